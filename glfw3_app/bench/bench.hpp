@@ -0,0 +1,101 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	ベンチマーク、テスト共通
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+
+namespace bench {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	経過時間計測
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class timer {
+		typedef std::chrono::steady_clock	clock;
+		clock::time_point	org_;
+	public:
+		timer() : org_(clock::now()) { }
+
+		void reset() { org_ = clock::now(); }
+
+		double get_msec() const {
+			auto d = clock::now() - org_;
+			return std::chrono::duration<double, std::milli>(d).count();
+		}
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	計測結果を表示
+		@param[in]	name	名前
+		@param[in]	msec	経過時間
+		@param[in]	num		処理数
+		@param[in]	unit	単位
+	*/
+	//-----------------------------------------------------------------//
+	inline void report(const char* name, double msec, double num, const char* unit)
+	{
+		double rate = msec > 0.0 ? num * 1000.0 / msec : 0.0;
+		printf("  %-32s %10.2f ms  %14.0f %s/s\n", name, msec, rate, unit);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	テスト結果を検査
+		@param[in]	ok		結果
+		@param[in]	name	名前
+		@return 失敗なら「1」
+	*/
+	//-----------------------------------------------------------------//
+	inline int check(bool ok, const std::string& name)
+	{
+		printf("  %-48s %s\n", name.c_str(), ok ? "OK" : "NG");
+		return ok ? 0 : 1;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	一時ファイルのパスを作る（TMPDIR、TEMP、無ければ /tmp）
+		@param[in]	name	ファイル名
+		@return パス
+	*/
+	//-----------------------------------------------------------------//
+	inline std::string temp_path(const char* name)
+	{
+		const char* dir = std::getenv("TMPDIR");
+		if(dir == nullptr) dir = std::getenv("TEMP");
+		if(dir == nullptr) dir = "/tmp";
+		std::string s = dir;
+		if(!s.empty() && s.back() != '/' && s.back() != '\\') s += '/';
+		s += name;
+		return s;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	最適化で計算が取り除かれないようにする
+		@param[in]	v	値
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline void keep(const T& v)
+	{
+		static volatile T tmp;
+		tmp = v;
+		(void)tmp;
+	}
+}
@@ -0,0 +1,445 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	utils::from_chars / to_chars と、解析済みフォーマットのテスト @n
+			整数のオーバーフローと基数、浮動小数点の中間値（二重丸め）、@n
+			±22 の高速経路を超える指数、inf/nan を strtod、strtof と比べる。@n
+			to_chars の読み戻し、実行時と解析済みフォーマットの出力を比べる。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include "bench.hpp"
+#include "utils/chars_conv.hpp"
+#include "utils/format.hpp"
+
+namespace bench {
+
+	template <typename T>
+	inline bool chars_int_(const char* s, int base, std::errc ec, T ref, size_t used)
+	{
+		T v = static_cast<T>(123);
+		auto r = utils::from_chars(s, s + std::strlen(s), v, base);
+		if(r.ec != ec || static_cast<size_t>(r.ptr - s) != used) return false;
+		// エラーなら値を変更しない
+		return ec == std::errc() ? v == ref : v == static_cast<T>(123);
+	}
+
+
+	inline bool chars_same_bits_(float a, float b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+	inline bool chars_same_bits_(double a, double b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+
+
+	inline double chars_strto_(const char* s, char** e, double) { return std::strtod(s, e); }
+	inline float chars_strto_(const char* s, char** e, float) { return std::strtof(s, e); }
+
+
+	inline bool chars_is_inf_text_(const char* s)
+	{
+		if(*s == '-') ++s;
+		return (*s | 0x20) == 'i';
+	}
+
+
+	// strtod、strtof と同じ値、同じ終了位置になるか
+	template <typename T>
+	inline bool chars_real_(const char* s)
+	{
+		size_t len = std::strlen(s);
+		T v = 0;
+		auto r = utils::from_chars(s, s + len, v);
+		char* e;
+		T ref = chars_strto_(s, &e, T());
+		if(e == s) return r.ec == std::errc::invalid_argument && r.ptr == s;
+		if(r.ptr != e) return false;
+		if(std::isinf(ref) && !chars_is_inf_text_(s)) return r.ec == std::errc::result_out_of_range;
+		if(r.ec != std::errc()) return false;
+		if(std::isnan(ref)) return std::isnan(v);
+		return chars_same_bits_(v, ref);
+	}
+
+
+	template <typename T>
+	inline bool chars_round_trip_(T v)
+	{
+		char tmp[64];
+		auto r = utils::to_chars(tmp, tmp + sizeof(tmp), v);
+		if(r.ec != std::errc()) return false;
+		T back = 0;
+		auto b = utils::from_chars(tmp, r.ptr, back);
+		return b.ec == std::errc() && b.ptr == r.ptr && chars_same_bits_(back, v);
+	}
+
+
+	template <typename T>
+	inline bool chars_int_round_trip_(T v, int base)
+	{
+		char tmp[80];
+		auto r = utils::to_chars(tmp, tmp + sizeof(tmp), v, base);
+		if(r.ec != std::errc()) return false;
+		T back = 0;
+		auto b = utils::from_chars(tmp, r.ptr, back, base);
+		if(b.ec != std::errc() || b.ptr != r.ptr || back != v) return false;
+		// 領域が足りない場合
+		size_t len = r.ptr - tmp;
+		auto s = utils::to_chars(tmp, tmp + len - 1, v, base);
+		return s.ec == std::errc::value_too_large && s.ptr == tmp + len - 1;
+	}
+
+
+	template <class FMT>
+	inline void chars_format_args_(FMT&) { }
+
+	template <class FMT, typename T, typename... Args>
+	inline void chars_format_args_(FMT& f, T v, Args... args)
+	{
+		f % v;
+		chars_format_args_(f, args...);
+	}
+
+
+	// 同じ文字列を、実行時の解析と解析済みで出力して比べる
+	template <uint32_t N, typename... Args>
+	inline bool chars_format_same_(const utils::format_spec<N>& spec, bool status, Args... args)
+	{
+		char a[256] = { 0 };
+		char b[256] = { 0 };
+		utils::sformat fa(spec.form_, a, sizeof(a));
+		chars_format_args_(fa, args...);
+		bool sa = fa.status();
+		int na = fa.size();
+		utils::sformat fb(spec, b, sizeof(b));
+		chars_format_args_(fb, args...);
+		return sa == status && fb.status() == status && fb.size() == na && std::strcmp(a, b) == 0;
+	}
+
+
+	inline int chars_conv()
+	{
+		int err = 0;
+
+		// 整数
+		{
+			bool ok = chars_int_<int32_t>("2147483647", 10, std::errc(), 2147483647, 10);
+			ok = ok && chars_int_<int32_t>("2147483648", 10, std::errc::result_out_of_range, 0, 10);
+			ok = ok && chars_int_<int32_t>("-2147483648", 10, std::errc(), INT32_MIN, 11);
+			ok = ok && chars_int_<int32_t>("-2147483649", 10, std::errc::result_out_of_range, 0, 11);
+			ok = ok && chars_int_<int32_t>("99999999999999999999x", 10, std::errc::result_out_of_range, 0, 20);
+			ok = ok && chars_int_<uint8_t>("255", 10, std::errc(), 255, 3);
+			ok = ok && chars_int_<uint8_t>("256", 10, std::errc::result_out_of_range, 0, 3);
+			ok = ok && chars_int_<int8_t>("-128", 10, std::errc(), -128, 4);
+			ok = ok && chars_int_<int8_t>("128", 10, std::errc::result_out_of_range, 0, 3);
+			ok = ok && chars_int_<uint64_t>("18446744073709551615", 10, std::errc(), UINT64_MAX, 20);
+			ok = ok && chars_int_<uint64_t>("18446744073709551616", 10, std::errc::result_out_of_range, 0, 20);
+			ok = ok && chars_int_<int64_t>("-9223372036854775808", 10, std::errc(), INT64_MIN, 20);
+			ok = ok && chars_int_<uint32_t>("-1", 10, std::errc::invalid_argument, 0, 0);
+			ok = ok && chars_int_<int32_t>("-", 10, std::errc::invalid_argument, 0, 0);
+			ok = ok && chars_int_<int32_t>("+1", 10, std::errc::invalid_argument, 0, 0);
+			ok = ok && chars_int_<int32_t>("", 10, std::errc::invalid_argument, 0, 0);
+			ok = ok && chars_int_<int32_t>("12abc", 10, std::errc(), 12, 2);
+			err += check(ok, "from_chars int overflow");
+
+			ok = chars_int_<uint32_t>("ff", 16, std::errc(), 255, 2);
+			ok = ok && chars_int_<uint32_t>("FFFFFFFF", 16, std::errc(), 0xffffffff, 8);
+			ok = ok && chars_int_<uint32_t>("100000000", 16, std::errc::result_out_of_range, 0, 9);
+			ok = ok && chars_int_<int32_t>("-80000000", 16, std::errc(), INT32_MIN, 9);
+			ok = ok && chars_int_<int32_t>("777", 8, std::errc(), 511, 3);
+			ok = ok && chars_int_<int32_t>("1012", 2, std::errc(), 5, 3);
+			ok = ok && chars_int_<int32_t>("zZ", 36, std::errc(), 35 * 36 + 35, 2);
+			ok = ok && chars_int_<int32_t>("g", 16, std::errc::invalid_argument, 0, 0);
+			ok = ok && chars_int_<int32_t>("9", 8, std::errc::invalid_argument, 0, 0);
+			err += check(ok, "from_chars int base");
+		}
+
+		// 浮動小数点（strtod、strtof が基準）
+		{
+			static const char* mid[] = {
+				"16777217", "16777219", "33554434", "33554438",			// float の丁度中間
+				"1.000000059604644775390625",							// 1 + 2^-24
+				"1.000000059604644776", "1.000000059604644775",			// 中間の直ぐ上、下
+				"0.30000001192092895507812", "9007199254740993",		// 2^53 + 1
+				"9007199254740992", "9007199254740994",
+				"4503599627370497.5", "2.5", "0.1", "0.2", "0.3",
+				// 高速経路で double が float の中間に丸まる（真の値は中間ではない）
+				"2.749544946709648e-04", "7.723983749747276e-02", "9.27905598655343e-03",
+				"3.923612518310547e+02", "1.881959941238165e-02", "2.004416842282808e-06",
+			};
+			static const char* range[] = {
+				"1e22", "1e23", "1e-22", "1e-23", "123456789e20", "1.5e-30", "3.4028235e38",
+				"3.4028236e38", "1e39", "1.17549435e-38", "1.4e-45", "1e-46",
+				"1.7976931348623157e308", "1.7976931348623159e308", "1e400", "-1e400",
+				"2.2250738585072011e-308", "4.9e-324", "2e-324", "1e-400",
+				"123456789012345678901234567890", "0.000000000000000000000000000001234",
+				"1e+5", "1E-5", "1e", "1e+", "-.5", ".5", "5.", ".", "-", "", "e5",
+				"-0", "-0.0e10", "00012.50", "1e99999999999",
+			};
+			static const char* special[] = {
+				"inf", "INF", "-inf", "infinity", "-Infinity", "infinit", "nan", "NaN", "-nan",
+				"nanx", "in", "na",
+			};
+			bool ok = true;
+			for(const char* s : mid) ok = ok && chars_real_<float>(s) && chars_real_<double>(s);
+			err += check(ok, "from_chars float midpoint / double rounding");
+
+			ok = true;
+			for(const char* s : range) ok = ok && chars_real_<float>(s) && chars_real_<double>(s);
+			err += check(ok, "from_chars beyond e+-22 fast path");
+
+			ok = true;
+			for(const char* s : special) ok = ok && chars_real_<float>(s) && chars_real_<double>(s);
+			// strtod と違い、「+」と１６進は受け付けない
+			{
+				float v = 1.0f;
+				const char* s = "+inf";
+				auto r = utils::from_chars(s, s + 4, v);
+				ok = ok && r.ec == std::errc::invalid_argument && r.ptr == s && v == 1.0f;
+				s = "0x10";
+				r = utils::from_chars(s, s + 4, v);
+				ok = ok && r.ec == std::errc() && r.ptr == s + 1 && v == 0.0f;
+			}
+			err += check(ok, "from_chars inf / nan");
+
+			// 乱数の数字列（仮数の桁数と指数を変える）
+			std::mt19937 rnd(47);
+			ok = true;
+			for(uint32_t i = 0; i < 200000 && ok; ++i) {
+				char tmp[64];
+				uint32_t nd = 1 + rnd() % 24;
+				uint32_t n = 0;
+				if(rnd() & 1) tmp[n++] = '-';
+				uint32_t dot = rnd() % (nd + 1);
+				for(uint32_t j = 0; j < nd; ++j) {
+					if(j == dot && j != 0) tmp[n++] = '.';
+					tmp[n++] = '0' + rnd() % 10;
+				}
+				int e = static_cast<int>(rnd() % 90) - 45;
+				if(i & 1) e = static_cast<int>(rnd() % 700) - 350;
+				n += snprintf(&tmp[n], sizeof(tmp) - n, "e%d", e);
+				ok = chars_real_<float>(tmp) && chars_real_<double>(tmp);
+			}
+			err += check(ok, "from_chars random vs strtod / strtof");
+		}
+
+		// to_chars の読み戻し
+		{
+			bool ok = true;
+			for(int base : { 10, 2, 8, 16, 36 }) {
+				ok = ok && chars_int_round_trip_<int8_t>(INT8_MIN, base)
+					&& chars_int_round_trip_<int8_t>(INT8_MAX, base)
+					&& chars_int_round_trip_<uint8_t>(UINT8_MAX, base)
+					&& chars_int_round_trip_<int32_t>(INT32_MIN, base)
+					&& chars_int_round_trip_<int32_t>(0, base)
+					&& chars_int_round_trip_<uint32_t>(UINT32_MAX, base)
+					&& chars_int_round_trip_<int64_t>(INT64_MIN, base)
+					&& chars_int_round_trip_<int64_t>(INT64_MAX, base)
+					&& chars_int_round_trip_<uint64_t>(UINT64_MAX, base);
+			}
+			std::mt19937 rnd(48);
+			for(uint32_t i = 0; i < 100000 && ok; ++i) {
+				uint64_t u = (static_cast<uint64_t>(rnd()) << 32 | rnd()) >> (rnd() % 64);
+				int64_t v = static_cast<int64_t>(u);
+				if(rnd() & 1) v = ~v;
+				ok = chars_int_round_trip_(v, 10) && chars_int_round_trip_(static_cast<int32_t>(v), 10);
+			}
+			err += check(ok, "to_chars int round trip");
+
+			ok = true;
+			for(uint32_t i = 0; i < 100000 && ok; ++i) {
+				uint32_t fb = rnd();
+				uint64_t db = static_cast<uint64_t>(rnd()) << 32 | rnd();
+				float f;
+				double d;
+				std::memcpy(&f, &fb, sizeof(f));
+				std::memcpy(&d, &db, sizeof(d));
+				if(std::isfinite(f)) ok = chars_round_trip_(f);
+				if(ok && std::isfinite(d)) ok = chars_round_trip_(d);
+			}
+			static const double dv[] = { 0.1, 1.0 / 3.0, 1e23, 5e-324, 1.7976931348623157e308, -0.0 };
+			for(double d : dv) ok = ok && chars_round_trip_(d) && chars_round_trip_(static_cast<float>(d));
+			char tmp[16];
+			auto r = utils::to_chars(tmp, tmp + sizeof(tmp), 1.5, 3);
+			ok = ok && r.ec == std::errc() && std::string(tmp, r.ptr) == "1.500";
+			r = utils::to_chars(tmp, tmp + 3, 1.5, 3);
+			ok = ok && r.ec == std::errc::value_too_large;
+			err += check(ok, "to_chars float / double round trip");
+		}
+
+		// 実行時と解析済みフォーマット
+		{
+			static constexpr auto f0 = utils::make_format("%d: %s\n");
+			static_assert(f0.check<int, const char*>(), "check<int, const char*>");
+			static_assert(!f0.check<int>(), "argument count");
+			static_assert(!f0.check<const char*, int>(), "argument type");
+			static constexpr auto f1 = utils::make_format("100%% done, %d%%");
+			static_assert(f1.check<int>() && f1.args() == 1, "%% is not an argument");
+			static constexpr auto f2 = utils::make_format("%q %d");
+			static_assert(!f2.status() && !f2.check<int>(), "unknown conversion");
+			static constexpr auto f3 = utils::make_format("[%5d] [%-3d] [%05d] [%+d] [%x] [%X] [%o] [%b]");
+			static constexpr auto f4 = utils::make_format("%c%c %s %7.3f %e %g %1.0f");
+			static_assert(f4.check<char, char, const char*, float, float, double, double>(), "f4");
+			static constexpr auto f5 = utils::make_format("literal only");
+			static_assert(f5.args() == 0 && f5.check<>(), "f5");
+			static constexpr auto f6 = utils::make_format("%d %s");
+
+			bool ok = chars_format_same_(f0, true, 42, "abc");
+			ok = ok && chars_format_same_(f1, true, 75);
+			ok = ok && chars_format_same_(f2, false, 1);
+			ok = ok && chars_format_same_(f3, true, 12, 3, -42, 7, 255, 255, 8, 5);
+			ok = ok && chars_format_same_(f4, true, 'a', 'b', "xyz", 3.14159f, 1234.5f, 0.001, 2.5);
+			ok = ok && chars_format_same_(f5, true);
+			ok = ok && chars_format_same_(f6, false, "str", 1);  // 型の不一致
+			{
+				char tmp[64] = { 0 };
+				utils::sformat(f1, tmp, sizeof(tmp)) % 75;
+				ok = ok && std::strcmp(tmp, "100% done, 75%") == 0;
+			}
+			err += check(ok, "pre-parsed format == runtime format");
+		}
+		return err;
+	}
+
+
+	inline int chars_conv_bench()
+	{
+		static const uint32_t num = 200000;
+		std::mt19937 rnd(49);
+		std::vector<std::string> ints;
+		std::vector<std::string> reals;
+		ints.reserve(num);
+		reals.reserve(num);
+		for(uint32_t i = 0; i < num; ++i) {
+			ints.push_back(std::to_string(static_cast<int32_t>(rnd())));
+			char tmp[64];
+			snprintf(tmp, sizeof(tmp), "%.*g", static_cast<int>(1 + rnd() % 9), (rnd() / 65536.0 - 32768.0) * 0.01);
+			reals.push_back(tmp);
+		}
+
+		timer t;
+		{
+			int64_t sum = 0;
+			for(const auto& s : ints) {
+				int32_t v = 0;
+				utils::from_chars(s.data(), s.data() + s.size(), v);
+				sum += v;
+			}
+			keep(sum);
+		}
+		report("from_chars int 200k", t.get_msec(), num, "items");
+		t.reset();
+		{
+			int64_t sum = 0;
+			for(const auto& s : ints) sum += std::strtol(s.c_str(), nullptr, 10);
+			keep(sum);
+		}
+		report("strtol int 200k", t.get_msec(), num, "items");
+		t.reset();
+		{
+			int64_t sum = 0;
+			for(const auto& s : ints) sum += boost::lexical_cast<int32_t>(s);
+			keep(sum);
+		}
+		report("lexical_cast int 200k", t.get_msec(), num, "items");
+
+		t.reset();
+		{
+			double sum = 0;
+			for(const auto& s : reals) {
+				float v = 0;
+				utils::from_chars(s.data(), s.data() + s.size(), v);
+				sum += v;
+			}
+			keep(sum);
+		}
+		report("from_chars float 200k", t.get_msec(), num, "items");
+		t.reset();
+		{
+			double sum = 0;
+			for(const auto& s : reals) {
+				double v = 0;
+				utils::from_chars(s.data(), s.data() + s.size(), v);
+				sum += v;
+			}
+			keep(sum);
+		}
+		report("from_chars double 200k", t.get_msec(), num, "items");
+		t.reset();
+		{
+			double sum = 0;
+			for(const auto& s : reals) sum += std::strtod(s.c_str(), nullptr);
+			keep(sum);
+		}
+		report("strtod 200k", t.get_msec(), num, "items");
+		t.reset();
+		{
+			double sum = 0;
+			for(const auto& s : reals) sum += boost::lexical_cast<float>(s);
+			keep(sum);
+		}
+		report("lexical_cast float 200k", t.get_msec(), num, "items");
+
+		char tmp[64];
+		t.reset();
+		{
+			size_t sum = 0;
+			for(uint32_t i = 0; i < num; ++i) {
+				auto r = utils::to_chars(tmp, tmp + sizeof(tmp), static_cast<int32_t>(i * 2654435761U));
+				sum += r.ptr - tmp;
+			}
+			keep(sum);
+		}
+		report("to_chars int 200k", t.get_msec(), num, "items");
+		t.reset();
+		{
+			size_t sum = 0;
+			for(uint32_t i = 0; i < num; ++i) {
+				sum += snprintf(tmp, sizeof(tmp), "%d", static_cast<int32_t>(i * 2654435761U));
+			}
+			keep(sum);
+		}
+		report("snprintf int 200k", t.get_msec(), num, "items");
+
+		static constexpr auto fm = utils::make_format("frame %d: pos (%5.2f, %5.2f) name %s\n");
+		static_assert(fm.check<uint32_t, float, float, const char*>(), "fm");
+		t.reset();
+		{
+			size_t sum = 0;
+			for(uint32_t i = 0; i < num; ++i) {
+				utils::sformat f("frame %d: pos (%5.2f, %5.2f) name %s\n", tmp, sizeof(tmp));
+				f % i % (i * 0.5f) % (i * 0.25f) % "widget";
+				sum += f.size();
+			}
+			keep(sum);
+		}
+		report("sformat runtime 200k", t.get_msec(), num, "items");
+		t.reset();
+		{
+			size_t sum = 0;
+			for(uint32_t i = 0; i < num; ++i) {
+				utils::sformat f(fm, tmp, sizeof(tmp));
+				f % i % (i * 0.5f) % (i * 0.25f) % "widget";
+				sum += f.size();
+			}
+			keep(sum);
+		}
+		report("sformat pre-parsed 200k", t.get_msec(), num, "items");
+		t.reset();
+		{
+			size_t sum = 0;
+			for(uint32_t i = 0; i < num; ++i) {
+				sum += snprintf(tmp, sizeof(tmp), "frame %u: pos (%5.2f, %5.2f) name %s\n",
+					i, i * 0.5, i * 0.25, "widget");
+			}
+			keep(sum);
+		}
+		report("snprintf 200k", t.get_msec(), num, "items");
+		return 0;
+	}
+}
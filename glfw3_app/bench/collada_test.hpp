@@ -0,0 +1,516 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	collada SAX デコーダーとバイナリ・キャッシュのテスト @n
+			float_array と <p> のデコードは、以前のパーサーが使っていた @n
+			utils::string_to_float、utils::string_to_int とビット単位で @n
+			一致する事。キャッシュは書き込み→読み込みで一致し、元ファイルの @n
+			内容、サイズ、パスが変わった場合と、壊れた場合は読まない事。@n
+			メッシュ最適化の後も、三角形の集合と巻き方向、頂点の属性は @n
+			変わらない事。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <random>
+#include <cstring>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include "bench.hpp"
+#include "utils/file_io.hpp"
+#include "utils/string_utils.hpp"
+#include "collada/dae_sax.hpp"
+#include "collada/dae_cache.hpp"
+#include "collada/dae_optimize.hpp"
+
+namespace bench {
+
+	// SAX パーサーで、float_array と p のテキストをデコードする
+	struct collada_handler_ {
+		std::vector<float>	floats_;
+		std::vector<int>	ints_;
+		bool				array_;
+		bool				pointer_;
+		bool				error_;
+
+		collada_handler_() : array_(false), pointer_(false), error_(false) { }
+
+		void start(const std::string& name, const collada::sax::attrs& as) {
+			if(name == "float_array") array_ = true;
+			else if(name == "p") pointer_ = true;
+		}
+		void end(const std::string& name) {
+			array_ = false;
+			pointer_ = false;
+		}
+		void text(const char* org, const char* end, bool cdata) {
+			if(array_) {
+				if(!collada::sax::decode_floats(org, end, floats_)) error_ = true;
+			} else if(pointer_) {
+				if(!collada::sax::decode_ints(org, end, ints_)) error_ = true;
+			}
+		}
+	};
+
+
+	inline bool collada_same_floats_(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		return a.size() == b.size() && (a.empty() || std::memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0);
+	}
+
+
+	// DAE の出力に現れる書式を混ぜる
+	inline std::string collada_float_text_(std::mt19937& rnd)
+	{
+		char tmp[64];
+		std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+		std::uniform_int_distribution<int> ue(-30, 30);
+		float v = u(rnd) * std::pow(10.0f, static_cast<float>(ue(rnd)));
+		switch(rnd() % 6) {
+		case 0:
+			snprintf(tmp, sizeof(tmp), "%g", v);
+			break;
+		case 1:
+			snprintf(tmp, sizeof(tmp), "%.9g", v);
+			break;
+		case 2:
+			snprintf(tmp, sizeof(tmp), "%.6f", u(rnd) * 1000.0f);
+			break;
+		case 3:
+			snprintf(tmp, sizeof(tmp), "%.17e", static_cast<double>(v));
+			break;
+		case 4:
+			snprintf(tmp, sizeof(tmp), "%d", static_cast<int>(rnd() % 100000) - 50000);
+			break;
+		default:
+			// 仮数が長い（高速パスを使わない）
+			snprintf(tmp, sizeof(tmp), "%.20f", u(rnd));
+			break;
+		}
+		return tmp;
+	}
+
+
+	inline int collada_sax()
+	{
+		int err = 0;
+		std::mt19937 rnd(31);
+		static const char* spaces[] = { " ", "  ", "\t", "\n", "\r\n", " \n\t" };
+		{
+			bool ok = true;
+			static const char* fixed[] = {
+				"0", "-0", "1", "-1", "0.5", "1e10", "1E-10", "3.4028235e38", "1.17549435e-38",
+				"16777216", "16777217", "0.1", "123456789", "1.0000001", "+2.5", "7.", ".25",
+				"0.000000000001", "1234567890123456789012", "0.30000001192092896",
+			};
+			for(const char* s : fixed) {
+				std::vector<float> ref;
+				std::vector<float> out;
+				bool a = utils::string_to_float(s, ref);
+				bool b = collada::sax::decode_floats(s, s + std::strlen(s), out);
+				if(a != b || !collada_same_floats_(ref, out)) {
+					ok = false;
+					std::cout << "    float: '" << s << "'" << std::endl;
+				}
+			}
+			for(uint32_t loop = 0; loop < 2000; ++loop) {
+				std::string old_text;
+				std::string dae_text;
+				uint32_t n = rnd() % 64;
+				for(uint32_t i = 0; i < n; ++i) {
+					std::string t = collada_float_text_(rnd);
+					if(i) old_text += ' ';
+					old_text += t;
+					dae_text += spaces[rnd() % 6];
+					dae_text += t;
+				}
+				dae_text += spaces[rnd() % 6];
+				std::vector<float> ref;
+				std::vector<float> out;
+				ok = ok && utils::string_to_float(old_text, ref);
+				ok = ok && collada::sax::decode_floats(dae_text.data(), dae_text.data() + dae_text.size(), out);
+				ok = ok && collada_same_floats_(ref, out);
+			}
+			err += check(ok, "collada decode_floats == string_to_float");
+		}
+		{
+			bool ok = true;
+			for(uint32_t loop = 0; loop < 2000; ++loop) {
+				std::string old_text;
+				std::string dae_text;
+				uint32_t n = rnd() % 64;
+				for(uint32_t i = 0; i < n; ++i) {
+					int v;
+					switch(rnd() % 4) {
+					case 0: v = rnd() % 1000; break;
+					case 1: v = static_cast<int>(rnd()); break;
+					case 2: v = INT_MAX - static_cast<int>(rnd() % 3); break;
+					default: v = INT_MIN + static_cast<int>(rnd() % 3); break;
+					}
+					std::string t = std::to_string(v);
+					if(i) old_text += ' ';
+					old_text += t;
+					dae_text += spaces[rnd() % 6];
+					dae_text += t;
+				}
+				std::vector<int32_t> ref;
+				std::vector<int> out;
+				ok = ok && utils::string_to_int(old_text, ref);
+				ok = ok && collada::sax::decode_ints(dae_text.data(), dae_text.data() + dae_text.size(), out);
+				ok = ok && ref.size() == out.size() && std::equal(ref.begin(), ref.end(), out.begin());
+			}
+			// 範囲外と不正な文字は、どちらも失敗する
+			static const char* bad[] = { "2147483648", "-2147483649", "99999999999", "12a", "1.5", "-" };
+			for(const char* s : bad) {
+				std::vector<int32_t> ref;
+				std::vector<int> out;
+				bool a = utils::string_to_int(s, ref);
+				bool b = collada::sax::decode_ints(s, s + std::strlen(s), out);
+				if(a || b) {
+					ok = false;
+					std::cout << "    int: '" << s << "'" << std::endl;
+				}
+			}
+			err += check(ok, "collada decode_ints == string_to_int");
+		}
+		{
+			// パーサーを通しても同じ（コメント、CDATA、属性を含む）
+			std::vector<float> fref;
+			std::vector<int32_t> iref;
+			std::string farr;
+			std::string parr;
+			for(uint32_t i = 0; i < 3000; ++i) {
+				std::string t = collada_float_text_(rnd);
+				if(i) farr += ' ';
+				farr += t;
+				std::string p = std::to_string(rnd() % 100000);
+				if(i) parr += ' ';
+				parr += p;
+			}
+			utils::string_to_float(farr, fref);
+			utils::string_to_int(parr, iref);
+			std::string doc = "\xef\xbb\xbf<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+				"<!-- comment -->\n<COLLADA version=\"1.4.1\">\n<library_geometries>\n"
+				"<geometry id=\"g\" name=\"a &amp; b\"><mesh><source id=\"s\">\n"
+				"<float_array id=\"f\" count=\"3000\">\n" + farr + "\n</float_array>\n"
+				"</source><triangles material=\"m\" count=\"1000\"><p>" + parr + "</p>"
+				"</triangles><extra><![CDATA[<p>1 2</p>]]></extra></mesh></geometry>\n"
+				"</library_geometries>\n</COLLADA>\n";
+			collada_handler_ h;
+			collada::sax::parser parser;
+			bool ok = parser.parse(doc.data(), doc.data() + doc.size(), h) && !h.error_;
+			ok = ok && collada_same_floats_(fref, h.floats_);
+			ok = ok && iref.size() == h.ints_.size() && std::equal(iref.begin(), iref.end(), h.ints_.begin());
+			err += check(ok, "collada sax parser arrays");
+		}
+		return err;
+	}
+
+
+	inline bool collada_load_file_(const std::string& fn, std::string& s)
+	{
+		utils::file_io fin;
+		if(!fin.open(fn, "rb")) return false;
+		s.resize(fin.get_file_size());
+		bool ok = fin.read(&s[0], s.size()) == s.size();
+		fin.close();
+		return ok;
+	}
+
+
+	inline bool collada_save_file_(const std::string& fn, const void* p, size_t n)
+	{
+		utils::file_io fout;
+		if(!fout.open(fn, "wb")) return false;
+		bool ok = fout.write(p, n) == n;
+		fout.close();
+		return ok;
+	}
+
+
+	inline int collada_cache()
+	{
+		int err = 0;
+		const std::string src = temp_path("bench_collada.dae");
+		const std::string cache = temp_path("bench_collada.dae.dcache");
+
+		std::string text = "<COLLADA version=\"1.4.1\"><asset><unit meter=\"0.01\"/></asset></COLLADA>\n";
+		collada_save_file_(src, text.data(), text.size());
+
+		boost::property_tree::ptree pt;
+		pt.put("COLLADA.<xmlattr>.version", "1.4.1");
+		pt.put("COLLADA.asset.unit.<xmlattr>.meter", "0.01");
+		pt.add("COLLADA.library_materials.material", "m0");
+		pt.add("COLLADA.library_materials.material", "m1");
+		std::vector<float> fa;
+		std::vector<int> ia;
+		std::mt19937 rnd(7);
+		for(uint32_t i = 0; i < 5000; ++i) {
+			fa.push_back(static_cast<float>(rnd()) / 65536.0f);
+			ia.push_back(static_cast<int>(rnd() % 10000));
+		}
+
+		// 書き込み
+		{
+			std::string s;
+			bool ok = collada_load_file_(src, s);
+			collada::dae_cache::writer wr;
+			wr.put_header(s.size(), collada::dae_cache::content_hash(s.data(), s.size()), src);
+			wr.put(pt);
+			wr.put(fa);
+			wr.put(ia);
+			ok = ok && collada_save_file_(cache, &wr.buf_[0], wr.buf_.size());
+			err += check(ok, "collada cache write");
+		}
+
+		// 元ファイルを読んで、キャッシュが使えるか
+		auto valid = [&](const std::string& path, boost::property_tree::ptree& out,
+			std::vector<float>& fo, std::vector<int>& io) {
+			std::string s;
+			std::string c;
+			if(!collada_load_file_(src, s) || !collada_load_file_(cache, c)) return false;
+			collada::dae_cache::reader rd(c.data(), c.size());
+			if(!rd.check_header(s.size(), collada::dae_cache::content_hash(s.data(), s.size()), path)) {
+				return false;
+			}
+			rd.get(out);
+			rd.get(fo);
+			rd.get(io);
+			return rd.ok_ && rd.p_ == rd.end_;
+		};
+
+		{
+			boost::property_tree::ptree out;
+			std::vector<float> fo;
+			std::vector<int> io;
+			bool ok = valid(src, out, fo, io);
+			ok = ok && out == pt && collada_same_floats_(fa, fo) && ia == io;
+			err += check(ok, "collada cache round trip");
+		}
+
+		// 元ファイルが変わったら古い
+		{
+			boost::property_tree::ptree out;
+			std::vector<float> fo;
+			std::vector<int> io;
+			bool ok = !valid(src + "x", out, fo, io);
+			std::string t = text;
+			t[t.find("0.01")] = '1';
+			collada_save_file_(src, t.data(), t.size());
+			ok = ok && !valid(src, out, fo, io);
+			t = text + " ";
+			collada_save_file_(src, t.data(), t.size());
+			ok = ok && !valid(src, out, fo, io);
+			// 戻せば再び使える
+			collada_save_file_(src, text.data(), text.size());
+			out.clear();
+			ok = ok && valid(src, out, fo, io) && out == pt;
+			err += check(ok, "collada cache stale source");
+		}
+
+		// 壊れたキャッシュ
+		{
+			std::string s;
+			std::string c;
+			collada_load_file_(src, s);
+			collada_load_file_(cache, c);
+			uint64_t hash = collada::dae_cache::content_hash(s.data(), s.size());
+			bool ok = true;
+			for(size_t n = 0; n < c.size(); n += (n < 256 ? 1 : 97)) {
+				collada::dae_cache::reader rd(c.data(), n);
+				boost::property_tree::ptree out;
+				std::vector<float> fo;
+				std::vector<int> io;
+				if(rd.check_header(s.size(), hash, src)) {
+					rd.get(out);
+					rd.get(fo);
+					rd.get(io);
+					if(rd.ok_) ok = false;
+				}
+			}
+			for(size_t i = 0; i < 16; ++i) {
+				std::string t = c;
+				t[i] ^= 0x10;
+				collada::dae_cache::reader rd(t.data(), t.size());
+				if(rd.check_header(s.size(), hash, src)) ok = false;
+			}
+			// 配列の長さだけ大きい
+			std::string t = c;
+			collada::dae_cache::reader hd(t.data(), t.size());
+			hd.check_header(s.size(), hash, src);
+			boost::property_tree::ptree out;
+			hd.get(out);
+			size_t pos = hd.p_ - t.data();
+			t[pos + 3] = 0x7f;
+			collada::dae_cache::reader rd(t.data(), t.size());
+			std::vector<float> fo;
+			ok = ok && rd.check_header(s.size(), hash, src);
+			out.clear();
+			rd.get(out);
+			rd.get(fo);
+			ok = ok && !rd.ok_ && fo.empty();
+			err += check(ok, "collada cache truncated / corrupt");
+		}
+
+		utils::remove_file(src);
+		utils::remove_file(cache);
+		return err;
+	}
+
+
+	struct collada_mesh_ {
+		std::vector<float>	vertex_;
+		std::vector<float>	normal_;
+		std::vector<float>	texcoord_;
+		std::vector<float>	color_;
+		size_t				vertex_stride_;
+		size_t				normal_stride_;
+		size_t				texcoord_stride_;
+		size_t				color_stride_;
+		std::vector<uint32_t>	index_;
+		collada_mesh_() : vertex_stride_(3), normal_stride_(3), texcoord_stride_(2), color_stride_(4) { }
+	};
+
+
+	// 頂点の全属性をバイト列にする
+	inline std::string collada_vertex_key_(const collada_mesh_& m, uint32_t v)
+	{
+		std::string s;
+		s.append(reinterpret_cast<const char*>(&m.vertex_[v * m.vertex_stride_]), m.vertex_stride_ * 4);
+		if(!m.normal_.empty()) {
+			s.append(reinterpret_cast<const char*>(&m.normal_[v * m.normal_stride_]), m.normal_stride_ * 4);
+		}
+		if(!m.texcoord_.empty()) {
+			s.append(reinterpret_cast<const char*>(&m.texcoord_[v * m.texcoord_stride_]), m.texcoord_stride_ * 4);
+		}
+		if(!m.color_.empty()) {
+			s.append(reinterpret_cast<const char*>(&m.color_[v * m.color_stride_]), m.color_stride_ * 4);
+		}
+		return s;
+	}
+
+
+	// 三角形を、巻き方向を保ったまま最小の頂点が先頭になるように回して並べる
+	inline std::vector<std::string> collada_triangles_(const collada_mesh_& m)
+	{
+		std::vector<std::string> out;
+		uint32_t tnum = m.index_.empty() ? m.vertex_.size() / m.vertex_stride_ / 3 : m.index_.size() / 3;
+		for(uint32_t t = 0; t < tnum; ++t) {
+			std::string k[3];
+			for(uint32_t i = 0; i < 3; ++i) {
+				uint32_t v = m.index_.empty() ? t * 3 + i : m.index_[t * 3 + i];
+				k[i] = collada_vertex_key_(m, v);
+			}
+			uint32_t r = 0;
+			if(k[1] < k[r]) r = 1;
+			if(k[2] < k[r]) r = 2;
+			out.push_back(k[r] + k[(r + 1) % 3] + k[(r + 2) % 3]);
+		}
+		std::sort(out.begin(), out.end());
+		return out;
+	}
+
+
+	// 格子状のメッシュを展開して作る、seam 列はテクスチャ座標だけが違う
+	inline void collada_grid_(collada_mesh_& m, uint32_t w, uint32_t h, uint32_t seam, std::mt19937& rnd)
+	{
+		auto put = [&](uint32_t x, uint32_t y, bool right) {
+			float fx = static_cast<float>(x) * 0.25f;
+			float fy = static_cast<float>(y) * 0.25f;
+			m.vertex_.insert(m.vertex_.end(), { fx, fy, std::sin(fx) * std::cos(fy) });
+			m.normal_.insert(m.normal_.end(), { std::cos(fx), std::sin(fy), 1.0f });
+			float u = (x == seam && right) ? 1.0f : fx / (w * 0.25f);
+			m.texcoord_.insert(m.texcoord_.end(), { u, fy / (h * 0.25f) });
+			m.color_.insert(m.color_.end(), { fx, fy, 0.5f, 1.0f });
+		};
+		std::vector<uint32_t> tris;
+		for(uint32_t y = 0; y < h; ++y) {
+			for(uint32_t x = 0; x < w; ++x) {
+				tris.push_back(y * w + x);
+			}
+		}
+		std::shuffle(tris.begin(), tris.end(), rnd);
+		for(uint32_t q : tris) {
+			uint32_t x = q % w;
+			uint32_t y = q / w;
+			// seam の右側の四角形は、seam 上の頂点を u = 1 で使う
+			bool r = x + 1 == seam;
+			uint32_t rot = rnd() % 3;
+			uint32_t a[3][2] = { { x, y }, { x + 1, y }, { x + 1, y + 1 } };
+			uint32_t b[3][2] = { { x, y }, { x + 1, y + 1 }, { x, y + 1 } };
+			for(uint32_t i = 0; i < 3; ++i) {
+				const uint32_t* p = a[(i + rot) % 3];
+				put(p[0], p[1], r);
+			}
+			for(uint32_t i = 0; i < 3; ++i) {
+				const uint32_t* p = b[(i + rot) % 3];
+				put(p[0], p[1], r);
+			}
+		}
+	}
+
+
+	inline int collada_optimize()
+	{
+		int err = 0;
+		std::mt19937 rnd(32);
+		{
+			static const uint32_t w = 40;
+			static const uint32_t h = 30;
+			static const uint32_t seam = 20;
+			collada_mesh_ m;
+			collada_grid_(m, w, h, seam, rnd);
+			collada_mesh_ org = m;
+			std::vector<std::string> ref = collada_triangles_(org);
+
+			collada::dae_optimize::report rep = collada::dae_optimize::optimize(m);
+			bool ok = !m.index_.empty() && rep.triangle_num_ == w * h * 2 && rep.source_num_ == w * h * 6;
+			ok = ok && collada_triangles_(m) == ref;
+			err += check(ok, "collada optimize same triangles and winding");
+
+			// 溶接後の頂点は、元の頂点のどれかと全属性が一致し、重複しない
+			std::vector<std::string> src;
+			for(uint32_t v = 0; v < rep.source_num_; ++v) src.push_back(collada_vertex_key_(org, v));
+			std::sort(src.begin(), src.end());
+			src.erase(std::unique(src.begin(), src.end()), src.end());
+			std::vector<std::string> dst;
+			for(uint32_t v = 0; v < rep.vertex_num_; ++v) dst.push_back(collada_vertex_key_(m, v));
+			std::sort(dst.begin(), dst.end());
+			ok = rep.vertex_num_ == (w + 1) * (h + 1) + (h + 1) && dst == src;
+			ok = ok && m.vertex_.size() == rep.vertex_num_ * 3 && m.normal_.size() == rep.vertex_num_ * 3
+				&& m.texcoord_.size() == rep.vertex_num_ * 2 && m.color_.size() == rep.vertex_num_ * 4;
+			ok = ok && rep.acmr_opt_ <= rep.acmr_weld_;
+			err += check(ok, "collada optimize vertex dedup keeps attributes");
+
+			// 二度目は何もしない
+			collada_mesh_ t = m;
+			rep = collada::dae_optimize::optimize(t);
+			ok = rep.triangle_num_ == 0 && t.index_ == m.index_ && t.vertex_ == m.vertex_;
+			err += check(ok, "collada optimize indexed mesh unchanged");
+		}
+		{
+			// 頂点数の合わないストリームは捨てる、共有が無ければ展開したまま
+			collada_mesh_ m;
+			collada_grid_(m, 8, 8, 100, rnd);
+			m.color_.resize(m.color_.size() - 4);
+			collada_mesh_ org = m;
+			org.color_.clear();
+			collada::dae_optimize::optimize(m);
+			bool ok = m.color_.empty() && !m.index_.empty() && collada_triangles_(m) == collada_triangles_(org);
+
+			collada_mesh_ s;
+			for(uint32_t i = 0; i < 30; ++i) {
+				for(uint32_t j = 0; j < 3; ++j) s.vertex_.push_back(static_cast<float>(i * 3 + j));
+			}
+			s.normal_stride_ = s.texcoord_stride_ = s.color_stride_ = 0;
+			std::vector<float> v = s.vertex_;
+			collada::dae_optimize::report rep = collada::dae_optimize::optimize(s);
+			ok = ok && s.index_.empty() && s.vertex_ == v && rep.vertex_num_ == 30;
+			err += check(ok, "collada optimize mismatched / unshared streams");
+		}
+		return err;
+	}
+}
@@ -0,0 +1,208 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	utils::csv_reader、csv_writer のテストとベンチマーク @n
+			引用、エスケープ、セル中の改行を含む 3000 行を往復させる。@n
+			分割して解析しても、逐次読み込みと同じ順序、同じ値になる事。@n
+			ベンチマークは、app::csv のロード、セーブと、以前の @n
+			get_line + split_text による読み込みも比べる。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <vector>
+#include "bench.hpp"
+#include "utils/csv_io.hpp"
+#include "utils/string_utils.hpp"
+#include "../ignitor/csv.hpp"
+
+namespace bench {
+
+	inline std::string csv_text_(uint32_t i)
+	{
+		switch(i % 5) {
+		case 0: return "plain" + std::to_string(i);
+		case 1: return "a,b," + std::to_string(i);
+		case 2: return "say \"hi\" " + std::to_string(i);
+		case 3: return "line\nbreak\r\n" + std::to_string(i);
+		default: return "";
+		}
+	}
+
+
+	inline void csv_write_rows_(utils::csv_writer& wr, uint32_t num)
+	{
+		wr.put("id").put("real").put("text").end_row();
+		for(uint32_t i = 0; i < num; ++i) {
+			wr.put(static_cast<int32_t>(i) - 1000).put(static_cast<float>(i) * 0.25f).put(csv_text_(i)).end_row();
+		}
+	}
+
+
+	inline bool csv_check_rows_(utils::csv_reader& rd, uint32_t num)
+	{
+		utils::csv_row row;
+		if(!rd.next(row) || row.size() != 3 || row[0] != "id") return false;
+		for(uint32_t i = 0; i < num; ++i) {
+			int32_t a = 0;
+			float b = 0.0f;
+			if(!rd.next(row) || row.size() != 3) return false;
+			if(!row.get(0, a) || a != static_cast<int32_t>(i) - 1000) return false;
+			if(!row.get(1, b) || b != static_cast<float>(i) * 0.25f) return false;
+			if(row[2] != csv_text_(i)) return false;
+		}
+		return !rd.next(row) && !rd.get_error() && rd.get_rows() == num + 1;
+	}
+
+
+	inline int csv_io()
+	{
+		static const uint32_t num = 3000;
+		int err = 0;
+		const std::string fn = temp_path("bench_csv_io.csv");
+
+		{
+			utils::csv_writer wr;
+			bool ok = wr.open(fn);
+			csv_write_rows_(wr, num);
+			ok = ok && wr.close();
+			utils::csv_reader rd;
+			ok = ok && rd.open(fn) && csv_check_rows_(rd, num);
+			err += check(ok, "3000 rows file round trip");
+		}
+
+		utils::csv_writer mw(',', true);
+		csv_write_rows_(mw, num);
+		const std::string& buf = mw.get_buffer();
+		{
+			utils::csv_reader rd;
+			rd.open(buf.data(), buf.size());
+			err += check(csv_check_rows_(rd, num), "3000 rows memory round trip (CRLF)");
+		}
+
+		{
+			utils::csv_reader rd;
+			rd.open(buf.data(), buf.size());
+			std::vector<utils::csv_column<int32_t>> cols;
+			cols.emplace_back(0, -1);
+			cols.emplace_back(2, -1);
+			uint32_t n = utils::csv_read_columns(rd, cols, 1);
+			bool ok = n == num && cols[0].error_ == 0 && cols[1].error_ == num;
+			for(uint32_t i = 0; ok && i < num; ++i) {
+				ok = cols[0].data_[i] == static_cast<int32_t>(i) - 1000 && cols[1].data_[i] == -1;
+			}
+			err += check(ok, "read columns, fill value");
+		}
+
+		{
+			// 小さく分割して、引用の中の改行で切らない事
+			std::vector<std::vector<int32_t>> part(8);
+			uint32_t chunks = utils::csv_parallel_for_each(buf.data(), buf.size(), 8,
+				[&](uint32_t chunk, const utils::csv_row& row) {
+					int32_t v;
+					if(row.size() == 3 && row.get(0, v) && row[2] == csv_text_(v + 1000)) {
+						part[chunk].push_back(v);
+					} else {
+						part[chunk].push_back(-99999);
+					}
+				}, ',', true, 4096);
+			std::vector<int32_t> all;
+			for(const auto& p : part) all.insert(all.end(), p.begin(), p.end());
+			bool ok = chunks == 8 && all.size() == num + 1 && all[0] == -99999;
+			for(uint32_t i = 0; ok && i < num; ++i) ok = all[i + 1] == static_cast<int32_t>(i) - 1000;
+			err += check(ok, "parallel split (8 chunks) == sequential");
+		}
+		utils::remove_file(fn);
+		return err;
+	}
+
+
+	inline int csv_io_bench()
+	{
+		static const uint32_t num = 1000000;
+		const std::string fn = temp_path("bench_csv_io.csv");
+		char tmp[64];
+
+		timer t;
+		utils::csv_writer wr;
+		wr.open(fn);
+		csv_write_rows_(wr, num);
+		wr.close();
+		report("csv write 1M rows", t.get_msec(), num, "rows");
+
+		utils::csv_reader rd;
+		rd.open(fn);
+		t.reset();
+		utils::csv_row row;
+		uint32_t cells = 0;
+		while(rd.next(row)) cells += row.size();
+		keep(cells);
+		report("csv read 1M rows", t.get_msec(), num, "rows");
+
+		rd.rewind();
+		t.reset();
+		{
+			std::vector<utils::csv_column<float>> cols;
+			cols.emplace_back(0);
+			cols.emplace_back(1);
+			utils::csv_read_columns(rd, cols, 1);
+			keep(cols[1].data_.size());
+		}
+		report("csv read columns 1M rows", t.get_msec(), num, "rows");
+
+		t.reset();
+		{
+			std::vector<utils::csv_column<float>> cols;
+			cols.emplace_back(0);
+			cols.emplace_back(1);
+			utils::csv_read_columns_parallel(rd, cols, 1);
+			keep(cols[1].data_.size());
+		}
+		snprintf(tmp, sizeof(tmp), "csv read columns 1M rows (%u threads)", utils::csv_threads_(0));
+		report(tmp, t.get_msec(), num, "rows");
+		rd.close();
+
+		// app::csv（引用の無いセル）
+		{
+			app::csv cv;
+			cv.create(3, num);
+			for(uint32_t i = 0; i < num; ++i) {
+				cv.set(0, i, std::to_string(static_cast<int32_t>(i) - 1000));
+				cv.set(1, i, std::to_string(i * 0.25f));
+				cv.set(2, i, "plain" + std::to_string(i));
+			}
+			t.reset();
+			cv.save(fn);
+			report("app::csv save 1M rows", t.get_msec(), num, "rows");
+
+			app::csv ld;
+			ld.create(3, num);
+			t.reset();
+			ld.load(fn);
+			report("app::csv load 1M rows", t.get_msec(), num, "rows");
+			keep(ld.get(2, num - 1).size());
+		}
+
+		// 以前の app::csv::load と同じ、get_line + split_text
+		t.reset();
+		{
+			std::vector<utils::strings> cell;
+			cell.reserve(num);
+			utils::file_io fio;
+			fio.open(fn, "rb");
+			while(!fio.eof()) {
+				auto line = fio.get_line();
+				if(line.empty()) continue;
+				cell.push_back(utils::split_text(line, ","));
+			}
+			fio.close();
+			keep(cell.size());
+		}
+		report("get_line + split_text 1M rows", t.get_msec(), num, "rows");
+
+		utils::remove_file(fn);
+		return 0;
+	}
+}
@@ -0,0 +1,245 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	utils::file_io のテストとベンチマーク @n
+			マップ読み出し、書き込みキャッシュの結果が stdio と一致する事。@n
+			一時ファイルはテストの後で消す。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstring>
+#include <vector>
+#include "bench.hpp"
+#include "utils/file_io.hpp"
+
+namespace bench {
+
+	inline std::string file_io_line_(uint32_t i)
+	{
+		char tmp[64];
+		snprintf(tmp, sizeof(tmp), "line %u, %08x abcdefghijklmnopqrstuvwxyz", i, i * 2654435761u);
+		return tmp;
+	}
+
+
+	inline bool file_io_read_all_(const std::string& fn, std::vector<char>& out)
+	{
+		out.clear();
+		FILE* fp = fopen(fn.c_str(), "rb");
+		if(fp == nullptr) return false;
+		char tmp[4096];
+		size_t n;
+		while((n = fread(tmp, 1, sizeof(tmp), fp)) > 0) out.insert(out.end(), tmp, tmp + n);
+		fclose(fp);
+		return true;
+	}
+
+
+	inline int file_io()
+	{
+		int err = 0;
+		const std::string fa = temp_path("bench_file_io_a.bin");
+		const std::string fb = temp_path("bench_file_io_b.bin");
+		const std::string fe = temp_path("bench_file_io_e.bin");
+
+		{	// w+b：キャッシュ越しの書き込み、シーク、読み出し
+			utils::file_io fo;
+			bool ok = fo.open(fa, "w+b");
+			std::vector<char> ref;
+			for(uint32_t i = 0; i < 200000; ++i) {
+				char c = static_cast<char>(i * 7 + (i >> 8));
+				ok = ok && fo.put_char(c);
+				ref.push_back(c);
+			}
+			ok = ok && fo.tell() == ref.size();
+			ok = ok && fo.seek(1000, utils::file_io::seek::set);
+			char tmp[100];
+			ok = ok && fo.read(tmp, sizeof(tmp)) == sizeof(tmp);
+			ok = ok && std::memcmp(tmp, &ref[1000], sizeof(tmp)) == 0;
+			fo.close();
+			std::vector<char> all;
+			ok = ok && file_io_read_all_(fa, all) && all == ref;
+			err += check(ok, "w+b write/seek/read");
+		}
+
+		{	// put_line と、マップ、stdio の get_line
+			static const uint32_t num = 10000;
+			utils::file_io fo;
+			bool ok = fo.open(fa, "wb");
+			for(uint32_t i = 0; i < num; ++i) ok = ok && fo.put_line(file_io_line_(i), (i & 1) != 0);
+			ok = ok && fo.put("last line without LF");
+			fo.close();
+
+			utils::file_io fm;
+			ok = ok && fm.open_map(fa) && fm.is_mapped();
+			utils::file_io fs;
+			ok = ok && fs.open(fa, "rb");
+			for(uint32_t i = 0; i <= num; ++i) {
+				std::string ref = i < num ? file_io_line_(i) : "last line without LF";
+				const char* top;
+				size_t len;
+				ok = ok && fm.get_line(top, len) && std::string(top, len) == ref;
+				ok = ok && fs.get_line() == ref;
+			}
+			const char* top;
+			size_t len;
+			ok = ok && !fm.get_line(top, len);
+			err += check(ok, "put_line / get_line (mapped, stdio)");
+
+			// 全体のスパン、ビュー、再オープン
+			std::vector<char> all;
+			file_io_read_all_(fa, all);
+			ok = fm.get_span() != nullptr && fm.get_file_size() == all.size()
+				&& std::memcmp(fm.get_span(), &all[0], all.size()) == 0;
+			fm.close();
+			ok = ok && fm.re_open() && fm.is_mapped();
+			ok = ok && fm.seek(10, utils::file_io::seek::set);
+			const char* v = fm.get_view(20);
+			ok = ok && v != nullptr && std::memcmp(v, &all[10], 20) == 0 && fm.tell() == 30;
+			ok = ok && fm.get_view(all.size()) == nullptr && fm.tell() == 30;
+			fm.close();
+			fs.close();
+			err += check(ok, "span / view / re_open");
+		}
+
+		{	// 空のファイルはマップせずに開く
+			utils::file_io fo;
+			fo.open(fe, "wb");
+			fo.close();
+			utils::file_io fi;
+			bool ok = fi.open_map(fe) && !fi.is_mapped();
+			char c;
+			ok = ok && fi.read(&c, 1) == 0;
+			fi.close();
+			ok = ok && fi.re_open();
+			fi.close();
+			err += check(ok, "open_map empty file fallback");
+		}
+
+		{
+			bool ok = utils::copy_file(fa, fb, true);
+			std::vector<char> a, b;
+			ok = ok && file_io_read_all_(fa, a) && file_io_read_all_(fb, b) && a == b;
+			err += check(ok, "copy_file");
+		}
+
+		utils::remove_file(fa);
+		utils::remove_file(fb);
+		utils::remove_file(fe);
+		return err;
+	}
+
+
+	inline int file_io_bench()
+	{
+		static const uint32_t lines = 2000000;
+		static const uint32_t bytes = 16 * 1024 * 1024;
+		const std::string ft = temp_path("bench_file_io_t.txt");
+		const std::string fb = temp_path("bench_file_io_b.bin");
+
+		std::vector<std::string> src(lines);
+		for(uint32_t i = 0; i < lines; ++i) src[i] = file_io_line_(i);
+
+		timer t;
+		{
+			FILE* fp = fopen(ft.c_str(), "wb");
+			for(const auto& s : src) {
+				for(char c : s) fputc(c, fp);
+				fputc('\n', fp);
+			}
+			fclose(fp);
+		}
+		report("put_line 2M (stdio fputc)", t.get_msec(), lines, "lines");
+		t.reset();
+		{
+			utils::file_io fo;
+			fo.open(ft, "wb");
+			for(const auto& s : src) fo.put_line(s);
+			fo.close();
+		}
+		report("put_line 2M (file_io cache)", t.get_msec(), lines, "lines");
+
+		t.reset();
+		{
+			FILE* fp = fopen(fb.c_str(), "wb");
+			for(uint32_t i = 0; i < bytes; ++i) fputc(static_cast<char>(i), fp);
+			fclose(fp);
+		}
+		report("put_char 16M (stdio fputc)", t.get_msec(), bytes, "bytes");
+		t.reset();
+		{
+			utils::file_io fo;
+			fo.open(fb, "wb");
+			for(uint32_t i = 0; i < bytes; ++i) fo.put_char(static_cast<char>(i));
+			fo.close();
+		}
+		report("put_char 16M (file_io cache)", t.get_msec(), bytes, "bytes");
+
+		size_t total = 0;
+		t.reset();
+		{
+			utils::file_io fi;
+			fi.open(ft, "rb");
+			while(!fi.eof()) total += fi.get_line().size();
+			fi.close();
+		}
+		report("get_line 2M (stdio)", t.get_msec(), lines, "lines");
+		t.reset();
+		{
+			utils::file_io fi;
+			fi.open_map(ft);
+			while(!fi.eof()) total += fi.get_line().size();
+			fi.close();
+		}
+		report("get_line 2M (mapped)", t.get_msec(), lines, "lines");
+		t.reset();
+		{
+			utils::file_io fi;
+			fi.open_map(ft);
+			const char* top;
+			size_t len;
+			while(fi.get_line(top, len)) total += len;
+			fi.close();
+		}
+		report("get_line 2M (mapped view)", t.get_msec(), lines, "lines");
+		keep(total);
+
+		static const uint32_t rec = 12;
+		uint32_t sum = 0;
+		t.reset();
+		{
+			utils::file_io fi;
+			fi.open(fb, "rb");
+			char tmp[rec];
+			while(fi.read(tmp, rec) == rec) sum += tmp[0];
+			fi.close();
+		}
+		report("12-byte records (stdio)", t.get_msec(), bytes / rec, "records");
+		t.reset();
+		{
+			utils::file_io fi;
+			fi.open_map(fb);
+			char tmp[rec];
+			while(fi.read(tmp, rec) == rec) sum += tmp[0];
+			fi.close();
+		}
+		report("12-byte records (mapped)", t.get_msec(), bytes / rec, "records");
+		t.reset();
+		{
+			utils::file_io fi;
+			fi.open_map(fb);
+			const char* p;
+			while((p = fi.get_view(rec)) != nullptr) sum += p[0];
+			fi.close();
+		}
+		report("12-byte records (mapped view)", t.get_msec(), bytes / rec, "records");
+		keep(sum);
+
+		utils::remove_file(ft);
+		utils::remove_file(fb);
+		return 0;
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	galloc とシステムの malloc のベンチマーク @n
+			同じ乱数列で確保と開放を繰り返し、一定数のブロックを生かしておく。@n
+			ウィジェット（同じサイズの小さなオブジェクトを、フレーム毎に確保して @n
+			開放）と、画像バッファ（大きく、寿命が混在）の負荷も計る。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include "bench.hpp"
+#include "utils/galloc.hpp"
+
+namespace bench {
+
+	struct galloc_malloc_ {
+		static void* alloc(std::size_t n) { return std::malloc(n); }
+		static void free(void* p) { std::free(p); }
+	};
+
+	struct galloc_galloc_ {
+		static void* alloc(std::size_t n) { return global_memory_alloc(n); }
+		static void free(void* p) { global_memory_free(p); }
+	};
+
+
+	// live 個のブロックを入れ替えながら num 回確保する（小さいサイズが多い分布）
+	template <class A>
+	inline uint32_t galloc_churn_(uint32_t num, uint32_t live, uint32_t seed)
+	{
+		std::mt19937 rnd(seed);
+		std::vector<uint8_t*> blk(live, nullptr);
+		uint32_t sum = 0;
+		for(uint32_t i = 0; i < num; ++i) {
+			uint32_t r = rnd();
+			uint32_t idx = r % live;
+			std::size_t n = (r >> 16) & 7 ? 8 + ((r >> 8) & 255) : 256 + ((r >> 4) & 4095);
+			if(blk[idx]) {
+				sum += blk[idx][0];
+				A::free(blk[idx]);
+			}
+			blk[idx] = static_cast<uint8_t*>(A::alloc(n));
+			blk[idx][0] = static_cast<uint8_t>(i);
+		}
+		for(uint8_t* p : blk) A::free(p);
+		return sum;
+	}
+
+
+	// フレーム毎に、同じサイズの小さなオブジェクトを per 個確保し、フレームの終わりに開放する @n
+	// 一部（1/16）は、数フレーム生き残る
+	template <class A>
+	inline uint32_t galloc_widgets_(uint32_t frames, uint32_t per, uint32_t seed)
+	{
+		static const std::size_t sizes[] = { 96, 96, 96, 48, 160 };
+		std::mt19937 rnd(seed);
+		std::vector<uint8_t*> frame(per, nullptr);
+		std::vector<uint8_t*> hold(per / 16, nullptr);
+		uint32_t sum = 0;
+		for(uint32_t f = 0; f < frames; ++f) {
+			for(uint32_t i = 0; i < per; ++i) {
+				std::size_t n = sizes[i % 5];
+				uint8_t* p = static_cast<uint8_t*>(A::alloc(n));
+				p[0] = static_cast<uint8_t>(i);
+				p[n - 1] = static_cast<uint8_t>(f);
+				frame[i] = p;
+			}
+			for(uint32_t i = 0; i < hold.size(); ++i) {
+				uint32_t j = rnd() % per;
+				if(hold[i] != nullptr) {
+					sum += hold[i][0];
+					A::free(hold[i]);
+				}
+				hold[i] = frame[j];
+				frame[j] = nullptr;
+			}
+			// 生成と逆の順に開放する
+			for(uint32_t i = per; i > 0; --i) {
+				uint8_t* p = frame[i - 1];
+				if(p == nullptr) continue;
+				sum += p[0];
+				A::free(p);
+			}
+		}
+		for(uint8_t* p : hold) A::free(p);
+		return sum;
+	}
+
+
+	// 64x64 から 2048x2048 の RGBA バッファ @n
+	// 半分は直ぐに開放し（一時バッファ）、残りは live 個の中で入れ替える
+	template <class A>
+	inline uint32_t galloc_images_(uint32_t num, uint32_t live, uint32_t seed)
+	{
+		std::mt19937 rnd(seed);
+		std::vector<uint8_t*> blk(live, nullptr);
+		std::vector<std::size_t> len(live, 0);
+		uint32_t sum = 0;
+		for(uint32_t i = 0; i < num; ++i) {
+			uint32_t r = rnd();
+			std::size_t w = 64 << (r % 6);
+			std::size_t h = 64 << ((r >> 4) % 6);
+			std::size_t n = w * h * 4;
+			uint8_t* p = static_cast<uint8_t*>(A::alloc(n));
+			p[0] = static_cast<uint8_t>(i);
+			p[n - 1] = static_cast<uint8_t>(i);
+			if(r & 0x100) {
+				sum += p[n - 1];
+				A::free(p);
+				continue;
+			}
+			uint32_t idx = (r >> 12) % live;
+			if(blk[idx]) {
+				sum += blk[idx][len[idx] - 1];
+				A::free(blk[idx]);
+			}
+			blk[idx] = p;
+			len[idx] = n;
+		}
+		for(uint8_t* p : blk) A::free(p);
+		return sum;
+	}
+
+
+	template <class A>
+	inline double galloc_threads_(uint32_t threads, uint32_t num, uint32_t live)
+	{
+		timer t;
+		std::vector<std::thread> ths;
+		for(uint32_t i = 0; i < threads; ++i) {
+			ths.emplace_back([=] { keep(galloc_churn_<A>(num, live, 100 + i)); });
+		}
+		for(auto& th : ths) th.join();
+		return t.get_msec();
+	}
+
+
+	inline int galloc_bench()
+	{
+		static const uint32_t num = 2000000;
+		static const uint32_t live = 4096;
+		{
+			timer t;
+			keep(galloc_churn_<galloc_malloc_>(num, live, 1));
+			report("malloc 2M churn", t.get_msec(), num, "allocs");
+			t.reset();
+			keep(galloc_churn_<galloc_galloc_>(num, live, 1));
+			report("galloc 2M churn", t.get_msec(), num, "allocs");
+		}
+		{
+			// プロファイル（キー毎の集計）を有効にした場合
+			global_memory_profile(true);
+			global_memory_setkey("bench");
+			timer t;
+			keep(galloc_churn_<galloc_galloc_>(num, live, 1));
+			report("galloc 2M churn (profile)", t.get_msec(), num, "allocs");
+			global_memory_restorekey();
+			global_memory_frame();
+			global_memory_profile(false);
+		}
+		{
+			static const uint32_t frames = 1000;
+			static const uint32_t per = 2000;
+			timer t;
+			keep(galloc_widgets_<galloc_malloc_>(frames, per, 2));
+			report("malloc widgets 1000 frames x 2000", t.get_msec(), frames * per, "allocs");
+			t.reset();
+			keep(galloc_widgets_<galloc_galloc_>(frames, per, 2));
+			report("galloc widgets 1000 frames x 2000", t.get_msec(), frames * per, "allocs");
+		}
+		{
+			static const uint32_t inum = 20000;
+			static const uint32_t ilive = 16;
+			timer t;
+			keep(galloc_images_<galloc_malloc_>(inum, ilive, 3));
+			report("malloc images 20k (64..2048 sq)", t.get_msec(), inum, "allocs");
+			t.reset();
+			keep(galloc_images_<galloc_galloc_>(inum, ilive, 3));
+			report("galloc images 20k (64..2048 sq)", t.get_msec(), inum, "allocs");
+		}
+		static const uint32_t threads = 4;
+		static const uint32_t tnum = 500000;
+		double ms = galloc_threads_<galloc_malloc_>(threads, tnum, live);
+		report("malloc 4 threads x 500k", ms, static_cast<double>(threads) * tnum, "allocs");
+		ms = galloc_threads_<galloc_galloc_>(threads, tnum, live);
+		report("galloc 4 threads x 500k", ms, static_cast<double>(threads) * tnum, "allocs");
+		return 0;
+	}
+}
@@ -0,0 +1,182 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	img_span カーネルと img_rgba8 転送のテスト @n
+			SIMD 版はスカラー版とビット単位で一致する事。@n
+			同じイメージ内の重なった転送は、別のイメージからの転送と一致する事。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <random>
+#include "bench.hpp"
+#include "img_io/img_rgba8.hpp"
+
+namespace bench {
+
+	inline void img_span_random_(std::mt19937& rnd, std::vector<img::rgba8>& v)
+	{
+		for(auto& c : v) {
+			uint32_t r = rnd();
+			c.set(r, r >> 8, r >> 16, r >> 24);
+			// 端の値を多めに混ぜる
+			if((r & 15) == 0) c.a = 0;
+			else if((r & 15) == 1) c.a = 255;
+		}
+	}
+
+
+	inline int img_span_kernels_(const img::span_kernels& k, const char* name)
+	{
+		const img::span_kernels ref = img::span_kernels::scalar();
+		std::mt19937 rnd(12345);
+		bool ok[5] = { true, true, true, true, true };
+		img::rgba8 clut[256];
+		for(auto& c : clut) {
+			uint32_t r = rnd();
+			c.set(r, r >> 8, r >> 16, r >> 24);
+		}
+		for(uint32_t n = 0; n < 70; ++n) {
+			std::vector<img::rgba8> src(n);
+			std::vector<img::rgba8> dst(n);
+			img_span_random_(rnd, src);
+			img_span_random_(rnd, dst);
+			std::vector<uint8_t> idx(n);
+			for(auto& i : idx) i = rnd();
+			if(n & 1) idx[0] = 0;
+			auto a = dst;
+			auto b = dst;
+			ref.blend_over(a.data(), src.data(), n);
+			k.blend_over(b.data(), src.data(), n);
+			ok[0] = ok[0] && a == b;
+			a = dst; b = dst;
+			ref.blend_premul(a.data(), src.data(), n);
+			k.blend_premul(b.data(), src.data(), n);
+			ok[1] = ok[1] && a == b;
+			for(int alpha : { 0, 1, 127, 128, 254, 255 }) {
+				a = dst; b = dst;
+				ref.blend_const(a.data(), src.data(), n, alpha);
+				k.blend_const(b.data(), src.data(), n, alpha);
+				ok[2] = ok[2] && a == b;
+			}
+			ref.expand_idx8(a.data(), idx.data(), n, clut);
+			k.expand_idx8(b.data(), idx.data(), n, clut);
+			ok[3] = ok[3] && a == b;
+			ref.expand_gray8(a.data(), idx.data(), n);
+			k.expand_gray8(b.data(), idx.data(), n);
+			ok[4] = ok[4] && a == b;
+		}
+		static const char* tbl[] = { "blend_over", "blend_premul", "blend_const", "expand_idx8", "expand_gray8" };
+		int err = 0;
+		for(int i = 0; i < 5; ++i) {
+			err += check(ok[i], std::string(name) + " " + tbl[i]);
+		}
+		return err;
+	}
+
+
+	inline bool img_span_same_(const img::img_rgba8& a, const img::img_rgba8& b)
+	{
+		const vtx::spos& sz = a.get_size();
+		for(short y = 0; y < sz.y; ++y) {
+			const img::rgba8* pa = a.get_img(y);
+			const img::rgba8* pb = b.get_img(y);
+			if(!std::equal(pa, pa + sz.x, pb)) return false;
+		}
+		return true;
+	}
+
+
+	inline int img_span_overlap_()
+	{
+		std::mt19937 rnd(777);
+		img::img_rgba8 org;
+		org.create(vtx::spos(97, 61), true);
+		for(short y = 0; y < 61; ++y) {
+			for(short x = 0; x < 97; ++x) {
+				uint32_t r = rnd();
+				org.put_pixel(vtx::spos(x, y), img::rgba8(r, r >> 8, r >> 16, r >> 24));
+			}
+		}
+		const vtx::srect rect(vtx::spos(10, 8), vtx::spos(60, 40));
+		static const short ofs[][2] = {
+			{ 3, 0 }, { -3, 0 }, { 0, 2 }, { 0, -2 }, { 5, 7 }, { -5, -7 }, { 4, -6 }, { -4, 6 }
+		};
+		bool ok[4] = { true, true, true, true };
+		for(const auto& o : ofs) {
+			vtx::spos d(rect.org.x + o[0], rect.org.y + o[1]);
+			for(int m = 0; m < 4; ++m) {
+				img::img_rgba8 a;
+				img::img_rgba8 b;
+				img::img_rgba8 s;
+				for(auto* p : { &a, &b, &s }) {
+					p->create(org.get_size(), true);
+					p->copy(org);
+				}
+				switch(m) {
+				case 0: a.copy(d, a, rect); b.copy(d, s, rect); break;
+				case 1: a.blend(d, a, rect); b.blend(d, s, rect); break;
+				case 2: a.blend_premultiplied(d, a, rect); b.blend_premultiplied(d, s, rect); break;
+				case 3: a.blend(d, a, rect, 100); b.blend(d, s, rect, 100); break;
+				}
+				ok[m] = ok[m] && img_span_same_(a, b);
+			}
+		}
+		static const char* tbl[] = { "copy", "blend", "blend_premultiplied", "blend(alpha)" };
+		int err = 0;
+		for(int i = 0; i < 4; ++i) {
+			err += check(ok[i], std::string("overlap ") + tbl[i]);
+		}
+		return err;
+	}
+
+
+	inline int img_span_parallel_()
+	{
+		// スレッド・プールで分割される大きさ
+		std::mt19937 rnd(99);
+		std::vector<img::rgba8> v(1024 * 700);
+		img_span_random_(rnd, v);
+		img::img_rgba8 src;
+		src.create(vtx::spos(1024, 700), true);
+		img::img_rgba8 dst;
+		dst.create(vtx::spos(1024, 700), true);
+		for(short y = 0; y < 700; ++y) {
+			for(short x = 0; x < 1024; ++x) {
+				src.put_pixel(vtx::spos(x, y), v[y * 1024 + x]);
+				dst.put_pixel(vtx::spos(x, y), v[(699 - y) * 1024 + x]);
+			}
+		}
+		img::img_rgba8 ref;
+		ref.create(dst.get_size(), true);
+		ref.copy(dst);
+		const img::span_kernels k = img::span_kernels::scalar();
+		for(short y = 0; y < 700; ++y) {
+			k.blend_over(ref.at_image(y * 1024), src.get_img(y), 1024);
+		}
+		dst.blend(vtx::spos(0), src, vtx::srect(vtx::spos(0), src.get_size()));
+		return check(img_span_same_(dst, ref), "parallel blend == scalar");
+	}
+
+
+	inline int img_span()
+	{
+		int err = 0;
+		err += img_span_kernels_(img::get_span_kernels(), "select");
+#ifdef __SSE2__
+		{
+			img::span_kernels k = img::span_kernels::scalar();
+			k.blend_over   = img::blend_over_span_sse2_;
+			k.blend_premul = img::blend_premul_span_sse2_;
+			k.blend_const  = img::blend_const_span_sse2_;
+			k.expand_gray8 = img::expand_gray8_span_sse2_;
+			err += img_span_kernels_(k, "sse2");
+		}
+#endif
+		err += img_span_overlap_();
+		err += img_span_parallel_();
+		return err;
+	}
+}
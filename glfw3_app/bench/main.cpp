@@ -0,0 +1,136 @@
+//=====================================================================//
+/*! @file
+	@brief  ベンチマーク、テスト・メイン @n
+			bench					全てのベンチマーク @n
+			bench -test				全てのテスト @n
+			bench name ...			名前を指定して実行 @n
+			bench -list				名前のリスト
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <iostream>
+#include <vector>
+#include "bench.hpp"
+#include "terminal_bench.hpp"
+#include "paint_test.hpp"
+#include "img_span_test.hpp"
+#include "quantize_bench.hpp"
+#include "skinning_bench.hpp"
+#include "mtx_simd_test.hpp"
+#include "galloc_bench.hpp"
+#include "ring_buffer_bench.hpp"
+#include "file_io_test.hpp"
+#include "tree_bench.hpp"
+#include "preference_test.hpp"
+#include "string_utils_bench.hpp"
+#include "csv_test.hpp"
+#include "sqlite_bench.hpp"
+#include "motion_bench.hpp"
+#include "media_index_test.hpp"
+#include "zip_archive_test.hpp"
+#include "chars_conv_test.hpp"
+#include "texfb_conv_test.hpp"
+#include "collada_test.hpp"
+
+namespace {
+
+	struct item_t {
+		const char*	name_;
+		bool		test_;
+		int			(*func_)();
+	};
+
+	const item_t items_[] = {
+		{ "terminal_puts",	false,	bench::terminal_puts },
+		{ "paint_clip",		true,	bench::paint_clip },
+		{ "paint_bench",	false,	bench::paint_bench },
+		{ "img_span",		true,	bench::img_span },
+		{ "quantize",		true,	bench::quantize },
+		{ "quantize_4k",	false,	bench::quantize_4k },
+		{ "skinning",		true,	bench::skinning },
+		{ "skinning_bench",	false,	bench::skinning_bench },
+		{ "mtx_simd",		true,	bench::mtx_simd },
+		{ "mtx_simd_bench",	false,	bench::mtx_simd_bench },
+		{ "galloc_bench",	false,	bench::galloc_bench },
+		{ "ring_buffer_bench",	false,	bench::ring_buffer_bench },
+		{ "file_io",		true,	bench::file_io },
+		{ "file_io_bench",	false,	bench::file_io_bench },
+		{ "tree_arena",		true,	bench::tree_arena },
+		{ "tree_arena_bench",	false,	bench::tree_arena_bench },
+		{ "preference",		true,	bench::preference },
+		{ "preference_bench",	false,	bench::preference_bench },
+		{ "string_utils",		true,	bench::string_utils },
+		{ "string_utils_bench",	false,	bench::string_utils_bench },
+		{ "csv_io",			true,	bench::csv_io },
+		{ "csv_io_bench",		false,	bench::csv_io_bench },
+		{ "sqlite",			true,	bench::sqlite },
+		{ "sqlite_bench",		false,	bench::sqlite_bench },
+		{ "motion",			true,	bench::motion },
+		{ "motion_bench",		false,	bench::motion_bench },
+		{ "media_index",		true,	bench::media_index },
+		{ "zip_archive",		true,	bench::zip_archive },
+		{ "chars_conv",		true,	bench::chars_conv },
+		{ "chars_conv_bench",	false,	bench::chars_conv_bench },
+		{ "texfb_conv",		true,	bench::texfb_conv },
+		{ "texfb_conv_bench",	false,	bench::texfb_conv_bench },
+		{ "collada_sax",		true,	bench::collada_sax },
+		{ "collada_cache",	true,	bench::collada_cache },
+		{ "collada_optimize",	true,	bench::collada_optimize },
+	};
+
+
+	int run_(const item_t& t)
+	{
+		std::cout << (t.test_ ? "Test: " : "Bench: ") << t.name_ << std::endl;
+		int err = t.func_();
+		if(err) {
+			std::cout << "  " << err << " error(s)" << std::endl;
+		}
+		return err;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool test = false;
+	bool list = false;
+	std::vector<std::string> names;
+	for(int i = 1; i < argc; ++i) {
+		std::string s = argv[i];
+		if(s == "-test") test = true;
+		else if(s == "-list") list = true;
+		else names.push_back(s);
+	}
+
+	if(list) {
+		for(const auto& t : items_) {
+			std::cout << (t.test_ ? "test  " : "bench ") << t.name_ << std::endl;
+		}
+		return 0;
+	}
+
+	int err = 0;
+	if(names.empty()) {
+		for(const auto& t : items_) {
+			if(t.test_ == test) err += run_(t);
+		}
+	} else {
+		for(const auto& s : names) {
+			bool find = false;
+			for(const auto& t : items_) {
+				if(s == t.name_) {
+					err += run_(t);
+					find = true;
+				}
+			}
+			if(!find) {
+				std::cerr << "Can't find: '" << s << "'" << std::endl;
+				++err;
+			}
+		}
+	}
+	return err != 0 ? 1 : 0;
+}
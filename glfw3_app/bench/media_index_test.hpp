@@ -0,0 +1,739 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	al::read_tag と al::media_index のテスト @n
+			ID3v2.2/2.3/2.4（非同期化、拡張ヘッダー）、MP4 ilst、Ogg、FLAC を @n
+			メモリー上で合成して解析する。@n
+			切り詰めたバッファーや、大き過ぎる長さでも、範囲外を読まない事。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "bench.hpp"
+#include "utils/file_io.hpp"
+#include "snd_io/tag_reader.hpp"
+#include "snd_io/media_index.hpp"
+
+namespace bench {
+
+	typedef std::vector<uint8_t> media_bytes_;
+
+	static const uint8_t media_cover_[] = {
+		0x89, 'P', 'N', 'G', 0xff, 0x00, 0xff, 0xe0, 0x12, 0x00, 0x34, 0xff
+	};
+
+
+	inline void media_add_(media_bytes_& b, const media_bytes_& s)
+	{
+		b.insert(b.end(), s.begin(), s.end());
+	}
+
+
+	inline void media_add_(media_bytes_& b, const std::string& s)
+	{
+		b.insert(b.end(), s.begin(), s.end());
+	}
+
+
+	inline void media_be32_(media_bytes_& b, uint32_t v)
+	{
+		b.push_back(v >> 24); b.push_back(v >> 16); b.push_back(v >> 8); b.push_back(v);
+	}
+
+
+	inline void media_le32_(media_bytes_& b, uint32_t v)
+	{
+		b.push_back(v); b.push_back(v >> 8); b.push_back(v >> 16); b.push_back(v >> 24);
+	}
+
+
+	inline void media_syncsafe_(media_bytes_& b, uint32_t v)
+	{
+		b.push_back((v >> 21) & 0x7f); b.push_back((v >> 14) & 0x7f);
+		b.push_back((v >> 7) & 0x7f); b.push_back(v & 0x7f);
+	}
+
+
+	inline media_bytes_ media_cover_bytes_()
+	{
+		return media_bytes_(media_cover_, media_cover_ + sizeof(media_cover_));
+	}
+
+
+	// 0xff の後に必ず 0x00 を挟む（読み込み側は、それを取り除く）
+	inline media_bytes_ media_unsync_(const media_bytes_& s)
+	{
+		media_bytes_ d;
+		for(uint8_t v : s) {
+			d.push_back(v);
+			if(v == 0xff) d.push_back(0x00);
+		}
+		return d;
+	}
+
+
+	inline media_bytes_ media_id3_text_(uint8_t enc, const std::string& s)
+	{
+		media_bytes_ b;
+		b.push_back(enc);
+		media_add_(b, s);
+		return b;
+	}
+
+
+	inline media_bytes_ media_id3_frame_(const char* id, const media_bytes_& d, uint8_t ver,
+		uint8_t fmt = 0)
+	{
+		media_bytes_ b(id, id + 4);
+		if(ver == 4) media_syncsafe_(b, d.size());
+		else media_be32_(b, d.size());
+		b.push_back(0);
+		b.push_back(fmt);
+		media_add_(b, d);
+		return b;
+	}
+
+
+	inline media_bytes_ media_apic_(uint8_t type, const char* mime, const char* dscrp)
+	{
+		media_bytes_ b;
+		b.push_back(0);
+		media_add_(b, std::string(mime));
+		b.push_back(0);
+		b.push_back(type);
+		media_add_(b, std::string(dscrp));
+		b.push_back(0);
+		media_add_(b, media_cover_bytes_());
+		return b;
+	}
+
+
+	inline media_bytes_ media_id3_(uint8_t ver, uint8_t flags, const media_bytes_& body)
+	{
+		media_bytes_ b = { 'I', 'D', '3', ver, 0, flags };
+		media_syncsafe_(b, body.size());
+		media_add_(b, body);
+		return b;
+	}
+
+
+	// ID3v2.3: 全体の非同期化、拡張ヘッダー、UTF-16 の文字列
+	inline media_bytes_ media_id3v23_(const std::string& title)
+	{
+		media_bytes_ body;
+		media_be32_(body, 6);  // 拡張ヘッダー（サイズ自身を含まない）
+		body.insert(body.end(), 6, 0);
+		media_add_(body, media_id3_frame_("TIT2", media_id3_text_(0, title), 3));
+		// 「アート」UTF-16LE、BOM 付き
+		static const uint8_t art[] = { 1, 0xff, 0xfe, 0xa2, 0x30, 0xfc, 0x30, 0xc8, 0x30, 0, 0 };
+		media_add_(body, media_id3_frame_("TPE1", media_bytes_(art, art + sizeof(art)), 3));
+		media_add_(body, media_id3_frame_("TALB", media_id3_text_(0, "Album"), 3));
+		media_add_(body, media_id3_frame_("TRCK", media_id3_text_(0, "3/12"), 3));
+		media_add_(body, media_id3_frame_("TPOS", media_id3_text_(0, "1/2"), 3));
+		media_add_(body, media_id3_frame_("TYER", media_id3_text_(0, "1999"), 3));
+		media_add_(body, media_id3_frame_("APIC", media_apic_(3, "image/png", "cover"), 3));
+		body.insert(body.end(), 16, 0);  // パディング
+		return media_id3_(3, 0xc0, media_unsync_(body));
+	}
+
+
+	// ID3v2.4: 拡張ヘッダー、フッター、フレーム単位の非同期化とデータ長、圧縮フレーム
+	inline media_bytes_ media_id3v24_()
+	{
+		media_bytes_ body;
+		media_syncsafe_(body, 6);  // 拡張ヘッダー（サイズ自身を含む）
+		body.push_back(1);
+		body.push_back(0);
+		media_add_(body, media_id3_frame_("TIT2", media_id3_text_(3, "\xe6\x9b\xb2"), 4));
+		media_add_(body, media_id3_frame_("TPE1", media_id3_text_(3, "Artist"), 4));
+		media_add_(body, media_id3_frame_("TYER", media_id3_text_(0, "1999"), 4));
+		media_add_(body, media_id3_frame_("TDRC", media_id3_text_(3, "2017-05-01"), 4));
+		media_add_(body, media_id3_frame_("TRCK", media_id3_text_(3, "7"), 4));
+		media_add_(body, media_id3_frame_("TALB", media_id3_text_(3, "Zipped"), 4, 0x08));
+		media_bytes_ pic = media_apic_(3, "image/png", "");
+		media_bytes_ d;
+		media_syncsafe_(d, pic.size());
+		media_add_(d, media_unsync_(pic));
+		media_add_(body, media_id3_frame_("APIC", d, 4, 0x03));
+		media_bytes_ b = media_id3_(4, 0x50, body);
+		media_bytes_ foot = { '3', 'D', 'I', 4, 0, 0x50 };
+		media_syncsafe_(foot, body.size());
+		media_add_(b, foot);
+		return b;
+	}
+
+
+	inline media_bytes_ media_id3v22_()
+	{
+		media_bytes_ body;
+		auto frame = [&body](const char* id, const media_bytes_& d) {
+			body.insert(body.end(), id, id + 3);
+			body.push_back(d.size() >> 16); body.push_back(d.size() >> 8); body.push_back(d.size());
+			media_add_(body, d);
+		};
+		frame("TT2", media_id3_text_(0, "Old"));
+		frame("TRK", media_id3_text_(0, "2/5"));
+		media_bytes_ pic = { 0, 'P', 'N', 'G', 3, 0 };
+		media_add_(pic, media_cover_bytes_());
+		frame("PIC", pic);
+		return media_id3_(2, 0, body);
+	}
+
+
+	inline media_bytes_ media_id3v1_(const char* title, const char* album, uint8_t track)
+	{
+		media_bytes_ b(128, 0);
+		std::memcpy(&b[0], "TAG", 3);
+		std::memcpy(&b[3], title, std::strlen(title));
+		std::memcpy(&b[33], "V1 Artist", 9);
+		std::memcpy(&b[63], album, std::strlen(album));
+		std::memcpy(&b[93], "1985", 4);
+		b[126] = track;
+		return b;
+	}
+
+
+	inline media_bytes_ media_vorbis_comment_(const std::vector<std::string>& items)
+	{
+		media_bytes_ b;
+		static const char* vendor = "bench vendor";
+		media_le32_(b, std::strlen(vendor));
+		media_add_(b, std::string(vendor));
+		media_le32_(b, items.size());
+		for(const std::string& s : items) {
+			media_le32_(b, s.size());
+			media_add_(b, s);
+		}
+		return b;
+	}
+
+
+	inline media_bytes_ media_flac_picture_(uint32_t type, const char* mime, const char* dscrp)
+	{
+		media_bytes_ b;
+		media_be32_(b, type);
+		media_be32_(b, std::strlen(mime));
+		media_add_(b, std::string(mime));
+		media_be32_(b, std::strlen(dscrp));
+		media_add_(b, std::string(dscrp));
+		b.insert(b.end(), 16, 0);
+		media_be32_(b, sizeof(media_cover_));
+		media_add_(b, media_cover_bytes_());
+		return b;
+	}
+
+
+	inline void media_flac_block_(media_bytes_& b, uint8_t type, const media_bytes_& d)
+	{
+		b.push_back(type);
+		b.push_back(d.size() >> 16); b.push_back(d.size() >> 8); b.push_back(d.size());
+		media_add_(b, d);
+	}
+
+
+	inline media_bytes_ media_flac_(const std::string& title)
+	{
+		media_bytes_ b = { 'f', 'L', 'a', 'C' };
+		media_flac_block_(b, 0, media_bytes_(34, 0));
+		media_flac_block_(b, 6, media_flac_picture_(4, "image/jpeg", "back"));
+		media_flac_block_(b, 4, media_vorbis_comment_({
+			"TITLE=" + title, "ARTIST=Flac Artist", "ALBUM=Flac Album", "COMPOSER=Comp",
+			"TRACKNUMBER=4/8", "DISCNUMBER=2", "DISCTOTAL=3", "DATE=2003" }));
+		media_flac_block_(b, 0x80 | 6, media_flac_picture_(3, "image/png", "front"));
+		b.insert(b.end(), 64, 0x55);  // フレーム
+		return b;
+	}
+
+
+	inline std::string media_base64_(const media_bytes_& s)
+	{
+		static const char* tbl = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string out;
+		for(size_t i = 0; i < s.size(); i += 3) {
+			uint32_t v = s[i] << 16;
+			if(i + 1 < s.size()) v |= s[i + 1] << 8;
+			if(i + 2 < s.size()) v |= s[i + 2];
+			out += tbl[(v >> 18) & 63];
+			out += tbl[(v >> 12) & 63];
+			out += i + 1 < s.size() ? tbl[(v >> 6) & 63] : '=';
+			out += i + 2 < s.size() ? tbl[v & 63] : '=';
+		}
+		return out;
+	}
+
+
+	inline void media_ogg_page_(media_bytes_& b, uint32_t serial, uint32_t seq,
+		const media_bytes_& lace, const media_bytes_& data)
+	{
+		media_add_(b, std::string("OggS"));
+		b.push_back(0);
+		b.push_back(seq == 0 ? 2 : 0);
+		b.insert(b.end(), 8, 0);  // グラニュール位置
+		media_le32_(b, serial);
+		media_le32_(b, seq);
+		media_le32_(b, 0);  // CRC（読み込み側は見ない）
+		b.push_back(lace.size());
+		media_add_(b, lace);
+		media_add_(b, data);
+	}
+
+
+	// パケットを連結して、１ページ当たり segs 個のセグメントに分ける @n
+	// 最初のページの後に、別のストリームのページを挟む
+	inline media_bytes_ media_ogg_(const std::vector<media_bytes_>& packets, uint32_t segs)
+	{
+		media_bytes_ lace;
+		media_bytes_ data;
+		for(const media_bytes_& p : packets) {
+			size_t n = p.size();
+			while(n >= 255) { lace.push_back(255); n -= 255; }
+			lace.push_back(n);
+			media_add_(data, p);
+		}
+		media_bytes_ b;
+		uint32_t seq = 0;
+		size_t dpos = 0;
+		for(size_t i = 0; i < lace.size(); i += segs) {
+			size_t e = std::min(lace.size(), i + segs);
+			media_bytes_ l(lace.begin() + i, lace.begin() + e);
+			size_t n = 0;
+			for(uint8_t v : l) n += v;
+			media_ogg_page_(b, 0x1234, seq, l, media_bytes_(data.begin() + dpos, data.begin() + dpos + n));
+			dpos += n;
+			if(seq == 0) {
+				media_bytes_ other = { '\x03', 'v', 'o', 'r', 'b', 'i', 's', 0, 0, 0, 0 };
+				media_ogg_page_(b, 0x9999, 0, media_bytes_(1, other.size()), other);
+			}
+			++seq;
+		}
+		return b;
+	}
+
+
+	inline media_bytes_ media_vorbis_(const std::string& title)
+	{
+		media_bytes_ id = { 1, 'v', 'o', 'r', 'b', 'i', 's' };
+		id.insert(id.end(), 23, 0);
+		media_bytes_ cm = { 3, 'v', 'o', 'r', 'b', 'i', 's' };
+		media_add_(cm, media_vorbis_comment_({
+			"TITLE=" + title, "artist=Ogg Artist", "Album=Ogg Album", "TRACKNUMBER=5",
+			"TRACKTOTAL=9", "ALBUMARTIST=Band", "COMPOSER=Not used", "DATE=2001",
+			"DESCRIPTION=" + std::string(600, 'x') }));
+		cm.push_back(1);
+		media_bytes_ setup = { 5, 'v', 'o', 'r', 'b', 'i', 's', 0 };
+		return media_ogg_({ id, cm, setup }, 2);
+	}
+
+
+	inline media_bytes_ media_opus_()
+	{
+		media_bytes_ id = { 'O', 'p', 'u', 's', 'H', 'e', 'a', 'd' };
+		id.insert(id.end(), 11, 0);
+		media_bytes_ cm = { 'O', 'p', 'u', 's', 'T', 'a', 'g', 's' };
+		media_add_(cm, media_vorbis_comment_({
+			"TITLE=Opus Title", "ARTIST=Opus Artist",
+			"METADATA_BLOCK_PICTURE=" + media_base64_(media_flac_picture_(3, "image/png", "opus")) }));
+		return media_ogg_({ id, cm }, 255);
+	}
+
+
+	inline media_bytes_ media_atom_(const char* name, const media_bytes_& d)
+	{
+		media_bytes_ b;
+		media_be32_(b, d.size() + 8);
+		b.insert(b.end(), name, name + 4);
+		media_add_(b, d);
+		return b;
+	}
+
+
+	inline media_bytes_ media_mp4_data_(uint32_t type, const media_bytes_& d)
+	{
+		media_bytes_ b;
+		media_be32_(b, type);
+		media_be32_(b, 0);
+		media_add_(b, d);
+		return media_atom_("data", b);
+	}
+
+
+	inline media_bytes_ media_mp4_text_(const char* name, const std::string& s)
+	{
+		return media_atom_(name, media_mp4_data_(1, media_bytes_(s.begin(), s.end())));
+	}
+
+
+	// full が「true」なら ISO 形式（meta はフル・ボックス）、そうでなければ QuickTime 形式
+	inline media_bytes_ media_mp4_(const std::string& title, bool full)
+	{
+		media_bytes_ ilst;
+		media_add_(ilst, media_mp4_text_("\xa9nam", title));
+		media_add_(ilst, media_mp4_text_("\xa9""ART", "MP4 Artist"));
+		media_add_(ilst, media_mp4_text_("\xa9""alb", "MP4 Album"));
+		media_add_(ilst, media_mp4_text_("\xa9""day", "2010"));
+		media_add_(ilst, media_mp4_text_("\xa9wrt", "Writer"));
+		media_add_(ilst, media_mp4_text_("aART", "Album Artist"));
+		media_add_(ilst, media_atom_("trkn", media_mp4_data_(0, { 0, 0, 0, 4, 0, 10, 0, 0 })));
+		media_add_(ilst, media_atom_("disk", media_mp4_data_(0, { 0, 0, 0, 1, 0, 2 })));
+		media_add_(ilst, media_atom_("covr", media_mp4_data_(14, media_cover_bytes_())));
+		media_bytes_ meta;
+		if(full) media_be32_(meta, 0);
+		media_add_(meta, media_atom_("hdlr", media_bytes_(25, 0)));
+		media_add_(meta, media_atom_("ilst", ilst));
+
+		media_bytes_ moov = media_atom_("mvhd", media_bytes_(100, 0));
+		media_add_(moov, media_atom_("udta", media_atom_("meta", meta)));
+
+		media_bytes_ b = media_atom_("ftyp", { 'M', '4', 'A', ' ', 0, 0, 0, 0, 'i', 's', 'o', 'm' });
+		// 64 ビット・サイズの mdat
+		media_be32_(b, 1);
+		media_add_(b, std::string("mdat"));
+		media_be32_(b, 0);
+		media_be32_(b, 16 + 32);
+		b.insert(b.end(), 32, 0xaa);
+		media_add_(b, media_atom_("moov", moov));
+		return b;
+	}
+
+
+	inline bool media_cover_ok_(const al::tag& t, const char* mime, uint8_t type)
+	{
+		if(t.image_mime_ != mime || t.image_cover_ != type || !t.image_) return false;
+		return t.image_->size() == sizeof(media_cover_)
+			&& std::memcmp(t.image_->get(), media_cover_, sizeof(media_cover_)) == 0;
+	}
+
+
+	// 長さちょうどのヒープに写して、範囲外の読み込みを検出し易くする
+	inline al::tag_format media_read_(const media_bytes_& b, size_t n, al::tag& t, bool image = true)
+	{
+		std::unique_ptr<uint8_t[]> tmp(new uint8_t[n + 1]);
+		if(n > 0) std::memcpy(tmp.get(), b.data(), n);
+		return al::read_tag(tmp.get(), n, t, image);
+	}
+
+
+	inline bool media_write_(const std::string& fn, const media_bytes_& b)
+	{
+		utils::file_io fout;
+		if(!fout.open(fn, "wb")) return false;
+		bool ok = fout.write(b.data(), b.size()) == b.size();
+		fout.close();
+		return ok;
+	}
+
+
+	inline bool media_same_(const al::media_index::entry& a, const al::media_index::entry& b)
+	{
+		return a.path_ == b.path_ && a.size_ == b.size_ && a.time_ == b.time_
+			&& a.format_ == b.format_ && a.cover_ == b.cover_ && a.title_ == b.title_
+			&& a.artist_ == b.artist_ && a.writer_ == b.writer_ && a.album_ == b.album_
+			&& a.track_ == b.track_ && a.total_tracks_ == b.total_tracks_
+			&& a.disc_ == b.disc_ && a.total_discs_ == b.total_discs_ && a.date_ == b.date_;
+	}
+
+
+	inline int media_tag_()
+	{
+		int err = 0;
+		al::tag t;
+		bool ok;
+
+		media_bytes_ v23 = media_id3v23_("Song A");
+		ok = media_read_(v23, v23.size(), t) == al::tag_format::MP3;
+		ok = ok && t.title_ == "Song A" && t.artist_ == "\xe3\x82\xa2\xe3\x83\xbc\xe3\x83\x88"
+			&& t.album_ == "Album" && t.track_ == "3" && t.total_tracks_ == "12"
+			&& t.disc_ == "1" && t.total_discs_ == "2" && t.date_ == "1999"
+			&& t.image_dscrp_ == "cover" && media_cover_ok_(t, "image/png", 3);
+		err += check(ok, "id3v2.3 unsync, extended header, UTF-16");
+
+		// 画像を読まない場合
+		ok = media_read_(v23, v23.size(), t, false) == al::tag_format::MP3;
+		err += check(ok && t.image_mime_ == "image/png" && !t.image_, "id3v2.3 without image");
+
+		media_bytes_ v24 = media_id3v24_();
+		ok = media_read_(v24, v24.size(), t) == al::tag_format::MP3;
+		ok = ok && t.title_ == "\xe6\x9b\xb2" && t.artist_ == "Artist" && t.date_ == "2017-05-01"
+			&& t.track_ == "7" && t.album_.empty() && media_cover_ok_(t, "image/png", 3);
+		err += check(ok, "id3v2.4 extended header, frame unsync, data length");
+
+		// フッターの後ろの FLAC、ID3v1 は空の項目だけを埋める
+		{
+			media_bytes_ b = v24;
+			media_add_(b, media_flac_("After ID3"));
+			ok = media_read_(b, b.size(), t) == al::tag_format::FLAC && t.title_ == "After ID3";
+			b = v24;
+			media_add_(b, media_id3v1_("V1 Title", "V1 Album", 9));
+			ok = ok && media_read_(b, b.size(), t) == al::tag_format::MP3
+				&& t.title_ == "\xe6\x9b\xb2" && t.album_ == "V1 Album" && t.track_ == "7";
+			b = media_id3v1_("Only V1", "Album V1", 11);
+			ok = ok && media_read_(b, b.size(), t) == al::tag_format::MP3
+				&& t.title_ == "Only V1" && t.artist_ == "V1 Artist" && t.track_ == "11"
+				&& t.date_ == "1985";
+		}
+		err += check(ok, "id3v2.4 footer, id3v1 fill");
+
+		media_bytes_ v22 = media_id3v22_();
+		ok = media_read_(v22, v22.size(), t) == al::tag_format::MP3;
+		ok = ok && t.title_ == "Old" && t.track_ == "2" && t.total_tracks_ == "5"
+			&& media_cover_ok_(t, "image/png", 3);
+		err += check(ok, "id3v2.2");
+
+		media_bytes_ mp4 = media_mp4_("MP4 Title", true);
+		ok = media_read_(mp4, mp4.size(), t) == al::tag_format::MP4;
+		ok = ok && t.title_ == "MP4 Title" && t.artist_ == "MP4 Artist" && t.album_ == "MP4 Album"
+			&& t.writer_ == "Album Artist" && t.date_ == "2010" && t.track_ == "4"
+			&& t.total_tracks_ == "10" && t.disc_ == "1" && t.total_discs_ == "2"
+			&& media_cover_ok_(t, "image/png", 3);
+		media_bytes_ qt = media_mp4_("QT Title", false);
+		ok = ok && media_read_(qt, qt.size(), t) == al::tag_format::MP4 && t.title_ == "QT Title";
+		err += check(ok, "mp4 ilst (iso / quicktime meta)");
+
+		media_bytes_ ogg = media_vorbis_("Ogg Title");
+		ok = media_read_(ogg, ogg.size(), t) == al::tag_format::OGG;
+		ok = ok && t.title_ == "Ogg Title" && t.artist_ == "Ogg Artist" && t.album_ == "Ogg Album"
+			&& t.track_ == "5" && t.total_tracks_ == "9" && t.writer_ == "Band" && t.date_ == "2001";
+		err += check(ok, "ogg vorbis comment across pages");
+
+		media_bytes_ opus = media_opus_();
+		ok = media_read_(opus, opus.size(), t) == al::tag_format::OGG;
+		ok = ok && t.title_ == "Opus Title" && t.artist_ == "Opus Artist"
+			&& t.image_dscrp_ == "opus" && media_cover_ok_(t, "image/png", 3);
+		err += check(ok, "opus tags, METADATA_BLOCK_PICTURE");
+
+		media_bytes_ flac = media_flac_("Flac Title");
+		ok = media_read_(flac, flac.size(), t) == al::tag_format::FLAC;
+		ok = ok && t.title_ == "Flac Title" && t.artist_ == "Flac Artist" && t.writer_ == "Comp"
+			&& t.track_ == "4" && t.total_tracks_ == "8" && t.disc_ == "2" && t.total_discs_ == "3"
+			&& t.image_dscrp_ == "front" && media_cover_ok_(t, "image/png", 3);
+		err += check(ok, "flac vorbis comment, front cover preferred");
+
+		// 全ての長さに切り詰める（ヘッダーが揃えば、形式は判別できる）
+		{
+			struct case_t {
+				const media_bytes_*	buf;
+				size_t				min;
+			};
+			const case_t cases[] = {
+				{ &v23, 10 }, { &v24, 10 }, { &v22, 10 }, { &mp4, 8 },
+				{ &qt, 8 }, { &ogg, 4 }, { &opus, 4 }, { &flac, 4 },
+			};
+			ok = true;
+			for(const case_t& c : cases) {
+				for(size_t n = 0; n <= c.buf->size(); ++n) {
+					al::tag_format fmt = media_read_(*c.buf, n, t);
+					if(n >= c.min && fmt == al::tag_format::NONE) ok = false;
+				}
+			}
+		}
+		err += check(ok, "truncated buffers");
+
+		// 大き過ぎる長さ
+		{
+			ok = true;
+			// タグ・サイズ
+			media_bytes_ b = media_id3_(3, 0, media_id3_frame_("TIT2", media_id3_text_(0, "Big"), 3));
+			b[6] = b[7] = b[8] = b[9] = 0x7f;
+			ok = ok && media_read_(b, b.size(), t) == al::tag_format::MP3 && t.title_ == "Big";
+			// フレーム・サイズ
+			b = media_id3_(3, 0, media_id3_frame_("TIT2", media_id3_text_(0, "Frame"), 3));
+			media_add_(b, media_id3_frame_("TPE1", media_id3_text_(0, "Lost"), 3));
+			b[6] = b[7] = b[8] = 0; b[9] = 0x7f;
+			b[10 + 16 + 4] = b[10 + 16 + 5] = b[10 + 16 + 6] = b[10 + 16 + 7] = 0xff;
+			ok = ok && media_read_(b, b.size(), t) == al::tag_format::MP3
+				&& t.title_ == "Frame" && t.artist_.empty();
+			// 拡張ヘッダーのサイズ（v2.3 / v2.4）
+			for(uint8_t ver = 3; ver <= 4; ++ver) {
+				media_bytes_ body = { 0xff, 0xff, 0xff, 0xfc };
+				if(ver == 4) body[0] = body[1] = body[2] = body[3] = 0x7f;
+				media_add_(body, media_id3_frame_("TIT2", media_id3_text_(0, "Ext"), ver));
+				b = media_id3_(ver, 0x40, body);
+				ok = ok && media_read_(b, b.size(), t) == al::tag_format::MP3 && t.title_.empty();
+			}
+			// APIC の終端の無い文字列
+			{
+				media_bytes_ d = { 0, 'i', 'm', 'a', 'g', 'e' };
+				b = media_id3_(3, 0, media_id3_frame_("APIC", d, 3));
+				ok = ok && media_read_(b, b.size(), t) == al::tag_format::MP3 && t.image_mime_.empty();
+			}
+
+			// FLAC ブロック長、ベンダー長、コメント数、画像の長さ
+			b = { 'f', 'L', 'a', 'C' };
+			media_flac_block_(b, 0, media_bytes_(34, 0));
+			b.push_back(4); b.push_back(0xff); b.push_back(0xff); b.push_back(0xff);
+			b.insert(b.end(), 16, 0);
+			ok = ok && media_read_(b, b.size(), t) == al::tag_format::FLAC;
+			{
+				media_bytes_ vc;
+				media_le32_(vc, 0xffffffff);
+				media_le32_(vc, 1);
+				b = { 'f', 'L', 'a', 'C' };
+				media_flac_block_(b, 0x84, vc);
+				ok = ok && media_read_(b, b.size(), t) == al::tag_format::FLAC;
+				vc = media_vorbis_comment_({ "TITLE=Count" });
+				vc[4 + 12] = vc[5 + 12] = vc[6 + 12] = vc[7 + 12] = 0xff;
+				media_le32_(vc, 0xfffffff0);
+				vc.push_back('A');
+				b = { 'f', 'L', 'a', 'C' };
+				media_flac_block_(b, 0x84, vc);
+				ok = ok && media_read_(b, b.size(), t) == al::tag_format::FLAC && t.title_ == "Count";
+			}
+			{
+				media_bytes_ pic = media_flac_picture_(3, "image/png", "");
+				media_bytes_ p1 = pic;
+				p1[4] = p1[5] = p1[6] = p1[7] = 0xff;
+				media_bytes_ p2 = pic;
+				size_t n = p2.size() - sizeof(media_cover_) - 4;
+				p2[n] = p2[n + 1] = p2[n + 2] = p2[n + 3] = 0xff;
+				b = { 'f', 'L', 'a', 'C' };
+				media_flac_block_(b, 6, p1);
+				media_flac_block_(b, 0x86, p2);
+				ok = ok && media_read_(b, b.size(), t) == al::tag_format::FLAC
+					&& media_cover_ok_(t, "image/png", 3);
+			}
+
+			// MP4 のアトム長
+			{
+				b = mp4;
+				// moov を 64 ビットの巨大なサイズにする
+				size_t pos = 0;
+				while(pos + 8 <= b.size() && std::memcmp(&b[pos + 4], "moov", 4) != 0) {
+					uint32_t n = (b[pos] << 24) | (b[pos + 1] << 16) | (b[pos + 2] << 8) | b[pos + 3];
+					pos += n == 1 ? 16 + 32 : n;
+				}
+				media_bytes_ big(b.begin(), b.begin() + pos);
+				media_be32_(big, 1);
+				media_add_(big, std::string("moov"));
+				media_be32_(big, 0xffffffff);
+				media_be32_(big, 0xffffffff);
+				big.insert(big.end(), 8, 0);
+				ok = ok && media_read_(big, big.size(), t) == al::tag_format::MP4 && t.title_.empty();
+
+				media_bytes_ ilst;
+				media_add_(ilst, media_mp4_text_("\xa9nam", "Atom"));
+				media_add_(ilst, media_atom_("trkn", media_mp4_data_(0, { 0, 0 })));
+				media_bytes_ bad = media_mp4_text_("\xa9""ART", "Lost");
+				bad[0] = bad[1] = bad[2] = bad[3] = 0xff;
+				media_add_(ilst, bad);
+				media_bytes_ meta(4, 0);
+				media_add_(meta, media_atom_("ilst", ilst));
+				b = media_atom_("ftyp", { 'M', '4', 'A', ' ' });
+				media_add_(b, media_atom_("moov", media_atom_("udta", media_atom_("meta", meta))));
+				ok = ok && media_read_(b, b.size(), t) == al::tag_format::MP4
+					&& t.title_ == "Atom" && t.track_.empty() && t.artist_.empty();
+			}
+
+			// Ogg のセグメント表
+			{
+				b.clear();
+				media_ogg_page_(b, 1, 0, media_bytes_(255, 255), media_bytes_(10, 0));
+				b.resize(27 + 100);
+				ok = ok && media_read_(b, b.size(), t) == al::tag_format::OGG;
+				b.clear();
+				media_ogg_page_(b, 1, 0, media_bytes_(3, 200), media_bytes_(10, 0));
+				ok = ok && media_read_(b, b.size(), t) == al::tag_format::OGG;
+			}
+		}
+		err += check(ok, "oversized length fields");
+		return err;
+	}
+
+
+	inline int media_index()
+	{
+		int err = media_tag_();
+
+		const std::string dir = temp_path("bench_media_index");
+		const std::string sub = dir + "/sub";
+		const std::string idx = temp_path("bench_media_index.midx");
+		utils::create_directory(dir);
+		utils::create_directory(sub);
+		const std::string a = dir + "/a.mp3";
+		const std::string b = dir + "/b.m4a";
+		const std::string c = dir + "/c.ogg";
+		const std::string d = sub + "/d.flac";
+		const std::string e = sub + "/e.opus";
+		const std::string f = dir + "/f.mp3";
+		const std::string n = dir + "/note.txt";
+		bool ok = media_write_(a, media_id3v23_("Song A"));
+		ok = ok && media_write_(b, media_mp4_("MP4 Title", true));
+		ok = ok && media_write_(c, media_vorbis_("Ogg Title"));
+		ok = ok && media_write_(d, media_flac_("Flac Title"));
+		ok = ok && media_write_(e, media_opus_());
+		ok = ok && media_write_(f, media_id3v1_("Only V1", "Album", 1));
+		ok = ok && media_write_(n, media_bytes_(10, 'x'));
+
+		al::media_index mi;
+		ok = ok && mi.scan(dir, 2) == 6 && mi.size() == 6;
+		uint32_t ia = mi.find(a);
+		ok = ok && ia != al::media_index::npos;
+		if(ok) {
+			const al::media_index::entry& en = mi.get(ia);
+			ok = en.title_ == "Song A" && en.track_ == "3" && en.total_tracks_ == "12"
+				&& en.cover_ && en.format_ == al::tag_format::MP3;
+		}
+		ok = ok && mi.find(n) == al::media_index::npos && mi.find_album("Album").size() == 2;
+		ok = ok && mi.get(mi.find(d)).format_ == al::tag_format::FLAC;
+		{
+			al::media_index::ids ids = mi.search("ogg title");
+			ok = ok && ids.size() == 1 && mi.get(ids[0]).path_ == c;
+			ok = ok && mi.search("ogg title", false).empty();
+		}
+		ok = ok && mi.scan(dir, 2) == 0;
+		err += check(ok, "media_index scan");
+
+		// 保存と読み込み
+		{
+			ok = mi.save(idx) && !mi.is_modify();
+			al::media_index mj;
+			ok = ok && mj.load(idx) && !mj.is_modify() && mj.size() == mi.size();
+			for(uint32_t i = 0; ok && i < mi.size(); ++i) {
+				uint32_t j = mj.find(mi.get(i).path_);
+				ok = j != al::media_index::npos && media_same_(mi.get(i), mj.get(j));
+			}
+			ok = ok && mj.find_album("Album").size() == 2 && mj.scan(dir, 1) == 0;
+			err += check(ok, "media_index save / load");
+
+			// 壊れたファイルは読まず、元のインデックスを残す
+			utils::file_io fin;
+			media_bytes_ buf;
+			if(fin.open(idx, "rb")) {
+				buf.resize(fin.get_file_size());
+				fin.read(buf.data(), buf.size());
+				fin.close();
+			}
+			media_write_(idx, media_bytes_(buf.begin(), buf.begin() + buf.size() / 2));
+			ok = !buf.empty() && !mj.load(idx) && mj.size() == mi.size();
+			buf[0] = 'X';
+			media_write_(idx, buf);
+			ok = ok && !mj.load(idx) && mj.size() == mi.size();
+			err += check(ok, "media_index broken file");
+		}
+
+		// 書き換えたファイルだけを、再解析する
+		ok = media_write_(a, media_id3v23_("Song A, take 2"));
+		ok = ok && mi.scan(dir, 2) == 1 && mi.size() == 6 && mi.is_modify();
+		ok = ok && mi.get(mi.find(a)).title_ == "Song A, take 2";
+		err += check(ok, "media_index touch rescan");
+
+		// 消したファイルは、取り除く
+		utils::remove_file(d);
+		ok = mi.scan(dir, 2) == 0 && mi.size() == 5 && mi.find(d) == al::media_index::npos;
+		ok = ok && mi.find(e) != al::media_index::npos && mi.get(mi.find(e)).title_ == "Opus Title";
+		media_write_(d, media_flac_("Flac Again"));
+		ok = ok && mi.update({ d }) == 1 && mi.size() == 6
+			&& mi.get(mi.find(d)).title_ == "Flac Again";
+		err += check(ok, "media_index delete rescan");
+
+		for(const std::string& s : { a, b, c, d, e, f, n, idx }) utils::remove_file(s);
+		std::remove(sub.c_str());
+		std::remove(dir.c_str());
+		return err;
+	}
+}
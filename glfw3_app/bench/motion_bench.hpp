@@ -0,0 +1,362 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	mdf::motion のテストと 100 モデルのベンチマーク @n
+			ベジェ補間は倍精度の二分法と、IK は目標との距離で確かめる。@n
+			プールで分割した評価は、逐次の評価と同じ結果になる事。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include "bench.hpp"
+#include "utils/file_io.hpp"
+#include "utils/task_pool.hpp"
+#include "mdf/motion.hpp"
+
+namespace bench {
+
+	// VMD のボーン・キー（１１１バイト）、補間は全ての軸で同じ
+	inline void motion_vmd_key_(std::vector<uint8_t>& buf, const std::string& name, uint32_t frame,
+		const vtx::fvtx& pos, const qtx::fquat& rot, const uint8_t* bz)
+	{
+		uint8_t rec[111];
+		std::memset(rec, 0, sizeof(rec));
+		std::memcpy(rec, name.c_str(), std::min(name.size(), static_cast<size_t>(15)));
+		std::memcpy(rec + 15, &frame, 4);
+		float f[7] = { pos.x, pos.y, pos.z, rot.x, rot.y, rot.z, rot.w };
+		std::memcpy(rec + 19, f, sizeof(f));
+		for(int k = 0; k < 4; ++k) {
+			rec[47 + k] = bz[0];
+			rec[47 + k + 4] = bz[1];
+			rec[47 + k + 8] = bz[2];
+			rec[47 + k + 12] = bz[3];
+		}
+		buf.insert(buf.end(), rec, rec + sizeof(rec));
+	}
+
+
+	inline bool motion_vmd_save_(const std::string& fn, const std::vector<uint8_t>& keys)
+	{
+		char head[50];
+		std::memset(head, 0, sizeof(head));
+		std::strcpy(head, "Vocaloid Motion Data 0002");
+		std::strcpy(head + 30, "bench");
+		uint32_t num = keys.size() / 111;
+		uint32_t morph = 0;
+		utils::file_io fo;
+		if(!fo.open(fn, "wb")) return false;
+		bool ok = fo.write(head, sizeof(head)) == sizeof(head) && fo.put(num);
+		ok = ok && fo.write(&keys[0], keys.size()) == keys.size() && fo.put(morph);
+		fo.close();
+		return ok;
+	}
+
+
+	// 倍精度の二分法による補間値
+	inline double motion_bezier_ref_(double x1, double y1, double x2, double y2, double t)
+	{
+		double lo = 0.0;
+		double hi = 1.0;
+		for(int i = 0; i < 60; ++i) {
+			double s = (lo + hi) * 0.5;
+			double is = 1.0 - s;
+			double x = 3.0 * is * is * s * x1 + 3.0 * is * s * s * x2 + s * s * s;
+			if(x < t) lo = s; else hi = s;
+		}
+		double s = (lo + hi) * 0.5;
+		double is = 1.0 - s;
+		return 3.0 * is * is * s * y1 + 3.0 * is * s * s * y2 + s * s * s;
+	}
+
+
+	inline qtx::fquat motion_axis_rot_(const vtx::fvtx& axis, float a)
+	{
+		float s = std::sin(a * 0.5f) / axis.len();
+		return qtx::fquat(axis.x * s, axis.y * s, axis.z * s, std::cos(a * 0.5f));
+	}
+
+
+	inline uint32_t motion_sorted_(const mdf::motion& m, uint32_t bone)
+	{
+		for(uint32_t s = 0; s < m.get_bone_num(); ++s) {
+			if(m.get_order(s) == bone) return s;
+		}
+		return 0;
+	}
+
+
+	// センターの下に、IK 付きの枝を branch 本（各 depth ボーン）
+	inline void motion_model_(mdf::motion::bones& bs, mdf::motion::iks& is, uint32_t branch, uint32_t depth)
+	{
+		bs.clear();
+		is.clear();
+		mdf::motion::bone c;
+		c.name_ = "center";
+		bs.push_back(c);
+		for(uint32_t b = 0; b < branch; ++b) {
+			float a = static_cast<float>(b) * 6.2831853f / static_cast<float>(branch);
+			vtx::fvtx dir(std::cos(a), std::sin(a), 0.5f);
+			uint32_t top = bs.size();
+			for(uint32_t d = 0; d < depth; ++d) {
+				mdf::motion::bone n;
+				n.name_ = "b" + std::to_string(b) + "_" + std::to_string(d);
+				n.parent_ = d == 0 ? 0 : bs.size() - 1;
+				n.position_ = dir * static_cast<float>(d + 1);
+				bs.push_back(n);
+			}
+			mdf::motion::bone k;
+			k.name_ = "ik" + std::to_string(b);
+			k.parent_ = 0;
+			k.position_ = dir * (static_cast<float>(depth) * 0.8f) + vtx::fvtx(0.0f, 0.0f, 1.0f);
+			bs.push_back(k);
+
+			mdf::motion::ik t;
+			t.bone_ = bs.size() - 1;
+			t.target_ = top + depth - 1;
+			t.loop_ = 20;
+			t.limit_ = 0.5f;
+			for(uint32_t l = 2; l <= 4 && l < depth; ++l) {
+				mdf::motion::ik_link kl;
+				kl.bone_ = top + depth - l;
+				t.links_.push_back(kl);
+			}
+			is.push_back(t);
+		}
+	}
+
+
+	// 枝のボーンは回転、IK ボーンは移動するモーション
+	inline bool motion_vmd_(const std::string& fn, uint32_t branch, uint32_t depth)
+	{
+		static const uint8_t bz[4] = { 20, 10, 107, 117 };
+		std::mt19937 rnd(34);
+		std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+		std::vector<uint8_t> keys;
+		for(uint32_t f = 0; f <= 60; f += 15) {
+			for(uint32_t b = 0; b < branch; ++b) {
+				for(uint32_t d = 0; d < depth; ++d) {
+					vtx::fvtx ax(u(rnd), u(rnd), u(rnd) + 2.0f);
+					motion_vmd_key_(keys, "b" + std::to_string(b) + "_" + std::to_string(d), f,
+						vtx::fvtx(0.0f), motion_axis_rot_(ax, u(rnd) * 0.3f), bz);
+				}
+				motion_vmd_key_(keys, "ik" + std::to_string(b), f,
+					vtx::fvtx(u(rnd), u(rnd), u(rnd)), qtx::fquat(), bz);
+			}
+		}
+		return motion_vmd_save_(fn, keys);
+	}
+
+
+	inline bool motion_same_(const mdf::motion::pose& a, const mdf::motion::pose& b)
+	{
+		if(a.skin_.size() != b.skin_.size()) return false;
+		for(uint32_t i = 0; i < a.skin_.size(); ++i) {
+			if(std::memcmp(a.skin_[i](), b.skin_[i](), sizeof(float) * 16) != 0) return false;
+		}
+		return true;
+	}
+
+
+	inline int motion()
+	{
+		int err = 0;
+
+		{
+			// 対称な曲線の中点、端点、直線
+			mdf::vmd_io::bezier s;
+			s.set(127, 0, 0, 127);
+			bool ok = std::abs(s.get(0.5f) - 0.5f) < 1e-4f && s.get(0.0f) == 0.0f
+				&& std::abs(s.get(1.0f) - 1.0f) < 1e-5f && std::abs(s.get(0.25f) - 0.25f) > 0.01f;
+			mdf::vmd_io::bezier l;
+			l.set(20, 20, 107, 107);
+			for(float t = 0.0f; t <= 1.0f; t += 0.125f) ok = ok && l.get(t) == t;
+			static const uint8_t cs[][4] = {
+				{ 20, 10, 107, 117 }, { 64, 0, 64, 127 }, { 0, 127, 127, 0 }, { 127, 127, 0, 0 }
+			};
+			float e = 0.0f;
+			for(const auto& c : cs) {
+				mdf::vmd_io::bezier b;
+				b.set(c[0], c[1], c[2], c[3]);
+				for(int i = 0; i <= 64; ++i) {
+					double t = i / 64.0;
+					double r = motion_bezier_ref_(c[0] / 127.0, c[1] / 127.0, c[2] / 127.0, c[3] / 127.0, t);
+					float d = std::abs(b.get(static_cast<float>(t)) - static_cast<float>(r));
+					if(e < d) e = d;
+				}
+			}
+			err += check(ok && e < 1e-3f, "bezier vs hand values, double bisection");
+		}
+
+		const std::string fn = temp_path("bench_motion.vmd");
+		{
+			// キーの補間曲線は後側のキーが持つ
+			static const uint8_t lin[4] = { 20, 20, 107, 107 };
+			static const uint8_t ease[4] = { 127, 0, 0, 127 };
+			std::vector<uint8_t> keys;
+			motion_vmd_key_(keys, "bone", 10, vtx::fvtx(10.0f, 20.0f, 30.0f),
+				motion_axis_rot_(vtx::fvtx(0.0f, 0.0f, 1.0f), 1.5707963f), lin);
+			motion_vmd_key_(keys, "bone", 0, vtx::fvtx(0.0f), qtx::fquat(), lin);
+			motion_vmd_key_(keys, "bone", 20, vtx::fvtx(0.0f), qtx::fquat(), ease);
+			mdf::vmd_io vmd;
+			bool ok = motion_vmd_save_(fn, keys) && vmd.load(fn) && vmd.get_last_frame() == 20;
+			int32_t tr = vmd.find_bone_track("bone");
+			ok = ok && tr >= 0 && vmd.find_bone_track("none") < 0;
+			if(ok) {
+				const mdf::vmd_io::bone_track& t = vmd.get_bone_tracks()[tr];
+				uint32_t cur = 0;
+				vtx::fvtx p;
+				qtx::fquat q;
+				mdf::vmd_io::sample(t, 5.0f, cur, p, q);
+				ok = std::abs(p.x - 5.0f) < 1e-4f && std::abs(p.y - 10.0f) < 1e-4f && std::abs(p.z - 15.0f) < 1e-4f;
+				ok = ok && std::abs(q.z - std::sin(0.3926991f)) < 1e-4f && std::abs(q.w - std::cos(0.3926991f)) < 1e-4f;
+				mdf::vmd_io::sample(t, 15.0f, cur, p, q);
+				ok = ok && std::abs(p.x - 5.0f) < 1e-3f;
+				mdf::vmd_io::sample(t, 12.5f, cur, p, q);
+				float r = 10.0f * (1.0f - static_cast<float>(motion_bezier_ref_(1.0, 0.0, 0.0, 1.0, 0.25)));
+				ok = ok && std::abs(p.x - r) < 1e-2f;
+				mdf::vmd_io::sample(t, 30.0f, cur, p, q);
+				ok = ok && p.x == 0.0f && q.w == 1.0f;
+			}
+			err += check(ok, "vmd load, sample (sorted keys)");
+		}
+
+		{
+			// 上向きの３リンクを、届く目標へ CCD で曲げる
+			mdf::motion::bones bs(5);
+			for(uint32_t i = 0; i < 4; ++i) {
+				bs[i].name_ = "a" + std::to_string(i);
+				bs[i].parent_ = static_cast<int32_t>(i) - 1;
+				bs[i].position_.set(0.0f, static_cast<float>(i), 0.0f);
+			}
+			bs[4].name_ = "ik";
+			bs[4].position_.set(1.5f, 1.5f, 0.3f);
+			mdf::motion::iks is(1);
+			is[0].bone_ = 4;
+			is[0].target_ = 3;
+			is[0].loop_ = 40;
+			is[0].limit_ = 1.0f;
+			for(uint32_t l = 2; l >= 1; --l) {
+				mdf::motion::ik_link kl;
+				kl.bone_ = l;
+				is[0].links_.push_back(kl);
+			}
+			{
+				mdf::motion::ik_link kl;
+				kl.bone_ = 0;
+				is[0].links_.push_back(kl);
+			}
+			mdf::motion m;
+			bool ok = m.setup(bs, is);
+			mdf::motion::pose p;
+			m.create_pose(p);
+			m.evaluate(0.0f, p);
+			vtx::fvtx d = p.world_pos_[motion_sorted_(m, 3)] - bs[4].position_;
+			// リンク長は変わらない
+			vtx::fvtx l = p.world_pos_[motion_sorted_(m, 2)] - p.world_pos_[motion_sorted_(m, 1)];
+			ok = ok && d.len() < 1e-3f && std::abs(l.len() - 1.0f) < 1e-4f;
+			err += check(ok, "CCD IK converges to reachable goal");
+
+			// 届かない目標では、目標の方向へ伸びきる
+			bs[4].position_.set(0.0f, 0.0f, 10.0f);
+			ok = m.setup(bs, is);
+			m.create_pose(p);
+			m.evaluate(0.0f, p);
+			vtx::fvtx e = p.world_pos_[motion_sorted_(m, 3)];
+			ok = ok && std::abs(e.z - 3.0f) < 1e-2f;
+			err += check(ok, "CCD IK stretches toward unreachable goal");
+		}
+
+		{
+			mdf::motion::bones bs;
+			mdf::motion::iks is;
+			motion_model_(bs, is, 12, 10);
+			mdf::vmd_io vmd;
+			mdf::motion m;
+			bool ok = motion_vmd_(fn, 12, 10) && vmd.load(fn) && m.setup(bs, is);
+			ok = ok && m.bind(vmd) == bs.size() - 1 && m.get_island_num() == 12;
+
+			static const uint32_t num = 16;
+			std::vector<mdf::motion::pose> one(num);
+			std::vector<mdf::motion::pose> isl(num);
+			std::vector<mdf::motion::pose> all(num);
+			for(uint32_t i = 0; i < num; ++i) {
+				m.create_pose(one[i]);
+				m.create_pose(isl[i]);
+				m.create_pose(all[i]);
+			}
+			for(float f = 0.0f; ok && f <= 60.0f; f += 7.25f) {
+				for(uint32_t i = 0; i < num; ++i) {
+					m.set_thread(1);
+					m.evaluate(f + i, one[i]);
+					m.set_thread(8);
+					m.evaluate(f + i, isl[i]);
+					ok = ok && motion_same_(one[i], isl[i]);
+				}
+				m.evaluate(f, &all[0], num, 0);
+				for(uint32_t i = 0; ok && i < num; ++i) {
+					m.set_thread(1);
+					mdf::motion::pose p;
+					m.create_pose(p);
+					m.evaluate(f, p);
+					ok = motion_same_(p, all[i]);
+				}
+			}
+			err += check(ok, "islands / pooled poses == serial");
+		}
+		utils::remove_file(fn);
+		return err;
+	}
+
+
+	inline int motion_bench()
+	{
+		static const uint32_t models = 100;
+		static const uint32_t frames = 120;
+		const std::string fn = temp_path("bench_motion.vmd");
+		mdf::motion::bones bs;
+		mdf::motion::iks is;
+		motion_model_(bs, is, 16, 12);
+		mdf::vmd_io vmd;
+		mdf::motion m;
+		motion_vmd_(fn, 16, 12);
+		vmd.load(fn);
+		utils::remove_file(fn);
+		m.setup(bs, is);
+		m.bind(vmd);
+
+		std::vector<mdf::motion::pose> ps(models);
+		for(auto& p : ps) m.create_pose(p);
+		double num = static_cast<double>(models) * frames;
+		char tmp[64];
+
+		timer t;
+		for(uint32_t f = 0; f < frames; ++f) {
+			m.evaluate(static_cast<float>(f) * 0.5f, &ps[0], models, 1);
+		}
+		snprintf(tmp, sizeof(tmp), "motion 100 x %u bones serial", m.get_bone_num());
+		report(tmp, t.get_msec(), num, "models");
+
+		t.reset();
+		for(uint32_t f = 0; f < frames; ++f) {
+			m.evaluate(static_cast<float>(f) * 0.5f, &ps[0], models);
+		}
+		snprintf(tmp, sizeof(tmp), "motion 100 x %u bones pool(%u)", m.get_bone_num(),
+			utils::task_pool::get_instance().size());
+		report(tmp, t.get_msec(), num, "models");
+
+		t.reset();
+		m.set_thread(utils::task_pool::get_instance().size());
+		for(uint32_t f = 0; f < frames; ++f) {
+			for(auto& p : ps) m.evaluate(static_cast<float>(f) * 0.5f, p);
+		}
+		snprintf(tmp, sizeof(tmp), "motion 100 x %u bones islands", m.get_bone_num());
+		report(tmp, t.get_msec(), num, "models");
+		keep(ps[0].skin_[1]()[12]);
+		return 0;
+	}
+}
@@ -0,0 +1,222 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	mtx::simd のテストとベンチマーク @n
+			積と一括変換は、スカラー版とビット単位で一致する事。@n
+			逆行列は演算の順序が違うので、単位行列との誤差と、@n
+			mtx.hpp のテンプレート版（double）との要素毎の誤差で確かめる。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "bench.hpp"
+#include "utils/mtx_simd.hpp"
+#include "utils/mtx.hpp"
+
+namespace bench {
+
+	inline void mtx_simd_random_(std::mt19937& rnd, float* p, size_t num)
+	{
+		std::uniform_real_distribution<float> u(-4.0f, 4.0f);
+		for(size_t i = 0; i < num; ++i) p[i] = u(rnd);
+	}
+
+
+	// スカラー版の積（mtx_simd.hpp と同じ演算順序）
+	inline void mtx_simd_matmul4_ref_(float* out, const float* a, const float* b)
+	{
+		for(int j = 0; j < 4; ++j) {
+			for(int i = 0; i < 4; ++i) {
+				out[j * 4 + i] = a[i] * b[j * 4] + a[4 + i] * b[j * 4 + 1]
+					+ a[8 + i] * b[j * 4 + 2] + a[12 + i] * b[j * 4 + 3];
+			}
+		}
+	}
+
+
+	inline int mtx_simd_transform_(const char* name, mtx::simd::level lvl)
+	{
+		std::mt19937 rnd(4321);
+		bool okp = true;
+		bool okn = true;
+		float m[16];
+		mtx_simd_random_(rnd, m, 16);
+		// 端数の処理を確かめる為、点数を変える
+		for(size_t n = 0; n < 40; ++n) {
+			std::vector<float> src(n * 3 + 1);
+			mtx_simd_random_(rnd, &src[0], src.size());
+			std::vector<float> ref(n * 3 + 1, 0.0f);
+			std::vector<float> out(n * 3 + 1, 0.0f);
+
+			mtx::simd::set_level(mtx::simd::level::none);
+			mtx::simd::transform_points(m, &src[0], &ref[0], n);
+			mtx::simd::set_level(lvl);
+			mtx::simd::transform_points(m, &src[0], &out[0], n);
+			okp = okp && std::memcmp(&ref[0], &out[0], ref.size() * sizeof(float)) == 0;
+
+			mtx::simd::set_level(mtx::simd::level::none);
+			mtx::simd::transform_normals(m, &src[0], &ref[0], n);
+			mtx::simd::set_level(lvl);
+			mtx::simd::transform_normals(m, &src[0], &out[0], n);
+			okn = okn && std::memcmp(&ref[0], &out[0], ref.size() * sizeof(float)) == 0;
+
+			// src と dst が同じ場合
+			std::vector<float> in = src;
+			mtx::simd::transform_points(m, &in[0], &in[0], n);
+			mtx::simd::set_level(mtx::simd::level::none);
+			mtx::simd::transform_points(m, &src[0], &ref[0], n);
+			okp = okp && std::memcmp(&ref[0], &in[0], n * 3 * sizeof(float)) == 0;
+		}
+		mtx::simd::set_level(mtx::simd::level::avx);
+		int err = 0;
+		err += check(okp, std::string(name) + " transform_points == scalar");
+		err += check(okn, std::string(name) + " transform_normals == scalar");
+		return err;
+	}
+
+
+	inline int mtx_simd()
+	{
+		int err = 0;
+		std::mt19937 rnd(2017);
+		bool okm = true;
+		bool oka = true;
+		bool okv = true;
+		bool okt = true;
+		float einv = 0.0f;
+		float eref = 0.0f;
+		for(int k = 0; k < 1000; ++k) {
+			float a[16], b[16], ref[16], out[16];
+			mtx_simd_random_(rnd, a, 16);
+			mtx_simd_random_(rnd, b, 16);
+			mtx_simd_matmul4_ref_(ref, a, b);
+			mtx::simd::matmul4(out, a, b);
+			okm = okm && std::memcmp(ref, out, sizeof(ref)) == 0;
+			// 出力と入力が重なる場合
+			float c[16];
+			std::memcpy(c, a, sizeof(c));
+			mtx::simd::matmul4(c, c, b);
+			oka = oka && std::memcmp(ref, c, sizeof(ref)) == 0;
+
+			float v[4], rv[4], ov[4];
+			mtx_simd_random_(rnd, v, 4);
+			for(int i = 0; i < 4; ++i) {
+				rv[i] = a[i] * v[0] + a[4 + i] * v[1] + a[8 + i] * v[2] + a[12 + i] * v[3];
+			}
+			mtx::simd::matmul1(ov, a, v);
+			okv = okv && std::memcmp(rv, ov, sizeof(rv)) == 0;
+
+			float t[16];
+			mtx::simd::transpose(a, t);
+			for(int j = 0; j < 4; ++j) {
+				for(int i = 0; i < 4; ++i) okt = okt && t[j * 4 + i] == a[i * 4 + j];
+			}
+
+			// 条件の良い行列（対角優位）で逆行列を確かめる
+			for(int i = 0; i < 4; ++i) a[i * 5] += 20.0f;
+			float inv[16], id[16];
+			if(!mtx::simd::invert(a, inv)) {
+				einv = 1.0f;
+				continue;
+			}
+			mtx_simd_matmul4_ref_(id, a, inv);
+			for(int i = 0; i < 16; ++i) {
+				float e = std::fabs(id[i] - ((i % 5) == 0 ? 1.0f : 0.0f));
+				if(e > einv) einv = e;
+			}
+			// テンプレート版（float は SIMD に特殊化されているので double で）
+			double ad[16], invd[16];
+			for(int i = 0; i < 16; ++i) ad[i] = a[i];
+			if(!mtx::invert_matrix<double>(ad, invd)) {
+				eref = 1.0f;
+				continue;
+			}
+			for(int i = 0; i < 16; ++i) {
+				double e = std::fabs(inv[i] - invd[i]) / std::max(1.0, std::fabs(invd[i]));
+				if(e > eref) eref = e;
+			}
+		}
+		err += check(okm, "matmul4 == scalar");
+		err += check(oka, "matmul4 in place");
+		err += check(okv, "matmul1 == scalar");
+		err += check(okt, "transpose");
+		err += check(einv < 1e-5f, "invert (|a * inv - I| < 1e-5)");
+		err += check(eref < 1e-6f, "invert == mtx::invert_matrix<double> (< 1e-6)");
+		{
+			float s[16] = { 0.0f };
+			float d[16];
+			err += check(!mtx::simd::invert(s, d), "invert singular");
+		}
+
+		err += mtx_simd_transform_("sse", mtx::simd::level::sse);
+		err += mtx_simd_transform_("avx", mtx::simd::level::avx);
+		return err;
+	}
+
+
+	inline int mtx_simd_bench()
+	{
+		std::mt19937 rnd(1);
+		{
+			static const int loop = 2000000;
+			float a[16], b[16], ref[16];
+			mtx_simd_random_(rnd, a, 16);
+			mtx_simd_random_(rnd, b, 16);
+			timer t;
+			for(int i = 0; i < loop; ++i) {
+				a[0] = static_cast<float>(i & 255) * 0.01f + 10.0f;
+				mtx_simd_matmul4_ref_(ref, a, b);
+				keep(ref[i & 15]);
+			}
+			report("matmul4 scalar", t.get_msec(), loop, "mul");
+			t.reset();
+			for(int i = 0; i < loop; ++i) {
+				a[0] = static_cast<float>(i & 255) * 0.01f + 10.0f;
+				mtx::simd::matmul4(ref, a, b);
+				keep(ref[i & 15]);
+			}
+			report("matmul4 simd", t.get_msec(), loop, "mul");
+			t.reset();
+			for(int i = 0; i < loop; ++i) {
+				a[0] = static_cast<float>(i & 255) * 0.01f + 10.0f;
+				mtx::simd::invert(a, ref);
+				keep(ref[i & 15]);
+			}
+			report("invert simd", t.get_msec(), loop, "inv");
+		}
+
+		static const size_t num = 1000000;
+		static const int loop = 20;
+		std::vector<float> src(num * 3);
+		std::vector<float> dst(num * 3);
+		mtx_simd_random_(rnd, &src[0], src.size());
+		float m[16];
+		mtx_simd_random_(rnd, m, 16);
+		static const struct {
+			mtx::simd::level	lvl;
+			const char*			name;
+		} tbl[] = {
+			{ mtx::simd::level::none,	"transform_points 1M scalar" },
+			{ mtx::simd::level::sse,	"transform_points 1M sse" },
+			{ mtx::simd::level::avx,	"transform_points 1M avx" },
+		};
+		for(const auto& e : tbl) {
+			mtx::simd::set_level(e.lvl);
+			if(mtx::simd::get_level() != e.lvl) continue;
+			timer t;
+			for(int i = 0; i < loop; ++i) {
+				mtx::simd::transform_points(m, &src[0], &dst[0], num);
+			}
+			report(e.name, t.get_msec(), static_cast<double>(num) * loop, "points");
+			keep(dst[num]);
+		}
+		mtx::simd::set_level(mtx::simd::level::avx);
+		return 0;
+	}
+}
@@ -0,0 +1,175 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	img::paint アンチエイリアス・ポリゴンのクリッピング・テストと @n
+			ベンチマーク @n
+			画面からはみ出たポリゴンを、十分に大きい画像に描いて切り出した @n
+			結果と比較する。@n
+			ベンチマークは、線、円、ポリゴンを数千個ずつ、アンチエイリアスの @n
+			有無で描く。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include "bench.hpp"
+#include "img_io/paint.hpp"
+
+namespace bench {
+
+	inline int paint_clip_polygon_(const vtx::sposs& src, const char* name)
+	{
+		static const short w = 64;
+		static const short h = 48;
+		static const short ofs = 128;
+
+		img::paint small;
+		small.create(vtx::spos(w, h), true);
+		small.fill(img::rgba8(0, 0, 0, 255));
+		small.anti_alias();
+		small.set_fore_color(img::rgba8(255, 200, 100, 255));
+		small.fill_polygon(src);
+
+		img::paint large;
+		large.create(vtx::spos(w + ofs * 2, h + ofs * 2), true);
+		large.fill(img::rgba8(0, 0, 0, 255));
+		large.anti_alias();
+		large.set_fore_color(img::rgba8(255, 200, 100, 255));
+		vtx::sposs pts;
+		for(const auto& p : src) {
+			pts.push_back(vtx::spos(p.x + ofs, p.y + ofs));
+		}
+		large.fill_polygon(pts);
+
+		// 左側のカバレッジは先頭の列にまとめて積むので、丸めの誤差を許す
+		int diff = 0;
+		for(short y = 0; y < h; ++y) {
+			for(short x = 0; x < w; ++x) {
+				img::rgba8 a(0, 0, 0, 0);
+				img::rgba8 b(0, 0, 0, 0);
+				small.get_pixel(vtx::spos(x, y), a);
+				large.get_pixel(vtx::spos(x + ofs, y + ofs), b);
+				int d = std::abs(a.r - b.r);
+				d = std::max(d, std::abs(a.g - b.g));
+				d = std::max(d, std::abs(a.b - b.b));
+				if(d > diff) diff = d;
+			}
+		}
+		return check(diff <= 1, name);
+	}
+
+
+	inline int paint_clip()
+	{
+		int err = 0;
+		{
+			vtx::sposs pts;
+			pts.push_back(vtx::spos(-40, 10));
+			pts.push_back(vtx::spos(30, -7));
+			pts.push_back(vtx::spos(50, 30));
+			pts.push_back(vtx::spos(-3, 44));
+			err += paint_clip_polygon_(pts, "polygon left/top clip");
+		}
+		{
+			vtx::sposs pts;
+			pts.push_back(vtx::spos(20, 5));
+			pts.push_back(vtx::spos(110, 20));
+			pts.push_back(vtx::spos(40, 70));
+			err += paint_clip_polygon_(pts, "polygon right/bottom clip");
+		}
+		{
+			vtx::sposs pts;
+			pts.push_back(vtx::spos(-100, -30));
+			pts.push_back(vtx::spos(100, 3));
+			pts.push_back(vtx::spos(90, 90));
+			pts.push_back(vtx::spos(-90, 60));
+			err += paint_clip_polygon_(pts, "polygon larger than image");
+		}
+		{
+			vtx::sposs pts;
+			pts.push_back(vtx::spos(-120, 0));
+			pts.push_back(vtx::spos(-2, 20));
+			pts.push_back(vtx::spos(-120, 40));
+			err += paint_clip_polygon_(pts, "polygon outside left");
+		}
+		return err;
+	}
+
+
+	inline void paint_bench_run_(bool aa)
+	{
+		static const short w = 1024;
+		static const short h = 768;
+		static const uint32_t lines = 20000;
+		static const uint32_t circles = 5000;
+		static const uint32_t polygons = 5000;
+		const char* mode = aa ? "aa on " : "aa off";
+		char tmp[64];
+
+		img::paint pa;
+		pa.create(vtx::spos(w, h), true);
+		pa.fill(img::rgba8(0, 0, 0, 255));
+		pa.anti_alias(aa);
+
+		// 一部は画面からはみ出す
+		std::mt19937 rnd(1234);
+		std::uniform_int_distribution<int> ux(-64, w + 64);
+		std::uniform_int_distribution<int> uy(-64, h + 64);
+		std::uniform_int_distribution<int> ur(2, 48);
+		std::uniform_int_distribution<int> uc(0, 255);
+
+		timer t;
+		for(uint32_t i = 0; i < lines; ++i) {
+			pa.set_fore_color(img::rgba8(uc(rnd), uc(rnd), uc(rnd), 255));
+			pa.line(ux(rnd), uy(rnd), ux(rnd), uy(rnd));
+		}
+		snprintf(tmp, sizeof(tmp), "paint %s line x20k", mode);
+		report(tmp, t.get_msec(), lines, "lines");
+
+		t.reset();
+		for(uint32_t i = 0; i < circles; ++i) {
+			pa.set_fore_color(img::rgba8(uc(rnd), uc(rnd), uc(rnd), 255));
+			pa.fill_circle(vtx::spos(ux(rnd), uy(rnd)), ur(rnd));
+		}
+		snprintf(tmp, sizeof(tmp), "paint %s fill_circle x5k", mode);
+		report(tmp, t.get_msec(), circles, "circles");
+
+		// 凸と凹が混ざる、３～１２角形
+		std::vector<vtx::sposs> polys(polygons);
+		for(vtx::sposs& pts : polys) {
+			int cx = ux(rnd);
+			int cy = uy(rnd);
+			int r = ur(rnd) * 2;
+			int num = 3 + rnd() % 10;
+			for(int j = 0; j < num; ++j) {
+				float a = 6.2831853f * j / num;
+				float rr = (j & 1) ? r * 0.5f : r;
+				pts.push_back(vtx::spos(cx + static_cast<int>(rr * std::cos(a)),
+					cy + static_cast<int>(rr * std::sin(a))));
+			}
+		}
+		t.reset();
+		for(const vtx::sposs& pts : polys) {
+			pa.set_fore_color(img::rgba8(uc(rnd), uc(rnd), uc(rnd), 255));
+			pa.fill_polygon(pts);
+		}
+		snprintf(tmp, sizeof(tmp), "paint %s fill_polygon x5k", mode);
+		report(tmp, t.get_msec(), polygons, "polygons");
+
+		img::rgba8 c(0, 0, 0, 0);
+		pa.get_pixel(vtx::spos(w / 2, h / 2), c);
+		keep(c.r);
+	}
+
+
+	inline int paint_bench()
+	{
+		paint_bench_run_(false);
+		paint_bench_run_(true);
+		return 0;
+	}
+}
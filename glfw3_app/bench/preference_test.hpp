@@ -0,0 +1,177 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	sys::preference のテスト @n
+			テキスト形式の .pre はセーブで書き換えず、ログは .prb に置く事。@n
+			追記ログと詰め直しの後も、値と消去が保たれる事。@n
+			100k キーで、テキストの取り込み、.prb のロード、追記セーブ、@n
+			詰め直しの時間を計る。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdio>
+#include <vector>
+#include "bench.hpp"
+#include "file_io_test.hpp"
+#include "utils/preference.hpp"
+
+namespace bench {
+
+	inline int preference()
+	{
+		int err = 0;
+		const std::string fn = temp_path("bench_preference.pre");
+		const std::string log = sys::preference::get_log_name(fn);
+		utils::remove_file(log);
+		{
+			utils::file_io fo;
+			fo.open(fn, "wb");
+			fo.put("/app/name 2 \"hello\"\n/app/count 0 42\n");
+			fo.close();
+		}
+		std::vector<char> text;
+		file_io_read_all_(fn, text);
+
+		{
+			sys::preference pre;
+			bool ok = pre.load(fn);
+			int n = 0;
+			std::string s;
+			ok = ok && pre.get_integer("/app/count", n) && n == 42;
+			ok = ok && pre.get_text("/app/name", s) && s == "hello";
+			err += check(ok, "load text .pre");
+
+			pre.put_integer("/app/count", 43);
+			{
+				// ベースは一時オブジェクトでも良い
+				sys::preference::batch b(pre, std::string("/app/") + "window");
+				b.put_position("locate", vtx::ipos(10, 20));
+			}
+			pre.put_text("/app/sub dir/x", "y");
+			ok = pre.save(fn);
+			std::vector<char> t;
+			file_io_read_all_(fn, t);
+			err += check(ok && t == text && log == temp_path("bench_preference.prb") &&
+				utils::probe_file(log), "save to .prb, .pre untouched");
+		}
+		{
+			sys::preference pre;
+			bool ok = pre.load(fn);
+			int n = 0;
+			vtx::ipos p(0);
+			std::string s;
+			ok = ok && pre.get_integer("/app/count", n) && n == 43;
+			ok = ok && pre.get_position("/app/window/locate", p) && p == vtx::ipos(10, 20);
+			ok = ok && pre.get_text("/app/sub_dir/x", s) && s == "y";
+			err += check(ok, "load .prb");
+
+			pre.erase("/app/name");
+			pre.put_integer("/app/count", 44);
+			uint32_t sz = pre.get_log_size();
+			ok = pre.save(fn) && pre.get_log_size() > sz;
+			err += check(ok, "append to log");
+		}
+		{
+			sys::preference pre;
+			pre.load(fn);
+			int n = 0;
+			bool ok = !pre.find("/app/name") && pre.get_integer("/app/count", n) && n == 44;
+			ok = ok && pre.compact();
+			sys::preference q;
+			ok = ok && q.load(fn) && q.size() == pre.size() && q.get_integer("/app/count", n) && n == 44;
+			err += check(ok, "erase and compact");
+		}
+		utils::remove_file(fn);
+		utils::remove_file(log);
+		return err;
+	}
+
+
+	inline std::string preference_key_(uint32_t i)
+	{
+		char tmp[64];
+		snprintf(tmp, sizeof(tmp), "/bench/group%u/key%u", i / 100, i);
+		return tmp;
+	}
+
+
+	inline void preference_put_(sys::preference& pre, uint32_t i, int32_t v)
+	{
+		switch(i % 3) {
+		case 0:
+			pre.put_integer(preference_key_(i), v);
+			break;
+		case 1:
+			pre.put_text(preference_key_(i), "text" + std::to_string(v));
+			break;
+		default:
+			pre.put_position(preference_key_(i), vtx::ipos(v, -v));
+			break;
+		}
+	}
+
+
+	inline int preference_bench()
+	{
+		static const uint32_t num = 100000;
+		static const uint32_t edits = 1000;
+		static const uint32_t rounds = 10;
+		const std::string fn = temp_path("bench_preference_100k.pre");
+		const std::string log = sys::preference::get_log_name(fn);
+		utils::remove_file(log);
+		{
+			sys::preference pre;
+			for(uint32_t i = 0; i < num; ++i) preference_put_(pre, i, i);
+			pre.save_text(fn);
+		}
+
+		timer t;
+		{
+			sys::preference pre;
+			pre.load(fn);
+			report("preference text import 100k", t.get_msec(), num, "keys");
+
+			t.reset();
+			pre.save(fn);
+			report("preference .prb write 100k", t.get_msec(), num, "keys");
+		}
+
+		t.reset();
+		sys::preference pre;
+		pre.load(fn);
+		report("preference .prb load 100k", t.get_msec(), num, "keys");
+
+		t.reset();
+		{
+			int32_t sum = 0;
+			for(uint32_t i = 0; i < num; i += 3) {
+				int32_t v = 0;
+				pre.get_integer(preference_key_(i), v);
+				sum += v;
+			}
+			keep(sum);
+		}
+		report("preference get_integer 33k", t.get_msec(), num / 3, "keys");
+
+		t.reset();
+		for(uint32_t r = 0; r < rounds; ++r) {
+			for(uint32_t j = 0; j < edits; ++j) {
+				preference_put_(pre, (j * 7919 + r * 131) % num, r * edits + j);
+			}
+			pre.save(fn);
+		}
+		report("preference append save (1k edits)", t.get_msec(), rounds, "saves");
+
+		t.reset();
+		pre.compact();
+		report("preference compact 100k", t.get_msec(), num, "keys");
+		keep(pre.get_log_size());
+
+		utils::remove_file(fn);
+		utils::remove_file(log);
+		return 0;
+	}
+}
@@ -0,0 +1,179 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	img::quantize_to_idx8 のテストと 4K 画像ベンチマーク @n
+			パレット数以下の色数の画像は、そのまま再現される事。@n
+			パレットは指定数以下で、グラデーションの誤差は小さい事。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cmath>
+#include <random>
+#include "bench.hpp"
+#include "img_io/img_utils.hpp"
+
+namespace bench {
+
+	// 最大誤差（チャネル毎）と平均二乗誤差を返す
+	inline int quantize_error_(const img::img_rgba8& src, const img::img_idx8& dst, double& mse)
+	{
+		const vtx::spos& size = src.get_size();
+		int emax = 0;
+		double sum = 0.0;
+		vtx::spos p;
+		for(p.y = 0; p.y < size.y; ++p.y) {
+			for(p.x = 0; p.x < size.x; ++p.x) {
+				img::rgba8 a(0, 0, 0, 0);
+				img::rgba8 b(0, 0, 0, 0);
+				src.get_pixel(p, a);
+				dst.get_pixel(p, b);
+				int d[4] = { a.r - b.r, a.g - b.g, a.b - b.b, a.a - b.a };
+				for(int v : d) {
+					if(std::abs(v) > emax) emax = std::abs(v);
+					sum += v * v;
+				}
+			}
+		}
+		mse = sum / (static_cast<double>(size.x) * size.y * 4);
+		return emax;
+	}
+
+
+	inline int quantize()
+	{
+		static const img::dither::type dts[] = {
+			img::dither::NONE, img::dither::ORDERED, img::dither::FLOYD_STEINBERG
+		};
+		int err = 0;
+		std::mt19937 rnd(30);
+		{
+			// 256 色、隣り合う色は１しか違わないものも混ぜる
+			img::rgba8 pal[256];
+			for(int i = 0; i < 256; ++i) {
+				if(i & 1) {
+					pal[i] = pal[i - 1];
+					pal[i].r ^= 1;
+				} else {
+					pal[i].set(rnd(), rnd(), rnd(), (i & 2) ? 255 : rnd());
+				}
+			}
+			img::img_rgba8 src;
+			src.create(vtx::spos(97, 61), true);
+			for(int y = 0; y < 61; ++y) {
+				for(int x = 0; x < 97; ++x) {
+					src.put_pixel(vtx::spos(x, y), pal[(x * 7 + y * 13 + (x * y) % 5) & 255]);
+				}
+			}
+			bool ok = true;
+			for(img::dither::type dt : dts) {
+				img::img_idx8 dst;
+				double mse;
+				ok = ok && img::quantize_to_idx8(&src, dst, 256, dt);
+				ok = ok && dst.get_clut_max() <= 256 && quantize_error_(src, dst, mse) == 0;
+			}
+			// ８色の画像を、８色で
+			img::img_rgba8 s8;
+			s8.create(vtx::spos(32, 32), false);
+			for(int y = 0; y < 32; ++y) {
+				for(int x = 0; x < 32; ++x) {
+					s8.put_pixel(vtx::spos(x, y), pal[((x >> 2) + y) & 7]);
+				}
+			}
+			img::img_idx8 d8;
+			double mse;
+			ok = ok && img::quantize_to_idx8(&s8, d8, 8) && d8.get_clut_max() <= 8 && quantize_error_(s8, d8, mse) == 0;
+			err += check(ok, "quantize <= 256 colors is exact");
+		}
+		{
+			// 色数の多い画像でも、パレットは指定数以下
+			img::img_rgba8 src;
+			src.create(vtx::spos(128, 96), false);
+			for(int y = 0; y < 96; ++y) {
+				for(int x = 0; x < 128; ++x) {
+					src.put_pixel(vtx::spos(x, y), img::rgba8(rnd(), rnd(), rnd(), 255));
+				}
+			}
+			bool ok = true;
+			for(int num : { 2, 16, 100, 256 }) {
+				for(img::dither::type dt : dts) {
+					img::img_idx8 dst;
+					ok = ok && img::quantize_to_idx8(&src, dst, num, dt) && dst.get_clut_max() <= num;
+					for(int y = 0; ok && y < 96; ++y) {
+						for(int x = 0; x < 128; ++x) {
+							img::idx8 i(0);
+							dst.get_pixel(vtx::spos(x, y), i);
+							if(i.i >= dst.get_clut_max()) ok = false;
+						}
+					}
+				}
+			}
+			img::img_idx8 dst;
+			ok = ok && !img::quantize_to_idx8(&src, dst, 1) && !img::quantize_to_idx8(&src, dst, 257);
+			err += check(ok, "quantize palette size");
+		}
+		{
+			// グラデーション（約 65000 色）の誤差
+			img::img_rgba8 src;
+			src.create(vtx::spos(256, 256), false);
+			for(int y = 0; y < 256; ++y) {
+				for(int x = 0; x < 256; ++x) {
+					src.put_pixel(vtx::spos(x, y), img::rgba8(x, y, (x + y) / 2, 255));
+				}
+			}
+			// ディザ無しは量子化幅（８）程度、ディザ有りは誤差を散らすので少し大きい
+			static const int emax_lim[] = { 12, 16, 24 };
+			static const double mse_lim[] = { 20.0, 25.0, 32.0 };
+			bool ok = true;
+			for(int i = 0; i < 3; ++i) {
+				img::img_idx8 dst;
+				double mse = 0.0;
+				ok = ok && img::quantize_to_idx8(&src, dst, 256, dts[i]);
+				ok = ok && dst.get_clut_max() <= 256;
+				ok = ok && quantize_error_(src, dst, mse) <= emax_lim[i] && mse < mse_lim[i];
+			}
+			err += check(ok, "quantize gradient error");
+		}
+		return err;
+	}
+
+
+	inline int quantize_4k()
+	{
+		static const short w = 3840;
+		static const short h = 2160;
+
+		// グラデーションと模様を重ねて、色数の多い画像を作る
+		img::img_rgba8 src;
+		src.create(vtx::spos(w, h), true);
+		for(int y = 0; y < h; ++y) {
+			img::rgba8* p = src.at_image(y * w);
+			for(int x = 0; x < w; ++x) {
+				int r = x * 255 / w;
+				int g = y * 255 / h;
+				int b = static_cast<int>(127.5f + 127.5f * std::sin(x * 0.013f + y * 0.007f));
+				p[x].set(r, g, (b + ((x ^ y) & 15)) & 255, 255);
+			}
+		}
+
+		static const struct {
+			img::dither::type	type;
+			const char*			name;
+		} tbl[] = {
+			{ img::dither::NONE,			"quantize 4K, 256 colors" },
+			{ img::dither::ORDERED,			"quantize 4K, ordered" },
+			{ img::dither::FLOYD_STEINBERG,	"quantize 4K, floyd-steinberg" },
+		};
+		int err = 0;
+		for(const auto& t : tbl) {
+			img::img_idx8 dst;
+			timer tm;
+			bool f = img::quantize_to_idx8(&src, dst, 256, t.type);
+			report(t.name, tm.get_msec(), static_cast<double>(w) * h, "pixels");
+			if(!f) ++err;
+		}
+		return err;
+	}
+}
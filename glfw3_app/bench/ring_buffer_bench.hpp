@@ -0,0 +1,163 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	utils::spsc_ring、mpsc_ring のベンチマーク @n
+			比較の為、mutex と std::deque のキューも計る。@n
+			受け取った値の順番も確かめる。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "bench.hpp"
+#include "utils/ring_buffer.hpp"
+
+namespace bench {
+
+	static const uint32_t ring_size_ = 4096;
+	typedef utils::spsc_ring<uint32_t, ring_size_>	ring_spsc_;
+	typedef utils::mpsc_ring<uint32_t, ring_size_>	ring_mpsc_;
+
+	struct ring_deque_ {
+		std::mutex				mtx_;
+		std::deque<uint32_t>	que_;
+		bool put(uint32_t v) {
+			std::lock_guard<std::mutex> lk(mtx_);
+			if(que_.size() >= ring_size_) return false;
+			que_.push_back(v);
+			return true;
+		}
+		bool get(uint32_t& v) {
+			std::lock_guard<std::mutex> lk(mtx_);
+			if(que_.empty()) return false;
+			v = que_.front();
+			que_.pop_front();
+			return true;
+		}
+	};
+
+
+	// １個ずつ put / get
+	template <class Q>
+	inline bool ring_single_(Q& q, uint32_t num)
+	{
+		std::thread th([&] {
+			for(uint32_t i = 0; i < num; ++i) {
+				while(!q.put(i)) std::this_thread::yield();
+			}
+		});
+		bool ok = true;
+		for(uint32_t i = 0; i < num; ++i) {
+			uint32_t v;
+			while(!q.get(v)) std::this_thread::yield();
+			if(v != i) ok = false;
+		}
+		th.join();
+		return ok;
+	}
+
+
+	// まとめ書き、peek / consume によるコピーしない読み出し
+	inline bool ring_spsc_batch_(ring_spsc_& q, uint32_t num)
+	{
+		std::thread th([&] {
+			uint32_t tmp[256];
+			uint32_t i = 0;
+			while(i < num) {
+				uint32_t n = std::min(num - i, 256u);
+				for(uint32_t j = 0; j < n; ++j) tmp[j] = i + j;
+				uint32_t w = q.write(tmp, n);
+				if(w == 0) std::this_thread::yield();
+				i += w;
+			}
+		});
+		bool ok = true;
+		uint32_t i = 0;
+		while(i < num) {
+			const uint32_t* p;
+			uint32_t n = q.peek(p);
+			if(n == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			for(uint32_t j = 0; j < n; ++j) {
+				if(p[j] != i + j) ok = false;
+			}
+			q.consume(n);
+			i += n;
+		}
+		th.join();
+		return ok;
+	}
+
+
+	// 複数のプロデューサー（上位８ビットに番号、下位に連番）
+	inline bool ring_mpsc_multi_(ring_mpsc_& q, uint32_t producers, uint32_t num)
+	{
+		std::vector<std::thread> ths;
+		for(uint32_t t = 0; t < producers; ++t) {
+			ths.emplace_back([&q, t, num] {
+				for(uint32_t i = 0; i < num; ++i) {
+					while(!q.put((t << 24) | i)) std::this_thread::yield();
+				}
+			});
+		}
+		std::vector<uint32_t> next(producers, 0);
+		bool ok = true;
+		for(uint32_t i = 0; i < producers * num; ++i) {
+			uint32_t v;
+			while(!q.get(v)) std::this_thread::yield();
+			uint32_t t = v >> 24;
+			if(t >= producers || (v & 0xffffff) != next[t]) ok = false;
+			else ++next[t];
+		}
+		for(auto& th : ths) th.join();
+		return ok;
+	}
+
+
+	inline int ring_buffer_bench()
+	{
+		static const uint32_t num = 4000000;
+		static ring_spsc_ spsc;
+		static ring_mpsc_ mpsc;
+		static ring_deque_ deq;
+		int err = 0;
+
+		timer t;
+		bool ok = ring_single_(deq, num);
+		report("mutex deque put/get", t.get_msec(), num, "items");
+		err += check(ok, "mutex deque order");
+
+		spsc.clear();
+		t.reset();
+		ok = ring_single_(spsc, num);
+		report("spsc put/get", t.get_msec(), num, "items");
+		err += check(ok, "spsc order");
+
+		spsc.clear();
+		t.reset();
+		ok = ring_spsc_batch_(spsc, num);
+		report("spsc write/peek", t.get_msec(), num, "items");
+		err += check(ok, "spsc batch order");
+
+		mpsc.clear();
+		t.reset();
+		ok = ring_single_(mpsc, num);
+		report("mpsc put/get (1 producer)", t.get_msec(), num, "items");
+		err += check(ok, "mpsc order");
+
+		static const uint32_t producers = 4;
+		mpsc.clear();
+		t.reset();
+		ok = ring_mpsc_multi_(mpsc, producers, num / producers);
+		report("mpsc put/get (4 producers)", t.get_msec(), num, "items");
+		err += check(ok, "mpsc per-producer order");
+		return err;
+	}
+}
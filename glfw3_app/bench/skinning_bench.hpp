@@ -0,0 +1,218 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	mdf::skinning のテストとベンチマーク @n
+			SSE 版とスカラー版は加算の順序が違うので、許容誤差で比較する。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <random>
+#include "bench.hpp"
+#include "mdf/skinning.hpp"
+
+namespace bench {
+
+	struct skin_model_ {
+		std::vector<vtx::fvtx>		pos_;
+		std::vector<vtx::fvtx>		nor_;
+		std::vector<vtx::fpos>		uv_;
+		std::vector<int32_t>		idx_;
+		std::vector<float>			wgt_;
+		std::vector<uint32_t>		slot_;
+		std::vector<mdf::skin_sdef>	sdef_;
+		std::vector<mtx::fmat4>		mats_;
+
+		mdf::skin_source get() const {
+			mdf::skin_source s;
+			s.position_ = &pos_[0];
+			s.normal_ = &nor_[0];
+			s.uv_ = &uv_[0];
+			s.bone_index_ = &idx_[0];
+			s.bone_weight_ = &wgt_[0];
+			s.sdef_slot_ = &slot_[0];
+			s.sdef_ = sdef_.empty() ? nullptr : &sdef_[0];
+			s.num_ = pos_.size();
+			return s;
+		}
+	};
+
+
+	// 回転と平行移動のマトリックス（列優先）
+	inline mtx::fmat4 skin_random_mat_(std::mt19937& rnd)
+	{
+		std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+		float x = u(rnd), y = u(rnd), z = u(rnd), w = u(rnd);
+		float l = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+		x *= l; y *= l; z *= l; w *= l;
+		float m[16] = {
+			1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f,
+			2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f,
+			2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f,
+			u(rnd) * 5.0f, u(rnd) * 5.0f, u(rnd) * 5.0f, 1.0f
+		};
+		return mtx::fmat4(m);
+	}
+
+
+	inline void skin_make_model_(skin_model_& md, uint32_t num, uint32_t bones, bool sdef)
+	{
+		std::mt19937 rnd(2017);
+		std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+		md.mats_.clear();
+		for(uint32_t i = 0; i < bones; ++i) md.mats_.push_back(skin_random_mat_(rnd));
+		md.pos_.resize(num);
+		md.nor_.resize(num);
+		md.uv_.resize(num);
+		md.idx_.resize(num * 4);
+		md.wgt_.resize(num * 4);
+		md.slot_.assign(num, ~0u);
+		md.sdef_.clear();
+		for(uint32_t i = 0; i < num; ++i) {
+			md.pos_[i].set(u(rnd) * 10.0f, u(rnd) * 10.0f, u(rnd) * 10.0f);
+			vtx::fvtx n(u(rnd), u(rnd), u(rnd) + 2.0f);
+			md.nor_[i] = n * (1.0f / std::sqrt(vtx::dot(n, n)));
+			md.uv_[i].set(u(rnd), u(rnd));
+			// BDEF1、BDEF2、BDEF4 を混ぜる
+			uint32_t k = rnd() % 3;
+			uint32_t cnt = k == 0 ? 1 : (k == 1 ? 2 : 4);
+			float sum = 0.0f;
+			for(uint32_t j = 0; j < 4; ++j) {
+				md.idx_[i * 4 + j] = j < cnt ? static_cast<int32_t>(rnd() % bones) : -1;
+				float w = j < cnt ? (u(rnd) + 1.5f) : 0.0f;
+				md.wgt_[i * 4 + j] = w;
+				sum += w;
+			}
+			for(uint32_t j = 0; j < 4; ++j) md.wgt_[i * 4 + j] /= sum;
+			if(sdef && cnt == 2 && (i % 7) == 0) {
+				mdf::skin_sdef sd;
+				vtx::fvtx c(u(rnd), u(rnd), u(rnd));
+				sd.set(c, c + vtx::fvtx(0.5f, 0.0f, 0.0f), c - vtx::fvtx(0.5f, 0.0f, 0.0f), md.wgt_[i * 4]);
+				md.slot_[i] = md.sdef_.size();
+				md.sdef_.push_back(sd);
+			}
+		}
+	}
+
+
+	inline float skin_max_diff_(const std::vector<mdf::skin_vbo>& a, const std::vector<mdf::skin_vbo>& b)
+	{
+		float d = 0.0f;
+		for(uint32_t i = 0; i < a.size(); ++i) {
+			const float* pa = &a[i].uv.x;
+			const float* pb = &b[i].uv.x;
+			for(int j = 0; j < 8; ++j) {
+				float e = std::fabs(pa[j] - pb[j]) / (1.0f + std::fabs(pb[j]));
+				if(e > d) d = e;
+			}
+		}
+		return d;
+	}
+
+
+	inline int skinning()
+	{
+		int err = 0;
+		skin_model_ md;
+		skin_make_model_(md, 50000, 64, true);
+		mdf::skin_source src = md.get();
+		const mtx::fmat4* mats = &md.mats_[0];
+		uint32_t mn = md.mats_.size();
+
+		std::vector<mdf::skin_vbo> ref(src.num_);
+		mdf::skin_range_scalar(src, mats, mn, &ref[0], 0, src.num_);
+
+		// 倍精度の素朴な計算と比較（LBS 頂点のみ）
+		float dref = 0.0f;
+		for(uint32_t i = 0; i < src.num_; ++i) {
+			if(md.slot_[i] != ~0u) continue;
+			double v[3] = { 0.0, 0.0, 0.0 };
+			for(int k = 0; k < 4; ++k) {
+				int32_t b = md.idx_[i * 4 + k];
+				double w = md.wgt_[i * 4 + k];
+				if(b < 0 || w == 0.0) continue;
+				const float* m = md.mats_[b]();
+				const vtx::fvtx& p = md.pos_[i];
+				for(int j = 0; j < 3; ++j) {
+					v[j] += w * (m[j] * p.x + m[4 + j] * p.y + m[8 + j] * p.z + m[12 + j]);
+				}
+			}
+			const float* o = &ref[i].v.x;
+			for(int j = 0; j < 3; ++j) {
+				float e = std::fabs(o[j] - static_cast<float>(v[j])) / (1.0f + std::fabs(o[j]));
+				if(e > dref) dref = e;
+			}
+		}
+		err += check(dref < 1e-5f, "scalar vs double reference");
+
+#ifdef __SSE__
+		{
+			std::vector<mdf::skin_vbo> out(src.num_);
+			mdf::skin_range_sse(src, mats, mn, &out[0], 0, src.num_);
+			err += check(skin_max_diff_(out, ref) < 1e-5f, "sse vs scalar (tolerance 1e-5)");
+		}
+#endif
+		{
+			std::vector<mdf::skin_vbo> one(src.num_);
+			std::vector<mdf::skin_vbo> out(src.num_);
+			mdf::skinning(src, mats, mn, &one[0], 1);
+			mdf::skinning(src, mats, mn, &out[0]);
+			bool ok = std::equal(&one[0].uv.x, &one[0].uv.x + src.num_ * 8, &out[0].uv.x);
+			err += check(ok, "pooled == single thread");
+		}
+		{
+			// 範囲外のボーンを持つ SDEF 頂点は、LBS と同じ結果になる事
+			skin_model_ bad = md;
+			for(uint32_t i = 0; i < bad.slot_.size(); ++i) {
+				if(bad.slot_[i] != ~0u) bad.idx_[i * 4 + (i & 1)] = 999;
+			}
+			skin_model_ lbs = bad;
+			std::fill(lbs.slot_.begin(), lbs.slot_.end(), ~0u);
+			mdf::skin_source bs = bad.get();
+			mdf::skin_source ls = lbs.get();
+			std::vector<mdf::skin_vbo> a(bs.num_);
+			std::vector<mdf::skin_vbo> b(ls.num_);
+			mdf::skin_range_scalar(bs, &bad.mats_[0], mn, &a[0], 0, bs.num_);
+			mdf::skin_range_scalar(ls, &lbs.mats_[0], mn, &b[0], 0, ls.num_);
+			bool ok = std::equal(&a[0].uv.x, &a[0].uv.x + bs.num_ * 8, &b[0].uv.x);
+			err += check(ok, "SDEF with bad bone index falls back to LBS");
+		}
+		return err;
+	}
+
+
+	inline int skinning_bench()
+	{
+		static const int loop = 20;
+		skin_model_ md;
+		skin_make_model_(md, 100000, 64, false);
+		mdf::skin_source src = md.get();
+		const mtx::fmat4* mats = &md.mats_[0];
+		uint32_t mn = md.mats_.size();
+		std::vector<mdf::skin_vbo> out(src.num_);
+		double verts = static_cast<double>(src.num_) * loop;
+
+		timer t;
+		for(int i = 0; i < loop; ++i) {
+			mdf::skin_range_scalar(src, mats, mn, &out[0], 0, src.num_);
+		}
+		report("skinning 100k/64 scalar", t.get_msec(), verts, "verts");
+#ifdef __SSE__
+		t.reset();
+		for(int i = 0; i < loop; ++i) {
+			mdf::skin_range_sse(src, mats, mn, &out[0], 0, src.num_);
+		}
+		report("skinning 100k/64 sse", t.get_msec(), verts, "verts");
+#endif
+		t.reset();
+		for(int i = 0; i < loop; ++i) {
+			mdf::skinning(src, mats, mn, &out[0]);
+		}
+		char tmp[64];
+		snprintf(tmp, sizeof(tmp), "skinning 100k/64 pool(%u)", utils::task_pool::get_instance().size());
+		report(tmp, t.get_msec(), verts, "verts");
+		return 0;
+	}
+}
@@ -0,0 +1,174 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	sys::sqlite のテストと 2M 行のベンチマーク @n
+			一時オブジェクトの文字列をバインドしても、値が残る事。@n
+			標準の config では、ジャーナル・モードを変えない事。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdio>
+#include "bench.hpp"
+#include "utils/file_io.hpp"
+#include "utils/sqlite.hpp"
+
+namespace bench {
+
+	inline std::string sqlite_text_(uint32_t i)
+	{
+		return "name" + std::to_string(i * 7);
+	}
+
+
+	inline void sqlite_remove_(const std::string& fn)
+	{
+		utils::remove_file(fn);
+		utils::remove_file(fn + "-wal");
+		utils::remove_file(fn + "-shm");
+		utils::remove_file(fn + "-journal");
+	}
+
+
+	inline std::string sqlite_journal_(sys::sqlite& db)
+	{
+		std::string s;
+		sys::sqlite::statement st = db.query("PRAGMA journal_mode");
+		if(st.next()) st.get(0, s);
+		return s;
+	}
+
+
+	inline bool sqlite_insert_(sys::sqlite& db, uint32_t num)
+	{
+		if(!db.command("CREATE TABLE t (id INTEGER PRIMARY KEY, v INTEGER, r REAL, s TEXT)")) return false;
+		sys::sqlite::transaction tr(db);
+		{
+			sys::sqlite::inserter ins(db, "INSERT INTO t (id, v, r, s)", 4);
+			for(uint32_t i = 0; i < num; ++i) {
+				ins.add(i, static_cast<int64_t>(i) * 3 - 1000, i * 0.5, sqlite_text_(i));
+			}
+			if(!ins.flush() || ins.get_count() != num) return false;
+		}
+		return tr.commit();
+	}
+
+
+	inline int sqlite()
+	{
+		static const uint32_t num = 3000;
+		int err = 0;
+		const std::string fn = temp_path("bench_sqlite.db");
+		sqlite_remove_(fn);
+		{
+			sys::sqlite db;
+			bool ok = db.open(fn.c_str());
+			err += check(ok && sqlite_journal_(db) == "delete" && !db.get_config().wal_,
+				"default config keeps journal mode");
+
+			ok = ok && sqlite_insert_(db, num);
+			uint32_t n = 0;
+			{
+				sys::sqlite::statement st = db.query("SELECT id, v, r, s FROM t ORDER BY id");
+				while(ok && st.next()) {
+					uint32_t id = st.get<uint32_t>(0);
+					ok = id == n && st.get<int64_t>(1) == static_cast<int64_t>(n) * 3 - 1000 &&
+						st.get<double>(2) == n * 0.5 && st.get<std::string>(3) == sqlite_text_(n);
+					++n;
+				}
+			}
+			err += check(ok && n == num, "inserter 3000 rows, select");
+
+			// 一時オブジェクトの文字列は、バインドでコピーされる
+			{
+				sys::sqlite::statement st = db.query("SELECT id FROM t WHERE s = ?");
+				st.bind(1, sqlite_text_(1234));
+				ok = st.next() && st.get<uint32_t>(0) == 1234 && !st.next();
+			}
+			ok = ok && db.exec("UPDATE t SET s = ? WHERE id = ?", std::string("tmp"), 5);
+			{
+				sys::sqlite::statement st = db.query("SELECT s FROM t WHERE id = ?");
+				st.bind(1, 5);
+				ok = ok && st.next() && st.get<std::string>(0) == "tmp";
+			}
+			err += check(ok, "bind temporary string");
+
+			// ロールバック
+			{
+				sys::sqlite::transaction tr(db);
+				db.exec("DELETE FROM t");
+			}
+			{
+				sys::sqlite::statement st = db.query("SELECT count(*) FROM t");
+				ok = st.next() && st.get<uint32_t>(0) == num;
+			}
+			err += check(ok, "transaction rollback");
+			db.close();
+		}
+		{
+			sys::sqlite db;
+			bool ok = db.open(fn.c_str(), sys::sqlite::config::fast());
+			err += check(ok && sqlite_journal_(db) == "wal", "config::fast uses WAL");
+			db.close();
+		}
+		sqlite_remove_(fn);
+		return err;
+	}
+
+
+	inline void sqlite_run_(const char* name, const sys::sqlite::config& cfg)
+	{
+		static const uint32_t num = 2000000;
+		static const uint32_t look = 200000;
+		const std::string fn = temp_path("bench_sqlite.db");
+		sqlite_remove_(fn);
+		char tmp[64];
+
+		sys::sqlite db;
+		db.open(fn.c_str(), cfg);
+		timer t;
+		sqlite_insert_(db, num);
+		snprintf(tmp, sizeof(tmp), "sqlite %s insert 2M rows", name);
+		report(tmp, t.get_msec(), num, "rows");
+
+		t.reset();
+		{
+			int64_t sum = 0;
+			std::string s;
+			sys::sqlite::statement st = db.query("SELECT v, s FROM t");
+			while(st.next()) {
+				sum += st.get<int64_t>(0);
+				st.get(1, s);
+				sum += s.size();
+			}
+			keep(sum);
+		}
+		snprintf(tmp, sizeof(tmp), "sqlite %s select 2M rows", name);
+		report(tmp, t.get_msec(), num, "rows");
+
+		t.reset();
+		{
+			int64_t sum = 0;
+			for(uint32_t i = 0; i < look; ++i) {
+				sys::sqlite::statement st = db.query("SELECT v FROM t WHERE id = ?");
+				st.bind(1, (i * 7919) % num);
+				if(st.next()) sum += st.get<int64_t>(0);
+			}
+			keep(sum);
+		}
+		snprintf(tmp, sizeof(tmp), "sqlite %s lookup x200k", name);
+		report(tmp, t.get_msec(), look, "rows");
+		db.close();
+		sqlite_remove_(fn);
+	}
+
+
+	inline int sqlite_bench()
+	{
+		sqlite_run_("default", sys::sqlite::config());
+		sqlite_run_("fast   ", sys::sqlite::config::fast());
+		return 0;
+	}
+}
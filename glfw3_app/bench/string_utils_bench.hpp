@@ -0,0 +1,155 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	utils の文字コード変換のテストとスループット・ベンチマーク @n
+			ASCII の連続と、かな、漢字を混ぜたテキストで計る。@n
+			変換の往復で、元のテキストに戻る事。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <random>
+#include "bench.hpp"
+#include "utils/string_utils.hpp"
+
+namespace bench {
+
+	// ASCII の連続（長さはまちまち）と、SJIS にある全角文字を混ぜる @n
+	// 「~」は SJIS から U+203E に戻るので使わない
+	inline utils::wstring string_utils_text_(uint32_t len, uint32_t ascii_ratio, uint32_t seed)
+	{
+		static const uint16_t kanji[] = {
+			0x65e5, 0x672c, 0x8a9e, 0x6f22, 0x5b57, 0x6587, 0x5316, 0x8ee2, 0x63db, 0x9ad8, 0x901f
+		};
+		std::mt19937 rnd(seed);
+		utils::wstring s;
+		s.reserve(len);
+		while(s.size() < len) {
+			if((rnd() % 100) < ascii_ratio) {
+				uint32_t n = 1 + rnd() % 40;
+				for(uint32_t i = 0; i < n; ++i) s += static_cast<uint16_t>(0x20 + rnd() % 0x5e);
+			} else {
+				uint32_t n = 1 + rnd() % 8;
+				for(uint32_t i = 0; i < n; ++i) {
+					switch(rnd() % 3) {
+					case 0: s += static_cast<uint16_t>(0x3042 + rnd() % 0x50); break;  // ひらがな
+					case 1: s += static_cast<uint16_t>(0x30a2 + rnd() % 0x50); break;  // カタカナ
+					default: s += kanji[rnd() % (sizeof(kanji) / sizeof(kanji[0]))]; break;
+					}
+				}
+			}
+		}
+		s.resize(len);
+		return s;
+	}
+
+
+	inline int string_utils()
+	{
+		int err = 0;
+		bool ok[4] = { true, true, true, true };
+		// 空の入力は「false」を返すので、１文字から
+		for(uint32_t len : { 1, 15, 16, 17, 31, 32, 33, 100, 1000, 10000 }) {
+			for(uint32_t ratio : { 0, 50, 90, 100 }) {
+				utils::wstring w = string_utils_text_(len, ratio, len * 7 + ratio);
+				std::string u8;
+				utils::wstring w2;
+				ok[0] = ok[0] && utils::utf16_to_utf8(w, u8) && utils::utf8_to_utf16(u8, w2) && w2 == w;
+				utils::lstring l;
+				std::string u8b;
+				ok[1] = ok[1] && utils::utf8_to_utf32(u8, l) && l.size() == w.size() &&
+					utils::utf32_to_utf8(l, u8b) && u8b == u8;
+				// 変換の出力は追加なので、空にしてから
+				std::string sj;
+				w2.clear();
+				ok[2] = ok[2] && utils::utf16_to_sjis(w, sj) && utils::sjis_to_utf16(sj, w2) && w2 == w;
+				std::string sj2;
+				u8b.clear();
+				ok[3] = ok[3] && utils::utf8_to_sjis(u8, sj2) && sj2 == sj &&
+					utils::sjis_to_utf8(sj2, u8b) && u8b == u8;
+			}
+		}
+		err += check(ok[0], "utf16 <-> utf8 round trip");
+		err += check(ok[1], "utf8 <-> utf32 round trip");
+		err += check(ok[2], "utf16 <-> sjis round trip");
+		err += check(ok[3], "utf8 <-> sjis round trip");
+
+		// 項目の途中までしか変換出来ない場合、値は変えない
+		{
+			int32_t n = 7;
+			double d = 0.5;
+			float f = 0.25f;
+			bool e = !utils::string_to_int("12abc", n) && !utils::string_to_int("", n) &&
+				!utils::string_to_double("1.5x", d) && !utils::string_to_float("+-1", f);
+			e = e && n == 7 && d == 0.5 && f == 0.25f;
+			e = e && utils::string_to_int("+12", n) && n == 12 && utils::string_to_double("-1.5", d) && d == -1.5;
+			err += check(e, "string_to_int/double keep value on error");
+		}
+		return err;
+	}
+
+
+	inline void string_utils_run_(uint32_t ratio)
+	{
+		static const uint32_t len = 4 * 1024 * 1024;
+		static const int loop = 4;
+		utils::wstring w = string_utils_text_(len, ratio, 1234);
+		std::string u8;
+		utils::utf16_to_utf8(w, u8);
+		std::string sj;
+		utils::utf16_to_sjis(w, sj);
+		double chars = static_cast<double>(len) * loop;
+
+		// 出力は追加なので、毎回空にする（領域は使い回す）
+		char tmp[64];
+		timer t;
+		utils::wstring w2;
+		for(int i = 0; i < loop; ++i) { w2.clear(); utils::utf8_to_utf16(u8, w2); }
+		snprintf(tmp, sizeof(tmp), "ascii %u%%, utf8 -> utf16", ratio);
+		report(tmp, t.get_msec(), chars, "chars");
+
+		t.reset();
+		std::string s;
+		for(int i = 0; i < loop; ++i) { s.clear(); utils::utf16_to_utf8(w, s); }
+		snprintf(tmp, sizeof(tmp), "ascii %u%%, utf16 -> utf8", ratio);
+		report(tmp, t.get_msec(), chars, "chars");
+
+		t.reset();
+		utils::lstring l;
+		for(int i = 0; i < loop; ++i) { l.clear(); utils::utf8_to_utf32(u8, l); }
+		snprintf(tmp, sizeof(tmp), "ascii %u%%, utf8 -> utf32", ratio);
+		report(tmp, t.get_msec(), chars, "chars");
+
+		t.reset();
+		for(int i = 0; i < loop; ++i) { w2.clear(); utils::sjis_to_utf16(sj, w2); }
+		snprintf(tmp, sizeof(tmp), "ascii %u%%, sjis -> utf16", ratio);
+		report(tmp, t.get_msec(), chars, "chars");
+
+		t.reset();
+		for(int i = 0; i < loop; ++i) { s.clear(); utils::utf16_to_sjis(w, s); }
+		snprintf(tmp, sizeof(tmp), "ascii %u%%, utf16 -> sjis", ratio);
+		report(tmp, t.get_msec(), chars, "chars");
+
+		t.reset();
+		for(int i = 0; i < loop; ++i) { s.clear(); utils::utf8_to_sjis(u8, s); }
+		snprintf(tmp, sizeof(tmp), "ascii %u%%, utf8 -> sjis", ratio);
+		report(tmp, t.get_msec(), chars, "chars");
+
+		t.reset();
+		for(int i = 0; i < loop; ++i) { s.clear(); utils::sjis_to_utf8(sj, s); }
+		snprintf(tmp, sizeof(tmp), "ascii %u%%, sjis -> utf8", ratio);
+		report(tmp, t.get_msec(), chars, "chars");
+		keep(s.size() + w2.size() + l.size());
+	}
+
+
+	inline int string_utils_bench()
+	{
+		string_utils_run_(100);
+		string_utils_run_(90);
+		string_utils_run_(0);
+		return 0;
+	}
+}
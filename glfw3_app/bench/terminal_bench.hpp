@@ -0,0 +1,41 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	gl::terminal の puts スループット @n
+			put、scroll は GL を使わないので、コンテキスト無しで計測できる。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include "bench.hpp"
+#include "gl_fw/glterminal.hpp"
+
+namespace bench {
+
+	inline int terminal_puts()
+	{
+		static const int lines = 200000;
+
+		utils::lstring line;
+		for(int i = 0; i < 72; ++i) {
+			line += static_cast<uint32_t>('!' + (i % 90));
+		}
+		line += '\n';
+
+		for(int hist : { 0, 1000, 10000 }) {
+			gl::terminal term;
+			term.set_history_max(hist);
+			term.resize(80, 25);
+			timer t;
+			for(int i = 0; i < lines; ++i) {
+				term.puts(line);
+			}
+			char tmp[64];
+			snprintf(tmp, sizeof(tmp), "puts 80x25, history %d", hist);
+			report(tmp, t.get_msec(), lines, "lines");
+		}
+		return 0;
+	}
+}
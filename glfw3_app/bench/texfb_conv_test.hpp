@@ -0,0 +1,200 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	gl::texfb_conv のテストとベンチマーク @n
+			各変換は、以前の gl::texfb::rendering のピクセル毎の@n
+			ループとバイト単位で一致する事（端数の長さも含める）。@n
+			ベンチマークは、フレーム毎に new する以前の経路と比べる。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <random>
+#include <cstring>
+#include "bench.hpp"
+#include "gl_fw/texfb_conv.hpp"
+
+namespace bench {
+
+	enum class texfb_conv_type_ {
+		gray_rgb,
+		rgba_rgb,
+		bgr_rgb,
+		gray_rgba,
+		rgb_rgba,
+		bgr_rgba,
+	};
+
+
+	inline uint32_t texfb_conv_src_bytes_(texfb_conv_type_ t)
+	{
+		switch(t) {
+		case texfb_conv_type_::gray_rgb:
+		case texfb_conv_type_::gray_rgba:
+			return 1;
+		case texfb_conv_type_::rgba_rgb:
+			return 4;
+		default:
+			return 3;
+		}
+	}
+
+
+	inline uint32_t texfb_conv_dst_bytes_(texfb_conv_type_ t)
+	{
+		switch(t) {
+		case texfb_conv_type_::gray_rgb:
+		case texfb_conv_type_::rgba_rgb:
+		case texfb_conv_type_::bgr_rgb:
+			return 3;
+		default:
+			return 4;
+		}
+	}
+
+
+	// 以前の gl::texfb::rendering と同じピクセル毎のループ
+	inline void texfb_conv_old_(texfb_conv_type_ t, const uint8_t* im, uint8_t* p, uint32_t n, int alpha)
+	{
+		switch(t) {
+		case texfb_conv_type_::gray_rgb:
+			for(uint32_t i = 0; i < n; ++i) {
+				char g = *im++;
+				*p++ = g;
+				*p++ = g;
+				*p++ = g;
+			}
+			break;
+		case texfb_conv_type_::rgba_rgb:
+			for(uint32_t i = 0; i < n; ++i) {
+				*p++ = *im++;
+				*p++ = *im++;
+				*p++ = *im++;
+				im++;
+			}
+			break;
+		case texfb_conv_type_::bgr_rgb:
+			for(uint32_t i = 0; i < n; ++i) {
+				p[2] = *im++;
+				p[1] = *im++;
+				p[0] = *im++;
+				p += 3;
+			}
+			break;
+		case texfb_conv_type_::gray_rgba:
+			for(uint32_t i = 0; i < n; ++i) {
+				char g = *im++;
+				*p++ = g;
+				*p++ = g;
+				*p++ = g;
+				*p++ = alpha;
+			}
+			break;
+		case texfb_conv_type_::rgb_rgba:
+			for(uint32_t i = 0; i < n; ++i) {
+				*p++ = *im++;
+				*p++ = *im++;
+				*p++ = *im++;
+				*p++ = alpha;
+			}
+			break;
+		case texfb_conv_type_::bgr_rgba:
+			for(uint32_t i = 0; i < n; ++i) {
+				p[3] = alpha;
+				p[2] = *im++;
+				p[1] = *im++;
+				p[0] = *im++;
+				p += 4;
+			}
+			break;
+		}
+	}
+
+
+	inline void texfb_conv_new_(texfb_conv_type_ t, const uint8_t* src, uint8_t* dst, uint32_t n, int alpha)
+	{
+		switch(t) {
+		case texfb_conv_type_::gray_rgb:  gl::texfb_conv::gray_to_rgb(src, dst, n); break;
+		case texfb_conv_type_::rgba_rgb:  gl::texfb_conv::rgba_to_rgb(src, dst, n); break;
+		case texfb_conv_type_::bgr_rgb:   gl::texfb_conv::bgr_to_rgb(src, dst, n); break;
+		case texfb_conv_type_::gray_rgba: gl::texfb_conv::gray_to_rgba(src, dst, n, alpha); break;
+		case texfb_conv_type_::rgb_rgba:  gl::texfb_conv::rgb_to_rgba(src, dst, n, alpha); break;
+		case texfb_conv_type_::bgr_rgba:  gl::texfb_conv::bgr_to_rgba(src, dst, n, alpha); break;
+		}
+	}
+
+
+	static const texfb_conv_type_ texfb_conv_types_[] = {
+		texfb_conv_type_::gray_rgb, texfb_conv_type_::rgba_rgb, texfb_conv_type_::bgr_rgb,
+		texfb_conv_type_::gray_rgba, texfb_conv_type_::rgb_rgba, texfb_conv_type_::bgr_rgba,
+	};
+	static const char* texfb_conv_names_[] = {
+		"gray -> rgb", "rgba -> rgb", "bgr -> rgb", "gray -> rgba", "rgb -> rgba", "bgr -> rgba",
+	};
+
+
+	inline int texfb_conv()
+	{
+		std::mt19937 rnd(2017);
+		int err = 0;
+		for(uint32_t k = 0; k < 6; ++k) {
+			texfb_conv_type_ t = texfb_conv_types_[k];
+			uint32_t sb = texfb_conv_src_bytes_(t);
+			uint32_t db = texfb_conv_dst_bytes_(t);
+			bool ok = true;
+			// SIMD の端数と、出力の先に書き込まない事を確かめる
+			for(uint32_t n = 0; n < 200; ++n) {
+				std::vector<uint8_t> src(n * sb);
+				for(uint8_t& c : src) c = rnd();
+				int alpha = rnd() & 255;
+				std::vector<uint8_t> ref(n * db + 16, 0x5a);
+				std::vector<uint8_t> out(n * db + 16, 0x5a);
+				texfb_conv_old_(t, src.data(), ref.data(), n, alpha);
+				texfb_conv_new_(t, src.data(), out.data(), n, alpha);
+				ok = ok && ref == out;
+			}
+			err += check(ok, std::string("texfb_conv ") + texfb_conv_names_[k] + " == per-pixel");
+		}
+		return err;
+	}
+
+
+	inline int texfb_conv_bench()
+	{
+		static const uint32_t w = 1920;
+		static const uint32_t h = 1080;
+		static const uint32_t frames = 100;
+		static const uint32_t n = w * h;
+		std::mt19937 rnd(1234);
+		std::vector<uint8_t> src(n * 4);
+		for(uint8_t& c : src) c = rnd();
+		std::vector<uint8_t> stage(n * 4);
+		char tmp[64];
+		for(uint32_t k = 0; k < 6; ++k) {
+			texfb_conv_type_ t = texfb_conv_types_[k];
+			uint32_t db = texfb_conv_dst_bytes_(t);
+
+			// 以前の経路: フレーム毎に確保して、ピクセル毎に詰める
+			timer tm;
+			for(uint32_t f = 0; f < frames; ++f) {
+				uint8_t* dst = new uint8_t[n * db];
+				texfb_conv_old_(t, src.data(), dst, n, 255);
+				keep(dst[f]);
+				delete[] dst;
+			}
+			snprintf(tmp, sizeof(tmp), "texfb %s per-pixel 1080p", texfb_conv_names_[k]);
+			report(tmp, tm.get_msec(), frames, "frames");
+
+			tm.reset();
+			for(uint32_t f = 0; f < frames; ++f) {
+				texfb_conv_new_(t, src.data(), stage.data(), n, 255);
+				keep(stage[f]);
+			}
+			snprintf(tmp, sizeof(tmp), "texfb %s texfb_conv 1080p", texfb_conv_names_[k]);
+			report(tmp, tm.get_msec(), frames, "frames");
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	utils::tree_arena のテストと 1M ノードのベンチマーク @n
+			比較の為、utils::tree_unit も同じ操作を計る。@n
+			削除されたノードが再利用されても、保持したイテレーターの @n
+			世代で見分けられる事を確かめる。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdio>
+#include "bench.hpp"
+#include "utils/tree_arena.hpp"
+#include "utils/tree_unit.hpp"
+
+namespace bench {
+
+	typedef utils::tree_arena<uint32_t>	tree_arena_;
+	typedef utils::tree_unit<uint32_t>	tree_unit_;
+
+	// /dN/eN/fN の葉を num 個作るパス
+	inline std::string tree_path_(uint32_t i, uint32_t div)
+	{
+		char tmp[64];
+		snprintf(tmp, sizeof(tmp), "/d%u/e%u/f%u", i / (div * div), (i / div) % div, i % div);
+		return tmp;
+	}
+
+
+	inline int tree_arena()
+	{
+		int err = 0;
+		tree_arena_ t;
+		static const uint32_t div = 10;
+		for(uint32_t i = 0; i < div * div * div; ++i) {
+			t.install(tree_path_(i, div), i);
+		}
+		err += check(t.size() == div * div * div + div * div + div, "install 1000 leaves");
+
+		bool ok = true;
+		for(uint32_t i = 0; i < div * div * div; ++i) {
+			auto v = t.get(tree_path_(i, div));
+			if(!v || *v != i) ok = false;
+		}
+		err += check(ok, "get == install");
+
+		// 前順は名前順で、親は子より前
+		{
+			const tree_arena_::unit_map_its& all = t.get_preorder();
+			bool f = all.size() == t.size();
+			for(uint32_t i = 1; i < all.size(); ++i) {
+				const tree_arena_::unit_node* p = all[i]->get_parent();
+				if(p != nullptr && p->get_depth() > 0 &&
+				  std::find(all.begin(), all.begin() + i, p) == all.begin() + i) f = false;
+				if(all[i - 1]->get_depth() >= all[i]->get_depth() && all[i - 1]->first > all[i]->first) f = false;
+			}
+			err += check(f, "preorder sorted, parent first");
+		}
+
+		// 削除したノードが再利用されても、世代が変わる
+		{
+			tree_arena_::unit_map_it it = t.find_it("/d3/e4/f5");
+			uint32_t gen = it->get_gen();
+			t.erase("/d3/e4");
+			bool f = t.find_it("/d3/e4/f5") == nullptr && t.size() == div * div * div + div * div + div - div - 1;
+			t.install("/x/y", 0);
+			f = f && it->get_gen() != gen;
+			err += check(f, "erase, reused node has new generation");
+		}
+		return err;
+	}
+
+
+	inline bool tree_erase_(tree_arena_& t, uint32_t div)
+	{
+		char tmp[32];
+		for(uint32_t i = 0; i < div; ++i) {
+			snprintf(tmp, sizeof(tmp), "/d%u", i);
+			t.erase(tmp);
+		}
+		return true;
+	}
+
+
+	// tree_unit::erase は unit_t に無い keys を参照していて、実体化できないので計らない
+	inline bool tree_erase_(tree_unit_& t, uint32_t div) { return false; }
+
+
+	template <class TREE>
+	inline void tree_bench_(const char* name, uint32_t div)
+	{
+		uint32_t num = div * div * div;
+		std::vector<std::string> paths(num);
+		for(uint32_t i = 0; i < num; ++i) paths[i] = tree_path_(i, div);
+
+		char tmp[64];
+		TREE t;
+		timer tm;
+		for(uint32_t i = 0; i < num; ++i) t.install(paths[i], i);
+		snprintf(tmp, sizeof(tmp), "%s install", name);
+		report(tmp, tm.get_msec(), num, "nodes");
+
+		tm.reset();
+		uint32_t sum = 0;
+		for(uint32_t i = 0; i < num; ++i) {
+			auto v = t.get(paths[i]);
+			if(v) sum += *v;
+		}
+		keep(sum);
+		snprintf(tmp, sizeof(tmp), "%s get", name);
+		report(tmp, tm.get_msec(), num, "nodes");
+
+		tm.reset();
+		typename TREE::unit_map_its list;
+		t.create_list("", list);
+		keep(list.size());
+		snprintf(tmp, sizeof(tmp), "%s list all", name);
+		report(tmp, tm.get_msec(), list.size(), "nodes");
+
+		tm.reset();
+		uint32_t n = 0;
+		for(uint32_t i = 0; i < 1000; ++i) {
+			snprintf(tmp, sizeof(tmp), "/d%u/e%u", i % div, (i / div) % div);
+			t.set_current_path(tmp);  // tree_unit は子の名前をカレントから探す
+			t.create_list(tmp, list);
+			n += list.size();
+		}
+		snprintf(tmp, sizeof(tmp), "%s list dir x1000", name);
+		report(tmp, tm.get_msec(), n, "nodes");
+
+		tm.reset();
+		if(tree_erase_(t, div)) {
+			snprintf(tmp, sizeof(tmp), "%s erase", name);
+			report(tmp, tm.get_msec(), num, "nodes");
+		}
+	}
+
+
+	inline int tree_arena_bench()
+	{
+		tree_bench_<tree_arena_>("tree_arena 1M", 100);
+		tree_bench_<tree_unit_>("tree_unit  1M", 100);
+		return 0;
+	}
+}
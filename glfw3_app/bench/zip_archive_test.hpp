@@ -0,0 +1,249 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	utils::zip_archive のテスト @n
+			メモリー上で小さな zip を作り、無圧縮と deflate のエントリー、@n
+			CRC の不一致、切り詰めたセントラル・ディレクトリー、@n
+			大き過ぎる展開サイズ、file_io のオープン・フックを確かめる。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+#include "bench.hpp"
+#include "utils/file_io.hpp"
+#include "utils/zip_archive.hpp"
+
+namespace bench {
+
+	struct zip_item_ {
+		std::string	name;
+		std::string	data;
+		bool		deflate;
+		uint32_t	crc_xor;	///< CRC を壊す
+		uint32_t	usize;		///< ０以外なら、展開サイズを偽る
+	};
+
+
+	inline void zip_put16_(std::string& s, uint32_t v)
+	{
+		s += static_cast<char>(v); s += static_cast<char>(v >> 8);
+	}
+
+
+	inline void zip_put32_(std::string& s, uint32_t v)
+	{
+		zip_put16_(s, v); zip_put16_(s, v >> 16);
+	}
+
+
+	inline std::string zip_deflate_(const std::string& src)
+	{
+		z_stream zs;
+		std::memset(&zs, 0, sizeof(zs));
+		deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		std::string out(deflateBound(&zs, src.size()), 0);
+		zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(src.data()));
+		zs.avail_in = src.size();
+		zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+		zs.avail_out = out.size();
+		deflate(&zs, Z_FINISH);
+		out.resize(zs.total_out);
+		deflateEnd(&zs);
+		return out;
+	}
+
+
+	// cd_ofs にセントラル・ディレクトリーの位置を返す
+	inline std::string zip_build_(const std::vector<zip_item_>& items, size_t* cd_ofs = nullptr)
+	{
+		std::string zip;
+		std::string cd;
+		for(const zip_item_& it : items) {
+			std::string body = it.deflate ? zip_deflate_(it.data) : it.data;
+			uint32_t crc = crc32(0L, reinterpret_cast<const Bytef*>(it.data.data()), it.data.size());
+			crc ^= it.crc_xor;
+			uint32_t usize = it.usize != 0 ? it.usize : it.data.size();
+			uint32_t method = it.deflate ? Z_DEFLATED : 0;
+			uint32_t ofs = zip.size();
+
+			zip_put32_(zip, 0x04034b50);
+			zip_put16_(zip, 20);
+			zip_put16_(zip, 0);
+			zip_put16_(zip, method);
+			zip_put16_(zip, 0x6000);  // 12:00
+			zip_put16_(zip, 0x4a21);  // 2017/1/1
+			zip_put32_(zip, crc);
+			zip_put32_(zip, body.size());
+			zip_put32_(zip, usize);
+			zip_put16_(zip, it.name.size());
+			zip_put16_(zip, 4);
+			zip += it.name;
+			zip_put32_(zip, 0);  // 拡張フィールド
+			zip += body;
+
+			zip_put32_(cd, 0x02014b50);
+			zip_put16_(cd, 20);
+			zip_put16_(cd, 20);
+			zip_put16_(cd, 0);
+			zip_put16_(cd, method);
+			zip_put16_(cd, 0x6000);
+			zip_put16_(cd, 0x4a21);
+			zip_put32_(cd, crc);
+			zip_put32_(cd, body.size());
+			zip_put32_(cd, usize);
+			zip_put16_(cd, it.name.size());
+			zip_put16_(cd, 0);
+			zip_put16_(cd, 0);
+			zip_put16_(cd, 0);
+			zip_put16_(cd, 0);
+			zip_put32_(cd, 0);
+			zip_put32_(cd, ofs);
+			cd += it.name;
+		}
+		if(cd_ofs != nullptr) *cd_ofs = zip.size();
+		uint32_t ofs = zip.size();
+		zip += cd;
+		zip_put32_(zip, 0x06054b50);
+		zip_put16_(zip, 0);
+		zip_put16_(zip, 0);
+		zip_put16_(zip, items.size());
+		zip_put16_(zip, items.size());
+		zip_put32_(zip, cd.size());
+		zip_put32_(zip, ofs);
+		static const char* comment = "bench comment";
+		zip_put16_(zip, std::strlen(comment));
+		zip += comment;
+		return zip;
+	}
+
+
+	inline bool zip_write_(const std::string& fn, const std::string& s)
+	{
+		utils::file_io fout;
+		if(!fout.open(fn, "wb")) return false;
+		bool ok = fout.write(s.data(), s.size()) == s.size();
+		fout.close();
+		return ok;
+	}
+
+
+	inline bool zip_same_(const utils::zip_archive::span& s, const std::string& ref)
+	{
+		return s.valid() && s.size == ref.size() && std::memcmp(s.data, ref.data(), ref.size()) == 0;
+	}
+
+
+	inline int zip_archive()
+	{
+		int err = 0;
+		const std::string fn = temp_path("bench_zip.zip");
+
+		std::string text = "stored text entry\n";
+		std::string big;
+		for(uint32_t i = 0; i < 200000; ++i) big += static_cast<char>('a' + (i * 7 % 13));
+		std::vector<zip_item_> items = {
+			{ "a.txt", text, false, 0, 0 },
+			{ "dir/", "", false, 0, 0 },
+			{ "dir/b.bin", big, true, 0, 0 },
+			{ "dir/empty.txt", "", true, 0, 0 },
+			{ "crc.bin", big.substr(0, 5000), true, 1, 0 },
+			{ "huge.bin", big.substr(0, 5000), true, 0, 0xffffffff },
+			{ "long.bin", big.substr(0, 5000), true, 0, 5001 },
+			{ "ratio.bin", big, true, 0, 0x10000000 },
+		};
+		std::string zip = zip_build_(items);
+		zip_write_(fn, zip);
+
+		{
+			utils::zip_archive za;
+			bool ok = za.open(fn, 2);
+			ok = ok && za.file_count() == 7 && za.dir_count() == 1 && za.get_dir_name(0) == "dir/";
+			ok = ok && za.is_stored(za.find("a.txt")) && !za.is_stored(za.find("dir/b.bin"));
+			ok = ok && za.get_filesize(za.find("dir/b.bin")) == big.size() && za.find("none") < 0;
+			err += check(ok, "zip open, directory");
+
+			utils::zip_archive::span s = za.get("a.txt");
+			ok = zip_same_(s, text);
+			s = za.get("dir/b.bin");
+			ok = ok && zip_same_(s, big) && za.get_cache_bytes() == big.size();
+			utils::zip_archive::span t = za.get("dir/b.bin");
+			ok = ok && t.data == s.data;
+			s = za.get("dir/empty.txt");
+			ok = ok && s.valid() && s.size == 0;
+			ok = ok && za.get_error_count() == 0;
+			err += check(ok, "zip stored / deflated entries");
+
+			ok = !za.get("crc.bin").valid() && za.get_error_count() == 1;
+			err += check(ok, "zip crc mismatch");
+
+			ok = !za.get("huge.bin").valid() && !za.get("long.bin").valid()
+				&& !za.get("ratio.bin").valid() && za.get_error_count() == 4;
+			err += check(ok, "zip oversized uncompressed size");
+
+			// 先行展開、閉じた後も span は有効
+			za.prefetch(std::vector<std::string>{ "dir/b.bin", "crc.bin", "a.txt" });
+			s = za.get("dir/b.bin");
+			za.close();
+			ok = zip_same_(s, big) && za.file_count() == 0;
+			err += check(ok, "zip prefetch, span after close");
+		}
+
+		// 壊れたセントラル・ディレクトリー
+		{
+			bool ok = true;
+			size_t cd_ofs;
+			std::string z = zip_build_({ { "a.txt", text, false, 0, 0 }, { "b.bin", big, true, 0, 0 } },
+				&cd_ofs);
+			std::string end = z.substr(z.size() - 22 - 13);
+			utils::zip_archive za;
+			// セントラル・ディレクトリーを切り詰め、終端レコードを残す
+			for(size_t n = cd_ofs; n < z.size() - end.size(); ++n) {
+				zip_write_(fn, z.substr(0, n) + end);
+				if(za.open(fn, 1)) ok = false;
+			}
+			// ファイル全体を切り詰める
+			for(size_t n = 0; n < z.size() - 13; n += 7) {
+				zip_write_(fn, z.substr(0, n));
+				if(za.open(fn, 1)) ok = false;
+			}
+			// 数だけ多い
+			std::string t = z;
+			t[z.size() - 13 - 12] = 3;
+			zip_write_(fn, t);
+			ok = ok && !za.open(fn, 1);
+			// ローカル・ヘッダーの位置が範囲外
+			t = z;
+			t[cd_ofs + 42 + 3] = 0x7f;
+			zip_write_(fn, t);
+			ok = ok && za.open(fn, 1) && !za.get("a.txt").valid() && zip_same_(za.get("b.bin"), big);
+			za.close();
+			err += check(ok, "zip truncated central directory");
+		}
+
+		// file_io のオープン・フック
+		{
+			zip_write_(fn, zip);
+			utils::file_io fin;
+			bool ok = fin.open_map(fn + "/dir/b.bin") && fin.get_file_size() == big.size();
+			if(ok) {
+				std::string s(big.size(), 0);
+				ok = fin.read(&s[0], s.size()) == s.size() && s == big;
+				fin.close();
+			}
+			ok = ok && fin.open_map(fn + "/a.txt") && fin.get_file_size() == text.size();
+			fin.close();
+			ok = ok && !utils::zip_archive::open_path(fn + "/dir/none.txt", fin);
+			ok = ok && !utils::zip_archive::open_path(fn + "/crc.bin", fin);
+			utils::zip_archive::clear_path_cache();
+			err += check(ok, "zip open hook");
+		}
+
+		utils::remove_file(fn);
+		return err;
+	}
+}
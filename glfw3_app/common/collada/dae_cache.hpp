@@ -0,0 +1,186 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	collada バイナリ・キャッシュのフォーマット（ヘッダー） @n
+			dae_io が XML の解析結果を保存する、ネイティブ・エンディアンの @n
+			コンテナ。先頭にマジック、バージョン、エンディアン、元ファイルの @n
+			サイズと内容のハッシュ、パスを置き、どれかが違えば古いとみなす。
+	@author	平松邦仁 (hira@rvf-rc45.net)
+*/
+//=====================================================================//
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/foreach.hpp>
+
+namespace collada {
+
+	namespace dae_cache {
+
+		static const char magic[8] = { 'D', 'A', 'E', 'C', 'A', 'C', 'H', 'E' };
+		static const uint32_t version = 2;
+		static const uint32_t endian = 0x01020304;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	キャッシュのキーにする内容のハッシュ（８バイト単位）
+			@param[in]	p	先頭
+			@param[in]	n	バイト数
+			@return ハッシュ
+		*/
+		//-----------------------------------------------------------------//
+		inline uint64_t content_hash(const char* p, size_t n)
+		{
+			static const uint64_t mul = 0xff51afd7ed558ccdULL;
+			uint64_t h = 0x9e3779b97f4a7c15ULL ^ (n * mul);
+			while(n >= 8) {
+				uint64_t v;
+				std::memcpy(&v, p, 8);
+				h = (h ^ v) * mul;
+				h ^= h >> 32;
+				p += 8;
+				n -= 8;
+			}
+			uint64_t v = 0;
+			std::memcpy(&v, p, n);
+			h = (h ^ v) * mul;
+			h ^= h >> 29;
+			return h;
+		}
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	キャッシュ・ライター
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct writer {
+			std::vector<char>	buf_;
+
+			void put(const void* p, size_t n) {
+				const char* s = static_cast<const char*>(p);
+				buf_.insert(buf_.end(), s, s + n);
+			}
+			template <typename T>
+			void put(T v) { put(&v, sizeof(T)); }
+			void put(const std::string& s) {
+				put(static_cast<uint32_t>(s.size()));
+				put(s.data(), s.size());
+			}
+			template <typename T>
+			void put(const std::vector<T>& v) {
+				put(static_cast<uint32_t>(v.size()));
+				if(!v.empty()) put(&v[0], v.size() * sizeof(T));
+			}
+
+			void put(const boost::property_tree::ptree& pt) {
+				put(pt.data());
+				put(static_cast<uint32_t>(pt.size()));
+				BOOST_FOREACH(const boost::property_tree::ptree::value_type& child, pt) {
+					put(child.first);
+					put(child.second);
+				}
+			}
+
+
+			//-----------------------------------------------------------------//
+			/*!
+				@brief	ヘッダーを書き込む
+				@param[in]	size	元ファイルのサイズ
+				@param[in]	hash	元ファイルの内容のハッシュ
+				@param[in]	path	元ファイルのパス
+			*/
+			//-----------------------------------------------------------------//
+			void put_header(uint64_t size, uint64_t hash, const std::string& path) {
+				put(magic, sizeof(magic));
+				put(version);
+				put(endian);
+				put(size);
+				put(hash);
+				put(path);
+			}
+		};
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	キャッシュ・リーダー @n
+					範囲外を読もうとすると ok_ が「false」になり、以降は何もしない
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct reader {
+			const char*	p_;
+			const char*	end_;
+			bool		ok_;
+
+			reader(const char* p, size_t n) : p_(p), end_(p + n), ok_(true) { }
+
+			bool get(void* dst, size_t n) {
+				if(!ok_ || static_cast<size_t>(end_ - p_) < n) {
+					ok_ = false;
+					return false;
+				}
+				std::memcpy(dst, p_, n);
+				p_ += n;
+				return true;
+			}
+			template <typename T>
+			T get() {
+				T v = T();
+				get(&v, sizeof(T));
+				return v;
+			}
+			void get(std::string& s) {
+				uint32_t n = get<uint32_t>();
+				if(!ok_ || static_cast<size_t>(end_ - p_) < n) { ok_ = false; return; }
+				s.assign(p_, n);
+				p_ += n;
+			}
+			template <typename T>
+			void get(std::vector<T>& v) {
+				uint32_t n = get<uint32_t>();
+				if(!ok_ || static_cast<size_t>(end_ - p_) / sizeof(T) < n) { ok_ = false; return; }
+				v.resize(n);
+				if(n) get(&v[0], n * sizeof(T));
+			}
+
+			void get(boost::property_tree::ptree& pt) {
+				get(pt.data());
+				uint32_t n = get<uint32_t>();
+				std::string key;
+				for(uint32_t i = 0; ok_ && i < n; ++i) {
+					get(key);
+					boost::property_tree::ptree& child =
+						pt.push_back(std::make_pair(key, boost::property_tree::ptree()))->second;
+					get(child);
+				}
+			}
+
+
+			//-----------------------------------------------------------------//
+			/*!
+				@brief	ヘッダーを読んで、元ファイルと一致するか調べる
+				@param[in]	size	元ファイルのサイズ
+				@param[in]	hash	元ファイルの内容のハッシュ
+				@param[in]	path	元ファイルのパス
+				@return 壊れているか、古い場合「false」
+			*/
+			//-----------------------------------------------------------------//
+			bool check_header(uint64_t size, uint64_t hash, const std::string& path) {
+				char m[sizeof(magic)];
+				get(m, sizeof(m));
+				if(!ok_ || std::memcmp(m, magic, sizeof(m)) != 0) return false;
+				if(get<uint32_t>() != version) return false;
+				if(get<uint32_t>() != endian) return false;
+				if(get<uint64_t>() != size) return false;
+				if(get<uint64_t>() != hash) return false;
+				std::string s;
+				get(s);
+				return ok_ && s == path;
+			}
+		};
+	}
+}
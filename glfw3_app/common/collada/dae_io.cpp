@@ -5,6 +5,12 @@
 */
 //=====================================================================//
 #include "dae_io.hpp"
+#include "dae_sax.hpp"
+#include "dae_cache.hpp"
+#include "dae_optimize.hpp"
+#include "utils/file_io.hpp"
+#include "utils/string_utils.hpp"
+#include <cstring>
 #include <boost/format.hpp>
 #include <boost/foreach.hpp>
 
@@ -30,57 +36,409 @@ namespace collada {
 	}
 
 
-	void dae_io::parse_geometry_(const ptree::value_type& element, geometry& gt)
-	{
-		const std::string& s = element.first.data();
-		if(s != "geometry") return;
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	ストリーミング・リーダー @n
+				library_geometries 以下は直接 geometry を構築し、@n
+				それ以外の要素は既存パーサー用に ptree を構築する。
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class dae_reader_ {
+
+		ptree&						root_;
+		dae_io::geometries&			geometries_;
+		utils::verbose&				verbose_;
 
-		const ptree& pt = element.second;
-		if(boost::optional<string> id = pt.get_optional<string>("<xmlattr>.id")) {
-			gt.id_ = id.get();
+		std::vector<ptree*>			stack_;
+		std::vector<std::string>	path_;
+
+		// geometry 構築状態
+		uint32_t			geom_level_;
+		dae_io::geometry	geom_;
+		dae_mesh::source	src_;
+		int					src_count_;
+		bool				src_valid_;
+		dae_mesh::vertice	vert_;
+		bool				vert_valid_;
+		dae_mesh::triangle	tri_;
+		bool				tri_valid_;
+		bool				tri_pointer_;
+		bool				array_;
+		bool				pointer_;
+
+		const std::string& parent_(uint32_t n = 1) const {
+			static const std::string none;
+			if(path_.size() <= n) return none;
+			return path_[path_.size() - 1 - n];
 		}
-		if(boost::optional<string> name = pt.get_optional<string>("<xmlattr>.name")) {
-			gt.name_ = name.get();
+
+		static bool to_int_(const std::string* s, int& v) {
+			return s != nullptr && sax::decode_int(s->data(), s->data() + s->size(), v);
 		}
-		if(verbose_()) {
-			verbose_.nest_out();
-			cout << boost::format("id: '%s', name: '%s'") % gt.id_ % gt.name_ << endl;
+
+		bool parse_input_(const sax::attrs& as, dae_mesh::input& inp) {
+			if(const std::string* s = sax::find_attr(as, "semantic")) {
+				inp.semantic_ = dae_mesh::to_semantic(*s);
+				if(inp.semantic_ == dae_mesh::input::semantic::NONE) return false;
+			}
+			if(const std::string* s = sax::find_attr(as, "source")) {
+				inp.source_ = *s;
+			}
+			to_int_(sax::find_attr(as, "offset"), inp.offset_);
+			to_int_(sax::find_attr(as, "set"), inp.set_);
+			return true;
+		}
+
+		void start_geometry_(const std::string& name, const sax::attrs& as) {
+			const std::string& par = parent_();
+			if(name == "geometry" && par == "library_geometries") {
+				geom_ = dae_io::geometry();
+				if(const std::string* s = sax::find_attr(as, "id")) geom_.id_ = *s;
+				if(const std::string* s = sax::find_attr(as, "name")) geom_.name_ = *s;
+				if(verbose_()) {
+					verbose_.nest_out();
+					cout << boost::format("id: '%s', name: '%s'") % geom_.id_ % geom_.name_ << endl;
+				}
+			} else if(name == "source" && par == "mesh") {
+				src_ = dae_mesh::source();
+				src_count_ = 0;
+				src_valid_ = false;
+				if(const std::string* s = sax::find_attr(as, "id")) {
+					src_.id_ = *s;
+					src_valid_ = true;
+				}
+			} else if(name == "float_array" && par == "source") {
+				int n;
+				if(to_int_(sax::find_attr(as, "count"), n) && n > 0) {
+					src_.array_.reserve(n);
+				}
+				array_ = true;
+			} else if(name == "accessor" && par == "technique_common" && parent_(2) == "source") {
+				to_int_(sax::find_attr(as, "count"), src_count_);
+				to_int_(sax::find_attr(as, "stride"), src_.stride_);
+			} else if(name == "vertices" && par == "mesh") {
+				vert_ = dae_mesh::vertice();
+				vert_valid_ = false;
+				if(const std::string* s = sax::find_attr(as, "id")) {
+					vert_.id_ = *s;
+					vert_valid_ = true;
+				}
+			} else if(name == "triangles" && par == "mesh") {
+				tri_ = dae_mesh::triangle();
+				tri_pointer_ = false;
+				int count = 0;
+				const std::string* mate = sax::find_attr(as, "material");
+				tri_valid_ = mate != nullptr && to_int_(sax::find_attr(as, "count"), count);
+				if(mate) tri_.material_ = *mate;
+				if(tri_valid_ && count > 0) tri_.pointer_.reserve(count * 3);
+			} else if(name == "input") {
+				dae_mesh::input inp;
+				if(par == "vertices") {
+					if(parse_input_(as, inp)) vert_.input_ = inp;
+				} else if(par == "triangles") {
+					if(parse_input_(as, inp)) tri_.inputs_.push_back(inp);
+				}
+			} else if(name == "p" && par == "triangles") {
+				tri_pointer_ = true;
+				pointer_ = true;
+			}
+		}
+
+		void end_geometry_(const std::string& name) {
+			const std::string& par = parent_();
+			if(name == "geometry" && par == "library_geometries") {
+				geometries_.push_back(dae_io::geometry());
+				std::swap(geometries_.back(), geom_);
+			} else if(name == "source" && par == "mesh") {
+				if(src_valid_ && src_.stride_ != 0 && src_count_ != 0) {
+					if(verbose_()) {
+						verbose_.nest_out();
+						cout << boost::format("source: '%s', stride: %d") % src_.id_ % src_.stride_;
+						cout << boost::format(", float_array: (%d)") % src_.array_.size() << endl;
+					}
+					geom_.mesh_.at_sourceies().push_back(dae_mesh::source());
+					std::swap(geom_.mesh_.at_sourceies().back(), src_);
+				}
+			} else if(name == "float_array") {
+				array_ = false;
+			} else if(name == "vertices" && par == "mesh") {
+				if(vert_valid_) {
+					geom_.mesh_.at_vertices().push_back(vert_);
+				}
+			} else if(name == "triangles" && par == "mesh") {
+				if(tri_valid_ && tri_pointer_) {
+					if(verbose_()) {
+						verbose_.nest_out();
+						cout << boost::format("triangle: material: '%s', pointer: (%d)")
+							% tri_.material_ % tri_.pointer_.size() << endl;
+					}
+					geom_.mesh_.at_triangles().push_back(dae_mesh::triangle());
+					std::swap(geom_.mesh_.at_triangles().back(), tri_);
+				}
+			} else if(name == "p") {
+				pointer_ = false;
+			}
 		}
-		verbose_.nest_down();
-		BOOST_FOREACH(const ptree::value_type& child, pt) {
-			gt.mesh_.parse(verbose_, child);
+
+	public:
+		bool	error_;
+
+		dae_reader_(ptree& root, dae_io::geometries& geos, utils::verbose& v) :
+			root_(root), geometries_(geos), verbose_(v),
+			geom_level_(0), src_count_(0), src_valid_(false), vert_valid_(false),
+			tri_valid_(false), tri_pointer_(false), array_(false), pointer_(false),
+			error_(false) {
+			stack_.push_back(&root_);
+		}
+
+		void start(const std::string& name, const sax::attrs& as) {
+			path_.push_back(name);
+			if(geom_level_ == 0 && name == "library_geometries" && path_.size() == 2) {
+				geom_level_ = path_.size();
+				if(verbose_()) {
+					cout << name << ":" << endl;
+				}
+				verbose_.nest_down();
+				return;
+			}
+			if(geom_level_) {
+				start_geometry_(name, as);
+				return;
+			}
+
+			ptree& pt = stack_.back()->push_back(std::make_pair(name, ptree()))->second;
+			if(!as.empty()) {
+				ptree& attr = pt.push_back(std::make_pair("<xmlattr>", ptree()))->second;
+				BOOST_FOREACH(const sax::attr& a, as) {
+					attr.push_back(std::make_pair(a.first, ptree(a.second)));
+				}
+			}
+			stack_.push_back(&pt);
+		}
+
+		void end(const std::string& name) {
+			if(geom_level_) {
+				if(geom_level_ == path_.size()) {
+					geom_level_ = 0;
+					verbose_.nest_up();
+				} else {
+					end_geometry_(name);
+				}
+			} else {
+				stack_.pop_back();
+			}
+			path_.pop_back();
+		}
+
+		void text(const char* org, const char* end, bool cdata) {
+			if(geom_level_) {
+				if(array_) {
+					if(!sax::decode_floats(org, end, src_.array_)) error_ = true;
+				} else if(pointer_) {
+					if(!sax::decode_ints(org, end, tri_.pointer_)) error_ = true;
+				}
+				return;
+			}
+			if(cdata) stack_.back()->data().append(org, end);
+			else sax::append_decoded(org, end, stack_.back()->data());
+		}
+	};
+
+
+	// ファイル全体を参照する（マップ出来ない場合は読み込む）
+	static bool read_span_(const std::string& filename, utils::file_io& fin, std::vector<char>& tmp,
+		const char*& top, size_t& size)
+	{
+		if(!utils::probe_file(filename) || !fin.open_map(filename)) return false;
+		size = fin.get_file_size();
+		top = static_cast<const char*>(fin.get_span());
+		if(top != nullptr) return size > 0;
+		tmp.resize(size);
+		if(size == 0 || fin.read(&tmp[0], size) != size) return false;
+		top = &tmp[0];
+		return true;
+	}
+
+
+	static void put_input_(dae_cache::writer& wr, const dae_mesh::input& inp)
+	{
+		wr.put(static_cast<int32_t>(inp.semantic_));
+		wr.put(inp.source_);
+		wr.put(static_cast<int32_t>(inp.offset_));
+		wr.put(static_cast<int32_t>(inp.set_));
+	}
+
+
+	static void get_input_(dae_cache::reader& rd, dae_mesh::input& inp)
+	{
+		inp.semantic_ = static_cast<dae_mesh::input::semantic::type>(rd.get<int32_t>());
+		rd.get(inp.source_);
+		inp.offset_ = rd.get<int32_t>();
+		inp.set_ = rd.get<int32_t>();
+	}
+
+
+	std::string dae_io::cache_name_(const std::string& filename) const
+	{
+		if(cache_dir_.empty()) return filename + ".dcache";
+		// 別のディレクトリーにある同じ名前のファイルは、パスのハッシュで区別する
+		uint64_t h = dae_cache::content_hash(filename.data(), filename.size());
+		std::string name = (boost::format("%s_%016x.dcache") % utils::get_file_name(filename) % h).str();
+		return utils::append_path(cache_dir_, name);
+	}
+
+
+	bool dae_io::parse_xml_(const std::string& filename, const char* org, size_t size)
+	{
+		dae_reader_ reader(pt_, geometries_, verbose_);
+		sax::parser parser;
+		if(!parser.parse(org, org + size, reader) || reader.error_) {
+			if(verbose_()) {
+				cout << boost::format("Collada: parse error: '%s' (%d)") % filename % parser.get_line() << endl;
+			}
+			pt_.clear();
+			geometries_.clear();
+			return false;
 		}
-		verbose_.nest_up();
+		return true;
 	}
 
 
-	void dae_io::parse_geometries_(const ptree::value_type& element)
+	bool dae_io::load_cache_(const std::string& filename, uint64_t size, uint64_t hash)
 	{
-		const std::string& s = element.first.data();
-		if(s != "library_geometries") return;
+		utils::file_io fin;
+		std::vector<char> tmp;
+		const char* top;
+		size_t len;
+		if(!read_span_(cache_name_(filename), fin, tmp, top, len)) return false;
+
+		dae_cache::reader rd(top, len);
+		if(!rd.check_header(size, hash, filename)) return false;
+
+		rd.get(pt_);
+		uint32_t gn = rd.get<uint32_t>();
+		geometries_.resize(gn);
+		BOOST_FOREACH(geometry& g, geometries_) {
+			if(!rd.ok_) break;
+			rd.get(g.id_);
+			rd.get(g.name_);
+			dae_mesh::sourceies& srcs = g.mesh_.at_sourceies();
+			srcs.resize(rd.get<uint32_t>());
+			BOOST_FOREACH(dae_mesh::source& src, srcs) {
+				rd.get(src.id_);
+				src.stride_ = rd.get<int32_t>();
+				rd.get(src.array_);
+			}
+			dae_mesh::vertices& verts = g.mesh_.at_vertices();
+			verts.resize(rd.get<uint32_t>());
+			BOOST_FOREACH(dae_mesh::vertice& vert, verts) {
+				rd.get(vert.id_);
+				get_input_(rd, vert.input_);
+			}
+			dae_mesh::triangles& tris = g.mesh_.at_triangles();
+			tris.resize(rd.get<uint32_t>());
+			BOOST_FOREACH(dae_mesh::triangle& tri, tris) {
+				float m[16];
+				rd.get(m, sizeof(m));
+				tri.matrix_ = m;
+				rd.get(tri.material_);
+				tri.inputs_.resize(rd.get<uint32_t>());
+				BOOST_FOREACH(dae_mesh::input& inp, tri.inputs_) {
+					get_input_(rd, inp);
+				}
+				rd.get(tri.pointer_);
+			}
+		}
+
+		if(!rd.ok_) {
+			pt_.clear();
+			geometries_.clear();
+			return false;
+		}
 		if(verbose_()) {
-			cout << s << ":" << endl;
+			cout << boost::format("Collada: cache: '%s'") % cache_name_(filename) << endl;
 		}
-		verbose_.nest_down();
-		BOOST_FOREACH(const ptree::value_type& child, element.second) {
-			geometry gt;
-			parse_geometry_(child, gt);
-			geometries_.push_back(gt);
+		return true;
+	}
+
+
+	bool dae_io::save_cache_(const std::string& filename, uint64_t size, uint64_t hash) const
+	{
+		dae_cache::writer wr;
+		wr.put_header(size, hash, filename);
+
+		wr.put(pt_);
+		wr.put(static_cast<uint32_t>(geometries_.size()));
+		BOOST_FOREACH(const geometry& g, geometries_) {
+			wr.put(g.id_);
+			wr.put(g.name_);
+			const dae_mesh::sourceies& srcs = g.mesh_.get_sourceies();
+			wr.put(static_cast<uint32_t>(srcs.size()));
+			BOOST_FOREACH(const dae_mesh::source& src, srcs) {
+				wr.put(src.id_);
+				wr.put(static_cast<int32_t>(src.stride_));
+				wr.put(src.array_);
+			}
+			const dae_mesh::vertices& verts = g.mesh_.get_vertices();
+			wr.put(static_cast<uint32_t>(verts.size()));
+			BOOST_FOREACH(const dae_mesh::vertice& vert, verts) {
+				wr.put(vert.id_);
+				put_input_(wr, vert.input_);
+			}
+			const dae_mesh::triangles& tris = g.mesh_.get_triangles();
+			wr.put(static_cast<uint32_t>(tris.size()));
+			BOOST_FOREACH(const dae_mesh::triangle& tri, tris) {
+				wr.put(tri.matrix_(), sizeof(float) * 16);
+				wr.put(tri.material_);
+				wr.put(static_cast<uint32_t>(tri.inputs_.size()));
+				BOOST_FOREACH(const dae_mesh::input& inp, tri.inputs_) {
+					put_input_(wr, inp);
+				}
+				wr.put(tri.pointer_);
+			}
+		}
+
+		// 書き込みに失敗しても、パース自体は成功とする
+		utils::file_io fout;
+		if(!fout.open(cache_name_(filename), "wb")) return false;
+		bool ok = fout.write(&wr.buf_[0], wr.buf_.size()) == wr.buf_.size();
+		fout.close();
+		if(!ok) {
+			utils::remove_file(cache_name_(filename));
 		}
-		verbose_.nest_up();
+		return ok;
 	}
 
 
 	//-----------------------------------------------------------------//
 	/*!
-		@brief	パース
+		@brief	パース @n
+				キャッシュが有効なら、XML を解析せずにキャッシュから読み込む。
 		@param[in]	filename	ファイル名
 		@return 成功なら「true」
 	*/
 	//-----------------------------------------------------------------//
 	bool dae_io::parse(const std::string& filename)
 	{
-		read_xml(filename, pt_);
+		pt_.clear();
+		geometries_.clear();
+
+		utils::file_io fin;
+		std::vector<char> tmp;
+		const char* top;
+		size_t size;
+		if(!read_span_(filename, fin, tmp, top, size)) return false;
+
+		uint64_t hash = 0;
+		bool cached = false;
+		if(cache_enable_) {
+			hash = dae_cache::content_hash(top, size);
+			cached = load_cache_(filename, size, hash);
+		}
+		if(!cached && !parse_xml_(filename, top, size)) {
+			return false;
+		}
+		fin.close();
 
 		// version の確認
 		if(boost::optional<string> ver = pt_.get_optional<string>("COLLADA.<xmlattr>.version")) {
@@ -92,7 +450,7 @@ namespace collada {
 					boost::format("Collada: file: '%s',  version: '%s'") % filename % version_ << endl;
 			}
 
-			// 全エントリーを展開
+			// 全エントリーを展開（geometry は構築済み）
 			int error = 0;
 			BOOST_FOREACH(const ptree::value_type& child, pt_.get_child("COLLADA")) {
 				error += asset_.parse(verbose_, child);
@@ -100,7 +458,6 @@ namespace collada {
 				error += images_.parse(verbose_, child);
 				error += materials_.parse(verbose_, child);
 				error += effects_.parse(verbose_, child);
-				parse_geometries_(child);
 				error += controllers_.parse(verbose_, child);
 				error += visual_scenes_.parse(verbose_, child);
 				error += scene_.parse(verbose_, child);
@@ -109,6 +466,9 @@ namespace collada {
 				}
 			}
 
+			if(!cached && cache_enable_) {
+				save_cache_(filename, size, hash);
+			}
 			return true;
 		} else {
 			return false;
@@ -192,6 +552,14 @@ namespace collada {
 						}						
 					}
 				}
+				if(optimize_enable_) {
+					dae_optimize::report rep = dae_optimize::optimize(tm);
+					if(verbose_() && rep.triangle_num_) {
+						cout << boost::format("Optimize: '%s', triangle: %d, vertex: %d -> %d, ACMR: %4.3f -> %4.3f")
+							% g.id_ % rep.triangle_num_ % rep.source_num_ % rep.vertex_num_
+							% rep.acmr_weld_ % rep.acmr_opt_ << endl;
+					}
+				}
 				tms.push_back(tm);
 			}
 		}
@@ -80,8 +80,11 @@ namespace collada {
 			std::vector<float>	texcoord_;
 			size_t				color_stride_;
 			std::vector<float>	color_;
+			std::vector<uint32_t>	index_;		///< 空の場合は展開済み（インデックス無し）
 			triangle_mesh() : min_(0.0f), max_(0.0f),
-							  vertex_stride_(0), texcoord_stride_(0), color_stride_(0) { matrix_.identity(); }
+							  vertex_stride_(0), normal_stride_(0), texcoord_stride_(0), color_stride_(0) {
+				matrix_.identity();
+			}
 			void list(const std::string& tab = "") const {
 				std::cout << tab << boost::format("vertex: %d, (stride: %d)")
 						% vertex_.size() % vertex_stride_ << std::endl; 
@@ -94,6 +97,8 @@ namespace collada {
 				std::cout << tab << "  " <<
 					boost::format("color: %d, (stride: %d)")
 						% color_.size() % color_stride_ << std::endl; 
+				std::cout << tab << "  " <<
+					boost::format("index: %d") % index_.size() << std::endl;
 			}
 		};
 		typedef std::vector<triangle_mesh>	triangle_meshes;
@@ -116,17 +121,57 @@ namespace collada {
 
 		utils::verbose		verbose_;
 
+		bool				cache_enable_;
+		bool				optimize_enable_;
+		std::string			cache_dir_;
+
 		void setup_material_(const std::string& name, material& mate);
-		void parse_geometry_(const boost::property_tree::ptree::value_type& ele, geometry& gt);
-		void parse_geometries_(const boost::property_tree::ptree::value_type& element);
+		std::string cache_name_(const std::string& filename) const;
+		bool parse_xml_(const std::string& filename, const char* org, size_t size);
+		bool load_cache_(const std::string& filename, uint64_t size, uint64_t hash);
+		bool save_cache_(const std::string& filename, uint64_t size, uint64_t hash) const;
 
 	public:
-		dae_io() { verbose_.set_level(utils::verbose::level::none); }
+		dae_io() : cache_enable_(false), optimize_enable_(true) { verbose_.set_level(utils::verbose::level::none); }
 
 
 		utils::verbose& at_verbose() { return verbose_; }
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	バイナリ・キャッシュの許可（標準は不許可） @n
+					許可すると、パース成功後に「ファイル名.dcache」を作成し、@n
+					次回以降、パス、サイズ、内容のハッシュが一致すれば XML を @n
+					解析せずにキャッシュから読み込む。@n
+					モデルの横に書き込むので、set_cache_dir で場所を決めると良い。
+			@param[in]	ena	不許可なら「false」
+		*/
+		//-----------------------------------------------------------------//
+		void enable_cache(bool ena = true) { cache_enable_ = ena; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	キャッシュを置くディレクトリーを設定 @n
+					空の場合（標準）は、モデルと同じ場所に置く。
+			@param[in]	dir	ディレクトリー
+		*/
+		//-----------------------------------------------------------------//
+		void set_cache_dir(const std::string& dir) { cache_dir_ = dir; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	三角形メッシュ最適化の許可 @n
+					許可すると、create_triangle_mesh で頂点を溶接して @n
+					インデックス化し、頂点キャッシュ向けに並べ替える。
+			@param[in]	ena	不許可なら「false」
+		*/
+		//-----------------------------------------------------------------//
+		void enable_optimize(bool ena = true) { optimize_enable_ = ena; }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	パース
@@ -163,6 +208,7 @@ namespace collada {
 			filename_.clear();
 			version_.clear();
 			pt_.clear();
+			geometries_.clear();
 		}
 
 	};
@@ -14,18 +14,8 @@ namespace collada {
 
 		const ptree& pt = element.second;
 		if(boost::optional<string> opt = pt.get_optional<string>("<xmlattr>.semantic")) {
-			const std::string& s = opt.get();
-			if(s == "POSITION") {
-				inp.semantic_ = input::semantic::POSITION;
-			} else if(s == "VERTEX") {
-				inp.semantic_ = input::semantic::VERTEX;
-			} else if(s == "NORMAL") {
-				inp.semantic_ = input::semantic::NORMAL;
-			} else if(s == "COLOR") {
-				inp.semantic_ = input::semantic::COLOR;
-			} else if(s == "TEXCOORD") {
-				inp.semantic_ = input::semantic::TEXCOORD;
-			} else {
+			inp.semantic_ = to_semantic(opt.get());
+			if(inp.semantic_ == input::semantic::NONE) {
 				++error_;
 				return false;
 			}
@@ -96,9 +96,39 @@ namespace collada {
 		int parse(utils::verbose& v, const boost::property_tree::ptree::value_type& element);
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	セマンティック文字列を変換
+			@param[in]	s	セマンティック文字列
+			@return 不明な場合「semantic::NONE」
+		*/
+		//-----------------------------------------------------------------//
+		static input::semantic::type to_semantic(const std::string& s) {
+			if(s == "POSITION") return input::semantic::POSITION;
+			else if(s == "VERTEX") return input::semantic::VERTEX;
+			else if(s == "NORMAL") return input::semantic::NORMAL;
+			else if(s == "COLOR") return input::semantic::COLOR;
+			else if(s == "TEXCOORD") return input::semantic::TEXCOORD;
+			return input::semantic::NONE;
+		}
+
+
 		const triangles& get_triangles() const { return triangles_; }
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ストリーミング・パーサー、バイナリ・キャッシュからの @n
+					直接構築用アクセス
+		*/
+		//-----------------------------------------------------------------//
+		sourceies& at_sourceies() { return sourceies_; }
+		const sourceies& get_sourceies() const { return sourceies_; }
+		vertices& at_vertices() { return vertices_; }
+		const vertices& get_vertices() const { return vertices_; }
+		triangles& at_triangles() { return triangles_; }
+
+
 		const boost::optional<const source&> get_source(const std::string& id) const {
 			if(!id.empty()) {
 				int ofs = 0;
@@ -0,0 +1,319 @@
+//=====================================================================//
+/*!	@file
+	@brief	collada 三角形メッシュの最適化
+	@author	平松邦仁 (hira@rvf-rc45.net)
+*/
+//=====================================================================//
+#include "dae_optimize.hpp"
+#include <cmath>
+#include <cstring>
+
+namespace collada {
+
+	// Forsyth 法のパラメーター
+	static const uint32_t cache_size_ = 32;
+	static const uint32_t valence_max_ = 64;
+
+	struct score_table_ {
+		float	cache_[cache_size_];
+		float	valence_[valence_max_];
+		score_table_() {
+			for(uint32_t i = 0; i < cache_size_; ++i) {
+				if(i < 3) {
+					// 直前の三角形の頂点は、あえて少し低くする
+					cache_[i] = 0.75f;
+				} else {
+					float t = 1.0f - static_cast<float>(i - 3) / static_cast<float>(cache_size_ - 3);
+					cache_[i] = std::pow(t, 1.5f);
+				}
+			}
+			valence_[0] = 0.0f;
+			for(uint32_t i = 1; i < valence_max_; ++i) {
+				valence_[i] = 2.0f / std::sqrt(static_cast<float>(i));
+			}
+		}
+
+		float get(int32_t pos, uint32_t remain) const {
+			if(remain == 0) return -1.0f;
+			float s = pos >= 0 ? cache_[pos] : 0.0f;
+			return s + valence_[remain < valence_max_ ? remain : valence_max_ - 1];
+		}
+	};
+
+
+	float dae_optimize::acmr(const indices& idx, uint32_t vnum, uint32_t cache)
+	{
+		uint32_t tnum = idx.size() / 3;
+		if(tnum == 0) return 0.0f;
+
+		// 挿入時刻で FIFO を模擬する
+		std::vector<uint32_t> stamp(vnum, 0);
+		uint32_t time = cache + 1;
+		uint32_t miss = 0;
+		for(uint32_t i = 0; i < tnum * 3; ++i) {
+			uint32_t v = idx[i];
+			if(v >= vnum) continue;
+			if(stamp[v] == 0 || (time - stamp[v]) > cache) {
+				stamp[v] = time;
+				++time;
+				++miss;
+			}
+		}
+		return static_cast<float>(miss) / static_cast<float>(tnum);
+	}
+
+
+	void dae_optimize::reorder_triangles(indices& idx, uint32_t vnum)
+	{
+		static const score_table_ table;
+
+		uint32_t tnum = idx.size() / 3;
+		if(tnum < 2) return;
+
+		// 頂点毎の隣接三角形リスト（CSR 形式）
+		std::vector<uint32_t> remain(vnum, 0);
+		for(uint32_t i = 0; i < tnum * 3; ++i) {
+			++remain[idx[i]];
+		}
+		std::vector<uint32_t> offset(vnum + 1, 0);
+		for(uint32_t v = 0; v < vnum; ++v) {
+			offset[v + 1] = offset[v] + remain[v];
+		}
+		std::vector<uint32_t> adj(tnum * 3);
+		{
+			std::vector<uint32_t> fill(offset.begin(), offset.end() - 1);
+			for(uint32_t i = 0; i < tnum * 3; ++i) {
+				adj[fill[idx[i]]++] = i / 3;
+			}
+		}
+
+		std::vector<int32_t> cpos(vnum, -1);
+		std::vector<float> vscore(vnum);
+		for(uint32_t v = 0; v < vnum; ++v) {
+			vscore[v] = table.get(-1, remain[v]);
+		}
+
+		std::vector<float> tscore(tnum);
+		std::vector<uint8_t> emitted(tnum, 0);
+		uint32_t best = 0;
+		float best_score = -1.0f;
+		for(uint32_t t = 0; t < tnum; ++t) {
+			const uint32_t* p = &idx[t * 3];
+			tscore[t] = vscore[p[0]] + vscore[p[1]] + vscore[p[2]];
+			if(tscore[t] > best_score) {
+				best_score = tscore[t];
+				best = t;
+			}
+		}
+
+		uint32_t cache[cache_size_ + 3];
+		uint32_t cnum = 0;
+		uint32_t next[cache_size_ + 3];
+
+		indices out;
+		out.reserve(tnum * 3);
+		uint32_t cursor = 0;
+		for(uint32_t n = 0; n < tnum; ++n) {
+			if(best == ~0u) {
+				// キャッシュ内に候補が無い場合は、未出力の先頭から続ける
+				while(emitted[cursor]) ++cursor;
+				best = cursor;
+			}
+
+			const uint32_t* tri = &idx[best * 3];
+			out.push_back(tri[0]);
+			out.push_back(tri[1]);
+			out.push_back(tri[2]);
+			emitted[best] = 1;
+
+			// 隣接リストの有効範囲から取り除く
+			for(uint32_t k = 0; k < 3; ++k) {
+				uint32_t v = tri[k];
+				uint32_t* a = &adj[offset[v]];
+				uint32_t m = remain[v];
+				for(uint32_t j = 0; j < m; ++j) {
+					if(a[j] == best) {
+						a[j] = a[m - 1];
+						a[m - 1] = best;
+						break;
+					}
+				}
+				--remain[v];
+			}
+
+			// LRU の更新（三角形の頂点を先頭に）
+			uint32_t nnum = 0;
+			for(uint32_t k = 0; k < 3; ++k) {
+				uint32_t v = tri[k];
+				bool dup = false;
+				for(uint32_t j = 0; j < nnum; ++j) {
+					if(next[j] == v) { dup = true; break; }
+				}
+				if(!dup) next[nnum++] = v;
+			}
+			for(uint32_t j = 0; j < cnum; ++j) {
+				uint32_t v = cache[j];
+				if(v != tri[0] && v != tri[1] && v != tri[2]) {
+					next[nnum++] = v;
+				}
+			}
+
+			for(uint32_t j = 0; j < nnum; ++j) {
+				uint32_t v = next[j];
+				cpos[v] = j < cache_size_ ? static_cast<int32_t>(j) : -1;
+				vscore[v] = table.get(cpos[v], remain[v]);
+			}
+
+			// キャッシュ内の頂点に隣接する三角形だけ再評価
+			best = ~0u;
+			best_score = -1.0f;
+			for(uint32_t j = 0; j < nnum; ++j) {
+				uint32_t v = next[j];
+				const uint32_t* a = &adj[offset[v]];
+				for(uint32_t i = 0; i < remain[v]; ++i) {
+					uint32_t t = a[i];
+					const uint32_t* p = &idx[t * 3];
+					float s = vscore[p[0]] + vscore[p[1]] + vscore[p[2]];
+					tscore[t] = s;
+					if(s > best_score) {
+						best_score = s;
+						best = t;
+					}
+				}
+			}
+
+			cnum = nnum < cache_size_ ? nnum : cache_size_;
+			std::memcpy(cache, next, cnum * sizeof(uint32_t));
+		}
+
+		idx.swap(out);
+	}
+
+
+	uint32_t dae_optimize::reorder_vertices(indices& idx, uint32_t vnum, indices& remap)
+	{
+		remap.assign(vnum, ~0u);
+		uint32_t next = 0;
+		for(uint32_t& i : idx) {
+			uint32_t& r = remap[i];
+			if(r == ~0u) r = next++;
+			i = r;
+		}
+		return next;
+	}
+
+
+	namespace {
+
+		uint32_t hash_vertex_(const dae_optimize::stream* ss, uint32_t sn, uint32_t v)
+		{
+			uint32_t h = 2166136261u;
+			for(uint32_t s = 0; s < sn; ++s) {
+				const float* p = &(*ss[s].array_)[v * ss[s].stride_];
+				for(size_t i = 0; i < ss[s].stride_; ++i) {
+					uint32_t bits;
+					std::memcpy(&bits, &p[i], sizeof(bits));
+					h ^= bits;
+					h *= 16777619u;
+					h ^= h >> 15;
+				}
+			}
+			return h;
+		}
+
+		bool equal_vertex_(const dae_optimize::stream* ss, uint32_t sn, uint32_t a, uint32_t b)
+		{
+			for(uint32_t s = 0; s < sn; ++s) {
+				size_t st = ss[s].stride_;
+				const float* pa = &(*ss[s].array_)[a * st];
+				const float* pb = &(*ss[s].array_)[b * st];
+				if(std::memcmp(pa, pb, st * sizeof(float)) != 0) return false;
+			}
+			return true;
+		}
+	}
+
+
+	dae_optimize::report dae_optimize::optimize(stream* src, uint32_t snum, indices& index)
+	{
+		report rep;
+		index.clear();
+		if(snum == 0 || src[0].stride_ == 0) return rep;
+
+		uint32_t n = src[0].array_->size() / src[0].stride_;
+		if(n < 3) return rep;
+
+		// 頂点数が一致するストリームだけを対象にする
+		std::vector<stream> ss;
+		ss.push_back(src[0]);
+		for(uint32_t s = 1; s < snum; ++s) {
+			if(src[s].stride_ && src[s].array_->size() == n * src[s].stride_) {
+				ss.push_back(src[s]);
+			} else {
+				src[s].array_->clear();
+			}
+		}
+		uint32_t sn = ss.size();
+
+		// 溶接（オープン・アドレス法のハッシュ表）
+		uint32_t tsize = 1;
+		while(tsize < n * 2) tsize <<= 1;
+		std::vector<uint32_t> table(tsize, ~0u);
+		indices idx(n);
+		indices unique;
+		unique.reserve(n);
+		for(uint32_t v = 0; v < n; ++v) {
+			uint32_t h = hash_vertex_(&ss[0], sn, v) & (tsize - 1);
+			while(1) {
+				uint32_t e = table[h];
+				if(e == ~0u) {
+					table[h] = v;
+					idx[v] = unique.size();
+					unique.push_back(v);
+					break;
+				}
+				if(equal_vertex_(&ss[0], sn, e, v)) {
+					idx[v] = idx[e];
+					break;
+				}
+				h = (h + 1) & (tsize - 1);
+			}
+		}
+		table.clear();
+		table.shrink_to_fit();
+
+		uint32_t vnum = unique.size();
+		idx.resize((n / 3) * 3);
+		rep.triangle_num_ = idx.size() / 3;
+		rep.source_num_ = n;
+		rep.vertex_num_ = vnum;
+		rep.acmr_weld_ = acmr(idx, vnum);
+		if(vnum == n) {
+			// 共有される頂点が無い場合は展開したままにする
+			rep.acmr_opt_ = rep.acmr_weld_;
+			return rep;
+		}
+
+		reorder_triangles(idx, vnum);
+		indices remap;
+		uint32_t used = reorder_vertices(idx, vnum, remap);
+		rep.acmr_opt_ = acmr(idx, used);
+
+		// 新しい頂点順で各ストリームを詰め直す
+		for(uint32_t s = 0; s < sn; ++s) {
+			size_t st = ss[s].stride_;
+			const std::vector<float>& src = *ss[s].array_;
+			std::vector<float> dst(used * st);
+			for(uint32_t u = 0; u < vnum; ++u) {
+				uint32_t r = remap[u];
+				if(r == ~0u) continue;
+				std::memcpy(&dst[r * st], &src[unique[u] * st], st * sizeof(float));
+			}
+			ss[s].array_->swap(dst);
+		}
+		rep.vertex_num_ = used;
+
+		index.swap(idx);
+		return rep;
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	collada 三角形メッシュの最適化（ヘッダー） @n
+			同一頂点の溶接（インデックス化）、ポストトランスフォーム・ @n
+			キャッシュ向けの三角形並べ替え（Forsyth 法）、頂点フェッチ @n
+			向けの頂点並べ替えを行う。（CPU のみ）
+	@author	平松邦仁 (hira@rvf-rc45.net)
+*/
+//=====================================================================//
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace collada {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	メッシュ最適化クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct dae_optimize {
+
+		typedef std::vector<uint32_t>	indices;
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	頂点ストリーム
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct stream {
+			std::vector<float>*	array_;
+			size_t				stride_;
+		};
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	最適化レポート
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct report {
+			uint32_t	triangle_num_;	///< 三角形数
+			uint32_t	source_num_;	///< 溶接前の頂点数
+			uint32_t	vertex_num_;	///< 溶接後の頂点数
+			float		acmr_weld_;		///< 溶接直後（元の順番）の ACMR
+			float		acmr_opt_;		///< 並べ替え後の ACMR
+			report() : triangle_num_(0), source_num_(0), vertex_num_(0),
+				acmr_weld_(0.0f), acmr_opt_(0.0f) { }
+		};
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ACMR (Average Cache Miss Ratio) を計算 @n
+					FIFO キャッシュを模擬し、三角形あたりの頂点変換数を返す。
+			@param[in]	idx		インデックス列
+			@param[in]	vnum	頂点数
+			@param[in]	cache	キャッシュ・サイズ
+			@return ACMR（0.5 〜 3.0）
+		*/
+		//-----------------------------------------------------------------//
+		static float acmr(const indices& idx, uint32_t vnum, uint32_t cache = 16);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	三角形をポストトランスフォーム・キャッシュ向けに並べ替え @n
+					Tom Forsyth "Linear-Speed Vertex Cache Optimisation" の @n
+					スコア関数（LRU 32 エントリー）を使う。
+			@param[in,out]	idx		インデックス列
+			@param[in]		vnum	頂点数
+		*/
+		//-----------------------------------------------------------------//
+		static void reorder_triangles(indices& idx, uint32_t vnum);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	頂点をフェッチ順に並べ替える為のリマップ表を作成し、@n
+					インデックス列を書き換える
+			@param[in,out]	idx		インデックス列
+			@param[in]		vnum	頂点数
+			@param[out]		remap	旧頂点番号から新頂点番号への表
+			@return 使われている頂点数
+		*/
+		//-----------------------------------------------------------------//
+		static uint32_t reorder_vertices(indices& idx, uint32_t vnum, indices& remap);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	展開済みの頂点ストリームを最適化 @n
+					全ストリームが一致する頂点を溶接してインデックス化し、@n
+					三角形と頂点を並べ替える。先頭は位置で、頂点数が位置と @n
+					合わないストリームは空にする。
+			@param[in,out]	ss		ストリーム列
+			@param[in]		sn		ストリーム数
+			@param[out]		index	インデックス列（共有される頂点が無い場合は空）
+			@return レポート
+		*/
+		//-----------------------------------------------------------------//
+		static report optimize(stream* ss, uint32_t sn, indices& index);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	三角形メッシュを最適化 @n
+					展開済みの頂点（位置、法線、テクスチャ座標、カラー）を @n
+					溶接してインデックス化し、三角形と頂点を並べ替える。@n
+					すでにインデックス化されている場合は何もしない。@n
+					MESH は dae_io::triangle_mesh と同じメンバーを持つ事。
+			@param[in,out]	tm	三角形メッシュ
+			@return レポート
+		*/
+		//-----------------------------------------------------------------//
+		template <class MESH>
+		static report optimize(MESH& tm)
+		{
+			if(!tm.index_.empty()) return report();
+			stream ss[4] = {
+				{ &tm.vertex_, tm.vertex_stride_ },
+				{ &tm.normal_, tm.normal_stride_ },
+				{ &tm.texcoord_, tm.texcoord_stride_ },
+				{ &tm.color_, tm.color_stride_ },
+			};
+			return optimize(ss, 4, tm.index_);
+		}
+	};
+}
@@ -0,0 +1,483 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	collada 用、ストリーミング XML (SAX) パーサー @n
+			dae_io が扱うサブセット（要素、属性、テキスト、CDATA）のみを @n
+			解析し、コメント、処理命令、DOCTYPE は読み飛ばす。@n
+			数値配列は一時文字列を作らずに直接デコードする。
+	@author	平松邦仁 (hira@rvf-rc45.net)
+*/
+//=====================================================================//
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace collada {
+
+	namespace sax {
+
+		typedef std::pair<std::string, std::string>	attr;
+		typedef std::vector<attr>					attrs;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	属性を探す
+			@param[in]	as	属性列
+			@param[in]	key	属性名
+			@return 見つからない場合「nullptr」
+		*/
+		//-----------------------------------------------------------------//
+		inline const std::string* find_attr(const attrs& as, const char* key) {
+			for(const attr& a : as) {
+				if(a.first == key) return &a.second;
+			}
+			return nullptr;
+		}
+
+
+		inline bool is_space_(char ch) {
+			return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+		}
+
+
+		inline bool is_name_end_(char ch) {
+			return is_space_(ch) || ch == '/' || ch == '>' || ch == '=';
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	エンティティ参照をデコードして追加
+			@param[in]	org	開始位置
+			@param[in]	end	終端位置
+			@param[out]	dst	追加先
+		*/
+		//-----------------------------------------------------------------//
+		inline void append_decoded(const char* org, const char* end, std::string& dst) {
+			const char* p = org;
+			while(p < end) {
+				const char* q = static_cast<const char*>(std::memchr(p, '&', end - p));
+				if(q == nullptr) {
+					dst.append(p, end);
+					return;
+				}
+				dst.append(p, q);
+				const char* s = static_cast<const char*>(std::memchr(q, ';', end - q));
+				if(s == nullptr) {
+					dst.append(q, end);
+					return;
+				}
+				size_t len = s - q - 1;
+				const char* e = q + 1;
+				if(len == 2 && std::strncmp(e, "lt", 2) == 0) dst += '<';
+				else if(len == 2 && std::strncmp(e, "gt", 2) == 0) dst += '>';
+				else if(len == 3 && std::strncmp(e, "amp", 3) == 0) dst += '&';
+				else if(len == 4 && std::strncmp(e, "quot", 4) == 0) dst += '"';
+				else if(len == 4 && std::strncmp(e, "apos", 4) == 0) dst += '\'';
+				else if(len >= 2 && e[0] == '#') {
+					uint32_t code = 0;
+					if(e[1] == 'x' || e[1] == 'X') {
+						for(const char* c = e + 2; c < s; ++c) {
+							char ch = *c;
+							code <<= 4;
+							if(ch >= '0' && ch <= '9') code |= ch - '0';
+							else if(ch >= 'a' && ch <= 'f') code |= ch - 'a' + 10;
+							else if(ch >= 'A' && ch <= 'F') code |= ch - 'A' + 10;
+						}
+					} else {
+						for(const char* c = e + 1; c < s; ++c) {
+							code = code * 10 + (*c - '0');
+						}
+					}
+					// UTF-8 へ変換
+					if(code < 0x80) {
+						dst += static_cast<char>(code);
+					} else if(code < 0x800) {
+						dst += static_cast<char>(0xc0 | (code >> 6));
+						dst += static_cast<char>(0x80 | (code & 0x3f));
+					} else if(code < 0x10000) {
+						dst += static_cast<char>(0xe0 | (code >> 12));
+						dst += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+						dst += static_cast<char>(0x80 | (code & 0x3f));
+					} else {
+						dst += static_cast<char>(0xf0 | (code >> 18));
+						dst += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+						dst += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+						dst += static_cast<char>(0x80 | (code & 0x3f));
+					}
+				} else {
+					dst.append(q, s + 1);
+				}
+				p = s + 1;
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	空白で区切られた浮動小数点列をデコードして追加 @n
+					仮数が 2^24 未満、指数が ±10 以内の場合は float の @n
+					演算だけで正確に丸められるので、そのまま計算する。@n
+					それ以外は、スタック上のバッファで strtof に回す（二重丸めしない）。
+			@param[in]	org	開始位置
+			@param[in]	end	終端位置
+			@param[out]	dst	追加先
+			@return 不正な文字があった場合「false」
+		*/
+		//-----------------------------------------------------------------//
+		inline bool decode_floats(const char* org, const char* end, std::vector<float>& dst) {
+			static const float pow10[] = {
+				1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+			};
+			const char* p = org;
+			while(p < end) {
+				while(p < end && is_space_(*p)) ++p;
+				if(p >= end) break;
+
+				const char* top = p;
+				bool neg = false;
+				if(*p == '-') { neg = true; ++p; }
+				else if(*p == '+') ++p;
+
+				uint64_t man = 0;
+				int digits = 0;
+				int exp = 0;
+				bool any = false;
+				while(p < end && *p >= '0' && *p <= '9') {
+					if(digits < 19) {
+						man = man * 10 + (*p - '0');
+						if(man) ++digits;
+					} else {
+						++exp;
+					}
+					any = true;
+					++p;
+				}
+				if(p < end && *p == '.') {
+					++p;
+					while(p < end && *p >= '0' && *p <= '9') {
+						if(digits < 19) {
+							man = man * 10 + (*p - '0');
+							if(man) ++digits;
+							--exp;
+						}
+						any = true;
+						++p;
+					}
+				}
+				if(any && p < end && (*p == 'e' || *p == 'E')) {
+					const char* ep = p + 1;
+					bool eneg = false;
+					if(ep < end && *ep == '-') { eneg = true; ++ep; }
+					else if(ep < end && *ep == '+') ++ep;
+					if(ep < end && *ep >= '0' && *ep <= '9') {
+						int e = 0;
+						while(ep < end && *ep >= '0' && *ep <= '9') {
+							if(e < 10000) e = e * 10 + (*ep - '0');
+							++ep;
+						}
+						exp += eneg ? -e : e;
+						p = ep;
+					}
+				}
+
+				if(!any || (p < end && !is_space_(*p))) {
+					// "inf", "nan" などは strtof に任せる
+					const char* q = top;
+					while(q < end && !is_space_(*q)) ++q;
+					char tmp[64];
+					size_t len = q - top;
+					if(len >= sizeof(tmp)) return false;
+					std::memcpy(tmp, top, len);
+					tmp[len] = 0;
+					char* tail;
+					float v = std::strtof(tmp, &tail);
+					if(tail != &tmp[len]) return false;
+					dst.push_back(v);
+					p = q;
+					continue;
+				}
+
+				float v;
+				if(man < (1u << 24) && exp >= -10 && exp <= 10) {
+					v = static_cast<float>(man);
+					if(exp < 0) v /= pow10[-exp];
+					else v *= pow10[exp];
+				} else if(man == 0) {
+					v = 0.0f;
+				} else {
+					char tmp[64];
+					size_t len = p - top;
+					if(len >= sizeof(tmp)) return false;
+					std::memcpy(tmp, top, len);
+					tmp[len] = 0;
+					v = std::strtof(tmp, nullptr);
+					neg = false;
+				}
+				dst.push_back(neg ? -v : v);
+			}
+			return true;
+		}
+
+
+		// 整数を１つデコード（int の範囲を超える場合は失敗）
+		inline const char* decode_int_(const char* p, const char* end, int& v) {
+			bool neg = false;
+			if(*p == '-') { neg = true; ++p; }
+			else if(*p == '+') ++p;
+			if(p >= end || *p < '0' || *p > '9') return nullptr;
+			// 負数は -2147483648 まで許す
+			const uint32_t lim = neg ? 0x80000000u : 0x7fffffffu;
+			uint32_t a = 0;
+			while(p < end && *p >= '0' && *p <= '9') {
+				uint32_t d = *p - '0';
+				if(a > (lim - d) / 10) return nullptr;
+				a = a * 10 + d;
+				++p;
+			}
+			if(p < end && !is_space_(*p)) return nullptr;
+			v = neg ? static_cast<int>(0u - a) : static_cast<int>(a);
+			return p;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	整数をデコード（前後の空白は許す）
+			@param[in]	org	開始位置
+			@param[in]	end	終端位置
+			@param[out]	v	値（失敗した場合は変更しない）
+			@return 不正な文字、範囲外、２つ以上の値の場合「false」
+		*/
+		//-----------------------------------------------------------------//
+		inline bool decode_int(const char* org, const char* end, int& v) {
+			const char* p = org;
+			while(p < end && is_space_(*p)) ++p;
+			if(p >= end) return false;
+			int t;
+			p = decode_int_(p, end, t);
+			if(p == nullptr) return false;
+			while(p < end && is_space_(*p)) ++p;
+			if(p != end) return false;
+			v = t;
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	空白で区切られた整数列をデコードして追加
+			@param[in]	org	開始位置
+			@param[in]	end	終端位置
+			@param[out]	dst	追加先
+			@return 不正な文字、int の範囲を超える値があった場合「false」
+		*/
+		//-----------------------------------------------------------------//
+		inline bool decode_ints(const char* org, const char* end, std::vector<int>& dst) {
+			const char* p = org;
+			while(p < end) {
+				while(p < end && is_space_(*p)) ++p;
+				if(p >= end) break;
+				int v;
+				p = decode_int_(p, end, v);
+				if(p == nullptr) return false;
+				dst.push_back(v);
+			}
+			return true;
+		}
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	SAX パーサー・クラス @n
+					HANDLER は以下の関数を持つ事 @n
+					void start(const std::string& name, const sax::attrs& as) @n
+					void end(const std::string& name) @n
+					void text(const char* org, const char* end, bool cdata)
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		class parser {
+
+			std::vector<std::string>	stack_;
+			std::string					name_;
+			attrs						attrs_;
+			uint32_t					attr_num_;
+			uint32_t					line_;
+
+			static const char* find_(const char* p, const char* end, const char* key) {
+				size_t n = std::strlen(key);
+				while(p + n <= end) {
+					const char* q = static_cast<const char*>(std::memchr(p, key[0], end - p));
+					if(q == nullptr || q + n > end) return nullptr;
+					if(std::memcmp(q, key, n) == 0) return q;
+					p = q + 1;
+				}
+				return nullptr;
+			}
+
+			void count_lines_(const char* org, const char* end) {
+				for(const char* p = org; p < end; ++p) {
+					if(*p == '\n') ++line_;
+				}
+			}
+
+		public:
+			//-----------------------------------------------------------------//
+			/*!
+				@brief	コンストラクター
+			*/
+			//-----------------------------------------------------------------//
+			parser() : attr_num_(0), line_(1) { }
+
+
+			//-----------------------------------------------------------------//
+			/*!
+				@brief	エラー行を取得（parse が失敗した場合に有効）
+				@return 行番号
+			*/
+			//-----------------------------------------------------------------//
+			uint32_t get_line() const { return line_; }
+
+
+			//-----------------------------------------------------------------//
+			/*!
+				@brief	パース
+				@param[in]	org	先頭
+				@param[in]	end	終端
+				@param[in]	h	ハンドラー
+				@return 成功なら「true」
+			*/
+			//-----------------------------------------------------------------//
+			template <class HANDLER>
+			bool parse(const char* org, const char* end, HANDLER& h)
+			{
+				stack_.clear();
+				line_ = 1;
+
+				// UTF-8 BOM
+				if(end - org >= 3 && std::memcmp(org, "\xef\xbb\xbf", 3) == 0) org += 3;
+
+				const char* p = org;
+				while(p < end) {
+					if(*p != '<') {
+						const char* q = static_cast<const char*>(std::memchr(p, '<', end - p));
+						if(q == nullptr) q = end;
+						const char* s = p;
+						while(s < q && is_space_(*s)) ++s;
+						// 空白のみのテキストは無視する
+						if(s < q && !stack_.empty()) {
+							h.text(p, q, false);
+						}
+						count_lines_(p, q);
+						p = q;
+						continue;
+					}
+
+					const char* t = p + 1;
+					if(t >= end) return false;
+					if(*t == '?') {
+						const char* q = find_(t, end, "?>");
+						if(q == nullptr) return false;
+						count_lines_(p, q);
+						p = q + 2;
+					} else if(*t == '!') {
+						if(end - t >= 3 && t[1] == '-' && t[2] == '-') {
+							const char* q = find_(t + 3, end, "-->");
+							if(q == nullptr) return false;
+							count_lines_(p, q);
+							p = q + 3;
+						} else if(end - t >= 8 && std::memcmp(t, "![CDATA[", 8) == 0) {
+							const char* q = find_(t + 8, end, "]]>");
+							if(q == nullptr) return false;
+							if(!stack_.empty()) h.text(t + 8, q, true);
+							count_lines_(p, q);
+							p = q + 3;
+						} else {
+							// DOCTYPE など、[] の入れ子を考慮して読み飛ばす
+							int nest = 0;
+							const char* q = t;
+							while(q < end) {
+								if(*q == '[') ++nest;
+								else if(*q == ']') --nest;
+								else if(*q == '>' && nest <= 0) break;
+								++q;
+							}
+							if(q >= end) return false;
+							count_lines_(p, q);
+							p = q + 1;
+						}
+					} else if(*t == '/') {
+						++t;
+						const char* n = t;
+						while(t < end && !is_name_end_(*t)) ++t;
+						if(stack_.empty() || stack_.back().size() != static_cast<size_t>(t - n)
+							|| std::memcmp(stack_.back().data(), n, t - n) != 0) {
+							return false;
+						}
+						while(t < end && is_space_(*t)) ++t;
+						if(t >= end || *t != '>') return false;
+						h.end(stack_.back());
+						stack_.pop_back();
+						p = t + 1;
+					} else {
+						const char* n = t;
+						while(t < end && !is_name_end_(*t)) ++t;
+						if(t == n) return false;
+						name_.assign(n, t);
+
+						attr_num_ = 0;
+						bool empty = false;
+						while(1) {
+							while(t < end && is_space_(*t)) {
+								if(*t == '\n') ++line_;
+								++t;
+							}
+							if(t >= end) return false;
+							if(*t == '>') { ++t; break; }
+							if(*t == '/') {
+								if(t + 1 >= end || t[1] != '>') return false;
+								empty = true;
+								t += 2;
+								break;
+							}
+							const char* an = t;
+							while(t < end && !is_name_end_(*t)) ++t;
+							if(t == an) return false;
+							const char* ae = t;
+							while(t < end && is_space_(*t)) ++t;
+							if(t >= end || *t != '=') return false;
+							++t;
+							while(t < end && is_space_(*t)) ++t;
+							if(t >= end || (*t != '"' && *t != '\'')) return false;
+							char quote = *t++;
+							const char* vo = t;
+							const char* ve = static_cast<const char*>(std::memchr(t, quote, end - t));
+							if(ve == nullptr) return false;
+							if(attrs_.size() <= attr_num_) attrs_.emplace_back();
+							attr& a = attrs_[attr_num_];
+							a.first.assign(an, ae);
+							a.second.clear();
+							append_decoded(vo, ve, a.second);
+							++attr_num_;
+							t = ve + 1;
+						}
+						attrs_.resize(attr_num_);
+
+						h.start(name_, attrs_);
+						if(empty) {
+							h.end(name_);
+						} else {
+							stack_.push_back(name_);
+						}
+						p = t;
+					}
+				}
+				return stack_.empty();
+			}
+		};
+	}
+}
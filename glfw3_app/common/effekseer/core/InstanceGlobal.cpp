@@ -4,6 +4,7 @@
 //
 //----------------------------------------------------------------------------------
 #include "InstanceGlobal.h"
+#include <stdlib.h>
 
 //----------------------------------------------------------------------------------
 //
@@ -17,6 +18,7 @@ InstanceGlobal::InstanceGlobal()
 	: m_instanceCount	( 0 )
 	, m_updatedFrame	( 0 )
 	, m_rootContainer	( NULL )
+	, m_randState		( 1 )
 {
 	
 }
@@ -85,6 +87,28 @@ void InstanceGlobal::SetRootContainer( InstanceContainer* container )
 	m_rootContainer = container;
 }
 
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+void InstanceGlobal::SetSeed( uint32_t seed )
+{
+	/* xorshift  0 Ŏ~܂ */
+	m_randState = seed != 0 ? seed : 1;
+}
+
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+int InstanceGlobal::Rand()
+{
+	uint32_t x = m_randState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	m_randState = x;
+	return (int)( (x >> 1) % ((uint32_t)RAND_MAX + 1) );
+}
+
 //----------------------------------------------------------------------------------
 //
 //----------------------------------------------------------------------------------
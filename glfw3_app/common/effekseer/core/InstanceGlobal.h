@@ -34,6 +34,9 @@ private:
 
 	InstanceContainer*	m_rootContainer;
 
+	/* ̏(GtFNgɓƗAXVĂʂςȂ) */
+	uint32_t	m_randState;
+
 	InstanceGlobal();
 
 	virtual ~InstanceGlobal();
@@ -57,6 +60,16 @@ public:
 
 	InstanceContainer* GetRootContainer() const;
 	void SetRootContainer( InstanceContainer* container );
+
+	/**
+		@brief	̎ݒ肷B
+	*/
+	void SetSeed( uint32_t seed );
+
+	/**
+		@brief	擾B(0 ` RAND_MAX)
+	*/
+	int Rand();
 };
 //----------------------------------------------------------------------------------
 //
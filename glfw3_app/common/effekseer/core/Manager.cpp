@@ -32,6 +32,8 @@
 
 #include "ModelLoader.h"
 
+#include <algorithm>
+
 #ifdef _WIN32
 #include <windows.h>
 #else
@@ -66,6 +68,31 @@ static int64_t GetTime(void)
 #endif
 }
 
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+// ݂̃XbhŗĂGtFNg
+static thread_local InstanceGlobal* g_currentGlobal = NULL;
+
+/**
+	@brief	GtFNg؂ւ(XR[v𔲂ƌɖ߂)
+*/
+class RandScope
+{
+	InstanceGlobal*	m_prev;
+public:
+	RandScope( InstanceGlobal* global )
+		: m_prev	( g_currentGlobal )
+	{
+		g_currentGlobal = global;
+	}
+
+	~RandScope()
+	{
+		g_currentGlobal = m_prev;
+	}
+};
+
 //----------------------------------------------------------------------------------
 //
 //----------------------------------------------------------------------------------
@@ -79,21 +106,44 @@ Manager* Manager::Create( int instance_max, bool autoFlip )
 //----------------------------------------------------------------------------------
 Handle ManagerImplemented::AddDrawSet( Effect* effect, InstanceContainer* pInstanceContainer, InstanceGlobal* pGlobalPointer )
 {
-	Handle Temp = m_NextHandle;
-
-	if( ++m_NextHandle < 0 )
+	int32_t index;
+	if( m_freeDrawSetSlots.size() > 0 )
 	{
-		// I[o[t[烊Zbg
-		m_NextHandle = 0;
+		index = m_freeDrawSetSlots.back();
+		m_freeDrawSetSlots.pop_back();
+	}
+	else
+	{
+		index = (int32_t)m_drawSetSlots.size();
+		if( index > DrawSetIndexMask ) return -1;
+		m_drawSetSlots.push_back( DrawSetSlot() );
 	}
-
-	DrawSet drawset( effect, pInstanceContainer, pGlobalPointer );
 
 	ES_SAFE_ADDREF( effect );
 
-	m_DrawSets[Temp] = drawset;
+	DrawSetSlot& slot = m_drawSetSlots[index];
+	slot.Set = DrawSet( effect, pInstanceContainer, pGlobalPointer );
+	slot.Used = true;
+
+	m_drawSetOrder.push_back( index );
 
-	return Temp;
+	return (slot.Generation << DrawSetIndexBits) | index;
+}
+
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+ManagerImplemented::DrawSet* ManagerImplemented::GetDrawSet( Handle handle )
+{
+	if( handle < 0 ) return NULL;
+
+	int32_t index = handle & DrawSetIndexMask;
+	if( index >= (int32_t)m_drawSetSlots.size() ) return NULL;
+
+	DrawSetSlot& slot = m_drawSetSlots[index];
+	if( !slot.Used || slot.Generation != (handle >> DrawSetIndexBits) ) return NULL;
+
+	return &slot.Set;
 }
 
 //----------------------------------------------------------------------------------
@@ -103,10 +153,9 @@ void ManagerImplemented::GCDrawSet( bool isRemovingManager )
 {
 	// CX^XO[v̂̍폜
 	{
-		std::map<Handle,DrawSet>::iterator it = m_RemovingDrawSets[1].begin();
-		while( it != m_RemovingDrawSets[1].end() )
+		for( size_t i = 0; i < m_RemovingDrawSets[1].size(); i++ )
 		{
-			DrawSet& drawset = (*it).second;
+			DrawSet& drawset = m_RemovingDrawSets[1][i];
 
 			// Sj
 			drawset.InstanceContainerPointer->RemoveForcibly( true );
@@ -114,27 +163,19 @@ void ManagerImplemented::GCDrawSet( bool isRemovingManager )
 			InstanceContainer::operator delete( drawset.InstanceContainerPointer, this );
 			ES_SAFE_RELEASE( drawset.ParameterPointer );
 			ES_SAFE_DELETE( drawset.GlobalPointer );
-			m_RemovingDrawSets[1].erase( it++ );
 		}
 		m_RemovingDrawSets[1].clear();
 	}
 
-	{
-		std::map<Handle,DrawSet>::iterator it = m_RemovingDrawSets[0].begin();
-		while( it != m_RemovingDrawSets[0].end() )
-		{
-			DrawSet& drawset = (*it).second;
-			m_RemovingDrawSets[1][ (*it).first ] = (*it).second;
-			m_RemovingDrawSets[0].erase( it++ );
-		}
-		m_RemovingDrawSets[0].clear();
-	}
+	m_RemovingDrawSets[1].swap( m_RemovingDrawSets[0] );
 
 	{
-		std::map<Handle,DrawSet>::iterator it = m_DrawSets.begin();
-		while( it != m_DrawSets.end() )
+		// R[obNōĐꂽԂɒׂ
+		size_t alive = 0;
+		for( size_t i = 0; i < m_drawSetOrder.size(); i++ )
 		{
-			DrawSet& draw_set = (*it).second;
+			int32_t index = m_drawSetOrder[i];
+			DrawSet& draw_set = m_drawSetSlots[index].Set;
 
 			// 폜tOĂ鎞
 			bool isRemoving = draw_set.IsRemoving;
@@ -192,21 +233,29 @@ void ManagerImplemented::GCDrawSet( bool isRemovingManager )
 			if( isRemoving )
 			{
 				// 
-				StopEffect( (*it).first );
+				Handle handle = (m_drawSetSlots[index].Generation << DrawSetIndexBits) | index;
+				StopEffect( handle );
 
-				if( (*it).second.RemovingCallback != NULL )
+				if( draw_set.RemovingCallback != NULL )
 				{
-					(*it).second.RemovingCallback( this, (*it).first, isRemovingManager );
+					draw_set.RemovingCallback( this, handle, isRemovingManager );
 				}
 
-				m_RemovingDrawSets[0][ (*it).first ] = (*it).second;
-				m_DrawSets.erase( it++ );
+				// R[obN̍ĐŃXbgĔzuĂꍇ
+				DrawSetSlot& slot = m_drawSetSlots[index];
+				m_RemovingDrawSets[0].push_back( slot.Set );
+				slot.Set = DrawSet();
+				slot.Used = false;
+				slot.Generation = (slot.Generation + 1) & DrawSetGenerationMask;
+				m_freeDrawSetSlots.push_back( index );
 			}
 			else
 			{
-				++it;
-			}			
+				m_drawSetOrder[alive] = index;
+				alive++;
+			}
 		}
+		m_drawSetOrder.resize( alive );
 	}
 }
 
@@ -261,6 +310,10 @@ void EFK_STDCALL ManagerImplemented::Free( void* p, unsigned int size )
 //----------------------------------------------------------------------------------
 int EFK_STDCALL ManagerImplemented::Rand()
 {
+	if( g_currentGlobal != NULL )
+	{
+		return g_currentGlobal->Rand();
+	}
 	return rand();
 }
 
@@ -269,31 +322,28 @@ int EFK_STDCALL ManagerImplemented::Rand()
 //----------------------------------------------------------------------------------
 void ManagerImplemented::ExecuteEvents()
 {	
-	std::map<Handle,DrawSet>::iterator it = m_DrawSets.begin();
-	std::map<Handle,DrawSet>::iterator it_end = m_DrawSets.end();
-
-	while( it != it_end )
+	for( size_t i = 0; i < m_drawSetOrder.size(); i++ )
 	{
-		if( (*it).second.GoingToStop )
+		DrawSet& drawSet = m_drawSetSlots[m_drawSetOrder[i]].Set;
+
+		if( drawSet.GoingToStop )
 		{
-			InstanceContainer* pContainer = (*it).second.InstanceContainerPointer;
+			InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 			pContainer->KillAllInstances( true );
-			(*it).second.IsRemoving = true;
+			drawSet.IsRemoving = true;
 #ifdef WITH_SOUND
 			if (GetSoundPlayer() != NULL)
 			{
-				GetSoundPlayer()->StopTag((*it).second.GlobalPointer);
+				GetSoundPlayer()->StopTag(drawSet.GlobalPointer);
 			}
 #endif
 		}
 
-		if( (*it).second.GoingToStopRoot )
+		if( drawSet.GoingToStopRoot )
 		{
-			InstanceContainer* pContainer = (*it).second.InstanceContainerPointer;
+			InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 			pContainer->KillAllInstances( false );
 		}
-
-		++it;
 	}
 }
 
@@ -303,8 +353,15 @@ void ManagerImplemented::ExecuteEvents()
 ManagerImplemented::ManagerImplemented( int instance_max, bool autoFlip )
 	: m_reference	( 1 )
 	, m_autoFlip	( autoFlip )
-	, m_NextHandle	( 0 )
+	, m_seed		( 1 )
 	, m_instance_max	( instance_max )
+	, m_parallelUpdating	( false )
+	, m_updateThreadCount	( 1 )
+	, m_updateGeneration	( 0 )
+	, m_updateRunning	( 0 )
+	, m_updateExit		( false )
+	, m_updateCursor	( 0 )
+	, m_updateDeltaFrame	( 0.0f )
 	, m_setting			( NULL )
 	, m_sequenceNumber	( 0 )
 
@@ -348,6 +405,8 @@ ManagerImplemented::ManagerImplemented( int instance_max, bool autoFlip )
 //----------------------------------------------------------------------------------
 ManagerImplemented::~ManagerImplemented()
 {
+	StopUpdateWorkers();
+
 	StopAllEffects();
 
 	ExecuteEvents();
@@ -377,6 +436,14 @@ ManagerImplemented::~ManagerImplemented()
 //----------------------------------------------------------------------------------
 void ManagerImplemented::PushInstance( Instance* instance )
 {
+	if( m_parallelUpdating )
+	{
+		m_instanceSession.Enter();
+		m_reserved_instances.push( instance );
+		m_instanceSession.Leave();
+		return;
+	}
+
 	m_reserved_instances.push( instance );
 }
 
@@ -385,13 +452,22 @@ void ManagerImplemented::PushInstance( Instance* instance )
 //----------------------------------------------------------------------------------
 Instance* ManagerImplemented::PopInstance()
 {
-	if( m_reserved_instances.empty() )
+	if( m_parallelUpdating )
+	{
+		m_instanceSession.Enter();
+	}
+
+	Instance* ret = NULL;
+	if( !m_reserved_instances.empty() )
 	{
-		return NULL;
+		ret = m_reserved_instances.front();
+		m_reserved_instances.pop();
 	}
 
-	Instance* ret = m_reserved_instances.front();
-	m_reserved_instances.pop();
+	if( m_parallelUpdating )
+	{
+		m_instanceSession.Leave();
+	}
 	return ret;
 }
 
@@ -713,11 +789,11 @@ void ManagerImplemented::SetModelLoader( ModelLoader* modelLoader )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::StopEffect( Handle handle )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
-		drawSet.GoingToStop = true;
-		drawSet.IsRemoving = true;
+		drawSet->GoingToStop = true;
+		drawSet->IsRemoving = true;
 	}
 }
 
@@ -726,12 +802,11 @@ void ManagerImplemented::StopEffect( Handle handle )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::StopAllEffects()
 {
-	std::map<Handle,DrawSet>::iterator it = m_DrawSets.begin();
-	while( it != m_DrawSets.end() )
+	for( size_t i = 0; i < m_drawSetOrder.size(); i++ )
 	{
-		(*it).second.GoingToStop = true;
-		(*it).second.IsRemoving = true;
-		++it;		
+		DrawSet& drawSet = m_drawSetSlots[m_drawSetOrder[i]].Set;
+		drawSet.GoingToStop = true;
+		drawSet.IsRemoving = true;
 	}
 }
 
@@ -740,9 +815,10 @@ void ManagerImplemented::StopAllEffects()
 //----------------------------------------------------------------------------------
 void ManagerImplemented::StopRoot( Handle handle )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		m_DrawSets[handle].GoingToStopRoot = true;
+		drawSet->GoingToStopRoot = true;
 	}
 }
 
@@ -751,16 +827,13 @@ void ManagerImplemented::StopRoot( Handle handle )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::StopRoot( Effect* effect )
 {
-	std::map<Handle,DrawSet>::iterator it = m_DrawSets.begin();
-	std::map<Handle,DrawSet>::iterator it_end = m_DrawSets.end();
-
-	while( it != it_end )
+	for( size_t i = 0; i < m_drawSetOrder.size(); i++ )
 	{
-		if( (*it).second.ParameterPointer == effect )
+		DrawSet& drawSet = m_drawSetSlots[m_drawSetOrder[i]].Set;
+		if( drawSet.ParameterPointer == effect )
 		{
-			(*it).second.GoingToStopRoot = true;
+			drawSet.GoingToStopRoot = true;
 		}
-		++it;
 	}
 }
 
@@ -769,9 +842,10 @@ void ManagerImplemented::StopRoot( Effect* effect )
 //----------------------------------------------------------------------------------
 bool ManagerImplemented::Exists( Handle handle )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		if( m_DrawSets[handle].IsRemoving ) return false;
+		if( drawSet->IsRemoving ) return false;
 		return true;
 	}
 	return false;
@@ -782,9 +856,10 @@ bool ManagerImplemented::Exists( Handle handle )
 //----------------------------------------------------------------------------------
 int32_t ManagerImplemented::GetInstanceCount( Handle handle )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		return m_DrawSets[handle].GlobalPointer->GetInstanceCount();
+		return drawSet->GlobalPointer->GetInstanceCount();
 	}
 	return 0;
 }
@@ -794,9 +869,10 @@ int32_t ManagerImplemented::GetInstanceCount( Handle handle )
 //----------------------------------------------------------------------------------
 Matrix43 ManagerImplemented::GetMatrix( Handle handle )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* pDrawSet = GetDrawSet( handle );
+	if( pDrawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
+		DrawSet& drawSet = *pDrawSet;
 
 		InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 		
@@ -822,9 +898,10 @@ Matrix43 ManagerImplemented::GetMatrix( Handle handle )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetMatrix( Handle handle, const Matrix43& mat )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* pDrawSet = GetDrawSet( handle );
+	if( pDrawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
+		DrawSet& drawSet = *pDrawSet;
 
 		InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 		
@@ -850,9 +927,10 @@ Vector3D ManagerImplemented::GetLocation( Handle handle )
 {
 	Vector3D location;
 
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* pDrawSet = GetDrawSet( handle );
+	if( pDrawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
+		DrawSet& drawSet = *pDrawSet;
 
 		InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 		
@@ -871,9 +949,10 @@ Vector3D ManagerImplemented::GetLocation( Handle handle )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetLocation( Handle handle, float x, float y, float z )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* pDrawSet = GetDrawSet( handle );
+	if( pDrawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
+		DrawSet& drawSet = *pDrawSet;
 
 		InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 		
@@ -900,9 +979,10 @@ void ManagerImplemented::SetLocation( Handle handle, const Vector3D& location )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::AddLocation( Handle handle, const Vector3D& location )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* pDrawSet = GetDrawSet( handle );
+	if( pDrawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
+		DrawSet& drawSet = *pDrawSet;
 
 		InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 		
@@ -921,9 +1001,10 @@ void ManagerImplemented::AddLocation( Handle handle, const Vector3D& location )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetRotation( Handle handle, float x, float y, float z )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* pDrawSet = GetDrawSet( handle );
+	if( pDrawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
+		DrawSet& drawSet = *pDrawSet;
 
 		InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 
@@ -960,9 +1041,10 @@ void ManagerImplemented::SetRotation( Handle handle, float x, float y, float z )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetRotation( Handle handle, const Vector3D& axis, float angle )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* pDrawSet = GetDrawSet( handle );
+	if( pDrawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
+		DrawSet& drawSet = *pDrawSet;
 
 		InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 		
@@ -990,9 +1072,10 @@ void ManagerImplemented::SetRotation( Handle handle, const Vector3D& axis, float
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetScale( Handle handle, float x, float y, float z )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* pDrawSet = GetDrawSet( handle );
+	if( pDrawSet != NULL )
 	{
-		DrawSet& drawSet = m_DrawSets[handle];
+		DrawSet& drawSet = *pDrawSet;
 
 		InstanceContainer* pContainer = drawSet.InstanceContainerPointer;
 		
@@ -1022,9 +1105,10 @@ void ManagerImplemented::SetScale( Handle handle, float x, float y, float z )
 //----------------------------------------------------------------------------------
 Matrix43 ManagerImplemented::GetBaseMatrix( Handle handle )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		return m_DrawSets[handle].BaseMatrix;
+		return drawSet->BaseMatrix;
 	}
 
 	return Matrix43();
@@ -1035,10 +1119,11 @@ Matrix43 ManagerImplemented::GetBaseMatrix( Handle handle )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetBaseMatrix( Handle handle, const Matrix43& mat )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		m_DrawSets[handle].BaseMatrix = mat;
-		m_DrawSets[handle].DoUseBaseMatrix = true;
+		drawSet->BaseMatrix = mat;
+		drawSet->DoUseBaseMatrix = true;
 	}
 }
 
@@ -1047,9 +1132,10 @@ void ManagerImplemented::SetBaseMatrix( Handle handle, const Matrix43& mat )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetRemovingCallback( Handle handle, EffectInstanceRemovingCallback callback )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		m_DrawSets[handle].RemovingCallback = callback;
+		drawSet->RemovingCallback = callback;
 	}
 }
 
@@ -1058,9 +1144,10 @@ void ManagerImplemented::SetRemovingCallback( Handle handle, EffectInstanceRemov
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetShown( Handle handle, bool shown )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		m_DrawSets[handle].IsShown = shown;
+		drawSet->IsShown = shown;
 	}
 }
 
@@ -1069,9 +1156,10 @@ void ManagerImplemented::SetShown( Handle handle, bool shown )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetPaused( Handle handle, bool paused )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		m_DrawSets[handle].IsPaused = paused;
+		drawSet->IsPaused = paused;
 	}
 }
 
@@ -1080,9 +1168,10 @@ void ManagerImplemented::SetPaused( Handle handle, bool paused )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetSpeed( Handle handle, float speed )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		m_DrawSets[handle].Speed = speed;
+		drawSet->Speed = speed;
 	}
 }
 
@@ -1091,9 +1180,10 @@ void ManagerImplemented::SetSpeed( Handle handle, float speed )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::SetAutoDrawing( Handle handle, bool autoDraw )
 {
-	if( m_DrawSets.count( handle ) > 0 )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		m_DrawSets[handle].IsAutoDrawing = autoDraw;
+		drawSet->IsAutoDrawing = autoDraw;
 	}
 }
 
@@ -1115,13 +1205,9 @@ void ManagerImplemented::Flip()
 	m_renderingDrawSets.clear();
 
 	{
-		std::map<Handle,DrawSet>::iterator it = m_DrawSets.begin();
-		std::map<Handle,DrawSet>::iterator it_end = m_DrawSets.end();
-		
-		while( it != it_end )
+		for( size_t i = 0; i < m_drawSetOrder.size(); i++ )
 		{
-			m_renderingDrawSets.push_back( (*it).second );
-			++it;
+			m_renderingDrawSets.push_back( m_drawSetSlots[m_drawSetOrder[i]].Set );
 		}
 	}
 
@@ -1141,11 +1227,50 @@ void ManagerImplemented::Update( float deltaFrame )
 	// JnԂL^
 	int64_t beginTime = ::Effekseer::GetTime();
 
-	for( size_t i = 0; i < m_renderingDrawSets.size(); i++ )
+	// ֐ւĂꍇ́AĂяoۂߕ񉻂Ȃ
+	if( m_updateWorkers.size() > 0 && m_renderingDrawSets.size() > 1 && m_randFunc == Rand )
 	{
-		DrawSet& drawSet = m_renderingDrawSets[i];
+		// CX^X̑GtFNg犄蓖Ă
+		m_updateJobs.resize( m_renderingDrawSets.size() );
+		for( size_t i = 0; i < m_updateJobs.size(); i++ )
+		{
+			m_updateJobs[i] = (int32_t)i;
+		}
+
+		std::vector<DrawSet>& drawSets = m_renderingDrawSets;
+		std::stable_sort( m_updateJobs.begin(), m_updateJobs.end(),
+			[&drawSets]( int32_t a, int32_t b ) {
+				return drawSets[a].GlobalPointer->GetInstanceCount() > drawSets[b].GlobalPointer->GetInstanceCount();
+			} );
+
+		m_updateDeltaFrame = deltaFrame;
+		m_updateCursor = 0;
+		m_parallelUpdating = true;
+
+		{
+			std::lock_guard<std::mutex> lock( m_updateMutex );
+			m_updateRunning = (int32_t)m_updateWorkers.size();
+			m_updateGeneration++;
+		}
+		m_updateStart.notify_all();
+
+		ExecuteUpdateJobs();
+
+		{
+			std::unique_lock<std::mutex> lock( m_updateMutex );
+			m_updateDone.wait( lock, [this] { return m_updateRunning == 0; } );
+		}
+
+		m_parallelUpdating = false;
+	}
+	else
+	{
+		for( size_t i = 0; i < m_renderingDrawSets.size(); i++ )
+		{
+			DrawSet& drawSet = m_renderingDrawSets[i];
 		
-		UpdateHandle( drawSet, deltaFrame );
+			UpdateHandle( drawSet, deltaFrame );
+		}
 	}
 
 	// oߎԂvZ
@@ -1154,6 +1279,93 @@ void ManagerImplemented::Update( float deltaFrame )
 	EndUpdate();
 }
 
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+void ManagerImplemented::ExecuteUpdateJobs()
+{
+	int32_t count = (int32_t)m_updateJobs.size();
+	while( true )
+	{
+		int32_t i = m_updateCursor.fetch_add( 1 );
+		if( i >= count ) break;
+
+		UpdateHandle( m_renderingDrawSets[m_updateJobs[i]], m_updateDeltaFrame );
+	}
+}
+
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+void ManagerImplemented::UpdateWorker()
+{
+	uint32_t generation = 0;
+	while( true )
+	{
+		{
+			std::unique_lock<std::mutex> lock( m_updateMutex );
+			m_updateStart.wait( lock, [this, generation] { return m_updateExit || m_updateGeneration != generation; } );
+			if( m_updateExit ) return;
+			generation = m_updateGeneration;
+		}
+
+		ExecuteUpdateJobs();
+
+		{
+			std::lock_guard<std::mutex> lock( m_updateMutex );
+			m_updateRunning--;
+		}
+		m_updateDone.notify_one();
+	}
+}
+
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+void ManagerImplemented::StartUpdateWorkers( int32_t count )
+{
+	m_updateExit = false;
+	for( int32_t i = 1; i < count; i++ )
+	{
+		m_updateWorkers.push_back( std::thread( &ManagerImplemented::UpdateWorker, this ) );
+	}
+}
+
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+void ManagerImplemented::StopUpdateWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_updateMutex );
+		m_updateExit = true;
+	}
+	m_updateStart.notify_all();
+
+	for( size_t i = 0; i < m_updateWorkers.size(); i++ )
+	{
+		m_updateWorkers[i].join();
+	}
+	m_updateWorkers.clear();
+}
+
+//----------------------------------------------------------------------------------
+//
+//----------------------------------------------------------------------------------
+void ManagerImplemented::SetUpdateThreadCount( int32_t count )
+{
+	if( count < 1 ) count = 1;
+	if( count == m_updateThreadCount ) return;
+
+	m_renderingSession.Enter();
+
+	StopUpdateWorkers();
+	m_updateThreadCount = count;
+	StartUpdateWorkers( count );
+
+	m_renderingSession.Leave();
+}
+
 //----------------------------------------------------------------------------------
 //
 //----------------------------------------------------------------------------------
@@ -1182,12 +1394,10 @@ void ManagerImplemented::EndUpdate()
 //----------------------------------------------------------------------------------
 void ManagerImplemented::UpdateHandle( Handle handle, float deltaFrame )
 {
-	std::map<Handle,DrawSet>::iterator it = m_DrawSets.find( handle );
-	if( it != m_DrawSets.end() )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		DrawSet& drawSet = it->second;
-
-		UpdateHandle( drawSet, deltaFrame );
+		UpdateHandle( *drawSet, deltaFrame );
 	}
 }
 
@@ -1198,6 +1408,8 @@ void ManagerImplemented::UpdateHandle( DrawSet& drawSet, float deltaFrame )
 {
 	if( !drawSet.IsPaused )
 	{
+		RandScope scope( drawSet.GlobalPointer );
+
 		float df = deltaFrame * drawSet.Speed;
 
 		drawSet.InstanceContainerPointer->Update( true, df, drawSet.IsShown );
@@ -1246,6 +1458,12 @@ Handle ManagerImplemented::Play( Effect* effect, float x, float y, float z )
 	
 	// [g
 	InstanceGlobal* pGlobal = new InstanceGlobal();
+
+	// ͍̎ĐɌ܂̂ŁAXṼXbhɈ˂Ȃ
+	m_seed = m_seed * 1664525 + 1013904223;
+	pGlobal->SetSeed( m_seed );
+
+	RandScope scope( pGlobal );
 	InstanceContainer* pContainer = CreateInstanceContainer( ((EffectImplemented*)effect)->GetRoot(), pGlobal, true, NULL );
 	
 	pGlobal->SetRootContainer(  pContainer );
@@ -1257,8 +1475,16 @@ Handle ManagerImplemented::Play( Effect* effect, float x, float y, float z )
 	pInstance->m_GlobalMatrix43.Value[3][2] = z;
 
 	Handle handle = AddDrawSet( effect, pContainer, pGlobal );
+	if( handle < 0 )
+	{
+		pContainer->RemoveForcibly( true );
+		pContainer->~InstanceContainer();
+		InstanceContainer::operator delete( pContainer, this );
+		ES_SAFE_DELETE( pGlobal );
+		return -1;
+	}
 
-	m_DrawSets[handle].GlobalMatrix = pInstance->m_GlobalMatrix43;
+	GetDrawSet( handle )->GlobalMatrix = pInstance->m_GlobalMatrix43;
 
 	return handle;
 }
@@ -1270,14 +1496,12 @@ void ManagerImplemented::DrawHandle( Handle handle )
 {
 	m_renderingSession.Enter();
 	
-	std::map<Handle,DrawSet>::iterator it = m_DrawSets.find( handle );
-	if( it != m_DrawSets.end() )
+	DrawSet* drawSet = GetDrawSet( handle );
+	if( drawSet != NULL )
 	{
-		DrawSet& drawSet = it->second;
-
-		if( drawSet.IsShown )
+		if( drawSet->IsShown )
 		{
-			drawSet.InstanceContainerPointer->Draw( true );
+			drawSet->InstanceContainerPointer->Draw( true );
 		}
 	}
 
@@ -1291,18 +1515,16 @@ void ManagerImplemented::BeginReloadEffect( Effect* effect )
 {
 	m_renderingSession.Enter();
 
-	std::map<Handle,DrawSet>::iterator it = m_DrawSets.begin();
-	std::map<Handle,DrawSet>::iterator it_end = m_DrawSets.end();
-
-	for(; it != it_end; ++it )
+	for( size_t i = 0; i < m_drawSetOrder.size(); i++ )
 	{
-		if( (*it).second.ParameterPointer != effect ) continue;
+		DrawSet& drawSet = m_drawSetSlots[m_drawSetOrder[i]].Set;
+		if( drawSet.ParameterPointer != effect ) continue;
 	
 		/* CX^X폜 */
-		(*it).second.InstanceContainerPointer->RemoveForcibly( true );
-		(*it).second.InstanceContainerPointer->~InstanceContainer();
-		InstanceContainer::operator delete( (*it).second.InstanceContainerPointer, this );
-		(*it).second.InstanceContainerPointer = NULL;
+		drawSet.InstanceContainerPointer->RemoveForcibly( true );
+		drawSet.InstanceContainerPointer->~InstanceContainer();
+		InstanceContainer::operator delete( drawSet.InstanceContainerPointer, this );
+		drawSet.InstanceContainerPointer = NULL;
 
 
 	}
@@ -1313,28 +1535,28 @@ void ManagerImplemented::BeginReloadEffect( Effect* effect )
 //----------------------------------------------------------------------------------
 void ManagerImplemented::EndReloadEffect( Effect* effect )
 {
-	std::map<Handle,DrawSet>::iterator it = m_DrawSets.begin();
-	std::map<Handle,DrawSet>::iterator it_end = m_DrawSets.end();
-
-	for(; it != it_end; ++it )
+	for( size_t i = 0; i < m_drawSetOrder.size(); i++ )
 	{
-		if( (*it).second.ParameterPointer != effect ) continue;
+		DrawSet& drawSet = m_drawSetSlots[m_drawSetOrder[i]].Set;
+		if( drawSet.ParameterPointer != effect ) continue;
+
+		RandScope scope( drawSet.GlobalPointer );
 
 		/* CX^X */
-		(*it).second.InstanceContainerPointer = CreateInstanceContainer( ((EffectImplemented*)effect)->GetRoot(), (*it).second.GlobalPointer, true, NULL );
-		(*it).second.GlobalPointer->SetRootContainer(  (*it).second.InstanceContainerPointer );
+		drawSet.InstanceContainerPointer = CreateInstanceContainer( ((EffectImplemented*)effect)->GetRoot(), drawSet.GlobalPointer, true, NULL );
+		drawSet.GlobalPointer->SetRootContainer(  drawSet.InstanceContainerPointer );
 
 		/* sݒ */
-		(*it).second.InstanceContainerPointer->GetFirstGroup()->GetFirst()->m_GlobalMatrix43 = 
-			(*it).second.GlobalMatrix;
+		drawSet.InstanceContainerPointer->GetFirstGroup()->GetFirst()->m_GlobalMatrix43 = 
+			drawSet.GlobalMatrix;
 		
 		/* XLbv */
-		for( float f = 0; f < (*it).second.GlobalPointer->GetUpdatedFrame() - 1; f+= 1.0f )
+		for( float f = 0; f < drawSet.GlobalPointer->GetUpdatedFrame() - 1; f+= 1.0f )
 		{
-			(*it).second.InstanceContainerPointer->Update( true, 1.0f, false );
+			drawSet.InstanceContainerPointer->Update( true, 1.0f, false );
 		}
 
-		(*it).second.InstanceContainerPointer->Update( true, 1.0f, (*it).second.IsShown );
+		drawSet.InstanceContainerPointer->Update( true, 1.0f, drawSet.IsShown );
 	}
 
 	m_renderingSession.Leave();
@@ -430,6 +430,22 @@ public:
 		@brief	c̊mۂCX^X擾B
 	*/
 	virtual int32_t GetRestInstancesCount() const = 0;
+
+	/**
+		@brief	UpdateɎgXbhݒ肷B
+		@param	count	[in]	Xbh(1ȉȂXbhgȂ)
+		@note
+		Đ̃GtFNgPʂŕSčXVB
+		̓GtFNgɓƗĂ̂ŁAʂ̓XbhɈ˂ȂB
+		(CX^X̊mېȂȂꍇ)
+		SetRandFuncŗ֐ւꍇ́AXbhgȂB
+	*/
+	virtual void SetUpdateThreadCount( int32_t count ) = 0;
+
+	/**
+		@brief	UpdateɎgXbh擾B
+	*/
+	virtual int32_t GetUpdateThreadCount() const = 0;
 };
 //----------------------------------------------------------------------------------
 //
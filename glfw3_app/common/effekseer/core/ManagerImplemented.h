@@ -10,6 +10,12 @@
 #include "Matrix43.h"
 #include "CriticalSection.h"
 
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
 //----------------------------------------------------------------------------------
 //
 //----------------------------------------------------------------------------------
@@ -95,8 +101,43 @@ private:
 	/* f[^ւtO */
 	bool m_autoFlip;
 
-	// Handle
-	Handle		m_NextHandle;
+	/**
+		@brief	nh\̃Xbg
+		@note
+		nh ( << DrawSetIndexBits) | ԍ ŁA
+		ꂽXbg͐i߂ĂėpB
+	*/
+	struct DrawSetSlot
+	{
+		DrawSet		Set;
+		int32_t		Generation;
+		bool		Used;
+
+		DrawSetSlot()
+			: Generation	( 0 )
+			, Used			( false )
+		{
+		}
+	};
+
+	enum
+	{
+		DrawSetIndexBits = 20,
+		DrawSetIndexMask = (1 << DrawSetIndexBits) - 1,
+		DrawSetGenerationMask = (1 << (31 - DrawSetIndexBits)) - 1,
+	};
+
+	// Xbgz(nh̔ԍň)
+	std::vector<DrawSetSlot>	m_drawSetSlots;
+
+	// 󂫃Xbg
+	std::vector<int32_t>		m_freeDrawSetSlots;
+
+	// Đ̃Xbg(Đ)
+	std::vector<int32_t>		m_drawSetOrder;
+
+	// ̎
+	uint32_t	m_seed;
 
 	// mۍς݃CX^X
 	int m_instance_max;
@@ -107,11 +148,8 @@ private:
 	// mۍς݃CX^Xobt@
 	uint8_t*				m_reserved_instances_buffer;
 
-	// ĐIuWFNg̑gݍ킹W
-	std::map<Handle,DrawSet>	m_DrawSets;
-
 	// j҂IuWFNg
-	std::map<Handle,DrawSet>	m_RemovingDrawSets[2];
+	std::vector<DrawSet>		m_RemovingDrawSets[2];
 
 	/* `撆IuWFNg */
 	std::vector<DrawSet>		m_renderingDrawSets;
@@ -119,6 +157,27 @@ private:
 	/* `ZbV */
 	CriticalSection				m_renderingSession;
 
+	/* CX^Xobt@mۃZbV(XV̂ݎgp) */
+	CriticalSection				m_instanceSession;
+	bool						m_parallelUpdating;
+
+	/* XVXbh(ĂяoXbh܂) */
+	int32_t						m_updateThreadCount;
+
+	/* XVp[J[Xbh */
+	std::vector<std::thread>	m_updateWorkers;
+	std::mutex					m_updateMutex;
+	std::condition_variable		m_updateStart;
+	std::condition_variable		m_updateDone;
+	uint32_t					m_updateGeneration;
+	int32_t						m_updateRunning;
+	bool						m_updateExit;
+
+	/* XVWu(CX^X̑̃Xbgԍ) */
+	std::vector<int32_t>		m_updateJobs;
+	std::atomic<int32_t>		m_updateCursor;
+	float						m_updateDeltaFrame;
+
 	/* ݒCX^X */
 	Setting*						m_setting;
 
@@ -164,6 +223,19 @@ private:
 	// `IuWFNgj
 	void GCDrawSet( bool isRemovingManager );
 
+	// nh`IuWFNg擾(ȃnhȂNULL)
+	DrawSet* GetDrawSet( Handle handle );
+
+	// [J[Xbh̊JnAI
+	void StartUpdateWorkers( int32_t count );
+	void StopUpdateWorkers();
+
+	// [J[Xbh̏
+	void UpdateWorker();
+
+	// XVWuɂȂ܂ŏ
+	void ExecuteUpdateJobs();
+
 	// CX^XRei
 	InstanceContainer* CreateInstanceContainer( EffectNode* pEffectNode, InstanceGlobal* pGlobal, bool isRoot = false, Instance* pParent = NULL );
 
@@ -527,6 +599,16 @@ public:
 	*/
 	virtual int32_t GetRestInstancesCount() const { return m_reserved_instances.size(); }
 
+	/**
+		@brief	XVɎgpXbhݒ肷B
+	*/
+	void SetUpdateThreadCount( int32_t count );
+
+	/**
+		@brief	XVɎgpXbh擾B
+	*/
+	int32_t GetUpdateThreadCount() const { return m_updateThreadCount; }
+
 	/**
 		@brief	[hJnB
 	*/
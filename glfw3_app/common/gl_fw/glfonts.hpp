@@ -409,6 +409,15 @@ namespace gl {
 		void set_clip(vtx::irect& clip) { clip_ = clip; }
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	クリップ領域を得る
+			@return	クリップ領域
+		*/
+		//-----------------------------------------------------------------//
+		const vtx::irect& get_clip() const { return clip_; }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	クリップ基点設定
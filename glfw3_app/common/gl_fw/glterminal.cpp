@@ -7,7 +7,6 @@
 				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
 */
 //=====================================================================//
-#include <cstring>
 #include <boost/foreach.hpp>
 #include "gl_fw/glterminal.hpp"
 #include "core/glcore.hpp"
@@ -17,6 +16,92 @@ using namespace img;
 
 namespace gl {
 
+	void terminal::fill_row_(int phy)
+	{
+		code c;
+		c.cha = 0x0020;
+		c.fore_color = fore_color_;
+		c.back_color = back_color_;
+		c.atr = attribute_;
+		code* p = &buff_[phy * limit_pos_.x];
+		for(int i = 0; i < limit_pos_.x; ++i) {
+			p[i] = c;
+		}
+		dirty_[phy] = 1;
+	}
+
+
+	int terminal::cell_width_(uint32_t cha, int& kn)
+	{
+		fonts& fonts = core::get_instance().at_fonts();
+		kn = 0;
+		int fw = fonts.get_width(cha);
+		// プロポーショナルフォントを等幅で表示
+		if(proportional_ == false) {
+			if(cha < 0x80) {		// 半角文字
+				kn = (font_size_.x - fw) / 2;
+				fw = font_size_.x;
+			} else {	// 全角文字
+				kn = ((font_size_.x * 2) - fw) / 2;
+				fw = font_size_.x * 2;
+			}
+		}
+		return fw;
+	}
+
+
+	void terminal::draw_row_(int phy, int y)
+	{
+		fonts& fonts = core::get_instance().at_fonts();
+		const code* p = &buff_[phy * limit_pos_.x];
+		int xx = 0;
+		for(int x = 0; x < limit_pos_.x; ++x) {
+			const code& c = p[x];
+			int kn;
+			int fw = cell_width_(c.cha, kn);
+			fonts.set_fore_color(c.fore_color);
+			fonts.set_back_color(c.back_color);
+			fonts.draw(vtx::ipos(xx + kn, y), c.cha, c.atr == attribute::inverse);
+			xx += fw;
+		}
+	}
+
+
+	void terminal::render_row_(int phy)
+	{
+		fonts& fonts = core::get_instance().at_fonts();
+		const code* p = &buff_[phy * limit_pos_.x];
+
+		// フォント・テクスチャーの生成はリストに記録させない
+		for(int x = 0; x < limit_pos_.x; ++x) {
+			fonts.get_width(p[x].cha);
+		}
+
+		if(lists_[phy] == 0) {
+			lists_[phy] = glGenLists(1);
+		}
+		// 行は平行移動して呼ぶので、縦方向のクリップは外して記録する
+		vtx::irect back = fonts.get_clip();
+		vtx::irect clip(list_clip_x_, -(1 << 28), list_clip_w_, 1 << 29);
+		fonts.set_clip(clip);
+		glNewList(lists_[phy], GL_COMPILE);
+		draw_row_(phy, 0);
+		glEndList();
+		fonts.set_clip(back);
+		dirty_[phy] = 0;
+	}
+
+
+	void terminal::release_lists_()
+	{
+		BOOST_FOREACH(GLuint id, lists_) {
+			if(id != 0) glDeleteLists(id, 1);
+		}
+		lists_.clear();
+		dirty_.clear();
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	初期化
@@ -28,19 +113,7 @@ namespace gl {
 	{
 		core& core = core::get_instance();
 
-		buff_.clear();
-		limit_pos_.x = w;
-		limit_pos_.y = h;
-		buff_.resize(w * h);
-
-		code c;
-		c.cha = 0x0020;
-		c.fore_color = fore_color_;
-		c.back_color = back_color_;
-		c.atr = attribute_;
-		BOOST_FOREACH(code& cd, buff_) {
-			cd = c;
-		}
+		resize(w, h);
 
 		// 半角文字中で一番広い場合の幅検出
 		fonts& fonts = core.at_fonts();
@@ -63,9 +136,19 @@ namespace gl {
 	//-----------------------------------------------------------------//
 	void terminal::resize(int w, int h)
 	{
+		release_lists_();
 		buff_.clear();
 		limit_pos_.set(w, h);
-		buff_.resize(w * h);
+		rows_ = h > 0 ? h + history_max_ : 0;
+		buff_.resize(w * rows_);
+		dirty_.resize(rows_, 1);
+		lists_.resize(rows_, 0);
+		head_ = 0;
+		history_ = 0;
+		view_offset_ = 0;
+		for(int i = 0; i < rows_; ++i) {
+			fill_row_(i);
+		}
 	}
 
 
@@ -77,13 +160,11 @@ namespace gl {
 	void terminal::clear()
 	{
 		if(limit_pos_.y > 1 && limit_pos_.x > 0) {
-			code c;
-			c.cha = 0x0020;
-			c.fore_color = fore_color_;
-			c.back_color = back_color_;
-			c.atr = attribute_;
-			BOOST_FOREACH(code& cd, buff_) {
-				cd = c;
+			head_ = 0;
+			history_ = 0;
+			view_offset_ = 0;
+			for(int i = 0; i < rows_; ++i) {
+				fill_row_(i);
 			}
 		}
 	}
@@ -97,15 +178,16 @@ namespace gl {
 	void terminal::scroll()
 	{
 		if(scroll_ == true && limit_pos_.y > 1 && limit_pos_.x > 0) {
-			memcpy(&buff_[0], &buff_[limit_pos_.x],
-				limit_pos_.x * (limit_pos_.y - 1) * sizeof(code));
-			int o = (limit_pos_.y - 1) * limit_pos_.x;
-			code& c = buff_[o];
-			c.cha = 0x0020;
-			c.fore_color = fore_color_;
-			c.back_color = back_color_;
-			c.atr = attribute_;
-			memcpy(&buff_[o + 1], &buff_[o], (limit_pos_.x - 1) * sizeof(code));
+			// 先頭行をリングの後ろへ送るだけで、バッファの移動は行わない
+			head_ = phys_row_(1);
+			if(history_ < history_max_) {
+				++history_;
+			}
+			// 過去を表示中なら、表示位置を保つ
+			if(view_offset_ > 0 && view_offset_ < history_) {
+				++view_offset_;
+			}
+			fill_row_(phys_row_(limit_pos_.y - 1));
 		}
 	}
 
@@ -118,6 +200,8 @@ namespace gl {
 	//-----------------------------------------------------------------//
 	void terminal::put(uint32_t ch)
 	{
+		if(rows_ == 0) return;
+
 		if(ch < 0x20) {
 			if(ch == 0x0a) {
 				cursor_pos_.y++;
@@ -128,11 +212,12 @@ namespace gl {
 				cursor_pos_.x = 0;
 			}
 		} else {
-			code& c = buff_[cursor_pos_.x + cursor_pos_.y * limit_pos_.x];
+			code& c = row_ptr_(cursor_pos_.y)[cursor_pos_.x];
 			c.cha = ch;
 			c.fore_color = fore_color_;
 			c.back_color = back_color_;
 			c.atr = attribute_;
+			dirty_[phys_row_(cursor_pos_.y)] = 1;
 
 			++cursor_pos_.x;
 			if(cursor_pos_.x >= limit_pos_.x) {
@@ -157,34 +242,49 @@ namespace gl {
 		core& core = core::get_instance();
 		fonts& fonts = core.at_fonts();
 
+		// 横方向のクリップが変わったら、全ての行を作り直す
+		const vtx::irect& clip = fonts.get_clip();
+		if(clip.org.x != list_clip_x_ || clip.size.x != list_clip_w_) {
+			list_clip_x_ = clip.org.x;
+			list_clip_w_ = clip.size.x;
+			mark_all_dirty_();
+		}
+		int clip_ye = clip.org.y + clip.size.y;
+
+		// 変更の有った行だけ再構築し、他はキャッシュを呼ぶ
+		for(int y = 0; y < limit_pos_.y; ++y) {
+			int phy = phys_row_(y - view_offset_);
+			int yy = (limit_pos_.y - y - 1) * font_size_.y;
+			int ye = yy + font_size_.y;
+			if(ye <= clip.org.y || clip_ye <= yy) continue;  // 見えない行
+			if(yy < clip.org.y || clip_ye < ye) {
+				// 縦に一部だけ見える行は、実際の位置でクリップして直接描く
+				draw_row_(phy, yy);
+				continue;
+			}
+			if(dirty_[phy] != 0 || lists_[phy] == 0) {
+				render_row_(phy);
+			}
+			glPushMatrix();
+			glTranslatef(0.0f, static_cast<float>(yy), 0.0f);
+			glCallList(lists_[phy]);
+			glPopMatrix();
+		}
+
 		fonts.set_fore_color(fore_color_);
 		fonts.set_back_color(back_color_);
 
-		for(int y = 0; y < limit_pos_.y; ++y) {
+		if(cursor_ == true && view_offset_ == 0 && limit_pos_.y > 0 && (frame_count_ & 7) > 3) {
+			const code* p = row_ptr_(cursor_pos_.y);
 			int xx = 0;
-			for(int x = 0; x < limit_pos_.x; ++x) {
-				code& c = buff_[y * limit_pos_.x + x];
-				if(cursor_ == true && cursor_pos_.x == x && cursor_pos_.y == y) {
-					if((frame_count_ & 7) > 3) {
-						c.cha = 0x007f;
-					}
-				}
-				// プロポーショナルフォントを等幅で表示
-				int kn = 0;
-				int fw = fonts.get_width(c.cha);
-				if(proportional_ == false) {
-					if(c.cha < 0x80) {		// 半角文字
-						kn = (font_size_.x - fw) / 2;
-						fw = font_size_.x;
-					} else {	// 全角文字
-						kn = ((font_size_.x * 2) - fw) / 2;
-						fw = font_size_.x * 2;
-					}
-				}
-				vtx::spos pos(xx + kn, (limit_pos_.y - y - 1) * font_size_.y);
-				fonts.draw(pos, c.cha);
-				xx += fw;
+			for(int x = 0; x < cursor_pos_.x; ++x) {
+				int kn;
+				xx += cell_width_(p[x].cha, kn);
 			}
+			int kn;
+			cell_width_(0x007f, kn);
+			vtx::ipos pos(xx + kn, (limit_pos_.y - cursor_pos_.y - 1) * font_size_.y);
+			fonts.draw(pos, 0x007f);
 		}
 		++frame_count_;
 	}
@@ -197,7 +297,12 @@ namespace gl {
 	//-----------------------------------------------------------------//
 	void terminal::destroy()
 	{
+		release_lists_();
 		codes().swap(buff_);
 		limit_pos_.set(0, 0);
+		rows_ = 0;
+		head_ = 0;
+		history_ = 0;
+		view_offset_ = 0;
 	}
 }
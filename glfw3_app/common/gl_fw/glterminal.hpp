@@ -9,6 +9,8 @@
 */
 //=====================================================================//
 #include <vector>
+#include <algorithm>
+#include "gl_fw/gl_info.hpp"
 #include "img_io/img.hpp"
 #include "utils/vtx.hpp"
 #include "utils/string_utils.hpp"
@@ -48,7 +50,20 @@ namespace gl {
 		typedef std::vector<code>::iterator			codes_it;
 		typedef std::vector<code>::const_iterator	codes_cit;
 
+		// 行リングバッファ（スクリーン＋スクロールバック）
 		codes	buff_;
+		int		rows_;
+		int		head_;
+		int		history_;
+		int		history_max_;
+		int		view_offset_;
+
+		// 物理行毎の描画キャッシュ（ディスプレイ・リスト） @n
+		// リストは縦方向のクリップ無しで記録し、横方向のクリップが変わったら作り直す
+		std::vector<uint8_t>	dirty_;
+		std::vector<GLuint>		lists_;
+		int						list_clip_x_;
+		int						list_clip_w_;
 
 		img::rgba8	fore_color_;
 		img::rgba8	back_color_;
@@ -65,13 +80,30 @@ namespace gl {
 		bool	cursor_;
 		bool	proportional_;
 
+		int phys_row_(int y) const {
+			int r = (head_ + y) % rows_;
+			if(r < 0) r += rows_;
+			return r;
+		}
+
+		code* row_ptr_(int y) { return &buff_[phys_row_(y) * limit_pos_.x]; }
+
+		void fill_row_(int phy);
+		int cell_width_(uint32_t cha, int& kn);
+		void draw_row_(int phy, int y);
+		void render_row_(int phy);
+		void release_lists_();
+		void mark_all_dirty_() { std::fill(dirty_.begin(), dirty_.end(), 1); }
+
 	public:
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	コンストラクター
 		*/
 		//-----------------------------------------------------------------//
-		terminal() : fore_color_(255, 255, 255, 255), back_color_(0, 0, 0, 255),
+		terminal() : rows_(0), head_(0), history_(0), history_max_(2048), view_offset_(0),
+					   list_clip_x_(0), list_clip_w_(0),
+					   fore_color_(255, 255, 255, 255), back_color_(0, 0, 0, 255),
 					   cursor_pos_(0), limit_pos_(0), font_size_(24, 24),
 					   attribute_(attribute::normal), frame_count_(0),
 					   scroll_(true), cursor_(true), proportional_(false) { }
@@ -79,10 +111,21 @@ namespace gl {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	デストラクター
+			@brief	デストラクター @n
+					GL コンテキストが無い場合があるので、ディスプレイ・リストは @n
+					解放しない（destroy を呼ぶ事）
+		*/
+		//-----------------------------------------------------------------//
+		~terminal() { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	スクロールバック行数を設定（initialize、resize 前に設定）
+			@param[in]	n	スクロールバック行数
 		*/
 		//-----------------------------------------------------------------//
-		~terminal() { destroy(); }
+		void set_history_max(int n) { history_max_ = n < 0 ? 0 : n; }
 
 
 		//-----------------------------------------------------------------//
@@ -155,7 +198,7 @@ namespace gl {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	廃棄
+			@brief	廃棄（GL コンテキストがカレントの状態で呼ぶ事）
 		*/
 		//-----------------------------------------------------------------//
 		void destroy();
@@ -212,7 +255,12 @@ namespace gl {
 			@param[in]	flag	「false」なら等幅
 		*/
 		//-----------------------------------------------------------------//
-		void enable_proportional(bool flag = true) { proportional_ = flag; }
+		void enable_proportional(bool flag = true) {
+			if(proportional_ != flag) {
+				proportional_ = flag;
+				mark_all_dirty_();
+			}
+		}
 
 
 		//-----------------------------------------------------------------//
@@ -233,6 +281,37 @@ namespace gl {
 		int get_screen_height() const { return font_size_.y * limit_pos_.y; }
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	スクロールバックに保持されている行数を得る
+			@return	行数
+		*/
+		//-----------------------------------------------------------------//
+		int get_history() const { return history_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	表示位置（スクロールバック）を設定
+			@param[in]	ofs	遡る行数（０で最新）
+		*/
+		//-----------------------------------------------------------------//
+		void set_view_offset(int ofs) {
+			if(ofs < 0) ofs = 0;
+			else if(ofs > history_) ofs = history_;
+			view_offset_ = ofs;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	表示位置（スクロールバック）を得る
+			@return	遡っている行数
+		*/
+		//-----------------------------------------------------------------//
+		int get_view_offset() const { return view_offset_; }
+
+
 	};
 
 }
@@ -10,6 +10,7 @@
 */
 //=====================================================================//
 #include "gl_fw/gltexfb.hpp"
+#include "gl_fw/texfb_conv.hpp"
 
 namespace gl {
 
@@ -23,6 +24,14 @@ namespace gl {
 	}
 
 
+	// ステージング・バッファは、必要な時だけ拡張し、解放しない
+	static uint8_t* stage_buffer_(std::vector<uint8_t>& buf, size_t size)
+	{
+		if(buf.size() < size) buf.resize(size);
+		return &buf[0];
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	テクスチャー・フレーム・バッファの設定
@@ -105,6 +114,10 @@ namespace gl {
 		}
 		delete[] img;
 
+		for(int i = 0; i < 2; ++i) {
+			std::vector<uint8_t>(disp_size_.x * disp_size_.y * 4).swap(stage_[i]);
+		}
+
 		return error::ERROR_NONE;
 	}
 
@@ -198,6 +211,8 @@ namespace gl {
 		if(img == 0) return;
 
 		// GL_RGB 又は、GL_RGBA への変換（必要な場合）
+		const uint8_t* im = static_cast<const uint8_t*>(img);
+		uint32_t n = disp_size_.x * disp_size_.y;
 		uint8_t* dst = 0;
 		GLuint src_type = GL_RGBA;
 		if(tex_depth_ == 4) {
@@ -205,86 +220,22 @@ namespace gl {
 		} else if(tex_depth_ == 16) {		// RGBA4
 		} else if(tex_depth_ == 24) {		// RGB8
 			src_type = GL_RGB;
-			if(srct == image::GRAY) {
-				dst = new uint8_t[disp_size_.x * disp_size_.y * 3];
-				const uint8_t* im = static_cast<const uint8_t*>(img);
-				for(int y = 0; y < disp_size_.y; ++y) {
-					uint8_t* p = &dst[y * disp_size_.x * 3];
-					for(int x = 0; x < disp_size_.x; ++x) {
-						char g = *im++;
-						*p++ = g;
-						*p++ = g;
-						*p++ = g;
-					}
-				}
-			} else if(srct == image::RGB) {
+			if(srct == image::RGB) {
 				// 変換の必要無し
-			} else if(srct == image::RGBA) {
-				dst = new uint8_t[disp_size_.x * disp_size_.y * 3];
-				const uint8_t* im = static_cast<const uint8_t*>(img);
-				for(int y = 0; y < disp_size_.y; ++y) {
-					uint8_t* p = &dst[y * disp_size_.x * 3];
-					for(int x = 0; x < disp_size_.x; ++x) {
-						*p++ = *im++;
-						*p++ = *im++;
-						*p++ = *im++;
-						im++;
-					}
-				}
-			} else if(srct == image::BGR) {
-				dst = new uint8_t[disp_size_.x * disp_size_.y * 3];
-				const uint8_t* im = static_cast<const uint8_t*>(img);
-				for(int y = 0; y < disp_size_.y; ++y) {
-					uint8_t* p = &dst[y * disp_size_.x * 3];
-					for(int x = 0; x < disp_size_.x; ++x) {
-						p[2] = *im++;
-						p[1] = *im++;
-						p[0] = *im++;
-						p += 3;
-					}
-				}
+			} else if(srct == image::GRAY || srct == image::RGBA || srct == image::BGR) {
+				dst = stage_buffer_(stage_[disp_page_ ^ 1], n * 3);
+				if(srct == image::GRAY) texfb_conv::gray_to_rgb(im, dst, n);
+				else if(srct == image::RGBA) texfb_conv::rgba_to_rgb(im, dst, n);
+				else texfb_conv::bgr_to_rgb(im, dst, n);
 			}
 		} else if(tex_depth_ == 32) {		// RGBA8
-			if(srct == image::GRAY) {
-				dst = new uint8_t[disp_size_.x * disp_size_.y * 4];
-				const uint8_t* im = static_cast<const uint8_t*>(img);
-				for(int y = 0; y < disp_size_.y; ++y) {
-					uint8_t* p = &dst[y * disp_size_.x * 4];
-					for(int x = 0; x < disp_size_.x; ++x) {
-						char g = *im++;
-						*p++ = g;
-						*p++ = g;
-						*p++ = g;
-						*p++ = alpha;
-					}
-				}
-			} else if(srct == image::RGB) {
-				dst = new uint8_t[disp_size_.x * disp_size_.y * 4];
-				const uint8_t* im = static_cast<const uint8_t*>(img);
-				for(int y = 0; y < disp_size_.y; ++y) {
-					uint8_t* p = &dst[y * disp_size_.x * 4];
-					for(int x = 0; x < disp_size_.x; ++x) {
-						*p++ = *im++;
-						*p++ = *im++;
-						*p++ = *im++;
-						*p++ = alpha;
-					}
-				}
-			} else if(srct == image::RGBA) {
+			if(srct == image::RGBA) {
 				// 変換不要
-			} else if(srct == image::BGR) {
-				dst = new uint8_t[disp_size_.x * disp_size_.y * 4];
-				const uint8_t* im = static_cast<const uint8_t*>(img);
-				for(int y = 0; y < disp_size_.y; ++y) {
-					uint8_t* p = &dst[y * disp_size_.x * 4];
-					for(int x = 0; x < disp_size_.x; ++x) {
-						p[3] = alpha;
-						p[2] = *im++;
-						p[1] = *im++;
-						p[0] = *im++;
-						p += 4;
-					}
-				}
+			} else if(srct == image::GRAY || srct == image::RGB || srct == image::BGR) {
+				dst = stage_buffer_(stage_[disp_page_ ^ 1], n * 4);
+				if(srct == image::GRAY) texfb_conv::gray_to_rgba(im, dst, n, alpha);
+				else if(srct == image::RGB) texfb_conv::rgb_to_rgba(im, dst, n, alpha);
+				else texfb_conv::bgr_to_rgba(im, dst, n, alpha);
 			}
 		}
 
@@ -295,15 +246,11 @@ namespace gl {
 			src = img;
 		}
 
-		if(src) {
-			glBindTexture(GL_TEXTURE_2D, tex_id_.ids_[disp_page_ ^ 1]);
-
-			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-			glTexSubImage2D(GL_TEXTURE_2D, 0,
-				disp_start_.x, disp_start_.y, disp_size_.x, disp_size_.y, src_type, GL_UNSIGNED_BYTE, src);
-		}
+		glBindTexture(GL_TEXTURE_2D, tex_id_.ids_[disp_page_ ^ 1]);
 
-		if(dst) delete[] dst;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0,
+			disp_start_.x, disp_start_.y, disp_size_.x, disp_size_.y, src_type, GL_UNSIGNED_BYTE, src);
 	}
 	
 
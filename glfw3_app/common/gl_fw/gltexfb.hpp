@@ -11,6 +11,7 @@
 				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
 */
 //=====================================================================//
+#include <vector>
 #include "gl_fw/gl_info.hpp"
 #include "utils/vtx.hpp"
 
@@ -62,6 +63,9 @@ namespace gl {
 		};
 		tex_page	tex_id_;
 
+		// 変換用ステージング・バッファ（ページ毎に保持して使いまわす）
+		std::vector<uint8_t>	stage_[2];
+
 		bool	h_flip_;
 		bool	v_flip_;
 
@@ -0,0 +1,259 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	テクスチャー・フレーム・バッファ用ピクセル変換 @n
+			GRAY/RGB/RGBA/BGR を GL_RGB、GL_RGBA に詰め替える。@n
+			SSSE3 はコンパイル・オプションに依存せず、実行時に CPU を@n
+			調べて使い、端数はスカラーで処理する。
+	@author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TEXFB_SSSE3_DISPATCH
+#define TEXFB_SSSE3 __attribute__((target("ssse3")))
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace gl {
+
+	namespace texfb_conv {
+
+#ifdef TEXFB_SSSE3_DISPATCH
+		inline bool has_ssse3_()
+		{
+			static const bool f = __builtin_cpu_supports("ssse3");
+			return f;
+		}
+
+
+		TEXFB_SSSE3 inline uint32_t gray_to_rgb_ssse3_(const uint8_t* src, uint8_t* dst, uint32_t n)
+		{
+			uint32_t i = 0;
+			const __m128i m0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+			const __m128i m1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+			const __m128i m2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+			for(; (i + 16) <= n; i += 16) {
+				__m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i* d = reinterpret_cast<__m128i*>(dst + i * 3);
+				_mm_storeu_si128(d + 0, _mm_shuffle_epi8(g, m0));
+				_mm_storeu_si128(d + 1, _mm_shuffle_epi8(g, m1));
+				_mm_storeu_si128(d + 2, _mm_shuffle_epi8(g, m2));
+			}
+			return i;
+		}
+
+
+		TEXFB_SSSE3 inline uint32_t rgba_to_rgb_ssse3_(const uint8_t* src, uint8_t* dst, uint32_t n)
+		{
+			uint32_t i = 0;
+			// ４ピクセル毎に１２バイトを詰める（最後の書き込みは１６バイト幅なので余裕を残す）
+			const __m128i m = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+			for(; (i + 6) <= n; i += 4) {
+				__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(p, m));
+			}
+			return i;
+		}
+
+
+		TEXFB_SSSE3 inline uint32_t bgr_to_rgb_ssse3_(const uint8_t* src, uint8_t* dst, uint32_t n)
+		{
+			uint32_t i = 0;
+			// ５ピクセル（１５バイト）毎に反転、読み書き共に１６バイト幅なので余裕を残す
+			const __m128i m = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+			for(; (i + 6) <= n; i += 5) {
+				__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(p, m));
+			}
+			return i;
+		}
+
+
+		TEXFB_SSSE3 inline uint32_t rgb_to_rgba_ssse3_(const uint8_t* src, uint8_t* dst, uint32_t n, int alpha)
+		{
+			uint32_t i = 0;
+			const __m128i m = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m128i a = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+			// ４ピクセル（１２バイト）毎、読み込みは１６バイト幅なので余裕を残す
+			for(; (i + 6) <= n; i += 4) {
+				__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+				p = _mm_or_si128(_mm_shuffle_epi8(p, m), a);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), p);
+			}
+			return i;
+		}
+
+
+		TEXFB_SSSE3 inline uint32_t bgr_to_rgba_ssse3_(const uint8_t* src, uint8_t* dst, uint32_t n, int alpha)
+		{
+			uint32_t i = 0;
+			const __m128i m = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+			const __m128i a = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+			for(; (i + 6) <= n; i += 4) {
+				__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+				p = _mm_or_si128(_mm_shuffle_epi8(p, m), a);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), p);
+			}
+			return i;
+		}
+#endif
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	GRAY から RGB への変換
+			@param[in]	src	ソース（n バイト）
+			@param[out]	dst	出力（n * 3 バイト）
+			@param[in]	n	ピクセル数
+		*/
+		//-----------------------------------------------------------------//
+		inline void gray_to_rgb(const uint8_t* src, uint8_t* dst, uint32_t n)
+		{
+			uint32_t i = 0;
+#ifdef TEXFB_SSSE3_DISPATCH
+			if(has_ssse3_()) i = gray_to_rgb_ssse3_(src, dst, n);
+#endif
+			for(; i < n; ++i) {
+				uint8_t g = src[i];
+				dst[i * 3 + 0] = g;
+				dst[i * 3 + 1] = g;
+				dst[i * 3 + 2] = g;
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	GRAY から RGBA への変換
+			@param[in]	src		ソース（n バイト）
+			@param[out]	dst		出力（n * 4 バイト）
+			@param[in]	n		ピクセル数
+			@param[in]	alpha	アルファ値
+		*/
+		//-----------------------------------------------------------------//
+		inline void gray_to_rgba(const uint8_t* src, uint8_t* dst, uint32_t n, int alpha)
+		{
+			uint32_t i = 0;
+#ifdef __SSE2__
+			const __m128i a = _mm_set1_epi8(static_cast<char>(alpha));
+			for(; (i + 16) <= n; i += 16) {
+				__m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i gg_l = _mm_unpacklo_epi8(g, g);
+				__m128i gg_h = _mm_unpackhi_epi8(g, g);
+				__m128i ga_l = _mm_unpacklo_epi8(g, a);
+				__m128i ga_h = _mm_unpackhi_epi8(g, a);
+				__m128i* d = reinterpret_cast<__m128i*>(dst + i * 4);
+				_mm_storeu_si128(d + 0, _mm_unpacklo_epi16(gg_l, ga_l));
+				_mm_storeu_si128(d + 1, _mm_unpackhi_epi16(gg_l, ga_l));
+				_mm_storeu_si128(d + 2, _mm_unpacklo_epi16(gg_h, ga_h));
+				_mm_storeu_si128(d + 3, _mm_unpackhi_epi16(gg_h, ga_h));
+			}
+#endif
+			for(; i < n; ++i) {
+				uint8_t g = src[i];
+				dst[i * 4 + 0] = g;
+				dst[i * 4 + 1] = g;
+				dst[i * 4 + 2] = g;
+				dst[i * 4 + 3] = alpha;
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	RGBA から RGB への変換（アルファは捨てる）
+			@param[in]	src	ソース（n * 4 バイト）
+			@param[out]	dst	出力（n * 3 バイト）
+			@param[in]	n	ピクセル数
+		*/
+		//-----------------------------------------------------------------//
+		inline void rgba_to_rgb(const uint8_t* src, uint8_t* dst, uint32_t n)
+		{
+			uint32_t i = 0;
+#ifdef TEXFB_SSSE3_DISPATCH
+			if(has_ssse3_()) i = rgba_to_rgb_ssse3_(src, dst, n);
+#endif
+			for(; i < n; ++i) {
+				dst[i * 3 + 0] = src[i * 4 + 0];
+				dst[i * 3 + 1] = src[i * 4 + 1];
+				dst[i * 3 + 2] = src[i * 4 + 2];
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	BGR から RGB への変換
+			@param[in]	src	ソース（n * 3 バイト）
+			@param[out]	dst	出力（n * 3 バイト）
+			@param[in]	n	ピクセル数
+		*/
+		//-----------------------------------------------------------------//
+		inline void bgr_to_rgb(const uint8_t* src, uint8_t* dst, uint32_t n)
+		{
+			uint32_t i = 0;
+#ifdef TEXFB_SSSE3_DISPATCH
+			if(has_ssse3_()) i = bgr_to_rgb_ssse3_(src, dst, n);
+#endif
+			for(; i < n; ++i) {
+				dst[i * 3 + 0] = src[i * 3 + 2];
+				dst[i * 3 + 1] = src[i * 3 + 1];
+				dst[i * 3 + 2] = src[i * 3 + 0];
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	RGB から RGBA への変換
+			@param[in]	src		ソース（n * 3 バイト）
+			@param[out]	dst		出力（n * 4 バイト）
+			@param[in]	n		ピクセル数
+			@param[in]	alpha	アルファ値
+		*/
+		//-----------------------------------------------------------------//
+		inline void rgb_to_rgba(const uint8_t* src, uint8_t* dst, uint32_t n, int alpha)
+		{
+			uint32_t i = 0;
+#ifdef TEXFB_SSSE3_DISPATCH
+			if(has_ssse3_()) i = rgb_to_rgba_ssse3_(src, dst, n, alpha);
+#endif
+			for(; i < n; ++i) {
+				dst[i * 4 + 0] = src[i * 3 + 0];
+				dst[i * 4 + 1] = src[i * 3 + 1];
+				dst[i * 4 + 2] = src[i * 3 + 2];
+				dst[i * 4 + 3] = alpha;
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	BGR から RGBA への変換
+			@param[in]	src		ソース（n * 3 バイト）
+			@param[out]	dst		出力（n * 4 バイト）
+			@param[in]	n		ピクセル数
+			@param[in]	alpha	アルファ値
+		*/
+		//-----------------------------------------------------------------//
+		inline void bgr_to_rgba(const uint8_t* src, uint8_t* dst, uint32_t n, int alpha)
+		{
+			uint32_t i = 0;
+#ifdef TEXFB_SSSE3_DISPATCH
+			if(has_ssse3_()) i = bgr_to_rgba_ssse3_(src, dst, n, alpha);
+#endif
+			for(; i < n; ++i) {
+				dst[i * 4 + 0] = src[i * 3 + 2];
+				dst[i * 4 + 1] = src[i * 3 + 1];
+				dst[i * 4 + 2] = src[i * 3 + 0];
+				dst[i * 4 + 3] = alpha;
+			}
+		}
+	}
+}
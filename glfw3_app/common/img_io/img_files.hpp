@@ -100,7 +100,7 @@ namespace img {
 		bool probe(const std::string& filename) {
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(filename, "rb")) {
+			if(fin.open_map(filename)) {
 				f = probe(fin, utils::get_file_ext(filename));
 				fin.close();
 			}
@@ -120,7 +120,7 @@ namespace img {
 			utils::utf16_to_utf8(filename, s);
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(s, "rb")) {
+			if(fin.open_map(s)) {
 				f = probe(fin, utils::get_file_ext(s));
 				fin.close();
 			}
@@ -151,7 +151,7 @@ namespace img {
 		bool info(const std::string& filename, img::img_info& fo) {
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(filename, "rb")) {
+			if(fin.open_map(filename)) {
 				f = info(fin, fo, utils::get_file_ext(filename));
 				fin.close();
 			}
@@ -172,7 +172,7 @@ namespace img {
 			utils::utf16_to_utf8(filename, s);
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(s, "rb")) {
+			if(fin.open_map(s)) {
 				f = info(fin, fo, utils::get_file_ext(s));
 				fin.close();
 			}
@@ -203,7 +203,7 @@ namespace img {
 		bool load(const std::string& filename, const std::string& opt = "") {
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(filename, "rb")) {
+			if(fin.open_map(filename)) {
 				f = load(fin, utils::get_file_ext(filename), opt);
 				fin.close();
 			}
@@ -224,7 +224,7 @@ namespace img {
 			utils::utf16_to_utf8(filename, s);
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(s, "rb")) {
+			if(fin.open_map(s)) {
 				f = load(fin, utils::get_file_ext(s), opt);
 				fin.close();
 			}
@@ -247,11 +247,12 @@ namespace img {
 		*/
 		//-----------------------------------------------------------------//
 		uint32_t count_color() const override {
-			boost::unordered_set<gray8> n;
+			bool map[256] = { false };
+			uint32_t n = 0;
 			BOOST_FOREACH(const gray8& c, img_) {
-				n.insert(c);
+				if(!map[c.g]) { map[c.g] = true; ++n; }
 			}
-			return static_cast<uint32_t>(n.size());
+			return n;
 		}
 
 
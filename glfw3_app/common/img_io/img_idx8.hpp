@@ -208,6 +208,28 @@ namespace img {
 		}
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	イメージのポインターを得る。
+			@param[in]	y イメージの高さ（省略すると先頭）
+			@return	イメージのポインター
+		*/
+		//-----------------------------------------------------------------//
+		const idx8* get_img(int y = 0) const {
+			if(y >= 0 && y < size_.y) return &img_[size_.x * y]; else return 0;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	読み書き可能な画像のポインターを取得
+			@param[in]	n	オフセット
+			@return	画像ポインター
+		*/
+		//-----------------------------------------------------------------//
+		idx8* at_image(int n = 0) { return &img_[n]; }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	イメージのアドレスを得る。
@@ -269,11 +291,12 @@ namespace img {
 		*/
 		//-----------------------------------------------------------------//
 		uint32_t count_color() const override {
-			boost::unordered_set<idx8> n;
+			bool map[256] = { false };
+			uint32_t n = 0;
 			BOOST_FOREACH(const idx8& c, img_) {
-				n.insert(c);
+				if(!map[c.i]) { map[c.i] = true; ++n; }
 			}
-			return static_cast<uint32_t>(n.size());
+			return n;
 		}
 
 
@@ -283,19 +306,20 @@ namespace img {
 		*/
 		//-----------------------------------------------------------------//
 		void index_optimize() {
-			std::set<idx8> n;
-			for(std::vector<idx8>::const_iterator cit = img_.begin(); cit != img_.end(); ++cit) {
-				n.insert(*cit);
+			bool used[256] = { false };
+			int num = 0;
+			BOOST_FOREACH(const idx8& c, img_) {
+				if(!used[c.i]) { used[c.i] = true; ++num; }
 			}
-			if(static_cast<int>(n.size()) >= clut_max_) {
+			if(num >= clut_max_) {
 				// 並べなおす必要無し！
 				return;
 			}
 			unsigned char cnv[256];
 			rgba8 clut[256];
 			int i = 0;
-			for(std::set<idx8>::const_iterator cit = n.begin(); cit != n.end(); ++cit) {
-				int idx = (*cit).i;
+			for(int idx = 0; idx < 256; ++idx) {
+				if(!used[idx]) continue;
 				cnv[idx] = i;
 				clut[i] = clut_[idx];
 				++i;
@@ -9,11 +9,12 @@
 */
 //=====================================================================//
 #include <vector>
-#include <boost/unordered_set.hpp>
+#include <algorithm>
 #include <boost/foreach.hpp>
 #include "i_img.hpp"
 #include "img_idx8.hpp"
 #include "img_gray8.hpp"
+#include "img_span.hpp"
 
 namespace img {
 
@@ -33,6 +34,53 @@ namespace img {
 
 		bool	alpha_;
 
+		// 転送領域をソース、コピー先の両方でクリップする
+		bool clip_(vtx::spos& dst, const vtx::spos& ssize, vtx::srect& rsrc) const {
+			int sx = rsrc.org.x;
+			int sy = rsrc.org.y;
+			int dx = dst.x;
+			int dy = dst.y;
+			int w = rsrc.size.x;
+			int h = rsrc.size.y;
+			if(sx < 0) { dx -= sx; w += sx; sx = 0; }
+			if(sy < 0) { dy -= sy; h += sy; sy = 0; }
+			if(dx < 0) { sx -= dx; w += dx; dx = 0; }
+			if(dy < 0) { sy -= dy; h += dy; dy = 0; }
+			w = std::min(w, std::min(ssize.x - sx, size_.x - dx));
+			h = std::min(h, std::min(ssize.y - sy, size_.y - dy));
+			if(w <= 0 || h <= 0 || img_.empty()) return false;
+			dst.set(dx, dy);
+			rsrc.org.set(sx, sy);
+			rsrc.size.set(w, h);
+			return true;
+		}
+
+		// 同じイメージ内で、転送元と転送先が重なるか
+		bool overlap_(const vtx::spos& d, const img_rgba8& isrc, const vtx::srect& r) const {
+			if(&isrc != this) return false;
+			return d.x < (r.org.x + r.size.x) && r.org.x < (d.x + r.size.x)
+				&& d.y < (r.org.y + r.size.y) && r.org.y < (d.y + r.size.y);
+		}
+
+		// 重なる場合は、転送元の行を退避し、まだ読んでいない行を壊さない順番で処理する
+		template <class FUNC>
+		void overlap_rows_(const vtx::spos& d, const vtx::srect& r, FUNC func) {
+			std::vector<value_type> tmp(r.size.x);
+			int y = 0;
+			int ye = r.size.y;
+			int dy = 1;
+			if(d.y > r.org.y) {
+				y = r.size.y - 1;
+				ye = -1;
+				dy = -1;
+			}
+			for(; y != ye; y += dy) {
+				const value_type* src = &img_[size_.x * (r.org.y + y) + r.org.x];
+				std::copy(src, src + r.size.x, tmp.begin());
+				func(&img_[size_.x * (d.y + y) + d.x], &tmp[0], r.size.x);
+			}
+		}
+
 	public:
 		//-----------------------------------------------------------------//
 		/*!
@@ -276,11 +324,32 @@ namespace img {
 		*/
 		//-----------------------------------------------------------------//
 		uint32_t count_color() const override {
-			boost::unordered_set<rgba8> n;
+			if(img_.empty()) return 0;
+			bool same_alpha = true;
 			BOOST_FOREACH(const rgba8& c, img_) {
-				n.insert(c);
+				if(c.a != img_[0].a) { same_alpha = false; break; }
+			}
+			if(same_alpha) {
+				// RGB 24 ビットのビットマップで数える
+				std::vector<uint32_t> map(1 << (24 - 5), 0);
+				uint32_t n = 0;
+				BOOST_FOREACH(const rgba8& c, img_) {
+					uint32_t v = (static_cast<uint32_t>(c.r) << 16) | (static_cast<uint32_t>(c.g) << 8) | c.b;
+					uint32_t& w = map[v >> 5];
+					uint32_t m = 1 << (v & 31);
+					if((w & m) == 0) { w |= m; ++n; }
+				}
+				return n;
+			} else {
+				std::vector<uint32_t> tmp;
+				tmp.reserve(img_.size());
+				BOOST_FOREACH(const rgba8& c, img_) {
+					tmp.push_back((static_cast<uint32_t>(c.a) << 24) | (static_cast<uint32_t>(c.r) << 16)
+						| (static_cast<uint32_t>(c.g) << 8) | c.b);
+				}
+				std::sort(tmp.begin(), tmp.end());
+				return static_cast<uint32_t>(std::unique(tmp.begin(), tmp.end()) - tmp.begin());
 			}
-			return static_cast<uint32_t>(n.size());
 		}
 
 
@@ -293,14 +362,18 @@ namespace img {
 		*/
 		//-----------------------------------------------------------------//
 		void copy(const vtx::spos& dst, const img_rgba8& isrc, const vtx::srect& rsrc) {
-			vtx::spos p;
-			for(p.y = 0; p.y < rsrc.size.y; ++p.y) {
-				for(p.x = 0; p.x < rsrc.size.x; ++p.x) {
-					rgba8 c;
-					if(isrc.get_pixel(p + rsrc.org, c)) {
-						put_pixel(p + dst, c);
-					}
-				}
+			vtx::spos d = dst;
+			vtx::srect r = rsrc;
+			if(!clip_(d, isrc.get_size(), r)) return;
+			if(overlap_(d, isrc, r)) {
+				overlap_rows_(d, r, [](rgba8* dst, const rgba8* src, uint32_t n) {
+					std::copy(src, src + n, dst);
+				});
+				return;
+			}
+			for(int y = 0; y < r.size.y; ++y) {
+				const rgba8* src = isrc.get_img(r.org.y + y) + r.org.x;
+				std::copy(src, src + r.size.x, &img_[size_.x * (d.y + y) + d.x]);
 			}
 		}
 
@@ -323,15 +396,18 @@ namespace img {
 		*/
 		//-----------------------------------------------------------------//
 		void copy(const vtx::spos& dst, const img_idx8& isrc, const vtx::srect& rsrc) {
-			vtx::spos p;
-			for(p.y = 0; p.y < rsrc.size.y; ++p.y) {
-				for(p.x = 0; p.x < rsrc.size.x; ++p.x) {
-					rgba8 c;
-					if(isrc.get_pixel(p + rsrc.org, c)) {
-						put_pixel(p + dst, c);
-					}
-				}
+			vtx::spos d = dst;
+			vtx::srect r = rsrc;
+			if(!clip_(d, isrc.get_size(), r)) return;
+			rgba8 clut[256];
+			for(int i = 0; i < 256; ++i) {
+				if(!isrc.get_clut(i, clut[i])) clut[i].set(0, 0, 0, 0);
 			}
+			const span_kernels& k = get_span_kernels();
+			parallel_rows(r.size.x, r.size.y, [&](int y) {
+				const uint8_t* src = &isrc.get_img(r.org.y + y)[r.org.x].i;
+				k.expand_idx8(&img_[size_.x * (d.y + y) + d.x], src, r.size.x, clut);
+			});
 		}
 
 
@@ -344,18 +420,14 @@ namespace img {
 		*/
 		//-----------------------------------------------------------------//
 		void copy(const vtx::spos& dst, const img_gray8& isrc, const vtx::srect& rsrc) {
-			vtx::spos p;
-			for(p.y = 0; p.y < rsrc.size.y; ++p.y) {
-				for(p.x = 0; p.x < rsrc.size.x; ++p.x) {
-					gray8	g;
-					if(isrc.get_pixel(p + rsrc.org, g)) {
-						rgba8	c;
-						c.r = c.g = c.b = g.g;
-						if(g.g) c.a = 255; else c.a = 0;
-						put_pixel(p + dst, c);
-					}
-				}
-			}
+			vtx::spos d = dst;
+			vtx::srect r = rsrc;
+			if(!clip_(d, isrc.get_size(), r)) return;
+			const span_kernels& k = get_span_kernels();
+			parallel_rows(r.size.x, r.size.y, [&](int y) {
+				const uint8_t* src = &isrc.get_img(r.org.y + y)[r.org.x].g;
+				k.expand_gray8(&img_[size_.x * (d.y + y) + d.x], src, r.size.x);
+			});
 		}
 
 
@@ -377,24 +449,66 @@ namespace img {
 		*/
 		//-----------------------------------------------------------------//
 		void blend(const vtx::spos& pdst, const img_rgba8& isrc, const vtx::srect& rsrc) {
-			vtx::spos p;
-			for(p.y = 0; p.y < rsrc.size.y; ++p.y) {
-				for(p.x = 0; p.x < rsrc.size.x; ++p.x) {
-					rgba8 sc;
-					if(isrc.get_pixel(p + rsrc.org, sc)) {
-						rgba8 dc;
-						if(get_pixel(p + pdst, dc)) {
-							dc.r = ((static_cast<uint16_t>(sc.a + 1) * static_cast<uint16_t>(sc.r)) >> 8) +
-								((static_cast<uint16_t>(256 - sc.a) * static_cast<uint16_t>(dc.r)) >> 8);
-							dc.g = ((static_cast<uint16_t>(sc.a + 1) * static_cast<uint16_t>(sc.g)) >> 8) +
-								((static_cast<uint16_t>(256 - sc.a) * static_cast<uint16_t>(dc.g)) >> 8);
-							dc.b = ((static_cast<uint16_t>(sc.a + 1) * static_cast<uint16_t>(sc.b)) >> 8) +
-								((static_cast<uint16_t>(256 - sc.a) * static_cast<uint16_t>(dc.b)) >> 8);
-							put_pixel(p + pdst, dc);
-						}
-					}
-				}
+			vtx::spos d = pdst;
+			vtx::srect r = rsrc;
+			if(!clip_(d, isrc.get_size(), r)) return;
+			const span_kernels& k = get_span_kernels();
+			if(overlap_(d, isrc, r)) {
+				overlap_rows_(d, r, k.blend_over);
+				return;
+			}
+			parallel_rows(r.size.x, r.size.y, [&](int y) {
+				k.blend_over(&img_[size_.x * (d.y + y) + d.x], isrc.get_img(r.org.y + y) + r.org.x, r.size.x);
+			});
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	プリマルチプライド・アルファ画像のブレンド
+			@param[in]	pdst	ブレンド先
+			@param[in]	isrc	ソースイメージ（RGB にアルファが乗算済み）
+			@param[in]	rsrc	ソースの領域
+		*/
+		//-----------------------------------------------------------------//
+		void blend_premultiplied(const vtx::spos& pdst, const img_rgba8& isrc, const vtx::srect& rsrc) {
+			vtx::spos d = pdst;
+			vtx::srect r = rsrc;
+			if(!clip_(d, isrc.get_size(), r)) return;
+			const span_kernels& k = get_span_kernels();
+			if(overlap_(d, isrc, r)) {
+				overlap_rows_(d, r, k.blend_premul);
+				return;
+			}
+			parallel_rows(r.size.x, r.size.y, [&](int y) {
+				k.blend_premul(&img_[size_.x * (d.y + y) + d.x], isrc.get_img(r.org.y + y) + r.org.x, r.size.x);
+			});
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	一定のアルファでイメージをブレンド（ソースのアルファは無視）
+			@param[in]	pdst	ブレンド先
+			@param[in]	isrc	ソースイメージ
+			@param[in]	rsrc	ソースの領域
+			@param[in]	alpha	ソースの不透明度
+		*/
+		//-----------------------------------------------------------------//
+		void blend(const vtx::spos& pdst, const img_rgba8& isrc, const vtx::srect& rsrc, uint8_t alpha) {
+			vtx::spos d = pdst;
+			vtx::srect r = rsrc;
+			if(!clip_(d, isrc.get_size(), r)) return;
+			const span_kernels& k = get_span_kernels();
+			if(overlap_(d, isrc, r)) {
+				overlap_rows_(d, r, [&](rgba8* dst, const rgba8* src, uint32_t n) {
+					k.blend_const(dst, src, n, alpha);
+				});
+				return;
 			}
+			parallel_rows(r.size.x, r.size.y, [&](int y) {
+				k.blend_const(&img_[size_.x * (d.y + y) + d.x], isrc.get_img(r.org.y + y) + r.org.x, r.size.x, alpha);
+			});
 		}
 
 
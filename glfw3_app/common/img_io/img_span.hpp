@@ -0,0 +1,556 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	RGBA8 スパン（水平ピクセル列）描画カーネル @n
+			SSE2 が有効な場合は４ピクセル単位で処理し、@n
+			端数はスカラーで処理する（結果はスカラー版と一致）。@n
+			イメージ間の合成、展開は、実行時に AVX2 が使えれば@n
+			AVX2 版を選択する。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IMG_SPAN_AVX2
+#endif
+#include "img_io/img.hpp"
+#include "utils/task_pool.hpp"
+
+namespace img {
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	１ピクセルのアルファ合成（書き込み先のアルファを考慮）
+		@param[in]	d	書き込み先
+		@param[in]	c	合成するカラー（アルファが「０」なら何もしない）
+	*/
+	//-----------------------------------------------------------------//
+	inline void blend_pixel(rgba8& d, const rgba8& c)
+	{
+		if(c.a == 0) return;
+		u16 a = static_cast<u16>(d.a) + 1;
+		a *= 256 - static_cast<u16>(c.a);
+		a >>= 8;
+		u16 r = static_cast<u16>(d.r) * a;
+		u16 g = static_cast<u16>(d.g) * a;
+		u16 b = static_cast<u16>(d.b) * a;
+		a = static_cast<u16>(c.a) + 1;
+		r += static_cast<u16>(c.r) * a;
+		g += static_cast<u16>(c.g) * a;
+		b += static_cast<u16>(c.b) * a;
+		d.r = r >> 8;
+		d.g = g >> 8;
+		d.b = b >> 8;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	スパンを単色で塗る
+		@param[in]	dst	書き込み先
+		@param[in]	n	ピクセル数
+		@param[in]	c	カラー
+	*/
+	//-----------------------------------------------------------------//
+	inline void fill_span(rgba8* dst, uint32_t n, const rgba8& c)
+	{
+		uint32_t i = 0;
+#ifdef __SSE2__
+		uint32_t v;
+		std::memcpy(&v, &c, 4);
+		const __m128i cv = _mm_set1_epi32(static_cast<int>(v));
+		for(; (i + 4) <= n; i += 4) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), cv);
+		}
+#endif
+		for(; i < n; ++i) {
+			dst[i] = c;
+		}
+	}
+
+
+#ifdef __SSE2__
+	// ２ピクセル分（16 ビット・レーン）の合成、ca1: c.a+1、ia0: 256-c.a
+	inline __m128i blend_px2_(__m128i d, __m128i cc, __m128i ca1, __m128i ia0)
+	{
+		const __m128i one = _mm_set1_epi16(1);
+		__m128i da = _mm_shufflehi_epi16(_mm_shufflelo_epi16(d, 0xff), 0xff);
+		__m128i ia = _mm_srli_epi16(_mm_mullo_epi16(_mm_add_epi16(da, one), ia0), 8);
+		__m128i r = _mm_add_epi16(_mm_mullo_epi16(d, ia), _mm_mullo_epi16(cc, ca1));
+		return _mm_srli_epi16(r, 8);
+	}
+#endif
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	スパンに単色をアルファ合成
+		@param[in]	dst	書き込み先
+		@param[in]	n	ピクセル数
+		@param[in]	c	カラー
+	*/
+	//-----------------------------------------------------------------//
+	inline void blend_span(rgba8* dst, uint32_t n, const rgba8& c)
+	{
+		if(c.a == 0) return;
+		if(c.a == 255) {
+			for(uint32_t i = 0; i < n; ++i) {
+				rgba8 t = c;
+				t.a = dst[i].a;
+				dst[i] = t;
+			}
+			return;
+		}
+		uint32_t i = 0;
+#ifdef __SSE2__
+		const __m128i z = _mm_setzero_si128();
+		const __m128i cc = _mm_setr_epi16(c.r, c.g, c.b, 0, c.r, c.g, c.b, 0);
+		const __m128i ca1 = _mm_set1_epi16(c.a + 1);
+		const __m128i ia0 = _mm_set1_epi16(256 - c.a);
+		const __m128i am = _mm_set1_epi32(static_cast<int>(0xff000000));
+		for(; (i + 4) <= n; i += 4) {
+			__m128i* p = reinterpret_cast<__m128i*>(dst + i);
+			__m128i d = _mm_loadu_si128(p);
+			__m128i lo = blend_px2_(_mm_unpacklo_epi8(d, z), cc, ca1, ia0);
+			__m128i hi = blend_px2_(_mm_unpackhi_epi8(d, z), cc, ca1, ia0);
+			__m128i r = _mm_packus_epi16(lo, hi);
+			_mm_storeu_si128(p, _mm_or_si128(_mm_andnot_si128(am, r), _mm_and_si128(am, d)));
+		}
+#endif
+		for(; i < n; ++i) {
+			blend_pixel(dst[i], c);
+		}
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	スパンにカバレッジ付きで単色をアルファ合成 @n
+				ピクセル毎のアルファは「(c.a * (cover + 1)) >> 8」
+		@param[in]	dst	書き込み先
+		@param[in]	cov	カバレッジ（０～２５５）
+		@param[in]	n	ピクセル数
+		@param[in]	c	カラー
+	*/
+	//-----------------------------------------------------------------//
+	inline void blend_span_cover(rgba8* dst, const uint8_t* cov, uint32_t n, const rgba8& c)
+	{
+		uint32_t i = 0;
+#ifdef __SSE2__
+		const __m128i z = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i c256 = _mm_set1_epi16(256);
+		const __m128i cav = _mm_set1_epi16(c.a);
+		const __m128i cc = _mm_setr_epi16(c.r, c.g, c.b, 0, c.r, c.g, c.b, 0);
+		const __m128i am = _mm_set1_epi32(static_cast<int>(0xff000000));
+		for(; (i + 4) <= n; i += 4) {
+			int32_t c4;
+			std::memcpy(&c4, cov + i, 4);
+			if(c4 == 0) continue;
+			__m128i cv = _mm_unpacklo_epi8(_mm_cvtsi32_si128(c4), z);
+			cv = _mm_unpacklo_epi16(cv, cv);
+			__m128i ca = _mm_srli_epi16(_mm_mullo_epi16(cav, _mm_add_epi16(cv, one)), 8);
+			__m128i ca_lo = _mm_unpacklo_epi32(ca, ca);
+			__m128i ca_hi = _mm_unpackhi_epi32(ca, ca);
+
+			__m128i* p = reinterpret_cast<__m128i*>(dst + i);
+			__m128i d = _mm_loadu_si128(p);
+			__m128i dl = _mm_unpacklo_epi8(d, z);
+			__m128i dh = _mm_unpackhi_epi8(d, z);
+			__m128i lo = blend_px2_(dl, cc, _mm_add_epi16(ca_lo, one), _mm_sub_epi16(c256, ca_lo));
+			__m128i hi = blend_px2_(dh, cc, _mm_add_epi16(ca_hi, one), _mm_sub_epi16(c256, ca_hi));
+			// アルファが「０」になるピクセルは書き換えない
+			__m128i ml = _mm_cmpeq_epi16(ca_lo, z);
+			__m128i mh = _mm_cmpeq_epi16(ca_hi, z);
+			lo = _mm_or_si128(_mm_and_si128(ml, dl), _mm_andnot_si128(ml, lo));
+			hi = _mm_or_si128(_mm_and_si128(mh, dh), _mm_andnot_si128(mh, hi));
+			__m128i r = _mm_packus_epi16(lo, hi);
+			_mm_storeu_si128(p, _mm_or_si128(_mm_andnot_si128(am, r), _mm_and_si128(am, d)));
+		}
+#endif
+		for(; i < n; ++i) {
+			rgba8 t = c;
+			t.a = (static_cast<u16>(c.a) * (static_cast<u16>(cov[i]) + 1)) >> 8;
+			blend_pixel(dst[i], t);
+		}
+	}
+
+
+	//-----------------------------------------------------------------//
+	//	イメージ間のスパン・カーネル（スカラー版が基準）
+	//-----------------------------------------------------------------//
+
+	// ストレート・アルファのオーバー合成（書き込み先のアルファは保持）
+	inline void blend_over_span_scalar_(rgba8* dst, const rgba8* src, uint32_t n)
+	{
+		for(uint32_t i = 0; i < n; ++i) {
+			const rgba8& sc = src[i];
+			rgba8& dc = dst[i];
+			uint16_t sa = static_cast<uint16_t>(sc.a + 1);
+			uint16_t da = static_cast<uint16_t>(256 - sc.a);
+			dc.r = ((sa * static_cast<uint16_t>(sc.r)) >> 8) + ((da * static_cast<uint16_t>(dc.r)) >> 8);
+			dc.g = ((sa * static_cast<uint16_t>(sc.g)) >> 8) + ((da * static_cast<uint16_t>(dc.g)) >> 8);
+			dc.b = ((sa * static_cast<uint16_t>(sc.b)) >> 8) + ((da * static_cast<uint16_t>(dc.b)) >> 8);
+		}
+	}
+
+
+	// プリマルチプライド・アルファのオーバー合成（アルファも合成）
+	inline void blend_premul_span_scalar_(rgba8* dst, const rgba8* src, uint32_t n)
+	{
+		for(uint32_t i = 0; i < n; ++i) {
+			const rgba8& sc = src[i];
+			rgba8& dc = dst[i];
+			uint16_t ia = static_cast<uint16_t>(256 - sc.a);
+			dc.r = std::min(255, sc.r + ((ia * dc.r) >> 8));
+			dc.g = std::min(255, sc.g + ((ia * dc.g) >> 8));
+			dc.b = std::min(255, sc.b + ((ia * dc.b) >> 8));
+			dc.a = std::min(255, sc.a + ((ia * dc.a) >> 8));
+		}
+	}
+
+
+	// 一定アルファでの合成（書き込み先のアルファは保持）
+	inline void blend_const_span_scalar_(rgba8* dst, const rgba8* src, uint32_t n, uint8_t alpha)
+	{
+		uint16_t sa = static_cast<uint16_t>(alpha) + 1;
+		uint16_t da = static_cast<uint16_t>(256 - alpha);
+		for(uint32_t i = 0; i < n; ++i) {
+			const rgba8& sc = src[i];
+			rgba8& dc = dst[i];
+			dc.r = (sa * sc.r + da * dc.r) >> 8;
+			dc.g = (sa * sc.g + da * dc.g) >> 8;
+			dc.b = (sa * sc.b + da * dc.b) >> 8;
+		}
+	}
+
+
+	// インデックス・カラーの展開
+	inline void expand_idx8_span_scalar_(rgba8* dst, const uint8_t* src, uint32_t n, const rgba8* clut)
+	{
+		for(uint32_t i = 0; i < n; ++i) {
+			dst[i] = clut[src[i]];
+		}
+	}
+
+
+	// グレースケールの展開（「０」は透明）
+	inline void expand_gray8_span_scalar_(rgba8* dst, const uint8_t* src, uint32_t n)
+	{
+		for(uint32_t i = 0; i < n; ++i) {
+			uint8_t g = src[i];
+			dst[i].set(g, g, g, g ? 255 : 0);
+		}
+	}
+
+
+#ifdef __SSE2__
+	inline void blend_over_span_sse2_(rgba8* dst, const rgba8* src, uint32_t n)
+	{
+		const __m128i z = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i c256 = _mm_set1_epi16(256);
+		const __m128i am = _mm_set1_epi32(static_cast<int>(0xff000000));
+		uint32_t i = 0;
+		for(; (i + 4) <= n; i += 4) {
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			__m128i r[2];
+			for(int j = 0; j < 2; ++j) {
+				__m128i s16 = j == 0 ? _mm_unpacklo_epi8(s, z) : _mm_unpackhi_epi8(s, z);
+				__m128i d16 = j == 0 ? _mm_unpacklo_epi8(d, z) : _mm_unpackhi_epi8(d, z);
+				__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xff), 0xff);
+				__m128i t0 = _mm_srli_epi16(_mm_mullo_epi16(_mm_add_epi16(a, one), s16), 8);
+				__m128i t1 = _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(c256, a), d16), 8);
+				r[j] = _mm_add_epi16(t0, t1);
+			}
+			__m128i o = _mm_packus_epi16(r[0], r[1]);
+			o = _mm_or_si128(_mm_andnot_si128(am, o), _mm_and_si128(am, d));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), o);
+		}
+		blend_over_span_scalar_(dst + i, src + i, n - i);
+	}
+
+
+	inline void blend_premul_span_sse2_(rgba8* dst, const rgba8* src, uint32_t n)
+	{
+		const __m128i z = _mm_setzero_si128();
+		const __m128i c256 = _mm_set1_epi16(256);
+		uint32_t i = 0;
+		for(; (i + 4) <= n; i += 4) {
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			__m128i r[2];
+			for(int j = 0; j < 2; ++j) {
+				__m128i s16 = j == 0 ? _mm_unpacklo_epi8(s, z) : _mm_unpackhi_epi8(s, z);
+				__m128i d16 = j == 0 ? _mm_unpacklo_epi8(d, z) : _mm_unpackhi_epi8(d, z);
+				__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xff), 0xff);
+				__m128i t = _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(c256, a), d16), 8);
+				r[j] = _mm_add_epi16(s16, t);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(r[0], r[1]));
+		}
+		blend_premul_span_scalar_(dst + i, src + i, n - i);
+	}
+
+
+	inline void blend_const_span_sse2_(rgba8* dst, const rgba8* src, uint32_t n, uint8_t alpha)
+	{
+		const __m128i z = _mm_setzero_si128();
+		const __m128i sa = _mm_set1_epi16(static_cast<short>(alpha) + 1);
+		const __m128i da = _mm_set1_epi16(256 - static_cast<short>(alpha));
+		const __m128i am = _mm_set1_epi32(static_cast<int>(0xff000000));
+		uint32_t i = 0;
+		for(; (i + 4) <= n; i += 4) {
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, z), sa),
+									   _mm_mullo_epi16(_mm_unpacklo_epi8(d, z), da));
+			__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, z), sa),
+									   _mm_mullo_epi16(_mm_unpackhi_epi8(d, z), da));
+			__m128i o = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+			o = _mm_or_si128(_mm_andnot_si128(am, o), _mm_and_si128(am, d));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), o);
+		}
+		blend_const_span_scalar_(dst + i, src + i, n - i, alpha);
+	}
+
+
+	inline void expand_gray8_span_sse2_(rgba8* dst, const uint8_t* src, uint32_t n)
+	{
+		const __m128i z = _mm_setzero_si128();
+		uint32_t i = 0;
+		for(; (i + 16) <= n; i += 16) {
+			__m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i a = _mm_andnot_si128(_mm_cmpeq_epi8(g, z), _mm_set1_epi8(-1));
+			__m128i gg_l = _mm_unpacklo_epi8(g, g);
+			__m128i gg_h = _mm_unpackhi_epi8(g, g);
+			__m128i ga_l = _mm_unpacklo_epi8(g, a);
+			__m128i ga_h = _mm_unpackhi_epi8(g, a);
+			__m128i* d = reinterpret_cast<__m128i*>(dst + i);
+			_mm_storeu_si128(d + 0, _mm_unpacklo_epi16(gg_l, ga_l));
+			_mm_storeu_si128(d + 1, _mm_unpackhi_epi16(gg_l, ga_l));
+			_mm_storeu_si128(d + 2, _mm_unpacklo_epi16(gg_h, ga_h));
+			_mm_storeu_si128(d + 3, _mm_unpackhi_epi16(gg_h, ga_h));
+		}
+		expand_gray8_span_scalar_(dst + i, src + i, n - i);
+	}
+#endif
+
+
+#ifdef IMG_SPAN_AVX2
+	__attribute__((target("avx2")))
+	inline void blend_over_span_avx2_(rgba8* dst, const rgba8* src, uint32_t n)
+	{
+		const __m256i z = _mm256_setzero_si256();
+		const __m256i one = _mm256_set1_epi16(1);
+		const __m256i c256 = _mm256_set1_epi16(256);
+		const __m256i am = _mm256_set1_epi32(static_cast<int>(0xff000000));
+		const __m256i sh = _mm256_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+											6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+		uint32_t i = 0;
+		for(; (i + 8) <= n; i += 8) {
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+			__m256i r[2];
+			for(int j = 0; j < 2; ++j) {
+				__m256i s16 = j == 0 ? _mm256_unpacklo_epi8(s, z) : _mm256_unpackhi_epi8(s, z);
+				__m256i d16 = j == 0 ? _mm256_unpacklo_epi8(d, z) : _mm256_unpackhi_epi8(d, z);
+				__m256i a = _mm256_shuffle_epi8(s16, sh);
+				__m256i t0 = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_add_epi16(a, one), s16), 8);
+				__m256i t1 = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(c256, a), d16), 8);
+				r[j] = _mm256_add_epi16(t0, t1);
+			}
+			__m256i o = _mm256_packus_epi16(r[0], r[1]);
+			o = _mm256_or_si256(_mm256_andnot_si256(am, o), _mm256_and_si256(am, d));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), o);
+		}
+		blend_over_span_scalar_(dst + i, src + i, n - i);
+	}
+
+
+	__attribute__((target("avx2")))
+	inline void blend_premul_span_avx2_(rgba8* dst, const rgba8* src, uint32_t n)
+	{
+		const __m256i z = _mm256_setzero_si256();
+		const __m256i c256 = _mm256_set1_epi16(256);
+		const __m256i sh = _mm256_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+											6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+		uint32_t i = 0;
+		for(; (i + 8) <= n; i += 8) {
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+			__m256i r[2];
+			for(int j = 0; j < 2; ++j) {
+				__m256i s16 = j == 0 ? _mm256_unpacklo_epi8(s, z) : _mm256_unpackhi_epi8(s, z);
+				__m256i d16 = j == 0 ? _mm256_unpacklo_epi8(d, z) : _mm256_unpackhi_epi8(d, z);
+				__m256i a = _mm256_shuffle_epi8(s16, sh);
+				__m256i t = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(c256, a), d16), 8);
+				r[j] = _mm256_add_epi16(s16, t);
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(r[0], r[1]));
+		}
+		blend_premul_span_scalar_(dst + i, src + i, n - i);
+	}
+
+
+	__attribute__((target("avx2")))
+	inline void blend_const_span_avx2_(rgba8* dst, const rgba8* src, uint32_t n, uint8_t alpha)
+	{
+		const __m256i z = _mm256_setzero_si256();
+		const __m256i sa = _mm256_set1_epi16(static_cast<short>(alpha) + 1);
+		const __m256i da = _mm256_set1_epi16(256 - static_cast<short>(alpha));
+		const __m256i am = _mm256_set1_epi32(static_cast<int>(0xff000000));
+		uint32_t i = 0;
+		for(; (i + 8) <= n; i += 8) {
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+			__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, z), sa),
+										  _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, z), da));
+			__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, z), sa),
+										  _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, z), da));
+			__m256i o = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+			o = _mm256_or_si256(_mm256_andnot_si256(am, o), _mm256_and_si256(am, d));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), o);
+		}
+		blend_const_span_scalar_(dst + i, src + i, n - i, alpha);
+	}
+
+
+	__attribute__((target("avx2")))
+	inline void expand_idx8_span_avx2_(rgba8* dst, const uint8_t* src, uint32_t n, const rgba8* clut)
+	{
+		const int* tbl = reinterpret_cast<const int*>(clut);
+		uint32_t i = 0;
+		for(; (i + 8) <= n; i += 8) {
+			__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_i32gather_epi32(tbl, idx, 4));
+		}
+		expand_idx8_span_scalar_(dst + i, src + i, n - i, clut);
+	}
+
+
+	__attribute__((target("avx2")))
+	inline void expand_gray8_span_avx2_(rgba8* dst, const uint8_t* src, uint32_t n)
+	{
+		const __m256i z = _mm256_setzero_si256();
+		const __m256i gm = _mm256_set1_epi32(0x00010101);
+		const __m256i am = _mm256_set1_epi32(static_cast<int>(0xff000000));
+		uint32_t i = 0;
+		for(; (i + 8) <= n; i += 8) {
+			__m256i g = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+			__m256i a = _mm256_andnot_si256(_mm256_cmpeq_epi32(g, z), am);
+			__m256i o = _mm256_or_si256(_mm256_mullo_epi32(g, gm), a);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), o);
+		}
+		expand_gray8_span_scalar_(dst + i, src + i, n - i);
+	}
+#endif
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	イメージ間スパン・カーネルのテーブル
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct span_kernels {
+		void (*blend_over)(rgba8* dst, const rgba8* src, uint32_t n);
+		void (*blend_premul)(rgba8* dst, const rgba8* src, uint32_t n);
+		void (*blend_const)(rgba8* dst, const rgba8* src, uint32_t n, uint8_t alpha);
+		void (*expand_idx8)(rgba8* dst, const uint8_t* src, uint32_t n, const rgba8* clut);
+		void (*expand_gray8)(rgba8* dst, const uint8_t* src, uint32_t n);
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	スカラー版のテーブルを得る（検証用）
+			@return	テーブル
+		*/
+		//-----------------------------------------------------------------//
+		static span_kernels scalar() {
+			span_kernels k;
+			k.blend_over   = blend_over_span_scalar_;
+			k.blend_premul = blend_premul_span_scalar_;
+			k.blend_const  = blend_const_span_scalar_;
+			k.expand_idx8  = expand_idx8_span_scalar_;
+			k.expand_gray8 = expand_gray8_span_scalar_;
+			return k;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	実行している CPU で最速のテーブルを得る
+			@return	テーブル
+		*/
+		//-----------------------------------------------------------------//
+		static span_kernels select() {
+			span_kernels k = scalar();
+#ifdef __SSE2__
+			k.blend_over   = blend_over_span_sse2_;
+			k.blend_premul = blend_premul_span_sse2_;
+			k.blend_const  = blend_const_span_sse2_;
+			k.expand_gray8 = expand_gray8_span_sse2_;
+#endif
+#ifdef IMG_SPAN_AVX2
+			if(__builtin_cpu_supports("avx2")) {
+				k.blend_over   = blend_over_span_avx2_;
+				k.blend_premul = blend_premul_span_avx2_;
+				k.blend_const  = blend_const_span_avx2_;
+				k.expand_idx8  = expand_idx8_span_avx2_;
+				k.expand_gray8 = expand_gray8_span_avx2_;
+			}
+#endif
+			return k;
+		}
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	使用するカーネル・テーブルを得る（初回に CPU を判定）
+		@return	テーブル
+	*/
+	//-----------------------------------------------------------------//
+	inline const span_kernels& get_span_kernels()
+	{
+		static const span_kernels k = span_kernels::select();
+		return k;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	行単位の処理を、大きな画像の場合は共有のスレッド・プールで @n
+				分割して行う
+		@param[in]	w	横幅（ピクセル数）
+		@param[in]	h	高さ（行数）
+		@param[in]	func	func(y) を各行について呼ぶ
+	*/
+	//-----------------------------------------------------------------//
+	template <class FUNC>
+	void parallel_rows(int w, int h, FUNC func)
+	{
+		static const int tile_pixels = 256 * 256;
+		utils::task_pool& pool = utils::task_pool::get_instance();
+		if(pool.size() > 1 && (w * h) >= (tile_pixels * 2)) {
+			int rows = std::max(1, tile_pixels / std::max(1, w));
+			int tiles = (h + rows - 1) / rows;
+			pool.run(tiles, [&](uint32_t i) {
+				int ye = std::min(h, static_cast<int>(i + 1) * rows);
+				for(int y = static_cast<int>(i) * rows; y < ye; ++y) func(y);
+			});
+		} else {
+			for(int y = 0; y < h; ++y) func(y);
+		}
+	}
+}
@@ -8,6 +8,7 @@
 */
 //=====================================================================//
 #include "img_io/img_utils.hpp"
+#include <algorithm>
 
 namespace img {
 
@@ -172,6 +173,285 @@ namespace img {
 	}
 
 
+	// 減色用ヒストグラム（RGB 各５ビット）
+	struct qbin_t {
+		uint32_t	n;
+		uint64_t	r, g, b, a;
+	};
+
+	static inline uint32_t qkey_(int r, int g, int b)
+	{
+		return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+	}
+
+	static inline int qdist_(const rgba8& c, int r, int g, int b)
+	{
+		int dr = c.r - r;
+		int dg = c.g - g;
+		int db = c.b - b;
+		return dr * dr + dg * dg + db * db;
+	}
+
+	static uint8_t nearest_(const rgba8* pal, int num, int r, int g, int b)
+	{
+		int idx = 0;
+		int min = qdist_(pal[0], r, g, b);
+		for(int i = 1; i < num; ++i) {
+			int d = qdist_(pal[i], r, g, b);
+			if(d < min) { min = d; idx = i; }
+		}
+		return idx;
+	}
+
+	static inline uint8_t clamp8_(int v)
+	{
+		return v < 0 ? 0 : (v > 255 ? 255 : v);
+	}
+
+
+	// 色数がパレット数以下なら、そのままパレットにする（誤差無し）
+	static bool exact_palette_(const img_rgba8* src, img_idx8& dst, int num)
+	{
+		static const uint32_t tsize = 1024;
+		uint32_t key[tsize];
+		int16_t slot[tsize];
+		std::fill(slot, slot + tsize, -1);
+		rgba8 pal[256];
+		int pn = 0;
+
+		const vtx::spos& size = src->get_size();
+		for(int y = 0; y < size.y; ++y) {
+			const rgba8* p = src->get_img(y);
+			idx8* d = dst.at_image(size.x * y);
+			uint32_t last = 0;
+			int li = -1;
+			for(int x = 0; x < size.x; ++x) {
+				const rgba8& c = p[x];
+				uint32_t k = c.r | (c.g << 8) | (c.b << 16) | (static_cast<uint32_t>(c.a) << 24);
+				if(li < 0 || k != last) {
+					uint32_t h = (k * 2654435761u) >> 22;
+					while(slot[h] >= 0 && key[h] != k) h = (h + 1) & (tsize - 1);
+					if(slot[h] < 0) {
+						if(pn >= num) return false;
+						key[h] = k;
+						slot[h] = pn;
+						pal[pn++] = c;
+					}
+					last = k;
+					li = slot[h];
+				}
+				d[x].i = li;
+			}
+		}
+		for(int i = 0; i < pn; ++i) {
+			dst.put_clut(i, pal[i]);
+		}
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	フルカラー画像を減色して IDX8 イメージを作成する
+		@param[in]	src		ソースのイメージ
+		@param[out]	dst		作成する IDX8 イメージ
+		@param[in]	num		パレット数（２～２５６）
+		@param[in]	dt		ディザ・タイプ
+		@return 成功したら「true」を返す。
+	*/
+	//-----------------------------------------------------------------//
+	bool quantize_to_idx8(const i_img* src, img_idx8& dst, int num, dither::type dt)
+	{
+		if(src == 0 || src->empty() || num < 2 || num > 256) return false;
+
+		const vtx::spos& size = src->get_size();
+		const img_rgba8* rgba = dynamic_cast<const img_rgba8*>(src);
+		img_rgba8 tmp;
+		if(rgba == 0) {
+			tmp.create(size, src->test_alpha());
+			copy_to_rgba8(src, tmp);
+			rgba = &tmp;
+		}
+
+		dst.destroy();
+		dst.create(size, src->test_alpha());
+		if(exact_palette_(rgba, dst, num)) return true;
+
+		// ヒストグラム
+		std::vector<qbin_t> hist(32768);
+		for(int y = 0; y < size.y; ++y) {
+			const rgba8* p = rgba->get_img(y);
+			for(int x = 0; x < size.x; ++x) {
+				const rgba8& c = p[x];
+				qbin_t& h = hist[qkey_(c.r, c.g, c.b)];
+				++h.n;
+				h.r += c.r; h.g += c.g; h.b += c.b; h.a += c.a;
+			}
+		}
+		std::vector<uint16_t> bins;
+		for(uint32_t i = 0; i < hist.size(); ++i) {
+			if(hist[i].n) bins.push_back(i);
+		}
+
+		// メディアンカットで初期パレットを作る
+		struct box_t {
+			uint32_t	org;
+			uint32_t	end;
+			uint64_t	n;
+			int			axis;
+			int			range;
+		};
+		auto setup_box = [&](box_t& bx) {
+			int mn[3] = { 31, 31, 31 };
+			int mx[3] = { 0, 0, 0 };
+			bx.n = 0;
+			for(uint32_t i = bx.org; i < bx.end; ++i) {
+				int v[3] = { bins[i] >> 10, (bins[i] >> 5) & 31, bins[i] & 31 };
+				for(int j = 0; j < 3; ++j) {
+					if(v[j] < mn[j]) mn[j] = v[j];
+					if(v[j] > mx[j]) mx[j] = v[j];
+				}
+				bx.n += hist[bins[i]].n;
+			}
+			bx.axis = 0;
+			bx.range = -1;
+			for(int j = 0; j < 3; ++j) {
+				if((mx[j] - mn[j]) > bx.range) { bx.range = mx[j] - mn[j]; bx.axis = j; }
+			}
+		};
+		std::vector<box_t> boxes;
+		box_t bx;
+		bx.org = 0;
+		bx.end = bins.size();
+		setup_box(bx);
+		boxes.push_back(bx);
+		while(static_cast<int>(boxes.size()) < num) {
+			int sel = -1;
+			uint64_t score = 0;
+			for(uint32_t i = 0; i < boxes.size(); ++i) {
+				const box_t& b = boxes[i];
+				if(b.range <= 0 || (b.end - b.org) < 2) continue;
+				uint64_t sc = b.n * static_cast<uint64_t>(b.range);
+				if(sel < 0 || sc > score) { sel = i; score = sc; }
+			}
+			if(sel < 0) break;
+			box_t& b = boxes[sel];
+			int sh = 10 - b.axis * 5;
+			std::sort(bins.begin() + b.org, bins.begin() + b.end, [=](uint16_t l, uint16_t r) {
+				return ((l >> sh) & 31) < ((r >> sh) & 31);
+			});
+			uint64_t half = b.n / 2;
+			uint64_t acc = 0;
+			uint32_t cut = b.org + 1;
+			for(uint32_t i = b.org; i < (b.end - 1); ++i) {
+				acc += hist[bins[i]].n;
+				cut = i + 1;
+				if(acc >= half) break;
+			}
+			box_t nb;
+			nb.org = cut;
+			nb.end = b.end;
+			b.end = cut;
+			setup_box(b);
+			setup_box(nb);
+			boxes.push_back(nb);
+		}
+
+		rgba8 pal[256];
+		int pn = boxes.size();
+		for(int i = 0; i < pn; ++i) {
+			uint64_t n = 0, r = 0, g = 0, b = 0, a = 0;
+			for(uint32_t j = boxes[i].org; j < boxes[i].end; ++j) {
+				const qbin_t& h = hist[bins[j]];
+				n += h.n; r += h.r; g += h.g; b += h.b; a += h.a;
+			}
+			pal[i].set(r / n, g / n, b / n, a / n);
+		}
+
+		// k-means で調整（ヒストグラムのビン単位）
+		for(int loop = 0; loop < 4; ++loop) {
+			std::vector<qbin_t> sum(pn);
+			for(uint32_t i = 0; i < bins.size(); ++i) {
+				const qbin_t& h = hist[bins[i]];
+				uint8_t k = nearest_(pal, pn, h.r / h.n, h.g / h.n, h.b / h.n);
+				qbin_t& q = sum[k];
+				q.n += h.n; q.r += h.r; q.g += h.g; q.b += h.b; q.a += h.a;
+			}
+			for(int i = 0; i < pn; ++i) {
+				const qbin_t& q = sum[i];
+				if(q.n) pal[i].set(q.r / q.n, q.g / q.n, q.b / q.n, q.a / q.n);
+			}
+		}
+
+		// 逆カラーマップ
+		std::vector<uint8_t> inv(32768);
+		for(uint32_t i = 0; i < inv.size(); ++i) {
+			int r = ((i >> 10) << 3) + 4;
+			int g = (((i >> 5) & 31) << 3) + 4;
+			int b = ((i & 31) << 3) + 4;
+			inv[i] = nearest_(pal, pn, r, g, b);
+		}
+
+		for(int i = 0; i < pn; ++i) {
+			dst.put_clut(i, pal[i]);
+		}
+
+		if(dt == dither::FLOYD_STEINBERG) {
+			// 誤差は 16 倍で保持
+			std::vector<int> err0((size.x + 2) * 3, 0);
+			std::vector<int> err1((size.x + 2) * 3, 0);
+			for(int y = 0; y < size.y; ++y) {
+				const rgba8* p = rgba->get_img(y);
+				idx8* d = dst.at_image(size.x * y);
+				std::fill(err1.begin(), err1.end(), 0);
+				for(int x = 0; x < size.x; ++x) {
+					int* e = &err0[(x + 1) * 3];
+					int r = clamp8_(p[x].r + e[0] / 16);
+					int g = clamp8_(p[x].g + e[1] / 16);
+					int b = clamp8_(p[x].b + e[2] / 16);
+					uint8_t k = inv[qkey_(r, g, b)];
+					d[x].i = k;
+					int ev[3] = { r - pal[k].r, g - pal[k].g, b - pal[k].b };
+					for(int j = 0; j < 3; ++j) {
+						e[3 + j]              += ev[j] * 7;
+						err1[x * 3 + j]       += ev[j] * 3;
+						err1[(x + 1) * 3 + j] += ev[j] * 5;
+						err1[(x + 2) * 3 + j] += ev[j];
+					}
+				}
+				err0.swap(err1);
+			}
+		} else {
+			static const uint8_t bayer[64] = {
+				 0, 32,  8, 40,  2, 34, 10, 42,
+				48, 16, 56, 24, 50, 18, 58, 26,
+				12, 44,  4, 36, 14, 46,  6, 38,
+				60, 28, 52, 20, 62, 30, 54, 22,
+				 3, 35, 11, 43,  1, 33,  9, 41,
+				51, 19, 59, 27, 49, 17, 57, 25,
+				15, 47,  7, 39, 13, 45,  5, 37,
+				63, 31, 55, 23, 61, 29, 53, 21
+			};
+			for(int y = 0; y < size.y; ++y) {
+				const rgba8* p = rgba->get_img(y);
+				idx8* d = dst.at_image(size.x * y);
+				if(dt == dither::ORDERED) {
+					for(int x = 0; x < size.x; ++x) {
+						// ヒストグラムの量子化幅（８）に合わせた閾値
+						int t = (static_cast<int>(bayer[((y & 7) << 3) | (x & 7)]) - 32) / 8;
+						d[x].i = inv[qkey_(clamp8_(p[x].r + t), clamp8_(p[x].g + t), clamp8_(p[x].b + t))];
+					}
+				} else {
+					for(int x = 0; x < size.x; ++x) {
+						d[x].i = inv[qkey_(p[x].r, p[x].g, p[x].b)];
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	50% にリサイズされた画像イメージを生成する
@@ -102,6 +102,37 @@ namespace img {
 	}
 
 
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	減色時のディザ・タイプ
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct dither {
+		enum type {
+			NONE,				///< ディザ無し
+			ORDERED,			///< 組織的ディザ（8x8 Bayer）
+			FLOYD_STEINBERG,	///< 誤差拡散（Floyd-Steinberg）
+		};
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	フルカラー画像を減色して IDX8 イメージを作成する @n
+				色数がパレット数以下の場合は、その色をそのまま使う。@n
+				それ以外は、ヒストグラム（RGB 各５ビット）からメディアンカットで @n
+				初期パレットを作り、k-means で調整する。@n
+				パレットの検索には３次元の逆カラーマップを使う。
+		@param[in]	src		ソースのイメージ
+		@param[out]	dst		作成する IDX8 イメージ
+		@param[in]	num		パレット数（２～２５６）
+		@param[in]	dt		ディザ・タイプ
+		@return 成功したら「true」を返す。
+	*/
+	//-----------------------------------------------------------------//
+	bool quantize_to_idx8(const i_img* src, img_idx8& dst, int num = 256, dither::type dt = dither::NONE);
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	50% にリサイズされた画像イメージを生成する
@@ -10,6 +10,7 @@
 #include "paint.hpp"
 #include "core/ftimg.hpp"
 #include <cmath>
+#include <algorithm>
 
 namespace img {
 
@@ -59,43 +60,234 @@ namespace img {
 	}
 
 
+	void paint::span_(const img::rgba8& c, short x, short y, short len)
+	{
+		const vtx::spos& sz = get_size();
+		if(empty() || y < 0 || y >= sz.y) return;
+		int xs = x;
+		int xe = static_cast<int>(x) + len;
+		if(xs < 0) xs = 0;
+		if(xe > sz.x) xe = sz.x;
+		if(xs >= xe) return;
+		rgba8* dst = at_image(sz.x * y + xs);
+		if(alpha_blend_) {
+			blend_span(dst, xe - xs, c);
+		} else {
+			fill_span(dst, xe - xs, c);
+		}
+	}
+
+
 	void paint::h_line_(const img::rgba8& c, const vtx::spos& pos, short len)
 	{
-		short l = 0;
-		for(short i = 0; i < std::abs(len); ++i) {
-			plot(vtx::spos(pos.x + l, pos.y), c);
-			if(len < 0) --l; else ++l;
+		if(len < 0) {
+			span_(c, pos.x + len + 1, pos.y, -len);
+		} else {
+			span_(c, pos.x, pos.y, len);
 		}
 	}
 
 
 	void paint::h_line_gray_(const img::rgba8& c, const vtx::spos& pos, short len)
 	{
+		const vtx::spos& sz = get_size();
+		if(empty() || pos.y < 0 || pos.y >= sz.y) return;
+		rgba8* dst = at_image(sz.x * pos.y);
 		img::rgba8 cc = c;
 		short l = 0;
 		short d = std::abs(len);
 		for(short i = 0; i < d; ++i) {
-			int a = static_cast<int>(d - i) * static_cast<int>(c.a) / d;
-			cc.a = a;
-			plot(vtx::spos(pos.x + l, pos.y), cc);
+			int x = pos.x + l;
+			if(x >= 0 && x < sz.x) {
+				cc.a = static_cast<int>(d - i) * static_cast<int>(c.a) / d;
+				if(alpha_blend_) blend_pixel(dst[x], cc);
+				else dst[x] = cc;
+			}
 			if(len < 0) --l; else ++l;
 		}
 	}
 
 
-	void paint::make_scan_line_(const vtx::spos& st, const vtx::spos& en, int min, lines& lns)
+	// ピクセル中心でサンプリングし、ノンゼロ規則で内側となるスパンを塗る
+	void paint::fill_polygon_span_(const vtx::sposs& points)
 	{
-		int divx = en.x - st.x;
-		int divy = std::abs(en.y - st.y);
-		int idx = st.y;
-		for(int i = 0; i < divy; ++i) {
-			int v = st.x + divx * i / divy;
-			uint32_t pos = idx - min;
-			if(pos < lns.size()) {
-				lns[pos].set(v);
+		edges_.clear();
+		int ymin = points[0].y;
+		int ymax = points[0].y;
+		for(uint32_t i = 0; i < points.size(); ++i) {
+			const vtx::spos& t = points[i];
+			const vtx::spos& b = points[(i + 1) % points.size()];
+			if(t.y < ymin) ymin = t.y;
+			if(t.y > ymax) ymax = t.y;
+			if(t.y == b.y) continue;
+			edge_t e;
+			if(t.y < b.y) {
+				e.y0 = t.y; e.y1 = b.y; e.x0 = t.x; e.dir =  1;
+				e.dxdy = static_cast<float>(b.x - t.x) / static_cast<float>(b.y - t.y);
+			} else {
+				e.y0 = b.y; e.y1 = t.y; e.x0 = b.x; e.dir = -1;
+				e.dxdy = static_cast<float>(t.x - b.x) / static_cast<float>(t.y - b.y);
+			}
+			edges_.push_back(e);
+		}
+		if(edges_.empty()) return;
+
+		if(ymin < 0) ymin = 0;
+		if(ymax > get_size().y) ymax = get_size().y;
+		for(int y = ymin; y < ymax; ++y) {
+			float yc = static_cast<float>(y) + 0.5f;
+			crosses_.clear();
+			for(uint32_t i = 0; i < edges_.size(); ++i) {
+				const edge_t& e = edges_[i];
+				if(e.y0 <= yc && yc < e.y1) {
+					cross_t c;
+					c.x = e.x0 + (yc - e.y0) * e.dxdy;
+					c.dir = e.dir;
+					crosses_.push_back(c);
+				}
+			}
+			std::sort(crosses_.begin(), crosses_.end());
+
+			int wind = 0;
+			float xs = 0.0f;
+			for(uint32_t i = 0; i < crosses_.size(); ++i) {
+				int w = wind + crosses_[i].dir;
+				if(wind == 0 && w != 0) {
+					xs = crosses_[i].x;
+				} else if(wind != 0 && w == 0) {
+					int xa = static_cast<int>(std::ceil(xs - 0.5f));
+					int xb = static_cast<int>(std::ceil(crosses_[i].x - 0.5f));
+					if(xa < xb) {
+						span_(fore_color_, xa, y, xb - xa);
+					}
+				}
+				wind = w;
+			}
+		}
+	}
+
+
+	// エッジの符号付き面積を蓄積し、行毎の累積和からカバレッジを得る
+	// 蓄積バッファは画像の範囲に切り取り、左にはみ出た分は先頭の列に積む
+	void paint::fill_polygon_aa_(const vtx::sposs& points)
+	{
+		int xmin = points[0].x;
+		int xmax = points[0].x;
+		int ymin = points[0].y;
+		int ymax = points[0].y;
+		for(uint32_t i = 1; i < points.size(); ++i) {
+			const vtx::spos& p = points[i];
+			if(p.x < xmin) xmin = p.x;
+			if(p.x > xmax) xmax = p.x;
+			if(p.y < ymin) ymin = p.y;
+			if(p.y > ymax) ymax = p.y;
+		}
+		const vtx::spos& sz = get_size();
+		int by0 = ymin < 0 ? 0 : ymin;
+		int by1 = ymax > sz.y ? sz.y : ymax;
+		if(empty() || by0 >= by1 || xmin >= sz.x || xmax <= 0) return;
+
+		int bx0 = xmin < 0 ? 0 : xmin;
+		int bx1 = (xmax + 2) > sz.x ? sz.x : (xmax + 2);
+		int bw = bx1 - bx0;
+		int bh = by1 - by0;
+		cover_acc_.assign(bw * bh, 0.0f);
+		cover_line_.resize(bw);
+
+		for(uint32_t i = 0; i < points.size(); ++i) {
+			const vtx::spos& t = points[i];
+			const vtx::spos& b = points[(i + 1) % points.size()];
+			if(t.y == b.y) continue;
+			float dir;
+			float p0x, p0y, p1x, p1y;
+			if(t.y < b.y) {
+				dir =  1.0f;
+				p0x = t.x - bx0; p0y = t.y - by0; p1x = b.x - bx0; p1y = b.y - by0;
+			} else {
+				dir = -1.0f;
+				p0x = b.x - bx0; p0y = b.y - by0; p1x = t.x - bx0; p1y = t.y - by0;
+			}
+			float dxdy = (p1x - p0x) / (p1y - p0y);
+			float x = p0x;
+			int ys = static_cast<int>(std::floor(p0y));
+			if(ys < 0) {
+				x -= p0y * dxdy;
+				ys = 0;
+			}
+			int ye = static_cast<int>(std::ceil(p1y));
+			if(ye > bh) ye = bh;
+			for(int y = ys; y < ye; ++y) {
+				float* acc = &cover_acc_[y * bw];
+				auto add = [acc, bw](int xi, float v) {
+					if(xi < 0) xi = 0;
+					if(xi < bw) acc[xi] += v;
+				};
+				float dy = std::min(static_cast<float>(y + 1), p1y) - std::max(static_cast<float>(y), p0y);
+				float xnext = x + dxdy * dy;
+				float d = dy * dir;
+				float x0 = std::min(x, xnext);
+				float x1 = std::max(x, xnext);
+				float x0f = std::floor(x0);
+				int x0i = static_cast<int>(x0f);
+				float x1c = std::ceil(x1);
+				int x1i = static_cast<int>(x1c);
+				if(x1i <= (x0i + 1)) {
+					float xm = 0.5f * (x + xnext) - x0f;
+					add(x0i, d - d * xm);
+					add(x0i + 1, d * xm);
+				} else {
+					float s = 1.0f / (x1 - x0);
+					float x0r = x0 - x0f;
+					float a0 = 0.5f * s * (1.0f - x0r) * (1.0f - x0r);
+					float x1r = x1 - x1c + 1.0f;
+					float am = 0.5f * s * x1r * x1r;
+					add(x0i, d * a0);
+					if(x1i == (x0i + 2)) {
+						add(x0i + 1, d * (1.0f - a0 - am));
+					} else {
+						float a1 = s * (1.5f - x0r);
+						add(x0i + 1, d * (a1 - a0));
+						int xs = x0i + 2;
+						int xe = x1i - 1;
+						if(xs < 0) {
+							int n = std::min(xe, 0) - xs;
+							if(n > 0) acc[0] += d * s * static_cast<float>(n);
+							xs = 0;
+						}
+						if(xe > bw) xe = bw;
+						for(int xi = xs; xi < xe; ++xi) {
+							acc[xi] += d * s;
+						}
+						float a2 = a1 + static_cast<float>(x1i - x0i - 3) * s;
+						add(x1i - 1, d * (1.0f - a2 - am));
+					}
+					add(x1i, d * am);
+				}
+				x = xnext;
+			}
+		}
+
+		for(int y = 0; y < bh; ++y) {
+			const float* acc = &cover_acc_[y * bw];
+			float sum = 0.0f;
+			for(int x = 0; x < bw; ++x) {
+				sum += acc[x];
+				float a = std::fabs(sum);
+				cover_line_[x] = a >= 1.0f ? 255 : static_cast<uint8_t>(a * 255.0f + 0.5f);
+			}
+			rgba8* dst = at_image(sz.x * (by0 + y) + bx0);
+			int x = 0;
+			while(x < bw) {
+				int n = x;
+				if(cover_line_[x] == 255) {
+					while(n < bw && cover_line_[n] == 255) ++n;
+					span_(fore_color_, bx0 + x, by0 + y, n - x);
+				} else {
+					while(n < bw && cover_line_[n] != 255) ++n;
+					blend_span_cover(dst + x, &cover_line_[x], n - x, fore_color_);
+				}
+				x = n;
 			}
-			if(st.y < en.y) ++idx;
-			else --idx;
 		}
 	}
 
@@ -110,27 +302,15 @@ namespace img {
 	//-----------------------------------------------------------------//
 	bool paint::plot(const vtx::spos& p, const rgba8& c)
 	{
+		const vtx::spos& sz = get_size();
+		if(empty() || p.x < 0 || p.x >= sz.x || p.y < 0 || p.y >= sz.y) return false;
+		rgba8& d = *at_image(sz.x * p.y + p.x);
 		if(alpha_blend_) {
-			rgba8 bc;
-			if(get_pixel(p, bc)) {
-				u16 a = static_cast<u16>(bc.a) + 1;
-				a *= 256 - static_cast<u16>(c.a);
-				a >>= 8;
-				u16 r = static_cast<u16>(bc.r) * a;
-				u16 g = static_cast<u16>(bc.g) * a;
-				u16 b = static_cast<u16>(bc.b) * a;
-				a = static_cast<u16>(c.a) + 1;
-				r += static_cast<u16>(c.r) * a;
-				g += static_cast<u16>(c.g) * a;
-				b += static_cast<u16>(c.b) * a;
-				put_pixel(p, rgba8(r >> 8, g >> 8, b >> 8, bc.a));
-				return true;
-			} else {
-				return false;
-			}
+			blend_pixel(d, c);
 		} else {
-			return put_pixel(p, c);
+			d = c;
 		}
+		return true;
 	}
 
 
@@ -303,7 +483,7 @@ namespace img {
 	void paint::fill_circle(const vtx::spos& center, int radius)
 	{
 		using vtx::spos;
-		short ln;
+		short ln = radius - 1;
 		for(int dy = 0; dy < radius; ++dy) {
 			int r = radius - 1;
 			int dx = static_cast<int>(sqrtf(r * r - dy * dy) * 256.0f);
@@ -337,7 +517,7 @@ namespace img {
 
 	//-----------------------------------------------------------------//
 	/*!
-		@brief	ポリゴンを描画
+		@brief	ポリゴンを描画（ノンゼロ・ワインディング規則）
 		@param[in]	points	点集合
 	*/
 	//-----------------------------------------------------------------//
@@ -345,36 +525,10 @@ namespace img {
 	{
 		if(points.size() < 3) return;
 
-		using vtx::spos;
-
-		line_t lx;
-		lx.init(points[0].x);
-		line_t ly;
-		ly.init(points[0].y);
-		for(uint32_t i = 1; i < points.size(); ++i) {
-			lx.set(points[i].x);
-			ly.set(points[i].y);
-		}
-
-		lines ls;
-		line_t iv;
-		iv.min = lx.max;
-		iv.max = lx.min;
-		ls.resize(ly.len(), iv);
-		for(uint32_t i = 0; i < points.size(); ++i) {
-			const spos& t = points[i];
-			uint32_t j = i + 1;
-			if(j >= points.size()) j = 0;
-			const spos& b = points[j];
-			make_scan_line_(t, b, ly.min, ls);
-		}
-
-		for(uint32_t i = 0; i < ls.size(); ++i) {
-			const line_t& t = ls[i];
-			short y = ly.min + i;
-			if(y >= 0 && y < get_size().y) {
-				h_line_(fore_color_, spos(t.min, y), t.len());
-			}
+		if(anti_alias_) {
+			fill_polygon_aa_(points);
+		} else {
+			fill_polygon_span_(points);
 		}
 	}
 
@@ -13,6 +13,7 @@
 #include "i_img.hpp"
 #include "img_rgba8.hpp"
 #include "img_utils.hpp"
+#include "img_span.hpp"
 #include <stack>
 #include "utils/vtx.hpp"
 #include "utils/string_utils.hpp"
@@ -77,17 +78,23 @@ namespace img {
 		};
 
 	private:
-		struct line_t {
-			short	min;
-			short	max;
-			void init(short v) { min = max = v; }
-			void set(short v) {
-				if(v < min) min = v;
-				if(max < v) max = v;
-			}
-			short len() const { return max - min; }
+		// ポリゴンのエッジ（上端から下端へ）
+		struct edge_t {
+			float	y0;
+			float	y1;
+			float	x0;
+			float	dxdy;
+			int		dir;
+		};
+		typedef std::vector<edge_t> edges;
+
+		// スキャンラインとエッジの交点
+		struct cross_t {
+			float	x;
+			int		dir;
+			bool operator < (const cross_t& t) const { return x < t.x; }
 		};
-		typedef std::vector<line_t> lines;
+		typedef std::vector<cross_t> crosses;
 
 		rgba8				fore_color_;
 		rgba8				back_color_;
@@ -102,11 +109,20 @@ namespace img {
 		short				font_space_;
 
 		bool				alpha_blend_;
+		bool				anti_alias_;
+
+		// ポリゴン描画の作業領域（描画毎に確保しない）
+		edges				edges_;
+		crosses				crosses_;
+		std::vector<float>	cover_acc_;
+		std::vector<uint8_t>	cover_line_;
 
 		void make_round_tables_();
+		void span_(const img::rgba8& c, short x, short y, short len);
 		void h_line_(const img::rgba8& c, const vtx::spos& pos, short len);
 		void h_line_gray_(const img::rgba8& c, const vtx::spos& pos, short len);
-		void make_scan_line_(const vtx::spos& st, const vtx::spos& en, int ofs, lines& lns);
+		void fill_polygon_span_(const vtx::sposs& points);
+		void fill_polygon_aa_(const vtx::sposs& points);
 
 	public:
 		//-----------------------------------------------------------------//
@@ -118,7 +134,7 @@ namespace img {
 			inten_rect_(255),
 			round_radius_(0),
 			font_size_(24), font_space_(2),
-			alpha_blend_(false)
+			alpha_blend_(false), anti_alias_(false)
 		{ }
 
 
@@ -139,6 +155,16 @@ namespace img {
 		void alpha_blend(bool f = true) { alpha_blend_ = f; }
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ポリゴンのアンチエイリアスの設定 @n
+					有効な場合、エッジはカバレッジに応じて合成される
+			@param[in]	f	「false」なら無効
+		*/
+		//-----------------------------------------------------------------//
+		void anti_alias(bool f = true) { anti_alias_ = f; }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	ラウンドの設定
@@ -280,7 +306,7 @@ namespace img {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	ポリゴンを描画
+			@brief	ポリゴンを描画（ノンゼロ・ワインディング規則）
 			@param[in]	points	点集合
 		*/
 		//-----------------------------------------------------------------//
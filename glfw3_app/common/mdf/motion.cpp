@@ -0,0 +1,622 @@
+//=====================================================================//
+/*!	@file
+	@brief	モーション評価クラス
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include "mdf/motion.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/task_pool.hpp"
+
+namespace mdf {
+
+	namespace {
+
+		enum append_flag_ {
+			APPEND_ROTATE = 1,
+			APPEND_MOVE = 2,
+		};
+
+		// 素集合（島の分割用）
+		struct union_find_ {
+			std::vector<uint32_t>	parent_;
+			explicit union_find_(uint32_t n) : parent_(n) {
+				for(uint32_t i = 0; i < n; ++i) parent_[i] = i;
+			}
+			uint32_t find(uint32_t i) {
+				while(parent_[i] != i) {
+					parent_[i] = parent_[parent_[i]];
+					i = parent_[i];
+				}
+				return i;
+			}
+			void join(uint32_t a, uint32_t b) {
+				a = find(a);
+				b = find(b);
+				if(a != b) parent_[b] = a;
+			}
+		};
+
+		// R = Rx * Ry * Rz としてオイラー角へ分解
+		vtx::fvtx to_euler_(const qtx::fquat& q)
+		{
+			float r00 = 1.0f - 2.0f * (q.y * q.y + q.z * q.z);
+			float r01 = 2.0f * (q.x * q.y - q.w * q.z);
+			float r02 = 2.0f * (q.x * q.z + q.w * q.y);
+			float r12 = 2.0f * (q.y * q.z - q.w * q.x);
+			float r22 = 1.0f - 2.0f * (q.x * q.x + q.y * q.y);
+			if(r02 > 1.0f) r02 = 1.0f;
+			else if(r02 < -1.0f) r02 = -1.0f;
+			return vtx::fvtx(std::atan2(-r12, r22), std::asin(r02), std::atan2(-r01, r00));
+		}
+
+		qtx::fquat from_euler_(const vtx::fvtx& e)
+		{
+			qtx::fquat qx(std::sin(e.x * 0.5f), 0.0f, 0.0f, std::cos(e.x * 0.5f));
+			qtx::fquat qy(0.0f, std::sin(e.y * 0.5f), 0.0f, std::cos(e.y * 0.5f));
+			qtx::fquat qz(0.0f, 0.0f, std::sin(e.z * 0.5f), std::cos(e.z * 0.5f));
+			return qx * qy * qz;
+		}
+
+		float clamp_(float v, float lo, float hi)
+		{
+			if(v < lo) return lo;
+			if(v > hi) return hi;
+			return v;
+		}
+	}
+
+
+	void motion::split_islands_()
+	{
+		uint32_t n = order_.size();
+		trunk_.clear();
+		islands_.clear();
+
+		// 付与、IK に関わるボーン
+		std::vector<uint8_t> used(n, 0);
+		for(uint32_t s = 0; s < n; ++s) {
+			if(append_[s] >= 0) {
+				used[s] = 1;
+				used[append_[s]] = 1;
+			}
+		}
+		for(const ik_& t : iks_) {
+			used[t.bone_] = 1;
+			used[t.target_] = 1;
+			for(const ik_link_& l : t.links_) used[l.bone_] = 1;
+		}
+
+		// 関わらないルートを幹にして、幹の子孫を島に分ける。
+		// 最大の島がボーン数の半分を超える間は、その島の先頭を幹に移す。
+		std::vector<uint8_t> trunk(n, 0);
+		for(uint32_t s = 0; s < n; ++s) {
+			if(parent_[s] < 0 && !used[s]) trunk[s] = 1;
+		}
+		while(1) {
+			union_find_ uf(n);
+			for(uint32_t s = 0; s < n; ++s) {
+				if(trunk[s]) continue;
+				if(parent_[s] >= 0 && !trunk[parent_[s]]) uf.join(parent_[s], s);
+				if(append_[s] >= 0) uf.join(append_[s], s);
+			}
+			for(const ik_& t : iks_) {
+				uf.join(t.bone_, t.target_);
+				for(const ik_link_& l : t.links_) uf.join(t.bone_, l.bone_);
+			}
+
+			trunk_.clear();
+			islands_.clear();
+			std::vector<int32_t> island_of(n, -1);
+			for(uint32_t s = 0; s < n; ++s) {
+				if(trunk[s]) {
+					trunk_.push_back(s);
+					continue;
+				}
+				uint32_t r = uf.find(s);
+				if(island_of[r] < 0) {
+					island_of[r] = islands_.size();
+					islands_.push_back(island());
+				}
+				islands_[island_of[r]].push_back(s);
+			}
+
+			const island* big = nullptr;
+			for(const island& is : islands_) {
+				if(big == nullptr || big->size() < is.size()) big = &is;
+			}
+			if(big == nullptr || big->size() * 2 <= n) break;
+			uint32_t top = (*big)[0];
+			if(used[top]) break;
+			if(parent_[top] >= 0 && !trunk[parent_[top]]) break;
+			trunk[top] = 1;
+		}
+	}
+
+
+	bool motion::setup(const bones& bs, const iks& is)
+	{
+		uint32_t n = bs.size();
+
+		order_.clear();
+		parent_.clear();
+		offset_.clear();
+		bind_.clear();
+		append_.clear();
+		append_gain_.clear();
+		append_flags_.clear();
+		ik_index_.clear();
+		name_.clear();
+		iks_.clear();
+		trunk_.clear();
+		islands_.clear();
+		track_.clear();
+		vmd_ = nullptr;
+
+		// 依存（親、付与親）を集めて、優先度付きのトポロジカル・ソート
+		std::vector<int32_t> parent(n, -1);
+		std::vector<int32_t> append(n, -1);
+		std::vector<uint32_t> degree(n, 0);
+		std::vector<std::vector<uint32_t> > next(n);
+		for(uint32_t i = 0; i < n; ++i) {
+			const bone& b = bs[i];
+			if(b.parent_ >= 0 && static_cast<uint32_t>(b.parent_) < n
+				&& static_cast<uint32_t>(b.parent_) != i) {
+				parent[i] = b.parent_;
+				next[b.parent_].push_back(i);
+				++degree[i];
+			}
+			if((b.append_rotate_ || b.append_move_) && b.append_ >= 0
+				&& static_cast<uint32_t>(b.append_) < n && static_cast<uint32_t>(b.append_) != i) {
+				append[i] = b.append_;
+				if(b.append_ != parent[i]) {
+					next[b.append_].push_back(i);
+					++degree[i];
+				}
+			}
+		}
+
+		auto later = [&bs](uint32_t a, uint32_t b) {
+			if(bs[a].after_physics_ != bs[b].after_physics_) return bs[a].after_physics_;
+			if(bs[a].level_ != bs[b].level_) return bs[a].level_ > bs[b].level_;
+			return a > b;
+		};
+		std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(later)> que(later);
+		for(uint32_t i = 0; i < n; ++i) {
+			if(degree[i] == 0) que.push(i);
+		}
+		order_.reserve(n);
+		while(!que.empty()) {
+			uint32_t i = que.top();
+			que.pop();
+			order_.push_back(i);
+			for(uint32_t c : next[i]) {
+				if(--degree[c] == 0) que.push(c);
+			}
+		}
+		if(order_.size() != n) {
+			order_.clear();
+			return false;
+		}
+
+		std::vector<uint32_t> rank(n);
+		for(uint32_t s = 0; s < n; ++s) rank[order_[s]] = s;
+
+		parent_.resize(n);
+		offset_.resize(n);
+		bind_.resize(n);
+		append_.resize(n);
+		append_gain_.resize(n);
+		append_flags_.resize(n);
+		ik_index_.assign(n, -1);
+		name_.resize(n);
+		for(uint32_t s = 0; s < n; ++s) {
+			uint32_t i = order_[s];
+			const bone& b = bs[i];
+			name_[s] = b.name_;
+			bind_[s] = b.position_;
+			if(parent[i] >= 0) {
+				parent_[s] = rank[parent[i]];
+				offset_[s] = b.position_ - bs[parent[i]].position_;
+			} else {
+				parent_[s] = -1;
+				offset_[s] = b.position_;
+			}
+			if(append[i] >= 0) {
+				append_[s] = rank[append[i]];
+				append_gain_[s] = b.append_gain_;
+				append_flags_[s] = (b.append_rotate_ ? APPEND_ROTATE : 0)
+					| (b.append_move_ ? APPEND_MOVE : 0);
+			} else {
+				append_[s] = -1;
+				append_gain_[s] = 0.0f;
+				append_flags_[s] = 0;
+			}
+		}
+
+		// IK（番号を並べ替え後に変換）
+		for(const ik& k : is) {
+			if(k.bone_ < 0 || static_cast<uint32_t>(k.bone_) >= n) continue;
+			if(k.target_ < 0 || static_cast<uint32_t>(k.target_) >= n) continue;
+			ik_ t;
+			t.bone_ = rank[k.bone_];
+			t.target_ = rank[k.target_];
+			t.loop_ = k.loop_;
+			t.limit_ = k.limit_ > 0.0f ? k.limit_ : vtx::get_pi<float>();
+			for(const ik_link& l : k.links_) {
+				if(l.bone_ < 0 || static_cast<uint32_t>(l.bone_) >= n) continue;
+				ik_link_ tl;
+				tl.bone_ = rank[l.bone_];
+				tl.limit_ = l.limit_;
+				tl.lower_ = l.lower_;
+				tl.upper_ = l.upper_;
+				tl.axis_x_ = l.limit_ && l.lower_.y == 0.0f && l.upper_.y == 0.0f
+					&& l.lower_.z == 0.0f && l.upper_.z == 0.0f;
+				t.links_.push_back(tl);
+			}
+			if(t.links_.empty()) continue;
+
+			// エフェクターから最上位のリンクまでの経路
+			uint32_t top = t.links_[0].bone_;
+			for(const ik_link_& l : t.links_) {
+				if(l.bone_ < top) top = l.bone_;
+			}
+			{
+				std::vector<uint32_t> path;
+				int32_t c = t.target_;
+				while(c >= 0) {
+					path.push_back(c);
+					if(static_cast<uint32_t>(c) == top) break;
+					c = parent_[c];
+				}
+				if(c < 0) continue;  // エフェクターがリンクの子孫ではない
+				t.chain_.assign(path.rbegin(), path.rend());
+			}
+			for(const ik_link_& l : t.links_) {
+				std::vector<uint32_t>::const_iterator it
+					= std::find(t.chain_.begin(), t.chain_.end(), l.bone_);
+				t.chain_pos_.push_back(it - t.chain_.begin());
+			}
+
+			// リンクに（親、付与親を通して）依存する全てのボーン
+			std::vector<uint8_t> dirty(n, 0);
+			for(const ik_link_& l : t.links_) dirty[l.bone_] = 1;
+			for(uint32_t s = top; s < n; ++s) {
+				if(!dirty[s]) {
+					if((parent_[s] >= 0 && dirty[parent_[s]])
+						|| (append_[s] >= 0 && dirty[append_[s]])) dirty[s] = 1;
+				}
+				if(dirty[s]) t.update_.push_back(s);
+			}
+
+			if(ik_index_[t.bone_] < 0) {
+				ik_index_[t.bone_] = iks_.size();
+				iks_.push_back(t);
+			}
+		}
+
+		split_islands_();
+
+		return true;
+	}
+
+
+	bool motion::setup(const pmx_io& pmx)
+	{
+		typedef pmx_io::pmx_bone::flags flags;
+		const pmx_io::pmx_bones& src = pmx.get_bones();
+
+		bones bs(src.size());
+		iks is;
+		for(uint32_t i = 0; i < src.size(); ++i) {
+			const pmx_io::pmx_bone& pb = src[i];
+			bone& b = bs[i];
+			b.name_ = pb.name_;
+			b.parent_ = pb.parent_index_;
+			b.position_ = pb.position_;
+			b.level_ = pb.level_;
+			b.after_physics_ = pb.flags_.test(flags::MODIFY_PHY);
+			b.append_rotate_ = pb.flags_.test(flags::ROTATE_);
+			b.append_move_ = pb.flags_.test(flags::MOVE_);
+			if(b.append_rotate_ || b.append_move_) {
+				b.append_ = pb.parent_bone_index_;
+				b.append_gain_ = pb.parent_bone_gain_;
+			}
+
+			if(pb.flags_.test(flags::IK)) {
+				const pmx_io::pmx_bone::ik_data& d = pb.ik_data_;
+				ik k;
+				k.bone_ = i;
+				k.target_ = d.ik_target_;
+				k.loop_ = d.ik_loop_count_;
+				k.limit_ = d.ik_loop_radian_;
+				for(const pmx_io::pmx_bone::ik_data::ik_link& l : d.ik_links_) {
+					ik_link kl;
+					kl.bone_ = l.bone_index_;
+					kl.limit_ = l.angle_limit_ != 0;
+					kl.lower_ = l.lower_;
+					kl.upper_ = l.upper_;
+					k.links_.push_back(kl);
+				}
+				is.push_back(k);
+			}
+		}
+		return setup(bs, is);
+	}
+
+
+	bool motion::setup(const pmd_io& pmd)
+	{
+		const pmd_io::pmd_bones& src = pmd.get_bones();
+
+		bones bs(src.size());
+		for(uint32_t i = 0; i < src.size(); ++i) {
+			const pmd_io::pmd_bone& pb = src[i];
+			bone& b = bs[i];
+			std::string sjis(pb.name_, strnlen(pb.name_, sizeof(pb.name_)));
+			utils::sjis_to_utf8(sjis, b.name_);
+			b.parent_ = pb.parent_index_ == 0xffff ? -1 : pb.parent_index_;
+			b.position_ = pb.position_;
+		}
+
+		iks is;
+		for(const pmd_io::pmd_ik& pi : pmd.get_iks()) {
+			ik k;
+			k.bone_ = pi.index;
+			k.target_ = pi.target_index;
+			k.loop_ = pi.iterations;
+			// PMD の制御角は、PMX の単位角の１／４
+			k.limit_ = pi.control_weight * 4.0f;
+			for(uint16_t c : pi.child_index) {
+				// PMD には角度制限が無い（必要なら set_ik_limit で与える）
+				ik_link l;
+				l.bone_ = c;
+				k.links_.push_back(l);
+			}
+			is.push_back(k);
+		}
+		return setup(bs, is);
+	}
+
+
+	uint32_t motion::set_ik_limit(uint32_t bone, const vtx::fvtx& lower, const vtx::fvtx& upper)
+	{
+		uint32_t n = 0;
+		for(ik_& k : iks_) {
+			for(ik_link_& l : k.links_) {
+				if(order_[l.bone_] != bone) continue;
+				l.limit_ = true;
+				l.lower_ = lower;
+				l.upper_ = upper;
+				l.axis_x_ = lower.y == 0.0f && upper.y == 0.0f && lower.z == 0.0f && upper.z == 0.0f;
+				++n;
+			}
+		}
+		return n;
+	}
+
+
+	uint32_t motion::bind(const vmd_io& vmd)
+	{
+		vmd_ = &vmd;
+		track_.resize(order_.size());
+		uint32_t num = 0;
+		for(uint32_t s = 0; s < order_.size(); ++s) {
+			track_[s] = vmd.find_bone_track(name_[s]);
+			if(track_[s] >= 0) ++num;
+		}
+		return num;
+	}
+
+
+	void motion::create_pose(pose& p) const
+	{
+		uint32_t n = order_.size();
+		p.anim_pos_.assign(n, vtx::fvtx(0.0f));
+		p.anim_rot_.assign(n, qtx::fquat());
+		p.translate_ = offset_;
+		p.rotate_.assign(n, qtx::fquat());
+		p.world_pos_.resize(n);
+		p.world_rot_.resize(n);
+		p.cursor_.assign(n, 0);
+		p.skin_.resize(n);
+		for(uint32_t s = 0; s < n; ++s) {
+			world_(s, p);
+		}
+		skin_(p);
+	}
+
+
+	void motion::sample_(uint32_t i, float frame, pose& p) const
+	{
+		if(vmd_ != nullptr && i < track_.size() && track_[i] >= 0) {
+			vmd_io::sample(vmd_->get_bone_tracks()[track_[i]], frame, p.cursor_[i],
+				p.anim_pos_[i], p.anim_rot_[i]);
+		} else {
+			p.anim_pos_[i].set(0.0f);
+			p.anim_rot_[i].set(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+	}
+
+
+	void motion::compose_(uint32_t i, pose& p) const
+	{
+		vtx::fvtx t = p.anim_pos_[i];
+		qtx::fquat r = p.anim_rot_[i];
+		int32_t a = append_[i];
+		if(a >= 0) {
+			uint8_t f = append_flags_[i];
+			if(f & APPEND_ROTATE) {
+				qtx::fquat q;
+				q.slerp(qtx::fquat(), p.rotate_[a], append_gain_[i]);
+				r = q * r;
+			}
+			if(f & APPEND_MOVE) {
+				t += (p.translate_[a] - offset_[a]) * append_gain_[i];
+			}
+		}
+		p.translate_[i] = offset_[i] + t;
+		p.rotate_[i] = r;
+	}
+
+
+	void motion::solve_ik_(const ik_& ik, pose& p) const
+	{
+		const vtx::fvtx& goal = p.world_pos_[ik.bone_];
+		for(uint32_t loop = 0; loop < ik.loop_; ++loop) {
+			for(uint32_t li = 0; li < ik.links_.size(); ++li) {
+				const ik_link_& l = ik.links_[li];
+				uint32_t b = l.bone_;
+				const vtx::fvtx& eff = p.world_pos_[ik.target_];
+				qtx::fquat inv = p.world_rot_[b].get_conjugate();
+				vtx::fvtx v1 = inv.rotate_vector(eff - p.world_pos_[b]);
+				vtx::fvtx v2 = inv.rotate_vector(goal - p.world_pos_[b]);
+				float l1 = v1.len();
+				float l2 = v2.len();
+				if(l1 < 1e-6f || l2 < 1e-6f) continue;
+				v1 *= 1.0f / l1;
+				v2 *= 1.0f / l2;
+
+				qtx::fquat& r = p.anim_rot_[b];
+				if(l.axis_x_) {
+					// Ｘ軸回りだけで回す（膝）
+					float d = std::atan2(v2.z, v2.y) - std::atan2(v1.z, v1.y);
+					float pi = vtx::get_pi<float>();
+					if(d > pi) d -= 2.0f * pi;
+					else if(d < -pi) d += 2.0f * pi;
+					d = clamp_(d, -ik.limit_, ik.limit_);
+					float x = to_euler_(r).x + d;
+					x = clamp_(x, l.lower_.x, l.upper_.x);
+					r.set(std::sin(x * 0.5f), 0.0f, 0.0f, std::cos(x * 0.5f));
+				} else {
+					float c = clamp_(vtx::fvtx::dot(v1, v2), -1.0f, 1.0f);
+					float angle = std::acos(c);
+					if(angle < 1e-5f) continue;
+					if(angle > ik.limit_) angle = ik.limit_;
+					vtx::fvtx axis;
+					vtx::fvtx::cross(v1, v2, axis);
+					if(axis.len() < 1e-6f) continue;
+					qtx::fquat d;
+					d.from_axis(axis, angle);
+					r = r * d;
+					r.normalise();
+					if(l.limit_) {
+						vtx::fvtx e = to_euler_(r);
+						e.x = clamp_(e.x, l.lower_.x, l.upper_.x);
+						e.y = clamp_(e.y, l.lower_.y, l.upper_.y);
+						e.z = clamp_(e.z, l.lower_.z, l.upper_.z);
+						r = from_euler_(e);
+					}
+				}
+
+				// リンクからエフェクターまでを更新
+				for(uint32_t k = ik.chain_pos_[li]; k < ik.chain_.size(); ++k) {
+					uint32_t s = ik.chain_[k];
+					compose_(s, p);
+					world_(s, p);
+				}
+			}
+			vtx::fvtx d = p.world_pos_[ik.target_] - goal;
+			if(d.sqr() < 1e-8f) break;
+		}
+
+		for(uint32_t s : ik.update_) {
+			compose_(s, p);
+			world_(s, p);
+		}
+	}
+
+
+	void motion::evaluate_list_(const uint32_t* list, uint32_t num, float frame, pose& p) const
+	{
+		for(uint32_t k = 0; k < num; ++k) {
+			uint32_t s = list[k];
+			sample_(s, frame, p);
+			compose_(s, p);
+			world_(s, p);
+		}
+		// IK は全ての順運動学の後に、変形順で解く
+		for(uint32_t k = 0; k < num; ++k) {
+			int32_t ik = ik_index_[list[k]];
+			if(ik >= 0) solve_ik_(iks_[ik], p);
+		}
+	}
+
+
+	void motion::skin_(pose& p) const
+	{
+		for(uint32_t s = 0; s < order_.size(); ++s) {
+			const qtx::fquat& r = p.world_rot_[s];
+			mtx::fmat4& m = p.skin_[order_[s]];
+			m = r.create_matrix();
+			vtx::fvtx t = p.world_pos_[s] - r.rotate_vector(bind_[s]);
+			m[12] = t.x;
+			m[13] = t.y;
+			m[14] = t.z;
+		}
+	}
+
+
+	void motion::evaluate(float frame, pose& p) const
+	{
+		if(order_.empty()) return;
+
+		if(!trunk_.empty()) {
+			evaluate_list_(&trunk_[0], trunk_.size(), frame, p);
+		}
+
+		if(thread_ > 1 && islands_.size() > 1) {
+			uint32_t num = thread_;
+			if(num > islands_.size()) num = islands_.size();
+			utils::task_pool::get_instance().run(num, [this, num, frame, &p](uint32_t t) {
+				for(uint32_t i = t; i < islands_.size(); i += num) {
+					const island& is = islands_[i];
+					evaluate_list_(&is[0], is.size(), frame, p);
+				}
+			});
+		} else {
+			for(const island& is : islands_) {
+				evaluate_list_(&is[0], is.size(), frame, p);
+			}
+		}
+
+		skin_(p);
+	}
+
+
+	void motion::evaluate(float frame, pose* ps, uint32_t num, uint32_t thread) const
+	{
+		if(num == 0 || order_.empty()) return;
+
+		utils::task_pool& pool = utils::task_pool::get_instance();
+		uint32_t tn = thread;
+		if(tn == 0) tn = pool.size();
+		if(tn > num) tn = num;
+
+		// 姿勢単位で分けるので、島の分割は使わない
+		auto func = [this, frame, ps](uint32_t org, uint32_t end) {
+			for(uint32_t i = org; i < end; ++i) {
+				pose& p = ps[i];
+				if(!trunk_.empty()) evaluate_list_(&trunk_[0], trunk_.size(), frame, p);
+				for(const island& is : islands_) {
+					evaluate_list_(&is[0], is.size(), frame, p);
+				}
+				skin_(p);
+			}
+		};
+
+		if(tn <= 1) {
+			func(0, num);
+			return;
+		}
+		pool.run(tn, [&func, num, tn](uint32_t t) {
+			func(num * t / tn, num * (t + 1) / tn);
+		});
+	}
+}
@@ -0,0 +1,294 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	モーション評価クラス（ヘッダー） @n
+			ボーン階層をトポロジカル順の平坦な配列に並べ、VMD の @n
+			キーフレームから姿勢を求める。IK は CCD で解く。@n
+			依存関係の無いサブツリー（島）は、スレッドで分割して評価できる。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <string>
+#include <vector>
+#include "utils/vtx.hpp"
+#include "utils/mtx.hpp"
+#include "utils/quat.hpp"
+#include "mdf/vmd_io.hpp"
+#include "mdf/pmd_io.hpp"
+#include "mdf/pmx_io.hpp"
+
+namespace mdf {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	モーション評価クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class motion {
+	public:
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	ボーン定義
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct bone {
+			std::string	name_;
+			int32_t		parent_;			///< 親（無い場合 -1）
+			vtx::fvtx	position_;			///< バインド・ポーズの位置（モデル空間）
+			int32_t		level_;				///< 変形階層
+			bool		after_physics_;		///< 物理後変形
+			int32_t		append_;			///< 付与親（無い場合 -1）
+			float		append_gain_;		///< 付与率
+			bool		append_rotate_;		///< 回転付与
+			bool		append_move_;		///< 移動付与
+			bone() : parent_(-1), position_(0.0f), level_(0), after_physics_(false),
+				append_(-1), append_gain_(0.0f), append_rotate_(false), append_move_(false) { }
+		};
+		typedef std::vector<bone>	bones;
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	IK リンク
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct ik_link {
+			int32_t		bone_;
+			bool		limit_;		///< 角度制限
+			vtx::fvtx	lower_;		///< 下限（ラジアン、XYZ オイラー角）
+			vtx::fvtx	upper_;		///< 上限（ラジアン、XYZ オイラー角）
+			ik_link() : bone_(-1), limit_(false), lower_(0.0f), upper_(0.0f) { }
+		};
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	IK 定義
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct ik {
+			int32_t		bone_;		///< IK ボーン（目標位置）
+			int32_t		target_;	///< エフェクター
+			uint32_t	loop_;		///< 繰り返し回数
+			float		limit_;		///< １回あたりの制限角（ラジアン）
+			std::vector<ik_link>	links_;	///< エフェクター側から順に
+			ik() : bone_(-1), target_(-1), loop_(0), limit_(0.0f) { }
+		};
+		typedef std::vector<ik>	iks;
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	姿勢（モデル・インスタンス毎） @n
+					skin_ 以外はトポロジカル順に並んでいる。
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct pose {
+			std::vector<vtx::fvtx>	anim_pos_;		///< モーション（IK 込み）の移動量
+			std::vector<qtx::fquat>	anim_rot_;		///< モーション（IK 込み）の回転
+			std::vector<vtx::fvtx>	translate_;		///< ローカル移動量（付与込み）
+			std::vector<qtx::fquat>	rotate_;		///< ローカル回転（付与込み）
+			std::vector<vtx::fvtx>	world_pos_;		///< ワールド位置
+			std::vector<qtx::fquat>	world_rot_;		///< ワールド回転
+			std::vector<uint32_t>	cursor_;		///< キーフレーム区間のキャッシュ
+			std::vector<mtx::fmat4>	skin_;			///< スキニング・マトリックス（元のボーン順）
+		};
+
+	private:
+		// トポロジカル順の平坦な配列
+		std::vector<uint32_t>	order_;		///< 並べ替え後 → 元のボーン
+		std::vector<int32_t>	parent_;
+		std::vector<vtx::fvtx>	offset_;	///< 親からの相対位置
+		std::vector<vtx::fvtx>	bind_;
+		std::vector<int32_t>	append_;
+		std::vector<float>		append_gain_;
+		std::vector<uint8_t>	append_flags_;
+		std::vector<int32_t>	ik_index_;
+		std::vector<std::string>	name_;
+
+		struct ik_link_ {
+			uint32_t	bone_;
+			bool		limit_;
+			bool		axis_x_;	///< Ｘ軸のみの制限（膝）
+			vtx::fvtx	lower_;
+			vtx::fvtx	upper_;
+		};
+		struct ik_ {
+			uint32_t	bone_;
+			uint32_t	target_;
+			uint32_t	loop_;
+			float		limit_;
+			std::vector<ik_link_>	links_;
+			std::vector<uint32_t>	chain_;		///< 最上位のリンクからエフェクターまで
+			std::vector<uint32_t>	chain_pos_;	///< リンク毎の chain_ 内の位置
+			std::vector<uint32_t>	update_;	///< 解いた後に再計算するボーン
+		};
+		std::vector<ik_>		iks_;
+
+		std::vector<uint32_t>	trunk_;
+		typedef std::vector<uint32_t>	island;
+		std::vector<island>		islands_;
+
+		const vmd_io*			vmd_;
+		std::vector<int32_t>	track_;
+
+		uint32_t				thread_;
+
+		void world_(uint32_t i, pose& p) const {
+			int32_t pa = parent_[i];
+			if(pa < 0) {
+				p.world_rot_[i] = p.rotate_[i];
+				p.world_pos_[i] = p.translate_[i];
+			} else {
+				const qtx::fquat& pr = p.world_rot_[pa];
+				p.world_rot_[i] = pr * p.rotate_[i];
+				p.world_pos_[i] = p.world_pos_[pa] + pr.rotate_vector(p.translate_[i]);
+			}
+		}
+
+		void sample_(uint32_t i, float frame, pose& p) const;
+		void compose_(uint32_t i, pose& p) const;
+		void solve_ik_(const ik_& ik, pose& p) const;
+		void evaluate_list_(const uint32_t* list, uint32_t num, float frame, pose& p) const;
+		void skin_(pose& p) const;
+		void split_islands_();
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		motion() : vmd_(nullptr), thread_(1) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	スケルトンの構築 @n
+					親、付与親の依存でトポロジカル・ソート（変形階層、物理後、@n
+					元の番号の順で優先）し、独立したサブツリーを島に分ける。
+			@param[in]	bs	ボーン定義
+			@param[in]	is	IK 定義
+			@return 循環参照などがあれば「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool setup(const bones& bs, const iks& is);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	PMX のボーンからスケルトンを構築
+			@param[in]	pmx	pmx_io
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool setup(const pmx_io& pmx);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	PMD のボーンからスケルトンを構築
+			@param[in]	pmd	pmd_io
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool setup(const pmd_io& pmd);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	IK リンクの角度制限を設定 @n
+					PMD のように角度制限を持たない形式で、膝などを制限する場合に使う。@n
+					setup の後に呼ぶ。
+			@param[in]	bone	元のボーン番号
+			@param[in]	lower	下限（ラジアン、XYZ オイラー角）
+			@param[in]	upper	上限（ラジアン、XYZ オイラー角）
+			@return 設定したリンクの数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t set_ik_limit(uint32_t bone, const vtx::fvtx& lower, const vtx::fvtx& upper);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	モーションを割り当てる（ボーン名でトラックを対応付け）
+			@param[in]	vmd	vmd_io（評価中は保持する事）
+			@return 対応したトラック数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t bind(const vmd_io& vmd);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	島の評価に使うスレッド数を設定
+			@param[in]	num	スレッド数（１ならスレッドを使わない）
+		*/
+		//-----------------------------------------------------------------//
+		void set_thread(uint32_t num) { thread_ = num ? num : 1; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ボーン数を取得
+			@return ボーン数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_bone_num() const { return order_.size(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	独立して評価できる島の数を取得
+			@return 島の数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_island_num() const { return islands_.size(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	並べ替え後の番号から元のボーン番号を取得
+			@param[in]	i	並べ替え後の番号
+			@return 元のボーン番号
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_order(uint32_t i) const { return order_[i]; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	姿勢の領域を確保（バインド・ポーズで初期化）
+			@param[out]	p	姿勢
+		*/
+		//-----------------------------------------------------------------//
+		void create_pose(pose& p) const;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	評価 @n
+					島が複数あり、スレッド数が２以上なら共有のスレッド・プールで分割する。
+			@param[in]	frame	フレーム
+			@param[in,out]	p	姿勢
+		*/
+		//-----------------------------------------------------------------//
+		void evaluate(float frame, pose& p) const;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	複数の姿勢をまとめて評価（姿勢単位で共有のスレッド・プールに分割）
+			@param[in]	frame	フレーム
+			@param[in,out]	ps	姿勢の配列
+			@param[in]	num		姿勢の数
+			@param[in]	thread	最大分割数（０ならプールのスレッド数）
+		*/
+		//-----------------------------------------------------------------//
+		void evaluate(float frame, pose* ps, uint32_t num, uint32_t thread = 0) const;
+	};
+}
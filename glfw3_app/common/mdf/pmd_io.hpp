@@ -485,6 +485,15 @@ namespace mdf {
 		const pmd_bones& get_bones() const { return bones_; }
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	IK の参照
+			@return IK
+		*/
+		//-----------------------------------------------------------------//
+		const pmd_iks& get_iks() const { return iks_; }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	ボーン表示名の参照
@@ -13,6 +13,7 @@
 #include "gl_fw/gl_info.hpp"
 #include "gl_fw/glutils.hpp"
 #include "utils/quat.hpp"
+#include <cstring>
 
 namespace mdf {
 
@@ -32,13 +33,105 @@ namespace mdf {
 			idx_id_.clear();
 		}
 
-		if(tex_id_.empty()) {
+		if(!tex_id_.empty()) {
 			glDeleteTextures(tex_id_.size(), &tex_id_[0]);
 			tex_id_.clear();
 		}
 	}
 
 
+	// メモリー上のデータを読む為のリーダー
+	struct mem_reader_ {
+		const uint8_t*	p_;
+		const uint8_t*	end_;
+
+		mem_reader_(const uint8_t* org, const uint8_t* end) : p_(org), end_(end) { }
+
+		template <typename T>
+		bool get(T& v) {
+			if(static_cast<size_t>(end_ - p_) < sizeof(T)) return false;
+			std::memcpy(static_cast<void*>(&v), p_, sizeof(T));
+			p_ += sizeof(T);
+			return true;
+		}
+
+		bool get_index(uint8_t sz, int32_t& v) {
+			if(sz == 1) {
+				int8_t t;
+				if(!get(t)) return false;
+				v = t;
+			} else if(sz == 2) {
+				int16_t t;
+				if(!get(t)) return false;
+				v = t;
+			} else if(sz == 4) {
+				if(!get(v)) return false;
+			} else {
+				return false;
+			}
+			return true;
+		}
+	};
+
+
+	bool pmx_io::decode_vertices_(const uint8_t* org, const uint8_t* end, const uint8_t*& next)
+	{
+		mem_reader_ rd(org, end);
+		uint32_t num;
+		if(!rd.get(num)) return false;
+		// 最小の頂点サイズから、不正な頂点数を弾く
+		if(num > static_cast<size_t>(end - org) / (12 + 12 + 8 + 1 + 1 + 4)) return false;
+
+		const uint32_t apx = reading_info_.appendix_uv;
+		const uint8_t bis = reading_info_.bone_index_sizeof;
+		vertices_.resize(num, apx);
+		for(uint32_t i = 0; i < num; ++i) {
+			if(!rd.get(vertices_.position_[i])) return false;
+			if(!rd.get(vertices_.normal_[i])) return false;
+			if(!rd.get(vertices_.uv_[i])) return false;
+			for(uint32_t j = 0; j < apx; ++j) {
+				if(!rd.get(vertices_.appendix_uv_[i * apx + j])) return false;
+			}
+			uint8_t wt;
+			if(!rd.get(wt)) return false;
+			vertices_.weight_type_[i] = wt;
+			int32_t* bi = &vertices_.bone_index_[i * 4];
+			float* bw = &vertices_.bone_weight_[i * 4];
+			if(wt == pmx_vertices::weight::BDEF1) {
+				if(!rd.get_index(bis, bi[0])) return false;
+				bw[0] = 1.0f;
+			} else if(wt == pmx_vertices::weight::BDEF2 || wt == pmx_vertices::weight::SDEF) {
+				if(!rd.get_index(bis, bi[0])) return false;
+				if(!rd.get_index(bis, bi[1])) return false;
+				if(!rd.get(bw[0])) return false;
+				bw[1] = 1.0f - bw[0];
+				if(wt == pmx_vertices::weight::SDEF) {
+					vtx::fvtx c, r0, r1;
+					if(!rd.get(c)) return false;
+					if(!rd.get(r0)) return false;
+					if(!rd.get(r1)) return false;
+					vertices_.sdef_slot_[i] = vertices_.sdef_.size();
+					skin_sdef sd;
+					sd.set(c, r0, r1, bw[0]);
+					vertices_.sdef_.push_back(sd);
+				}
+			} else if(wt == pmx_vertices::weight::BDEF4) {
+				for(int j = 0; j < 4; ++j) {
+					if(!rd.get_index(bis, bi[j])) return false;
+				}
+				for(int j = 0; j < 4; ++j) {
+					if(!rd.get(bw[j])) return false;
+				}
+			} else {
+				return false;
+			}
+			if(!rd.get(vertices_.edge_scale_[i])) return false;
+		}
+		next = rd.p_;
+		return true;
+	}
+
+
 	static bool probe_(utils::file_io& fio)
 	{
 		std::string s;
@@ -103,34 +196,51 @@ namespace mdf {
 ///		std::cout << model_info_.name << std::endl;
 ///		std::cout << model_info_.comment << std::endl;
 
-		{  // 頂点データの読み込み
-			uint32_t num;
-			if(!fio.get(num)) return false;
-///			std::cout << "Vertex: " << num << std::endl;
-			vertices_.resize(num);
-			for(uint32_t i = 0; i < num; ++i) {
-				if(!vertices_[i].get(fio, reading_info_)) return false;
+		// 残りを一括で読み込み、以降はメモリー上で解析する
+		// （マップされていれば、コピーせずにそのまま使う）
+		std::vector<uint8_t> buff;
+		const uint8_t* top;
+		size_t len;
+		{
+			size_t pos = fio.tell();
+			size_t size = fio.get_file_size();
+			if(size <= pos) return false;
+			len = size - pos;
+			top = reinterpret_cast<const uint8_t*>(fio.get_view(len));
+			if(top == nullptr) {
+				buff.resize(len);
+				if(fio.read(&buff[0], len) != len) return false;
+				top = &buff[0];
 			}
 		}
 
+		// 頂点データの読み込み
+		const uint8_t* next;
+		if(!decode_vertices_(top, top + len, next)) {
+			vertices_.clear();
+			return false;
+		}
+		utils::file_io mio;
+		if(!mio.open(next, len - (next - top))) return false;
+
 		{  // 面データの読み込み
 			uint32_t num;
-			if(!fio.get(num)) return false;
+			if(!mio.get(num)) return false;
 ///			std::cout << "Face: " << num << std::endl;
 // std::cout << "Face Index sizeof: " << static_cast<int>(reading_info_.vertex_index_sizeof) << std::endl;
 			faces_.select(reading_info_.vertex_index_sizeof);
 			faces_.resize(num);
-			if(!fio.read(faces_.ptr(), reading_info_.vertex_index_sizeof, num)) return false;
+			if(!mio.read(faces_.ptr(), reading_info_.vertex_index_sizeof, num)) return false;
 		}
 
 		{  // テクスチャ
 			uint32_t num;
-			if(!fio.get(num)) return false;
+			if(!mio.get(num)) return false;
 			textures_.resize(num);
 ///			std::cout << "Texture: " << num << std::endl;
 			for(uint32_t i = 0; i < num; ++i) {
 				std::string s;
-				if(!get_text_(fio, s, reading_info_.text_encode_type)) return false;
+				if(!get_text_(mio, s, reading_info_.text_encode_type)) return false;
 				std::string path;
 				utils::code_conv(s, '\\', '/', path);
 				textures_[i] = path;
@@ -139,31 +249,31 @@ namespace mdf {
 
 		{  // 材質
 			uint32_t num;
-			if(!fio.get(num)) return false;
+			if(!mio.get(num)) return false;
 ///			std::cout << "Material: " << num << std::endl;
 			materials_.resize(num);
 			for(uint32_t i = 0; i < num; ++i) {
-				if(!materials_[i].get(fio, reading_info_)) return false;
+				if(!materials_[i].get(mio, reading_info_)) return false;
 //				materials_[i].list();
 			}
 		}
 
 		{  // ボーン
 			uint32_t num;
-			if(!fio.get(num)) return false;
+			if(!mio.get(num)) return false;
 ///			std::cout << "Bone: " << num << std::endl;
 			bones_.resize(num);
 			for(uint32_t i = 0; i < num; ++i) {
-				if(!bones_[i].get(fio, reading_info_)) return false;
+				if(!bones_[i].get(mio, reading_info_)) return false;
 			}
 		}
 		{  // モーフ
 			uint32_t num;
-			if(!fio.get(num)) return false;
+			if(!mio.get(num)) return false;
 			std::cout << "Morph: " << num << std::endl;
 			morphs_.resize(num);
 			for(uint32_t i = 0; i < num; ++i) {
-				if(!morphs_[i].get(fio, reading_info_)) return false;
+				if(!morphs_[i].get(mio, reading_info_)) return false;
 			}
 		}
 
@@ -196,22 +306,19 @@ namespace mdf {
 		if(vertices_.empty()) return;
 		if(faces_.empty()) return;
 
-		{	// 頂点バッファの作成
-			std::vector<vbo_t> vbos;
-			vbos.resize(vertices_.size());
-			uint32_t i = 0;
-			BOOST_FOREACH(pmx_vertex& v, vertices_) {
-				vbo_t& vbo = vbos[i];
-				vbo.uv = v.uv_;
-				vbo.n = v.normal_;			
-				vbo.v = v.position_;
-				++i;
+		{	// 頂点バッファの作成（スキニングで更新する為、ステージングを保持）
+			vbo_stage_.resize(vertices_.size());
+			for(uint32_t i = 0; i < vertices_.size(); ++i) {
+				vbo_t& vbo = vbo_stage_[i];
+				vbo.uv = vertices_.uv_[i];
+				vbo.n = vertices_.normal_[i];
+				vbo.v = vertices_.position_[i];
 			}
 
 			glGenBuffers(1, &vtx_id_);
 			glBindBuffer(GL_ARRAY_BUFFER, vtx_id_);
-			glBufferData(GL_ARRAY_BUFFER, vbos.size() * sizeof(vbo_t), &vbos[0],
-				GL_STATIC_DRAW);
+			glBufferData(GL_ARRAY_BUFFER, vbo_stage_.size() * sizeof(vbo_t), &vbo_stage_[0],
+				GL_DYNAMIC_DRAW);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		}
 
@@ -272,6 +379,27 @@ namespace mdf {
 	}
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	スキニング（CPU）
+		@param[in]	mats	ボーン毎のスキニング・マトリックス
+	*/
+	//-----------------------------------------------------------------//
+	void pmx_io::skinning(const std::vector<mtx::fmat4>& mats)
+	{
+		if(vertices_.empty() || mats.empty()) return;
+		if(vbo_stage_.size() != vertices_.size()) return;
+
+		mdf::skinning(vertices_.get_skin_source(), &mats[0], mats.size(), &vbo_stage_[0]);
+
+		if(vtx_id_) {
+			glBindBuffer(GL_ARRAY_BUFFER, vtx_id_);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, vbo_stage_.size() * sizeof(vbo_t), &vbo_stage_[0]);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	レンダリング
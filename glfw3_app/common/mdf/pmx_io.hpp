@@ -20,6 +20,7 @@
 #include "utils/dim.hpp"
 #include "utils/file_io.hpp"
 #include "mdf/surface.hpp"
+#include "mdf/skinning.hpp"
 
 namespace mdf {
 
@@ -158,14 +159,13 @@ namespace mdf {
 
 		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 		/*!
-			@brief	PMX 頂点情報
+			@brief	PMX 頂点情報（SoA） @n
+					ウェイトは形式によらず、ボーン番号とウェイトを４個ずつ @n
+					持つ（未使用はウェイト「０」）。@n
+					SDEF 頂点は、sdef_slot_ に sdef_ の番号を持つ。
 		*/
 		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
-		struct pmx_vertex {
- 			vtx::fvtx	position_;
-			vtx::fvtx	normal_;
-			vtx::fpos	uv_;
-			std::vector<vtx::fvtx4> appendix_uv_;
+		struct pmx_vertices {
 
 			struct weight {
 				enum type {
@@ -175,103 +175,69 @@ namespace mdf {
 					SDEF
 				};
 			};
-			weight::type	weight_type_;
 
-			struct i_weight {
-				virtual ~i_weight() { }
-				virtual bool get(utils::file_io& fio, uint8_t index_sizeof) = 0;
-			};
-
-			struct BDEF1 : public i_weight {
-				int32_t		index;
-				virtual ~BDEF1() { }
-				bool get(utils::file_io& fio, uint8_t index_sizeof) override {
-					return get_(fio, index_sizeof, index);
-				}
-			};
-			struct BDEF2 : public i_weight {
-				int32_t		index[2];
-				float		weight;
-				virtual ~BDEF2() { }
-				bool get(utils::file_io& fio, uint8_t index_sizeof) override {
-					if(!get_(fio, index_sizeof, index[0])) return false;
-					if(!get_(fio, index_sizeof, index[1])) return false;
-					if(!fio.get(weight)) return false;
-					return true;
-				}
-			};
-			struct BDEF4 : public i_weight {
-				int32_t		index[4];
-				float		weight[4];
-				virtual ~BDEF4() { }
-				bool get(utils::file_io& fio, uint8_t index_sizeof) override {
-					if(!get_(fio, index_sizeof, index[0])) return false;
-					if(!get_(fio, index_sizeof, index[1])) return false;
-					if(!get_(fio, index_sizeof, index[2])) return false;
-					if(!get_(fio, index_sizeof, index[3])) return false;
-					if(!fio.get(weight[0])) return false;
-					if(!fio.get(weight[1])) return false;
-					if(!fio.get(weight[2])) return false;
-					if(!fio.get(weight[3])) return false;
-					return true;
-				};
-			};
-			struct SDEF : public i_weight {
-				int32_t		index[2];
-				float		weight;
-				vtx::fvtx	C;
-				vtx::fvtx	R0;
-				vtx::fvtx	R1;
-				virtual ~SDEF() { }
-				bool get(utils::file_io& fio, uint8_t index_sizeof) override {
-					if(!get_(fio, index_sizeof, index[0])) return false;
-					if(!get_(fio, index_sizeof, index[1])) return false;
-					if(!fio.get(weight)) return false;
-					if(!fio.get(C)) return false;
-					if(!fio.get(R0)) return false;
-					if(!fio.get(R1)) return false;
-					return true;
-				};
-			};
-			i_weight*	weight_;
+			std::vector<vtx::fvtx>	position_;
+			std::vector<vtx::fvtx>	normal_;
+			std::vector<vtx::fpos>	uv_;
+			uint32_t				appendix_num_;
+			std::vector<vtx::fvtx4>	appendix_uv_;	///< 頂点数×appendix_num_
+			std::vector<uint8_t>	weight_type_;
+			std::vector<int32_t>	bone_index_;	///< 頂点数×４
+			std::vector<float>		bone_weight_;	///< 頂点数×４
+			std::vector<uint32_t>	sdef_slot_;		///< SDEF でない場合「~0」
+			std::vector<skin_sdef>	sdef_;
+			std::vector<float>		edge_scale_;
+
+			pmx_vertices() : appendix_num_(0) { }
+
+			size_t size() const { return position_.size(); }
+
+			bool empty() const { return position_.empty(); }
+
+			void clear() {
+				position_.clear();
+				normal_.clear();
+				uv_.clear();
+				appendix_num_ = 0;
+				appendix_uv_.clear();
+				weight_type_.clear();
+				bone_index_.clear();
+				bone_weight_.clear();
+				sdef_slot_.clear();
+				sdef_.clear();
+				edge_scale_.clear();
+			}
 
-			float		edge_scale_;
+			void resize(uint32_t num, uint32_t appendix) {
+				position_.resize(num);
+				normal_.resize(num);
+				uv_.resize(num);
+				appendix_num_ = appendix;
+				appendix_uv_.resize(num * appendix);
+				weight_type_.resize(num);
+				bone_index_.assign(num * 4, 0);
+				bone_weight_.assign(num * 4, 0.0f);
+				sdef_slot_.assign(num, ~0u);
+				sdef_.clear();
+				edge_scale_.resize(num);
+			}
 
-			bool get(utils::file_io& fio, const reading_info& info) {
-				if(!fio.get(position_)) return false;
-				if(!fio.get(normal_)) return false;
-				if(!fio.get(uv_)) return false;
-				if(info.appendix_uv) {
-					appendix_uv_.reserve(info.appendix_uv);
-					appendix_uv_.clear();
-					for(uint8_t i = 0; i < info.appendix_uv; ++i) {
-						vtx::fvtx4 v; 
-						if(!fio.get(v)) return false;
-						appendix_uv_.push_back(v);
-					}
+			skin_source get_skin_source() const {
+				skin_source src;
+				if(empty()) return src;
+				src.position_ = &position_[0];
+				src.normal_ = &normal_[0];
+				src.uv_ = &uv_[0];
+				src.bone_index_ = &bone_index_[0];
+				src.bone_weight_ = &bone_weight_[0];
+				if(!sdef_.empty()) {
+					src.sdef_slot_ = &sdef_slot_[0];
+					src.sdef_ = &sdef_[0];
 				}
-				uint8_t wt;
-				if(!fio.get(wt)) return false;
-				weight_type_ = static_cast<weight::type>(wt);
-				if(weight_type_ == weight::BDEF1) {
-					weight_ = new BDEF1;
-				} else if(weight_type_ == weight::BDEF2) {
-					weight_ = new BDEF2;
-				} else if(weight_type_ == weight::BDEF4) {
-					weight_ = new BDEF4;
-				} else if(weight_type_ == weight::SDEF) {
-					weight_ = new SDEF;
-				} else {
-					return false;
-				}
-				if(!weight_->get(fio, info.bone_index_sizeof)) return false;
-				if(!fio.get(edge_scale_)) return false;
-   				return true;
+				src.num_ = position_.size();
+				return src;
 			}
-			pmx_vertex() : weight_(0) { }
-			~pmx_vertex() { delete weight_; }
 		};
-		typedef std::vector<pmx_vertex>	pmx_vertices;
 
 
 		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
@@ -526,11 +492,8 @@ namespace mdf {
 
 		std::string		current_path_;
 
-		struct vbo_t {
-			vtx::fpos	uv;
-			vtx::fvtx	n;
-			vtx::fvtx	v;
-		};
+		typedef skin_vbo	vbo_t;
+		std::vector<vbo_t>	vbo_stage_;
 
 		GLuint	vtx_id_;
 		std::vector<GLuint>	idx_id_;
@@ -539,6 +502,7 @@ namespace mdf {
 
 		void initialize_();
 		void destroy_();
+		bool decode_vertices_(const uint8_t* org, const uint8_t* end, const uint8_t*& next);
 
 	public:
 		//-----------------------------------------------------------------//
@@ -546,7 +510,7 @@ namespace mdf {
 			@brief	コンストラクター
 		*/
 		//-----------------------------------------------------------------//
-		pmx_io() : version_(0.0f) { }
+		pmx_io() : version_(0.0f), vtx_id_(0) { }
 
 
 		//-----------------------------------------------------------------//
@@ -617,7 +581,7 @@ namespace mdf {
 		//-----------------------------------------------------------------//
 		bool load(const std::string& fn) {
 			utils::file_io fio;
-			if(!fio.open(fn, "rb")) {
+			if(!fio.open_map(fn)) {
 				return false;
 			}
 			bool f = load(fio);
@@ -662,6 +626,26 @@ namespace mdf {
 		void render_setup();
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	頂点の参照
+			@return 頂点
+		*/
+		//-----------------------------------------------------------------//
+		const pmx_vertices& get_vertices() const { return vertices_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	スキニング（CPU） @n
+					頂点バッファのステージングへ直接変形し、VBO を更新する。
+			@param[in]	mats	ボーン毎のスキニング・マトリックス @n
+								（ボーンの姿勢×バインド・ポーズの逆行列）
+		*/
+		//-----------------------------------------------------------------//
+		void skinning(const std::vector<mtx::fmat4>& mats);
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	レンダリング
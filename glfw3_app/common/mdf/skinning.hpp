@@ -0,0 +1,362 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	CPU スキニング・カーネル @n
+			SoA の頂点データ（位置、法線、UV、ボーン番号×４、ウェイト×４）に @n
+			対して、線形ブレンド・スキニング（LBS）を行い、@n
+			GL_T2F_N3F_V3F 形式の頂点バッファへ直接書き込む。@n
+			SDEF 頂点は、球面補間による SDEF 変形を行う。@n
+			SSE が有効な場合は、マトリックスの合成と変換を SIMD で処理し、@n
+			頂点数が多い場合は共有のスレッド・プールで分割する。@n
+			※SSE 版とスカラー版は加算の順序が異なるので、結果は丸め誤差の @n
+			範囲で一致する（ビット単位では一致しない）。@n
+			範囲外のボーン番号は、LBS、SDEF 共に無視する（SDEF で２つの @n
+			ボーンのどちらかが範囲外なら、その頂点は LBS で処理する）。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#include "utils/vtx.hpp"
+#include "utils/mtx.hpp"
+#include "utils/task_pool.hpp"
+
+namespace mdf {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	スキニング出力頂点（GL_T2F_N3F_V3F）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct skin_vbo {
+		vtx::fpos	uv;
+		vtx::fvtx	n;
+		vtx::fvtx	v;
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	SDEF パラメーター（ロード時に補正済みの値）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct skin_sdef {
+		vtx::fvtx	c_;		///< 中心
+		vtx::fvtx	cr0_;	///< (C + R0') / 2
+		vtx::fvtx	cr1_;	///< (C + R1') / 2
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	PMX の C、R0、R1 から設定
+			@param[in]	c	中心
+			@param[in]	r0	R0
+			@param[in]	r1	R1
+			@param[in]	w0	ボーン０のウェイト
+		*/
+		//-----------------------------------------------------------------//
+		void set(const vtx::fvtx& c, const vtx::fvtx& r0, const vtx::fvtx& r1, float w0) {
+			float w1 = 1.0f - w0;
+			vtx::fvtx rw = r0 * w0 + r1 * w1;
+			vtx::fvtx rr0 = c + r0 - rw;
+			vtx::fvtx rr1 = c + r1 - rw;
+			c_ = c;
+			cr0_ = (c + rr0) * 0.5f;
+			cr1_ = (c + rr1) * 0.5f;
+		}
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	スキニング入力（SoA への参照）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct skin_source {
+		const vtx::fvtx*	position_;
+		const vtx::fvtx*	normal_;
+		const vtx::fpos*	uv_;
+		const int32_t*		bone_index_;	///< 頂点あたり４個
+		const float*		bone_weight_;	///< 頂点あたり４個
+		const uint32_t*		sdef_slot_;		///< SDEF テーブルの番号（無効は ~0）
+		const skin_sdef*	sdef_;
+		uint32_t			num_;
+		skin_source() : position_(nullptr), normal_(nullptr), uv_(nullptr),
+			bone_index_(nullptr), bone_weight_(nullptr),
+			sdef_slot_(nullptr), sdef_(nullptr), num_(0) { }
+	};
+
+
+	// 回転部分から四元数を作成 (x, y, z, w)
+	inline void skin_quat_from_mat_(const float* m, float* q)
+	{
+		float tr = m[0] + m[5] + m[10];
+		if(tr > 0.0f) {
+			float s = std::sqrt(tr + 1.0f) * 2.0f;
+			q[3] = 0.25f * s;
+			q[0] = (m[6] - m[9]) / s;
+			q[1] = (m[8] - m[2]) / s;
+			q[2] = (m[1] - m[4]) / s;
+		} else if(m[0] > m[5] && m[0] > m[10]) {
+			float s = std::sqrt(1.0f + m[0] - m[5] - m[10]) * 2.0f;
+			q[3] = (m[6] - m[9]) / s;
+			q[0] = 0.25f * s;
+			q[1] = (m[4] + m[1]) / s;
+			q[2] = (m[8] + m[2]) / s;
+		} else if(m[5] > m[10]) {
+			float s = std::sqrt(1.0f + m[5] - m[0] - m[10]) * 2.0f;
+			q[3] = (m[8] - m[2]) / s;
+			q[0] = (m[4] + m[1]) / s;
+			q[1] = 0.25f * s;
+			q[2] = (m[9] + m[6]) / s;
+		} else {
+			float s = std::sqrt(1.0f + m[10] - m[0] - m[5]) * 2.0f;
+			q[3] = (m[1] - m[4]) / s;
+			q[0] = (m[8] + m[2]) / s;
+			q[1] = (m[9] + m[6]) / s;
+			q[2] = 0.25f * s;
+		}
+	}
+
+
+	// 球面線形補間した四元数から、3x3 回転行列（列優先）を作成
+	inline void skin_slerp_mat_(const float* a, const float* b, float t, float* r)
+	{
+		float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+		float bs[4] = { b[0], b[1], b[2], b[3] };
+		if(d < 0.0f) {
+			d = -d;
+			for(int i = 0; i < 4; ++i) bs[i] = -bs[i];
+		}
+		float k0, k1;
+		if(d > 0.9995f) {
+			k0 = 1.0f - t;
+			k1 = t;
+		} else {
+			float th = std::acos(d);
+			float si = std::sin(th);
+			k0 = std::sin((1.0f - t) * th) / si;
+			k1 = std::sin(t * th) / si;
+		}
+		float q[4];
+		float l = 0.0f;
+		for(int i = 0; i < 4; ++i) {
+			q[i] = a[i] * k0 + bs[i] * k1;
+			l += q[i] * q[i];
+		}
+		l = 1.0f / std::sqrt(l);
+		float x = q[0] * l, y = q[1] * l, z = q[2] * l, w = q[3] * l;
+		r[0] = 1.0f - 2.0f * (y * y + z * z);
+		r[1] = 2.0f * (x * y + z * w);
+		r[2] = 2.0f * (x * z - y * w);
+		r[3] = 2.0f * (x * y - z * w);
+		r[4] = 1.0f - 2.0f * (x * x + z * z);
+		r[5] = 2.0f * (y * z + x * w);
+		r[6] = 2.0f * (x * z + y * w);
+		r[7] = 2.0f * (y * z - x * w);
+		r[8] = 1.0f - 2.0f * (x * x + y * y);
+	}
+
+
+	// SDEF 変形、ボーン番号が範囲外なら何もせず「false」を返す
+	inline bool skin_sdef_vertex_(const skin_source& src, const mtx::fmat4* mats, uint32_t mat_num,
+		uint32_t i, skin_vbo& out)
+	{
+		const int32_t* bi = &src.bone_index_[i * 4];
+		const float* bw = &src.bone_weight_[i * 4];
+		const skin_sdef& sd = src.sdef_[src.sdef_slot_[i]];
+		uint32_t b0 = static_cast<uint32_t>(bi[0]);
+		uint32_t b1 = static_cast<uint32_t>(bi[1]);
+		if(b0 >= mat_num || b1 >= mat_num) return false;
+		const float* m0 = mats[b0]();
+		const float* m1 = mats[b1]();
+		float w0 = bw[0];
+		float w1 = 1.0f - w0;
+
+		float q0[4], q1[4], r[9];
+		skin_quat_from_mat_(m0, q0);
+		skin_quat_from_mat_(m1, q1);
+		skin_slerp_mat_(q0, q1, w1, r);
+
+		const vtx::fvtx& p = src.position_[i];
+		float px = p.x - sd.c_.x, py = p.y - sd.c_.y, pz = p.z - sd.c_.z;
+		const vtx::fvtx& c0 = sd.cr0_;
+		const vtx::fvtx& c1 = sd.cr1_;
+		float v[3];
+		for(int k = 0; k < 3; ++k) {
+			float rp = r[k] * px + r[3 + k] * py + r[6 + k] * pz;
+			float t0 = m0[k] * c0.x + m0[4 + k] * c0.y + m0[8 + k] * c0.z + m0[12 + k];
+			float t1 = m1[k] * c1.x + m1[4 + k] * c1.y + m1[8 + k] * c1.z + m1[12 + k];
+			v[k] = rp + t0 * w0 + t1 * w1;
+		}
+		out.v.set(v[0], v[1], v[2]);
+		const vtx::fvtx& n = src.normal_[i];
+		float nv[3];
+		for(int k = 0; k < 3; ++k) {
+			nv[k] = r[k] * n.x + r[3 + k] * n.y + r[6 + k] * n.z;
+		}
+		out.n.set(nv[0], nv[1], nv[2]);
+		out.uv = src.uv_[i];
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	スキニング（範囲指定、スカラー版）
+		@param[in]	src		入力
+		@param[in]	mats	スキニング・マトリックス（ボーン×バインド逆行列）
+		@param[in]	mat_num	マトリックス数
+		@param[out]	dst		出力先（src.num_ 個）
+		@param[in]	org		開始頂点
+		@param[in]	end		終了頂点（含まない）
+	*/
+	//-----------------------------------------------------------------//
+	inline void skin_range_scalar(const skin_source& src, const mtx::fmat4* mats, uint32_t mat_num,
+		skin_vbo* dst, uint32_t org, uint32_t end)
+	{
+		for(uint32_t i = org; i < end; ++i) {
+			if(src.sdef_slot_ != nullptr && src.sdef_slot_[i] != ~0u) {
+				if(skin_sdef_vertex_(src, mats, mat_num, i, dst[i])) continue;
+			}
+			float m[16] = { 0.0f };
+			const int32_t* bi = &src.bone_index_[i * 4];
+			const float* bw = &src.bone_weight_[i * 4];
+			for(int k = 0; k < 4; ++k) {
+				float w = bw[k];
+				uint32_t b = static_cast<uint32_t>(bi[k]);
+				if(w == 0.0f || b >= mat_num) continue;
+				const float* s = mats[b]();
+				for(int j = 0; j < 16; ++j) m[j] += s[j] * w;
+			}
+			const vtx::fvtx& p = src.position_[i];
+			const vtx::fvtx& n = src.normal_[i];
+			skin_vbo& o = dst[i];
+			o.v.x = m[0] * p.x + m[4] * p.y + m[ 8] * p.z + m[12];
+			o.v.y = m[1] * p.x + m[5] * p.y + m[ 9] * p.z + m[13];
+			o.v.z = m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14];
+			float nx = m[0] * n.x + m[4] * n.y + m[ 8] * n.z;
+			float ny = m[1] * n.x + m[5] * n.y + m[ 9] * n.z;
+			float nz = m[2] * n.x + m[6] * n.y + m[10] * n.z;
+			float l = nx * nx + ny * ny + nz * nz;
+			if(l > 0.0f) {
+				l = 1.0f / std::sqrt(l);
+				nx *= l; ny *= l; nz *= l;
+			}
+			o.n.set(nx, ny, nz);
+			o.uv = src.uv_[i];
+		}
+	}
+
+
+#ifdef __SSE__
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	スキニング（範囲指定、SSE 版） @n
+				ウェイト付きの列ベクトルを合成し、位置と法線を変換する。
+		@param[in]	src		入力
+		@param[in]	mats	スキニング・マトリックス（16 バイト境界）
+		@param[in]	mat_num	マトリックス数
+		@param[out]	dst		出力先
+		@param[in]	org		開始頂点
+		@param[in]	end		終了頂点（含まない）
+	*/
+	//-----------------------------------------------------------------//
+	inline void skin_range_sse(const skin_source& src, const mtx::fmat4* mats, uint32_t mat_num,
+		skin_vbo* dst, uint32_t org, uint32_t end)
+	{
+		for(uint32_t i = org; i < end; ++i) {
+			if(src.sdef_slot_ != nullptr && src.sdef_slot_[i] != ~0u) {
+				if(skin_sdef_vertex_(src, mats, mat_num, i, dst[i])) continue;
+			}
+			__m128 c0 = _mm_setzero_ps();
+			__m128 c1 = c0, c2 = c0, c3 = c0;
+			const int32_t* bi = &src.bone_index_[i * 4];
+			const float* bw = &src.bone_weight_[i * 4];
+			for(int k = 0; k < 4; ++k) {
+				float w = bw[k];
+				uint32_t b = static_cast<uint32_t>(bi[k]);
+				if(w == 0.0f || b >= mat_num) continue;
+				const float* s = mats[b]();
+				__m128 wv = _mm_set1_ps(w);
+				c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_load_ps(s +  0), wv));
+				c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_load_ps(s +  4), wv));
+				c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_load_ps(s +  8), wv));
+				c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_load_ps(s + 12), wv));
+			}
+			const vtx::fvtx& p = src.position_[i];
+			const vtx::fvtx& n = src.normal_[i];
+			__m128 v = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p.x)), _mm_mul_ps(c1, _mm_set1_ps(p.y))),
+				_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p.z)), c3));
+			__m128 nv = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(n.x)), _mm_mul_ps(c1, _mm_set1_ps(n.y))),
+				_mm_mul_ps(c2, _mm_set1_ps(n.z)));
+			float vf[4], nf[4];
+			_mm_storeu_ps(vf, v);
+			_mm_storeu_ps(nf, nv);
+			skin_vbo& o = dst[i];
+			o.v.set(vf[0], vf[1], vf[2]);
+			float l = nf[0] * nf[0] + nf[1] * nf[1] + nf[2] * nf[2];
+			if(l > 0.0f) {
+				l = 1.0f / std::sqrt(l);
+				nf[0] *= l; nf[1] *= l; nf[2] *= l;
+			}
+			o.n.set(nf[0], nf[1], nf[2]);
+			o.uv = src.uv_[i];
+		}
+	}
+#endif
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	スキニング @n
+				頂点数が多い場合は、共有のスレッド・プールで分割して処理する。
+		@param[in]	src		入力
+		@param[in]	mats	スキニング・マトリックス
+		@param[in]	mat_num	マトリックス数
+		@param[out]	dst		出力先（src.num_ 個）
+		@param[in]	thread	最大分割数（０ならプールのスレッド数）
+	*/
+	//-----------------------------------------------------------------//
+	inline void skinning(const skin_source& src, const mtx::fmat4* mats, uint32_t mat_num,
+		skin_vbo* dst, uint32_t thread = 0)
+	{
+		static const uint32_t chunk = 8192;
+
+		if(src.num_ == 0 || mat_num == 0) return;
+
+		utils::task_pool& pool = utils::task_pool::get_instance();
+		uint32_t num = thread;
+		if(num == 0) num = pool.size();
+		uint32_t chunks = (src.num_ + chunk - 1) / chunk;
+		if(num > chunks) num = chunks;
+
+		auto func = [&](uint32_t org, uint32_t end) {
+#ifdef __SSE__
+			skin_range_sse(src, mats, mat_num, dst, org, end);
+#else
+			skin_range_scalar(src, mats, mat_num, dst, org, end);
+#endif
+		};
+
+		if(num <= 1) {
+			func(0, src.num_);
+			return;
+		}
+
+		pool.run(num, [&](uint32_t t) {
+			uint32_t org = static_cast<uint64_t>(src.num_) * t / num;
+			uint32_t end = static_cast<uint64_t>(src.num_) * (t + 1) / num;
+			func(org, end);
+		});
+	}
+}
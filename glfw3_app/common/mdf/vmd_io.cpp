@@ -0,0 +1,200 @@
+//=====================================================================//
+/*!	@file
+	@brief	VMD（モーション）ファイルを扱うクラス
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <algorithm>
+#include <cstring>
+#include "mdf/vmd_io.hpp"
+#include "utils/string_utils.hpp"
+
+namespace mdf {
+
+	void vmd_io::get_text_(const char* src, uint32_t n, std::string& dst)
+	{
+		std::string tmp;
+		for(uint32_t i = 0; i < n; ++i) {
+			char ch = *src++;
+			if(ch == 0) break;
+			tmp += ch;
+		}
+		utils::sjis_to_utf8(tmp, dst);
+	}
+
+
+	// 残りのファイルサイズに num 個のレコードが収まるか
+	static bool fit_records_(utils::file_io& fio, uint32_t num, uint32_t rec)
+	{
+		size_t sz = fio.get_file_size();
+		size_t pos = fio.tell();
+		if(pos > sz) return false;
+		return static_cast<size_t>(num) <= (sz - pos) / rec;
+	}
+
+
+	bool vmd_io::load(utils::file_io& fio)
+	{
+		destroy();
+
+		char header[30];
+		if(fio.read(header, 30) != 30) return false;
+		uint32_t name_len;
+		if(std::strncmp(header, "Vocaloid Motion Data 0002", 25) == 0) {
+			name_len = 20;
+		} else if(std::strncmp(header, "Vocaloid Motion Data file", 25) == 0) {
+			name_len = 10;
+		} else {
+			return false;
+		}
+		{
+			char name[20];
+			if(fio.read(name, name_len) != name_len) return false;
+			get_text_(name, name_len, model_name_);
+		}
+
+		{	// ボーン・キーフレーム（１レコード１１１バイトをまとめて読む）
+			uint32_t num;
+			if(!fio.get(num)) return false;
+			static const uint32_t rec = 111;
+			if(!fit_records_(fio, num, rec)) return false;
+			std::vector<uint8_t> buff(static_cast<size_t>(num) * rec);
+			if(num > 0 && fio.read(&buff[0], buff.size()) != buff.size()) return false;
+
+			std::string last;
+			uint32_t idx = 0;
+			for(uint32_t i = 0; i < num; ++i) {
+				const uint8_t* p = &buff[i * rec];
+				// 同じボーンのキーは連続している事が多いので、名前の変換を省く
+				std::string sjis(reinterpret_cast<const char*>(p),
+					strnlen(reinterpret_cast<const char*>(p), 15));
+				if(i == 0 || sjis != last) {
+					std::string name;
+					get_text_(sjis.c_str(), sjis.size(), name);
+					track_map::const_iterator it = bone_map_.find(name);
+					if(it == bone_map_.end()) {
+						idx = bone_tracks_.size();
+						bone_map_.emplace(name, idx);
+						bone_tracks_.push_back(bone_track());
+						bone_tracks_.back().name_ = name;
+					} else {
+						idx = it->second;
+					}
+					last.swap(sjis);
+				}
+
+				bone_key key;
+				float f[7];
+				std::memcpy(&key.frame_, p + 15, 4);
+				std::memcpy(f, p + 19, sizeof(f));
+				key.position_.set(f[0], f[1], f[2]);
+				key.rotation_.set(f[3], f[4], f[5], f[6]);
+				// 補間パラメーター：[軸 + 0] x1, [軸 + 4] y1, [軸 + 8] x2, [軸 + 12] y2
+				const uint8_t* ip = p + 47;
+				for(int k = 0; k < 4; ++k) {
+					key.curve_[k].set(ip[k], ip[k + 4], ip[k + 8], ip[k + 12]);
+				}
+				bone_tracks_[idx].keys_.push_back(key);
+				if(last_frame_ < key.frame_) last_frame_ = key.frame_;
+			}
+		}
+
+		{	// モーフ・キーフレーム（旧形式ではここで終わる事がある）
+			uint32_t num = 0;
+			if(fio.get(num) && num > 0) {
+				static const uint32_t rec = 23;
+				if(!fit_records_(fio, num, rec)) return false;
+				std::vector<uint8_t> buff(static_cast<size_t>(num) * rec);
+				if(fio.read(&buff[0], buff.size()) != buff.size()) return false;
+				for(uint32_t i = 0; i < num; ++i) {
+					const uint8_t* p = &buff[i * rec];
+					std::string name;
+					get_text_(reinterpret_cast<const char*>(p), 15, name);
+					uint32_t idx;
+					track_map::const_iterator it = morph_map_.find(name);
+					if(it == morph_map_.end()) {
+						idx = morph_tracks_.size();
+						morph_map_.emplace(name, idx);
+						morph_tracks_.push_back(morph_track());
+						morph_tracks_.back().name_ = name;
+					} else {
+						idx = it->second;
+					}
+					morph_key key;
+					std::memcpy(&key.frame_, p + 15, 4);
+					std::memcpy(&key.weight_, p + 19, 4);
+					morph_tracks_[idx].keys_.push_back(key);
+					if(last_frame_ < key.frame_) last_frame_ = key.frame_;
+				}
+			}
+		}
+		// カメラ、照明、セルフ影は扱わない
+
+		// トラック毎にフレーム順へ整列
+		for(bone_track& t : bone_tracks_) {
+			std::stable_sort(t.keys_.begin(), t.keys_.end(),
+				[](const bone_key& a, const bone_key& b) { return a.frame_ < b.frame_; });
+			t.keys_.shrink_to_fit();
+		}
+		for(morph_track& t : morph_tracks_) {
+			std::stable_sort(t.keys_.begin(), t.keys_.end(),
+				[](const morph_key& a, const morph_key& b) { return a.frame_ < b.frame_; });
+			t.keys_.shrink_to_fit();
+		}
+
+		return true;
+	}
+
+
+	void vmd_io::sample(const bone_track& track, float frame, uint32_t& cursor,
+		vtx::fvtx& pos, qtx::fquat& rot)
+	{
+		const bone_keys& keys = track.keys_;
+		if(keys.empty()) {
+			pos.set(0.0f);
+			rot.set(0.0f, 0.0f, 0.0f, 1.0f);
+			return;
+		}
+
+		uint32_t c = find_(keys, frame, cursor);
+		const bone_key& k0 = keys[c];
+		if(c + 1 >= keys.size() || frame <= static_cast<float>(k0.frame_)) {
+			pos = k0.position_;
+			rot = k0.rotation_;
+			return;
+		}
+
+		// 補間曲線は後側のキーが持つ
+		const bone_key& k1 = keys[c + 1];
+		float t = (frame - static_cast<float>(k0.frame_))
+			/ static_cast<float>(k1.frame_ - k0.frame_);
+		float tx = k1.curve_[0].get(t);
+		float ty = k1.curve_[1].get(t);
+		float tz = k1.curve_[2].get(t);
+		float tr = k1.curve_[3].get(t);
+		pos.set(k0.position_.x + (k1.position_.x - k0.position_.x) * tx,
+				k0.position_.y + (k1.position_.y - k0.position_.y) * ty,
+				k0.position_.z + (k1.position_.z - k0.position_.z) * tz);
+		rot.slerp(k0.rotation_, k1.rotation_, tr);
+	}
+
+
+	float vmd_io::sample(const morph_track& track, float frame, uint32_t& cursor)
+	{
+		const morph_keys& keys = track.keys_;
+		if(keys.empty()) return 0.0f;
+
+		uint32_t c = find_(keys, frame, cursor);
+		const morph_key& k0 = keys[c];
+		if(c + 1 >= keys.size() || frame <= static_cast<float>(k0.frame_)) {
+			return k0.weight_;
+		}
+		const morph_key& k1 = keys[c + 1];
+		float t = (frame - static_cast<float>(k0.frame_))
+			/ static_cast<float>(k1.frame_ - k0.frame_);
+		return k0.weight_ + (k1.weight_ - k0.weight_) * t;
+	}
+}
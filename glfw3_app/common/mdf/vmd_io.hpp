@@ -0,0 +1,339 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	VMD（モーション）ファイルを扱うクラス（ヘッダー） @n
+			ボーン、モーフのキーフレームを名前毎のトラックに整理し、@n
+			フレーム順に並べて保持する。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include "utils/vtx.hpp"
+#include "utils/quat.hpp"
+#include "utils/file_io.hpp"
+#include <boost/format.hpp>
+
+namespace mdf {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	VMD クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class vmd_io {
+	public:
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	補間ベジェ曲線 @n
+					(0,0)、(x1,y1)、(x2,y2)、(1,1) の３次ベジェ曲線
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct bezier {
+			float	x1_;
+			float	y1_;
+			float	x2_;
+			float	y2_;
+			bool	linear_;
+
+			bezier() : x1_(0.0f), y1_(0.0f), x2_(1.0f), y2_(1.0f), linear_(true) { }
+
+			void set(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2) {
+				x1_ = static_cast<float>(x1) / 127.0f;
+				y1_ = static_cast<float>(y1) / 127.0f;
+				x2_ = static_cast<float>(x2) / 127.0f;
+				y2_ = static_cast<float>(y2) / 127.0f;
+				linear_ = (x1 == y1) && (x2 == y2);
+			}
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	補間値を求める
+				@param[in]	t	フレーム間の位置（0.0 〜 1.0）
+				@return 補間係数
+			*/
+			//-------------------------------------------------------------//
+			float get(float t) const {
+				if(linear_) return t;
+				// x(s) = t となる s をニュートン法で求め、失敗したら二分法
+				float s = t;
+				for(int i = 0; i < 8; ++i) {
+					float is = 1.0f - s;
+					float x = 3.0f * is * is * s * x1_ + 3.0f * is * s * s * x2_ + s * s * s - t;
+					if(std::abs(x) < 1e-5f) break;
+					float dx = 3.0f * is * is * x1_ + 6.0f * is * s * (x2_ - x1_)
+						+ 3.0f * s * s * (1.0f - x2_);
+					if(std::abs(dx) < 1e-6f) {
+						float lo = 0.0f;
+						float hi = 1.0f;
+						s = t;
+						for(int j = 0; j < 20; ++j) {
+							float js = 1.0f - s;
+							float xx = 3.0f * js * js * s * x1_ + 3.0f * js * s * s * x2_ + s * s * s;
+							if(xx < t) lo = s; else hi = s;
+							s = (lo + hi) * 0.5f;
+						}
+						break;
+					}
+					s -= x / dx;
+					if(s < 0.0f) s = 0.0f;
+					else if(s > 1.0f) s = 1.0f;
+				}
+				float is = 1.0f - s;
+				return 3.0f * is * is * s * y1_ + 3.0f * is * s * s * y2_ + s * s * s;
+			}
+		};
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	ボーン・キーフレーム
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct bone_key {
+			uint32_t	frame_;
+			vtx::fvtx	position_;
+			qtx::fquat	rotation_;
+			bezier		curve_[4];	///< X、Y、Z、回転
+		};
+		typedef std::vector<bone_key>	bone_keys;
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	モーフ・キーフレーム
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct morph_key {
+			uint32_t	frame_;
+			float		weight_;
+		};
+		typedef std::vector<morph_key>	morph_keys;
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	ボーン・トラック（フレーム順）
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct bone_track {
+			std::string	name_;
+			bone_keys	keys_;
+		};
+		typedef std::vector<bone_track>	bone_tracks;
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	モーフ・トラック（フレーム順）
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct morph_track {
+			std::string	name_;
+			morph_keys	keys_;
+		};
+		typedef std::vector<morph_track>	morph_tracks;
+
+	private:
+		std::string		model_name_;
+
+		bone_tracks		bone_tracks_;
+		morph_tracks	morph_tracks_;
+
+		typedef std::unordered_map<std::string, uint32_t>	track_map;
+		track_map		bone_map_;
+		track_map		morph_map_;
+
+		uint32_t		last_frame_;
+
+		static void get_text_(const char* src, uint32_t n, std::string& dst);
+
+		// 区間の検索（キャッシュ付き）
+		template <class KEYS>
+		static uint32_t find_(const KEYS& keys, float frame, uint32_t& cursor) {
+			uint32_t n = keys.size();
+			uint32_t c = cursor;
+			if(c < n && static_cast<float>(keys[c].frame_) <= frame) {
+				// 再生中はほとんど同じ区間か、次の区間
+				if(c + 1 >= n || frame < static_cast<float>(keys[c + 1].frame_)) return c;
+				if(c + 2 >= n || frame < static_cast<float>(keys[c + 2].frame_)) {
+					cursor = c + 1;
+					return c + 1;
+				}
+			}
+			// 二分探索（frame 以下の最後のキー）
+			uint32_t lo = 0;
+			uint32_t hi = n;
+			while(lo < hi) {
+				uint32_t mid = (lo + hi) >> 1;
+				if(static_cast<float>(keys[mid].frame_) <= frame) lo = mid + 1;
+				else hi = mid;
+			}
+			c = lo > 0 ? lo - 1 : 0;
+			cursor = c;
+			return c;
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		vmd_io() : last_frame_(0) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	廃棄
+		*/
+		//-----------------------------------------------------------------//
+		void destroy() {
+			model_name_.clear();
+			bone_tracks_.clear();
+			morph_tracks_.clear();
+			bone_map_.clear();
+			morph_map_.clear();
+			last_frame_ = 0;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ロード
+			@param[in]	fio	ファイル入出力クラス
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool load(utils::file_io& fio);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ロード
+			@param[in]	fn	ファイル名
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool load(const std::string& fn) {
+			utils::file_io fio;
+			if(!fio.open(fn, "rb")) {
+				return false;
+			}
+			bool f = load(fio);
+			fio.close();
+			return f;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	情報を取得
+			@param[out]	info	情報
+		*/
+		//-----------------------------------------------------------------//
+		void get_info(std::string& info) const {
+			info += (boost::format("Model: '%s'\n") % model_name_).str();
+			info += (boost::format("Bone tracks: %d\n") % bone_tracks_.size()).str();
+			info += (boost::format("Morph tracks: %d\n") % morph_tracks_.size()).str();
+			info += (boost::format("Last frame: %d\n") % last_frame_).str();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	モデル名の取得
+			@return モデル名
+		*/
+		//-----------------------------------------------------------------//
+		const std::string& get_model_name() const { return model_name_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	最終フレームの取得
+			@return 最終フレーム
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_last_frame() const { return last_frame_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ボーン・トラックの参照
+			@return ボーン・トラック
+		*/
+		//-----------------------------------------------------------------//
+		const bone_tracks& get_bone_tracks() const { return bone_tracks_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	モーフ・トラックの参照
+			@return モーフ・トラック
+		*/
+		//-----------------------------------------------------------------//
+		const morph_tracks& get_morph_tracks() const { return morph_tracks_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ボーン・トラックの検索
+			@param[in]	name	ボーン名（UTF-8）
+			@return 無い場合「-1」
+		*/
+		//-----------------------------------------------------------------//
+		int32_t find_bone_track(const std::string& name) const {
+			track_map::const_iterator it = bone_map_.find(name);
+			if(it == bone_map_.end()) return -1;
+			return static_cast<int32_t>(it->second);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	モーフ・トラックの検索
+			@param[in]	name	モーフ名（UTF-8）
+			@return 無い場合「-1」
+		*/
+		//-----------------------------------------------------------------//
+		int32_t find_morph_track(const std::string& name) const {
+			track_map::const_iterator it = morph_map_.find(name);
+			if(it == morph_map_.end()) return -1;
+			return static_cast<int32_t>(it->second);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ボーン・トラックのサンプリング @n
+					cursor は前回の区間を保持し、連続再生では探索を省く。
+			@param[in]	track	トラック
+			@param[in]	frame	フレーム
+			@param[in,out]	cursor	区間キャッシュ
+			@param[out]	pos	移動量
+			@param[out]	rot	回転
+		*/
+		//-----------------------------------------------------------------//
+		static void sample(const bone_track& track, float frame, uint32_t& cursor,
+			vtx::fvtx& pos, qtx::fquat& rot);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	モーフ・トラックのサンプリング（線形補間）
+			@param[in]	track	トラック
+			@param[in]	frame	フレーム
+			@param[in,out]	cursor	区間キャッシュ
+			@return ウェイト
+		*/
+		//-----------------------------------------------------------------//
+		static float sample(const morph_track& track, float frame, uint32_t& cursor);
+	};
+}
@@ -0,0 +1,445 @@
+//=====================================================================//
+/*!	@file
+	@brief	メディア・ライブラリー・インデックス
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "snd_io/media_index.hpp"
+#include "utils/file_io.hpp"
+#include "utils/file_info.hpp"
+
+namespace al {
+
+	const media_index::ids media_index::empty_;
+
+	namespace {
+
+		static const char file_magic_[4] = { 'M', 'I', 'D', 'X' };
+		static const uint32_t file_version_ = 1;
+
+		void put_u32_(std::vector<char>& out, uint32_t v)
+		{
+			char tmp[4];
+			std::memcpy(tmp, &v, 4);
+			out.insert(out.end(), tmp, tmp + 4);
+		}
+
+		void put_u64_(std::vector<char>& out, uint64_t v)
+		{
+			char tmp[8];
+			std::memcpy(tmp, &v, 8);
+			out.insert(out.end(), tmp, tmp + 8);
+		}
+
+		void put_str_(std::vector<char>& out, const std::string& s)
+		{
+			put_u32_(out, s.size());
+			out.insert(out.end(), s.begin(), s.end());
+		}
+
+
+		struct reader_ {
+			const char*	p;
+			const char*	end;
+			bool		error;
+
+			template <typename T>
+			T get() {
+				T v = 0;
+				if(static_cast<size_t>(end - p) < sizeof(T)) { error = true; return v; }
+				std::memcpy(&v, p, sizeof(T));
+				p += sizeof(T);
+				return v;
+			}
+
+			void get(std::string& s) {
+				uint32_t n = get<uint32_t>();
+				if(error || static_cast<size_t>(end - p) < n) { error = true; return; }
+				s.assign(p, n);
+				p += n;
+			}
+		};
+
+
+		// WIN32 では、UTF-8 のパスを UTF-16 にして調べる（file_io の probe_file と同じ）
+		bool stat_(const std::string& path, uint64_t& size, int64_t& time)
+		{
+#ifdef WIN32
+			struct _stat st;
+			utils::wstring wfn;
+			utils::utf8_to_utf16(path, wfn);
+			if(_wstat((const wchar_t*)wfn.c_str(), &st) != 0) return false;
+#else
+			struct stat st;
+			if(stat(path.c_str(), &st) != 0) return false;
+#endif
+			if(S_ISDIR(st.st_mode)) return false;
+			size = st.st_size;
+			time = st.st_mtime;
+			return true;
+		}
+
+
+		void set_entry_(const tag& t, tag_format fmt, media_index::entry& e)
+		{
+			e.format_ = fmt;
+			e.cover_ = !t.image_mime_.empty();
+			e.title_ = t.title_;
+			e.artist_ = t.artist_;
+			e.writer_ = t.writer_;
+			e.album_ = t.album_;
+			e.track_ = t.track_;
+			e.total_tracks_ = t.total_tracks_;
+			e.disc_ = t.disc_;
+			e.total_discs_ = t.total_discs_;
+			e.date_ = t.date_;
+		}
+
+
+		bool find_nocase_(const std::string& src, const std::string& key)
+		{
+			auto it = std::search(src.begin(), src.end(), key.begin(), key.end(),
+				[](char a, char b) {
+					if(a >= 'A' && a <= 'Z') a += 0x20;
+					if(b >= 'A' && b <= 'Z') b += 0x20;
+					return a == b;
+				});
+			return it != src.end();
+		}
+	}
+
+
+	void media_index::rebuild_()
+	{
+		path_map_.clear();
+		artist_map_.clear();
+		album_map_.clear();
+		for(uint32_t i = 0; i < entry_.size(); ++i) {
+			const entry& e = entry_[i];
+			path_map_[e.path_] = i;
+			if(!e.artist_.empty()) artist_map_[e.artist_].push_back(i);
+			if(!e.album_.empty()) album_map_[e.album_].push_back(i);
+		}
+
+		auto order = [this](uint32_t a, uint32_t b) {
+			const entry& ea = entry_[a];
+			const entry& eb = entry_[b];
+			int c = ea.album_.compare(eb.album_);
+			if(c != 0) return c < 0;
+			int da = std::atoi(ea.disc_.c_str());
+			int db = std::atoi(eb.disc_.c_str());
+			if(da != db) return da < db;
+			int ta = std::atoi(ea.track_.c_str());
+			int tb = std::atoi(eb.track_.c_str());
+			if(ta != tb) return ta < tb;
+			return ea.path_ < eb.path_;
+		};
+		for(auto& t : artist_map_) std::sort(t.second.begin(), t.second.end(), order);
+		for(auto& t : album_map_) std::sort(t.second.begin(), t.second.end(), order);
+	}
+
+
+	uint32_t media_index::update_(const utils::strings& paths, uint32_t threads)
+	{
+		// 変更されたファイルだけを集める
+		struct job_t {
+			uint32_t	id;
+			tag_format	fmt;
+			tag			tag_;
+		};
+		std::vector<job_t> jobs;
+		for(const std::string& path : paths) {
+			uint64_t size;
+			int64_t time;
+			if(!stat_(path, size, time)) continue;
+			uint32_t id = find(path);
+			if(id != npos) {
+				entry& e = entry_[id];
+				if(e.size_ == size && e.time_ == time) continue;
+				e.size_ = size;
+				e.time_ = time;
+			} else {
+				id = entry_.size();
+				entry_.emplace_back();
+				entry& e = entry_.back();
+				e.path_ = path;
+				e.size_ = size;
+				e.time_ = time;
+				path_map_[path] = id;
+			}
+			jobs.emplace_back();
+			jobs.back().id = id;
+		}
+		if(jobs.empty()) return 0;
+
+		if(threads == 0) {
+			threads = std::thread::hardware_concurrency();
+			if(threads == 0) threads = 1;
+			else if(threads > 8) threads = 8;
+		}
+		if(threads > jobs.size()) threads = jobs.size();
+
+		std::atomic<uint32_t> next(0);
+		auto work = [&]() {
+			uint32_t i;
+			while((i = next++) < jobs.size()) {
+				job_t& j = jobs[i];
+				j.fmt = read_tag(entry_[j.id].path_, j.tag_, false);
+			}
+		};
+		if(threads <= 1) {
+			work();
+		} else {
+			std::vector<std::thread> ths;
+			for(uint32_t i = 0; i < threads; ++i) ths.emplace_back(work);
+			for(auto& th : ths) th.join();
+		}
+
+		for(const job_t& j : jobs) {
+			set_entry_(j.tag_, j.fmt, entry_[j.id]);
+		}
+		rebuild_();
+		modify_ = true;
+		return jobs.size();
+	}
+
+
+	void media_index::scan_dir_(const std::string& root, utils::strings& paths) const
+	{
+		utils::file_infos list;
+		if(!utils::create_file_list(root, list)) return;
+		utils::strings exts = utils::split_text(exts_, ",");
+		for(const utils::file_info& fi : list) {
+			const std::string& name = fi.get_name();
+			if(name == "." || name == "..") continue;
+			std::string path = utils::append_path(root, name);
+			if(fi.is_directory()) {
+				scan_dir_(path, paths);
+				continue;
+			}
+			std::string ext = utils::get_file_ext(name);
+			for(const std::string& s : exts) {
+				if(utils::no_capital_strcmp(ext, s) == 0) {
+					paths.push_back(path);
+					break;
+				}
+			}
+		}
+	}
+
+
+	void media_index::clear()
+	{
+		entry_.clear();
+		path_map_.clear();
+		artist_map_.clear();
+		album_map_.clear();
+		modify_ = true;
+	}
+
+
+	bool media_index::load(const std::string& path)
+	{
+		if(!utils::probe_file(path)) return false;
+		utils::file_io fin;
+		if(!fin.open_map(path)) return false;
+
+		std::vector<char> buff;
+		const char* top = static_cast<const char*>(fin.get_span());
+		size_t size = fin.get_file_size();
+		if(top == nullptr) {
+			buff.resize(size);
+			size = fin.read(buff.data(), size);
+			top = buff.data();
+		}
+
+		reader_ rd{ top, top + size, false };
+		if(size < 12 || std::memcmp(top, file_magic_, 4) != 0) return false;
+		rd.p += 4;
+		if(rd.get<uint32_t>() != file_version_) return false;
+		uint32_t num = rd.get<uint32_t>();
+
+		std::vector<entry> tmp;
+		tmp.reserve(std::min(static_cast<size_t>(num), size / 32));
+		for(uint32_t i = 0; i < num && !rd.error; ++i) {
+			tmp.emplace_back();
+			entry& e = tmp.back();
+			e.size_ = rd.get<uint64_t>();
+			e.time_ = rd.get<int64_t>();
+			e.format_ = static_cast<tag_format>(rd.get<uint8_t>());
+			e.cover_ = rd.get<uint8_t>() != 0;
+			rd.get(e.path_);
+			rd.get(e.title_);
+			rd.get(e.artist_);
+			rd.get(e.writer_);
+			rd.get(e.album_);
+			rd.get(e.track_);
+			rd.get(e.total_tracks_);
+			rd.get(e.disc_);
+			rd.get(e.total_discs_);
+			rd.get(e.date_);
+		}
+		fin.close();
+		if(rd.error) return false;
+
+		entry_.swap(tmp);
+		rebuild_();
+		modify_ = false;
+		return true;
+	}
+
+
+	bool media_index::save(const std::string& path)
+	{
+		std::string tmp = path + ".tmp";
+		utils::file_io fo;
+		if(!fo.open(tmp, "wb")) return false;
+
+		std::vector<char> out;
+		out.reserve(64 * 1024 + 1024);
+		out.insert(out.end(), file_magic_, file_magic_ + 4);
+		put_u32_(out, file_version_);
+		put_u32_(out, entry_.size());
+		bool err = false;
+		for(const entry& e : entry_) {
+			put_u64_(out, e.size_);
+			put_u64_(out, static_cast<uint64_t>(e.time_));
+			out.push_back(static_cast<char>(e.format_));
+			out.push_back(e.cover_ ? 1 : 0);
+			put_str_(out, e.path_);
+			put_str_(out, e.title_);
+			put_str_(out, e.artist_);
+			put_str_(out, e.writer_);
+			put_str_(out, e.album_);
+			put_str_(out, e.track_);
+			put_str_(out, e.total_tracks_);
+			put_str_(out, e.disc_);
+			put_str_(out, e.total_discs_);
+			put_str_(out, e.date_);
+			if(out.size() >= (64 * 1024)) {
+				if(fo.write(out.data(), out.size()) != out.size()) err = true;
+				out.clear();
+			}
+		}
+		if(!out.empty()) {
+			if(fo.write(out.data(), out.size()) != out.size()) err = true;
+		}
+		fo.close();
+		if(err) {
+			utils::remove_file(tmp);
+			return false;
+		}
+		utils::remove_file(path);
+		if(std::rename(tmp.c_str(), path.c_str()) != 0) return false;
+		modify_ = false;
+		return true;
+	}
+
+
+	uint32_t media_index::scan(const std::string& root, uint32_t threads)
+	{
+		utils::strings paths;
+		scan_dir_(root, paths);
+
+		// ルート以下で、無くなったファイルを取り除く
+		boost::unordered_map<std::string, bool> exist;
+		for(const std::string& s : paths) exist[s] = true;
+		std::string top = root;
+		if(!top.empty() && top.back() != '/') top += '/';
+		size_t n = 0;
+		for(size_t i = 0; i < entry_.size(); ++i) {
+			const entry& e = entry_[i];
+			if(e.path_.compare(0, top.size(), top) == 0 && exist.find(e.path_) == exist.end()) {
+				continue;
+			}
+			if(n != i) entry_[n] = std::move(entry_[i]);
+			++n;
+		}
+		if(n != entry_.size()) {
+			entry_.resize(n);
+			rebuild_();
+			modify_ = true;
+		}
+		return update_(paths, threads);
+	}
+
+
+	media_index::ids media_index::search(const std::string& key, bool nocase) const
+	{
+		ids out;
+		for(uint32_t i = 0; i < entry_.size(); ++i) {
+			const entry& e = entry_[i];
+			bool f;
+			if(nocase) {
+				f = find_nocase_(e.title_, key) || find_nocase_(e.artist_, key)
+					|| find_nocase_(e.album_, key);
+			} else {
+				f = e.title_.find(key) != std::string::npos || e.artist_.find(key) != std::string::npos
+					|| e.album_.find(key) != std::string::npos;
+			}
+			if(f) out.push_back(i);
+		}
+		return out;
+	}
+
+
+	utils::strings media_index::get_artists() const
+	{
+		utils::strings ss;
+		ss.reserve(artist_map_.size());
+		for(const auto& t : artist_map_) ss.push_back(t.first);
+		std::sort(ss.begin(), ss.end());
+		return ss;
+	}
+
+
+	utils::strings media_index::get_albums() const
+	{
+		utils::strings ss;
+		ss.reserve(album_map_.size());
+		for(const auto& t : album_map_) ss.push_back(t.first);
+		std::sort(ss.begin(), ss.end());
+		return ss;
+	}
+
+
+	bool media_index::get_tag(uint32_t id, tag& t) const
+	{
+		if(id >= entry_.size()) return false;
+		const entry& e = entry_[id];
+		t.clear();
+		t.title_ = e.title_;
+		t.artist_ = e.artist_;
+		t.writer_ = e.writer_;
+		t.album_ = e.album_;
+		t.track_ = e.track_;
+		t.total_tracks_ = e.total_tracks_;
+		t.disc_ = e.disc_;
+		t.total_discs_ = e.total_discs_;
+		t.date_ = e.date_;
+		t.update();
+		return true;
+	}
+
+
+	bool media_index::read_cover(uint32_t id, tag& t) const
+	{
+		if(id >= entry_.size()) return false;
+		const entry& e = entry_[id];
+		if(!e.cover_) return false;
+		read_tag(e.path_, t, true);
+		t.update();
+		return t.image_ != nullptr;
+	}
+}
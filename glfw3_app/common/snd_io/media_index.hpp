@@ -0,0 +1,272 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	メディア・ライブラリー・インデックス（ヘッダー） @n
+			・音楽ファイルのタグ情報を、パスをキーとして保持し、@n
+			ファイルに保存する。@n
+			・再スキャンでは、サイズと更新時間が変わったファイルだけを @n
+			tag_reader で解析する（複数スレッド）。@n
+			・アルバム、アーティスト、タイトルで検索できる。@n
+			・画像は保持せず、必要になった時にファイルから読む。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "snd_io/tag_reader.hpp"
+#include "utils/string_utils.hpp"
+
+namespace al {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	media_index クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class media_index {
+	public:
+		//=================================================================//
+		/*!
+			@brief	エントリー
+		*/
+		//=================================================================//
+		struct entry {
+			std::string	path_;
+			uint64_t	size_;
+			int64_t		time_;
+			tag_format	format_;
+			bool		cover_;			///< 画像がある場合「true」
+
+			std::string	title_;
+			std::string	artist_;
+			std::string	writer_;
+			std::string	album_;
+			std::string	track_;
+			std::string	total_tracks_;
+			std::string	disc_;
+			std::string	total_discs_;
+			std::string	date_;
+
+			entry() : size_(0), time_(0), format_(tag_format::NONE), cover_(false) { }
+		};
+
+		typedef std::vector<uint32_t>	ids;
+
+		static const uint32_t npos = 0xffffffff;
+
+	private:
+		typedef boost::unordered_map<std::string, uint32_t>	path_map;
+		typedef boost::unordered_map<std::string, ids>		name_map;
+
+		std::vector<entry>	entry_;
+		path_map			path_map_;
+		name_map			artist_map_;
+		name_map			album_map_;
+		std::string			exts_;
+		bool				modify_;
+
+		static const ids	empty_;
+
+		void rebuild_();
+		uint32_t update_(const utils::strings& paths, uint32_t threads);
+		void scan_dir_(const std::string& root, utils::strings& paths) const;
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		media_index() : exts_("mp3,m4a,mp4,aac,ogg,opus,flac"), modify_(false) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	スキャン対象の拡張子を設定
+			@param[in]	exts	拡張子（「,」で区切る）
+		*/
+		//-----------------------------------------------------------------//
+		void set_exts(const std::string& exts) { exts_ = exts; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	全て消去
+		*/
+		//-----------------------------------------------------------------//
+		void clear();
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	インデックスをロード
+			@param[in]	path	ファイル・パス
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool load(const std::string& path);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	インデックスをセーブ（一時ファイルに書いてから置き換える）
+			@param[in]	path	ファイル・パス
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool save(const std::string& path);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ディレクトリーを再帰的にスキャン @n
+					無くなったファイルは、インデックスから取り除く。@n
+					※エントリーを取り除いた場合、ID は変わる。
+			@param[in]	root	ルート・ディレクトリー
+			@param[in]	threads	スレッド数（０ならハードウェアに合わせる）
+			@return 解析したファイル数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t scan(const std::string& root, uint32_t threads = 0);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイル・リストを更新 @n
+					変更されたファイルと、新しいファイルだけを解析する。
+			@param[in]	paths	ファイル・パスのリスト
+			@param[in]	threads	スレッド数（０ならハードウェアに合わせる）
+			@return 解析したファイル数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t update(const utils::strings& paths, uint32_t threads = 0) {
+			return update_(paths, threads);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	変更されているか
+			@return 変更されていれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool is_modify() const { return modify_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	エントリー数を取得
+			@return エントリー数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t size() const { return entry_.size(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	エントリーを取得
+			@param[in]	id	ID
+			@return エントリー
+		*/
+		//-----------------------------------------------------------------//
+		const entry& get(uint32_t id) const { return entry_[id]; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	パスから ID を探す
+			@param[in]	path	ファイル・パス
+			@return ID（無い場合「npos」）
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t find(const std::string& path) const {
+			auto it = path_map_.find(path);
+			if(it == path_map_.end()) return npos;
+			return it->second;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アルバムの曲を探す（ディスク、トラック順）
+			@param[in]	album	アルバム名
+			@return ID のリスト
+		*/
+		//-----------------------------------------------------------------//
+		const ids& find_album(const std::string& album) const {
+			auto it = album_map_.find(album);
+			if(it == album_map_.end()) return empty_;
+			return it->second;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーティストの曲を探す（アルバム、ディスク、トラック順）
+			@param[in]	artist	アーティスト名
+			@return ID のリスト
+		*/
+		//-----------------------------------------------------------------//
+		const ids& find_artist(const std::string& artist) const {
+			auto it = artist_map_.find(artist);
+			if(it == artist_map_.end()) return empty_;
+			return it->second;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	タイトル、アーティスト、アルバムを部分一致で探す
+			@param[in]	key	キー
+			@param[in]	nocase	大文字、小文字（ASCII）を区別しない場合「true」
+			@return ID のリスト
+		*/
+		//-----------------------------------------------------------------//
+		ids search(const std::string& key, bool nocase = true) const;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーティスト名のリストを得る（ソート済み）
+			@return アーティスト名のリスト
+		*/
+		//-----------------------------------------------------------------//
+		utils::strings get_artists() const;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アルバム名のリストを得る（ソート済み）
+			@return アルバム名のリスト
+		*/
+		//-----------------------------------------------------------------//
+		utils::strings get_albums() const;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	タグを取得（画像無し）
+			@param[in]	id	ID
+			@param[out]	t	タグ
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool get_tag(uint32_t id, tag& t) const;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	画像をファイルから読む @n
+					デコードは tag::decode_image で行う。
+			@param[in]	id	ID
+			@param[out]	t	タグ
+			@return 画像があれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool read_cover(uint32_t id, tag& t) const;
+	};
+}
@@ -116,7 +116,7 @@ namespace al {
 		bool probe(const std::string& filename) const {
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(filename, "rb")) {
+			if(fin.open_map(filename)) {
 				f = probe(fin, utils::get_file_ext(filename));
 				fin.close();
 			}
@@ -152,7 +152,7 @@ namespace al {
 				  i_snd_io::info_state st = i_snd_io::info_state::all) {
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(filename, "rb")) {
+			if(fin.open_map(filename)) {
 				f = info(fin, fo, st, utils::get_file_ext(filename));
 				fin.close();
 			}
@@ -183,7 +183,7 @@ namespace al {
 		bool load(const std::string& filename, const std::string& opt = "") {
 			bool f = false;
 			utils::file_io fin;
-			if(fin.open(filename, "rb")) {
+			if(fin.open_map(filename)) {
 				f = load(fin, utils::get_file_ext(filename), opt);
 				fin.close();
 			}
@@ -109,8 +109,8 @@ namespace al {
 			sst.state_ = sound::stream_state::PLAY;
 			bool first_pause = true;
 			while(pos < ainfo.samples) {
-				if(sst.request_.length()) {
-					const sound::request_t& r = sst.request_.get();
+				sound::request_t r;
+				if(sst.request_.get(r)) {
 					if(r.command_ == sound::request_t::command::NEXT) {
 						++i;
 						cmdin = true;
@@ -240,13 +240,19 @@ namespace al {
 
 				audio_io::wave_handle h = qt.audio_io_->status_stream(qt.slot_);
 				if(h) {
-					pthread_mutex_lock(&qt.sync_);
-					for(uint32_t i = 0; i < pcm_size; ++i) {
-						auto a = qt.wave_.get();
-						al::pcm16_s w(a, a);
-						aif->put(i, w);
+					// リング・バッファから直接（折り返しは２回に分けて）ステレオに展開
+					al::pcm16_s* dst = static_cast<al::pcm16_s*>(aif->at_wave());
+					uint32_t i = 0;
+					while(i < pcm_size) {
+						const int16_t* src;
+						uint32_t n = qt.wave_.peek(src);
+						if(n > (pcm_size - i)) n = pcm_size - i;
+						for(uint32_t j = 0; j < n; ++j) {
+							dst[i + j] = al::pcm16_s(src[j], src[j]);
+						}
+						qt.wave_.consume(n);
+						i += n;
 					}
-					pthread_mutex_unlock(&qt.sync_);
 
 					qt.audio_io_->set_loop(h, false);
 					qt.audio_io_->queue_stream(qt.slot_, h, aif);
@@ -257,9 +263,7 @@ namespace al {
 				audio_io::wave_handle h = qt.audio_io_->status_stream(qt.slot_);
 				if(h) {
 					audio aif;
-					pthread_mutex_lock(&qt.sync_);
-					aif = qt.audio_.get();
-					pthread_mutex_unlock(&qt.sync_);
+					qt.audio_.get(aif);
 
 					qt.audio_io_->set_loop(h, false);
 					qt.audio_io_->queue_stream(qt.slot_, h, aif);
@@ -288,9 +292,7 @@ namespace al {
 
 		while(t.loop_) {
 			if(t.path_.length()) {
-				pthread_mutex_lock(&t.sync_);
-				std::string path = t.path_.top();
-				pthread_mutex_unlock(&t.sync_);
+				std::string path = t.path_.front();
 				al::audio_info ai;
 				bool f = sdf.info(path, ai, i_snd_io::info_state::none);
 				pthread_mutex_lock(&t.sync_);
@@ -301,11 +303,10 @@ namespace al {
 					t.tag_.title_ = utils::get_file_name(path);
 					t.tag_.serial_ = n + 1;
 				}
-				if(t.path_.length()) {
-					t.path_.get();
-				}
 				// if(!f) std::cout << "Error: '" << path << "'" << std::endl;
 				pthread_mutex_unlock(&t.sync_);
+				// 開放は最後に行い、request_tag_info が次を受け付ける
+				t.path_.consume();
 			} else {
 				usleep(20000);	// 20ms
 			}
@@ -482,9 +483,7 @@ namespace al {
 			tag_thread_ = true;
 		}
 
-		pthread_mutex_lock(&tag_info_.sync_);
 		tag_info_.path_.put(fpath);
-		pthread_mutex_unlock(&tag_info_.sync_);
 
 		return true;
 	}
@@ -500,7 +499,6 @@ namespace al {
 		if(queue_start_) {
 			queue_t_.exit_ = true;
  			pthread_join(queue_pth_ , nullptr);
-			pthread_mutex_destroy(&queue_t_.sync_);
 		}
 
 		if(tag_thread_) {
@@ -17,7 +17,7 @@
 #include "snd_io/snd_files.hpp"
 #include "snd_io/tag.hpp"
 #include "snd_io/pcm.hpp"
-#include "utils/fifo.hpp"
+#include "utils/ring_buffer.hpp"
 #include "utils/string_utils.hpp"
 
 namespace al {
@@ -82,7 +82,7 @@ namespace al {
 			std::string				root_;
 			std::string				file_;
 
-			utils::fifo<request_t, 64> request_;
+			utils::mpsc_ring<request_t, 64> request_;
 			stream_state::type		state_;
 
 			volatile bool			start_;
@@ -113,7 +113,7 @@ namespace al {
 		*/
 		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 		struct tag_info {
-			utils::fifo<std::string, 2> path_;
+			utils::spsc_ring<std::string, 2> path_;
 			volatile bool		loop_;
 			pthread_mutex_t		sync_;
 			tag					tag_;
@@ -130,10 +130,8 @@ namespace al {
 			audio_io*				audio_io_;
 			audio_io::slot_handle	slot_;
 
-			utils::fifo<int16_t, 512 * 8>	wave_;
-			utils::fifo<audio, 32>			audio_;
-
-			pthread_mutex_t			sync_;
+			utils::spsc_ring<int16_t, 512 * 8>	wave_;
+			utils::spsc_ring<audio, 32>			audio_;
 
 			volatile uint32_t		frame_;
 			volatile bool			start_;
@@ -192,7 +190,6 @@ namespace al {
 				queue_t_.slot_ = stream_slot_;
 				queue_t_.exit_ = false;
 
-				pthread_mutex_init(&queue_t_.sync_, nullptr);
 				pthread_create(&queue_pth_, nullptr, queue_task_, &queue_t_);
 			}
 		}
@@ -272,7 +269,7 @@ namespace al {
 			}
 
 			utils::file_io fin;
-			if(!fin.open(filename, "rb")) {
+			if(!fin.open_map(filename)) {
 				return 0;
 			}
 			uint32_t h = load(fin, utils::get_file_ext(filename));
@@ -575,15 +572,7 @@ namespace al {
 
 			queue_setup_();
 
-			bool f = false;
-			if(queue_t_.audio_.length() < (queue_t_.audio_.size() - 1)) {
-				pthread_mutex_lock(&queue_t_.sync_);
-				queue_t_.audio_.put(aif);
-				pthread_mutex_unlock(&queue_t_.sync_);
-				f = true;
-			}
-
-			return f;
+			return queue_t_.audio_.put(aif);
 		}
 
 
@@ -604,12 +593,8 @@ namespace al {
 //				std::cout << "no waves..." << std::endl;
 //			}
 
-			if((queue_t_.wave_.size() - queue_t_.wave_.length()) > waves.size()) {
-				pthread_mutex_lock(&queue_t_.sync_);
-				for(auto w : waves) {
-					queue_t_.wave_.put(w);
-				}
-				pthread_mutex_unlock(&queue_t_.sync_);
+			if(queue_t_.wave_.space() >= waves.size()) {
+				queue_t_.wave_.write(waves.data(), waves.size());
 				return true;
 			} else {
 //				std::cout << "full..." << std::endl;
@@ -0,0 +1,621 @@
+//=====================================================================//
+/*!	@file
+	@brief	音楽ファイルのタグ読み込み
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "snd_io/tag_reader.hpp"
+#include "utils/file_io.hpp"
+#include "utils/string_utils.hpp"
+
+namespace al {
+
+	namespace {
+
+		inline uint32_t be16_(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+		inline uint32_t be24_(const uint8_t* p) { return (p[0] << 16) | (p[1] << 8) | p[2]; }
+		inline uint32_t be32_(const uint8_t* p) {
+			return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+		}
+		inline uint32_t le32_(const uint8_t* p) {
+			return (static_cast<uint32_t>(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+		}
+		inline uint32_t syncsafe_(const uint8_t* p) {
+			return ((p[0] & 0x7f) << 21) | ((p[1] & 0x7f) << 14) | ((p[2] & 0x7f) << 7) | (p[3] & 0x7f);
+		}
+
+
+		// 制御コードを取り除き、末尾の空白を削る
+		void clean_text_(std::string& s)
+		{
+			size_t n = 0;
+			for(char ch : s) {
+				if(static_cast<uint8_t>(ch) >= 0x20) s[n++] = ch;
+			}
+			while(n > 0 && s[n - 1] == ' ') --n;
+			s.resize(n);
+		}
+
+
+		// Latin-1 領域の文字列（実際には Shift-JIS が多い）
+		void sjis_text_(const uint8_t* p, size_t len, std::string& out)
+		{
+			size_t n = 0;
+			bool ascii = true;
+			while(n < len && p[n] != 0) {
+				if(p[n] >= 0x80) ascii = false;
+				++n;
+			}
+			std::string s(reinterpret_cast<const char*>(p), n);
+			if(ascii) out = s;
+			else {
+				out.clear();
+				utils::sjis_to_utf8(s, out);
+			}
+		}
+
+
+		void utf16_text_(const uint8_t* p, size_t len, bool le, std::string& out)
+		{
+			if(len >= 2) {
+				if(p[0] == 0xff && p[1] == 0xfe) { le = true; p += 2; len -= 2; }
+				else if(p[0] == 0xfe && p[1] == 0xff) { le = false; p += 2; len -= 2; }
+			}
+			utils::wstring ws;
+			for(size_t i = 0; i + 1 < len; i += 2) {
+				uint16_t ch = le ? (p[i] | (p[i + 1] << 8)) : ((p[i] << 8) | p[i + 1]);
+				if(ch == 0) break;
+				ws += ch;
+			}
+			out.clear();
+			utils::utf16_to_utf8(ws, out);
+		}
+
+
+		// ID3v2 のエンコード付き文字列、消費したバイト数を返す
+		size_t id3_text_(uint8_t enc, const uint8_t* p, size_t len, std::string& out)
+		{
+			size_t n = 0;
+			if(enc == 1 || enc == 2) {
+				while(n + 1 < len && (p[n] != 0 || p[n + 1] != 0)) n += 2;
+				utf16_text_(p, n, false, out);
+				n += 2;
+			} else {
+				while(n < len && p[n] != 0) ++n;
+				if(enc == 3) out.assign(reinterpret_cast<const char*>(p), n);
+				else sjis_text_(p, n, out);
+				n += 1;
+			}
+			clean_text_(out);
+			return n < len ? n : len;
+		}
+
+
+		// 「3/12」形式の番号を分ける
+		void set_number_(const std::string& s, std::string& num, std::string& total)
+		{
+			auto pos = s.find('/');
+			if(pos == std::string::npos) {
+				num = s;
+			} else {
+				num = s.substr(0, pos);
+				if(total.empty()) total = s.substr(pos + 1);
+			}
+		}
+
+
+		void set_image_(tag& t, const std::string& mime, uint8_t type, const std::string& dscrp,
+			const uint8_t* p, size_t len, bool image)
+		{
+			// 表紙（3）を優先し、それ以外は最初の画像
+			if(!t.image_mime_.empty() && (t.image_cover_ == 3 || type != 3)) return;
+			if(len == 0) return;
+			t.image_mime_ = mime;
+			t.image_cover_ = type;
+			t.image_dscrp_ = dscrp;
+			if(image) {
+				t.image_ = utils::shared_array_u8(new utils::array_u8);
+				t.image_->copy(p, len);
+			} else {
+				t.image_ = nullptr;
+			}
+		}
+
+
+		void unsync_(const uint8_t* p, size_t len, std::vector<uint8_t>& dst)
+		{
+			dst.clear();
+			dst.reserve(len);
+			for(size_t i = 0; i < len; ++i) {
+				dst.push_back(p[i]);
+				if(p[i] == 0xff && i + 1 < len && p[i + 1] == 0x00) ++i;
+			}
+		}
+
+
+		//-------------------------------------------------------------//
+		// ID3v2
+		//-------------------------------------------------------------//
+		void id3v2_frame_(const char* id, const uint8_t* p, size_t len, uint8_t ver, tag& t, bool image)
+		{
+			if(len < 2) return;
+			if(id[0] == 'T') {
+				std::string s;
+				id3_text_(p[0], p + 1, len - 1, s);
+				if(s.empty()) return;
+				if(std::strcmp(id, "TIT2") == 0) t.title_ = s;
+				else if(std::strcmp(id, "TPE1") == 0) t.artist_ = s;
+				else if(std::strcmp(id, "TALB") == 0) t.album_ = s;
+				else if(std::strcmp(id, "TPE2") == 0) t.writer_ = s;
+				else if(std::strcmp(id, "TRCK") == 0) set_number_(s, t.track_, t.total_tracks_);
+				else if(std::strcmp(id, "TPOS") == 0) set_number_(s, t.disc_, t.total_discs_);
+				else if(std::strcmp(id, "TDRC") == 0) t.date_ = s;
+				else if(std::strcmp(id, "TYER") == 0) {
+					if(t.date_.empty()) t.date_ = s;
+				}
+			} else if(std::strcmp(id, "APIC") == 0) {
+				uint8_t enc = p[0];
+				size_t pos = 1;
+				std::string mime;
+				if(ver == 2) {  // PIC: 画像形式は３文字
+					if(len < pos + 3) return;
+					std::string fmt(reinterpret_cast<const char*>(p + pos), 3);
+					if(utils::no_capital_strcmp(fmt, std::string("PNG")) == 0) mime = "image/png";
+					else mime = "image/jpeg";
+					pos += 3;
+				} else {
+					pos += id3_text_(0, p + pos, len - pos, mime);
+				}
+				if(pos >= len) return;
+				uint8_t type = p[pos++];
+				std::string dscrp;
+				pos += id3_text_(enc, p + pos, len - pos, dscrp);
+				if(pos >= len) return;
+				set_image_(t, mime, type, dscrp, p + pos, len - pos, image);
+			}
+		}
+
+
+		// ID3v2.2 の３文字 ID を v2.3 の ID に変換
+		const char* id3v22_id_(const uint8_t* p)
+		{
+			static const char* tbl[][2] = {
+				{ "TT2", "TIT2" }, { "TP1", "TPE1" }, { "TAL", "TALB" }, { "TP2", "TPE2" },
+				{ "TRK", "TRCK" }, { "TPA", "TPOS" }, { "TYE", "TYER" }, { "PIC", "APIC" },
+			};
+			for(const auto& t : tbl) {
+				if(std::memcmp(p, t[0], 3) == 0) return t[1];
+			}
+			return nullptr;
+		}
+
+
+		size_t parse_id3v2_(const uint8_t* top, size_t size, tag& t, bool image)
+		{
+			if(size < 10 || std::memcmp(top, "ID3", 3) != 0) return 0;
+			uint8_t ver = top[3];
+			uint8_t flags = top[5];
+			size_t tagsize = syncsafe_(top + 6);
+			size_t all = 10 + tagsize + ((ver == 4 && (flags & 0x10)) ? 10 : 0);
+			if(ver < 2 || ver > 4) return all;
+			if(tagsize > size - 10) tagsize = size - 10;
+
+			const uint8_t* p = top + 10;
+			size_t len = tagsize;
+			std::vector<uint8_t> tmp;
+			if(ver < 4 && (flags & 0x80)) {
+				unsync_(p, len, tmp);
+				p = tmp.data();
+				len = tmp.size();
+			}
+
+			size_t pos = 0;
+			if(ver >= 3 && (flags & 0x40) && len >= 4) {  // 拡張ヘッダー
+				size_t n = ver == 3 ? be32_(p) : syncsafe_(p);
+				pos = n > len - 4 ? len : (ver == 3 ? 4 + n : n);
+			}
+
+			size_t hlen = ver == 2 ? 6 : 10;
+			std::vector<uint8_t> ftmp;
+			while(pos + hlen <= len) {
+				const uint8_t* f = p + pos;
+				if(f[0] == 0) break;  // パディング
+				char id[5];
+				size_t fsize;
+				uint8_t fmt = 0;
+				if(ver == 2) {
+					fsize = be24_(f + 3);
+					const char* s = id3v22_id_(f);
+					if(s != nullptr) std::strcpy(id, s);
+					else id[0] = 0;
+				} else {
+					std::memcpy(id, f, 4);
+					id[4] = 0;
+					fsize = ver == 4 ? syncsafe_(f + 4) : be32_(f + 4);
+					fmt = f[9];
+				}
+				pos += hlen;
+				if(fsize > len - pos) break;
+				const uint8_t* d = p + pos;
+				size_t dlen = fsize;
+				pos += fsize;
+				if(id[0] == 0) continue;
+				if(id[0] != 'T' && std::strcmp(id, "APIC") != 0) continue;
+
+				if(ver == 3) {
+					if(fmt & 0xc0) continue;  // 圧縮、暗号化
+					if(fmt & 0x20) { if(dlen < 1) continue; ++d; --dlen; }  // グループ
+				} else if(ver == 4) {
+					if(fmt & 0x0c) continue;  // 圧縮、暗号化
+					if(fmt & 0x40) { if(dlen < 1) continue; ++d; --dlen; }  // グループ
+					if(fmt & 0x01) { if(dlen < 4) continue; d += 4; dlen -= 4; }  // データ長
+					if((fmt & 0x02) || (flags & 0x80)) {
+						unsync_(d, dlen, ftmp);
+						d = ftmp.data();
+						dlen = ftmp.size();
+					}
+				}
+				id3v2_frame_(id, d, dlen, ver, t, image);
+			}
+			return all;
+		}
+
+
+		//-------------------------------------------------------------//
+		// ID3v1（空の項目だけを埋める）
+		//-------------------------------------------------------------//
+		bool parse_id3v1_(const uint8_t* top, size_t size, tag& t)
+		{
+			if(size < 128) return false;
+			const uint8_t* p = top + size - 128;
+			if(std::memcmp(p, "TAG", 3) != 0) return false;
+			std::string s;
+			sjis_text_(p + 3, 30, s);  clean_text_(s);
+			if(t.title_.empty()) t.title_ = s;
+			sjis_text_(p + 33, 30, s); clean_text_(s);
+			if(t.artist_.empty()) t.artist_ = s;
+			sjis_text_(p + 63, 30, s); clean_text_(s);
+			if(t.album_.empty()) t.album_ = s;
+			sjis_text_(p + 93, 4, s);  clean_text_(s);
+			if(t.date_.empty()) t.date_ = s;
+			if(p[125] == 0 && p[126] != 0 && t.track_.empty()) {
+				t.track_ = std::to_string(p[126]);
+			}
+			return true;
+		}
+
+
+		//-------------------------------------------------------------//
+		// Vorbis コメント
+		//-------------------------------------------------------------//
+		int base64_(char ch)
+		{
+			if(ch >= 'A' && ch <= 'Z') return ch - 'A';
+			if(ch >= 'a' && ch <= 'z') return ch - 'a' + 26;
+			if(ch >= '0' && ch <= '9') return ch - '0' + 52;
+			if(ch == '+') return 62;
+			if(ch == '/') return 63;
+			return -1;
+		}
+
+
+		void base64_decode_(const char* p, size_t len, std::vector<uint8_t>& dst)
+		{
+			dst.clear();
+			dst.reserve(len / 4 * 3);
+			uint32_t acc = 0;
+			int bits = 0;
+			for(size_t i = 0; i < len; ++i) {
+				int v = base64_(p[i]);
+				if(v < 0) continue;
+				acc = (acc << 6) | v;
+				bits += 6;
+				if(bits >= 8) {
+					bits -= 8;
+					dst.push_back(static_cast<uint8_t>(acc >> bits));
+				}
+			}
+		}
+
+
+		// FLAC の PICTURE ブロック（ビッグ・エンディアン）
+		void flac_picture_(const uint8_t* p, size_t len, tag& t, bool image)
+		{
+			if(len < 8) return;
+			uint32_t type = be32_(p);
+			size_t pos = 4;
+			uint32_t n = be32_(p + pos); pos += 4;
+			if(n > len - pos) return;
+			std::string mime(reinterpret_cast<const char*>(p + pos), n); pos += n;
+			if(len - pos < 4) return;
+			n = be32_(p + pos); pos += 4;
+			if(n > len - pos) return;
+			std::string dscrp(reinterpret_cast<const char*>(p + pos), n); pos += n;
+			if(len - pos < 20) return;
+			pos += 16;  // 幅、高さ、深さ、色数
+			n = be32_(p + pos); pos += 4;
+			if(n > len - pos) n = len - pos;
+			set_image_(t, mime, type, dscrp, p + pos, n, image);
+		}
+
+
+		void vorbis_comment_(const uint8_t* p, size_t len, tag& t, bool image)
+		{
+			if(len < 8) return;
+			uint32_t vl = le32_(p);
+			if(vl > len - 8) return;
+			size_t pos = 4 + vl;
+			uint32_t num = le32_(p + pos);
+			pos += 4;
+			std::string composer;
+			std::vector<uint8_t> tmp;
+			for(uint32_t i = 0; i < num && pos + 4 <= len; ++i) {
+				uint32_t n = le32_(p + pos);
+				pos += 4;
+				if(n > len - pos) break;
+				const char* s = reinterpret_cast<const char*>(p + pos);
+				pos += n;
+				const char* eq = static_cast<const char*>(std::memchr(s, '=', n));
+				if(eq == nullptr) continue;
+				std::string key(s, eq);
+				for(char& ch : key) {
+					if(ch >= 'a' && ch <= 'z') ch -= 0x20;
+				}
+				const char* v = eq + 1;
+				size_t vlen = n - (v - s);
+
+				if(key == "METADATA_BLOCK_PICTURE") {
+					// 画像を使わない場合も、種別と形式は先頭だけで得られる
+					size_t l = image ? vlen : std::min(vlen, static_cast<size_t>(1024));
+					base64_decode_(v, l, tmp);
+					flac_picture_(tmp.data(), tmp.size(), t, image);
+					continue;
+				} else if(key == "COVERART") {
+					if(image) {
+						base64_decode_(v, vlen, tmp);
+						set_image_(t, "image/jpeg", 3, "", tmp.data(), tmp.size(), image);
+					} else {
+						set_image_(t, "image/jpeg", 3, "", reinterpret_cast<const uint8_t*>(v), vlen, image);
+					}
+					continue;
+				}
+
+				std::string val(v, vlen);
+				clean_text_(val);
+				if(val.empty()) continue;
+				if(key == "TITLE") t.title_ = val;
+				else if(key == "ARTIST") t.artist_ = val;
+				else if(key == "ALBUM") t.album_ = val;
+				else if(key == "ALBUMARTIST") t.writer_ = val;
+				else if(key == "COMPOSER") composer = val;
+				else if(key == "TRACKNUMBER") set_number_(val, t.track_, t.total_tracks_);
+				else if(key == "TRACKTOTAL" || key == "TOTALTRACKS") t.total_tracks_ = val;
+				else if(key == "DISCNUMBER") set_number_(val, t.disc_, t.total_discs_);
+				else if(key == "DISCTOTAL" || key == "TOTALDISCS") t.total_discs_ = val;
+				else if(key == "DATE") t.date_ = val;
+			}
+			if(t.writer_.empty()) t.writer_ = composer;
+		}
+
+
+		//-------------------------------------------------------------//
+		// FLAC
+		//-------------------------------------------------------------//
+		bool parse_flac_(const uint8_t* p, size_t len, tag& t, bool image)
+		{
+			if(len < 4 || std::memcmp(p, "fLaC", 4) != 0) return false;
+			size_t pos = 4;
+			while(pos + 4 <= len) {
+				uint8_t hd = p[pos];
+				uint32_t n = be24_(p + pos + 1);
+				pos += 4;
+				if(n > len - pos) break;
+				uint8_t type = hd & 0x7f;
+				if(type == 4) vorbis_comment_(p + pos, n, t, image);
+				else if(type == 6) flac_picture_(p + pos, n, t, image);
+				pos += n;
+				if(hd & 0x80) break;
+			}
+			return true;
+		}
+
+
+		//-------------------------------------------------------------//
+		// Ogg（最初のストリームのパケット１がコメント）
+		//-------------------------------------------------------------//
+		bool parse_ogg_(const uint8_t* p, size_t len, tag& t, bool image)
+		{
+			size_t pos = 0;
+			uint32_t serial = 0;
+			bool first = true;
+			uint32_t index = 0;
+			std::vector<uint8_t> packet;
+			while(pos + 27 <= len && std::memcmp(p + pos, "OggS", 4) == 0) {
+				uint32_t sn = le32_(p + pos + 14);
+				uint8_t nseg = p[pos + 26];
+				if(pos + 27 + nseg > len) break;
+				const uint8_t* seg = p + pos + 27;
+				size_t dpos = pos + 27 + nseg;
+				if(first) { serial = sn; first = false; }
+				if(sn == serial) {
+					for(uint8_t i = 0; i < nseg; ++i) {
+						size_t n = seg[i];
+						if(dpos + n > len) return true;
+						if(index == 1) packet.insert(packet.end(), p + dpos, p + dpos + n);
+						dpos += n;
+						if(n < 255) {  // パケットの終端
+							if(index == 1) {
+								if(packet.size() >= 7 && std::memcmp(packet.data(), "\x03vorbis", 7) == 0) {
+									vorbis_comment_(packet.data() + 7, packet.size() - 7, t, image);
+								} else if(packet.size() >= 8 && std::memcmp(packet.data(), "OpusTags", 8) == 0) {
+									vorbis_comment_(packet.data() + 8, packet.size() - 8, t, image);
+								}
+								return true;
+							}
+							++index;
+						}
+					}
+				} else {
+					for(uint8_t i = 0; i < nseg; ++i) dpos += seg[i];
+				}
+				pos = dpos;
+			}
+			return true;
+		}
+
+
+		//-------------------------------------------------------------//
+		// MP4（moov/udta/meta/ilst）
+		//-------------------------------------------------------------//
+		struct atom_ {
+			const uint8_t*	ptr;
+			size_t			len;
+		};
+
+
+		bool find_atom_(const uint8_t* p, size_t len, const char* name, atom_& out)
+		{
+			size_t pos = 0;
+			while(pos + 8 <= len) {
+				uint64_t n = be32_(p + pos);
+				size_t hl = 8;
+				if(n == 1) {
+					if(pos + 16 > len) return false;
+					n = (static_cast<uint64_t>(be32_(p + pos + 8)) << 32) | be32_(p + pos + 12);
+					hl = 16;
+				} else if(n == 0) {
+					n = len - pos;
+				}
+				if(n < hl || n > len - pos) return false;
+				if(std::memcmp(p + pos + 4, name, 4) == 0) {
+					out.ptr = p + pos + hl;
+					out.len = n - hl;
+					return true;
+				}
+				pos += n;
+			}
+			return false;
+		}
+
+
+		void mp4_item_(const uint8_t* name, const uint8_t* p, size_t len, tag& t, bool image)
+		{
+			atom_ d;
+			if(!find_atom_(p, len, "data", d) || d.len < 8) return;
+			uint32_t type = be32_(d.ptr) & 0xffffff;
+			const uint8_t* v = d.ptr + 8;
+			size_t vlen = d.len - 8;
+
+			if(std::memcmp(name, "trkn", 4) == 0 || std::memcmp(name, "disk", 4) == 0) {
+				if(vlen < 6) return;
+				uint32_t no = be16_(v + 2);
+				uint32_t total = be16_(v + 4);
+				bool trk = name[0] == 't';
+				if(no) (trk ? t.track_ : t.disc_) = std::to_string(no);
+				if(total) (trk ? t.total_tracks_ : t.total_discs_) = std::to_string(total);
+				return;
+			}
+			if(std::memcmp(name, "covr", 4) == 0) {
+				set_image_(t, type == 14 ? "image/png" : "image/jpeg", 3, "", v, vlen, image);
+				return;
+			}
+
+			if(type != 1) return;  // UTF-8 以外
+			std::string s(reinterpret_cast<const char*>(v), vlen);
+			clean_text_(s);
+			if(s.empty()) return;
+			if(name[0] == 0xa9) {
+				if(std::memcmp(name + 1, "nam", 3) == 0) t.title_ = s;
+				else if(std::memcmp(name + 1, "ART", 3) == 0) t.artist_ = s;
+				else if(std::memcmp(name + 1, "alb", 3) == 0) t.album_ = s;
+				else if(std::memcmp(name + 1, "day", 3) == 0) t.date_ = s;
+				else if(std::memcmp(name + 1, "wrt", 3) == 0) {
+					if(t.writer_.empty()) t.writer_ = s;
+				}
+			} else if(std::memcmp(name, "aART", 4) == 0) {
+				t.writer_ = s;
+			}
+		}
+
+
+		bool parse_mp4_(const uint8_t* p, size_t len, tag& t, bool image)
+		{
+			atom_ moov, udta, meta, ilst;
+			if(!find_atom_(p, len, "moov", moov)) return false;
+			if(!find_atom_(moov.ptr, moov.len, "udta", udta)) return true;
+			if(!find_atom_(udta.ptr, udta.len, "meta", meta)) return true;
+			// ISO 形式の meta はフル・ボックス（QuickTime 形式は違う）
+			if(meta.len >= 8 && std::memcmp(meta.ptr + 4, "hdlr", 4) != 0) {
+				meta.ptr += 4;
+				meta.len -= 4;
+			}
+			if(!find_atom_(meta.ptr, meta.len, "ilst", ilst)) return true;
+
+			size_t pos = 0;
+			while(pos + 8 <= ilst.len) {
+				size_t n = be32_(ilst.ptr + pos);
+				if(n < 8 || n > ilst.len - pos) break;
+				mp4_item_(ilst.ptr + pos + 4, ilst.ptr + pos + 8, n - 8, t, image);
+				pos += n;
+			}
+			return true;
+		}
+	}
+
+
+	tag_format read_tag(const void* top, size_t size, tag& t, bool image)
+	{
+		t.clear();
+		t.image_mime_.clear();
+		t.image_cover_ = 0;
+		t.image_dscrp_.clear();
+
+		const uint8_t* p = static_cast<const uint8_t*>(top);
+		tag_format fmt = tag_format::NONE;
+		size_t ofs = parse_id3v2_(p, size, t, image);
+		if(ofs > 0) {
+			fmt = tag_format::MP3;
+			if(ofs > size) ofs = size;
+		}
+
+		if(parse_flac_(p + ofs, size - ofs, t, image)) {
+			fmt = tag_format::FLAC;
+		} else if(ofs == 0 && size >= 4 && std::memcmp(p, "OggS", 4) == 0) {
+			parse_ogg_(p, size, t, image);
+			fmt = tag_format::OGG;
+		} else if(ofs == 0 && size >= 8 && std::memcmp(p + 4, "ftyp", 4) == 0) {
+			parse_mp4_(p, size, t, image);
+			fmt = tag_format::MP4;
+		} else if(parse_id3v1_(p, size, t)) {
+			fmt = tag_format::MP3;
+		}
+		return fmt;
+	}
+
+
+	tag_format read_tag(const std::string& path, tag& t, bool image)
+	{
+		utils::file_io fin;
+		if(!fin.open_map(path)) {
+			t.clear();
+			return tag_format::NONE;
+		}
+		size_t size = fin.get_file_size();
+		tag_format fmt;
+		if(fin.get_span() != nullptr) {
+			fmt = read_tag(fin.get_span(), size, t, image);
+		} else {
+			std::vector<uint8_t> buff(size);
+			size = fin.read(buff.data(), size);
+			fmt = read_tag(buff.data(), size, t, image);
+		}
+		fin.close();
+		return fmt;
+	}
+}
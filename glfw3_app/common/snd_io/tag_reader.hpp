@@ -0,0 +1,58 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	音楽ファイルのタグ読み込み（ヘッダー） @n
+			・デコーダーを使わず、ファイルの先頭（MP4 は moov）だけを @n
+			解析して、al::tag を埋める。@n
+			・ID3v2（2.2 ～ 2.4）、ID3v1、MP4（ilst）、Ogg Vorbis/Opus、@n
+			FLAC の Vorbis コメントと画像（PICTURE）に対応する。@n
+			・image が「false」の場合、画像は形式（image_mime_）だけを設定する。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <string>
+#include "snd_io/tag.hpp"
+
+namespace al {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	タグを読んだファイルの形式
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	enum class tag_format : uint8_t {
+		NONE,	///< 不明（タグ無し）
+		MP3,	///< MPEG Audio（ID3v2、ID3v1）
+		MP4,	///< MP4/M4A
+		OGG,	///< Ogg Vorbis/Opus
+		FLAC,	///< FLAC
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	記憶領域からタグを読む
+		@param[in]	top		先頭
+		@param[in]	size	サイズ
+		@param[out]	t		タグ（読む前にクリアされる）
+		@param[in]	image	画像を取り出す場合「true」
+		@return ファイルの形式
+	*/
+	//-----------------------------------------------------------------//
+	tag_format read_tag(const void* top, size_t size, tag& t, bool image);
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	ファイルからタグを読む（メモリー・マップ）
+		@param[in]	path	ファイル・パス
+		@param[out]	t		タグ（読む前にクリアされる）
+		@param[in]	image	画像を取り出す場合「true」
+		@return ファイルの形式
+	*/
+	//-----------------------------------------------------------------//
+	tag_format read_tag(const std::string& path, tag& t, bool image);
+}
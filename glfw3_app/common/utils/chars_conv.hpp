@@ -0,0 +1,517 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	数値と文字列の相互変換（from_chars / to_chars） @n
+			・C++17 の std::from_chars、std::to_chars に準じた、@n
+			メモリー確保、例外を伴わない変換 @n
+			・範囲は [first, last) のポインター対で渡す。@n
+			・浮動小数点は、仮数が 2^53 以下、指数が ±22 以内の場合、@n
+			double の乗除一回で正確に丸める。それ以外は strtod、@n
+			strtof に任せる。@n
+			・区切り文字で区切られた配列を、一回の走査で変換する。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <system_error>
+
+namespace utils {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	from_chars の結果 @n
+				ptr：変換が終わった位置、ec：エラー（正常なら std::errc()）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct from_chars_result {
+		const char*	ptr;
+		std::errc	ec;
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	to_chars の結果 @n
+				ptr：書き込みが終わった位置、ec：エラー（正常なら std::errc()）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct to_chars_result {
+		char*		ptr;
+		std::errc	ec;
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	区切り文字の集合（256 ビット）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class char_set {
+		uint32_t	bits_[8];
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+			@param[in]	str	文字の並び
+			@param[in]	len	長さ
+		*/
+		//-----------------------------------------------------------------//
+		char_set(const char* str, size_t len) noexcept : bits_{ 0 } {
+			for(size_t i = 0; i < len; ++i) {
+				uint8_t c = static_cast<uint8_t>(str[i]);
+				bits_[c >> 5] |= 1U << (c & 31);
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+			@param[in]	str	文字の並び（０終端）
+		*/
+		//-----------------------------------------------------------------//
+		explicit char_set(const char* str) noexcept : char_set(str, std::strlen(str)) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	文字が含まれるか
+			@param[in]	ch	文字
+			@return 含まれれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool operator () (char ch) const noexcept {
+			uint8_t c = static_cast<uint8_t>(ch);
+			return (bits_[c >> 5] >> (c & 31)) & 1;
+		}
+	};
+
+
+	namespace chars_detail {
+
+		inline uint32_t digit_(char ch) noexcept
+		{
+			uint32_t c = static_cast<uint8_t>(ch);
+			if((c - '0') < 10) return c - '0';
+			c |= 0x20;
+			if((c - 'a') < 26) return c - 'a' + 10;
+			return 255;
+		}
+
+
+		inline bool match_(const char* p, const char* last, const char* key) noexcept
+		{
+			while(*key != 0) {
+				if(p >= last || (*p | 0x20) != *key) return false;
+				++p;
+				++key;
+			}
+			return true;
+		}
+
+
+		inline double pow10_(int n) noexcept
+		{
+			static const double tbl[] = {
+				1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+				1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+				1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+			};
+			return tbl[n];
+		}
+
+
+		inline double strto_(const char* s, char** e, double) noexcept { return std::strtod(s, e); }
+		inline float strto_(const char* s, char** e, float) noexcept { return std::strtof(s, e); }
+
+
+		// 精度が足りない場合の下請け（[first, last) を０終端にして strtod へ）
+		template <typename T>
+		from_chars_result slow_real_(const char* first, const char* last, T& value) noexcept
+		{
+			char tmp[64];
+			std::string str;
+			const char* s;
+			size_t len = last - first;
+			if(len < sizeof(tmp)) {
+				std::memcpy(tmp, first, len);
+				tmp[len] = 0;
+				s = tmp;
+			} else {
+				try {
+					str.assign(first, last);
+				} catch(...) {
+					return from_chars_result{ first, std::errc::not_enough_memory };
+				}
+				s = str.c_str();
+			}
+			int org = errno;
+			errno = 0;
+			char* e;
+			T v = strto_(s, &e, T());
+			bool range = errno == ERANGE && std::isinf(v);
+			errno = org;
+			if(e != s + len) return from_chars_result{ first, std::errc::invalid_argument };
+			if(range) return from_chars_result{ last, std::errc::result_out_of_range };
+			value = v;
+			return from_chars_result{ last, std::errc() };
+		}
+
+
+		// 倍精度の結果を float に丸めて良いか（float の丁度中間なら二重丸めになる）
+		inline bool narrow_ok_(double d, float) noexcept
+		{
+			uint64_t b;
+			std::memcpy(&b, &d, sizeof(b));
+			return (b & 0x1fffffff) != 0x10000000;
+		}
+		inline bool narrow_ok_(double, double) noexcept { return true; }
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	文字列から整数へ変換 @n
+				符号は「-」のみ受け付ける（std::from_chars と同じ）
+		@param[in]	first	開始位置
+		@param[in]	last	終了位置
+		@param[out]	value	値（エラーの場合は変更しない）
+		@param[in]	base	基数（2 ～ 36）
+		@return 結果
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline typename std::enable_if<std::is_integral<T>::value, from_chars_result>::type
+		from_chars(const char* first, const char* last, T& value, int base = 10) noexcept
+	{
+		typedef typename std::make_unsigned<T>::type U;
+		const char* p = first;
+		bool neg = false;
+		if(std::is_signed<T>::value && p < last && *p == '-') {
+			neg = true;
+			++p;
+		}
+		const U b = static_cast<U>(base);
+		const U lim = neg ? static_cast<U>(std::numeric_limits<T>::max()) + 1
+						  : static_cast<U>(std::numeric_limits<T>::max());
+		const U cut = lim / b;
+		const U cutd = lim % b;
+		const char* top = p;
+		U v = 0;
+		bool over = false;
+		for(; p < last; ++p) {
+			uint32_t d = chars_detail::digit_(*p);
+			if(d >= static_cast<uint32_t>(base)) break;
+			if(v > cut || (v == cut && d > cutd)) over = true;
+			else v = v * b + d;
+		}
+		if(p == top) return from_chars_result{ first, std::errc::invalid_argument };
+		if(over) return from_chars_result{ p, std::errc::result_out_of_range };
+		if(neg) value = static_cast<T>(static_cast<U>(0) - v);
+		else value = static_cast<T>(v);
+		return from_chars_result{ p, std::errc() };
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	文字列から浮動小数点へ変換 @n
+				[-]digits[.digits][(e|E)[+|-]digits]、inf、infinity、nan @n
+				（大文字、小文字の区別無し）を受け付ける。
+		@param[in]	first	開始位置
+		@param[in]	last	終了位置
+		@param[out]	value	値（エラーの場合は変更しない）
+		@return 結果
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline typename std::enable_if<std::is_floating_point<T>::value, from_chars_result>::type
+		from_chars(const char* first, const char* last, T& value) noexcept
+	{
+		const char* p = first;
+		bool neg = false;
+		if(p < last && *p == '-') {
+			neg = true;
+			++p;
+		}
+
+		if(p < last && ((*p | 0x20) == 'i' || (*p | 0x20) == 'n')) {
+			if(chars_detail::match_(p, last, "infinity")) {
+				value = neg ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+				return from_chars_result{ p + 8, std::errc() };
+			} else if(chars_detail::match_(p, last, "inf")) {
+				value = neg ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+				return from_chars_result{ p + 3, std::errc() };
+			} else if(chars_detail::match_(p, last, "nan")) {
+				value = neg ? -std::numeric_limits<T>::quiet_NaN() : std::numeric_limits<T>::quiet_NaN();
+				return from_chars_result{ p + 3, std::errc() };
+			}
+			return from_chars_result{ first, std::errc::invalid_argument };
+		}
+
+		// 有効数字は 19 桁まで仮数に積む（それ以上は切り捨てとして記録）
+		uint64_t m = 0;
+		int32_t e10 = 0;
+		uint32_t nd = 0;
+		bool trunc = false;
+		bool any = false;
+		for(; p < last; ++p) {
+			uint32_t d = static_cast<uint8_t>(*p) - '0';
+			if(d >= 10) break;
+			any = true;
+			if(nd < 19) {
+				m = m * 10 + d;
+				if(m != 0) ++nd;
+			} else {
+				++e10;
+				if(d != 0) trunc = true;
+			}
+		}
+		if(p < last && *p == '.') {
+			const char* q = p + 1;
+			for(; q < last; ++q) {
+				uint32_t d = static_cast<uint8_t>(*q) - '0';
+				if(d >= 10) break;
+				any = true;
+				if(nd < 19) {
+					m = m * 10 + d;
+					if(m != 0) ++nd;
+					--e10;
+				} else if(d != 0) {
+					trunc = true;
+				}
+			}
+			if(any) p = q;
+		}
+		if(!any) return from_chars_result{ first, std::errc::invalid_argument };
+
+		if(p < last && (*p | 0x20) == 'e') {
+			const char* q = p + 1;
+			bool eneg = false;
+			if(q < last && (*q == '+' || *q == '-')) {
+				eneg = *q == '-';
+				++q;
+			}
+			if(q < last && static_cast<uint32_t>(static_cast<uint8_t>(*q) - '0') < 10) {
+				int32_t ev = 0;
+				for(; q < last; ++q) {
+					uint32_t d = static_cast<uint8_t>(*q) - '0';
+					if(d >= 10) break;
+					if(ev < 100000) ev = ev * 10 + static_cast<int32_t>(d);
+				}
+				e10 += eneg ? -ev : ev;
+				p = q;
+			}
+		}
+
+		if(!trunc) {
+			if(m == 0) {
+				value = neg ? -static_cast<T>(0) : static_cast<T>(0);
+				return from_chars_result{ p, std::errc() };
+			}
+			if(m <= (static_cast<uint64_t>(1) << 53) && e10 >= -22 && e10 <= 22) {
+				double d = static_cast<double>(m);
+				if(e10 < 0) d /= chars_detail::pow10_(-e10);
+				else d *= chars_detail::pow10_(e10);
+				if(chars_detail::narrow_ok_(d, T())) {
+					T v = static_cast<T>(d);
+					value = neg ? -v : v;
+					return from_chars_result{ p, std::errc() };
+				}
+			}
+		}
+		return chars_detail::slow_real_(first, p, value);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	整数を文字列へ変換（０終端はしない）
+		@param[in]	first	書き込み開始位置
+		@param[in]	last	書き込み終了位置
+		@param[in]	value	値
+		@param[in]	base	基数（2 ～ 36）
+		@return 結果（領域が足りない場合、ptr は last、ec は value_too_large）
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline typename std::enable_if<std::is_integral<T>::value, to_chars_result>::type
+		to_chars(char* first, char* last, T value, int base = 10) noexcept
+	{
+		typedef typename std::make_unsigned<T>::type U;
+		static const char pair[] =
+			"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+			"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+			"8081828384858687888990919293949596979899";
+
+		char tmp[sizeof(T) * 8 + 1];
+		char* e = tmp + sizeof(tmp);
+		char* p = e;
+		U v = static_cast<U>(value);
+		bool neg = std::is_signed<T>::value && value < 0;
+		if(neg) v = static_cast<U>(0) - v;
+		if(base == 10) {
+			while(v >= 100) {
+				uint32_t r = static_cast<uint32_t>(v % 100) * 2;
+				v /= 100;
+				p -= 2;
+				p[0] = pair[r];
+				p[1] = pair[r + 1];
+			}
+			if(v >= 10) {
+				uint32_t r = static_cast<uint32_t>(v) * 2;
+				p -= 2;
+				p[0] = pair[r];
+				p[1] = pair[r + 1];
+			} else {
+				*--p = static_cast<char>('0' + v);
+			}
+		} else {
+			const U b = static_cast<U>(base);
+			do {
+				uint32_t d = static_cast<uint32_t>(v % b);
+				v /= b;
+				*--p = static_cast<char>(d < 10 ? ('0' + d) : ('a' + d - 10));
+			} while(v != 0) ;
+		}
+		if(neg) *--p = '-';
+
+		size_t len = e - p;
+		if(static_cast<size_t>(last - first) < len) {
+			return to_chars_result{ last, std::errc::value_too_large };
+		}
+		std::memcpy(first, p, len);
+		return to_chars_result{ first + len, std::errc() };
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	浮動小数点を文字列へ変換（０終端はしない） @n
+				precision が負の場合、読み戻して同じ値になる最短の桁数 @n
+				（%g 形式）、それ以外は「%.Nf」形式
+		@param[in]	first	書き込み開始位置
+		@param[in]	last	書き込み終了位置
+		@param[in]	value	値
+		@param[in]	precision	小数点以下の桁数
+		@return 結果（領域が足りない場合、ptr は last、ec は value_too_large）
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline typename std::enable_if<std::is_floating_point<T>::value, to_chars_result>::type
+		to_chars(char* first, char* last, T value, int precision = -1) noexcept
+	{
+		char tmp[64];
+		int len = 0;
+		if(precision >= 0) {
+			len = std::snprintf(tmp, sizeof(tmp), "%.*f", precision, static_cast<double>(value));
+			if(len < 0 || len >= static_cast<int>(sizeof(tmp))) {
+				return to_chars_result{ last, std::errc::value_too_large };
+			}
+		} else {
+			const int dig = std::numeric_limits<T>::digits10;
+			const int maxdig = std::numeric_limits<T>::max_digits10;
+			for(int n = dig; n <= maxdig; ++n) {
+				len = std::snprintf(tmp, sizeof(tmp), "%.*g", n, static_cast<double>(value));
+				if(n == maxdig || !std::isfinite(value)) break;
+				T back;
+				auto r = from_chars(tmp, tmp + len, back);
+				if(r.ec == std::errc() && back == value) break;
+			}
+		}
+		if(last - first < len) {
+			return to_chars_result{ last, std::errc::value_too_large };
+		}
+		std::memcpy(first, tmp, len);
+		return to_chars_result{ first + len, std::errc() };
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	区切り文字で区切られた項目を順に渡す @n
+				・区切り文字毎に、一つの項目（空の場合もある）を渡す。@n
+				・最後の項目は、空でない場合だけ渡す。
+		@param[in]	first	開始位置
+		@param[in]	last	終了位置
+		@param[in]	spc		区切り文字の集合
+		@param[in]	func	項目を受け取る関数（bool(const char*, const char*)）
+		@return 全ての項目で func が「true」を返せば「true」
+	*/
+	//-----------------------------------------------------------------//
+	template <class FUNC>
+	inline bool for_each_token(const char* first, const char* last, const char_set& spc, FUNC func)
+	{
+		const char* p = first;
+		while(p < last) {
+			const char* e = p;
+			while(e < last && !spc(*e)) ++e;
+			if(!func(p, e)) return false;
+			if(e == last) break;
+			p = e + 1;
+		}
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	一つの項目全体を数値へ変換 @n
+				先頭の「+」を許し、項目の全てが変換されなければエラー @n
+				エラーの場合、value は変更しない。
+		@param[in]	first	開始位置
+		@param[in]	last	終了位置
+		@param[out]	value	値
+		@return 成功なら「true」
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline bool from_chars_token(const char* first, const char* last, T& value) noexcept
+	{
+		if(first < last && *first == '+') {
+			++first;
+			if(first < last && *first == '-') return false;
+		}
+		T v;
+		auto r = from_chars(first, last, v);
+		if(r.ec != std::errc() || r.ptr != last) return false;
+		value = v;
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	区切り文字で区切られた数値の並びを、一回の走査で変換 @n
+				項目の規則は for_each_token、from_chars_token を参照。@n
+				エラーの場合も、それまでに変換した値は追加されている。
+		@param[in]	first	開始位置
+		@param[in]	last	終了位置
+		@param[out]	dst		値の追加先
+		@param[in]	spc		区切り文字の集合
+		@return 全て変換出来れば「true」
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline bool from_chars_array(const char* first, const char* last, std::vector<T>& dst, const char_set& spc)
+	{
+		return for_each_token(first, last, spc, [&](const char* p, const char* e) {
+			T v;
+			if(!from_chars_token(p, e, v)) return false;
+			dst.push_back(v);
+			return true;
+		});
+	}
+}
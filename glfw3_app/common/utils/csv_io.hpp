@@ -0,0 +1,838 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	CSV の逐次読み込み、書き出し @n
+			・RFC 4180 の引用（"..."、"" によるエスケープ、引用内の改行）@n
+			に対応する。@n
+			・読み込みは一行（レコード）ずつ、再利用する csv_row に、@n
+			ソースを指すビュー（csv_cell）として取り出す。エスケープを @n
+			含むセルだけ、行バッファへ展開する。@n
+			・ファイルはメモリー・マップで読む（出来ない場合は一括読み込み）。@n
+			・列を指定して、数値の連続した配列へ変換出来る。@n
+			・大きなファイルは、引用の偶奇を数えて、レコードの境界で @n
+			分割し、複数スレッドで変換出来る。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2018 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "utils/file_io.hpp"
+#include "utils/chars_conv.hpp"
+
+namespace utils {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	CSV セル（ビュー） @n
+				ソース、又は行バッファを指し、次の読み込みまで有効。
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct csv_cell {
+		const char*	ptr_;
+		uint32_t	len_;
+
+		const char* data() const noexcept { return ptr_; }
+		uint32_t size() const noexcept { return len_; }
+		bool empty() const noexcept { return len_ == 0; }
+
+		std::string str() const { return std::string(ptr_, len_); }
+
+		bool operator == (const std::string& s) const noexcept {
+			return s.size() == len_ && (len_ == 0 || std::memcmp(s.data(), ptr_, len_) == 0);
+		}
+		bool operator != (const std::string& s) const noexcept { return !(*this == s); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	数値として取得（セル全体が数値でなければエラー）
+			@param[out]	v	値
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		template <typename T>
+		bool get(T& v) const noexcept { return from_chars_token(ptr_, ptr_ + len_, v); }
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	CSV 行バッファ（読み込み毎に再利用する）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class csv_row {
+		friend class csv_parser;
+
+		std::vector<csv_cell>	cell_;
+		std::string				tmp_;	///< エスケープを展開したセル
+		std::vector<std::pair<uint32_t, uint32_t>>	fix_;	///< tmp_ を指すセルの番号と位置
+
+		void clear_() {
+			cell_.clear();
+			tmp_.clear();
+			fix_.clear();
+		}
+
+		void fix_cells_() {
+			for(const auto& f : fix_) {
+				cell_[f.first].ptr_ = tmp_.data() + f.second;
+			}
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	セルの数
+			@return セルの数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t size() const noexcept { return cell_.size(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	セルの参照
+			@param[in]	idx	列
+			@return セル
+		*/
+		//-----------------------------------------------------------------//
+		const csv_cell& operator [] (uint32_t idx) const noexcept { return cell_[idx]; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	セルの取得（範囲外なら空のセル）
+			@param[in]	idx	列
+			@return セル
+		*/
+		//-----------------------------------------------------------------//
+		csv_cell get(uint32_t idx) const noexcept {
+			if(idx < cell_.size()) return cell_[idx];
+			return csv_cell{ "", 0 };
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	セルを数値として取得
+			@param[in]	idx	列
+			@param[out]	v	値
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		template <typename T>
+		bool get(uint32_t idx, T& v) const noexcept {
+			if(idx >= cell_.size()) return false;
+			return cell_[idx].get(v);
+		}
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	CSV レコードの解析（範囲 [top, end) を一レコードずつ）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class csv_parser {
+
+		// 区切り、CR、LF、引用符のどれかが現れる位置
+		static const char* find_special_(const char* p, const char* end, char delim) noexcept
+		{
+#ifdef __SSE2__
+			const __m128i d = _mm_set1_epi8(delim);
+			const __m128i cr = _mm_set1_epi8('\r');
+			const __m128i lf = _mm_set1_epi8('\n');
+			const __m128i qt = _mm_set1_epi8('"');
+			while((p + 16) <= end) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(a, d), _mm_cmpeq_epi8(a, cr)),
+					_mm_or_si128(_mm_cmpeq_epi8(a, lf), _mm_cmpeq_epi8(a, qt)));
+				if(_mm_movemask_epi8(m) != 0) break;
+				p += 16;
+			}
+#endif
+			while(p < end) {
+				char c = *p;
+				if(c == delim || c == '\r' || c == '\n' || c == '"') break;
+				++p;
+			}
+			return p;
+		}
+
+		// 引用されたセル（p は開始の引用符の次）
+		static const char* quoted_(const char* p, const char* end, char delim, csv_row& row, bool& error)
+		{
+			const char* top = p;
+			bool esc = false;
+			const char* q;
+			while(1) {
+				q = static_cast<const char*>(std::memchr(p, '"', end - p));
+				if(q == nullptr) {  // 閉じていない
+					error = true;
+					q = end;
+					break;
+				}
+				if((q + 1) < end && q[1] == '"') {
+					esc = true;
+					p = q + 2;
+					continue;
+				}
+				break;
+			}
+			p = (q < end) ? q + 1 : end;
+			const char* extra = find_special_(p, end, delim);  // 閉じた後の余分な文字
+			while(extra < end && *extra == '"') extra = find_special_(extra + 1, end, delim);
+
+			if(!esc && extra == p) {
+				row.cell_.push_back(csv_cell{ top, static_cast<uint32_t>(q - top) });
+				return p;
+			}
+
+			uint32_t ofs = row.tmp_.size();
+			for(const char* s = top; s < q; ++s) {
+				row.tmp_ += *s;
+				if(*s == '"') ++s;
+			}
+			row.tmp_.append(p, extra);
+			row.fix_.emplace_back(row.cell_.size(), ofs);
+			row.cell_.push_back(csv_cell{ nullptr, static_cast<uint32_t>(row.tmp_.size() - ofs) });
+			return extra;
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	一レコードを解析
+			@param[in]	p		開始位置
+			@param[in]	end		終了位置
+			@param[in]	delim	区切り文字
+			@param[in]	skip_empty	空行を読み飛ばす場合「true」
+			@param[out]	row		行バッファ
+			@param[out]	error	閉じていない引用があれば「true」にする
+			@return 次のレコードの位置（レコードが無ければ「nullptr」）
+		*/
+		//-----------------------------------------------------------------//
+		static const char* parse(const char* p, const char* end, char delim, bool skip_empty,
+			csv_row& row, bool& error)
+		{
+			if(skip_empty) {
+				while(p < end && (*p == '\n' || *p == '\r')) ++p;
+			}
+			if(p >= end) return nullptr;
+
+			row.clear_();
+			while(1) {
+				if(p < end && *p == '"') {
+					p = quoted_(p + 1, end, delim, row, error);
+				} else {
+					const char* e = p;
+					while(1) {
+						e = find_special_(e, end, delim);
+						if(e < end && *e == '"') ++e;  // 引用されていないセル中の引用符はそのまま
+						else break;
+					}
+					row.cell_.push_back(csv_cell{ p, static_cast<uint32_t>(e - p) });
+					p = e;
+				}
+				if(p >= end) break;
+				char c = *p++;
+				if(c == delim) continue;
+				if(c == '\r' && p < end && *p == '\n') ++p;
+				break;
+			}
+			row.fix_cells_();
+			return p;
+		}
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	CSV 逐次読み込みクラス @n
+				Ex: csv_reader rd; csv_row row; @n
+				if(rd.open(path)) { while(rd.next(row)) { ... } }
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class csv_reader {
+
+		file_io				fio_;
+		std::vector<char>	own_;	///< マップ出来ない場合の読み込み先
+		const char*			top_;
+		const char*			end_;
+		const char*			pos_;
+		char				delim_;
+		bool				skip_empty_;
+		bool				error_;
+		uint32_t			rows_;
+
+		void set_span_(const char* top, size_t size) {
+			if(size >= 3 && std::memcmp(top, "\xEF\xBB\xBF", 3) == 0) {  // UTF-8 BOM
+				top += 3;
+				size -= 3;
+			}
+			top_ = top;
+			end_ = top + size;
+			pos_ = top;
+			error_ = false;
+			rows_ = 0;
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+			@param[in]	delim	区切り文字
+			@param[in]	skip_empty	空行を読み飛ばす場合「true」
+		*/
+		//-----------------------------------------------------------------//
+		csv_reader(char delim = ',', bool skip_empty = true) noexcept :
+			top_(nullptr), end_(nullptr), pos_(nullptr),
+			delim_(delim), skip_empty_(skip_empty), error_(false), rows_(0) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイルを開く
+			@param[in]	path	ファイル・パス
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool open(const std::string& path)
+		{
+			close();
+			if(!fio_.open_map(path)) return false;
+			const void* span = fio_.get_span();
+			size_t size = fio_.get_file_size();
+			if(span == nullptr) {
+				own_.resize(size);
+				if(size > 0 && fio_.read(&own_[0], size) != size) {
+					close();
+					return false;
+				}
+				span = own_.data();
+			}
+			set_span_(static_cast<const char*>(span), size);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	記憶領域を開く（領域は閉じるまで保持すること）
+			@param[in]	top		先頭
+			@param[in]	size	サイズ
+		*/
+		//-----------------------------------------------------------------//
+		void open(const char* top, size_t size)
+		{
+			close();
+			set_span_(top, size);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	閉じる
+		*/
+		//-----------------------------------------------------------------//
+		void close()
+		{
+			fio_.close();
+			own_.clear();
+			own_.shrink_to_fit();
+			top_ = end_ = pos_ = nullptr;
+			error_ = false;
+			rows_ = 0;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	次のレコードを読む
+			@param[out]	row	行バッファ
+			@return レコードが無ければ「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool next(csv_row& row)
+		{
+			if(pos_ == nullptr) return false;
+			const char* p = csv_parser::parse(pos_, end_, delim_, skip_empty_, row, error_);
+			if(p == nullptr) {
+				pos_ = end_;
+				return false;
+			}
+			pos_ = p;
+			++rows_;
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	先頭に戻す
+		*/
+		//-----------------------------------------------------------------//
+		void rewind() noexcept { pos_ = top_; rows_ = 0; error_ = false; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ソースの先頭（BOM を除く）
+			@return ソースの先頭
+		*/
+		//-----------------------------------------------------------------//
+		const char* data() const noexcept { return top_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ソースのサイズ
+			@return ソースのサイズ
+		*/
+		//-----------------------------------------------------------------//
+		size_t size() const noexcept { return end_ - top_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	読んだレコード数
+			@return 読んだレコード数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_rows() const noexcept { return rows_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	閉じていない引用があったか
+			@return あれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool get_error() const noexcept { return error_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	区切り文字
+			@return 区切り文字
+		*/
+		//-----------------------------------------------------------------//
+		char get_delim() const noexcept { return delim_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	空行を読み飛ばすか
+			@return 読み飛ばす場合「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool get_skip_empty() const noexcept { return skip_empty_; }
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	CSV 逐次書き出しクラス @n
+				区切り、引用符、改行を含むセルは引用する（RFC 4180）。@n
+				ファイルを開かない場合は、内部バッファに貯める。
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class csv_writer {
+
+		static const size_t flush_size_ = 64 * 1024;
+
+		file_io		fio_;
+		std::string	buf_;
+		char		delim_;
+		bool		crlf_;
+		bool		top_;
+		bool		error_;
+
+		void sep_() {
+			if(!top_) buf_ += delim_;
+			top_ = false;
+		}
+
+		void flush_() {
+			if(!fio_.is_open() || buf_.empty()) return;
+			if(fio_.write(buf_.data(), buf_.size()) != buf_.size()) error_ = true;
+			buf_.clear();
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+			@param[in]	delim	区切り文字
+			@param[in]	crlf	改行を CR/LF にする場合「true」
+		*/
+		//-----------------------------------------------------------------//
+		csv_writer(char delim = ',', bool crlf = false) noexcept :
+			delim_(delim), crlf_(crlf), top_(true), error_(false) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	デストラクター
+		*/
+		//-----------------------------------------------------------------//
+		~csv_writer() { close(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイルを開く
+			@param[in]	path	ファイル・パス
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool open(const std::string& path)
+		{
+			close();
+			buf_.clear();
+			buf_.reserve(flush_size_ + 256);
+			top_ = true;
+			error_ = false;
+			return fio_.open(path, "wb");
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	閉じる
+			@return 書き出しに失敗していなければ「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool close()
+		{
+			if(!fio_.is_open()) return !error_;
+			flush_();
+			fio_.close();
+			return !error_;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	文字列セルを書き出す
+			@param[in]	str	文字列
+			@param[in]	len	長さ
+			@return 自分の参照
+		*/
+		//-----------------------------------------------------------------//
+		csv_writer& put(const char* str, size_t len)
+		{
+			sep_();
+			bool quote = false;
+			for(size_t i = 0; i < len; ++i) {
+				char c = str[i];
+				if(c == delim_ || c == '"' || c == '\r' || c == '\n') {
+					quote = true;
+					break;
+				}
+			}
+			if(quote) {
+				buf_ += '"';
+				const char* p = str;
+				const char* end = str + len;
+				const char* q;
+				while((q = static_cast<const char*>(std::memchr(p, '"', end - p))) != nullptr) {
+					buf_.append(p, q + 1);
+					buf_ += '"';
+					p = q + 1;
+				}
+				buf_.append(p, end);
+				buf_ += '"';
+			} else {
+				buf_.append(str, len);
+			}
+			return *this;
+		}
+
+		csv_writer& put(const std::string& str) { return put(str.data(), str.size()); }
+		csv_writer& put(const char* str) { return put(str, std::strlen(str)); }
+		csv_writer& put(const csv_cell& cell) { return put(cell.data(), cell.size()); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	数値セルを書き出す
+			@param[in]	v	値
+			@return 自分の参照
+		*/
+		//-----------------------------------------------------------------//
+		template <typename T>
+		typename std::enable_if<std::is_arithmetic<T>::value, csv_writer&>::type put(T v)
+		{
+			sep_();
+			char tmp[64];
+			auto r = to_chars(tmp, tmp + sizeof(tmp), v);
+			buf_.append(tmp, r.ptr);
+			return *this;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	行の全てのセルを書き出し、行を終える
+			@param[in]	row	行バッファ
+			@return 自分の参照
+		*/
+		//-----------------------------------------------------------------//
+		csv_writer& put(const csv_row& row)
+		{
+			for(uint32_t i = 0; i < row.size(); ++i) put(row[i]);
+			return end_row();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	行を終える
+			@return 自分の参照
+		*/
+		//-----------------------------------------------------------------//
+		csv_writer& end_row()
+		{
+			if(crlf_) buf_ += '\r';
+			buf_ += '\n';
+			top_ = true;
+			if(buf_.size() >= flush_size_) flush_();
+			return *this;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	内部バッファ（ファイルを開かない場合の出力）
+			@return 内部バッファ
+		*/
+		//-----------------------------------------------------------------//
+		const std::string& get_buffer() const noexcept { return buf_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	書き出しに失敗したか
+			@return 失敗していれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool get_error() const noexcept { return error_; }
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	数値の列（連続した配列へ変換する）
+		@param[in]	T	数値の型
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <typename T>
+	struct csv_column {
+		uint32_t		index_;		///< 列の位置
+		T				fill_;		///< 変換出来ないセルの値
+		std::vector<T>	data_;		///< 値
+		uint32_t		error_;		///< 変換出来なかったセルの数
+
+		csv_column(uint32_t index, T fill = T()) : index_(index), fill_(fill), data_(), error_(0) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	行から値を取り出して追加
+			@param[in]	row	行バッファ
+		*/
+		//-----------------------------------------------------------------//
+		void decode(const csv_row& row)
+		{
+			T v;
+			if(row.get(index_, v)) {
+				data_.push_back(v);
+			} else {
+				data_.push_back(fill_);
+				++error_;
+			}
+		}
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	列を数値の配列へ変換（読み込み位置から最後まで）
+		@param[in]	rd		読み込みクラス
+		@param[in]	cols	列（値は追加される）
+		@param[in]	skip	先頭で読み飛ばすレコード数（見出しなど）
+		@return 変換したレコード数
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline uint32_t csv_read_columns(csv_reader& rd, std::vector<csv_column<T>>& cols, uint32_t skip = 0)
+	{
+		csv_row row;
+		uint32_t n = 0;
+		while(rd.next(row)) {
+			if(skip > 0) {
+				--skip;
+				continue;
+			}
+			for(auto& c : cols) c.decode(row);
+			++n;
+		}
+		return n;
+	}
+
+
+	// スレッド数（０ならハードウェアのスレッド数、最大８）
+	inline uint32_t csv_threads_(uint32_t threads)
+	{
+		if(threads == 0) {
+			threads = std::thread::hardware_concurrency();
+			if(threads == 0) threads = 1;
+			else if(threads > 8) threads = 8;
+		}
+		return threads;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	大きな領域を、レコードの境界で分割して、複数スレッドで解析 @n
+				・引用符の数の偶奇で、分割位置が引用の中か判定する @n
+				（引用されないセル中に引用符がある、RFC 4180 に沿わない @n
+				ソースでは、逐次読み込みと結果が異なる場合がある）。@n
+				・func(chunk, row) は、分割（chunk）毎に別のスレッドから、@n
+				ソース順に呼ばれる。
+		@param[in]	top		先頭（csv_reader::data() など）
+		@param[in]	size	サイズ
+		@param[in]	threads	スレッド数（０ならハードウェアのスレッド数、最大８）
+		@param[in]	func	レコードを受け取る関数
+		@param[in]	delim	区切り文字
+		@param[in]	skip_empty	空行を読み飛ばす場合「true」
+		@param[in]	min_chunk	分割の最小サイズ
+		@return 分割数
+	*/
+	//-----------------------------------------------------------------//
+	template <class FUNC>
+	inline uint32_t csv_parallel_for_each(const char* top, size_t size, uint32_t threads, FUNC func,
+		char delim = ',', bool skip_empty = true, size_t min_chunk = 1024 * 1024)
+	{
+		threads = csv_threads_(threads);
+		size_t num = std::max(static_cast<size_t>(1), std::min(static_cast<size_t>(threads), size / min_chunk));
+		const char* end = top + size;
+
+		// 名目上の分割位置と、各区間の引用符の数
+		std::vector<const char*> pos(num + 1);
+		for(size_t i = 0; i <= num; ++i) pos[i] = top + size * i / num;
+		std::vector<uint32_t> quotes(num, 0);
+		auto count = [&](size_t i) {
+			uint32_t n = 0;
+			const char* p = pos[i];
+			while((p = static_cast<const char*>(std::memchr(p, '"', pos[i + 1] - p))) != nullptr) {
+				++n;
+				++p;
+			}
+			quotes[i] = n;
+		};
+		// 分割位置を、引用の外の改行の次へ進める
+		std::vector<const char*> start(num + 1);
+		start[0] = top;
+		start[num] = end;
+		auto align = [&](size_t i, bool inq) {
+			const char* p = pos[i];
+			while(p < end) {
+				if(*p == '"') inq = !inq;
+				else if(*p == '\n' && !inq) {
+					++p;
+					break;
+				}
+				++p;
+			}
+			start[i] = p;
+		};
+		auto parse = [&](size_t i) {
+			const char* s = start[i];
+			const char* e = std::max(s, start[i + 1]);
+			csv_row row;
+			bool error = false;
+			while((s = csv_parser::parse(s, e, delim, skip_empty, row, error)) != nullptr) {
+				func(static_cast<uint32_t>(i), static_cast<const csv_row&>(row));
+			}
+		};
+
+		if(num == 1) {
+			parse(0);
+			return 1;
+		}
+
+		std::vector<std::thread> ths;
+		for(size_t i = 0; i < num; ++i) ths.emplace_back(count, i);
+		for(auto& th : ths) th.join();
+		uint32_t sum = 0;
+		for(size_t i = 1; i < num; ++i) {
+			sum += quotes[i - 1];
+			align(i, (sum & 1) != 0);
+		}
+		for(size_t i = 1; i < num; ++i) {  // 一行が分割より長い場合
+			if(start[i] < start[i - 1]) start[i] = start[i - 1];
+		}
+		ths.clear();
+		for(size_t i = 0; i < num; ++i) ths.emplace_back(parse, i);
+		for(auto& th : ths) th.join();
+		return static_cast<uint32_t>(num);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	列を数値の配列へ変換（複数スレッド） @n
+				結果は csv_read_columns と同じ順序で追加される。
+		@param[in]	rd		読み込みクラス（開いた状態、読み込み位置は使わない）
+		@param[in]	cols	列（値は追加される）
+		@param[in]	skip	先頭で読み飛ばすレコード数（見出しなど）
+		@param[in]	threads	スレッド数（０ならハードウェアのスレッド数、最大８）
+		@return 変換したレコード数
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T>
+	inline uint32_t csv_read_columns_parallel(const csv_reader& rd, std::vector<csv_column<T>>& cols,
+		uint32_t skip = 0, uint32_t threads = 0)
+	{
+		threads = csv_threads_(threads);
+		std::vector<std::vector<csv_column<T>>> part(threads);
+		std::vector<uint32_t> rows(part.size(), 0);
+		uint32_t skipped = 0;
+		for(auto& p : part) {
+			for(const auto& c : cols) p.emplace_back(c.index_, c.fill_);
+		}
+		uint32_t num = csv_parallel_for_each(rd.data(), rd.size(), threads,
+			[&](uint32_t chunk, const csv_row& row) {
+				if(chunk == 0 && skipped < skip) {
+					++skipped;
+					return;
+				}
+				++rows[chunk];
+				for(auto& c : part[chunk]) c.decode(row);
+			}, rd.get_delim(), rd.get_skip_empty());
+
+		uint32_t n = 0;
+		for(uint32_t i = 0; i < num; ++i) {
+			n += rows[i];
+			for(size_t j = 0; j < cols.size(); ++j) {
+				const auto& src = part[i][j];
+				cols[j].data_.insert(cols[j].data_.end(), src.data_.begin(), src.data_.end());
+				cols[j].error_ += src.error_;
+			}
+		}
+		return n;
+	}
+}
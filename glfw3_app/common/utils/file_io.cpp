@@ -14,6 +14,12 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <unistd.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
 
 #ifdef __PPU__
 #include <sys/paths.h>
@@ -99,6 +105,37 @@ namespace utils {
 	}
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	UTF-8 のファイル名でオープン（UTF-32 を経由しない）
+		@param[in]	fn	ファイル名
+		@param[in]	md	オープンモード
+		@return オープンできれば、ファイル構造体のポインターを返す
+	*/
+	//-----------------------------------------------------------------//
+	std::FILE* wfopen(const std::string& fn, const std::string& md)
+	{
+		std::FILE* fp = 0;
+#ifdef WIN32
+		utils::wstring wfn;
+		utf8_to_utf16(fn, wfn);
+		utils::wstring wsm(md.begin(), md.end());
+		fp = _wfopen((const wchar_t*)wfn.c_str(), (const wchar_t*)wsm.c_str());
+#else
+		fp = fopen(fn.c_str(), md.c_str());
+#endif
+#ifndef NDEBUG
+		if(fp == 0) {
+			std::string tt;
+			if(strchr(md.c_str(), 'w')) tt = "output";
+			else tt = "input";
+			std::cerr << boost::format("Can't open %1% file (file_io::wfopen): '%2%'") % tt % fn << std::endl;
+		}
+#endif
+		return fp;
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	ディレクトリーを作成する（UTF8）
@@ -189,6 +226,36 @@ namespace utils {
 	}
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	ファイルの検査（UTF-32 を経由しない）
+		@param[in]	fn	ファイル名
+		@param[in]	dir	「true」ならディレクトリーとして検査
+		@return ファイルが有効なら「true」
+	*/
+	//-----------------------------------------------------------------//
+	bool probe_file(const std::string& fn, bool dir)
+	{
+#ifdef WIN32
+		struct _stat st;
+		utils::wstring wfn;
+		utf8_to_utf16(fn, wfn);
+		if(_wstat((const wchar_t*)wfn.c_str(), &st) == 0) {
+#else
+		struct stat st;
+		if(stat(fn.c_str(), &st) == 0) {
+#endif
+			if(dir) {
+				bool d = S_ISDIR(st.st_mode);
+				if(d) return true;
+			} else {
+				return true;
+			}
+		}
+		return false;
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	ファイルのサイズを返す
@@ -249,7 +316,7 @@ namespace utils {
 		}
 
 		utils::file_io fin;
-		if(!fin.open(src, "rb")) {
+		if(!fin.open_map(src)) {
 			return false;
 		}
 		utils::file_io fout;
@@ -257,6 +324,11 @@ namespace utils {
 			return false;
 		}
 
+		if(fin.get_span() != nullptr) {
+			size_t sz = fin.get_file_size();
+			return fout.write(fin.get_span(), sz) == sz;
+		}
+
 		std::vector<uint8_t> buff;
 		buff.resize(4096);
 
@@ -280,6 +352,7 @@ namespace utils {
 	bool file_io::get_char(char& ch)
 	{
 		if(fp_) {
+			flush_wcache_();
 			int cha = ::fgetc(fp_);
 			if(cha != EOF) {
 				ch = cha;
@@ -310,7 +383,12 @@ namespace utils {
 	bool file_io::put_char(char c)
 	{
 		if(fp_) {
-			fputc(c, fp_);
+			if(cache_mode_()) {
+				wcache_.push_back(c);
+				if(wcache_.size() >= wcache_size_) flush_wcache_();
+			} else {
+				fputc(c, fp_);
+			}
 			return true;
 		} else {
 			if(!open_) return false;
@@ -348,17 +426,150 @@ namespace utils {
 		std::string tmp;
 		if(!open_) return tmp;
 
-		char ch;
-		while(get_char(ch) == true) {
+		if(is_memory_read_()) {
+			const char* top;
+			size_t len;
+			if(get_line(top, len)) tmp.assign(top, len);
+			return tmp;
+		}
+
+		read_line_stream_(tmp);
+		return tmp;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	ファイル・ストリームから 1 行読み込み
+		@param[out]	line	読み込み先
+		@return	何か読み込んだら「true」
+	*/
+	//-----------------------------------------------------------------//
+	bool file_io::read_line_stream_(std::string& line)
+	{
+		if(fp_ == nullptr) return false;
+
+		flush_wcache_();
+		bool any = false;
+		int ch;
+		while((ch = ::getc(fp_)) != EOF) {
+			any = true;
 			if(ch == 0x0d) {
 				cr_ = true;
 			} else if(ch == 0x0a) {
 				break;
 			} else {
-				tmp += ch;
+				line += static_cast<char>(ch);
 			}
 		}
-		return tmp;
+		return any;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	1 行読み込み（ビュー）
+		@param[out]	top	行の先頭
+		@param[out]	len	行の長さ
+		@return	ファイルの終端で、読み込む物が無ければ「false」
+	*/
+	//-----------------------------------------------------------------//
+	bool file_io::get_line(const char*& top, size_t& len)
+	{
+		if(!open_) return false;
+
+		if(!is_memory_read_()) {
+			line_.clear();
+			bool any = read_line_stream_(line_);
+			top = line_.c_str();
+			len = line_.size();
+			return any;
+		}
+
+		if(fpos_ >= size_) return false;
+		const char* org = rbuff_ + fpos_;
+		size_t rem = size_ - fpos_;
+		const char* lf = static_cast<const char*>(std::memchr(org, 0x0a, rem));
+		size_t n = lf != nullptr ? static_cast<size_t>(lf - org) : rem;
+		fpos_ += lf != nullptr ? n + 1 : n;
+		if(n > 0 && org[n - 1] == 0x0d) {
+			cr_ = true;
+			--n;
+		}
+		top = org;
+		len = n;
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	ファイル全体を読み出し専用でマップする
+		@param[in]	filename	ファイル名
+		@return	マップ出来たら「true」
+	*/
+	//-----------------------------------------------------------------//
+	bool file_io::map_file_(const std::string& filename)
+	{
+		if(map_ != nullptr) return false;
+#ifdef WIN32
+		auto ws = utils::utf8_to_utf16(filename);
+		HANDLE fh = CreateFileW((LPCWSTR)ws.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(fh == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER sz;
+		if(!GetFileSizeEx(fh, &sz) || sz.QuadPart == 0) {
+			CloseHandle(fh);
+			return false;
+		}
+		HANDLE mh = CreateFileMappingW(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(fh);
+		if(mh == NULL) return false;
+		void* p = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+		if(p == NULL) {
+			CloseHandle(mh);
+			return false;
+		}
+		map_handle_ = mh;
+		map_ = p;
+		map_size_ = static_cast<size_t>(sz.QuadPart);
+#else
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if(fd < 0) return false;
+		struct stat st;
+		if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if(p == MAP_FAILED) return false;
+		madvise(p, st.st_size, MADV_SEQUENTIAL);
+		map_ = p;
+		map_size_ = st.st_size;
+#endif
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	マップを解除する
+	*/
+	//-----------------------------------------------------------------//
+	void file_io::unmap_file_()
+	{
+		if(map_ == nullptr) return;
+#ifdef WIN32
+		UnmapViewOfFile(map_);
+		CloseHandle(static_cast<HANDLE>(map_handle_));
+		map_handle_ = nullptr;
+#else
+		munmap(map_, map_size_);
+#endif
+		map_ = nullptr;
+		map_size_ = 0;
+		rbuff_ = nullptr;
 	}
 
 
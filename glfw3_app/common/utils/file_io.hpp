@@ -10,7 +10,9 @@
 */
 //=====================================================================//
 #include <cstdio>
+#include <cstring>
 #include <memory>
+#include <vector>
 #include "utils/string_utils.hpp"
 
 namespace utils {
@@ -38,6 +40,17 @@ namespace utils {
 	std::FILE* wfopen(const utils::lstring& fn, const std::string& md);
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	UTF-8 のファイル名でオープン（UTF-32 を経由しない）
+		@param[in]	fn	ファイル名
+		@param[in]	md	オープンモード
+		@return オープンできれば、ファイル構造体のポインターを返す
+	*/
+	//-----------------------------------------------------------------//
+	std::FILE* wfopen(const std::string& fn, const std::string& md);
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	ディレクトリーを作成する（UTF8）
@@ -91,11 +104,7 @@ namespace utils {
 		@return ファイルが有効なら「true」
 	*/
 	//-----------------------------------------------------------------//
-	inline bool probe_file(const std::string& fn, bool dir = false) {
-		utils::lstring ls;
-		utils::utf8_to_utf32(fn, ls);
-		return probe_file(ls, dir);
-	}
+	bool probe_file(const std::string& fn, bool dir = false);
 
 
 	//-----------------------------------------------------------------//
@@ -132,7 +141,10 @@ namespace utils {
 
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	/*!
-		@brief	ファイル入出力・クラス
+		@brief	ファイル入出力・クラス @n
+				open_map でオープンすると、ファイルをメモリーにマップし、@n
+				記憶領域と同じ経路（memcpy）で読み出す。@n
+				書き込みは、ユーザー空間のキャッシュに溜めてまとめて書き出す。
 	*/
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	class file_io {
@@ -150,6 +162,16 @@ namespace utils {
 			};
 		};
 
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	オープン・フック型 @n
+					open_map で、実ファイルが無い場合に呼ばれる。@n
+					（アーカイブ内のパスなどを記憶領域としてオープンする）
+		*/
+		//-----------------------------------------------------------------//
+		typedef bool (*open_hook_type)(const std::string& path, file_io& fio);
+
 	private:
 		uint32_t	count_;
 
@@ -165,6 +187,21 @@ namespace utils {
 		const char*			rbuff_;
 		std::vector<char>	wbuff_;
 
+		void*	map_;
+		size_t	map_size_;
+		void*	map_handle_;
+		bool	map_mode_;
+
+		mutable std::vector<char>	wcache_;
+		std::string	line_;
+
+		std::shared_ptr<const void>	hold_;
+
+		static open_hook_type& open_hook_() {
+			static open_hook_type hook = nullptr;
+			return hook;
+		}
+
 		size_t	fpos_;
 		size_t	size_;
 
@@ -186,6 +223,29 @@ namespace utils {
 
 		bool	cr_;
 
+		static const size_t wcache_size_ = 64 * 1024;
+
+		bool cache_mode_() const {
+			return fp_ != nullptr && (write_mode_ || append_mode_);
+		}
+
+		void flush_wcache_() const {
+			if(!wcache_.empty()) {
+				::fwrite(&wcache_[0], 1, wcache_.size(), fp_);
+				wcache_.clear();
+			}
+		}
+
+		bool is_memory_read_() const {
+			return open_ && fp_ == nullptr && rbuff_ != nullptr && read_mode_;
+		}
+
+		bool map_file_(const std::string& filename);
+
+		bool read_line_stream_(std::string& line);
+
+		void unmap_file_();
+
 	public:
 
 		//-----------------------------------------------------------------//
@@ -194,9 +254,11 @@ namespace utils {
 		*/
 		//-----------------------------------------------------------------//
 		file_io() : count_(0), open_(false), file_(false),
-					fp_(0), w_buff_(0), rbuff_(0), fpos_(0), size_(0),
+					fp_(0), w_buff_(0), rbuff_(0),
+					map_(nullptr), map_size_(0), map_handle_(nullptr), map_mode_(false),
+					fpos_(0), size_(0),
 					binary_mode_(true), read_mode_(false), write_mode_(false),
-					cr_(false) { }
+					append_mode_(false), cr_(false) { }
 
 
 		//-----------------------------------------------------------------//
@@ -230,11 +292,9 @@ namespace utils {
 			file_ = true;
 			fpath_ = filename;
 			mode_ = mode;
+			map_mode_ = false;
 
-			utils::lstring lfn;
-			utf8_to_utf32(fpath_, lfn);
-
-			fp_ = wfopen(lfn, mode);
+			fp_ = wfopen(fpath_, mode);
 			if(fp_ == 0) {
 				return false;
 			} else {
@@ -291,6 +351,110 @@ namespace utils {
 		}
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイル・リード・オープン（メモリー・マップ） @n
+					ファイル全体を読み出し専用でマップし、記憶領域として扱う。@n
+					マップ出来ない場合（空のファイルなど）は「rb」でオープンする。
+			@param[in]	filename	ファイル名
+			@return	正常なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool open_map(const std::string& filename) {
+			if(open_) return false;
+			if(!map_file_(filename)) {
+				auto hook = open_hook_();
+				bool f;
+				if(hook != nullptr && hook(filename, *this)) {
+					file_ = true;
+					fpath_ = filename;
+					mode_ = "rb";
+					f = true;
+				} else {
+					f = open(filename, "rb");
+				}
+				map_mode_ = true;
+				return f;
+			}
+			if(!open(map_, map_size_)) {
+				unmap_file_();
+				return false;
+			}
+			file_ = true;
+			fpath_ = filename;
+			mode_ = "rb";
+			map_mode_ = true;
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	オープン・フックを設定する
+			@param[in]	hook	フック（nullptr なら解除）
+		*/
+		//-----------------------------------------------------------------//
+		static void set_open_hook(open_hook_type hook) { open_hook_() = hook; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイル・リード・オープン（共有された記憶領域） @n
+					hold が領域を保持し、クローズするまで参照を保つ。
+			@param[in]	buff	メモリーの先頭
+			@param[in]	size	サイズ
+			@param[in]	hold	領域の所有者
+			@return	正常なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool open(const void* buff, size_t size, const std::shared_ptr<const void>& hold) {
+			if(!open(buff, size)) return false;
+			hold_ = hold;
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	マップされているか検査する
+			@return	マップされていれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool is_mapped() const { return map_ != nullptr; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	読み出し領域の全体を得る（記憶領域、マップの場合） @n
+					※ファイル・ストリームの場合「nullptr」が返る。
+			@return	領域の先頭（サイズは get_file_size で得る）
+		*/
+		//-----------------------------------------------------------------//
+		const void* get_span() const {
+			if(is_memory_read_()) return rbuff_;
+			else return nullptr;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	現在位置から len バイトのビューを得て、位置を進める @n
+					コピーせずに、領域のポインターを返す。@n
+					※ファイル・ストリームの場合や、残りが足りない場合は @n
+					「nullptr」を返し、位置は変化しない。
+			@param[in]	len	バイト数
+			@return	ビューの先頭
+		*/
+		//-----------------------------------------------------------------//
+		const char* get_view(size_t len) {
+			if(!is_memory_read_()) return nullptr;
+			if(len > (size_ - fpos_)) return nullptr;
+			const char* p = rbuff_ + fpos_;
+			fpos_ += len;
+			return p;
+		}
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	ファイル・オープン（記憶領域）
@@ -343,6 +507,9 @@ namespace utils {
 			if(file_) {
 				std::string fn = fpath_;
 				std::string md = mode_;
+				if(map_mode_) {
+					return open_map(fn);
+				}
 				return open(fn, md);
 			} else {
 				if(write_mode_) {
@@ -408,7 +575,7 @@ namespace utils {
 		//-----------------------------------------------------------------//
 		size_t tell() const {
 			if(fp_) {
-				return ftell(fp_);
+				return ftell(fp_) + wcache_.size();
 			} else {
 				return fpos_;
 			}
@@ -425,6 +592,7 @@ namespace utils {
 		//-----------------------------------------------------------------//
 		bool seek(size_t offset, seek::type stp) {
 			if(fp_) {
+				flush_wcache_();
 				if(fseek(fp_, offset, stp) == 0) return true;
 				else return false;
 			} else {
@@ -474,16 +642,16 @@ namespace utils {
 		//-----------------------------------------------------------------//
 		size_t read(void* ptr, size_t size, size_t num) {
 			if(fp_) {
+				flush_wcache_();
 				return fread(ptr, size, num, fp_);
+			} else if(size > 0 && is_memory_read_()) {
+				size_t n = size * num;
+				if(n > (size_ - fpos_)) n = size_ - fpos_;
+				std::memcpy(ptr, rbuff_ + fpos_, n);
+				fpos_ += n;
+				return n / size;
 			} else {
-				char *p = static_cast<char*>(ptr);
-				size_t i;
-				for(i = 0; i < (size * num); ++i) {
-					char c;
-					if(get_char(c) == false) { return i / size; }
-					*p++ = c;
-				}
-				return i / size;
+				return 0;
 			}
 		}
 
@@ -509,6 +677,23 @@ namespace utils {
 		*/
 		//-----------------------------------------------------------------//
 		size_t get(std::string& pad, uint32_t size = 0, char term = 0) {
+			if(is_memory_read_()) {
+				const char* top = rbuff_ + fpos_;
+				size_t n = size_ - fpos_;
+				size_t skip = 0;
+				if(size == 0) {
+					const void* t = std::memchr(top, term, n);
+					if(t != nullptr) {
+						n = static_cast<const char*>(t) - top;
+						skip = 1;
+					}
+				} else if(n > size) {
+					n = size;
+				}
+				pad.append(top, n);
+				fpos_ += n + skip;
+				return n;
+			}
 			if(size == 0) {
 				uint32_t n = 0;
 				while(1) {
@@ -640,14 +825,7 @@ namespace utils {
 		//-----------------------------------------------------------------//
 		size_t put(const std::string& text) {
 			if(text.empty()) return 0;
-			size_t n = 0;
-			for(auto ch : text) {
-				if(!put_char(ch)) {
-					return n;
-				}
-				++n;
-			}
-			return n;
+			return write(text.data(), text.size());
 		}
 
 
@@ -662,15 +840,7 @@ namespace utils {
 			if(text == nullptr) {
 				return 0;
 			}
-			char ch;
-			size_t n = 0;
-			while((ch = *text++) != 0) {
-				if(!put_char(ch)) {
-					return n;
-				}
-				++n;
-			}
-			return n;
+			return write(text, std::strlen(text));
 		}
 
 
@@ -738,13 +908,24 @@ namespace utils {
 		*/
 		//-----------------------------------------------------------------//
 		size_t write(const void* ptr, size_t size, size_t num) {
-			const char*p = static_cast<const char*>(ptr);
-			size_t i;
-			for(i = 0; i < (size * num); ++i) {
-				char c = *p++;
-				if(put_char(c) == false) { return i / size; }
+			if(!open_ || size == 0) return 0;
+			const char* p = static_cast<const char*>(ptr);
+			size_t n = size * num;
+			if(fp_) {
+				if(!cache_mode_()) {
+					return fwrite(p, size, num, fp_);
+				}
+				if((wcache_.size() + n) > wcache_size_) {
+					flush_wcache_();
+				}
+				if(n >= wcache_size_) {
+					return fwrite(p, size, num, fp_);
+				}
+				wcache_.insert(wcache_.end(), p, p + n);
+			} else {
+				wbuff_.insert(wbuff_.end(), p, p + n);
 			}
-			return i / size;
+			return num;
 		}
 
 
@@ -769,6 +950,7 @@ namespace utils {
 			int ret = 0;
 			if(open_) {
 				if(fp_) {
+					flush_wcache_();
 					ret = ::fflush(fp_);
 				}
 			}
@@ -787,6 +969,7 @@ namespace utils {
 			int fd = -1;
 			if(open_) {
 				if(fp_) {
+					flush_wcache_();
 #ifdef __USE_MINGW_ANSI_STDIO
 					fd = fp_->_file;
 #else
@@ -816,6 +999,21 @@ namespace utils {
 		std::string get_line();
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	1 行読み込み（ビュー） @n
+					改行（CR/LF）を含まない行の先頭と長さを返す。@n
+					記憶領域、マップの場合はコピーしない。@n
+					ファイル・ストリームの場合は内部バッファを指し、@n
+					次の読み込みまで有効。
+			@param[out]	top	行の先頭
+			@param[out]	len	行の長さ
+			@return	ファイルの終端で、読み込む物が無ければ「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool get_line(const char*& top, size_t& len);
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	改行にCRが含まれるか
@@ -834,8 +1032,8 @@ namespace utils {
 		*/
 		//-----------------------------------------------------------------//
 		bool put_line(const std::string& buff, bool cr = false) {
-			for(auto ch : buff) {
-				if(!put_char(ch)) return false;
+			if(!buff.empty() && write(buff.data(), buff.size()) != buff.size()) {
+				return false;
 			}
 			if(cr) put_char('\r');
 			put_char('\n');
@@ -861,9 +1059,12 @@ namespace utils {
 		bool close() {
 			if(open_) {
 				if(fp_) {
+					flush_wcache_();
 					fclose(fp_);
 					fp_ = 0;
 				}
+				unmap_file_();
+				hold_.reset();
 				open_ = false;
 				return true;
 			} else {
@@ -12,13 +12,17 @@
 			+ 2017/06/11 20:00- 標準文字出力クラスの再定義、実装 @n 
 			+ 2017/06/11 21:00- 固定文字列クラス向け chaout、実装 @n
 			+ 2017/06/12 14:50- memory_chaoutと、専用コンストラクター実装 @n
-			+ 2017/06/14 05:34- memory_chaout size() のバグ修正
+			+ 2017/06/14 05:34- memory_chaout size() のバグ修正 @n
+			・make_format でコンパイル時に解析したフォーマット（format_spec）を @n
+			受け付ける。引数の数と型は format_spec::check で static_assert 出来る。
     @author 平松邦仁 (hira@rvf-rc45.net)
 	@copyright	Copyright (C) 2013, 2017 Kunihito Hiramatsu @n
 				Released under the MIT license @n
 				https://github.com/hirakuni45/RX/blob/master/LICENSE
 */
 //=====================================================================//
+#include <cstdint>
+#include <cstddef>
 #include <type_traits>
 #include <unistd.h>
 #include <cstring>
@@ -64,6 +68,8 @@ namespace utils {
 		void operator() (char ch) {
 		}
 
+		void write(const char* src, uint32_t len) { }
+
 		void clear() { };
 
 		uint32_t size() const { return 0; }
@@ -92,6 +98,8 @@ namespace utils {
 			++size_;
 		}
 
+		void write(const char* src, uint32_t len) { size_ += len; }
+
 		void clear() { size_ = 0; };
 
 		uint32_t size() const { return size_; }
@@ -238,12 +246,216 @@ namespace utils {
 			}
 		}
 
+		void write(const char* src, uint32_t len) {
+			if(limit_ == 0 || pos_ >= (limit_ - 1)) return;
+			uint32_t n = limit_ - 1 - pos_;
+			if(len < n) n = len;
+			std::memcpy(&dst_[pos_], src, n);
+			pos_ += n;
+			dst_[pos_] = 0;
+		}
+
 		void clear() { pos_ = 0; }
 
 		uint32_t size() const { return pos_; }
 	};
 
 
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  解析済みフォーマットの一項目 @n
+				文字列 [ofs_, ofs_ + len_) を出力した後、conv_ の変換を行う。@n
+				conv_ が０なら文字列のみ、「?」なら不明な変換（エラー）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct format_item {
+		uint16_t	ofs_;
+		uint16_t	len_;
+		char		conv_;
+		uint8_t		num_;
+		uint8_t		point_;
+		uint8_t		bitlen_;
+		bool		zerosupp_;
+		bool		sign_;
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  解析済みフォーマット（make_format で生成する）
+		@param[in]	N	項目の最大数
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <uint32_t N>
+	struct format_spec {
+		const char*	form_;
+		format_item	item_[N];
+		uint32_t	size_;		///< 項目数
+		uint32_t	args_;		///< 変換の数
+		bool		error_;		///< 不明な変換がある場合「true」
+
+	private:
+		// 引数の型の分類（1:文字列、2:１バイト整数、3:整数、4:浮動小数点）
+		template <typename T>
+		static constexpr uint8_t class_() {
+			typedef typename std::decay<T>::type U;
+			return (std::is_same<U, const char*>::value || std::is_same<U, char*>::value) ? 1
+				: std::is_integral<U>::value ? (sizeof(U) == 1 ? 2 : 3)
+				: std::is_floating_point<U>::value ? 4 : 0;
+		}
+
+		static constexpr bool accept_(uint8_t cls, char conv) {
+			switch(conv) {
+			case 's':
+				return cls == 1;
+			case 'c':
+				return cls == 2;
+			case 'b': case 'o': case 'd': case 'u': case 'x': case 'X': case 'y':
+				return cls == 2 || cls == 3;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+				return cls == 4;
+			default:
+				return false;
+			}
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  解析ステータス
+			@return 不明な変換が無ければ「true」
+		*/
+		//-----------------------------------------------------------------//
+		constexpr bool status() const { return !error_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  変換の数（必要な引数の数）
+			@return 変換の数
+		*/
+		//-----------------------------------------------------------------//
+		constexpr uint32_t args() const { return args_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  引数の型を検査（static_assert で使う） @n
+					Ex: static_assert(fm.check<int, const char*>(), "format");
+			@return 数と型が全て一致すれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		template <typename... Args>
+		constexpr bool check() const {
+			const uint8_t cls[] = { 0, class_<Args>()... };
+			if(error_ || sizeof...(Args) != args_) return false;
+			uint32_t n = 0;
+			for(uint32_t i = 0; i < size_; ++i) {
+				if(item_[i].conv_ == 0) continue;
+				++n;
+				if(!accept_(cls[n], item_[i].conv_)) return false;
+			}
+			return true;
+		}
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  フォーマット式を解析（コンパイル時） @n
+				basic_format の実行時解析と同じ規則で、文字列と変換の @n
+				並びに分解する。@n
+				Ex: constexpr auto fm = utils::make_format("%d: %s\n"); @n
+				utils::format(fm) % 10 % "abc";
+		@param[in]	form	フォーマット式（文字列リテラル）
+		@return 解析済みフォーマット
+	*/
+	//-----------------------------------------------------------------//
+	template <size_t L>
+	constexpr format_spec<L / 2 + 1> make_format(const char (&form)[L])
+	{
+		static_assert(L < 65536, "format string too long");
+
+		format_spec<L / 2 + 1> t {};
+		t.form_ = form;
+		format_item it {};
+		uint16_t lit = 0;
+		uint16_t len = 0;
+		bool spec = false;
+		uint8_t md = 0;  // 1:数字、2:小数点、3:ビット長さ
+		uint16_t i = 0;
+		for(; i < (L - 1) && form[i] != 0; ++i) {
+			char ch = form[i];
+			if(!spec) {
+				if(ch == '%') {
+					spec = true;
+					md = 1;
+					len = i - lit;
+				}
+				continue;
+			}
+			if(ch == '+') {
+				it.sign_ = true;
+			} else if(ch >= '0' && ch <= '9') {
+				uint8_t d = ch - '0';
+				if(md == 1) {
+					if(it.num_ == 0 && d == 0) it.zerosupp_ = true;
+					it.num_ = static_cast<uint8_t>(it.num_ * 10 + d);
+				} else if(md == 2) {
+					it.point_ = static_cast<uint8_t>(it.point_ * 10 + d);
+				} else {
+					it.bitlen_ = static_cast<uint8_t>(it.bitlen_ * 10 + d);
+				}
+			} else if(ch == '.') {
+				md = 2;
+			} else if(ch == ':') {
+				md = 3;
+			} else if(ch == '-') {  // 無視する
+
+			} else if(ch == '%') {  // 二つ目の「%」から、文字列を再開
+				if(len > 0) {
+					format_item& o = t.item_[t.size_++];
+					o.ofs_ = lit;
+					o.len_ = len;
+				}
+				lit = i;
+				spec = false;
+			} else {
+				bool conv = false;
+				switch(ch) {
+				case 's': case 'c': case 'b': case 'o': case 'd': case 'u': case 'x': case 'X':
+				case 'y': case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+					conv = true;
+					break;
+				default:
+					break;
+				}
+				it.ofs_ = lit;
+				it.len_ = len;
+				if(conv) {
+					it.conv_ = ch;
+					++t.args_;
+				} else {
+					it.conv_ = '?';
+					t.error_ = true;
+				}
+				t.item_[t.size_++] = it;
+				if(!conv) return t;
+				it = format_item {};
+				lit = i + 1;
+				spec = false;
+			}
+		}
+		if(!spec) len = i - lit;
+		if(len > 0) {
+			format_item& o = t.item_[t.size_++];
+			o.ofs_ = lit;
+			o.len_ = len;
+		}
+		return t;
+	}
+
+
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	/*!
 		@brief  簡易 format クラス
@@ -286,6 +498,8 @@ namespace utils {
 		static CHAOUT	chaout_;
 
 		const char*	form_;
+		const format_item*	item_;
+		const format_item*	item_end_;
 
 		char		buff_[34];
 
@@ -312,7 +526,61 @@ namespace utils {
 			sign_ = false;
 		}
 
+		static mode conv_mode_(char ch) {
+			switch(ch) {
+			case 's': return mode::STR;
+			case 'c': return mode::CHA;
+			case 'b': return mode::BINARY;
+			case 'o': return mode::OCTAL;
+			case 'd': return mode::DECIMAL;
+			case 'u': return mode::U_DECIMAL;
+			case 'x': return mode::HEX;
+			case 'X': return mode::HEX_CAPS;
+			case 'y': return mode::FIXED_REAL;
+			case 'f': case 'F': return mode::REAL;
+			case 'e': return mode::EXPONENT;
+			case 'E': return mode::EXPONENT_CAPS;
+			case 'g': case 'G': return mode::REAL_AUTO;
+			default: return mode::NONE;
+			}
+		}
+
+		// 文字列の一括出力（write を持つ出力ファンクタはそれを使う）
+		template <class OUT>
+		static auto write_(OUT& out, const char* src, uint32_t len, int) -> decltype(out.write(src, len), void()) {
+			out.write(src, len);
+		}
+		template <class OUT>
+		static void write_(OUT& out, const char* src, uint32_t len, long) {
+			for(uint32_t i = 0; i < len; ++i) out(src[i]);
+		}
+
+		// 解析済みフォーマットの次の項目まで進める
+		void next_item_() {
+			while(item_ != item_end_) {
+				const format_item& t = *item_++;
+				write_(chaout_, form_ + t.ofs_, t.len_, 0);
+				if(t.conv_ == 0) continue;
+				if(t.conv_ == '?') {
+					error_ = error::unknown;
+					return;
+				}
+				num_ = t.num_;
+				point_ = t.point_;
+				bitlen_ = t.bitlen_;
+				zerosupp_ = t.zerosupp_;
+				sign_ = t.sign_;
+				mode_ = conv_mode_(t.conv_);
+				return;
+			}
+		}
+
 		void next_() {
+			if(item_ != nullptr) {
+				next_item_();
+				return;
+			}
+
 			enum class apmd : uint8_t {
 				none,
 				num,    // 数字
@@ -650,7 +918,7 @@ namespace utils {
 		*/
 		//-----------------------------------------------------------------//
 		basic_format(const char* form) noexcept :
-			form_(form),
+			form_(form), item_(nullptr), item_end_(nullptr),
 			error_(error::none),
 			num_(0), point_(0),
 			bitlen_(0),
@@ -670,7 +938,51 @@ namespace utils {
 		*/
 		//-----------------------------------------------------------------//
 		basic_format(const char* form, char* buff, uint32_t size, bool append = false) noexcept :
-			form_(form),
+			form_(form), item_(nullptr), item_end_(nullptr),
+			error_(error::none),
+			num_(0), point_(0),
+			bitlen_(0),
+			mode_(mode::NONE), zerosupp_(false), sign_(false)
+		{
+			chaout_.set(buff, size);
+			if(!append) {
+				chaout_.clear();
+
+			}
+			next_();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  コンストラクター（解析済みフォーマット）
+			@param[in]	spec	make_format で解析したフォーマット
+		*/
+		//-----------------------------------------------------------------//
+		template <uint32_t N>
+		basic_format(const format_spec<N>& spec) noexcept :
+			form_(spec.form_), item_(spec.item_), item_end_(spec.item_ + spec.size_),
+			error_(error::none),
+			num_(0), point_(0),
+			bitlen_(0),
+			mode_(mode::NONE), zerosupp_(false), sign_(false)
+		{
+			next_();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  コンストラクター（解析済みフォーマット）
+			@param[in]	spec	make_format で解析したフォーマット
+			@param[in]	buff	文字バッファ
+			@param[in]	size	文字バッファサイズ
+			@param[in]	append	文字バッファに追加する場合「true」
+		*/
+		//-----------------------------------------------------------------//
+		template <uint32_t N>
+		basic_format(const format_spec<N>& spec, char* buff, uint32_t size, bool append = false) noexcept :
+			form_(spec.form_), item_(spec.item_), item_end_(spec.item_ + spec.size_),
 			error_(error::none),
 			num_(0), point_(0),
 			bitlen_(0),
@@ -1,33 +1,259 @@
 //=====================================================================//
 /*!	@file
-	@brief	グローバル・アロケーター（ヘッダー）
+	@brief	グローバル・アロケーター @n
 			new, delete, new[], delete[] オペレーターのオーバーロード
-	@author	平松邦仁 (hira@rvf-rc45.net) 
+	@author	平松邦仁 (hira@rvf-rc45.net)
 */
 //=====================================================================//
-#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <mutex>
+#include <atomic>
 #include <boost/format.hpp>
-#include <assert.h>
 #include "galloc.hpp"
 
-#ifdef OPTION_MEMORY_ALOCATE
-/// ↓このサイズを変更して、グローバル記憶ブロックサイズを調整する
-static const size_t global_memory_block_size = (192 * 1024 * 1024);
-static BXMM* global_bxmm = 0;
+namespace {
 
-#ifndef NDEBUG
-galloc galloc_dummy;	///< グローバル記憶管理ダミー用
-#endif
+	// 各ブロックの先頭に置くヘッダー（１６バイトで、ユーザー領域のアライメントを保つ）
+	struct header {
+		uint64_t	size_;		///< 要求サイズ
+		uint16_t	cls_;		///< サイズ・クラス（large_class なら malloc）
+		uint16_t	tag_;		///< 集計キー（counted_flag なら集計済み）
+		uint32_t	magic_;
+	};
+	static const uint32_t header_size = sizeof(header);
+	static const uint32_t magic_code = 0x47414c43;	///< "GALC"
 
-#ifndef NDEBUG
-void global_check_map()
-{
-	int	parity;
-	int	prev;
-	::bxmm_check_map(global_bxmm, &parity, &prev);
-	std::cout << boost::format("GLOBAL BXMM: %d, %d") % parity % prev << std::endl;
+	// サイズ・クラス：１２８まで１６刻み、以降は２の累乗を４分割（３２Ｋまで）
+	static const uint32_t class_num = 40;
+	static const uint32_t small_max = 32768;
+	static const uint16_t large_class = 0xffff;
+
+	// スパン（システムから確保する単位）
+	static const uint32_t span_size = 64 * 1024;
+
+	static const uint32_t tag_max = 64;
+	static const uint16_t counted_flag = 0x8000;
+	static const uint32_t key_depth = 16;
+
+	inline uint32_t size_to_class_(std::size_t n)
+	{
+		if(n <= 128) return n == 0 ? 0 : static_cast<uint32_t>((n + 15) / 16 - 1);
+		uint32_t e = 31 - __builtin_clz(static_cast<uint32_t>(n - 1));
+		uint32_t p = 1 << e;
+		uint32_t sub = (static_cast<uint32_t>(n - 1) - p) >> (e - 2);
+		return 8 + (e - 7) * 4 + sub;
+	}
+
+	inline uint32_t class_to_size_(uint32_t cls)
+	{
+		if(cls < 8) return (cls + 1) * 16;
+		uint32_t e = 7 + (cls - 8) / 4;
+		uint32_t p = 1 << e;
+		return p + ((cls - 8) % 4 + 1) * (p >> 2);
+	}
+
+	// １回の補充で移すブロック数
+	inline uint32_t batch_(uint32_t cls)
+	{
+		uint32_t n = (16 * 1024) / (class_to_size_(cls) + header_size);
+		if(n < 4) n = 4;
+		else if(n > 64) n = 64;
+		return n;
+	}
+
+	struct free_node {
+		free_node*	next_;
+	};
+
+	// 全スレッドで共有するプール
+	struct central {
+		std::mutex	mutex_;
+		free_node*	list_;
+		uint32_t	count_;
+	};
+	central central_[class_num];
+
+	std::atomic<uint64_t>	reserved_(0);	///< スパンとして確保したバイト数
+	std::atomic<uint64_t>	large_(0);		///< malloc で確保中のバイト数
+
+	// キー毎の集計
+	struct tag_stat {
+		char					name_[32];
+		std::atomic<int64_t>	bytes_;			///< 使用中のバイト数
+		std::atomic<int64_t>	peak_;
+		std::atomic<uint64_t>	allocs_;
+		std::atomic<uint64_t>	frees_;
+		std::atomic<uint64_t>	frame_allocs_;
+		std::atomic<uint64_t>	frame_bytes_;
+		std::atomic<uint64_t>	last_allocs_;	///< 前フレームの確保回数
+		std::atomic<uint64_t>	last_bytes_;	///< 前フレームの確保バイト数
+	};
+	tag_stat	tags_[tag_max];
+	std::atomic<uint32_t>	tag_num_(1);	///< ０番はキー無し
+	std::mutex	tag_mutex_;
+	std::atomic<bool>	profile_(false);
+	std::atomic<uint64_t>	frame_(0);
+
+	uint16_t find_tag_(const char* key)
+	{
+		std::lock_guard<std::mutex> lock(tag_mutex_);
+		uint32_t n = tag_num_;
+		for(uint32_t i = 1; i < n; ++i) {
+			if(std::strncmp(tags_[i].name_, key, sizeof(tags_[i].name_) - 1) == 0) return i;
+		}
+		if(n >= tag_max) return 0;
+		std::strncpy(tags_[n].name_, key, sizeof(tags_[n].name_) - 1);
+		tag_num_ = n + 1;
+		return n;
+	}
+
+	void count_alloc_(uint16_t tag, std::size_t n)
+	{
+		tag_stat& t = tags_[tag];
+		int64_t b = t.bytes_.fetch_add(n, std::memory_order_relaxed) + n;
+		int64_t pk = t.peak_.load(std::memory_order_relaxed);
+		while(b > pk && !t.peak_.compare_exchange_weak(pk, b, std::memory_order_relaxed)) ;
+		t.allocs_.fetch_add(1, std::memory_order_relaxed);
+		t.frame_allocs_.fetch_add(1, std::memory_order_relaxed);
+		t.frame_bytes_.fetch_add(n, std::memory_order_relaxed);
+	}
+
+	void count_free_(uint16_t tag, std::size_t n)
+	{
+		tag_stat& t = tags_[tag];
+		t.bytes_.fetch_sub(n, std::memory_order_relaxed);
+		t.frees_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// スパンを確保して、ブロックのリストにする（central の mutex を持って呼ぶ）
+	bool grow_(uint32_t cls)
+	{
+		uint32_t bsz = class_to_size_(cls) + header_size;
+		uint32_t sz = span_size;
+		if(sz < bsz * 8) sz = bsz * 8;
+		uint8_t* span = static_cast<uint8_t*>(std::malloc(sz));
+		if(span == nullptr) return false;
+		reserved_ += sz;
+
+		central& c = central_[cls];
+		uint32_t num = sz / bsz;
+		for(uint32_t i = 0; i < num; ++i) {
+			free_node* f = reinterpret_cast<free_node*>(span + i * bsz);
+			f->next_ = c.list_;
+			c.list_ = f;
+		}
+		c.count_ += num;
+		return true;
+	}
+
+	void release_(uint32_t cls, free_node* first, free_node* last, uint32_t num)
+	{
+		central& c = central_[cls];
+		std::lock_guard<std::mutex> lock(c.mutex_);
+		last->next_ = c.list_;
+		c.list_ = first;
+		c.count_ += num;
+	}
+
+	// スレッド毎のキャッシュ
+	struct thread_cache {
+		free_node*	list_[class_num];
+		uint32_t	count_[class_num];
+		uint16_t	keys_[key_depth];
+		uint32_t	key_pos_;
+
+		void flush(uint32_t cls, uint32_t num) {
+			free_node* first = list_[cls];
+			free_node* last = first;
+			for(uint32_t i = 1; i < num; ++i) last = last->next_;
+			list_[cls] = last->next_;
+			count_[cls] -= num;
+			release_(cls, first, last, num);
+		}
+
+		void flush_all() {
+			for(uint32_t i = 0; i < class_num; ++i) {
+				if(count_[i] > 0) flush(i, count_[i]);
+			}
+		}
+
+		~thread_cache();
+	};
+	thread_local thread_cache cache_;
+	thread_local bool cache_dead_ = false;	///< キャッシュ廃棄後の確保、開放はプールを直接使う
+
+	thread_cache::~thread_cache()
+	{
+		flush_all();
+		cache_dead_ = true;
+	}
+
+	uint16_t current_tag_()
+	{
+		if(!profile_.load(std::memory_order_relaxed)) return 0;
+		if(cache_dead_ || cache_.key_pos_ == 0) return 0;
+		uint32_t pos = cache_.key_pos_;
+		if(pos > key_depth) pos = key_depth;
+		return cache_.keys_[pos - 1];
+	}
+
+	void* alloc_small_(uint32_t cls)
+	{
+		if(!cache_dead_) {
+			thread_cache& tc = cache_;
+			if(tc.list_[cls] == nullptr) {
+				uint32_t num = batch_(cls);
+				central& c = central_[cls];
+				std::lock_guard<std::mutex> lock(c.mutex_);
+				if(c.count_ < num && !grow_(cls) && c.count_ == 0) return nullptr;
+				free_node* first = c.list_;
+				free_node* last = first;
+				uint32_t n = 1;
+				while(n < num && last->next_ != nullptr) {
+					last = last->next_;
+					++n;
+				}
+				c.list_ = last->next_;
+				c.count_ -= n;
+				last->next_ = nullptr;
+				tc.list_[cls] = first;
+				tc.count_[cls] = n;
+			}
+			free_node* f = tc.list_[cls];
+			tc.list_[cls] = f->next_;
+			--tc.count_[cls];
+			return f;
+		}
+
+		central& c = central_[cls];
+		std::lock_guard<std::mutex> lock(c.mutex_);
+		if(c.list_ == nullptr && !grow_(cls)) return nullptr;
+		free_node* f = c.list_;
+		c.list_ = f->next_;
+		--c.count_;
+		return f;
+	}
+
+	void free_small_(uint32_t cls, void* blk)
+	{
+		free_node* f = static_cast<free_node*>(blk);
+		if(cache_dead_) {
+			release_(cls, f, f, 1);
+			return;
+		}
+		thread_cache& tc = cache_;
+		f->next_ = tc.list_[cls];
+		tc.list_[cls] = f;
+		++tc.count_[cls];
+		uint32_t num = batch_(cls);
+		if(tc.count_[cls] > num * 2) {
+			tc.flush(cls, num);
+		}
+	}
 }
-#endif
+
 
 //-----------------------------------------------------------------//
 /*!
@@ -36,15 +262,9 @@ void global_check_map()
 //-----------------------------------------------------------------//
 void global_memory_create()
 {
-	if(global_bxmm == 0) {
-		global_bxmm = memory_block_create("GAPP", global_memory_block_size, 16);
-	}
 }
 
 
-BXMM* global_memory_get() { return global_bxmm; }
-
-
 //-----------------------------------------------------------------//
 /*!
 	@brief	グローバル、記憶ブロックの廃棄
@@ -52,52 +272,169 @@ BXMM* global_memory_get() { return global_bxmm; }
 //-----------------------------------------------------------------//
 void global_memory_destroy()
 {
-	if(global_bxmm != 0) {
-		memory_block_destroy(global_bxmm);
-		global_bxmm = 0;
+	if(!cache_dead_) cache_.flush_all();
+	if(profile_) global_memory_report(std::cout);
+}
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief	メモリーの確保
+	@param[in]	n	確保するサイズ
+	@return	確保したメモリーのポインター
+ */
+//-----------------------------------------------------------------//
+void* global_memory_alloc(std::size_t n)
+{
+	header* h;
+	uint16_t cls;
+	if(n <= small_max) {
+		cls = size_to_class_(n);
+		h = static_cast<header*>(alloc_small_(cls));
+	} else {
+		cls = large_class;
+		h = static_cast<header*>(std::malloc(header_size + n));
+		if(h != nullptr) large_ += n;
+	}
+	if(h == nullptr) return nullptr;
+
+	h->size_ = n;
+	h->cls_ = cls;
+	h->tag_ = 0;
+	h->magic_ = magic_code;
+	if(profile_.load(std::memory_order_relaxed)) {
+		uint16_t tag = current_tag_();
+		count_alloc_(tag, n);
+		h->tag_ = tag | counted_flag;
 	}
+	return h + 1;
 }
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	記憶管理ブロックを作成する。
-	@param[in]	key		記憶管理テーブルの識別キー
-	@param[in]	size	記憶割り当てブロックのサイズ（バイト）
-	@param[in]	align	記憶管理ブロックの最小アライメントサイズ（バイト）
-	@return	記憶管理テーブル構造体のポインター
+	@brief	メモリーの開放
+	@param[in]	p	開放するメモリーのポインター
  */
 //-----------------------------------------------------------------//
-BXMM *memory_block_create(const char* key, size_t size, size_t align)
+void global_memory_free(void* p)
 {
-	void* mem = malloc(size);
-	assert(mem != 0);
-	BXMM *bx = ::bxmm_create(mem, size, align);
-#ifndef NDEBUG
-	::bxmm_set_system_key(bx, key);
-#endif
-	::bxmm_set_ptr(bx, mem);
-	return bx;
+	if(p == nullptr) return;
+
+	header* h = static_cast<header*>(p) - 1;
+	if(h->magic_ != magic_code) {
+		std::cerr << boost::format("galloc: invalid free (%p)") % p << std::endl;
+		std::abort();
+	}
+	h->magic_ = 0;
+	if(h->tag_ & counted_flag) count_free_(h->tag_ & ~counted_flag, h->size_);
+
+	if(h->cls_ == large_class) {
+		large_ -= h->size_;
+		std::free(h);
+	} else {
+		free_small_(h->cls_, h);
+	}
 }
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	記憶管理ブロックを廃棄する。
-	@param[in]	bx		記憶管理テーブル構造体のポインター
+	@brief	確保した領域の実サイズを取得
+	@param[in]	p	メモリーのポインター
+	@return	利用できるサイズ
  */
 //-----------------------------------------------------------------//
-void memory_block_destroy(BXMM *bx)
+std::size_t global_memory_size(const void* p)
 {
-#ifndef NDEBUG
-	::bxmm_list_map(bx);
-#endif
-	void* mem = ::bxmm_get_ptr(bx);
-	::bxmm_destroy(bx);
-	::free(mem);
+	if(p == nullptr) return 0;
+	const header* h = static_cast<const header*>(p) - 1;
+	if(h->cls_ == large_class) return h->size_;
+	return class_to_size_(h->cls_);
+}
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief	プロファイル（キー毎の集計）の許可
+	@param[in]	ena	「false」なら集計しない
+ */
+//-----------------------------------------------------------------//
+void global_memory_profile(bool ena)
+{
+	profile_ = ena;
 }
 
 
+//-----------------------------------------------------------------//
+/*!
+	@brief	グローバル、記憶ブロックにキー設定
+	@param[in]	key	設定するキー
+ */
+//-----------------------------------------------------------------//
+void global_memory_setkey(const char* key)
+{
+	if(cache_dead_) return;
+	uint16_t tag = (key == nullptr || key[0] == 0) ? 0 : find_tag_(key);
+	if(cache_.key_pos_ < key_depth) cache_.keys_[cache_.key_pos_] = tag;
+	++cache_.key_pos_;
+}
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief	グローバル、記憶ブロックのキーをリストア
+ */
+//-----------------------------------------------------------------//
+void global_memory_restorekey()
+{
+	if(cache_dead_) return;
+	if(cache_.key_pos_ > 0) --cache_.key_pos_;
+}
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief	フレームの区切り
+ */
+//-----------------------------------------------------------------//
+void global_memory_frame()
+{
+	uint32_t n = tag_num_;
+	for(uint32_t i = 0; i < n; ++i) {
+		tag_stat& t = tags_[i];
+		t.last_allocs_.store(t.frame_allocs_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+		t.last_bytes_.store(t.frame_bytes_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	++frame_;
+}
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief	集計のレポート
+	@param[in]	out	出力先
+ */
+//-----------------------------------------------------------------//
+void global_memory_report(std::ostream& out)
+{
+	out << boost::format("galloc: frame %d, reserved %d bytes (small), %d bytes (large)")
+		% frame_.load() % reserved_.load() % large_.load() << std::endl;
+	out << boost::format("  %-24s %12s %12s %10s %10s %8s %10s")
+		% "key" % "live" % "peak" % "allocs" % "frees" % "f-allocs" % "f-bytes" << std::endl;
+	uint32_t n = tag_num_;
+	for(uint32_t i = 0; i < n; ++i) {
+		const tag_stat& t = tags_[i];
+		if(t.allocs_ == 0) continue;
+		out << boost::format("  %-24s %12d %12d %10d %10d %8d %10d")
+			% (i == 0 ? "(none)" : t.name_)
+			% t.bytes_.load() % t.peak_.load() % t.allocs_.load() % t.frees_.load()
+			% t.last_allocs_.load() % t.last_bytes_.load() << std::endl;
+	}
+}
+
+
+#ifdef OPTION_MEMORY_ALOCATE
 //-----------------------------------------------------------------//
 /*!
 	@brief	グローバル new オペレーターのオーバーロード
@@ -105,12 +442,10 @@ void memory_block_destroy(BXMM *bx)
 	@return	獲得したメモリーのポインター
  */
 //-----------------------------------------------------------------//
-void* operator new(std::size_t n) throw()
+void* operator new(std::size_t n)
 {
-	global_memory_create();
-
-	if(n == 0) n = 1;
-	void* p = ::bxmm_malloc(global_bxmm, n);
+	void* p = global_memory_alloc(n);
+	if(p == nullptr) throw std::bad_alloc();
 	return p;
 }
 
@@ -121,9 +456,9 @@ void* operator new(std::size_t n) throw()
 	@param[in]	p	開放するメモリーのポインター
  */
 //-----------------------------------------------------------------//
-void operator delete(void* p) throw()
+void operator delete(void* p) noexcept
 {
-	::bxmm_free(global_bxmm, p);
+	global_memory_free(p);
 }
 
 
@@ -134,12 +469,10 @@ void operator delete(void* p) throw()
 	@return	獲得したメモリーのポインター
  */
 //-----------------------------------------------------------------//
-void* operator new[](std::size_t n) throw()
+void* operator new[](std::size_t n)
 {
-	global_memory_create();
-
-	if(n == 0) n = 1;
-	void* p = ::bxmm_malloc(global_bxmm, n);
+	void* p = global_memory_alloc(n);
+	if(p == nullptr) throw std::bad_alloc();
 	return p;
 }
 
@@ -150,8 +483,44 @@ void* operator new[](std::size_t n) throw()
 	@param[in]	p	開放するメモリーのポインター
  */
 //-----------------------------------------------------------------//
-void operator delete[](void* p) throw()
+void operator delete[](void* p) noexcept
+{
+	global_memory_free(p);
+}
+
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	global_memory_free(p);
+}
+
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	global_memory_free(p);
+}
+
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+	return global_memory_alloc(n);
+}
+
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+	return global_memory_alloc(n);
+}
+
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	global_memory_free(p);
+}
+
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
 {
-	::bxmm_free(global_bxmm, p);
+	global_memory_free(p);
 }
 #endif
@@ -2,21 +2,24 @@
 #define GALLOC_HPP
 //=====================================================================//
 /*!	@file
-	@brief	グローバル・アロケーター（ヘッダー）
-			new, delete, new[], delete[] オペレーターのオーバーロード
-	@author	平松邦仁 (hira@rvf-rc45.net) 
+	@brief	グローバル・アロケーター（ヘッダー） @n
+			サイズ・クラス毎のスラブ・プールと、スレッド毎のキャッシュで @n
+			小さな領域を管理し、大きな領域はシステムの malloc に任せる。@n
+			OPTION_MEMORY_ALOCATE を定義すると、new, delete, new[], delete[] @n
+			オペレーターを置き換える。@n
+			プロファイルを有効にすると、キー（タグ）毎、フレーム毎に @n
+			確保バイト数、確保回数を集計する。
+	@author	平松邦仁 (hira@rvf-rc45.net)
 */
 //=====================================================================//
-#include "bxmm.h"
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
-#ifndef NDEBUG
-void global_check_map();
-#endif
-
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル、記憶ブロックの作成
+	@brief	グローバル、記憶ブロックの作成 @n
+			※管理領域は静的に初期化されるので、呼ばなくても良い。
  */
 //-----------------------------------------------------------------//
 void global_memory_create();
@@ -24,119 +27,104 @@ void global_memory_create();
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル、記憶ブロックの取得
-	@return グローバル記憶ブロック、BXMM 構造体のポインター
+	@brief	グローバル、記憶ブロックの廃棄 @n
+			呼び出したスレッドのキャッシュをプールに戻し、@n
+			プロファイルが有効ならレポートを出力する。
  */
 //-----------------------------------------------------------------//
-BXMM* global_memory_get();
+void global_memory_destroy();
 
-#ifndef NDEBUG
-//-----------------------------------------------------------------//
-/*!
-	@brief	グローバル、記憶ブロックにキー設定
-	@param[in]	key	設定するキー
- */
-//-----------------------------------------------------------------//
-inline void global_memory_setkey(const char* key) {
-	BXMM *bx = global_memory_get();
-	bxmm_push_key(bx);
-	bxmm_set_key(bx, key);
-}
-#endif
 
-#ifndef NDEBUG
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル、記憶ブロックのキーをリストア
+	@brief	メモリーの確保
+	@param[in]	n	確保するサイズ
+	@return	確保したメモリーのポインター（失敗したら nullptr）
  */
 //-----------------------------------------------------------------//
-inline void global_memory_restorekey() {
-	BXMM *bx = global_memory_get();
-	bxmm_pop_key(bx);
-}
-#endif
+void* global_memory_alloc(std::size_t n);
+
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル、記憶ブロックの廃棄
+	@brief	メモリーの開放
+	@param[in]	p	開放するメモリーのポインター（nullptr なら何もしない）
  */
 //-----------------------------------------------------------------//
-void global_memory_destroy();
+void global_memory_free(void* p);
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	記憶管理ブロックを作成する。
-	@param[in]	key		記憶管理テーブルの識別キー
-	@param[in]	size	記憶割り当てブロックのサイズ（バイト）
-	@param[in]	align	記憶管理ブロックの最小アライメントサイズ（バイト）
-	@return	記憶管理テーブル構造体のポインター
+	@brief	確保した領域の実サイズを取得
+	@param[in]	p	メモリーのポインター
+	@return	利用できるサイズ（サイズ・クラスに丸めた値）
  */
 //-----------------------------------------------------------------//
-BXMM *memory_block_create(const char* key, size_t size, size_t align);
+std::size_t global_memory_size(const void* p);
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	記憶管理ブロックを廃棄する。
-	@param[in]	bx		記憶管理テーブル構造体のポインター
+	@brief	プロファイル（キー毎の集計）の許可
+	@param[in]	ena	「false」なら集計しない
  */
 //-----------------------------------------------------------------//
-void memory_block_destroy(BXMM *bx);
+void global_memory_profile(bool ena = true);
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル new オペレーターのオーバーロード
-	@param[in]	n	獲得するサイズ
-	@return	獲得したメモリーのポインター
+	@brief	グローバル、記憶ブロックにキー設定 @n
+			以降、このスレッドの確保はキーに集計される。@n
+			キーはスタックに積まれるので、global_memory_restorekey と組で使う。
+	@param[in]	key	設定するキー（３１文字まで）
  */
 //-----------------------------------------------------------------//
-void* operator new(std::size_t n) throw();
+void global_memory_setkey(const char* key);
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル delete オペレーターのオーバーロード
-	@param[in]	p	開放するメモリーのポインター
+	@brief	グローバル、記憶ブロックのキーをリストア
  */
 //-----------------------------------------------------------------//
-void operator delete(void* p) throw();
+void global_memory_restorekey();
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル new[] オペレーターのオーバーロード
-	@param[in]	n	獲得するサイズ
-	@return	獲得したメモリーのポインター
+	@brief	フレームの区切り @n
+			フレーム内の集計を「前フレーム」に移してクリアする。@n
+			メイン・ループで１フレームに１回呼ぶ。
  */
 //-----------------------------------------------------------------//
-void* operator new[](std::size_t n) throw();
+void global_memory_frame();
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル delete[] オペレーターのオーバーロード
-	@param[in]	p	開放するメモリーのポインター
+	@brief	集計のレポート（キー毎の使用中バイト数、確保回数、@n
+			前フレームの確保回数、バイト数）
+	@param[in]	out	出力先
  */
 //-----------------------------------------------------------------//
-void operator delete[](void* p) throw();
+void global_memory_report(std::ostream& out = std::cout);
 
 
 //-----------------------------------------------------------------//
 /*!
-	@brief	グローバル記憶管理のダミー
+	@brief	グローバル記憶管理の開始、終了（スコープで管理）
  */
 //-----------------------------------------------------------------//
 class galloc {
 public:
-	galloc() {
-		std::cout << "--------------------------------" << std::endl;
-		std::cout << "----- Start, global allocator..." << std::endl;
+	galloc(bool profile = false) {
+		global_memory_create();
+		global_memory_profile(profile);
 	}
 	~galloc() {
-		std::cout << "----- Close, global allocator..." << std::endl;
-		std::cout << "--------------------------------" << std::endl;
+		global_memory_destroy();
 	}
 };
 
@@ -11,6 +11,7 @@
 #include <vector>
 #include <stack>
 #include "utils/vtx.hpp"
+#include "utils/mtx_simd.hpp"
 
 namespace mtx {
 
@@ -117,6 +118,67 @@ namespace mtx {
 	}
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	４×４マトリックス積（float 版、SIMD） @n
+				演算順序はテンプレート版と同じなので、結果は一致する。
+		@param[out]	out		出力マトリックス
+		@param[in]	a		入力マトリックス
+		@param[in]	b		入力マトリックス
+	 */
+	//-----------------------------------------------------------------//
+	template <>
+	inline void matmul4<float>(float* out, const float* a, const float* b) {
+		simd::matmul4(out, a, b);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	４×４マトリックスとベクターの積（float 版、SIMD）
+		@param[out]	out		出力ベクター
+		@param[in]	mat		入力マトリックス
+		@param[in]	vec		入力ベクター
+	 */
+	//-----------------------------------------------------------------//
+	template <>
+	inline void matmul1<float>(float* out, const float* mat, const float* vec) {
+		simd::matmul1(out, mat, vec);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	転置行列を求める（src と dst は同じでも良い）
+		@param[in]	src	ソースのマトリックス
+		@param[out]	dst	転置されたマトリックス
+	 */
+	//-----------------------------------------------------------------//
+	template <class T>
+	void transpose_matrix(const T* src, T* dst) {
+		T t[16];
+		for(uint32_t i = 0; i < 4; ++i) {
+			for(uint32_t j = 0; j < 4; ++j) {
+				prc_(t, i, j) = grc_(src, j, i);
+			}
+		}
+		for(uint32_t i = 0; i < 16; ++i) dst[i] = t[i];
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	転置行列を求める（float 版、SIMD）
+		@param[in]	src	ソースのマトリックス
+		@param[out]	dst	転置されたマトリックス
+	 */
+	//-----------------------------------------------------------------//
+	template <>
+	inline void transpose_matrix<float>(const float* src, float* dst) {
+		simd::transpose(src, dst);
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	OpenGL スケール（拡大／縮小）行列をベースマトリックスに合成する
@@ -561,6 +623,22 @@ namespace mtx {
 	}
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	逆行列を求める（float 版、SIMD の余因子展開） @n
+				テンプレート版（ピボット付き消去法）とは丸め誤差の範囲で一致する。
+		@param[in]	src	ソースのマトリックス
+		@param[in]	dst 計算された逆行列
+		@return	行列式が「０」の場合「false」が返る。
+	 */
+	//-----------------------------------------------------------------//
+	template <>
+	inline bool invert_matrix<float>(const float* src, float* dst)
+	{
+		return simd::invert(src, dst);
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	逆行列を求める（一般解の手法）
@@ -723,6 +801,14 @@ namespace mtx {
 		bool inverse_3d(const T* srcm) { return invert_matrix_3d<T>(srcm, m_); }
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	転置する
+		 */
+		//-----------------------------------------------------------------//
+		void transpose() { transpose_matrix<T>(m_, m_); }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	OpenGL スケーリング
@@ -877,7 +963,7 @@ namespace mtx {
 		//-----------------------------------------------------------------//
 		matrix4<T> operator * (const matrix4<T>& srcm) const {
 			matrix4<T> t;
-			matmul4(t(), m_, srcm.m);
+			matmul4<T>(t.m_, m_, srcm.m_);
 			return t;
 		}
 
@@ -889,7 +975,7 @@ namespace mtx {
 		 */
 		//-----------------------------------------------------------------//
 		matrix4<T>& operator *= (const matrix4<T>& srcm) {
-			matmul4(m_, m_, srcm());
+			matmul4<T>(m_, m_, srcm());
 			return *this;
 		}
 
@@ -900,10 +986,11 @@ namespace mtx {
 			@param[in]	srcv	ソースベクター
 		 */
 		//-----------------------------------------------------------------//
-		matrix4<T> operator * (const vtx::vertex4<T>& srcv) const {
-			matrix4 t;
-			matmul1(t, m_, srcv);
-			return t;
+		vtx::vertex4<T> operator * (const vtx::vertex4<T>& srcv) const {
+			T v[4] = { srcv.x, srcv.y, srcv.z, srcv.w };
+			T o[4];
+			matmul1<T>(o, m_, v);
+			return vtx::vertex4<T>(o[0], o[1], o[2], o[3]);
 		}
 
 
@@ -940,4 +1027,71 @@ namespace mtx {
 	typedef matrix4<float>	fmat4;	///< 「float」型マトリックス
 	typedef matrix4<double>	dmat4;	///< 「double」型マトリックス
 
+
+	static_assert(sizeof(vtx::fvtx) == (sizeof(float) * 3), "vtx::fvtx must be packed xyz");
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	点列を一括変換する（w = 1、src と dst は同じでも良い） @n
+				CPU に合わせて AVX、SSE、スカラーを選ぶ。
+		@param[in]	m	マトリックス
+		@param[in]	src	入力頂点
+		@param[out]	dst	出力頂点
+		@param[in]	num	頂点数
+	 */
+	//-----------------------------------------------------------------//
+	inline void transform_points(const fmat4& m, const vtx::fvtx* src, vtx::fvtx* dst, uint32_t num)
+	{
+		simd::transform_points(m(), &src->x, &dst->x, num);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	点列を一括変換する（w = 1）
+		@param[in]	m	マトリックス
+		@param[in]	src	入力頂点列
+		@param[out]	dst	出力頂点列（大きさは src に合わせる）
+	 */
+	//-----------------------------------------------------------------//
+	inline void transform_points(const fmat4& m, const vtx::fvtxs& src, vtx::fvtxs& dst)
+	{
+		dst.resize(src.size());
+		if(src.empty()) return;
+		transform_points(m, &src[0], &dst[0], src.size());
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	方向（法線）列を一括変換する（w = 0、正規化はしない） @n
+				非一様スケールを含む場合は、逆転置行列を渡す事。
+		@param[in]	m	マトリックス
+		@param[in]	src	入力ベクトル
+		@param[out]	dst	出力ベクトル
+		@param[in]	num	ベクトル数
+	 */
+	//-----------------------------------------------------------------//
+	inline void transform_normals(const fmat4& m, const vtx::fvtx* src, vtx::fvtx* dst, uint32_t num)
+	{
+		simd::transform_normals(m(), &src->x, &dst->x, num);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	方向（法線）列を一括変換する（w = 0、正規化はしない）
+		@param[in]	m	マトリックス
+		@param[in]	src	入力ベクトル列
+		@param[out]	dst	出力ベクトル列（大きさは src に合わせる）
+	 */
+	//-----------------------------------------------------------------//
+	inline void transform_normals(const fmat4& m, const vtx::fvtxs& src, vtx::fvtxs& dst)
+	{
+		dst.resize(src.size());
+		if(src.empty()) return;
+		transform_normals(m, &src[0], &dst[0], src.size());
+	}
+
 }
@@ -0,0 +1,500 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	float ４×４マトリックスの SIMD 演算 @n
+			SSE が使える場合、積、逆行列、転置、ベクトル変換を SSE で行う。@n
+			頂点列の一括変換は、実行時に CPU を調べて AVX、SSE、スカラーを @n
+			切り替える。（積と変換は、スカラー版と同じ演算順序なので結果は一致する）
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#include <cstddef>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MTX_SIMD_SSE
+#endif
+#if defined(MTX_SIMD_SSE) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MTX_SIMD_AVX
+#define MTX_SIMD_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+namespace mtx {
+namespace simd {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	SIMD レベル
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	enum class level {
+		none,	///< スカラー
+		sse,	///< SSE
+		avx,	///< AVX
+	};
+
+
+	static inline level detect_level_() {
+#if defined(MTX_SIMD_AVX)
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx")) return level::avx;
+		return level::sse;
+#elif defined(MTX_SIMD_SSE)
+		return level::sse;
+#else
+		return level::none;
+#endif
+	}
+
+	static inline level& level_ref_() {
+		static level lvl = detect_level_();
+		return lvl;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	一括変換で使う SIMD レベルを取得
+		@return SIMD レベル
+	*/
+	//-----------------------------------------------------------------//
+	inline level get_level() { return level_ref_(); }
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	一括変換で使う SIMD レベルを設定（検査、計測用） @n
+				CPU が対応していないレベルは、対応する最大のレベルになる。
+		@param[in]	lvl	SIMD レベル
+	*/
+	//-----------------------------------------------------------------//
+	inline void set_level(level lvl) {
+		level max = detect_level_();
+		level_ref_() = static_cast<int>(lvl) > static_cast<int>(max) ? max : lvl;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	４×４マトリックス積（out = a * b、out と a、b は重なっても良い）
+		@param[out]	out	出力
+		@param[in]	a	入力
+		@param[in]	b	入力
+	*/
+	//-----------------------------------------------------------------//
+	inline void matmul4(float* out, const float* a, const float* b) {
+#ifdef MTX_SIMD_SSE
+		__m128 a0 = _mm_loadu_ps(a +  0);
+		__m128 a1 = _mm_loadu_ps(a +  4);
+		__m128 a2 = _mm_loadu_ps(a +  8);
+		__m128 a3 = _mm_loadu_ps(a + 12);
+		__m128 r[4];
+		for(int j = 0; j < 4; ++j) {
+			const float* bj = b + j * 4;
+			__m128 t = _mm_mul_ps(a0, _mm_set1_ps(bj[0]));
+			t = _mm_add_ps(t, _mm_mul_ps(a1, _mm_set1_ps(bj[1])));
+			t = _mm_add_ps(t, _mm_mul_ps(a2, _mm_set1_ps(bj[2])));
+			r[j] = _mm_add_ps(t, _mm_mul_ps(a3, _mm_set1_ps(bj[3])));
+		}
+		_mm_storeu_ps(out +  0, r[0]);
+		_mm_storeu_ps(out +  4, r[1]);
+		_mm_storeu_ps(out +  8, r[2]);
+		_mm_storeu_ps(out + 12, r[3]);
+#else
+		float r[16];
+		for(int j = 0; j < 4; ++j) {
+			for(int i = 0; i < 4; ++i) {
+				r[j * 4 + i] = a[i] * b[j * 4] + a[4 + i] * b[j * 4 + 1]
+					+ a[8 + i] * b[j * 4 + 2] + a[12 + i] * b[j * 4 + 3];
+			}
+		}
+		for(int i = 0; i < 16; ++i) out[i] = r[i];
+#endif
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	４×４マトリックスとベクトルの積
+		@param[out]	out	出力（４要素）
+		@param[in]	m	マトリックス
+		@param[in]	v	ベクトル（４要素）
+	*/
+	//-----------------------------------------------------------------//
+	inline void matmul1(float* out, const float* m, const float* v) {
+#ifdef MTX_SIMD_SSE
+		__m128 t = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(v[0]));
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(m +  4), _mm_set1_ps(v[1])));
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(m +  8), _mm_set1_ps(v[2])));
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(v[3])));
+		_mm_storeu_ps(out, t);
+#else
+		float r[4];
+		for(int i = 0; i < 4; ++i) {
+			r[i] = m[i] * v[0] + m[4 + i] * v[1] + m[8 + i] * v[2] + m[12 + i] * v[3];
+		}
+		for(int i = 0; i < 4; ++i) out[i] = r[i];
+#endif
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	転置（src と dst は重なっても良い）
+		@param[in]	src	入力
+		@param[out]	dst	出力
+	*/
+	//-----------------------------------------------------------------//
+	inline void transpose(const float* src, float* dst) {
+#ifdef MTX_SIMD_SSE
+		__m128 r0 = _mm_loadu_ps(src +  0);
+		__m128 r1 = _mm_loadu_ps(src +  4);
+		__m128 r2 = _mm_loadu_ps(src +  8);
+		__m128 r3 = _mm_loadu_ps(src + 12);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(dst +  0, r0);
+		_mm_storeu_ps(dst +  4, r1);
+		_mm_storeu_ps(dst +  8, r2);
+		_mm_storeu_ps(dst + 12, r3);
+#else
+		float r[16];
+		for(int i = 0; i < 4; ++i) {
+			for(int j = 0; j < 4; ++j) r[j * 4 + i] = src[i * 4 + j];
+		}
+		for(int i = 0; i < 16; ++i) dst[i] = r[i];
+#endif
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	逆行列（余因子展開、src と dst は重なっても良い） @n
+				ガウスの消去法のスカラー版とは、丸め誤差の範囲で一致する。
+		@param[in]	src	入力
+		@param[out]	dst	出力
+		@return 行列式が「０」の場合「false」（dst は変更しない）
+	*/
+	//-----------------------------------------------------------------//
+	inline bool invert(const float* src, float* dst) {
+#ifdef MTX_SIMD_SSE
+		__m128 minor0, minor1, minor2, minor3;
+		__m128 row0, row1, row2, row3;
+		__m128 det, tmp1;
+		__m128 z = _mm_setzero_ps();
+
+		// 転置しながら読み込む
+		tmp1 = _mm_loadh_pi(_mm_loadl_pi(z, reinterpret_cast<const __m64*>(src)),
+			reinterpret_cast<const __m64*>(src + 4));
+		row1 = _mm_loadh_pi(_mm_loadl_pi(z, reinterpret_cast<const __m64*>(src + 8)),
+			reinterpret_cast<const __m64*>(src + 12));
+		row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
+		row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
+		tmp1 = _mm_loadh_pi(_mm_loadl_pi(z, reinterpret_cast<const __m64*>(src + 2)),
+			reinterpret_cast<const __m64*>(src + 6));
+		row3 = _mm_loadh_pi(_mm_loadl_pi(z, reinterpret_cast<const __m64*>(src + 10)),
+			reinterpret_cast<const __m64*>(src + 14));
+		row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
+		row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
+
+		tmp1 = _mm_mul_ps(row2, row3);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor0 = _mm_mul_ps(row1, tmp1);
+		minor1 = _mm_mul_ps(row0, tmp1);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp1), minor0);
+		minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor1);
+		minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+
+		tmp1 = _mm_mul_ps(row1, row2);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor0);
+		minor3 = _mm_mul_ps(row0, tmp1);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp1));
+		minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor3);
+		minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+
+		tmp1 = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		row2 = _mm_shuffle_ps(row2, row2, 0x4E);
+		minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor0);
+		minor2 = _mm_mul_ps(row0, tmp1);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp1));
+		minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor2);
+		minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+
+		tmp1 = _mm_mul_ps(row0, row1);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor2);
+		minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp1), minor3);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp1), minor2);
+		minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp1));
+
+		tmp1 = _mm_mul_ps(row0, row3);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp1));
+		minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor2);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor1);
+		minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp1));
+
+		tmp1 = _mm_mul_ps(row0, row2);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor1);
+		minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp1));
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp1));
+		minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor3);
+
+		det = _mm_mul_ps(row0, minor0);
+		det = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+		det = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
+		if(_mm_cvtss_f32(det) == 0.0f) return false;
+		det = _mm_div_ss(_mm_set_ss(1.0f), det);
+		det = _mm_shuffle_ps(det, det, 0x00);
+
+		_mm_storeu_ps(dst +  0, _mm_mul_ps(det, minor0));
+		_mm_storeu_ps(dst +  4, _mm_mul_ps(det, minor1));
+		_mm_storeu_ps(dst +  8, _mm_mul_ps(det, minor2));
+		_mm_storeu_ps(dst + 12, _mm_mul_ps(det, minor3));
+		return true;
+#else
+		const float* m = src;
+		float inv[16];
+		inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+		inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+		inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+		inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+		inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+		inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+		inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+		inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+		inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+		inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+		inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+		inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+		inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+		inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+		inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+		inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+		float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+		if(det == 0.0f) return false;
+		det = 1.0f / det;
+		for(int i = 0; i < 16; ++i) dst[i] = inv[i] * det;
+		return true;
+#endif
+	}
+
+
+	//=================================================================//
+	// 頂点列の一括変換（xyz が 12 バイト間隔で並んでいる事）
+	//=================================================================//
+
+	// w = 1 の点（アフィン変換、w 行は使わない）
+	static inline void transform_points_scalar_(const float* m, const float* src, float* dst, size_t num)
+	{
+		for(size_t i = 0; i < num; ++i) {
+			float x = src[i * 3 + 0];
+			float y = src[i * 3 + 1];
+			float z = src[i * 3 + 2];
+			dst[i * 3 + 0] = m[0] * x + m[4] * y + m[ 8] * z + m[12];
+			dst[i * 3 + 1] = m[1] * x + m[5] * y + m[ 9] * z + m[13];
+			dst[i * 3 + 2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+		}
+	}
+
+	// w = 0 の方向（上位 3x3 のみ）
+	static inline void transform_normals_scalar_(const float* m, const float* src, float* dst, size_t num)
+	{
+		for(size_t i = 0; i < num; ++i) {
+			float x = src[i * 3 + 0];
+			float y = src[i * 3 + 1];
+			float z = src[i * 3 + 2];
+			dst[i * 3 + 0] = m[0] * x + m[4] * y + m[ 8] * z;
+			dst[i * 3 + 1] = m[1] * x + m[5] * y + m[ 9] * z;
+			dst[i * 3 + 2] = m[2] * x + m[6] * y + m[10] * z;
+		}
+	}
+
+
+#ifdef MTX_SIMD_SSE
+	// ４点分の xyz（AoS）を SoA に展開
+	static inline void load_soa_(const float* p, __m128& x, __m128& y, __m128& z)
+	{
+		__m128 a = _mm_loadu_ps(p + 0);		// x0 y0 z0 x1
+		__m128 b = _mm_loadu_ps(p + 4);		// y1 z1 x2 y2
+		__m128 c = _mm_loadu_ps(p + 8);		// z2 x3 y3 z3
+		__m128 xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+		__m128 yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+		x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+
+	// SoA を４点分の xyz（AoS）へ戻す
+	static inline void store_soa_(float* p, __m128 x, __m128 y, __m128 z)
+	{
+		__m128 xy01 = _mm_unpacklo_ps(x, y);
+		__m128 xy23 = _mm_unpackhi_ps(x, y);
+		__m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+		__m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+		__m128 zx3 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+		__m128 yz3 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+		_mm_storeu_ps(p + 0, _mm_shuffle_ps(xy01, zx, _MM_SHUFFLE(2, 0, 1, 0)));
+		_mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+		_mm_storeu_ps(p + 8, _mm_shuffle_ps(zx3, yz3, _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+
+	template <bool POINT>
+	static inline void transform_sse_(const float* m, const float* src, float* dst, size_t num)
+	{
+		__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+		__m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+		__m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+		__m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+		size_t n4 = num & ~static_cast<size_t>(3);
+		for(size_t i = 0; i < n4; i += 4) {
+			__m128 x, y, z;
+			load_soa_(src + i * 3, x, y, z);
+			__m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_mul_ps(m8, z));
+			__m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_mul_ps(m9, z));
+			__m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_mul_ps(m10, z));
+			if(POINT) {
+				ox = _mm_add_ps(ox, m12);
+				oy = _mm_add_ps(oy, m13);
+				oz = _mm_add_ps(oz, m14);
+			}
+			store_soa_(dst + i * 3, ox, oy, oz);
+		}
+		if(POINT) transform_points_scalar_(m, src + n4 * 3, dst + n4 * 3, num - n4);
+		else transform_normals_scalar_(m, src + n4 * 3, dst + n4 * 3, num - n4);
+	}
+#endif
+
+
+#ifdef MTX_SIMD_AVX
+	// ８点分（各レーン４点）の xyz を SoA に展開
+	MTX_SIMD_TARGET_AVX
+	static inline void load_soa_avx_(const float* p, __m256& x, __m256& y, __m256& z)
+	{
+		__m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 0)), _mm_loadu_ps(p + 12), 1);
+		__m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+		__m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+		__m256 xy = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+		__m256 yz = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+		x = _mm256_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		z = _mm256_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+
+	MTX_SIMD_TARGET_AVX
+	static inline void store_soa_avx_(float* p, __m256 x, __m256 y, __m256 z)
+	{
+		__m256 xy01 = _mm256_unpacklo_ps(x, y);
+		__m256 xy23 = _mm256_unpackhi_ps(x, y);
+		__m256 zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+		__m256 yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+		__m256 zx3 = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+		__m256 yz3 = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+		__m256 a = _mm256_shuffle_ps(xy01, zx, _MM_SHUFFLE(2, 0, 1, 0));
+		__m256 b = _mm256_shuffle_ps(yz, xy23, _MM_SHUFFLE(1, 0, 2, 0));
+		__m256 c = _mm256_shuffle_ps(zx3, yz3, _MM_SHUFFLE(2, 0, 2, 0));
+		_mm_storeu_ps(p +  0, _mm256_castps256_ps128(a));
+		_mm_storeu_ps(p +  4, _mm256_castps256_ps128(b));
+		_mm_storeu_ps(p +  8, _mm256_castps256_ps128(c));
+		_mm_storeu_ps(p + 12, _mm256_extractf128_ps(a, 1));
+		_mm_storeu_ps(p + 16, _mm256_extractf128_ps(b, 1));
+		_mm_storeu_ps(p + 20, _mm256_extractf128_ps(c, 1));
+	}
+
+	template <bool POINT>
+	MTX_SIMD_TARGET_AVX
+	static void transform_avx_(const float* m, const float* src, float* dst, size_t num)
+	{
+		__m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+		__m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]);
+		__m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]);
+		__m256 m12 = _mm256_set1_ps(m[12]), m13 = _mm256_set1_ps(m[13]), m14 = _mm256_set1_ps(m[14]);
+		size_t n8 = num & ~static_cast<size_t>(7);
+		for(size_t i = 0; i < n8; i += 8) {
+			__m256 x, y, z;
+			load_soa_avx_(src + i * 3, x, y, z);
+			__m256 ox = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, x), _mm256_mul_ps(m4, y)), _mm256_mul_ps(m8, z));
+			__m256 oy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1, x), _mm256_mul_ps(m5, y)), _mm256_mul_ps(m9, z));
+			__m256 oz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m2, x), _mm256_mul_ps(m6, y)), _mm256_mul_ps(m10, z));
+			if(POINT) {
+				ox = _mm256_add_ps(ox, m12);
+				oy = _mm256_add_ps(oy, m13);
+				oz = _mm256_add_ps(oz, m14);
+			}
+			store_soa_avx_(dst + i * 3, ox, oy, oz);
+		}
+		transform_sse_<POINT>(m, src + n8 * 3, dst + n8 * 3, num - n8);
+	}
+#endif
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	点列の一括変換（w = 1、src と dst は同じでも良い）
+		@param[in]	m	マトリックス
+		@param[in]	src	入力（x, y, z の並び）
+		@param[out]	dst	出力（x, y, z の並び）
+		@param[in]	num	点数
+	*/
+	//-----------------------------------------------------------------//
+	inline void transform_points(const float* m, const float* src, float* dst, size_t num)
+	{
+		switch(get_level()) {
+#ifdef MTX_SIMD_AVX
+		case level::avx:
+			transform_avx_<true>(m, src, dst, num);
+			break;
+#endif
+#ifdef MTX_SIMD_SSE
+		case level::sse:
+			transform_sse_<true>(m, src, dst, num);
+			break;
+#endif
+		default:
+			transform_points_scalar_(m, src, dst, num);
+			break;
+		}
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	方向（法線）列の一括変換（w = 0、正規化はしない）
+		@param[in]	m	マトリックス（法線なら逆転置行列を渡す事）
+		@param[in]	src	入力（x, y, z の並び）
+		@param[out]	dst	出力（x, y, z の並び）
+		@param[in]	num	ベクトル数
+	*/
+	//-----------------------------------------------------------------//
+	inline void transform_normals(const float* m, const float* src, float* dst, size_t num)
+	{
+		switch(get_level()) {
+#ifdef MTX_SIMD_AVX
+		case level::avx:
+			transform_avx_<false>(m, src, dst, num);
+			break;
+#endif
+#ifdef MTX_SIMD_SSE
+		case level::sse:
+			transform_sse_<false>(m, src, dst, num);
+			break;
+#endif
+		default:
+			transform_normals_scalar_(m, src, dst, num);
+			break;
+		}
+	}
+}
+}
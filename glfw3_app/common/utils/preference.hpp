@@ -3,9 +3,17 @@
 /*!	@file
 	@brief	プリファレンス・クラス @n
 			・アプリケーションの状態を記録する（Maybe レジストリー）@n
-			・テキストファイルとして記録されるので汎用性が高い @n
 			・文字列（キー）に対応する値（整数、実数、文字列）をファイル @n
-			セーブ、ロードする場合に利用する。
+			セーブ、ロードする場合に利用する。@n
+			・キーはフル・パスの 64 ビット・ハッシュで索引され、@n
+			パス文字列は、新しいキーを登録する時だけ作られる。@n
+			・ファイルはバイナリーの追記ログで、ロード時はマップして @n
+			読み、セーブ時は変更されたアイテムだけを追記する。@n
+			ログが大きくなったら、生きているアイテムだけに詰め直す。@n
+			・ハッシュが衝突しても、キーの文字列を比べて区別する。@n
+			・バイナリーのログは、拡張子を「.prb」にしたファイルに置く。@n
+			テキスト形式のファイル（.pre）はロードで取り込み、上書きしない。@n
+			save_text で書き出しも出来る。
     @author 平松邦仁 (hira@rvf-rc45.net)
 	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
 				Released under the MIT license @n
@@ -14,7 +22,12 @@
 //=====================================================================//
 #include <string>
 #include <stack>
-#include <map>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <boost/unordered_map.hpp>
+#include "utils/string_utils.hpp"
 #include "utils/vtx.hpp"
 #include "utils/file_io.hpp"
 #include <boost/format.hpp>
@@ -43,21 +56,135 @@ namespace sys {
 			boolean,
 		};
 
+		typedef uint64_t	key_type;	///< フル・パスのハッシュ
+
 	private:
+		static const uint32_t file_magic_ = 0x31465250;	///< "PRF1"
+		static const uint8_t  erase_mark_ = 0xff;		///< 消去レコード
+		static const uint32_t head_size_ = 16;
+		static const uint32_t rec_size_ = 16;			///< レコード・ヘッダーのサイズ
+		static const uint16_t key_max_ = 0xffff;		///< キーの最大長
+
 		struct value_t {
 			vtype			vtype_;
-			std::string		value_;
-			value_t() { }
-			explicit value_t(vtype t, const std::string& v) : vtype_(t), value_(v) { }
+			union {
+				int32_t		i_[2];
+				float		f_[2];
+			};
+			std::string		text_;
+			value_t() : vtype_(vtype::invalid), text_() { i_[0] = 0; i_[1] = 0; }
 		};
 
-		typedef std::map<std::string, value_t>	item_map;
-		typedef std::pair<item_map::iterator, bool>  item_ret;
+		struct item_t {
+			value_t		v_;
+			std::string	key_;		///< フル・パス（ログにある場合は空）
+			uint32_t	ofs_;		///< ログ上のレコード位置（無い場合「０」）
+			bool		vlog_;		///< テキストの値がログ上にある
+			bool		dirty_;
+			item_t() : v_(), key_(), ofs_(0), vlog_(false), dirty_(false) { }
+		};
+
+		// ハッシュが衝突したキーは、同じハッシュで並ぶ
+		typedef boost::unordered_multimap<key_type, item_t>	item_map;
 		item_map					map_;
 
+		// キーの参照（最大３つの断片を繋げたもの、比較時に空白は「_」として扱う）
+		struct key_ref {
+			key_type	hash_;
+			const char*	s_[3];
+			size_t		n_[3];
+			key_ref() : hash_(0) {
+				for(int i = 0; i < 3; ++i) { s_[i] = ""; n_[i] = 0; }
+			}
+			size_t size() const { return n_[0] + n_[1] + n_[2]; }
+		};
+
 		std::string					path_;
+		key_type					path_hash_;
 		std::stack<std::string>		stack_path_;
 
+		// ログ・ファイル
+		std::string			file_;		///< 結び付いているファイル
+		utils::file_io		fmap_;
+		const char*			top_;		///< マップした領域
+		uint32_t			log_size_;	///< ログのサイズ
+		uint32_t			live_size_;	///< 生きているレコードのサイズ
+		std::vector<item_map::value_type*>	dirty_;	///< 変更されたアイテム
+		std::vector<std::pair<key_type, std::string> >	erased_;
+
+		static const key_type hash_init_ = 14695981039346656037ULL;
+
+		// FNV-1a（空白は「_」として扱う）
+		static key_type hash_add_(key_type h, const char* s, size_t n) {
+			for(size_t i = 0; i < n; ++i) {
+				char ch = s[i];
+				if(ch == ' ') ch = '_';
+				h ^= static_cast<uint8_t>(ch);
+				h *= 1099511628211ULL;
+			}
+			return h;
+		}
+
+		key_type hash_(const char* name, size_t n) const {
+			if(n > 0 && name[0] == '/') return hash_add_(hash_init_, name, n);
+			return hash_add_(path_hash_, name, n);
+		}
+
+		key_type hash_(const std::string& name) const {
+			return hash_(name.c_str(), name.size());
+		}
+
+
+		// カレント・パスを適用したキーの参照
+		key_ref ref_(const std::string& name) const {
+			key_ref k;
+			k.hash_ = hash_(name);
+			if(name.empty() || name[0] != '/') {
+				k.s_[0] = path_.c_str();
+				k.n_[0] = path_.size();
+			}
+			k.s_[1] = name.c_str();
+			k.n_[1] = name.size();
+			return k;
+		}
+
+
+		// フル・パス（変換済み）の base に続く「/leaf」の参照
+		static key_ref ref_(const std::string& base, key_type base_hash, const char* leaf) {
+			key_ref k;
+			k.hash_ = leaf_hash_(base_hash, leaf);
+			k.s_[0] = base.c_str();
+			k.n_[0] = base.size();
+			k.s_[1] = "/";
+			k.n_[1] = 1;
+			k.s_[2] = leaf;
+			k.n_[2] = std::strlen(leaf);
+			return k;
+		}
+
+
+		// ログのレコードにある（変換済みの）キーの参照
+		static key_ref ref_(key_type h, const char* key, size_t n) {
+			key_ref k;
+			k.hash_ = h;
+			k.s_[0] = key;
+			k.n_[0] = n;
+			return k;
+		}
+
+
+		static void key_string_(const key_ref& k, std::string& out) {
+			out.clear();
+			out.reserve(k.size());
+			for(int i = 0; i < 3; ++i) {
+				for(size_t j = 0; j < k.n_[i]; ++j) {
+					char ch = k.s_[i][j];
+					out += ch == ' ' ? '_' : ch;
+				}
+			}
+		}
+
+
 		void get_full_path_(const std::string& name, std::string& out) const
 		{
 			if(name.empty()) return;
@@ -101,59 +228,514 @@ namespace sys {
 		}
 
 
+		static uint32_t value_size_(const value_t& v) {
+			switch(v.vtype_) {
+			case vtype::int32:
+			case vtype::float32:
+				return 4;
+			case vtype::boolean:
+				return 1;
+			case vtype::position_int32:
+			case vtype::position_float32:
+				return 8;
+			case vtype::text:
+				return v.text_.size();
+			default:
+				return 0;
+			}
+		}
+
+
+		// レコード・ヘッダー：hash(8), key_len(2), vtype(1), pad(1), val_len(4)
+		struct rec_t {
+			key_type	hash_;
+			uint16_t	klen_;
+			uint8_t		type_;
+			uint8_t		pad_;
+			uint32_t	vlen_;
+		};
+
+
+		uint32_t rec_size_of_(const item_t& it) const {
+			if(it.vlog_) {
+				rec_t r;
+				std::memcpy(&r, top_ + it.ofs_, sizeof(r));
+				return rec_size_ + r.klen_ + r.vlen_;
+			}
+			return rec_size_ + key_len_(it) + value_size_(it.v_);
+		}
+
+
+		uint32_t key_len_(const item_t& it) const {
+			if(it.ofs_ != 0) {
+				rec_t r;
+				std::memcpy(&r, top_ + it.ofs_, sizeof(r));
+				return r.klen_;
+			}
+			return it.key_.size();
+		}
+
+
+		const char* key_ptr_(const item_t& it) const {
+			if(it.ofs_ != 0) return top_ + it.ofs_ + rec_size_;
+			return it.key_.c_str();
+		}
+
+
+		std::string key_of_(const item_t& it) const {
+			return std::string(key_ptr_(it), key_len_(it));
+		}
+
+
+		bool key_eq_(const item_t& it, const key_ref& k) const {
+			if(key_len_(it) != k.size()) return false;
+			const char* p = key_ptr_(it);
+			for(int i = 0; i < 3; ++i) {
+				for(size_t j = 0; j < k.n_[i]; ++j) {
+					char ch = k.s_[i][j];
+					if(ch == ' ') ch = '_';
+					if(*p++ != ch) return false;
+				}
+			}
+			return true;
+		}
+
+
+		// テキストがログ上にある場合、ログから読む
+		void get_text_(const item_t& it, std::string& out) const {
+			if(it.vlog_) {
+				rec_t r;
+				std::memcpy(&r, top_ + it.ofs_, sizeof(r));
+				out.assign(top_ + it.ofs_ + rec_size_ + r.klen_, r.vlen_);
+			} else {
+				out = it.v_.text_;
+			}
+		}
+
+
+		void write_rec_(std::vector<char>& out, key_type h, const char* key, uint16_t klen, const value_t* v) const {
+			rec_t r;
+			r.hash_ = h;
+			r.klen_ = klen;
+			r.type_ = v != nullptr ? static_cast<uint8_t>(v->vtype_) : erase_mark_;
+			r.pad_ = 0;
+			r.vlen_ = v != nullptr ? value_size_(*v) : 0;
+			size_t pos = out.size();
+			out.resize(pos + rec_size_ + klen + r.vlen_);
+			char* p = &out[pos];
+			std::memcpy(p, &r, sizeof(r));
+			p += rec_size_;
+			if(klen > 0) std::memcpy(p, key, klen);
+			p += klen;
+			if(v == nullptr) return;
+			switch(v->vtype_) {
+			case vtype::boolean:
+				*p = v->i_[0] != 0;
+				break;
+			case vtype::text:
+				if(r.vlen_ > 0) std::memcpy(p, v->text_.data(), r.vlen_);
+				break;
+			default:
+				std::memcpy(p, v->i_, r.vlen_);
+				break;
+			}
+		}
+
+
+		void close_map_() {
+			if(top_ != nullptr) {
+				// マップが無くなるので、ログを参照しているキーとテキストを取り込む
+				for(auto& t : map_) {
+					item_t& it = t.second;
+					if(it.ofs_ == 0) continue;
+					if(it.vlog_) get_text_(it, it.v_.text_);
+					it.key_ = key_of_(it);
+					it.ofs_ = 0;
+					it.vlog_ = false;
+				}
+			}
+			fmap_.close();
+			top_ = nullptr;
+		}
+
+
+		bool map_log_(const std::string& filename) {
+			if(!fmap_.open_map(filename)) return false;
+			size_t sz = fmap_.get_file_size();
+			const char* top = static_cast<const char*>(fmap_.get_span());
+			std::vector<char> tmp;
+			if(top == nullptr) {  // マップ出来ない環境
+				tmp.resize(sz);
+				if(sz > 0 && fmap_.read(&tmp[0], sz) != sz) {
+					fmap_.close();
+					return false;
+				}
+				top = tmp.data();
+			}
+			uint32_t magic = 0;
+			if(sz >= head_size_) std::memcpy(&magic, top, 4);
+			if(magic != file_magic_ || top == tmp.data()) {
+				fmap_.close();
+				if(magic == file_magic_) {  // マップ出来ない場合は、全て取り込む
+					log_size_ = scan_log_(top, sz, true);
+					return true;
+				}
+				return false;
+			}
+			top_ = top;
+			log_size_ = scan_log_(top, sz, false);
+			return true;
+		}
+
+
+		// ログを走査して、索引を作る（後のレコードが優先）
+		uint32_t scan_log_(const char* top, size_t sz, bool copy) {
+			size_t pos = head_size_;
+			while((pos + rec_size_) <= sz) {
+				rec_t r;
+				std::memcpy(&r, top + pos, sizeof(r));
+				size_t len = rec_size_ + r.klen_ + r.vlen_;
+				if((pos + len) > sz) break;  // 途中で切れたレコード
+				key_ref k = ref_(r.hash_, top + pos + rec_size_, r.klen_);
+				if(r.type_ == erase_mark_) {
+					auto f = find_it_(k);
+					if(f != map_.end()) {
+						live_size_ -= rec_size_of_(f->second);
+						map_.erase(f);
+					}
+				} else {
+					item_t* p = find_(k);
+					if(p == nullptr) {
+						p = &map_.emplace(r.hash_, item_t())->second;
+					} else {
+						live_size_ -= rec_size_of_(*p);
+					}
+					item_t& it = *p;
+					it.dirty_ = false;
+					it.v_.vtype_ = static_cast<vtype>(r.type_);
+					it.v_.text_.clear();
+					it.vlog_ = false;
+					const char* v = top + pos + rec_size_ + r.klen_;
+					if(it.v_.vtype_ == vtype::boolean) {
+						it.v_.i_[0] = *v != 0;
+					} else if(it.v_.vtype_ == vtype::text) {
+						if(copy) it.v_.text_.assign(v, r.vlen_);
+					} else {
+						std::memcpy(it.v_.i_, v, std::min(r.vlen_, static_cast<uint32_t>(sizeof(it.v_.i_))));
+					}
+					if(copy) {
+						it.key_.assign(top + pos + rec_size_, r.klen_);
+						it.ofs_ = 0;
+					} else {
+						it.key_.clear();
+						it.ofs_ = pos;
+						it.vlog_ = it.v_.vtype_ == vtype::text;
+					}
+					live_size_ += len;
+				}
+				pos += len;
+			}
+			return pos;
+		}
+
+
+		// 同じハッシュのアイテムから、キーが一致するものを探す
+		item_map::iterator find_it_(const key_ref& k) {
+			auto range = map_.equal_range(k.hash_);
+			for(auto it = range.first; it != range.second; ++it) {
+				if(key_eq_(it->second, k)) return it;
+			}
+			return map_.end();
+		}
+
+
+		item_t* find_(const key_ref& k) {
+			auto it = find_it_(k);
+			if(it == map_.end()) return nullptr;
+			return &it->second;
+		}
+
+
+		const item_t* find_(const key_ref& k) const {
+			auto range = map_.equal_range(k.hash_);
+			for(auto it = range.first; it != range.second; ++it) {
+				if(key_eq_(it->second, k)) return &it->second;
+			}
+			return nullptr;
+		}
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	アイテムを追加
-			@param[in]	key	キーワード
+			@param[in]	k	キーの参照
 			@param[in]	vt	値の構造体
 			@return 追加されれば「true」
 		*/
 		//-----------------------------------------------------------------//
-		bool put_(const std::string& key, const value_t& vt)
+		bool put_(const key_ref& k, const value_t& vt)
 		{
-			std::string s;
-			get_full_path_(key, s);
-			item_map::iterator it = map_.find(s);
-			if(it == map_.end()) {
-				item_map::value_type pa(s, vt);
-				item_ret r = map_.insert(pa);
-				return r.second;
+			if(k.size() > key_max_) return false;
+			auto t = find_it_(k);
+			if(t == map_.end()) {  // 新しいキーだけ、パスを作る
+				t = map_.emplace(k.hash_, item_t());
+				key_string_(k, t->second.key_);
 			} else {
-				it->second = vt;
-				return true;
+				live_size_ -= rec_size_of_(t->second);
+			}
+			item_t& it = t->second;
+			it.v_ = vt;
+			it.vlog_ = false;
+			live_size_ += rec_size_of_(it);
+			if(!it.dirty_) {
+				it.dirty_ = true;
+				dirty_.push_back(&*t);
 			}
+			return true;
 		}
 
 
-		//-----------------------------------------------------------------//
-		/*!
-			@brief	アイテムを取得
-			@param[in]	key	キーワード
-			@param[in]	vt	値の構造体
-			@return 取得されれば「true」
-		*/
-		//-----------------------------------------------------------------//
-		bool get_(const std::string& key, value_t& vt) const
+		bool put_(const std::string& key, const value_t& vt)
 		{
-			std::string s;
-			get_full_path_(key, s);
-			item_map::const_iterator cit = map_.find(s);
-			if(cit == map_.end()) {
+			if(key.empty()) return false;
+			return put_(ref_(key), vt);
+		}
+
+
+		bool get_(const key_ref& k, vtype t, value_t& vt) const
+		{
+			const item_t* it = find_(k);
+			if(it == nullptr || it->v_.vtype_ != t) return false;
+			vt.vtype_ = it->v_.vtype_;
+			vt.i_[0] = it->v_.i_[0];
+			vt.i_[1] = it->v_.i_[1];
+			if(t == vtype::text) get_text_(*it, vt.text_);
+			return true;
+		}
+
+
+		static key_type leaf_hash_(key_type base, const char* leaf) {
+			return hash_add_(hash_add_(base, "/", 1), leaf, std::strlen(leaf));
+		}
+
+
+		static value_t make_(vtype t, int32_t a, int32_t b = 0) {
+			value_t v;
+			v.vtype_ = t;
+			v.i_[0] = a;
+			v.i_[1] = b;
+			return v;
+		}
+
+
+		static value_t make_(vtype t, float a, float b) {
+			value_t v;
+			v.vtype_ = t;
+			v.f_[0] = a;
+			v.f_[1] = b;
+			return v;
+		}
+
+
+		static value_t make_(const std::string& s) {
+			value_t v;
+			v.vtype_ = vtype::text;
+			v.text_ = s;
+			return v;
+		}
+
+
+		bool write_all_(const std::string& filename) {
+			std::string tmp = filename + ".tmp";
+			utils::file_io fo;
+			if(!fo.open(tmp, "wb")) return false;
+
+			// 大きな領域を確保しないように、小分けにして書き出す
+			std::vector<char> out;
+			out.reserve(64 * 1024 + 1024);
+			out.resize(head_size_, 0);
+			std::memcpy(&out[0], &file_magic_, 4);
+			uint32_t ver = 1;
+			std::memcpy(&out[4], &ver, 4);
+			uint32_t pos = 0;
+			bool err = false;
+			std::vector<uint32_t> ofs;
+			ofs.reserve(map_.size());
+			for(auto& t : map_) {
+				item_t& it = t.second;
+				ofs.push_back(pos + out.size());
+				if(it.vlog_) {
+					value_t v = it.v_;
+					get_text_(it, v.text_);
+					write_rec_(out, t.first, key_ptr_(it), key_len_(it), &v);
+				} else {
+					write_rec_(out, t.first, key_ptr_(it), key_len_(it), &it.v_);
+				}
+				it.dirty_ = false;
+				if(out.size() >= (64 * 1024)) {
+					if(fo.write(out.data(), out.size()) != out.size()) err = true;
+					pos += out.size();
+					out.clear();
+				}
+			}
+			if(!out.empty()) {
+				if(fo.write(out.data(), out.size()) != out.size()) err = true;
+				pos += out.size();
+			}
+			fo.close();
+			if(err) {
+				utils::remove_file(tmp);
 				return false;
+			}
+
+			// 置き換える前に、マップを閉じる（Windows では、マップ中は消せない）
+			close_map_();
+			utils::remove_file(filename);
+			if(std::rename(tmp.c_str(), filename.c_str()) != 0) return false;
+
+			dirty_.clear();
+			erased_.clear();
+			file_ = filename;
+			log_size_ = pos;
+			live_size_ = pos - head_size_;
+
+			// 新しいログをマップして、キーとテキストの複製を捨てる
+			if(fmap_.open_map(filename) && fmap_.get_span() != nullptr) {
+				top_ = static_cast<const char*>(fmap_.get_span());
+				// 書き出した時と同じ順番で走査する
+				auto o = ofs.begin();
+				for(auto& t : map_) {
+					item_t& it = t.second;
+					it.ofs_ = *o++;
+					std::string().swap(it.key_);
+					if(it.v_.vtype_ == vtype::text) {
+						std::string().swap(it.v_.text_);
+						it.vlog_ = true;
+					}
+				}
 			} else {
-				vt = cit->second;
-				return true;
+				fmap_.close();
 			}
+			return true;
 		}
 
 
+		bool append_(const std::string& filename) {
+			std::vector<char> out;
+			for(const auto& e : erased_) {
+				if(find_(ref_(e.first, e.second.c_str(), e.second.size())) != nullptr) continue;
+				write_rec_(out, e.first, e.second.c_str(), e.second.size(), nullptr);
+			}
+			for(item_map::value_type* t : dirty_) {
+				item_t& it = t->second;
+				if(!it.dirty_) continue;
+				write_rec_(out, t->first, key_ptr_(it), key_len_(it), &it.v_);
+				it.dirty_ = false;
+			}
+			dirty_.clear();
+			erased_.clear();
+			if(out.empty()) return true;
+			utils::file_io fo;
+			if(!fo.open(filename, "ab")) return false;
+			bool f = fo.write(out.data(), out.size()) == out.size();
+			fo.close();
+			log_size_ += out.size();
+			return f;
+		}
+
 	public:
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	まとめて登録する為のクラス @n
+					ベースのパスのハッシュを保持し、キーの文字列を作らずに @n
+					「base/leaf」のアイテムを登録、取得する。
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		class batch {
+			preference&		pre_;
+			std::string		base_;	///< ベースのフル・パス
+			key_type		hash_;
+
+			bool put_(const char* leaf, const value_t& v) {
+				if(base_.empty()) return false;
+				return pre_.put_(ref_(base_, hash_, leaf), v);
+			}
+
+			bool get_(const char* leaf, vtype t, value_t& v) const {
+				return pre_.get_(ref_(base_, hash_, leaf), t, v);
+			}
+
+		public:
+			batch(preference& pre, const std::string& base) : pre_(pre), base_(), hash_(0) {
+				pre.get_full_path_(base, base_);
+				hash_ = hash_add_(hash_init_, base_.c_str(), base_.size());
+			}
+
+			bool put_boolean(const char* leaf, bool v) {
+				return put_(leaf, make_(vtype::boolean, v ? 1 : 0));
+			}
+			bool put_integer(const char* leaf, int v) {
+				return put_(leaf, make_(vtype::int32, v));
+			}
+			bool put_real(const char* leaf, float v) {
+				return put_(leaf, make_(vtype::float32, v, 0.0f));
+			}
+			bool put_position(const char* leaf, const vtx::ipos& pos) {
+				return put_(leaf, make_(vtype::position_int32, pos.x, pos.y));
+			}
+			bool put_position(const char* leaf, const vtx::fpos& pos) {
+				return put_(leaf, make_(vtype::position_float32, pos.x, pos.y));
+			}
+			bool put_text(const char* leaf, const std::string& v) {
+				return put_(leaf, make_(v));
+			}
+
+			bool get_boolean(const char* leaf, bool& v) const {
+				value_t vt;
+				if(!get_(leaf, vtype::boolean, vt)) return false;
+				v = vt.i_[0] != 0;
+				return true;
+			}
+			bool get_integer(const char* leaf, int& v) const {
+				value_t vt;
+				if(!get_(leaf, vtype::int32, vt)) return false;
+				v = vt.i_[0];
+				return true;
+			}
+			bool get_real(const char* leaf, float& v) const {
+				value_t vt;
+				if(!get_(leaf, vtype::float32, vt)) return false;
+				v = vt.f_[0];
+				return true;
+			}
+			bool get_position(const char* leaf, vtx::ipos& pos) const {
+				value_t vt;
+				if(!get_(leaf, vtype::position_int32, vt)) return false;
+				pos.set(vt.i_[0], vt.i_[1]);
+				return true;
+			}
+			bool get_position(const char* leaf, vtx::fpos& pos) const {
+				value_t vt;
+				if(!get_(leaf, vtype::position_float32, vt)) return false;
+				pos.set(vt.f_[0], vt.f_[1]);
+				return true;
+			}
+			bool get_text(const char* leaf, std::string& v) const {
+				value_t vt;
+				if(!get_(leaf, vtype::text, vt)) return false;
+				v.swap(vt.text_);
+				return true;
+			}
+		};
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	コンストラクター
 		*/
 		//-----------------------------------------------------------------//
-		preference() : path_("/") { }
+		preference() : map_(), path_("/"), path_hash_(hash_add_(hash_init_, "/", 1)),
+			stack_path_(), file_(), fmap_(), top_(nullptr), log_size_(0), live_size_(0),
+			dirty_(), erased_() { }
 
 
 		//-----------------------------------------------------------------//
@@ -161,7 +743,7 @@ namespace sys {
 			@brief	デストラクター
 		*/
 		//-----------------------------------------------------------------//
-		~preference() { }
+		~preference() { fmap_.close(); }
 
 
 		//-----------------------------------------------------------------//
@@ -185,6 +767,7 @@ namespace sys {
 			if(path_[path_.size() - 1] != '/') {
 				path_ += '/';
 			}
+			path_hash_ = hash_add_(hash_init_, path_.c_str(), path_.size());
 		}
 
 
@@ -210,7 +793,30 @@ namespace sys {
 			@brief	カレントのパスを復帰
 		*/
 		//-----------------------------------------------------------------//
-		void pop_current_path() { path_ = stack_path_.top(); stack_path_.pop(); }
+		void pop_current_path() {
+			path_ = stack_path_.top();
+			stack_path_.pop();
+			path_hash_ = hash_add_(hash_init_, path_.c_str(), path_.size());
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アイテム数を取得
+			@return アイテム数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t size() const { return map_.size(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	キーのハッシュを得る（カレント・パスが適用される）
+			@param[in]	key	キーワード
+			@return ハッシュ
+		*/
+		//-----------------------------------------------------------------//
+		key_type get_hash(const std::string& key) const { return hash_(key); }
 
 
 		//-----------------------------------------------------------------//
@@ -221,12 +827,14 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		void create_current_list(utils::strings& ss)
 		{
-			for(const item_map::value_type& t : map_) {
-				const std::string& s = t.first;
-				if(utils::string_strncmp(s, path_, path_.size()) == 0) {
-					ss.push_back(s);
+			size_t n = ss.size();
+			for(const auto& t : map_) {
+				const item_t& it = t.second;
+				if(key_len_(it) >= path_.size() && std::memcmp(key_ptr_(it), path_.c_str(), path_.size()) == 0) {
+					ss.push_back(key_of_(it));
 				}
 			}
+			std::sort(ss.begin() + n, ss.end());
 		}
 
 
@@ -239,14 +847,8 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		bool find(const std::string& key) const
 		{
-			std::string s;
-			get_full_path_(key, s);
-			item_map::const_iterator cit = map_.find(s);
-			if(cit == map_.end()) {
-				return false;
-			} else {
-				return true;
-			}
+			if(key.empty()) return false;
+			return find_(ref_(key)) != nullptr;
 		}
 
 
@@ -259,12 +861,16 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		bool erase(const std::string& key)
 		{
-			std::string s;
-			get_full_path_(key, s);
-			size_t sz = map_.size();
-			size_t n = map_.erase(s);
-			if(sz == n) return false;
-			else return true;
+			if(key.empty()) return false;
+			auto it = find_it_(ref_(key));
+			if(it == map_.end()) return false;
+			live_size_ -= rec_size_of_(it->second);
+			if(it->second.dirty_) {
+				dirty_.erase(std::find(dirty_.begin(), dirty_.end(), &*it));
+			}
+			erased_.emplace_back(it->first, key_of_(it->second));
+			map_.erase(it);
+			return true;
 		}
 
 
@@ -277,15 +883,10 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		vtype get_type(const std::string& key) const
 		{
-			vtype t = vtype::invalid;
-			std::string s;
-			get_full_path_(key, s);
-			item_map::const_iterator cit = map_.find(s);
-			if(cit != map_.end()) {
-				const value_t& vt = cit->second;
-				t = vt.vtype_;
-			}
-			return t;
+			if(key.empty()) return vtype::invalid;
+			const item_t* it = find_(ref_(key));
+			if(it == nullptr) return vtype::invalid;
+			return it->v_.vtype_;
 		}
 
 
@@ -298,12 +899,7 @@ namespace sys {
 		*/
 		//-----------------------------------------------------------------//
 		bool put_text(const std::string& key, const std::string& v) {
-			std::string s;
-			s += '"';
-			s += v;
-			s += '"';
-			value_t vt(vtype::text, s);
-			return put_(key, vt);
+			return put_(key, make_(v));
 		}
 
 
@@ -316,11 +912,7 @@ namespace sys {
 		*/
 		//-----------------------------------------------------------------//
 		bool put_boolean(const std::string& key, bool v) {
-			std::string t;
-			if(v) t = boost::io::str( boost::format("%1%") % "1" );
-			else t = boost::io::str( boost::format("%1%") % "0" );
-			value_t vt(vtype::boolean, t);
-			return put_(key, vt);
+			return put_(key, make_(vtype::boolean, v ? 1 : 0));
 		}
 
 
@@ -333,9 +925,7 @@ namespace sys {
 		*/
 		//-----------------------------------------------------------------//
 		bool put_integer(const std::string& key, int v) {
-			std::string t = boost::io::str( boost::format("%1%") % v );
-			value_t vt(vtype::int32, t);
-			return put_(key, vt);
+			return put_(key, make_(vtype::int32, v));
 		}
 
 
@@ -348,9 +938,7 @@ namespace sys {
 		*/
 		//-----------------------------------------------------------------//
 		bool put_real(const std::string& key, float v) {
-			const uint32_t* p = reinterpret_cast<const uint32_t*>(&v);
-			value_t vt(vtype::float32, uint_to_hexs_(*p));
-			return put_(key, vt);
+			return put_(key, make_(vtype::float32, v, 0.0f));
 		}
 
 
@@ -363,9 +951,7 @@ namespace sys {
 		*/
 		//-----------------------------------------------------------------//
 		bool put_position(const std::string& key, const vtx::ipos& pos) {
-			std::string t = boost::io::str( boost::format("%d,%d") % pos.x % pos.y );
-			value_t vt(vtype::position_int32, t);
-			return put_(key, vt);
+			return put_(key, make_(vtype::position_int32, pos.x, pos.y));
 		}
 
 
@@ -378,9 +964,7 @@ namespace sys {
 		*/
 		//-----------------------------------------------------------------//
 		bool put_position(const std::string& key, const vtx::fpos& pos) {
-			std::string t = boost::io::str( boost::format("%f,%f") % pos.x % pos.y );
-			value_t vt(vtype::position_float32, t);
-			return put_(key, vt);
+			return put_(key, make_(vtype::position_float32, pos.x, pos.y));
 		}
 
 
@@ -394,17 +978,9 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		bool get_text(const std::string& key, std::string& v) const {
 			value_t vt;
-			if(get_(key, vt)) {
-				if(vt.vtype_ == vtype::text) {
-					if(vt.value_.size() >= 2 && vt.value_[0] == '"' && vt.value_.back() == '"') {
-						v = vt.value_.substr(1, vt.value_.size() - 2);
-					} else {
-						v = vt.value_;
-					}
-					return true;
-				}
-			}
-			return false;
+			if(!get_(ref_(key), vtype::text, vt)) return false;
+			v.swap(vt.text_);
+			return true;
 		}
 
 
@@ -418,16 +994,9 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		bool get_boolean(const std::string& key, bool& v) const {
 			value_t vt;
-			if(get_(key, vt)) {
-				if(vt.vtype_ == vtype::boolean) {
-					int i;
-					if(sscanf(vt.value_.c_str(), "%d", &i) == 1) {
-						if(i) v = true; else v = false;
-						return true;
-					}
-				}
-			}
-			return false;
+			if(!get_(ref_(key), vtype::boolean, vt)) return false;
+			v = vt.i_[0] != 0;
+			return true;
 		}
 
 
@@ -441,16 +1010,9 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		bool get_integer(const std::string& key, int& v) const {
 			value_t vt;
-			if(get_(key, vt)) {
-				if(vt.vtype_ == vtype::int32) {
-					int i;
-					if(sscanf(vt.value_.c_str(), "%d", &i) == 1) {
-						v = i;
-						return true;
-					}
-				}
-			}
-			return false;
+			if(!get_(ref_(key), vtype::int32, vt)) return false;
+			v = vt.i_[0];
+			return true;
 		}
 
 
@@ -464,15 +1026,9 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		bool get_real(const std::string& key, float& v) const {
 			value_t vt;
-			if(get_(key, vt)) {
-				if(vt.vtype_ == vtype::float32) {
-					const uint32_t iv = hexs_to_uint_(vt.value_);
-					const float* p = reinterpret_cast<const float*>(&iv);
-					v = *p;
-					return true;
-				}
-			}
-			return false;
+			if(!get_(ref_(key), vtype::float32, vt)) return false;
+			v = vt.f_[0];
+			return true;
 		}
 
 
@@ -486,16 +1042,9 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		bool get_position(const std::string& key, vtx::ipos& pos) const {
 			value_t vt;
-			if(get_(key, vt)) {
-				if(vt.vtype_ == vtype::position_int32) {
-					int x, y;
-					if(sscanf(vt.value_.c_str(), "%d,%d", &x, &y) == 2) {
-						pos.set(x, y);
-						return true;
-					}
-				}
-			}
-			return false;
+			if(!get_(ref_(key), vtype::position_int32, vt)) return false;
+			pos.set(vt.i_[0], vt.i_[1]);
+			return true;
 		}
 
 
@@ -507,18 +1056,11 @@ namespace sys {
 			@return 取得できれば「true」
 		*/
 		//-----------------------------------------------------------------//
-		bool get_position(const std::string& key, vtx::fpos& pos) {
+		bool get_position(const std::string& key, vtx::fpos& pos) const {
 			value_t vt;
-			if(get_(key, vt)) {
-				if(vt.vtype_ == vtype::position_float32) {
-					float x, y;
-					if(sscanf(vt.value_.c_str(), "%g,%g", &x, &y) == 2) {
-						pos.set(x, y);
-						return true;
-					}
-				}
-			}
-			return false;
+			if(!get_(ref_(key), vtype::position_float32, vt)) return false;
+			pos.set(vt.f_[0], vt.f_[1]);
+			return true;
 		}
 
 
@@ -531,8 +1073,9 @@ namespace sys {
 		//-----------------------------------------------------------------//
 		bool load_rect(const std::string& key, vtx::srect& rect)
 		{
+			batch b(*this, key);
 			vtx::ipos org(-1);
-			if(!get_position(key + "/locate", org)) {
+			if(!b.get_position("locate", org)) {
 				return false;
 			}
 			if(org.x < 0 || org.y < 0) {
@@ -540,7 +1083,7 @@ namespace sys {
 			}
 
 			vtx::ipos size(0);
-			if(!get_position(key + "/size", size)) {
+			if(!b.get_position("size", size)) {
 				return false;
 			}
 			if(size.x <= 0 || size.y <= 0) {
@@ -570,29 +1113,32 @@ namespace sys {
 				return false;
 			}
 			vtx::ipos size = rect.size;
-			put_position(key + "/locate", org);
-			put_position(key + "/size", size);
+			batch b(*this, key);
+			b.put_position("locate", org);
+			b.put_position("size", size);
 			return true;
 		}
 
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	設定をロード
+			@brief	テキスト形式の設定を取り込む
 			@param[in]	filename	ファイル名
 			@return エラーが無ければ「true」
 		*/
 		//-----------------------------------------------------------------//
-		bool load(const std::string& filename)
+		bool load_text(const std::string& filename)
 		{
 			utils::file_io inp;
-			if(!inp.open(filename, "rb")) {
+			if(!inp.open_map(filename)) {
 				return false;
 			}
 
 			uint32_t err = 0;
-			while(!inp.eof()) {
-				auto s = inp.get_line();
+			const char* line;
+			size_t len;
+			while(inp.get_line(line, len)) {
+				std::string s(line, len);
 				if(s.empty()) continue;
 				if(s[0] == '#') ;  // コメント行は無視
 				else {
@@ -600,8 +1146,7 @@ namespace sys {
 					if(ss.size() == 3) {
 						int n;
 						if(utils::string_to_int(ss[1], n)) {
-							value_t vt(static_cast<vtype>(n), ss[2]);
-							put_(ss[0], vt);
+							if(!import_(ss[0], static_cast<vtype>(n), ss[2])) ++err;
 						} else {
 							++err;
 						}
@@ -616,30 +1161,191 @@ namespace sys {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	設定をセーブ
+			@brief	テキスト形式で書き出す
 			@param[in]	filename	ファイル名
 			@return エラーが無ければ「true」
 		*/
 		//-----------------------------------------------------------------//
-		bool save(const std::string& filename)
+		bool save_text(const std::string& filename)
 		{
 			utils::file_io out;
 			if(!out.open(filename, "wb")) {
 				return false;
 			}
 
-			for(item_map::const_iterator cit = map_.begin(); cit != map_.end(); ++cit) {
-				out.put(cit->first);
+			std::vector<std::pair<std::string, const item_t*> > list;
+			list.reserve(map_.size());
+			for(const auto& t : map_) {
+				list.emplace_back(key_of_(t.second), &t.second);
+			}
+			std::sort(list.begin(), list.end(),
+				[](const std::pair<std::string, const item_t*>& a,
+				   const std::pair<std::string, const item_t*>& b) { return a.first < b.first; });
+
+			for(const auto& l : list) {
+				out.put(l.first);
 				out.put_char(' ');
-				out.put_char(0x30 + static_cast<int>(cit->second.vtype_));
+				out.put_char(0x30 + static_cast<int>(l.second->v_.vtype_));
 				out.put_char(' ');
-				out.put(cit->second.value_);
+				out.put(export_(*l.second));
 				out.put_char('\n');
 			}
 			out.close();
 
 			return true;
 		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	バイナリー・ログのファイル名を得る @n
+					「.pre」は「.prb」に置き換え、それ以外は「.prb」を足す。
+			@param[in]	filename	ファイル名
+			@return ログのファイル名
+		*/
+		//-----------------------------------------------------------------//
+		static std::string get_log_name(const std::string& filename)
+		{
+			std::string ext = utils::get_file_ext(filename);
+			if(ext == "prb") return filename;
+			if(ext == "pre") return filename.substr(0, filename.size() - 3) + "prb";
+			return filename + ".prb";
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	設定をロード @n
+					バイナリー・ログ（get_log_name）があればマップして索引を @n
+					作り、以後の save はログへの追記になる。@n
+					無ければ、filename をテキスト形式として取り込む。
+			@param[in]	filename	ファイル名
+			@return エラーが無ければ「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool load(const std::string& filename)
+		{
+			close_map_();
+			std::string log = get_log_name(filename);
+			if(utils::probe_file(log) && map_log_(log)) {
+				file_ = log;
+				return true;
+			}
+			return load_text(filename);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	設定をセーブ @n
+					バイナリー・ログ（get_log_name）に書き、テキスト形式の @n
+					filename は書き換えない。@n
+					ロードしたログへは、変更されたアイテムだけを追記し、@n
+					ログが生きているアイテムの２倍を超えたら詰め直す。@n
+					他のログへは、全体を書き出す。
+			@param[in]	filename	ファイル名
+			@return エラーが無ければ「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool save(const std::string& filename)
+		{
+			std::string log = get_log_name(filename);
+			if(log == file_ && log_size_ >= head_size_ && utils::probe_file(log)) {
+				if(!append_(log)) return false;
+				if(log_size_ > (live_size_ * 2 + 64 * 1024)) {
+					return compact();
+				}
+				return true;
+			}
+			return write_all_(log);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ログを詰め直す（生きているアイテムだけにする）
+			@return エラーが無ければ「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool compact()
+		{
+			if(file_.empty()) return false;
+			return write_all_(file_);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ログのサイズを取得
+			@return ログのサイズ（バイト）
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_log_size() const { return log_size_; }
+
+	private:
+		bool import_(const std::string& key, vtype t, const std::string& s)
+		{
+			value_t v;
+			v.vtype_ = t;
+			switch(t) {
+			case vtype::int32:
+			case vtype::boolean:
+				if(sscanf(s.c_str(), "%d", &v.i_[0]) != 1) return false;
+				if(t == vtype::boolean) v.i_[0] = v.i_[0] != 0;
+				break;
+			case vtype::float32:
+				{
+					uint32_t iv = hexs_to_uint_(s);
+					std::memcpy(&v.f_[0], &iv, 4);
+				}
+				break;
+			case vtype::position_int32:
+				if(sscanf(s.c_str(), "%d,%d", &v.i_[0], &v.i_[1]) != 2) return false;
+				break;
+			case vtype::position_float32:
+				if(sscanf(s.c_str(), "%g,%g", &v.f_[0], &v.f_[1]) != 2) return false;
+				break;
+			case vtype::text:
+				if(s.size() >= 2 && s[0] == '"' && s.back() == '"') {
+					v.text_ = s.substr(1, s.size() - 2);
+				} else {
+					v.text_ = s;
+				}
+				break;
+			default:
+				return false;
+			}
+			return put_(key, v);
+		}
+
+
+		std::string export_(const item_t& it) const
+		{
+			const value_t& v = it.v_;
+			switch(v.vtype_) {
+			case vtype::int32:
+				return boost::io::str( boost::format("%1%") % v.i_[0] );
+			case vtype::boolean:
+				return v.i_[0] ? "1" : "0";
+			case vtype::float32:
+				{
+					uint32_t iv;
+					std::memcpy(&iv, &v.f_[0], 4);
+					return uint_to_hexs_(iv);
+				}
+			case vtype::position_int32:
+				return boost::io::str( boost::format("%d,%d") % v.i_[0] % v.i_[1] );
+			case vtype::position_float32:
+				return boost::io::str( boost::format("%f,%f") % v.f_[0] % v.f_[1] );
+			case vtype::text:
+				{
+					std::string s;
+					get_text_(it, s);
+					return '"' + s + '"';
+				}
+			default:
+				return "";
+			}
+		}
 	};
 }
-
@@ -297,6 +297,58 @@ namespace qtx {
 		}
 
 
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	球面線形補間
+			@param[in]	a	開始
+			@param[in]	b	終了
+			@param[in]	t	補間係数（0.0 〜 1.0）
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		void slerp(const quaternion& a, const quaternion& b, T t) {
+			T c = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+			T s = static_cast<T>(1);
+			if(c < 0) {
+				c = -c;
+				s = -s;
+			}
+			T ka, kb;
+			if(c > static_cast<T>(0.9995)) {
+				ka = static_cast<T>(1) - t;
+				kb = t;
+			} else {
+				T th = std::acos(c);
+				T is = static_cast<T>(1) / std::sin(th);
+				ka = std::sin((static_cast<T>(1) - t) * th) * is;
+				kb = std::sin(t * th) * is;
+			}
+			kb *= s;
+			x = a.x * ka + b.x * kb;
+			y = a.y * ka + b.y * kb;
+			z = a.z * ka + b.z * kb;
+			w = a.w * ka + b.w * kb;
+			if(c > static_cast<T>(0.9995)) normalise();
+		}
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	ベクトルを回転
+			@param[in]	v	ベクトル
+			@return 回転後のベクトル
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		vtx::vertex3<T> rotate_vector(const vtx::vertex3<T>& v) const {
+			// v + 2w(q x v) + 2q x (q x v)
+			T tx = static_cast<T>(2) * (y * v.z - z * v.y);
+			T ty = static_cast<T>(2) * (z * v.x - x * v.z);
+			T tz = static_cast<T>(2) * (x * v.y - y * v.x);
+			return vtx::vertex3<T>(v.x + w * tx + (y * tz - z * ty),
+								   v.y + w * ty + (z * tx - x * tz),
+								   v.z + w * tz + (x * ty - y * tx));
+		}
+
+
 		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 		/*!
 			@brief	指定方向に向ける
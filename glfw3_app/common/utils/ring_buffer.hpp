@@ -0,0 +1,450 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	スレッド間リング・バッファ @n
+			spsc_ring：単一プロデューサー、単一コンシューマー @n
+			mpsc_ring：複数プロデューサー、単一コンシューマー @n
+			どちらもロックを使わず、std::atomic のインデックス（取得／解放 @n
+			のメモリー順序）で同期する。インデックスはキャッシュ・ラインを @n
+			分けて置き、まとめ書き（write）、まとめ読み（read）と、@n
+			コピーしない参照（peek / consume）を持つ。
+	@author	平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#include <atomic>
+#include <utility>
+
+namespace utils {
+
+	static const uint32_t ring_cache_line = 64;
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	SPSC リング・バッファ @n
+				put / write / reserve はプロデューサー・スレッドだけ、@n
+				get / read / peek はコンシューマー・スレッドだけが呼ぶ事。
+		@param[in]	T		基本型
+		@param[in]	SIZE	バッファサイズ（２の累乗）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <class T, uint32_t SIZE>
+	class spsc_ring {
+
+		static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+		static const uint32_t mask_ = SIZE - 1;
+
+		// put_, get_ は単調増加のカウンター（位置は mask_ で求める）
+		alignas(ring_cache_line) std::atomic<uint32_t>	put_;
+		alignas(ring_cache_line) std::atomic<uint32_t>	get_;
+		alignas(ring_cache_line) T	buff_[SIZE];
+
+	public:
+		typedef T	value_type;
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		spsc_ring() : put_(0), get_(0) { }
+
+		spsc_ring(const spsc_ring&) = delete;
+		spsc_ring& operator = (const spsc_ring&) = delete;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	クリア（両方のスレッドが止まっている時に呼ぶ事）
+		*/
+		//-----------------------------------------------------------------//
+		void clear() {
+			put_.store(0, std::memory_order_relaxed);
+			get_.store(0, std::memory_order_relaxed);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	値の格納
+			@param[in]	v	値
+			@return 満杯なら「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool put(const T& v) {
+			uint32_t p = put_.load(std::memory_order_relaxed);
+			if((p - get_.load(std::memory_order_acquire)) >= SIZE) return false;
+			buff_[p & mask_] = v;
+			put_.store(p + 1, std::memory_order_release);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	値の格納（ムーブ）
+			@param[in]	v	値
+			@return 満杯なら「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool put(T&& v) {
+			uint32_t p = put_.load(std::memory_order_relaxed);
+			if((p - get_.load(std::memory_order_acquire)) >= SIZE) return false;
+			buff_[p & mask_] = std::move(v);
+			put_.store(p + 1, std::memory_order_release);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	まとめて格納
+			@param[in]	src	格納する配列
+			@param[in]	num	個数
+			@return 格納した個数（空きが足りなければ num より少ない）
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t write(const T* src, uint32_t num) {
+			uint32_t p = put_.load(std::memory_order_relaxed);
+			uint32_t n = SIZE - (p - get_.load(std::memory_order_acquire));
+			if(n > num) n = num;
+			uint32_t ofs = p & mask_;
+			uint32_t first = SIZE - ofs;
+			if(first > n) first = n;
+			for(uint32_t i = 0; i < first; ++i) buff_[ofs + i] = src[i];
+			for(uint32_t i = first; i < n; ++i) buff_[i - first] = src[i];
+			put_.store(p + n, std::memory_order_release);
+			return n;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	書き込み領域の確保（コピーしない書き込み） @n
+					連続して書ける領域を返し、commit で公開する。
+			@param[out]	ptr	書き込み先
+			@return 連続して書ける個数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t reserve(T*& ptr) {
+			uint32_t p = put_.load(std::memory_order_relaxed);
+			uint32_t n = SIZE - (p - get_.load(std::memory_order_acquire));
+			uint32_t ofs = p & mask_;
+			if(n > (SIZE - ofs)) n = SIZE - ofs;
+			ptr = &buff_[ofs];
+			return n;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	reserve で書いた値を公開
+			@param[in]	num	個数
+		*/
+		//-----------------------------------------------------------------//
+		void commit(uint32_t num) {
+			put_.store(put_.load(std::memory_order_relaxed) + num, std::memory_order_release);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	値の取得
+			@param[out]	v	値
+			@return 空なら「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool get(T& v) {
+			uint32_t g = get_.load(std::memory_order_relaxed);
+			if(g == put_.load(std::memory_order_acquire)) return false;
+			v = std::move(buff_[g & mask_]);
+			get_.store(g + 1, std::memory_order_release);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	まとめて取得
+			@param[out]	dst	取得先
+			@param[in]	num	最大個数
+			@return 取得した個数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t read(T* dst, uint32_t num) {
+			uint32_t g = get_.load(std::memory_order_relaxed);
+			uint32_t n = put_.load(std::memory_order_acquire) - g;
+			if(n > num) n = num;
+			uint32_t ofs = g & mask_;
+			uint32_t first = SIZE - ofs;
+			if(first > n) first = n;
+			for(uint32_t i = 0; i < first; ++i) dst[i] = std::move(buff_[ofs + i]);
+			for(uint32_t i = first; i < n; ++i) dst[i] = std::move(buff_[i - first]);
+			get_.store(g + n, std::memory_order_release);
+			return n;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	先頭の参照（コピーしない読み出し） @n
+					連続して読める領域を返し、consume で開放する。
+			@param[out]	ptr	先頭
+			@return 連続して読める個数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t peek(const T*& ptr) const {
+			uint32_t g = get_.load(std::memory_order_relaxed);
+			uint32_t n = put_.load(std::memory_order_acquire) - g;
+			uint32_t ofs = g & mask_;
+			if(n > (SIZE - ofs)) n = SIZE - ofs;
+			ptr = &buff_[ofs];
+			return n;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	先頭の値を参照（空で無い事を確認してから呼ぶ事）
+			@return 値
+		*/
+		//-----------------------------------------------------------------//
+		const T& front() const { return buff_[get_.load(std::memory_order_relaxed) & mask_]; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	peek / front で参照した値を開放
+			@param[in]	num	個数
+		*/
+		//-----------------------------------------------------------------//
+		void consume(uint32_t num = 1) {
+			get_.store(get_.load(std::memory_order_relaxed) + num, std::memory_order_release);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	格納されている個数
+			@return 個数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t length() const {
+			return put_.load(std::memory_order_acquire) - get_.load(std::memory_order_acquire);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	空き個数
+			@return 個数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t space() const { return SIZE - length(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	バッファのサイズを返す
+			@return	バッファのサイズ
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t size() const { return SIZE; }
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	MPSC リング・バッファ @n
+				要素毎のシーケンス番号で、書き込みの完了を公開する。@n
+				put / write は任意のスレッド、get / read / peek は @n
+				コンシューマー・スレッドだけが呼ぶ事。
+		@param[in]	T		基本型
+		@param[in]	SIZE	バッファサイズ（２の累乗）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <class T, uint32_t SIZE>
+	class mpsc_ring {
+
+		static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+		static const uint32_t mask_ = SIZE - 1;
+
+		alignas(ring_cache_line) std::atomic<uint32_t>	put_;
+		alignas(ring_cache_line) std::atomic<uint32_t>	get_;
+		// seq_[i] == pos なら空き、pos + 1 なら書き込み済み
+		alignas(ring_cache_line) std::atomic<uint32_t>	seq_[SIZE];
+		alignas(ring_cache_line) T	buff_[SIZE];
+
+		// num 個の領域を確保して、先頭のカウンターを返す
+		bool claim_(uint32_t num, uint32_t& pos) {
+			pos = put_.load(std::memory_order_relaxed);
+			while(1) {
+				// 最後の要素が空いていれば、コンシューマーは順に開放するので、その前も空いている
+				uint32_t last = pos + num - 1;
+				uint32_t s = seq_[last & mask_].load(std::memory_order_acquire);
+				if(static_cast<int32_t>(s - last) < 0) return false;
+				if(s == last) {
+					if(put_.compare_exchange_weak(pos, pos + num, std::memory_order_relaxed)) {
+						return true;
+					}
+				} else {
+					pos = put_.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+	public:
+		typedef T	value_type;
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		mpsc_ring() : put_(0), get_(0) {
+			for(uint32_t i = 0; i < SIZE; ++i) seq_[i].store(i, std::memory_order_relaxed);
+		}
+
+		mpsc_ring(const mpsc_ring&) = delete;
+		mpsc_ring& operator = (const mpsc_ring&) = delete;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	クリア（全てのスレッドが止まっている時に呼ぶ事）
+		*/
+		//-----------------------------------------------------------------//
+		void clear() {
+			put_.store(0, std::memory_order_relaxed);
+			get_.store(0, std::memory_order_relaxed);
+			for(uint32_t i = 0; i < SIZE; ++i) seq_[i].store(i, std::memory_order_relaxed);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	値の格納
+			@param[in]	v	値
+			@return 満杯なら「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool put(const T& v) {
+			uint32_t pos;
+			if(!claim_(1, pos)) return false;
+			buff_[pos & mask_] = v;
+			seq_[pos & mask_].store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	まとめて格納（全て入らなければ格納しない）
+			@param[in]	src	格納する配列
+			@param[in]	num	個数（SIZE 以下）
+			@return 満杯なら「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool write(const T* src, uint32_t num) {
+			if(num == 0) return true;
+			if(num > SIZE) return false;
+			uint32_t pos;
+			if(!claim_(num, pos)) return false;
+			for(uint32_t i = 0; i < num; ++i) {
+				uint32_t p = pos + i;
+				buff_[p & mask_] = src[i];
+				seq_[p & mask_].store(p + 1, std::memory_order_release);
+			}
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	値の取得
+			@param[out]	v	値
+			@return 空（または書き込み中）なら「false」
+		*/
+		//-----------------------------------------------------------------//
+		bool get(T& v) {
+			uint32_t g = get_.load(std::memory_order_relaxed);
+			if(seq_[g & mask_].load(std::memory_order_acquire) != g + 1) return false;
+			v = std::move(buff_[g & mask_]);
+			seq_[g & mask_].store(g + SIZE, std::memory_order_release);
+			get_.store(g + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	まとめて取得
+			@param[out]	dst	取得先
+			@param[in]	num	最大個数
+			@return 取得した個数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t read(T* dst, uint32_t num) {
+			uint32_t n = 0;
+			while(n < num && get(dst[n])) ++n;
+			return n;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	先頭の参照（コピーしない読み出し） @n
+					書き込みが完了していて、連続して読める領域を返す。
+			@param[out]	ptr	先頭
+			@return 連続して読める個数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t peek(const T*& ptr) const {
+			uint32_t g = get_.load(std::memory_order_relaxed);
+			uint32_t ofs = g & mask_;
+			uint32_t n = 0;
+			while((ofs + n) < SIZE
+				&& seq_[ofs + n].load(std::memory_order_acquire) == g + n + 1) ++n;
+			ptr = &buff_[ofs];
+			return n;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	peek で参照した値を開放
+			@param[in]	num	個数
+		*/
+		//-----------------------------------------------------------------//
+		void consume(uint32_t num = 1) {
+			uint32_t g = get_.load(std::memory_order_relaxed);
+			for(uint32_t i = 0; i < num; ++i) {
+				seq_[(g + i) & mask_].store(g + i + SIZE, std::memory_order_release);
+			}
+			get_.store(g + num, std::memory_order_relaxed);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	格納されている個数（書き込み中を含む目安）
+			@return 個数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t length() const {
+			return put_.load(std::memory_order_acquire) - get_.load(std::memory_order_acquire);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	バッファのサイズを返す
+			@return	バッファのサイズ
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t size() const { return SIZE; }
+	};
+}
@@ -6,14 +6,10 @@
 */
 //=====================================================================//
 #include "utils/sjis_utf16.hpp"
-#include <boost/unordered_map.hpp>
-
-#include <iostream>
-#include <boost/format.hpp>
 
 namespace utils {
 
-static uint16_t sjis_utf16_tbl_[] = {
+static constexpr uint16_t sjis_utf16_tbl_[] = {
 // SJIS: 0x81 (0x40 to 0x7e)
 0x3000, 0x3001, 0x3002, 0xff0c, 0xff0e, 0x30fb, 0xff1a, 0xff1b, 
 0xff1f, 0xff01, 0x309b, 0x309c, 0x00b4, 0xff40, 0x00a8, 0xff3e, 
@@ -1216,15 +1212,12 @@ static uint16_t sjis_utf16_tbl_[] = {
 0x0000
 };
 
-	typedef boost::unordered_map<uint16_t, uint16_t> utf16_to_sjis_map;
-	static utf16_to_sjis_map  utf16_to_sjis_map_;
-
 	// sjis コードをリニア表に変換する。
 	// 上位バイト： 0x81 to 0x9f, 0xe0 to 0xef
 	// 下位バイト： 0x40 to 0x7e, 0x80 to 0xfc
-	static uint16_t sjis_to_liner_(uint16_t sjis)
+	static constexpr uint16_t sjis_to_liner_(uint16_t sjis)
 	{
-		uint16_t code;
+		uint16_t code = 0;
 		uint8_t up = sjis >> 8;
 		uint8_t lo = sjis & 0xff;
 		if(0x81 <= up && up <= 0x9f) {
@@ -1249,30 +1242,8 @@ static uint16_t sjis_utf16_tbl_[] = {
 	}
 
 
-	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
-	/*!
-		@brief	SJIS から UTF-16 コードを求める
-		@param[in]	sjis	SJIS コード
-		@return UTF16 コード
-	*/
-	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
-	uint16_t sjis_to_utf16(uint16_t sjis)
+	static constexpr uint16_t sjis_to_utf16_(uint16_t sjis)
 	{
-#if 0
-		switch(sjis) {
-		case 0x8160: // return 0x301c;
-		case 0x8161: // return 0x2016;
-		case 0x817c: // return 0x2212;
-		case 0x8191: // return 0x00a2;
-		case 0x8192: // return 0x00a3;
-		case 0x81ca: // return 0x00ac;
-		case 0x815c: // return 0x2014;
-///			std::cout << boost::format("SJIS: %04x") % sjis << std::endl;
-			break;
-		default:
-			break;
-		}
-#endif
 		if(sjis <= 0x007d) {  // alphabet
 			return sjis;
 		} else if(sjis == 0x07e) {
@@ -1290,47 +1261,113 @@ static uint16_t sjis_utf16_tbl_[] = {
 	}
 
 
-	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	//-----------------------------------------------------------------//
 	/*!
-		@brief	UTF-16 から SJIS コードを求めるマップの生成
+		@brief	UTF-16 から SJIS を求める逆引き表（２段） @n
+				UTF-16 の上位バイトで page_ を引き、０以外なら、@n
+				code_[page_ - 1] を下位バイトで引く。（０は該当無し）
 	*/
-	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
-	void init_utf16_to_sjis()
-	{
-		struct tbl {
-			uint16_t	start;
-			uint16_t	end;
-		};
+	//-----------------------------------------------------------------//
+	template <uint32_t N>
+	struct utf16_sjis_tbl_t {
+		uint8_t		page_[256];
+		uint16_t	code_[N][256];
+	};
+
+
 	// 上位バイト： 0x81 to 0x9f, 0xe0 to 0xee
 	// 下位バイト： 0x40 to 0x7e, 0x80 to 0xfc
-		static const tbl hi_[] = {
-			{ 0x81, 0x9f },
-			{ 0xe0, 0xee }
-		};
-		static const tbl lo_[] = {
-			{ 0x40, 0x7e },
-			{ 0x80, 0xfc }
-		};
-		for(uint32_t i = 0; i < 2; ++i) {
-			for(uint16_t hi = hi_[i].start; hi <= hi_[i].end; ++hi) {
-				for(uint32_t j = 0; j < 2; ++j) {
-					for(uint16_t lo = lo_[j].start; lo <= lo_[j].end; ++lo) {
-						uint16_t sjis = (hi << 8) | lo;
-						uint16_t utf16 = sjis_to_utf16(sjis);
-						if(utf16 != 0xffff && utf16 != 0) {
-							utf16_to_sjis_map_.emplace(utf16, sjis);
-						}
-					}
-				}
+	// 半角カナ：   0xa1 to 0xdf
+	// の順番で走査し、同じ UTF-16 に複数の SJIS がある場合は、最初の物を使う。
+	template <class FUNC>
+	static constexpr void scan_sjis_(FUNC& func)
+	{
+		for(uint16_t hi = 0x81; hi <= 0xee; ++hi) {
+			if(0x9f < hi && hi < 0xe0) continue;
+			for(uint16_t lo = 0x40; lo <= 0xfc; ++lo) {
+				if(lo == 0x7f) continue;
+				func((hi << 8) | lo);
 			}
 		}
-		// 半角カナ
 		for(uint16_t sjis = 0x00a1; sjis <= 0x00df; ++sjis) {
-			uint16_t utf16 = sjis_to_utf16(sjis);
-			if(utf16 != 0xffff && utf16 != 0) {
-				utf16_to_sjis_map_.emplace(utf16, sjis);
+			func(sjis);
+		}
+	}
+
+
+	struct page_count_t {
+		bool		use_[256];
+		uint32_t	count_;
+		constexpr page_count_t() : use_{}, count_(0) { }
+		constexpr void operator () (uint16_t sjis) {
+			uint16_t utf16 = sjis_to_utf16_(sjis);
+			if(utf16 == 0xffff || utf16 == 0) return;
+			if(!use_[utf16 >> 8]) {
+				use_[utf16 >> 8] = true;
+				++count_;
 			}
 		}
+	};
+
+
+	static constexpr uint32_t count_pages_()
+	{
+		page_count_t pc;
+		scan_sjis_(pc);
+		return pc.count_;
+	}
+
+
+	template <uint32_t N>
+	struct tbl_builder_t {
+		utf16_sjis_tbl_t<N>	tbl_;
+		uint32_t			count_;
+		constexpr tbl_builder_t() : tbl_{}, count_(0) { }
+		constexpr void operator () (uint16_t sjis) {
+			uint16_t utf16 = sjis_to_utf16_(sjis);
+			if(utf16 == 0xffff || utf16 == 0) return;
+			uint8_t& pg = tbl_.page_[utf16 >> 8];
+			if(pg == 0) pg = ++count_;
+			uint16_t& code = tbl_.code_[pg - 1][utf16 & 0xff];
+			if(code == 0) code = sjis;
+		}
+	};
+
+
+	template <uint32_t N>
+	static constexpr utf16_sjis_tbl_t<N> build_utf16_sjis_()
+	{
+		tbl_builder_t<N> b;
+		scan_sjis_(b);
+		return b.tbl_;
+	}
+
+	static constexpr uint32_t utf16_sjis_pages_ = count_pages_();
+	static constexpr utf16_sjis_tbl_t<utf16_sjis_pages_> utf16_sjis_tbl_
+		= build_utf16_sjis_<utf16_sjis_pages_>();
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	SJIS から UTF-16 コードを求める
+		@param[in]	sjis	SJIS コード
+		@return UTF16 コード
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	uint16_t sjis_to_utf16(uint16_t sjis)
+	{
+		return sjis_to_utf16_(sjis);
+	}
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	UTF-16 から SJIS コードを求めるマップの生成 @n
+				逆引き表はコンパイル時に作られるので、何もしない。
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	void init_utf16_to_sjis()
+	{
 	}
 
 
@@ -1345,15 +1382,11 @@ static uint16_t sjis_utf16_tbl_[] = {
 	{
 		if(utf16 < 128) return utf16; // alphabet
 
-		if(utf16_to_sjis_map_.size() == 0) {
-			init_utf16_to_sjis();
-		}
-
-		utf16_to_sjis_map::const_iterator cit = utf16_to_sjis_map_.find(utf16);
-		if(cit == utf16_to_sjis_map_.end()) {
-			return 0xffff;
-		}
-		return cit->second;
+		uint8_t pg = utf16_sjis_tbl_.page_[utf16 >> 8];
+		if(pg == 0) return 0xffff;
+		uint16_t sjis = utf16_sjis_tbl_.code_[pg - 1][utf16 & 0xff];
+		if(sjis == 0) return 0xffff;
+		return sjis;
 	}
 
 }
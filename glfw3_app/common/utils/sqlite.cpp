@@ -6,10 +6,208 @@
 //=====================================================================//
 #include "sqlite.hpp"
 #include <boost/foreach.hpp>
+#include <algorithm>
 #include <iostream>
 
 namespace sys {
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	値をバインド
+		@param[in]	idx	パラメーター番号
+		@param[in]	v	値
+		@param[in]	d	SQLITE_STATIC（inserter の行バッファ）か SQLITE_TRANSIENT
+		@return 成功なら「true」
+	 */
+	//-----------------------------------------------------------------//
+	bool sqlite::statement::bind_(int idx, const value& v, sqlite3_destructor_type d)
+	{
+		switch(v.type_) {
+		case SQLITE_INTEGER:
+			status_ = sqlite3_bind_int64(stmt_, idx, v.i_);
+			break;
+		case SQLITE_FLOAT:
+			status_ = sqlite3_bind_double(stmt_, idx, v.d_);
+			break;
+		case SQLITE_TEXT:
+			status_ = sqlite3_bind_text(stmt_, idx, v.s_.data(), static_cast<int>(v.s_.size()), d);
+			break;
+		case SQLITE_BLOB:
+			status_ = sqlite3_bind_blob(stmt_, idx, v.s_.data(), static_cast<int>(v.s_.size()), d);
+			break;
+		default:
+			status_ = sqlite3_bind_null(stmt_, idx);
+			break;
+		}
+		return status_ == SQLITE_OK;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	トランザクションを開始（入れ子なら SAVEPOINT）
+		@param[in]	db	データベース
+	 */
+	//-----------------------------------------------------------------//
+	sqlite::transaction::transaction(sqlite& db) : db_(db), depth_(db.m_depth), active_(false)
+	{
+		if(depth_ == 0) {
+			active_ = db_.exec("BEGIN IMMEDIATE");
+		} else {
+			active_ = db_.exec("SAVEPOINT tr_" + std::to_string(depth_));
+		}
+		if(active_) ++db_.m_depth;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	コミット
+		@return 成功なら「true」
+	 */
+	//-----------------------------------------------------------------//
+	bool sqlite::transaction::commit()
+	{
+		if(!active_) return false;
+		bool f;
+		if(depth_ == 0) {
+			f = db_.exec("COMMIT");
+		} else {
+			f = db_.exec("RELEASE tr_" + std::to_string(depth_));
+		}
+		if(f) {
+			active_ = false;
+			--db_.m_depth;
+		}
+		return f;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	ロールバック
+	 */
+	//-----------------------------------------------------------------//
+	void sqlite::transaction::rollback()
+	{
+		if(!active_) return;
+		if(depth_ == 0) {
+			db_.exec("ROLLBACK");
+		} else {
+			std::string sp = "tr_" + std::to_string(depth_);
+			db_.exec("ROLLBACK TO " + sp);
+			db_.exec("RELEASE " + sp);
+		}
+		active_ = false;
+		--db_.m_depth;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	inserter のコンストラクター
+		@param[in]	db		データベース
+		@param[in]	head	「INSERT INTO t (a, b, c)」など
+		@param[in]	cols	カラム数
+		@param[in]	rows	まとめる行数
+	 */
+	//-----------------------------------------------------------------//
+	sqlite::inserter::inserter(sqlite& db, const std::string& head, uint32_t cols, uint32_t rows) :
+		db_(db), head_(head), cols_(cols), rows_(rows), num_(0), count_(0), error_(false)
+	{
+		if(cols_ == 0 || db_.m_db == NULL) {
+			error_ = true;
+			return;
+		}
+		// パラメーター数の上限（古い版は 999）
+		int lim = sqlite3_limit(db_.m_db, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+		uint32_t n = lim > 0 ? static_cast<uint32_t>(lim) / cols_ : 1;
+		rows_ = std::max(1U, std::min(rows_, n));
+		buff_.resize(rows_ * cols_);
+		full_ = db_.query(make_sql_(rows_));
+		if(!full_.is_valid()) error_ = true;
+	}
+
+
+	std::string sqlite::inserter::make_sql_(uint32_t rows) const
+	{
+		std::string row = "(";
+		for(uint32_t i = 0; i < cols_; ++i) {
+			if(i) row += ',';
+			row += '?';
+		}
+		row += ')';
+		std::string sql = head_ + " VALUES ";
+		sql.reserve(sql.size() + (row.size() + 1) * rows);
+		for(uint32_t i = 0; i < rows; ++i) {
+			if(i) sql += ',';
+			sql += row;
+		}
+		return sql;
+	}
+
+
+	bool sqlite::inserter::exec_(statement& st, uint32_t rows)
+	{
+		uint32_t n = rows * cols_;
+		for(uint32_t i = 0; i < n; ++i) {
+			// 行バッファは exec の間保持されるので、コピーしない
+			if(!st.bind_(static_cast<int>(i + 1), buff_[i], SQLITE_STATIC)) return false;
+		}
+		if(!st.exec()) return false;
+		count_ += rows;
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	残った行を実行
+		@return エラーが無ければ「true」
+	 */
+	//-----------------------------------------------------------------//
+	bool sqlite::inserter::flush()
+	{
+		if(num_ == 0) return !error_;
+		if(!error_) {
+			statement st = db_.query(make_sql_(num_));
+			if(!st.is_valid() || !exec_(st, num_)) error_ = true;
+		}
+		num_ = 0;
+		return !error_;
+	}
+
+
+	// 使われていない古いステートメントを捨てる
+	void sqlite::evict_cache_()
+	{
+		while(m_cache.size() > m_config.stmt_cache_) {
+			cache_list::iterator it = m_cache.end();
+			while(it != m_cache.begin()) {
+				--it;
+				if(it->ref_ == 0) break;
+			}
+			if(it->ref_ != 0) break;
+			cache_map::iterator mit = m_cache_map.find(it->sql_);
+			if(mit != m_cache_map.end() && mit->second == it) {
+				m_cache_map.erase(mit);
+			}
+			sqlite3_finalize(it->stmt_);
+			m_cache.erase(it);
+		}
+	}
+
+
+	void sqlite::clear_cache_()
+	{
+		BOOST_FOREACH(cache_t& c, m_cache) {
+			sqlite3_finalize(c.stmt_);
+		}
+		m_cache.clear();
+		m_cache_map.clear();
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	初期化
@@ -38,15 +236,41 @@ namespace sys {
 	/*!
 		@brief	データベースを開く
 		@param[in]	dbname	データベース名
+		@param[in]	cfg		設定
 		@return 成功なら「true」
 	 */
 	//-----------------------------------------------------------------//
-	bool sqlite::open(const char* dbname)
+	bool sqlite::open(const char* dbname, const config& cfg)
 	{
+		if(m_db != NULL) destroy();
+
 		sqlite3_open(dbname, &m_db);
 		if(sqlite3_errcode(m_db) != SQLITE_OK) {
+			sqlite3_close(m_db);
+			m_db = NULL;
 			return false;
 		}
+		m_config = cfg;
+		m_depth = 0;
+
+		if(cfg.busy_timeout_ > 0) {
+			sqlite3_busy_timeout(m_db, cfg.busy_timeout_);
+		}
+		if(cfg.wal_) {
+			command("PRAGMA journal_mode=WAL");
+		}
+		if(cfg.synchronous_ >= 0) {
+			command(("PRAGMA synchronous=" + std::to_string(cfg.synchronous_)).c_str());
+		}
+		if(cfg.mmap_size_ > 0) {
+			command(("PRAGMA mmap_size=" + std::to_string(cfg.mmap_size_)).c_str());
+		}
+		if(cfg.cache_size_ != 0) {
+			command(("PRAGMA cache_size=" + std::to_string(cfg.cache_size_)).c_str());
+		}
+		if(cfg.temp_memory_) {
+			command("PRAGMA temp_store=MEMORY");
+		}
 		return true;
 	}
 
@@ -59,6 +283,7 @@ namespace sys {
 	void sqlite::close()
 	{
 		if(m_db != NULL) {
+			clear_cache_();
 			sqlite3_close(m_db);
 			m_db = NULL;
 		}
@@ -77,20 +302,69 @@ namespace sys {
 		if(command == 0) return false;
 
 		sqlite3_stmt* stp = NULL;
-		sqlite3_prepare(m_db, command, -1, &stp, NULL);
+		sqlite3_prepare_v2(m_db, command, -1, &stp, NULL);
 		if(stp == NULL) {
 			std::cout << "sqlite error: '" << error_message() << "'" << std::endl;
 			return false;
 		}
 
-		while(sqlite3_step(stp) != SQLITE_DONE) ;
+		int ret;
+		while((ret = sqlite3_step(stp)) == SQLITE_ROW) ;
 
 		sqlite3_finalize(stp);
 
+		if(ret != SQLITE_DONE) {
+			std::cout << "sqlite error: '" << error_message() << "'" << std::endl;
+			return false;
+		}
 		return true;
 	}
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	キャッシュからステートメントを得る
+		@param[in]	sql	SQL テキスト
+		@return ステートメント
+	 */
+	//-----------------------------------------------------------------//
+	sqlite::statement sqlite::query(const std::string& sql)
+	{
+		if(m_db == NULL) return statement();
+
+		cache_map::iterator mit = m_cache_map.find(sql);
+		if(mit != m_cache_map.end() && mit->second->ref_ == 0) {
+			m_cache.splice(m_cache.begin(), m_cache, mit->second);
+			return statement(&*mit->second);
+		}
+
+		sqlite3_stmt* stp = NULL;
+#if SQLITE_VERSION_NUMBER >= 3020000
+		sqlite3_prepare_v3(m_db, sql.c_str(), static_cast<int>(sql.size()) + 1,
+			SQLITE_PREPARE_PERSISTENT, &stp, NULL);
+#else
+		sqlite3_prepare_v2(m_db, sql.c_str(), static_cast<int>(sql.size()) + 1, &stp, NULL);
+#endif
+		if(stp == NULL) {
+			std::cout << "sqlite error: '" << error_message() << "'" << std::endl;
+			return statement();
+		}
+
+		cache_t c;
+		c.sql_ = sql;
+		c.stmt_ = stp;
+		c.ref_ = 0;
+		m_cache.push_front(c);
+		// 同じ SQL が使用中の場合、新しい方はマップに登録しない（いずれ捨てられる）
+		if(mit == m_cache_map.end()) {
+			m_cache_map.emplace(sql, m_cache.begin());
+		}
+		statement st(&m_cache.front());
+		evict_cache_();
+		return st;
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	SQL ステートメントをコンパイル
@@ -152,7 +426,7 @@ namespace sys {
 
 	//-----------------------------------------------------------------//
 	/*!
-		@brief	廃棄
+		@brief	廃棄（query で得た statement は、先に破棄する事）
 	 */
 	//-----------------------------------------------------------------//
 	void sqlite::destroy()
@@ -161,6 +435,7 @@ namespace sys {
 			BOOST_FOREACH(sqlite3_stmt* stp, m_db_stmts) {
 				if(stp) sqlite3_finalize(stp);
 			}
+			m_db_stmts.clear();
 		}
 		close();
 	}
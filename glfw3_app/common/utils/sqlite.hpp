@@ -2,13 +2,24 @@
 #define SQLITE_HPP
 //=====================================================================//
 /*!	@file
-	@brief	SQLite3 ラッパー・クラス（ヘッダー）
+	@brief	SQLite3 ラッパー・クラス（ヘッダー） @n
+			・SQL テキストをキーとして、コンパイル済みステートメントを @n
+			キャッシュ（LRU）する。@n
+			・型付きのバインドとカラムの取得、RAII のトランザクション、@n
+			複数行をまとめて INSERT する inserter を持つ。@n
+			・WAL、mmap などのプラグマは config で設定する。@n
+			標準の config はジャーナル・モードを変えない（config::fast を参照）。
 	@author	平松邦仁 (hira@rvf-rc45.net)
 */
 //=====================================================================//
 #include <vector>
+#include <list>
+#include <string>
+#include <cstdint>
+#include <type_traits>
 #include <stdlib.h>
 #include <sqlite3.h>
+#include <boost/unordered_map.hpp>
 
 namespace sys {
 
@@ -18,7 +29,502 @@ namespace sys {
 	*/
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	class sqlite {
+	public:
+		//=================================================================//
+		/*!
+			@brief	データベースの設定（open 時にプラグマとして発行） @n
+					標準では、ジャーナル・モード、synchronous、mmap は @n
+					変えない（ファイルに残る WAL は、他のツールからも見える）。
+		*/
+		//=================================================================//
+		struct config {
+			bool		wal_;			///< journal_mode = WAL
+			int			synchronous_;	///< 0: OFF, 1: NORMAL, 2: FULL（負ならそのまま）
+			int64_t		mmap_size_;		///< mmap_size（０なら使わない）
+			int			cache_size_;	///< cache_size（負は KiB 単位、０ならそのまま）
+			bool		temp_memory_;	///< temp_store = MEMORY
+			int			busy_timeout_;	///< ビジー時の待ち時間（ミリ秒）
+			uint32_t	stmt_cache_;	///< ステートメント・キャッシュの最大数
+
+			config() : wal_(false), synchronous_(-1), mmap_size_(0),
+				cache_size_(-16 * 1024), temp_memory_(true), busy_timeout_(1000),
+				stmt_cache_(64) { }
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	大量の読み書き向けの設定 @n
+						WAL、synchronous = NORMAL、256 MiB の mmap を使う。
+				@return 設定
+			*/
+			//-------------------------------------------------------------//
+			static config fast() {
+				config c;
+				c.wal_ = true;
+				c.synchronous_ = 1;
+				c.mmap_size_ = 256 * 1024 * 1024;
+				return c;
+			}
+		};
+
+
+		//=================================================================//
+		/*!
+			@brief	値（inserter の行バッファ）
+		*/
+		//=================================================================//
+		struct value {
+			int			type_;	///< SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB, SQLITE_NULL
+			int64_t		i_;
+			double		d_;
+			std::string	s_;
+
+			value() : type_(SQLITE_NULL), i_(0), d_(0.0) { }
+
+			template <typename T>
+			typename std::enable_if<std::is_integral<T>::value>::type set(T v) {
+				type_ = SQLITE_INTEGER;
+				i_ = static_cast<int64_t>(v);
+			}
+			template <typename T>
+			typename std::enable_if<std::is_floating_point<T>::value>::type set(T v) {
+				type_ = SQLITE_FLOAT;
+				d_ = static_cast<double>(v);
+			}
+			void set(const std::string& v) { type_ = SQLITE_TEXT; s_ = v; }
+			void set(const char* v) {
+				if(v == nullptr) { type_ = SQLITE_NULL; return; }
+				type_ = SQLITE_TEXT;
+				s_ = v;
+			}
+			void set(std::nullptr_t) { type_ = SQLITE_NULL; }
+		};
+
+	private:
+		struct cache_t {
+			std::string		sql_;
+			sqlite3_stmt*	stmt_;
+			uint32_t		ref_;
+		};
+		typedef std::list<cache_t>	cache_list;
+		typedef boost::unordered_map<std::string, cache_list::iterator>	cache_map;
+
+	public:
+		//=================================================================//
+		/*!
+			@brief	ステートメント（query が返す） @n
+					キャッシュに保持されたステートメントを参照する。@n
+					破棄されると、リセットしてキャッシュに戻る。
+		*/
+		//=================================================================//
+		class statement {
+			friend class sqlite;
+
+			cache_t*		cache_;
+			sqlite3_stmt*	stmt_;
+			int				status_;
+
+			statement(cache_t* c) : cache_(c), stmt_(c != nullptr ? c->stmt_ : nullptr),
+				status_(c != nullptr ? SQLITE_OK : SQLITE_ERROR) {
+				if(cache_ != nullptr) ++cache_->ref_;
+			}
+
+			bool bind_(int idx, const value& v, sqlite3_destructor_type d);
+
+			void release_() {
+				if(cache_ != nullptr) {
+					sqlite3_reset(stmt_);
+					sqlite3_clear_bindings(stmt_);
+					--cache_->ref_;
+					cache_ = nullptr;
+					stmt_ = nullptr;
+				}
+			}
+
+			template <typename T, typename... Args>
+			bool bind_all_(int idx, const T& v, const Args&... args) {
+				if(!bind(idx, v)) return false;
+				return bind_all_(idx + 1, args...);
+			}
+			bool bind_all_(int idx) { return true; }
+
+		public:
+			statement() : cache_(nullptr), stmt_(nullptr), status_(SQLITE_ERROR) { }
+			statement(const statement&) = delete;
+			statement& operator = (const statement&) = delete;
+			statement(statement&& src) : cache_(src.cache_), stmt_(src.stmt_), status_(src.status_) {
+				src.cache_ = nullptr;
+				src.stmt_ = nullptr;
+			}
+			statement& operator = (statement&& src) {
+				if(this != &src) {
+					release_();
+					cache_ = src.cache_;
+					stmt_ = src.stmt_;
+					status_ = src.status_;
+					src.cache_ = nullptr;
+					src.stmt_ = nullptr;
+				}
+				return *this;
+			}
+			~statement() { release_(); }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	有効なステートメントか
+				@return 有効なら「true」
+			*/
+			//-------------------------------------------------------------//
+			bool is_valid() const { return stmt_ != nullptr; }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	最後の結果コードを取得
+				@return 結果コード（SQLITE_ROW、SQLITE_DONE など）
+			*/
+			//-------------------------------------------------------------//
+			int get_status() const { return status_; }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	ハンドルを取得（直接 sqlite3 API を使う場合）
+				@return ハンドル
+			*/
+			//-------------------------------------------------------------//
+			sqlite3_stmt* get() const { return stmt_; }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	値をバインド（idx は１から）
+				@param[in]	idx	パラメーター番号
+				@param[in]	v	値
+				@return 成功なら「true」
+			*/
+			//-------------------------------------------------------------//
+			template <typename T>
+			typename std::enable_if<std::is_integral<T>::value, bool>::type bind(int idx, T v) {
+				status_ = sqlite3_bind_int64(stmt_, idx, static_cast<sqlite3_int64>(v));
+				return status_ == SQLITE_OK;
+			}
+			template <typename T>
+			typename std::enable_if<std::is_floating_point<T>::value, bool>::type bind(int idx, T v) {
+				status_ = sqlite3_bind_double(stmt_, idx, static_cast<double>(v));
+				return status_ == SQLITE_OK;
+			}
+			/// 文字列はコピーするので、一時オブジェクトでも良い
+			bool bind(int idx, const std::string& v) {
+				status_ = sqlite3_bind_text(stmt_, idx, v.data(), static_cast<int>(v.size()), SQLITE_TRANSIENT);
+				return status_ == SQLITE_OK;
+			}
+			bool bind(int idx, const char* v) {
+				if(v == nullptr) status_ = sqlite3_bind_null(stmt_, idx);
+				else status_ = sqlite3_bind_text(stmt_, idx, v, -1, SQLITE_TRANSIENT);
+				return status_ == SQLITE_OK;
+			}
+			bool bind(int idx, std::nullptr_t) {
+				status_ = sqlite3_bind_null(stmt_, idx);
+				return status_ == SQLITE_OK;
+			}
+			bool bind(int idx, const value& v) { return bind_(idx, v, SQLITE_TRANSIENT); }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	バイナリーをバインド
+				@param[in]	idx		パラメーター番号
+				@param[in]	ptr		先頭（ステップが終わるまで保持する事）
+				@param[in]	size	サイズ
+				@return 成功なら「true」
+			*/
+			//-------------------------------------------------------------//
+			bool bind_blob(int idx, const void* ptr, size_t size) {
+				status_ = sqlite3_bind_blob(stmt_, idx, ptr, static_cast<int>(size), SQLITE_STATIC);
+				return status_ == SQLITE_OK;
+			}
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	全てのパラメーターを順番にバインド
+				@param[in]	args	値
+				@return 成功なら「true」
+			*/
+			//-------------------------------------------------------------//
+			template <typename... Args>
+			bool bind_all(const Args&... args) {
+				if(stmt_ == nullptr) return false;
+				return bind_all_(1, args...);
+			}
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	次の行へ進める
+				@return 行があれば「true」（終わりとエラーは「false」）
+			*/
+			//-------------------------------------------------------------//
+			bool next() {
+				if(stmt_ == nullptr) return false;
+				status_ = sqlite3_step(stmt_);
+				return status_ == SQLITE_ROW;
+			}
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	最後まで実行してリセット（バインドは残す）
+				@return 正常に終われば「true」
+			*/
+			//-------------------------------------------------------------//
+			bool exec() {
+				if(stmt_ == nullptr) return false;
+				while((status_ = sqlite3_step(stmt_)) == SQLITE_ROW) ;
+				bool f = status_ == SQLITE_DONE;
+				sqlite3_reset(stmt_);
+				return f;
+			}
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	リセット（バインドも消す）
+			*/
+			//-------------------------------------------------------------//
+			void reset() {
+				if(stmt_ == nullptr) return;
+				sqlite3_reset(stmt_);
+				sqlite3_clear_bindings(stmt_);
+			}
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	カラム数を取得
+				@return カラム数
+			*/
+			//-------------------------------------------------------------//
+			int columns() const { return sqlite3_column_count(stmt_); }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	カラムが NULL か
+				@param[in]	col	カラム番号（０から）
+				@return NULL なら「true」
+			*/
+			//-------------------------------------------------------------//
+			bool is_null(int col) const { return sqlite3_column_type(stmt_, col) == SQLITE_NULL; }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	カラムの値を取得
+				@param[in]	col	カラム番号（０から）
+				@param[out]	v	値
+			*/
+			//-------------------------------------------------------------//
+			template <typename T>
+			typename std::enable_if<std::is_integral<T>::value>::type get(int col, T& v) const {
+				v = static_cast<T>(sqlite3_column_int64(stmt_, col));
+			}
+			template <typename T>
+			typename std::enable_if<std::is_floating_point<T>::value>::type get(int col, T& v) const {
+				v = static_cast<T>(sqlite3_column_double(stmt_, col));
+			}
+			void get(int col, std::string& v) const {
+				const unsigned char* p = sqlite3_column_text(stmt_, col);
+				if(p == nullptr) v.clear();
+				else v.assign(reinterpret_cast<const char*>(p), sqlite3_column_bytes(stmt_, col));
+			}
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	カラムの値を取得
+				@param[in]	col	カラム番号（０から）
+				@return 値
+			*/
+			//-------------------------------------------------------------//
+			template <typename T>
+			T get(int col) const {
+				T v;
+				get(col, v);
+				return v;
+			}
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	カラムのバイナリーを取得（次のステップまで有効）
+				@param[in]	col		カラム番号（０から）
+				@param[out]	size	サイズ
+				@return 先頭
+			*/
+			//-------------------------------------------------------------//
+			const void* get_blob(int col, size_t& size) const {
+				const void* p = sqlite3_column_blob(stmt_, col);
+				size = sqlite3_column_bytes(stmt_, col);
+				return p;
+			}
+		};
+
+
+		//=================================================================//
+		/*!
+			@brief	トランザクション（RAII） @n
+					commit せずに破棄されるとロールバックする。@n
+					入れ子の場合は、SAVEPOINT になる。
+		*/
+		//=================================================================//
+		class transaction {
+			sqlite&		db_;
+			uint32_t	depth_;
+			bool		active_;
+
+		public:
+			//-------------------------------------------------------------//
+			/*!
+				@brief	コンストラクター（トランザクションを開始）
+				@param[in]	db	データベース
+			*/
+			//-------------------------------------------------------------//
+			transaction(sqlite& db);
+
+			transaction(const transaction&) = delete;
+			transaction& operator = (const transaction&) = delete;
+
+			~transaction() { rollback(); }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	開始できたか
+				@return 開始していれば「true」
+			*/
+			//-------------------------------------------------------------//
+			bool is_active() const { return active_; }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	コミット
+				@return 成功なら「true」
+			*/
+			//-------------------------------------------------------------//
+			bool commit();
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	ロールバック
+			*/
+			//-------------------------------------------------------------//
+			void rollback();
+		};
+
 
+		//=================================================================//
+		/*!
+			@brief	複数行の INSERT @n
+					「INSERT INTO t (a, b, c)」に、rows 行分の VALUES を付けた @n
+					ステートメントで、まとめて実行する。@n
+					※トランザクションは呼び出し側で張る事。@n
+					破棄される時、残った行を flush する。
+		*/
+		//=================================================================//
+		class inserter {
+			sqlite&				db_;
+			std::string			head_;
+			uint32_t			cols_;
+			uint32_t			rows_;
+			statement			full_;
+			std::vector<value>	buff_;
+			uint32_t			num_;
+			uint64_t			count_;
+			bool				error_;
+
+			std::string make_sql_(uint32_t rows) const;
+			bool exec_(statement& st, uint32_t rows);
+
+			template <typename T, typename... Args>
+			void set_(value* v, const T& t, const Args&... args) {
+				v->set(t);
+				set_(v + 1, args...);
+			}
+			void set_(value* v) { }
+
+		public:
+			//-------------------------------------------------------------//
+			/*!
+				@brief	コンストラクター
+				@param[in]	db		データベース
+				@param[in]	head	「INSERT INTO t (a, b, c)」など
+				@param[in]	cols	カラム数
+				@param[in]	rows	まとめる行数（パラメーター数の上限で制限される）
+			*/
+			//-------------------------------------------------------------//
+			inserter(sqlite& db, const std::string& head, uint32_t cols, uint32_t rows = 64);
+
+			inserter(const inserter&) = delete;
+			inserter& operator = (const inserter&) = delete;
+
+			~inserter() { flush(); }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	一行を追加
+				@param[in]	args	値（カラム数と同じ数）
+				@return エラーが無ければ「true」
+			*/
+			//-------------------------------------------------------------//
+			template <typename... Args>
+			bool add(const Args&... args) {
+				if(error_ || sizeof...(Args) != cols_) {
+					error_ = true;
+					return false;
+				}
+				set_(&buff_[num_ * cols_], args...);
+				++num_;
+				if(num_ >= rows_) {
+					if(!exec_(full_, num_)) error_ = true;
+					num_ = 0;
+				}
+				return !error_;
+			}
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	残った行を実行
+				@return エラーが無ければ「true」
+			*/
+			//-------------------------------------------------------------//
+			bool flush();
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	INSERT した行数を取得
+				@return 行数
+			*/
+			//-------------------------------------------------------------//
+			uint64_t get_count() const { return count_; }
+
+
+			//-------------------------------------------------------------//
+			/*!
+				@brief	エラーがあったか
+				@return エラーなら「true」
+			*/
+			//-------------------------------------------------------------//
+			bool get_error() const { return error_; }
+		};
+
+	private:
 		sqlite3*	m_db;
 
 		typedef std::vector<sqlite3_stmt*> db_stmts;
@@ -27,13 +533,21 @@ namespace sys {
 
 		db_stmts	m_db_stmts;
 
+		config		m_config;
+		cache_list	m_cache;
+		cache_map	m_cache_map;
+		uint32_t	m_depth;
+
+		void evict_cache_();
+		void clear_cache_();
+
 	public:
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	コンストラクター
 		*/
 		//-----------------------------------------------------------------//
-		sqlite() : m_db(NULL) { }
+		sqlite() : m_db(NULL), m_depth(0) { }
 
 
 		//-----------------------------------------------------------------//
@@ -62,14 +576,34 @@ namespace sys {
 		bool probe(const char* dbname);
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	データベースを開く（標準の config、ジャーナル・モードは変えない）
+			@param[in]	dbname	データベース名
+			@return 成功なら「true」
+		 */
+		//-----------------------------------------------------------------//
+		bool open(const char* dbname) { return open(dbname, config()); }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	データベースを開く
 			@param[in]	dbname	データベース名
+			@param[in]	cfg		設定
 			@return 成功なら「true」
 		 */
 		//-----------------------------------------------------------------//
-		bool open(const char* dbname);
+		bool open(const char* dbname, const config& cfg);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	設定を取得
+			@return 設定
+		 */
+		//-----------------------------------------------------------------//
+		const config& get_config() const { return m_config; }
 
 
 		//-----------------------------------------------------------------//
@@ -99,6 +633,60 @@ namespace sys {
 		bool command(const char* command);
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	キャッシュからステートメントを得る @n
+					無ければコンパイルしてキャッシュに加える。
+			@param[in]	sql	SQL テキスト
+			@return ステートメント（失敗なら is_valid() が「false」）
+		 */
+		//-----------------------------------------------------------------//
+		statement query(const std::string& sql);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	値をバインドして実行（キャッシュを使う）
+			@param[in]	sql		SQL テキスト
+			@param[in]	args	値
+			@return 正常なら「true」
+		 */
+		//-----------------------------------------------------------------//
+		template <typename... Args>
+		bool exec(const std::string& sql, const Args&... args) {
+			statement st = query(sql);
+			if(!st.bind_all(args...)) return false;
+			return st.exec();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	キャッシュされているステートメント数
+			@return ステートメント数
+		 */
+		//-----------------------------------------------------------------//
+		uint32_t get_cache_size() const { return static_cast<uint32_t>(m_cache.size()); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	最後に INSERT した行の ID
+			@return 行 ID
+		 */
+		//-----------------------------------------------------------------//
+		int64_t last_insert_rowid() const { return sqlite3_last_insert_rowid(m_db); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	最後のステートメントで変更された行数
+			@return 行数
+		 */
+		//-----------------------------------------------------------------//
+		int changes() const { return sqlite3_changes(m_db); }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	SQL ステートメントをコンパイル
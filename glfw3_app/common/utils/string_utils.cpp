@@ -9,8 +9,11 @@
 //=====================================================================//
 #include "utils/string_utils.hpp"
 #include <boost/format.hpp>
-#include <boost/lexical_cast.hpp>
 #include "utils/sjis_utf16.hpp"
+#include "utils/utf_conv.hpp"
+#include "utils/chars_conv.hpp"
+#include <cstring>
+#include <algorithm>
 
 #include <iostream>
 
@@ -19,9 +22,16 @@ namespace utils {
 	using namespace std;
 
 	bool string_to_hex(const std::string& src, uint32_t& dst)
+	{
+		return string_to_hex(src.data(), src.data() + src.size(), dst);
+	}
+
+
+	bool string_to_hex(const char* first, const char* last, uint32_t& dst) noexcept
 	{
 		uint32_t v = 0;
-		for(auto ch : src) {
+		for(const char* p = first; p < last; ++p) {
+			char ch = *p;
 			v <<= 4;
 			if(ch >= '0' && ch <= '9') v |= ch - '0';
 			else if(ch >= 'A' && ch <= 'F') v |= ch - 'A' + 10;
@@ -35,134 +45,77 @@ namespace utils {
 
 	bool string_to_hex(const std::string& src, std::vector<uint32_t>& dst, const std::string& spc)
 	{
-		string s;
-		for(auto ch : src) {
-			if(string_strchr(spc, ch) != nullptr) {
+		char_set set(spc.data(), spc.size());
+		return for_each_token(src.data(), src.data() + src.size(), set,
+			[&](const char* p, const char* e) {
 				uint32_t v;
-				if(string_to_hex(s, v)) {
-					dst.push_back(v);
-					s.clear();
-				} else {
-					return false;
-				}
-			} else {
-				s += ch;
-			}
-		}
-		if(!s.empty()) {
-			uint32_t v;
-			if(string_to_hex(s, v)) {
+				if(!string_to_hex(p, e, v)) return false;
 				dst.push_back(v);
-			} else {
-				return false;
-			}
-		}
-		return true;
+				return true;
+			});
 	}
 
 
 	bool string_to_int(const std::string& src, int32_t& dst)
 	{
-		try {
-			dst = boost::lexical_cast<int32_t>(src);
-		} catch(boost::bad_lexical_cast& bad) {
-			return false;
-		}
-		return true;
+		return from_chars_token(src.data(), src.data() + src.size(), dst);
 	}
 
 
 	bool string_to_int(const std::string& src, std::vector<int32_t>& dst, const std::string& spc)
 	{
-		try {
-			string s;
-			for(auto ch : src) {
-				if(string_strchr(spc, ch) != nullptr) {
-					int32_t v = boost::lexical_cast<int32_t>(s);
-					dst.push_back(v);
-					s.clear();
-				} else {
-					s += ch;
-				}
-			}
-			if(!s.empty()) {
-				int32_t v = boost::lexical_cast<int32_t>(s);
-				dst.push_back(v);
-			}
-		} catch(boost::bad_lexical_cast& bad) {
-			return false;
-		}
-		return true;
+		char_set set(spc.data(), spc.size());
+		return from_chars_array(src.data(), src.data() + src.size(), dst, set);
 	}
 
 
 	bool string_to_float(const std::string& src, float& dst)
 	{
-		try {
-			dst = boost::lexical_cast<float>(src);
-		} catch(boost::bad_lexical_cast& bad) {
-			return false;
-		}
-		return true;
+		return from_chars_token(src.data(), src.data() + src.size(), dst);
 	}
 
 
 	bool string_to_float(const std::string& src, std::vector<float>& dst, const std::string& spc)
 	{
-		try {
-			string s;
-			for(auto ch : src) {
-				if(string_strchr(spc, ch) != nullptr) {
-					float v = boost::lexical_cast<float>(s);
-					dst.push_back(v);
-					s.clear();
-				} else {
-					s += ch;
-				}
-			}
-			if(!s.empty()) {
-				float v = boost::lexical_cast<float>(s);
-				dst.push_back(v);
-			}
-		} catch(boost::bad_lexical_cast& bad) {
-			return false;
-		}
-		return true;
+		char_set set(spc.data(), spc.size());
+		return from_chars_array(src.data(), src.data() + src.size(), dst, set);
 	}
 
 
 	bool string_to_double(const std::string& src, double& dst)
 	{
-		try {
-			dst = boost::lexical_cast<double>(src);
-		} catch(boost::bad_lexical_cast& bad) {
-			return false;
-		}
-		return true;
+		return from_chars_token(src.data(), src.data() + src.size(), dst);
 	}
 
 
 	bool string_to_matrix4x4(const std::string& src, mtx::fmat4& dst)
 	{
-		std::vector<float> vv;
-		if(!string_to_float(src, vv)) {
+		float vv[16];
+		uint32_t n = 0;
+		char_set set(" ,:");
+		bool f = for_each_token(src.data(), src.data() + src.size(), set,
+			[&](const char* p, const char* e) {
+				float v;
+				if(!from_chars_token(p, e, v)) return false;
+				if(n < 16) vv[n] = v;
+				++n;
+				return true;
+			});
+		if(!f || n != 16) {
 			return false;
 		}
-		if(vv.size() == 16) {
-			for(int i = 0; i < 16; ++i) {
-				int j = ((i & 3) << 2) | ((i >> 2) & 3);
-				dst[j] = vv[i];
-			}
-			return true;
-		} else {
-			return false;
+		for(int i = 0; i < 16; ++i) {
+			int j = ((i & 3) << 2) | ((i >> 2) & 3);
+			dst[j] = vv[i];
 		}
+		return true;
 	}
 
 
 	//-----------------------------------------------------------------//
 	/*!
-		@brief	UTF-8 から UTF-16 への変換
+		@brief	UTF-8 から UTF-16 への変換 @n
+				変換先は先頭バイトの数で一度だけ広げ、最後に余りを詰める。
 		@param[in]	src	UTF-8 ソース
 		@param[out]	dst	UTF-16（追記）
 		@return 変換エラーが無ければ「true」
@@ -172,30 +125,14 @@ namespace utils {
 	{
 		if(src.empty()) return true;
 
-		bool f = true;
-		int cnt = 0;
-		uint16_t code = 0;
-		for(auto tc : src) {
-			uint8_t c = static_cast<uint8_t>(tc);
-			if(c < 0x80) { code = c; cnt = 0; }
-			else if((c & 0xf0) == 0xe0) { code = (c & 0x0f); cnt = 2; }
-			else if((c & 0xe0) == 0xc0) { code = (c & 0x1f); cnt = 1; }
-			else if((c & 0xc0) == 0x80) {
-				code <<= 6;
-				code |= c & 0x3f;
-				cnt--;
-				if(cnt == 0 && code < 0x80) {
-					code = 0;	// 不正なコードとして無視
-					f = false;
-				} else if(cnt < 0) {
-					code = 0;
-				}
-			}
-			if(cnt == 0 && code != 0) {
-				dst += code;
-				code = 0;
-			}
-		}
+		size_t org = dst.size();
+		dst.resize(org + utf::count_utf8_lead(src.data(), src.size()));
+		uint16_t* top = &dst[0];
+		uint16_t* out = top + org;
+		bool f = utf::decode_utf8<uint16_t>(src.data(), src.size(),
+			[&](const char* p, size_t n) { utf::widen(p, n, out); out += n; },
+			[&](uint16_t code) { *out++ = code; });
+		dst.resize(out - top);
 		return f;
 	}
 
@@ -212,33 +149,14 @@ namespace utils {
 	{
 		if(src.empty()) return false;
 
-		bool f = true;
-		int cnt = 0;
-		uint32_t code = 0;
-		for(auto tc : src) {
-			uint8_t c = static_cast<uint8_t>(tc);
-			if(c < 0x80) { code = c; cnt = 0; }
-			else if((c & 0xfe) == 0xfc) { code = (c & 0x03); cnt = 5; }
-			else if((c & 0xfc) == 0xf8) { code = (c & 0x07); cnt = 4; }
-			else if((c & 0xf8) == 0xf0) { code = (c & 0x0e); cnt = 3; }
-			else if((c & 0xf0) == 0xe0) { code = (c & 0x0f); cnt = 2; }
-			else if((c & 0xe0) == 0xc0) { code = (c & 0x1f); cnt = 1; }
-			else if((c & 0xc0) == 0x80) {
-				code <<= 6;
-				code |= c & 0x3f;
-				cnt--;
-				if(cnt == 0 && code < 0x80) {
-					code = 0;	// 不正なコードとして無視
-					f = false;
-				} else if(cnt < 0) {
-					code = 0;
-				}
-			}
-			if(cnt == 0 && code != 0) {
-				dst += code;
-				code = 0;
-			}
-		}
+		size_t org = dst.size();
+		dst.resize(org + utf::count_utf8_lead(src.data(), src.size()));
+		uint32_t* top = &dst[0];
+		uint32_t* out = top + org;
+		bool f = utf::decode_utf8<uint32_t>(src.data(), src.size(),
+			[&](const char* p, size_t n) { utf::widen(p, n, out); out += n; },
+			[&](uint32_t code) { *out++ = code; });
+		dst.resize(out - top);
 		return f;
 	}
 
@@ -255,22 +173,23 @@ namespace utils {
 	{
 		if(src.empty()) return false;
 
-		bool f = true;
-		for(auto code : src) {
-			if(code < 0x0080) {
-				dst += code;
-			} else if(code >= 0x0080 && code <= 0x07ff) {
-				dst += 0xc0 | ((code >> 6) & 0x1f);
-				dst += 0x80 | (code & 0x3f);
-			} else if(code >= 0x0800) {
-				dst += 0xe0 | ((code >> 12) & 0x0f);
-				dst += 0x80 | ((code >> 6) & 0x3f);
-				dst += 0x80 | (code & 0x3f);
+		const uint16_t* p = src.data();
+		size_t len = src.size();
+		size_t org = dst.size();
+		dst.resize(org + utf::count_utf8(p, len));
+		char* out = &dst[org];
+		size_t i = 0;
+		while(i < len) {
+			if(p[i] < 0x80) {
+				size_t n = utf::narrow(p + i, len - i, out);
+				out += n;
+				i += n;
 			} else {
-				f = false;
+				out = utf::put_utf8(p[i], out);
+				++i;
 			}
 		}
-		return f;
+		return true;
 	}
 
 
@@ -286,35 +205,47 @@ namespace utils {
 	{
 		if(src.empty()) return false;
 
+		const uint32_t* p = src.data();
+		size_t len = src.size();
+		size_t org = dst.size();
+		dst.resize(org + utf::count_utf8(p, len));
+		char* out = &dst[0] + org;
 		bool f = true;
-		for(auto code : src) {
+		size_t i = 0;
+		while(i < len) {
+			uint32_t code = p[i];
 			if(code < 0x0080) {
-				dst += code;
-			} else if(code >= 0x0080 && code <= 0x07ff) {
-				dst += 0xc0 | ((code >> 6) & 0x1f);
-				dst += 0x80 | (code & 0x3f);
-			} else if(code >= 0x0800 && code <= 0xffff) {
-				dst += 0xe0 | ((code >> 12) & 0x0f);
-				dst += 0x80 | ((code >> 6) & 0x3f);
-				dst += 0x80 | (code & 0x3f);
-			} else if(code >= 0x00010000 && code <= 0x001fffff) {
-				dst += 0xf0 | ((code >> 18) & 0x07); 
-				dst += 0x80 | ((code >> 12) & 0x3f);
-				dst += 0x80 | ((code >> 6) & 0x3f);
-				dst += 0x80 | (code & 0x3f);
-			} else if(code >= 0x00200000 && code <= 0x03ffffff) {
-				dst += 0xF8 | ((code >> 24) & 0x03);
-				dst += 0x80 | ((code >> 18) & 0x3f);
-				dst += 0x80 | ((code >> 12) & 0x3f);
-				dst += 0x80 | ((code >> 6) & 0x3f);
-				dst += 0x80 | (code & 0x3f);
-			} else if(code >= 0x04000000 && code <= 0x7fffffff) {
-				dst += 0xfc | ((code >> 30) & 0x01);
-				dst += 0x80 | ((code >> 24) & 0x3f);
-				dst += 0x80 | ((code >> 18) & 0x3f);
-				dst += 0x80 | ((code >> 12) & 0x3f);
-				dst += 0x80 | ((code >> 6) & 0x3f);
-				dst += 0x80 | (code & 0x3f);
+				size_t n = utf::narrow(p + i, len - i, out);
+				out += n;
+				i += n;
+				continue;
+			}
+			++i;
+			if(code <= 0x07ff) {
+				*out++ = 0xc0 | ((code >> 6) & 0x1f);
+				*out++ = 0x80 | (code & 0x3f);
+			} else if(code <= 0xffff) {
+				*out++ = 0xe0 | ((code >> 12) & 0x0f);
+				*out++ = 0x80 | ((code >> 6) & 0x3f);
+				*out++ = 0x80 | (code & 0x3f);
+			} else if(code <= 0x001fffff) {
+				*out++ = 0xf0 | ((code >> 18) & 0x07);
+				*out++ = 0x80 | ((code >> 12) & 0x3f);
+				*out++ = 0x80 | ((code >> 6) & 0x3f);
+				*out++ = 0x80 | (code & 0x3f);
+			} else if(code <= 0x03ffffff) {
+				*out++ = 0xF8 | ((code >> 24) & 0x03);
+				*out++ = 0x80 | ((code >> 18) & 0x3f);
+				*out++ = 0x80 | ((code >> 12) & 0x3f);
+				*out++ = 0x80 | ((code >> 6) & 0x3f);
+				*out++ = 0x80 | (code & 0x3f);
+			} else if(code <= 0x7fffffff) {
+				*out++ = 0xfc | ((code >> 30) & 0x01);
+				*out++ = 0x80 | ((code >> 24) & 0x3f);
+				*out++ = 0x80 | ((code >> 18) & 0x3f);
+				*out++ = 0x80 | ((code >> 12) & 0x3f);
+				*out++ = 0x80 | ((code >> 6) & 0x3f);
+				*out++ = 0x80 | (code & 0x3f);
 			} else {
 				f = false;
 			}
@@ -325,7 +256,9 @@ namespace utils {
 
 	//-----------------------------------------------------------------//
 	/*!
-		@brief	Shift-JIS から UTF-8(ucs2) への変換
+		@brief	Shift-JIS から UTF-8(ucs2) への変換 @n
+				0x7e 以上のバイトは、最大３バイトになるとして領域を確保し、@n
+				最後に余りを詰める。
 		@param[in]	src	Shift-JIS ソース
 		@param[out]	dst	UTF-8（追記）
 		@return 変換が正常なら「true」
@@ -334,28 +267,16 @@ namespace utils {
 	bool sjis_to_utf8(const std::string& src, std::string& dst) noexcept
 	{
 		if(src.empty()) return false;
-		wstring ws;
-		uint16_t wc = 0;
-		for(auto ch : src) {
-			uint8_t c = static_cast<uint8_t>(ch);
-			if(wc) {
-				if(0x40 <= c && c <= 0x7e) {
-					wc <<= 8;
-					wc |= c;
-					ws += sjis_to_utf16(wc);
-				} else if(0x80 <= c && c <= 0xfc) {
-					wc <<= 8;
-					wc |= c;
-					ws += sjis_to_utf16(wc);
-				}
-				wc = 0;
-			} else {
-				if(0x81 <= c && c <= 0x9f) wc = c;
-				else if(0xe0 <= c && c <= 0xfc) wc = c;
-				else ws += sjis_to_utf16(c);
-			}
-		}
-		utf16_to_utf8(ws, dst);
+
+		size_t len = src.size() + utf::count(src.data(), src.size(), 0x7e, 0xff) * 2;
+		size_t org = dst.size();
+		dst.resize(org + len);
+		char* top = &dst[0];
+		char* out = top + org;
+		utf::decode_sjis(src.data(), src.size(),
+			[&](const char* p, size_t n) { utf::copy(p, n, out); out += n; },
+			[&](uint16_t sjis) { out = utf::put_utf8(sjis_to_utf16(sjis), out); });
+		dst.resize(out - top);
 		return true;
 	}
 
@@ -371,16 +292,33 @@ namespace utils {
 	bool sjis_to_utf16(const std::string& src, wstring& dst) noexcept
 	{
 		if(src.empty()) return false;
-		std::string tmp;
-		bool f = sjis_to_utf8(src, tmp);
-		if(f) utf8_to_utf16(tmp, dst);
-		return f;
+
+		size_t org = dst.size();
+		dst.resize(org + src.size());
+		uint16_t* top = &dst[0];
+		uint16_t* out = top + org;
+		utf::decode_sjis(src.data(), src.size(),
+			[&](const char* p, size_t n) {
+				// NUL は捨てる（UTF-8 を経由していた時と同じ）
+				if(std::memchr(p, 0, n) == nullptr) {
+					utf::widen(p, n, out);
+					out += n;
+				} else {
+					for(size_t i = 0; i < n; ++i) {
+						if(p[i] != 0) *out++ = static_cast<uint8_t>(p[i]);
+					}
+				}
+			},
+			[&](uint16_t sjis) { *out++ = sjis_to_utf16(sjis); });
+		dst.resize(out - top);
+		return true;
 	}
 
 
 	//-----------------------------------------------------------------//
 	/*!
-		@brief	UTF-8 から Shift-JIS への変換
+		@brief	UTF-8 から Shift-JIS への変換 @n
+				変換後は、元の長さを超えないので、元の長さで領域を確保する。
 		@param[in]	src	UTF8 ソース
 		@param[out]	dst	Shift-JIS（追記）
 		@return 変換が正常なら「true」
@@ -390,17 +328,22 @@ namespace utils {
 	{
 		if(src.empty()) return false;
 
-		wstring ws;
-		utf8_to_utf16(src, ws);
-		for(auto wc : ws) {
-			uint16_t ww = utf16_to_sjis(wc);
-			if(ww <= 255) {
-				dst += ww;
-			} else {
-				dst += ww >> 8;
-				dst += ww & 0xff;
-			}
-		}
+		size_t org = dst.size();
+		dst.resize(org + src.size());
+		char* top = &dst[0];
+		char* out = top + org;
+		utf::decode_utf8<uint16_t>(src.data(), src.size(),
+			[&](const char* p, size_t n) { utf::copy(p, n, out); out += n; },
+			[&](uint16_t code) {
+				uint16_t ww = utf16_to_sjis(code);
+				if(ww <= 255) {
+					*out++ = ww;
+				} else {
+					*out++ = ww >> 8;
+					*out++ = ww & 0xff;
+				}
+			});
+		dst.resize(out - top);
 		return true;
 	}
 
@@ -417,9 +360,35 @@ namespace utils {
 	{
 		if(src.empty()) return false;
 
-		std::string tmp;
-		utf16_to_utf8(src, tmp);
-		utf8_to_sjis(tmp, dst);
+		const uint16_t* p = src.data();
+		size_t len = src.size();
+		size_t org = dst.size();
+		dst.resize(org + len * 2);
+		char* top = &dst[0];
+		char* out = top + org;
+		size_t i = 0;
+		while(i < len) {
+			uint16_t code = p[i];
+			if(code < 0x80) {
+				size_t n = utf::narrow(p + i, len - i, out);
+				i += n;
+				// NUL は捨てる（UTF-8 を経由していた時と同じ）
+				if(std::memchr(out, 0, n) != nullptr) {
+					n = std::remove(out, out + n, 0) - out;
+				}
+				out += n;
+				continue;
+			}
+			++i;
+			uint16_t ww = utf16_to_sjis(code);
+			if(ww <= 255) {
+				*out++ = ww;
+			} else {
+				*out++ = ww >> 8;
+				*out++ = ww & 0xff;
+			}
+		}
+		dst.resize(out - top);
 		return true;
 	}
 
@@ -39,6 +39,7 @@ namespace utils {
 	typedef std::vector<lstring>::const_iterator		lstrings_cit;
 
 	bool string_to_hex(const std::string& src, uint32_t& dst);
+	bool string_to_hex(const char* first, const char* last, uint32_t& dst) noexcept;
 	bool string_to_hex(const std::string& src, std::vector<uint32_t>& dst, const std::string& spc = " ,:");
 	bool string_to_int(const std::string& src, int32_t& dst);
 	bool string_to_int(const std::string& src, std::vector<int32_t>& dst, const std::string& spc = " ,:");
@@ -271,9 +272,7 @@ namespace utils {
 	*/
 	//-----------------------------------------------------------------//
 	inline bool utf16_to_utf32(const wstring& src, lstring& dst) noexcept {
-		for(auto ch : src) {
-			dst += ch;
-		}
+		dst.append(src.begin(), src.end());
 		return true;
 	}
 
@@ -0,0 +1,170 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	常駐スレッドによる並列ループ @n
+			スレッドは最初に作ったものを使い回し、run の度に作らない。@n
+			run を呼んだスレッドも仕事を分担する。@n
+			仕事の中から run を呼んだ場合や、他のスレッドが run を実行中の @n
+			場合は、呼んだスレッドだけで順番に処理する（デッドロックしない）。
+	@author	平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw3_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	task_pool クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class task_pool {
+	public:
+		typedef std::function<void (uint32_t)>	func_type;
+
+	private:
+		std::vector<std::thread>	threads_;
+
+		std::mutex					mtx_;
+		std::condition_variable		cv_;
+		std::condition_variable		done_cv_;
+		std::mutex					run_mtx_;
+
+		const func_type*			func_;
+		uint32_t					num_;
+		std::atomic<uint32_t>		next_;
+		uint32_t					busy_;
+		uint64_t					gen_;
+		bool						quit_;
+
+		static bool& in_pool_() {
+			static thread_local bool f = false;
+			return f;
+		}
+
+		void work_() {
+			in_pool_() = true;
+			uint32_t i;
+			while((i = next_.fetch_add(1)) < num_) {
+				(*func_)(i);
+			}
+			in_pool_() = false;
+		}
+
+		void worker_() {
+			uint64_t gen = 0;
+			for(;;) {
+				{
+					std::unique_lock<std::mutex> lk(mtx_);
+					cv_.wait(lk, [&] { return quit_ || gen_ != gen; });
+					if(quit_) return;
+					gen = gen_;
+				}
+				work_();
+				{
+					std::lock_guard<std::mutex> lk(mtx_);
+					if(--busy_ == 0) done_cv_.notify_one();
+				}
+			}
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+			@param[in]	threads	スレッド数（呼び出し側を含む、０ならハードウェアに合わせる）
+		*/
+		//-----------------------------------------------------------------//
+		explicit task_pool(uint32_t threads = 0) : func_(nullptr), num_(0), next_(0),
+			busy_(0), gen_(0), quit_(false)
+		{
+			if(threads == 0) {
+				threads = std::thread::hardware_concurrency();
+				if(threads == 0) threads = 1;
+				else if(threads > 8) threads = 8;
+			}
+			for(uint32_t i = 1; i < threads; ++i) {
+				threads_.emplace_back([this] { worker_(); });
+			}
+		}
+
+		task_pool(const task_pool&) = delete;
+		task_pool& operator = (const task_pool&) = delete;
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	デストラクター
+		*/
+		//-----------------------------------------------------------------//
+		~task_pool() {
+			{
+				std::lock_guard<std::mutex> lk(mtx_);
+				quit_ = true;
+			}
+			cv_.notify_all();
+			for(auto& th : threads_) th.join();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	スレッド数を得る（呼び出し側を含む）
+			@return スレッド数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t size() const { return threads_.size() + 1; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	func(0) ～ func(num - 1) を並列に実行し、終わるまで待つ @n
+					func は例外を投げない事。
+			@param[in]	num		仕事の数
+			@param[in]	func	仕事
+		*/
+		//-----------------------------------------------------------------//
+		void run(uint32_t num, const func_type& func) {
+			if(num == 0) return;
+			std::unique_lock<std::mutex> rl(run_mtx_, std::defer_lock);
+			if(threads_.empty() || num == 1 || in_pool_() || !rl.try_lock()) {
+				for(uint32_t i = 0; i < num; ++i) func(i);
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lk(mtx_);
+				func_ = &func;
+				num_ = num;
+				next_ = 0;
+				busy_ = threads_.size();
+				++gen_;
+			}
+			cv_.notify_all();
+			work_();
+			std::unique_lock<std::mutex> lk(mtx_);
+			done_cv_.wait(lk, [this] { return busy_ == 0; });
+			func_ = nullptr;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	共有のインスタンスを得る（初回に作る）
+			@return インスタンス
+		*/
+		//-----------------------------------------------------------------//
+		static task_pool& get_instance() {
+			static task_pool pool;
+			return pool;
+		}
+	};
+}
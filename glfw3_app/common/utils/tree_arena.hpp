@@ -0,0 +1,814 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	階層的構造を管理するテンプレート・クラス（アリーナ版） @n
+			tree_unit と同じインターフェースで、パスの要素名をインターン @n
+			し、ノードをアリーナ（固定長チャンク）に確保する。@n
+			各ノードは親へのポインターと子のベクターを持ち、@n
+			登録、検索は O(深さ)、子のリストは O(子の数) で得られる。@n
+			全体のリスト（前順、名前順）はキャッシュされ、@n
+			ツリーが変化した時だけ作り直される。@n
+			イテレーターはノードのポインターで、削除されるまで無効にならない。
+	@author	平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#ifndef NDEBUG
+#include <iostream>
+#endif
+#include <algorithm>
+#include <stack>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <boost/unordered_map.hpp>
+#include <boost/optional.hpp>
+
+namespace utils {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	ツリー・アリーナ・クラス・テンプレート
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <class T>
+	struct tree_arena {
+
+		struct unit_node;
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	ツリー・ユニット型@n
+					「T」型のユーザー定義をアトリビュート情報として付加
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct unit_t {
+			T				value;	///< ユーザー利用データ
+
+			typedef std::vector<unit_node*>	childs;
+			typedef typename childs::iterator		childs_it;
+			typedef typename childs::const_iterator	childs_cit;
+
+		private:
+			friend struct tree_arena;
+
+			uint32_t		id_;
+
+			childs			childs_;
+			bool			sorted_;	///< 子が名前順に並んでいる場合「true」
+
+		public:
+#ifndef NDEBUG
+			void list_all() const {
+				value.list_all();
+			}
+#endif
+			unit_t() : value(), id_(0), childs_(), sorted_(true) { }
+			void set_id(uint32_t id) { id_ = id; }
+			uint32_t get_id() const { return id_; }
+			bool is_childs_empty() const { return childs_.empty(); }
+			const childs& get_childs() const { return childs_; }
+		};
+
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	ノード型 @n
+					first がフル・パス、second がユニット（unordered_map の @n
+					要素と同じ形）
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct unit_node {
+			std::string		first;		///< フル・パス
+			unit_t			second;		///< ユニット
+
+		private:
+			friend struct tree_arena;
+
+			unit_node*			parent_;
+			const std::string*	name_;	///< インターンされた要素名
+			uint32_t			name_id_;
+			uint32_t			slot_;	///< アリーナ内の位置
+			uint32_t			depth_;	///< ルート直下が「１」
+			uint32_t			gen_;	///< 確保、開放の度に進む
+			bool				alive_;
+
+		public:
+			unit_node() : first(), second(), parent_(nullptr), name_(nullptr),
+				name_id_(0), slot_(0), depth_(0), gen_(0), alive_(false) { }
+
+			const unit_node* get_parent() const { return parent_; }
+			const std::string& get_name() const { return *name_; }
+			uint32_t get_depth() const { return depth_; }
+			/// 世代（ノードが削除、再利用されると変わるので、保持したイテレーターの検査に使う）
+			uint32_t get_gen() const { return gen_; }
+		};
+
+		typedef boost::optional<const T&>	optional_const_ref;	//< オプショナル参照型(const)
+		typedef boost::optional<T&>			optional_ref;		//< オプショナル参照型
+
+		typedef const unit_node*	unit_map_cit;
+		typedef unit_node*			unit_map_it;
+
+		typedef std::vector<unit_map_cit>	unit_map_cits;
+		typedef std::vector<unit_map_it>	unit_map_its;
+
+		static const uint32_t chunk_size = 1024;	///< アリーナのチャンク（ノード数）
+
+	private:
+		// アリーナ
+		std::vector<std::unique_ptr<unit_node[]> >	chunks_;
+		uint32_t			slot_count_;
+		std::vector<unit_node*>	free_;
+		uint32_t			size_;
+
+		// 要素名のインターン
+		typedef boost::unordered_map<std::string, uint32_t>	name_map;
+		name_map			name_map_;
+		std::deque<std::string>	names_;
+
+		// (親のスロット, 要素名) から子へ
+		typedef boost::unordered_map<uint64_t, unit_node*>	child_map;
+		child_map			child_map_;
+
+		unit_node			root_;
+
+		uint32_t			serial_id_;
+
+		// 前順リストのキャッシュ
+		unit_map_its		preorder_;
+		uint32_t			preorder_serial_;
+		bool				preorder_valid_;
+
+		std::string			current_path_;
+
+		typedef std::stack<std::string>		string_stack;
+		string_stack		stack_path_;
+
+		static uint64_t child_key_(const unit_node* parent, uint32_t name_id) {
+			return (static_cast<uint64_t>(parent->slot_) << 32) | name_id;
+		}
+
+
+		unit_node* alloc_node_() {
+			unit_node* n;
+			if(!free_.empty()) {
+				n = free_.back();
+				free_.pop_back();
+			} else {
+				if((slot_count_ % chunk_size) == 0) {
+					chunks_.emplace_back(new unit_node[chunk_size]);
+				}
+				n = &chunks_.back()[slot_count_ % chunk_size];
+				// スロット「０」はルート
+				n->slot_ = ++slot_count_;
+			}
+			n->alive_ = true;
+			++n->gen_;
+			++size_;
+			return n;
+		}
+
+
+		void free_node_(unit_node* n) {
+			n->alive_ = false;
+			++n->gen_;
+			n->first.clear();
+			n->second = unit_t();
+			n->parent_ = nullptr;
+			free_.push_back(n);
+			--size_;
+		}
+
+
+		uint32_t intern_(const std::string& name) {
+			auto ret = name_map_.emplace(name, static_cast<uint32_t>(names_.size()));
+			if(ret.second) {
+				names_.push_back(name);
+			}
+			return ret.first->second;
+		}
+
+
+		int32_t find_name_(const std::string& name) const {
+			auto cit = name_map_.find(name);
+			if(cit == name_map_.end()) return -1;
+			return static_cast<int32_t>(cit->second);
+		}
+
+
+		// フル・パスからノードを探す
+		unit_node* find_node_(const std::string& fpath) const {
+			const unit_node* n = &root_;
+			std::string s;
+			size_t i = 0;
+			while(i < fpath.size()) {
+				size_t j = fpath.find('/', i);
+				if(j == std::string::npos) j = fpath.size();
+				if(j > i) {
+					s.assign(fpath, i, j - i);
+					int32_t id = find_name_(s);
+					if(id < 0) return nullptr;
+					auto cit = child_map_.find(child_key_(n, id));
+					if(cit == child_map_.end()) return nullptr;
+					n = cit->second;
+				}
+				i = j + 1;
+			}
+			if(n == &root_) return nullptr;
+			return const_cast<unit_node*>(n);
+		}
+
+
+		bool install_(const std::string& key, const T& value, unit_node** out = nullptr)
+		{
+			std::string fpath;
+			if(!create_full_path(key, fpath)) {
+				return false;
+			}
+
+			bool f = false;
+			unit_node* n = &root_;
+			std::string s;
+			size_t i = 0;
+			while(i < fpath.size()) {
+				size_t j = fpath.find('/', i);
+				if(j == std::string::npos) j = fpath.size();
+				if(j > i) {
+					s.assign(fpath, i, j - i);
+					uint32_t id = intern_(s);
+					auto ret = child_map_.emplace(child_key_(n, id), nullptr);
+					if(ret.second) {
+						unit_node* c = alloc_node_();
+						c->first = n->first;
+						c->first += '/';
+						c->first += s;
+						c->second.value = value;
+						c->second.set_id(serial_id_);
+						++serial_id_;
+						c->parent_ = n;
+						c->name_ = &names_[id];
+						c->name_id_ = id;
+						c->depth_ = n->depth_ + 1;
+						auto& ch = n->second.childs_;
+						if(!ch.empty() && *c->name_ < *ch.back()->name_) {
+							n->second.sorted_ = false;
+						}
+						ch.push_back(c);
+						ret.first->second = c;
+						f = true;
+					} else {
+						f = false;
+					}
+					n = ret.first->second;
+				}
+				i = j + 1;
+			}
+			if(out != nullptr) *out = n;
+			return f;
+		}
+
+
+		void erase_node_(unit_node* n) {
+			for(unit_node* c : n->second.childs_) {
+				erase_node_(c);
+			}
+			child_map_.erase(child_key_(n->parent_, n->name_id_));
+			free_node_(n);
+		}
+
+
+		void sort_childs_(unit_node* n) {
+			if(n->second.sorted_) return;
+			auto& ch = n->second.childs_;
+			std::sort(ch.begin(), ch.end(), [] (const unit_node* l, const unit_node* r) {
+				return *l->name_ < *r->name_; }
+			);
+			n->second.sorted_ = true;
+		}
+
+
+		void build_preorder_() {
+			preorder_.clear();
+			preorder_.reserve(size_);
+			std::vector<unit_node*> stack;
+			sort_childs_(&root_);
+			for(auto it = root_.second.childs_.rbegin(); it != root_.second.childs_.rend(); ++it) {
+				stack.push_back(*it);
+			}
+			while(!stack.empty()) {
+				unit_node* n = stack.back();
+				stack.pop_back();
+				preorder_.push_back(n);
+				sort_childs_(n);
+				const auto& ch = n->second.childs_;
+				for(auto it = ch.rbegin(); it != ch.rend(); ++it) {
+					stack.push_back(*it);
+				}
+			}
+			preorder_serial_ = serial_id_;
+			preorder_valid_ = true;
+		}
+
+
+		void copy_(const tree_arena& src) {
+			clear();
+			std::vector<const unit_node*> stack(src.root_.second.childs_.begin(),
+				src.root_.second.childs_.end());
+			while(!stack.empty()) {
+				const unit_node* s = stack.back();
+				stack.pop_back();
+				unit_node* n;
+				install_(s->first, s->second.value, &n);
+				n->second.set_id(s->second.get_id());
+				stack.insert(stack.end(), s->second.childs_.begin(), s->second.childs_.end());
+			}
+			serial_id_ = src.serial_id_;
+			current_path_ = src.current_path_;
+			stack_path_ = src.stack_path_;
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		tree_arena() : chunks_(), slot_count_(0), free_(), size_(0),
+			name_map_(), names_(), child_map_(), root_(), serial_id_(0),
+			preorder_(), preorder_serial_(0), preorder_valid_(false),
+			current_path_(), stack_path_() { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コピー・コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		tree_arena(const tree_arena& src) : tree_arena() { copy_(src); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	デストラクター
+		*/
+		//-----------------------------------------------------------------//
+		~tree_arena() { clear(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	シリアルIDを取得 @n
+					ツリーが変化すると値が変わる
+			@return シリアルID
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_serial_id() const { return serial_id_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ユニット数を取得
+			@return ユニット数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t size() const { return size_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	クリア
+			@param[in]	all	全てをクリアする場合は「true」
+		*/
+		//-----------------------------------------------------------------//
+		void clear(bool all = true) {
+			chunks_.clear();
+			slot_count_ = 0;
+			free_.clear();
+			size_ = 0;
+			name_map_.clear();
+			names_.clear();
+			child_map_.clear();
+			root_.second = unit_t();
+			preorder_.clear();
+			preorder_valid_ = false;
+			current_path_.clear();
+			if(all) serial_id_ = 0;
+			else ++serial_id_;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	フルパスを生成
+			@param[in]	name	ベース名
+			@param[in]	fullpath	フル・パスを受け取るコンテナ
+			@return エラーが無ければ「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool create_full_path(const std::string& name, std::string& fullpath) const
+		{
+			if(name.empty()) return false;
+			if(name[0] == '/') {
+				fullpath = name;
+				return true;
+			}
+			fullpath += current_path_;
+			if(fullpath.empty() || fullpath.back() != '/') fullpath += '/';
+			fullpath += name;
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ユニットを登録
+			@param[in]	key		ユニットを識別するキー
+			@param[in]	value	値
+			@return 成功したら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool install(const std::string& key, const T& value)
+		{
+			return install_(key, value);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ユニットを削除（子も削除される）
+			@param[in]	key		ユニットを識別するキー
+			@return 成功したら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool erase(const std::string& key)
+		{
+			std::string fpath;
+			if(!create_full_path(key, fpath)) {
+				return false;
+			}
+
+			unit_node* n = find_node_(fpath);
+			if(n == nullptr) return false;
+
+			auto& ch = n->parent_->second.childs_;
+			ch.erase(std::find(ch.begin(), ch.end(), n));
+			erase_node_(n);
+			++serial_id_;
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	カレントのパスを退避
+		*/
+		//-----------------------------------------------------------------//
+		void push_current_path()
+		{
+			stack_path_.push(current_path_);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	カレントのパスを復帰
+		*/
+		//-----------------------------------------------------------------//
+		void pop_current_path()
+		{
+			if(!stack_path_.empty()) {
+				current_path_ = stack_path_.top();
+				stack_path_.pop();
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	カレントのパスをクリア
+		*/
+		//-----------------------------------------------------------------//
+		void clear_current_path()
+		{
+			current_path_.clear();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	カレントのパスを設定
+			@param[in]	path	パス
+			@return 正常なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool set_current_path(const std::string& path)
+		{
+			if(path.empty()) {
+				return false;
+			} else if(path[0] == '/') {	// 絶対パス
+				current_path_ = path;
+			} else {	// 相対パス
+				if(current_path_.empty() || current_path_.back() != '/') current_path_ += '/';
+				current_path_ += path;
+			}
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	カレント・パスを得る
+			@return カレントパス
+		*/
+		//-----------------------------------------------------------------//
+		const std::string& get_current_path() const { return current_path_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ディレクトリーを作成
+			@param[in]	name	ディレクトリー名
+			@return 正常なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool make_directory(const std::string& name)
+		{
+			T value;
+			return install_(name, value);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ユニットを探す
+			@param[in]	key	ユニット・キー
+			@return ユニットがあれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool find(const std::string& key) const {
+			std::string fullpath;
+			if(!create_full_path(key, fullpath)) {
+				return false;
+			}
+			return find_node_(fullpath) != nullptr;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ユニットのイテレーターを取得
+			@param[in]	key	ユニット・キー
+			@return 見つからない場合「nullptr」
+		*/
+		//-----------------------------------------------------------------//
+		unit_map_it find_it(const std::string& key) {
+			std::string fullpath;
+			if(!create_full_path(key, fullpath)) {
+				return nullptr;
+			}
+			return find_node_(fullpath);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ユニットを取得
+			@param[in]	key	ユニット・キー
+			@return ユニット・オプショナル型を返す
+		*/
+		//-----------------------------------------------------------------//
+		optional_const_ref get(const std::string& key) const
+		{
+			std::string fpath;
+			if(!create_full_path(key, fpath)) {
+				return boost::none;
+			}
+
+			unit_map_cit cit = find_node_(fpath);
+			if(cit == nullptr) {
+				return boost::none;
+			} else {
+				return optional_const_ref(cit->second.value);
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ディレクトリーかどうか？
+			@param[in]	key	ユニット・キー
+			@return ディレクトリーなら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool is_directory(const std::string& key) const
+		{
+			std::string fpath;
+			if(!create_full_path(key, fpath)) {
+				return false;
+			}
+			return is_directory(find_node_(fpath));
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	全体の前順（名前順）リストを得る @n
+					ツリーが変化していなければ、キャッシュを返す
+			@return 前順リスト
+		*/
+		//-----------------------------------------------------------------//
+		const unit_map_its& get_preorder()
+		{
+			if(!preorder_valid_ || preorder_serial_ != serial_id_) {
+				build_preorder_();
+			}
+			return preorder_;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	リストを作成する @n
+					root が空の場合、全体を前順（親の直後に子、兄弟は名前順）で、@n
+					それ以外は root の子を名前順で返す。
+			@param[in]	root	起点となるルートパス
+			@param[out]	list	リスト
+			@param[in]	id_sort	ID 順（登録順）でソートする場合「true」
+		*/
+		//-----------------------------------------------------------------//
+		void create_list(const std::string& root, unit_map_its& list, bool id_sort = false)
+		{
+			list.clear();
+			if(size_ == 0) {
+				return;
+			}
+
+			if(root.empty()) {
+				list = get_preorder();
+			} else {
+				std::string fullpath;
+				if(!create_full_path(root, fullpath)) {
+					return;
+				}
+				unit_node* n = find_node_(fullpath);
+				if(n == nullptr) return;
+				sort_childs_(n);
+				list = n->second.childs_;
+			}
+
+			if(id_sort) {
+				std::sort(list.begin(), list.end(), [] (unit_map_it l, unit_map_it r) {
+					return l->second.get_id() < r->second.get_id(); }
+				);
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	リストを作成する（const）
+			@param[in]	root	起点となるルートパス
+			@param[out]	list	リスト
+			@param[in]	id_sort	ID 順（登録順）でソートする場合「true」
+		*/
+		//-----------------------------------------------------------------//
+		void create_list(const std::string& root, unit_map_cits& list, bool id_sort = false)
+		{
+			unit_map_its its;
+			create_list(root, its, id_sort);
+			list.assign(its.begin(), its.end());
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	key の取得
+			@param[in]	cit	イテレーター
+			@return key の参照
+		*/
+		//-----------------------------------------------------------------//
+		const std::string& get_key(unit_map_cit cit) const { return cit->first; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	unit の取得
+			@param[in]	cit	イテレーター
+			@return unit の参照
+		*/
+		//-----------------------------------------------------------------//
+		const unit_t& get_unit(unit_map_cit cit) const { return cit->second; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	親の取得
+			@param[in]	cit	イテレーター
+			@return 親（ルート直下なら「nullptr」）
+		*/
+		//-----------------------------------------------------------------//
+		unit_map_it get_parent(unit_map_cit cit) const {
+			if(cit == nullptr || cit->parent_ == &root_) return nullptr;
+			return cit->parent_;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ディレクトリーかどうか？
+			@param[in]	cit	イテレーター
+			@return ディレクトリーなら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool is_directory(unit_map_cit cit) const
+		{
+			if(cit != nullptr) {
+				return !(cit->second.is_childs_empty());
+			} else {
+				return false;
+			}
+		}
+
+
+#ifndef NDEBUG
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	デバッグ用、全リスト表示
+		*/
+		//-----------------------------------------------------------------//
+		void list(const std::string& root = "")
+		{
+			unit_map_its its;
+			create_list(root, its);
+
+			// key の最大長さを探す
+			uint32_t ml = 0;
+			for(unit_map_cit cit : its) {
+				const std::string& key = cit->first;
+				if(key.size() > ml) ml = key.size();
+			}
+
+			for(unit_map_cit cit : its) {
+				const unit_t& t = cit->second;
+				if(t.is_childs_empty()) {
+					std::cout << "- ";
+				} else {
+					std::cout << "d ";
+				}
+
+				const std::string& key = cit->first;
+				std::cout << key;
+				for(uint32_t i = key.size(); i < ml; ++i) {
+					std::cout << " ";
+				}
+				std::cout << " ";
+				t.list_all();
+				std::cout << std::endl;
+			}
+
+			int n = its.size();
+
+			std::cout << "Total " << n << " file";
+			std::cout << ((n > 1) ? "s" : "") << std::endl << std::endl;
+		}
+#endif
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	swap
+		*/
+		//-----------------------------------------------------------------//
+		void swap(tree_arena& src) {
+			chunks_.swap(src.chunks_);
+			std::swap(slot_count_, src.slot_count_);
+			free_.swap(src.free_);
+			std::swap(size_, src.size_);
+			name_map_.swap(src.name_map_);
+			names_.swap(src.names_);
+			child_map_.swap(src.child_map_);
+			// ルートは実体なので、子の親ポインターを付け替える
+			std::swap(root_.second, src.root_.second);
+			for(unit_node* c : root_.second.childs_) c->parent_ = &root_;
+			for(unit_node* c : src.root_.second.childs_) c->parent_ = &src.root_;
+			std::swap(serial_id_, src.serial_id_);
+			preorder_valid_ = false;
+			src.preorder_valid_ = false;
+			current_path_.swap(src.current_path_);
+			stack_path_.swap(src.stack_path_);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	＝オペレーター
+		*/
+		//-----------------------------------------------------------------//
+		tree_arena& operator = (const tree_arena& src) {
+			if(this != &src) copy_(src);
+			return *this;
+		}
+	};
+}
@@ -0,0 +1,481 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	UTF-8, UTF-16, UTF-32, SJIS 変換の下請け @n
+			・ASCII が続く区間は、SSE2 が有効な場合、16 バイト単位 @n
+			（走査は 32 バイト単位）でまとめて判定、複写する。@n
+			・変換先の長さを先に求める関数を持ち、変換先の領域は @n
+			一度だけ確保する。@n
+			・UTF-8、SJIS の解読は、関数オブジェクトに ASCII の区間と、@n
+			一文字ずつのコードを渡す。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace utils {
+namespace utf {
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	先頭から、範囲 [lo, hi] のバイトが続く長さを求める
+		@param[in]	src	ソース
+		@param[in]	len	ソースの長さ
+		@param[in]	lo	範囲の下限
+		@param[in]	hi	範囲の上限
+		@return 範囲内のバイトが続く長さ
+	*/
+	//-----------------------------------------------------------------//
+	inline size_t span(const char* src, size_t len, uint8_t lo, uint8_t hi) noexcept
+	{
+		const uint8_t w = hi - lo;
+		size_t i = 0;
+#ifdef __SSE2__
+		// (c - lo) <= (hi - lo) を、符号無しの max で判定する
+		const __m128i l = _mm_set1_epi8(static_cast<char>(lo));
+		const __m128i k = _mm_set1_epi8(static_cast<char>(w));
+		for(; (i + 32) <= len; i += 32) {
+			__m128i a = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), l);
+			__m128i b = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16)), l);
+			__m128i m = _mm_max_epu8(_mm_max_epu8(a, b), k);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi8(m, k)) != 0xffff) break;
+		}
+		for(; (i + 16) <= len; i += 16) {
+			__m128i a = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), l);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(a, k), k)) != 0xffff) break;
+		}
+#endif
+		while(i < len && static_cast<uint8_t>(static_cast<uint8_t>(src[i]) - lo) <= w) ++i;
+		return i;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	バイト列を、UTF-16 に広げて複写
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@param[out]	dst	出力先
+	*/
+	//-----------------------------------------------------------------//
+	inline void widen(const char* src, size_t len, uint16_t* dst) noexcept
+	{
+		size_t i = 0;
+#ifdef __SSE2__
+		const __m128i z = _mm_setzero_si128();
+		for(; (i + 16) <= len; i += 16) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(a, z));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(a, z));
+		}
+#endif
+		for(; i < len; ++i) dst[i] = static_cast<uint8_t>(src[i]);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	バイト列を、UTF-32 に広げて複写
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@param[out]	dst	出力先
+	*/
+	//-----------------------------------------------------------------//
+	inline void widen(const char* src, size_t len, uint32_t* dst) noexcept
+	{
+		size_t i = 0;
+#ifdef __SSE2__
+		const __m128i z = _mm_setzero_si128();
+		for(; (i + 16) <= len; i += 16) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i lo = _mm_unpacklo_epi8(a, z);
+			__m128i hi = _mm_unpackhi_epi8(a, z);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),      _mm_unpacklo_epi16(lo, z));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4),  _mm_unpackhi_epi16(lo, z));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8),  _mm_unpacklo_epi16(hi, z));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), _mm_unpackhi_epi16(hi, z));
+		}
+#endif
+		for(; i < len; ++i) dst[i] = static_cast<uint8_t>(src[i]);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	ASCII（0x00 to 0x7f）が続く間、UTF-16 をバイト列に縮めて複写
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@param[out]	dst	出力先
+		@return 複写した数
+	*/
+	//-----------------------------------------------------------------//
+	inline size_t narrow(const uint16_t* src, size_t len, char* dst) noexcept
+	{
+		size_t i = 0;
+#ifdef __SSE2__
+		const __m128i m = _mm_set1_epi16(static_cast<short>(0xff80));
+		const __m128i z = _mm_setzero_si128();
+		for(; (i + 16) <= len; i += 16) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+			__m128i t = _mm_and_si128(_mm_or_si128(a, b), m);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi16(t, z)) != 0xffff) break;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+		}
+#endif
+		for(; i < len; ++i) {
+			if(src[i] >= 0x80) break;
+			dst[i] = src[i];
+		}
+		return i;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	ASCII（0x00 to 0x7f）が続く間、UTF-32 をバイト列に縮めて複写
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@param[out]	dst	出力先
+		@return 複写した数
+	*/
+	//-----------------------------------------------------------------//
+	inline size_t narrow(const uint32_t* src, size_t len, char* dst) noexcept
+	{
+		size_t i = 0;
+#ifdef __SSE2__
+		const __m128i m = _mm_set1_epi32(static_cast<int>(0xffffff80));
+		const __m128i z = _mm_setzero_si128();
+		for(; (i + 16) <= len; i += 16) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12));
+			__m128i t = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), m);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(t, z)) != 0xffff) break;
+			__m128i ab = _mm_packs_epi32(a, b);
+			__m128i cd = _mm_packs_epi32(c, d);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(ab, cd));
+		}
+#endif
+		for(; i < len; ++i) {
+			if(src[i] >= 0x80) break;
+			dst[i] = src[i];
+		}
+		return i;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	範囲 [lo, hi] のバイトの数を数える
+		@param[in]	src	ソース
+		@param[in]	len	ソースの長さ
+		@param[in]	lo	範囲の下限
+		@param[in]	hi	範囲の上限
+		@return 範囲内のバイトの数
+	*/
+	//-----------------------------------------------------------------//
+	inline size_t count(const char* src, size_t len, uint8_t lo, uint8_t hi) noexcept
+	{
+		const uint8_t w = hi - lo;
+		size_t n = 0;
+		size_t i = 0;
+#ifdef __SSE2__
+		const __m128i l = _mm_set1_epi8(static_cast<char>(lo));
+		const __m128i k = _mm_set1_epi8(static_cast<char>(w));
+		const __m128i z = _mm_setzero_si128();
+		while((i + 16) <= len) {
+			// ８ビットの計数が溢れないように、255 回毎に集計する
+			size_t blk = (len - i) / 16;
+			if(blk > 255) blk = 255;
+			__m128i acc = z;
+			for(; blk > 0; --blk, i += 16) {
+				__m128i a = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), l);
+				acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_max_epu8(a, k), k));
+			}
+			__m128i s = _mm_sad_epu8(acc, z);
+			n += _mm_cvtsi128_si32(s) + _mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+		}
+#endif
+		for(; i < len; ++i) {
+			n += static_cast<uint8_t>(static_cast<uint8_t>(src[i]) - lo) <= w;
+		}
+		return n;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	UTF-8 の、先頭バイト（継続バイト以外）の数を数える @n
+				（正しい UTF-8 なら、文字数と一致し、そうでなければ上限になる）
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@return 先頭バイトの数
+	*/
+	//-----------------------------------------------------------------//
+	inline size_t count_utf8_lead(const char* src, size_t len) noexcept
+	{
+		return len - count(src, len, 0x80, 0xbf);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	UTF-16 を UTF-8 にした時のバイト数
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@return バイト数
+	*/
+	//-----------------------------------------------------------------//
+	inline size_t count_utf8(const uint16_t* src, size_t len) noexcept
+	{
+		size_t n = 0;
+		size_t i = 0;
+#ifdef __SSE2__
+		// ３バイトから、0x80 未満、0x800 未満の数を引く
+		const __m128i m1 = _mm_set1_epi16(static_cast<short>(0xff80));
+		const __m128i m2 = _mm_set1_epi16(static_cast<short>(0xf800));
+		const __m128i z = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi16(1);
+		while((i + 8) <= len) {
+			size_t blk = (len - i) / 8;
+			if(blk > 8192) blk = 8192;
+			n += blk * 8 * 3;
+			__m128i acc = z;
+			for(; blk > 0; --blk, i += 8) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				acc = _mm_sub_epi16(acc, _mm_cmpeq_epi16(_mm_and_si128(v, m1), z));
+				acc = _mm_sub_epi16(acc, _mm_cmpeq_epi16(_mm_and_si128(v, m2), z));
+			}
+			__m128i s = _mm_madd_epi16(acc, one);
+			s = _mm_add_epi32(s, _mm_srli_si128(s, 8));
+			s = _mm_add_epi32(s, _mm_srli_si128(s, 4));
+			n -= static_cast<uint32_t>(_mm_cvtsi128_si32(s));
+		}
+#endif
+		for(; i < len; ++i) {
+			uint16_t c = src[i];
+			n += 1 + (c >= 0x0080) + (c >= 0x0800);
+		}
+		return n;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	UTF-32 を UTF-8 にした時のバイト数（範囲外のコードは「０」）
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@return バイト数
+	*/
+	//-----------------------------------------------------------------//
+	inline size_t count_utf8(const uint32_t* src, size_t len) noexcept
+	{
+		size_t n = 0;
+		size_t i = 0;
+#ifdef __SSE2__
+		// 0x10000 未満の４文字は、UTF-16 と同じく数える
+		const __m128i m1 = _mm_set1_epi32(static_cast<int>(0xffffff80));
+		const __m128i m2 = _mm_set1_epi32(static_cast<int>(0xfffff800));
+		const __m128i m3 = _mm_set1_epi32(static_cast<int>(0xffff0000));
+		const __m128i z = _mm_setzero_si128();
+		__m128i acc = z;
+		size_t vn = 0;
+		for(; (i + 4) <= len; i += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v, m3), z)) != 0xffff) {
+				for(size_t j = 0; j < 4; ++j) {
+					uint32_t c = src[i + j];
+					if(c > 0x7fffffff) continue;
+					n += 1 + (c >= 0x0080) + (c >= 0x0800) + (c >= 0x00010000)
+						+ (c >= 0x00200000) + (c >= 0x04000000);
+				}
+				continue;
+			}
+			acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_and_si128(v, m1), z));
+			acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_and_si128(v, m2), z));
+			vn += 4;
+		}
+		alignas(16) uint32_t t[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(t), acc);
+		n += vn * 3 - (static_cast<size_t>(t[0]) + t[1] + t[2] + t[3]);
+#endif
+		for(; i < len; ++i) {
+			uint32_t c = src[i];
+			if(c > 0x7fffffff) continue;
+			n += 1 + (c >= 0x0080) + (c >= 0x0800) + (c >= 0x00010000)
+				+ (c >= 0x00200000) + (c >= 0x04000000);
+		}
+		return n;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	短い区間の複写（短い場合は、関数を呼ばない）
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@param[out]	dst	出力先
+	*/
+	//-----------------------------------------------------------------//
+	inline void copy(const char* src, size_t len, char* dst) noexcept
+	{
+		if(len < 16) {
+			for(size_t i = 0; i < len; ++i) dst[i] = src[i];
+		} else {
+			std::memcpy(dst, src, len);
+		}
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	UTF-16 の１文字を UTF-8 に変換（サロゲートは、そのまま３バイト）
+		@param[in]	code	コード
+		@param[out]	dst		出力先
+		@return 出力の次
+	*/
+	//-----------------------------------------------------------------//
+	inline char* put_utf8(uint16_t code, char* dst) noexcept
+	{
+		if(code < 0x0080) {
+			*dst++ = code;
+		} else if(code < 0x0800) {
+			*dst++ = 0xc0 | ((code >> 6) & 0x1f);
+			*dst++ = 0x80 | (code & 0x3f);
+		} else {
+			*dst++ = 0xe0 | ((code >> 12) & 0x0f);
+			*dst++ = 0x80 | ((code >> 6) & 0x3f);
+			*dst++ = 0x80 | (code & 0x3f);
+		}
+		return dst;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	UTF-8 の解読 @n
+				・run(ptr, len) には、NUL 以外の ASCII の区間が渡される。@n
+				・put(code) には、それ以外で解読できた文字が渡される。@n
+				・NUL と、不正なシーケンスは捨てる。@n
+				・T が uint16_t の場合、４バイト以上のシーケンスは捨てる。
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@param[in]	run	ASCII 区間を受け取る関数
+		@param[in]	put	コードを受け取る関数
+		@return 不正なコードが無ければ「true」
+	*/
+	//-----------------------------------------------------------------//
+	template <typename T, class RUN, class PUT>
+	bool decode_utf8(const char* src, size_t len, RUN run, PUT put)
+	{
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(src);
+		bool f = true;
+		int cnt = 0;
+		T code = 0;
+		size_t i = 0;
+		while(i < len) {
+			uint8_t c = p[i];
+			if(c < 0x80) {
+				size_t n = span(src + i, len - i, 0x01, 0x7f);
+				if(n > 0) run(src + i, n);
+				else ++n;  // NUL
+				i += n;
+				cnt = 0;
+				code = 0;
+				continue;
+			}
+			// 完結した２、３バイトのシーケンスは、まとめて解読する
+			if((c & 0xf0) == 0xe0 && (i + 2) < len
+				&& (p[i + 1] & 0xc0) == 0x80 && (p[i + 2] & 0xc0) == 0x80) {
+				T t = ((c & 0x0f) << 12) | ((p[i + 1] & 0x3f) << 6) | (p[i + 2] & 0x3f);
+				if(t < 0x80) f = false;
+				else put(t);
+				i += 3;
+				cnt = 0;
+				code = 0;
+				continue;
+			}
+			if((c & 0xe0) == 0xc0 && (i + 1) < len && (p[i + 1] & 0xc0) == 0x80) {
+				T t = ((c & 0x1f) << 6) | (p[i + 1] & 0x3f);
+				if(t < 0x80) f = false;
+				else put(t);
+				i += 2;
+				cnt = 0;
+				code = 0;
+				continue;
+			}
+			++i;
+			if(sizeof(T) >= 4 && (c & 0xfe) == 0xfc) { code = (c & 0x03); cnt = 5; }
+			else if(sizeof(T) >= 4 && (c & 0xfc) == 0xf8) { code = (c & 0x07); cnt = 4; }
+			else if(sizeof(T) >= 4 && (c & 0xf8) == 0xf0) { code = (c & 0x0e); cnt = 3; }
+			else if((c & 0xf0) == 0xe0) { code = (c & 0x0f); cnt = 2; }
+			else if((c & 0xe0) == 0xc0) { code = (c & 0x1f); cnt = 1; }
+			else if((c & 0xc0) == 0x80) {
+				code <<= 6;
+				code |= c & 0x3f;
+				cnt--;
+				if(cnt == 0 && code < 0x80) {
+					code = 0;	// 不正なコードとして無視
+					f = false;
+				} else if(cnt < 0) {
+					code = 0;
+				}
+			}
+			if(cnt == 0 && code != 0) {
+				put(code);
+				code = 0;
+			}
+		}
+		return f;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	SJIS の解読 @n
+				・run(ptr, len) には、0x00 to 0x7d の区間が渡される。@n
+				・put(sjis) には、それ以外の SJIS コード（１、２バイト）が渡される。@n
+				・２バイト目が範囲外の場合、２バイトとも捨てる。
+		@param[in]	src	ソース
+		@param[in]	len	長さ
+		@param[in]	run	区間を受け取る関数
+		@param[in]	put	SJIS コードを受け取る関数
+	*/
+	//-----------------------------------------------------------------//
+	template <class RUN, class PUT>
+	void decode_sjis(const char* src, size_t len, RUN run, PUT put)
+	{
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(src);
+		size_t i = 0;
+		while(i < len) {
+			uint8_t c = p[i];
+			if(c < 0x7e) {
+				size_t n = span(src + i, len - i, 0x00, 0x7d);
+				run(src + i, n);
+				i += n;
+				continue;
+			}
+			++i;
+			if((0x81 <= c && c <= 0x9f) || (0xe0 <= c && c <= 0xfc)) {
+				if(i >= len) break;
+				uint8_t d = p[i++];
+				if((0x40 <= d && d <= 0x7e) || (0x80 <= d && d <= 0xfc)) {
+					put(static_cast<uint16_t>((c << 8) | d));
+				}
+			} else {
+				put(static_cast<uint16_t>(c));
+			}
+		}
+	}
+}
+}
@@ -0,0 +1,530 @@
+//=====================================================================//
+/*!	@file
+	@brief	zip アーカイブ（読み出し専用）クラス
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include "utils/zip_archive.hpp"
+#include <cctype>
+#include <iterator>
+#include <zlib.h>
+
+namespace {
+
+	inline uint16_t get16_(const char* p) {
+		const uint8_t* q = reinterpret_cast<const uint8_t*>(p);
+		return q[0] | (q[1] << 8);
+	}
+
+	inline uint32_t get32_(const char* p) {
+		const uint8_t* q = reinterpret_cast<const uint8_t*>(p);
+		return q[0] | (q[1] << 8) | (q[2] << 16) | (static_cast<uint32_t>(q[3]) << 24);
+	}
+
+	static const uint32_t sig_local_ = 0x04034b50;
+	static const uint32_t sig_central_ = 0x02014b50;
+	static const uint32_t sig_end_ = 0x06054b50;
+
+	static const uint32_t local_header_size_ = 30;
+	static const uint32_t central_header_size_ = 46;
+	static const uint32_t end_record_size_ = 22;
+
+	// open_path で開いたアーカイブ（先頭が最近使った物）
+	struct path_cache {
+		typedef std::pair<std::string, std::shared_ptr<utils::zip_archive> >	item;
+		std::mutex			mtx_;
+		std::list<item>		list_;
+		uint32_t			limit_;
+		path_cache() : limit_(utils::zip_archive::default_path_cache) { }
+
+		// 先頭に移して返す（mtx_ をロックして呼ぶ）
+		std::shared_ptr<utils::zip_archive> find(const std::string& arc) {
+			for(auto it = list_.begin(); it != list_.end(); ++it) {
+				if(it->first == arc) {
+					list_.splice(list_.begin(), list_, it);
+					return it->second;
+				}
+			}
+			return std::shared_ptr<utils::zip_archive>();
+		}
+	};
+
+	path_cache& get_path_cache_() {
+		static path_cache pc;
+		return pc;
+	}
+
+	// リンクされたら、file_io のオープン・フックに登録する
+	struct hook_installer {
+		hook_installer() { utils::file_io::set_open_hook(utils::zip_archive::open_path); }
+	};
+	hook_installer hook_installer_;
+}
+
+namespace utils {
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	セントラル・ディレクトリーを解析して索引を作る
+		@return 正常なら「true」
+	*/
+	//-----------------------------------------------------------------//
+	bool zip_archive::parse_directory_()
+	{
+		if(size_ < end_record_size_) return false;
+
+		// 終端レコードを後ろから探す（コメントは最大 65535 バイト）
+		size_t lim = size_ > (end_record_size_ + 0xffff) ? size_ - end_record_size_ - 0xffff : 0;
+		size_t pos = size_ - end_record_size_;
+		const char* end = nullptr;
+		while(1) {
+			if(get32_(top_ + pos) == sig_end_) {
+				end = top_ + pos;
+				break;
+			}
+			if(pos == lim) break;
+			--pos;
+		}
+		if(end == nullptr) return false;
+
+		uint32_t num = get16_(end + 10);
+		uint32_t cd_size = get32_(end + 12);
+		uint32_t cd_ofs  = get32_(end + 16);
+		// ZIP64 は扱わない
+		if(num == 0xffff || cd_ofs == 0xffffffff) return false;
+		if((static_cast<size_t>(cd_ofs) + cd_size) > pos) return false;
+
+		entries_.reserve(num);
+		const char* p = top_ + cd_ofs;
+		const char* e = p + cd_size;
+		for(uint32_t i = 0; i < num; ++i) {
+			if((p + central_header_size_) > e) return false;
+			if(get32_(p) != sig_central_) return false;
+			uint32_t nl = get16_(p + 28);
+			uint32_t xl = get16_(p + 30);
+			uint32_t cl = get16_(p + 32);
+			if((p + central_header_size_ + nl + xl + cl) > e) return false;
+
+			std::string fn(p + central_header_size_, nl);
+			if(!fn.empty() && fn.back() == '/') {	// ディレクトリーはファイルに含めない
+				dirs_.push_back(fn);
+			} else {
+				entry t;
+				t.path_   = fn;
+				t.flags_  = get16_(p + 8);
+				t.method_ = get16_(p + 10);
+				t.time_   = get16_(p + 12);
+				t.date_   = get16_(p + 14);
+				t.crc_    = get32_(p + 16);
+				t.csize_  = get32_(p + 20);
+				t.usize_  = get32_(p + 24);
+				t.ofs_    = get32_(p + 42);
+				zmap::iterator it = zmap_.find(fn);
+				if(it == zmap_.end()) {
+					zmap_.emplace(fn, static_cast<uint32_t>(entries_.size()));
+					entries_.push_back(t);
+				} else {
+					entries_[it->second] = t;
+				}
+			}
+			p += central_header_size_ + nl + xl + cl;
+		}
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	エントリーのデータ先頭を得る（ローカル・ヘッダーを読み飛ばす）
+		@param[in]	e	エントリー
+		@return データの先頭（不正なら nullptr）
+	*/
+	//-----------------------------------------------------------------//
+	const char* zip_archive::entry_data_(const entry& e) const
+	{
+		size_t ofs = e.ofs_;
+		if((ofs + local_header_size_) > size_) return nullptr;
+		const char* p = top_ + ofs;
+		if(get32_(p) != sig_local_) return nullptr;
+		ofs += local_header_size_ + get16_(p + 26) + get16_(p + 28);
+		if((ofs + e.csize_) > size_) return nullptr;
+		return top_ + ofs;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	deflate エントリーを展開する
+		@param[in]	index	ファイル番号
+		@return 展開したデータ（失敗したら空）
+	*/
+	//-----------------------------------------------------------------//
+	zip_archive::blob_ptr zip_archive::inflate_(uint32_t index) const
+	{
+		const entry& e = entries_[index];
+		const char* src = entry_data_(e);
+		if(src == nullptr) return blob_ptr();
+
+		// 展開後のサイズは信用できないので、上限と圧縮率で制限する
+		if(e.usize_ > max_entry_size) return blob_ptr();
+		if(e.usize_ > (static_cast<uint64_t>(e.csize_) * max_deflate_ratio + 1024)) return blob_ptr();
+		if(e.usize_ > (static_cast<uint64_t>(size_) * max_deflate_ratio)) return blob_ptr();
+
+		auto blob = std::make_shared<std::vector<char> >(e.usize_);
+		if(e.usize_ == 0) return blob;
+
+		z_stream zs;
+		std::memset(&zs, 0, sizeof(zs));
+		if(inflateInit2(&zs, -MAX_WBITS) != Z_OK) return blob_ptr();
+		zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(src));
+		zs.avail_in  = e.csize_;
+		zs.next_out  = reinterpret_cast<Bytef*>(&(*blob)[0]);
+		zs.avail_out = e.usize_;
+		int ret = inflate(&zs, Z_FINISH);
+		uLong out = zs.total_out;
+		inflateEnd(&zs);
+		if(ret != Z_STREAM_END || out != e.usize_) return blob_ptr();
+
+		uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(&(*blob)[0]), e.usize_);
+		if(crc != e.crc_) return blob_ptr();
+
+		return blob;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	deflate エントリーを展開する（例外を投げない） @n
+				失敗した場合はエラーの回数を数える。@n
+				※mtx_ をロックせずに呼ぶ
+		@param[in]	index	ファイル番号
+		@return 展開したデータ（失敗したら空）
+	*/
+	//-----------------------------------------------------------------//
+	zip_archive::blob_ptr zip_archive::inflate_safe_(uint32_t index)
+	{
+		blob_ptr blob;
+		try {
+			blob = inflate_(index);
+		} catch(...) {
+			blob.reset();
+		}
+		if(!blob) {
+			std::lock_guard<std::mutex> lock(mtx_);
+			++errors_;
+		}
+		return blob;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	キャッシュに登録して、上限を超えた分を古い順に捨てる @n
+				※mtx_ をロックして呼ぶ
+		@param[in]	index	ファイル番号
+		@param[in]	blob	展開したデータ
+	*/
+	//-----------------------------------------------------------------//
+	void zip_archive::insert_(uint32_t index, const blob_ptr& blob)
+	{
+		cache_t& c = cache_[index];
+		c.state_ = state::ready;
+		c.blob_ = blob;
+		lru_.push_front(index);
+		c.lru_ = lru_.begin();
+		cache_bytes_ += blob->size();
+
+		while(cache_bytes_ > cache_limit_ && lru_.size() > 1) {
+			uint32_t idx = lru_.back();
+			lru_.pop_back();
+			cache_t& t = cache_[idx];
+			cache_bytes_ -= t.blob_->size();
+			t.blob_.reset();
+			t.state_ = state::none;
+		}
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	展開ワーカー
+	*/
+	//-----------------------------------------------------------------//
+	void zip_archive::worker_()
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		while(1) {
+			job_cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+			if(stop_) break;
+
+			uint32_t idx = jobs_.front();
+			jobs_.pop_front();
+			// get() が先に取った場合は何もしない
+			if(cache_[idx].state_ != state::queued) continue;
+			cache_[idx].state_ = state::busy;
+
+			lock.unlock();
+			blob_ptr blob = inflate_safe_(idx);
+			lock.lock();
+
+			if(blob) {
+				insert_(idx, blob);
+			} else {
+				cache_[idx].state_ = state::none;
+			}
+			done_cv_.notify_all();
+		}
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	アーカイブを開く
+		@param[in]	archive	アーカイブ・ファイル名
+		@param[in]	threads	展開スレッド数（０ならハードウェアに合わせる）
+		@param[in]	cache_limit	キャッシュの上限（バイト）
+		@return エラーが無ければ「true」
+	*/
+	//-----------------------------------------------------------------//
+	bool zip_archive::open(const std::string& archive, uint32_t threads, size_t cache_limit)
+	{
+		close();
+
+		auto fio = std::make_shared<file_io>();
+		if(!fio->open_map(archive)) return false;
+		top_ = static_cast<const char*>(fio->get_span());
+		if(top_ == nullptr) return false;
+		size_ = fio->get_file_size();
+		map_ = fio;
+
+		if(!parse_directory_()) {
+			close();
+			return false;
+		}
+
+		zname_ = archive;
+		cache_.resize(entries_.size());
+		cache_limit_ = cache_limit;
+
+		if(threads == 0) {
+			threads = std::thread::hardware_concurrency();
+			if(threads == 0) threads = 1;
+			else if(threads > 8) threads = 8;
+		}
+		stop_ = false;
+		for(uint32_t i = 0; i < threads; ++i) {
+			workers_.emplace_back(&zip_archive::worker_, this);
+		}
+		return true;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	アーカイブを閉じる
+	*/
+	//-----------------------------------------------------------------//
+	void zip_archive::close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mtx_);
+			stop_ = true;
+		}
+		job_cv_.notify_all();
+		for(auto& th : workers_) {
+			th.join();
+		}
+		workers_.clear();
+		stop_ = false;
+
+		jobs_.clear();
+		errors_ = 0;
+		cache_.clear();
+		lru_.clear();
+		cache_bytes_ = 0;
+
+		entries_.clear();
+		dirs_.clear();
+		zmap_.clear();
+		zname_.clear();
+
+		map_.reset();
+		top_ = nullptr;
+		size_ = 0;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	展開を先行して要求する
+		@param[in]	index	ファイル番号
+	*/
+	//-----------------------------------------------------------------//
+	void zip_archive::prefetch(uint32_t index)
+	{
+		if(index >= entries_.size()) return;
+		if(entries_[index].method_ != Z_DEFLATED) return;
+
+		{
+			std::lock_guard<std::mutex> lock(mtx_);
+			cache_t& c = cache_[index];
+			if(c.state_ != state::none) return;
+			c.state_ = state::queued;
+			jobs_.push_back(index);
+		}
+		job_cv_.notify_one();
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	エントリーの領域を得る
+		@param[in]	index	ファイル番号
+		@return 領域
+	*/
+	//-----------------------------------------------------------------//
+	zip_archive::span zip_archive::get(uint32_t index)
+	{
+		span s;
+		if(index >= entries_.size()) return s;
+
+		const entry& e = entries_[index];
+		if(e.flags_ & 1) return s;	// 暗号化は扱わない
+
+		if(e.method_ == 0) {
+			const char* p = entry_data_(e);
+			if(p == nullptr) return s;
+			s.data = p;
+			s.size = e.csize_;
+			s.hold = map_;
+			return s;
+		}
+		if(e.method_ != Z_DEFLATED) return s;
+
+		blob_ptr blob;
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+			while(1) {
+				cache_t& c = cache_[index];
+				if(c.state_ == state::ready) {
+					lru_.splice(lru_.begin(), lru_, c.lru_);
+					blob = c.blob_;
+					break;
+				} else if(c.state_ == state::busy) {
+					done_cv_.wait(lock);
+				} else {	// 未展開、又は展開待ちなら、この場で展開する
+					c.state_ = state::busy;
+					lock.unlock();
+					blob_ptr b = inflate_safe_(index);
+					lock.lock();
+					if(b) {
+						insert_(index, b);
+					} else {
+						cache_[index].state_ = state::none;
+					}
+					done_cv_.notify_all();
+					if(!b) return s;
+					blob = b;
+					break;
+				}
+			}
+		}
+
+		static const char empty_ = 0;
+		s.data = blob->empty() ? &empty_ : &(*blob)[0];
+		s.size = blob->size();
+		s.hold = blob;
+		return s;
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	open_path で保持するアーカイブの数を設定
+		@param[in]	num	保持する数
+	*/
+	//-----------------------------------------------------------------//
+	void zip_archive::set_path_cache(uint32_t num)
+	{
+		path_cache& pc = get_path_cache_();
+		std::list<path_cache::item> tmp;
+		{
+			std::lock_guard<std::mutex> lock(pc.mtx_);
+			pc.limit_ = num;
+			while(pc.list_.size() > num) {
+				tmp.splice(tmp.end(), pc.list_, std::prev(pc.list_.end()));
+			}
+		}
+		// tmp の廃棄（ワーカーの終了待ち）は、ロックの外で行う
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	open_path で保持しているアーカイブを全て閉じる
+	*/
+	//-----------------------------------------------------------------//
+	void zip_archive::clear_path_cache()
+	{
+		path_cache& pc = get_path_cache_();
+		std::list<path_cache::item> tmp;
+		{
+			std::lock_guard<std::mutex> lock(pc.mtx_);
+			tmp.swap(pc.list_);
+		}
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	「archive.zip/path」形式のパスを開く
+		@param[in]	path	パス
+		@param[out]	fio	ファイル入出力
+		@return 成功なら「true」
+	*/
+	//-----------------------------------------------------------------//
+	bool zip_archive::open_path(const std::string& path, file_io& fio)
+	{
+		path_cache& pc = get_path_cache_();
+
+		std::string low = path;
+		for(auto& ch : low) ch = static_cast<char>(std::tolower(static_cast<uint8_t>(ch)));
+
+		size_t pos = 0;
+		while((pos = low.find(".zip/", pos)) != std::string::npos) {
+			pos += 4;
+			std::string arc = path.substr(0, pos);
+			std::string inner = path.substr(pos + 1);
+			std::shared_ptr<zip_archive> z;
+			std::list<path_cache::item> old;
+			{
+				std::lock_guard<std::mutex> lock(pc.mtx_);
+				z = pc.find(arc);
+			}
+			// 開く間はロックしない（閉じる時も、ワーカーの終了をロックの外で待つ）
+			if(!z && probe_file(arc) && !is_directory(arc)) {
+				z = std::make_shared<zip_archive>();
+				if(z->open(arc)) {
+					std::lock_guard<std::mutex> lock(pc.mtx_);
+					std::shared_ptr<zip_archive> t = pc.find(arc);
+					if(t) {
+						old.emplace_back(arc, z);
+						z = t;
+					} else if(pc.limit_ > 0) {
+						pc.list_.emplace_front(arc, z);
+						while(pc.list_.size() > pc.limit_) {
+							old.splice(old.end(), pc.list_, std::prev(pc.list_.end()));
+						}
+					}
+				} else {
+					z.reset();
+				}
+			}
+			if(z && z->open_file(inner, fio)) return true;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,420 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	zip アーカイブ（読み出し専用）クラス（ヘッダー）@n
+			アーカイブをメモリーにマップし、セントラル・ディレクトリーを @n
+			一度だけ解析してパスのハッシュ索引を作る。@n
+			無圧縮（stored）のエントリーは、マップ上の領域をそのまま返し、@n
+			deflate のエントリーは、ワーカー・スレッドで展開して、@n
+			LRU キャッシュに保持する。@n
+			このクラスをリンクすると、utils::file_io::open_map で @n
+			「archive.zip/path」形式のパスを開ける。
+    @author 平松邦仁 (hira@rvf-rc45.net)
+	@copyright	Copyright (C) 2017 Kunihito Hiramatsu @n
+				Released under the MIT license @n
+				https://github.com/hirakuni45/glfw_app/blob/master/LICENSE
+*/
+//=====================================================================//
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ctime>
+#include <boost/unordered_map.hpp>
+#include "utils/file_io.hpp"
+
+namespace utils {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	zip アーカイブ・クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class zip_archive {
+	public:
+		typedef std::shared_ptr<const std::vector<char> >	blob_ptr;
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	エントリーの領域 @n
+					hold が有効な間、data は参照できる。
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct span {
+			const char*	data;
+			size_t		size;
+			std::shared_ptr<const void>	hold;
+
+			span() : data(nullptr), size(0), hold() { }
+
+			bool valid() const { return data != nullptr; }
+		};
+
+		static const size_t default_cache_limit = 32 * 1024 * 1024;	///< キャッシュ上限（バイト）
+		static const uint32_t max_entry_size = 512 * 1024 * 1024;	///< 展開後の最大サイズ
+		static const uint32_t max_deflate_ratio = 1032;				///< deflate の最大圧縮率
+		static const uint32_t default_path_cache = 4;				///< open_path で保持する数
+
+	private:
+		struct entry {
+			std::string	path_;
+			uint32_t	ofs_;		///< ローカル・ヘッダーの位置
+			uint32_t	csize_;
+			uint32_t	usize_;
+			uint32_t	crc_;
+			uint16_t	method_;
+			uint16_t	flags_;
+			uint16_t	time_;
+			uint16_t	date_;
+		};
+
+		enum class state : uint8_t {
+			none,		///< 未展開
+			queued,		///< 展開待ち
+			busy,		///< 展開中
+			ready		///< キャッシュ済み
+		};
+
+		struct cache_t {
+			state		state_;
+			blob_ptr	blob_;
+			std::list<uint32_t>::iterator	lru_;
+			cache_t() : state_(state::none), blob_(), lru_() { }
+		};
+
+		std::string	zname_;
+
+		std::shared_ptr<file_io>	map_;
+		const char*	top_;
+		size_t		size_;
+
+		std::vector<entry>			entries_;
+		std::vector<std::string>	dirs_;
+
+		typedef boost::unordered_map<std::string, uint32_t>	zmap;
+		zmap	zmap_;
+
+		std::mutex	mtx_;
+		std::condition_variable	job_cv_;
+		std::condition_variable	done_cv_;
+
+		std::vector<cache_t>	cache_;
+		std::list<uint32_t>		lru_;
+		size_t	cache_bytes_;
+		size_t	cache_limit_;
+
+		std::deque<uint32_t>	jobs_;
+		std::vector<std::thread>	workers_;
+		bool	stop_;
+		uint32_t	errors_;
+
+		blob_ptr inflate_safe_(uint32_t index);
+
+		bool parse_directory_();
+
+		const char* entry_data_(const entry& e) const;
+
+		blob_ptr inflate_(uint32_t index) const;
+
+		void insert_(uint32_t index, const blob_ptr& blob);
+
+		void worker_();
+
+		zip_archive(const zip_archive&) = delete;
+		zip_archive& operator = (const zip_archive&) = delete;
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		zip_archive() : top_(nullptr), size_(0),
+			cache_bytes_(0), cache_limit_(default_cache_limit), stop_(false), errors_(0) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	デストラクター
+		*/
+		//-----------------------------------------------------------------//
+		~zip_archive() { close(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーカイブを開く
+			@param[in]	archive	アーカイブ・ファイル名
+			@param[in]	threads	展開スレッド数（０ならハードウェアに合わせる）
+			@param[in]	cache_limit	キャッシュの上限（バイト）
+			@return エラーが無ければ「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool open(const std::string& archive, uint32_t threads = 0,
+				  size_t cache_limit = default_cache_limit);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーカイブを閉じる @n
+					※取得済みの span は、hold により有効なまま
+		*/
+		//-----------------------------------------------------------------//
+		void close();
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーカイブ名を取得
+			@return アーカイブ名
+		*/
+		//-----------------------------------------------------------------//
+		const std::string& get_archive_name() const { return zname_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイル数を取得
+			@return ファイル数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t file_count() const { return static_cast<uint32_t>(entries_.size()); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ディレクトリー数を取得
+			@return ディレクトリー数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t dir_count() const { return static_cast<uint32_t>(dirs_.size()); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーカイブ内のファイル名取得
+			@param[in]	index	ファイル番号
+			@return ファイル名
+		*/
+		//-----------------------------------------------------------------//
+		const std::string& get_file_name(uint32_t index) const {
+			if(index < entries_.size()) {
+				return entries_[index].path_;
+			} else {
+				static std::string null_string_;
+				return null_string_;
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーカイブ内のディレクトリー名取得
+			@param[in]	index	ディレクトリー番号
+			@return ディレクトリー名
+		*/
+		//-----------------------------------------------------------------//
+		const std::string& get_dir_name(uint32_t index) const {
+			if(index < dirs_.size()) {
+				return dirs_[index];
+			} else {
+				static std::string null_string_;
+				return null_string_;
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーカイブ内のファイルサイズ（展開後）を返す
+			@param[in]	index	ファイル番号
+			@return ファイルサイズ
+		*/
+		//-----------------------------------------------------------------//
+		size_t get_filesize(uint32_t index) const {
+			if(index < entries_.size()) return entries_[index].usize_;
+			else return 0;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーカイブ内のファイル作成日時を取得
+			@param[in]	index	ファイル番号
+			@return 作成日時
+		*/
+		//-----------------------------------------------------------------//
+		time_t get_date(uint32_t index) const {
+			if(index >= entries_.size()) return 0;
+			const entry& e = entries_[index];
+			struct tm tm_t;
+			tm_t.tm_sec  = (e.time_ & 0x1f) * 2;
+			tm_t.tm_min  = (e.time_ >> 5) & 0x3f;
+			tm_t.tm_hour = e.time_ >> 11;
+			tm_t.tm_mday = e.date_ & 0x1f;
+			tm_t.tm_mon  = ((e.date_ >> 5) & 0x0f) - 1;
+			tm_t.tm_year = (e.date_ >> 9) + 80;
+			tm_t.tm_wday = 0;
+			tm_t.tm_yday = 0;
+			tm_t.tm_isdst = 0;
+			return mktime(&tm_t);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	無圧縮で格納されているか
+			@param[in]	index	ファイル番号
+			@return 無圧縮なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool is_stored(uint32_t index) const {
+			if(index < entries_.size()) return entries_[index].method_ == 0;
+			else return false;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	アーカイブ内の名前を検索
+			@param[in]	key	パス
+			@return 見つからない場合、負の値
+		*/
+		//-----------------------------------------------------------------//
+		int32_t find(const std::string& key) const {
+			zmap::const_iterator cit = zmap_.find(key);
+			if(cit == zmap_.end()) return -1;
+			return static_cast<int32_t>(cit->second);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	展開を先行して要求する（ワーカー・スレッドで展開） @n
+					無圧縮のエントリー、キャッシュ済みのエントリーは何もしない。@n
+					※キャッシュ上限を超える量を要求すると、使う前に追い出される。
+			@param[in]	index	ファイル番号
+		*/
+		//-----------------------------------------------------------------//
+		void prefetch(uint32_t index);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	展開を先行して要求する
+			@param[in]	paths	パスのリスト
+		*/
+		//-----------------------------------------------------------------//
+		void prefetch(const std::vector<std::string>& paths) {
+			for(const auto& s : paths) {
+				int32_t h = find(s);
+				if(h >= 0) prefetch(static_cast<uint32_t>(h));
+			}
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	エントリーの領域を得る @n
+					無圧縮ならマップ上の領域（コピー無し）、@n
+					deflate ならキャッシュ（無ければ、この場で展開）
+			@param[in]	index	ファイル番号
+			@return 領域（失敗したら valid() が「false」）
+		*/
+		//-----------------------------------------------------------------//
+		span get(uint32_t index);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	エントリーの領域を得る
+			@param[in]	path	パス
+			@return 領域（失敗したら valid() が「false」）
+		*/
+		//-----------------------------------------------------------------//
+		span get(const std::string& path) {
+			int32_t h = find(path);
+			if(h < 0) return span();
+			return get(static_cast<uint32_t>(h));
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	エントリーを記憶領域としてオープンする
+			@param[in]	path	パス
+			@param[out]	fio	ファイル入出力
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool open_file(const std::string& path, file_io& fio) {
+			span s = get(path);
+			if(!s.valid()) return false;
+			return fio.open(s.data, s.size, s.hold);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	キャッシュ中のバイト数を得る
+			@return バイト数
+		*/
+		//-----------------------------------------------------------------//
+		size_t get_cache_bytes() {
+			std::lock_guard<std::mutex> lock(mtx_);
+			return cache_bytes_;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	展開に失敗した回数を得る（壊れたデータ、サイズ超過、@n
+					メモリー不足など）
+			@return 回数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_error_count() {
+			std::lock_guard<std::mutex> lock(mtx_);
+			return errors_;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	open_path で保持するアーカイブの数を設定 @n
+					超えた分は、使われていない順に閉じる。@n
+					０なら保持せず、毎回開く。
+			@param[in]	num	保持する数
+		*/
+		//-----------------------------------------------------------------//
+		static void set_path_cache(uint32_t num);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	open_path で保持しているアーカイブを全て閉じる @n
+					※取得済みの span、開いた file_io は有効なまま
+		*/
+		//-----------------------------------------------------------------//
+		static void clear_path_cache();
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	「archive.zip/path」形式のパスを開く @n
+					開いたアーカイブは、set_path_cache で設定した数まで @n
+					共有して保持する。@n
+					file_io のオープン・フックとして登録される。
+			@param[in]	path	パス
+			@param[out]	fio	ファイル入出力
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		static bool open_path(const std::string& path, file_io& fio);
+	};
+
+}
@@ -10,7 +10,7 @@
 //=====================================================================//
 #include "widgets/widget_director.hpp"
 #include "widgets/widget_check.hpp"
-#include "utils/tree_unit.hpp"
+#include "utils/tree_arena.hpp"
 
 namespace gui {
 
@@ -49,13 +49,15 @@ namespace gui {
 		*/
 		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 		struct value {
-			widget_check*	w_;
+			widget_check*	w_;		///< 表示中の行に割り当てられた部品（画面外なら「０」）
 			std::string		data_;
+			bool			check_;	///< ディレクトリーなら開いている状態、それ以外は選択状態
+			short			width_;	///< 名前の描画幅（０なら未計測）
 
-			value() : w_(0), data_()
+			value() : w_(0), data_(), check_(false), width_(0)
 			{ }
 		};
-		typedef utils::tree_unit<value>	tree_unit;
+		typedef utils::tree_arena<value>	tree_unit;
 
 	private:
 		widget_director&	wd_;
@@ -69,7 +71,23 @@ namespace gui {
 
 		tree_unit			tree_unit_;
 		uint32_t			serial_id_;
-		tree_unit::unit_map_its	tree_unit_its_;
+		bool				rebuild_;	///< 次の service で行を作り直す
+		uint32_t			edit_count_;	///< 前の service から差分で更新した回数
+
+		// 一度の service までに差分で更新する上限（超えたら、まとめて作り直す）
+		static const uint32_t edit_limit_ = 32;
+
+		// 表示されている行（開いているディレクトリーの子だけを前順に並べたもの）
+		tree_unit::unit_map_its	rows_;
+
+		// 画面上の行に割り当てる部品のプール
+		struct slot_t {
+			widget_check*			w_;
+			tree_unit::unit_map_it	it_;
+			uint32_t				row_;	///< 割り当てた行（行が消えたら「~0」）
+			slot_t() : w_(nullptr), it_(nullptr), row_(~0u) { }
+		};
+		std::vector<slot_t>	slots_;
 
 		vtx::fpos			speed_;
 		vtx::fpos			offset_;
@@ -77,6 +95,7 @@ namespace gui {
 
 		uint32_t			select_id_;
 		tree_unit::unit_map_it	select_it_;
+		uint32_t			select_gen_;
 
 		struct root_t {
 			vtx::ipos			pos;
@@ -85,48 +104,244 @@ namespace gui {
 		std::vector<root_t>	roots_;
 
 
-		void create_()
+		// 行の範囲の終端（it の行の後ろで、it より浅い行の位置）
+		uint32_t subtree_end_(uint32_t row) const
 		{
-			vtx::irect r;
-			r.org.set(0);
-			r.size.x = get_rect().size.x;
-			r.size.y = param_.height_;
-			tree_unit::unit_map_its its;
-			tree_unit_.create_list("", its);
-
-			BOOST_FOREACH(tree_unit::unit_map_it it, its) {
-				if(!it->second.value.w_) {
-					gl::core& core = gl::core::get_instance();
-					gl::fonts& fonts = core.at_fonts();
-					r.size.x = fonts.get_width(utils::get_file_name(it->first)) + r.size.y + 8;
-					widget::param wp(r, this);
-					widget_check::param wp_(utils::get_file_name(it->first));
-					wp_.type_ = widget_check::style::MINUS_PLUS;
-					widget_check* w = wd_.add_widget<widget_check>(wp, wp_);
-					w->set_state(widget::state::POSITION_LOCK);
-					w->set_state(widget::state::SIZE_LOCK);
-					w->set_state(widget::state::MOVE_ROOT, false);
-					w->set_state(widget::state::RESIZE_ROOT);
-					w->set_state(widget::state::DRAG_UNSELECT);
-					w->set_state(widget::state::CLIP_PARENTS);
-					if(tree_unit_.is_directory(it)) {
-						r.org.y += param_.height_;
-					} else {
-						wd_.enable(w, false);
+			uint32_t depth = rows_[row]->get_depth();
+			++row;
+			while(row < rows_.size() && rows_[row]->get_depth() > depth) ++row;
+			return row;
+		}
+
+
+		// 選択ユニットが削除（再利用）されていたら選択を外す
+		void check_select_()
+		{
+			if(select_it_ != nullptr && select_it_->get_gen() != select_gen_) {
+				select_it_ = nullptr;
+			}
+		}
+
+
+		void set_select_(tree_unit::unit_map_it it)
+		{
+			select_it_ = it;
+			select_gen_ = it != nullptr ? it->get_gen() : 0;
+		}
+
+
+		// it が開いていて、その子が行に並んでいるか（nullptr はルート）
+		bool shown_(tree_unit::unit_map_cit it) const
+		{
+			for(; it != nullptr; it = it->get_parent()) {
+				if(it->get_depth() == 0) break;
+				if(!it->second.value.check_) return false;
+			}
+			return true;
+		}
+
+
+		// 開いているディレクトリーの子孫を、前順で追加する
+		void append_visible_(tree_unit::unit_map_it it, tree_unit::unit_map_its& out)
+		{
+			if(!it->second.value.check_) return;
+			tree_unit::unit_map_its ch;
+			tree_unit_.create_list(it->first, ch);
+			for(tree_unit::unit_map_it c : ch) {
+				out.push_back(c);
+				append_visible_(c, out);
+			}
+		}
+
+
+		void rebuild_rows_()
+		{
+			rows_.clear();
+			const tree_unit::unit_map_its& all = tree_unit_.get_preorder();
+			uint32_t i = 0;
+			while(i < all.size()) {
+				tree_unit::unit_map_it it = all[i];
+				it->second.value.w_ = 0;
+				rows_.push_back(it);
+				++i;
+				if(!it->second.value.check_) {  // 閉じている子孫は飛ばす
+					while(i < all.size() && all[i]->get_depth() > it->get_depth()) {
+						all[i]->second.value.w_ = 0;
+						++i;
 					}
-					it->second.value.w_ = w;
 				}
 			}
+			check_select_();
+			rebuild_ = false;
+			// 古い割り当ては、削除されたユニットを指している可能性がある
+			for(slot_t& t : slots_) {
+				t.it_ = nullptr;
+				if(t.w_ != nullptr) wd_.enable(t.w_, false);
+			}
+			serial_id_ = tree_unit_.get_serial_id();
+		}
+
+
+		void expand_(uint32_t row)
+		{
+			tree_unit::unit_map_its add;
+			append_visible_(rows_[row], add);
+			rows_.insert(rows_.begin() + row + 1, add.begin(), add.end());
+		}
+
+
+		void collapse_(uint32_t row)
+		{
+			rows_.erase(rows_.begin() + row + 1, rows_.begin() + subtree_end_(row));
+		}
+
+
+		// 行 top から後ろが増減した時、部品の行をずらす（消えた行は「~0」）
+		void shift_slots_(uint32_t top, uint32_t n)
+		{
+			for(slot_t& o : slots_) {
+				if(o.row_ == ~0u || o.row_ < top) continue;
+				if(rows_.size() < n && o.row_ < top + (n - rows_.size())) o.row_ = ~0u;
+				else o.row_ = o.row_ + rows_.size() - n;
+			}
+		}
+
+
+		// 前順で a が b より前か（祖先が先、兄弟は名前順）
+		static bool preorder_less_(tree_unit::unit_map_cit a, tree_unit::unit_map_cit b)
+		{
+			tree_unit::unit_map_cit pa = a;
+			tree_unit::unit_map_cit pb = b;
+			while(pa->get_depth() > pb->get_depth()) pa = pa->get_parent();
+			while(pb->get_depth() > pa->get_depth()) pb = pb->get_parent();
+			if(pa == pb) return a->get_depth() < b->get_depth();
+			while(pa->get_parent() != pb->get_parent()) {
+				pa = pa->get_parent();
+				pb = pb->get_parent();
+			}
+			return pa->get_name() < pb->get_name();
+		}
+
+
+		// it の行（行が無ければ「-1」）@n
+		// 部品に割り当てた行を先に調べ、無ければ前順に並んだ行を二分探索する
+		int32_t row_of_(tree_unit::unit_map_cit it) const
+		{
+			for(const slot_t& t : slots_) {
+				if(t.it_ == it && t.row_ < rows_.size() && rows_[t.row_] == it) return t.row_;
+			}
+			auto pos = std::lower_bound(rows_.begin(), rows_.end(), it, preorder_less_);
+			if(pos == rows_.end() || *pos != it) return -1;
+			return pos - rows_.begin();
+		}
+
+
+		// 新しく見える様になった it と、開いている子孫を前順の位置に入れる
+		void insert_row_(tree_unit::unit_map_it it)
+		{
+			tree_unit::unit_map_its add;
+			add.push_back(it);
+			append_visible_(it, add);
+			auto pos = std::lower_bound(rows_.begin(), rows_.end(), it, preorder_less_);
+			uint32_t top = pos - rows_.begin();
+			uint32_t n = rows_.size();
+			rows_.insert(pos, add.begin(), add.end());
+			shift_slots_(top, n);
+		}
+
+
+		// 差分で更新できるか（上限を超えたら、次の service でまとめて作り直す）
+		bool edit_()
+		{
+			if(rebuild_) return false;
+			if(edit_count_ >= edit_limit_) {
+				rebuild_ = true;
+				return false;
+			}
+			++edit_count_;
+			return true;
+		}
+
+
+		void unbind_()
+		{
+			for(slot_t& t : slots_) {
+				if(t.it_ != nullptr) t.it_->second.value.w_ = 0;
+				t.it_ = nullptr;
+				t.row_ = ~0u;
+				if(t.w_ != nullptr) wd_.enable(t.w_, false);
+			}
+		}
+
+
+		widget_check* create_slot_()
+		{
+			vtx::irect r(0, 0, param_.height_, param_.height_);
+			widget::param wp(r, this);
+			widget_check::param wp_;
+			wp_.type_ = widget_check::style::MINUS_PLUS;
+			widget_check* w = wd_.add_widget<widget_check>(wp, wp_);
+			w->set_state(widget::state::POSITION_LOCK);
+			w->set_state(widget::state::SIZE_LOCK);
+			w->set_state(widget::state::MOVE_ROOT, false);
+			w->set_state(widget::state::RESIZE_ROOT);
+			w->set_state(widget::state::DRAG_UNSELECT);
+			w->set_state(widget::state::CLIP_PARENTS);
+			return w;
+		}
+
+
+		// 画面上の行だけ、プールの部品を割り当てる
+		void bind_(int32_t ofsy)
+		{
+			int32_t h = param_.height_;
+			int32_t first = -ofsy / h;
+			if(first < 0) first = 0;
+			uint32_t num = get_rect().size.y / h + 2;
+			while(slots_.size() < num) {
+				slots_.push_back(slot_t());
+				slots_.back().w_ = create_slot_();
+			}
+
+			gl::core& core = gl::core::get_instance();
+			gl::fonts& fonts = core.at_fonts();
+			for(uint32_t i = 0; i < slots_.size(); ++i) {
+				slot_t& t = slots_[i];
+				uint32_t row = first + i;
+				tree_unit::unit_map_it it = nullptr;
+				if(i < num && row < rows_.size()) it = rows_[row];
+				if(t.it_ != it) {
+					if(t.it_ != nullptr && t.it_->second.value.w_ == t.w_) t.it_->second.value.w_ = 0;
+					t.it_ = it;
+				}
+				t.row_ = row;
+				if(it == nullptr) {
+					wd_.enable(t.w_, false);
+					continue;
+				}
+				value& v = it->second.value;
+				v.w_ = t.w_;
+				if(v.width_ == 0) {
+					v.width_ = fonts.get_width(it->get_name()) + h + 8;
+				}
+				widget_check::param& cp = t.w_->at_local_param();
+				cp.text_param_.set_text(it->get_name());
+				cp.draw_box_ = tree_unit_.is_directory(it);
+				t.w_->set_check(v.check_);
+				t.w_->at_rect().org.x = (it->get_depth() - 1) * h;
+				t.w_->at_rect().org.y = static_cast<int32_t>(row) * h + ofsy;
+				t.w_->at_rect().size.set(v.width_, h);
+				wd_.enable(t.w_);
+			}
 		}
 
 
 		void destroy_()
 		{
-			tree_unit::unit_map_its its;
-			tree_unit_.create_list("", its);
-			BOOST_FOREACH(tree_unit::unit_map_it it, its) {
-				wd_.del_widget(it->second.value.w_);
+			for(slot_t& t : slots_) {
+				wd_.del_widget(t.w_);
 			}
+			slots_.clear();
 		}
 
 	public:
@@ -138,8 +353,8 @@ namespace gui {
 		widget_tree(widget_director& wd, const widget::param& bp, const param& p) :
 			widget(bp), wd_(wd), param_(p),
 			vr_(0), r_(0), v_(0), h_(0),
-			tree_unit_(), serial_id_(0),
-			speed_(0.0f), offset_(0.0f), position_(0.0f), select_id_(0), select_it_()
+			tree_unit_(), serial_id_(0), rebuild_(false), edit_count_(0), rows_(), slots_(),
+			speed_(0.0f), offset_(0.0f), position_(0.0f), select_id_(0), select_it_(nullptr), select_gen_(0)
 			{ }
 
 
@@ -228,7 +443,10 @@ namespace gui {
 			@return 選択メニュー
 		*/
 		//-----------------------------------------------------------------//
-		tree_unit::unit_map_it get_select_it() const { return select_it_; }
+		tree_unit::unit_map_it get_select_it() const {
+			if(select_it_ == nullptr || select_it_->get_gen() != select_gen_) return nullptr;
+			return select_it_;
+		}
 
 
 		//-----------------------------------------------------------------//
@@ -268,28 +486,34 @@ namespace gui {
 				}
 			}
 
-			if(param_.single_) {
-				widget_check* sel = 0;
-				BOOST_FOREACH(tree_unit::unit_map_it it, tree_unit_its_) {
-					widget_check* w = it->second.value.w_;
-					if(w == 0) continue;
-					if(tree_unit_.is_directory(it)) continue;
-					if(w->get_select_out()) {
-						sel = w;
-						break;
+			// 部品の操作を、行に反映する（ツリーが外部で更新された場合は、作り直しを待つ）
+			if(rebuild_ || tree_unit_.get_serial_id() != serial_id_) return;
+			for(slot_t& t : slots_) {
+				tree_unit::unit_map_it it = t.it_;
+				if(it == nullptr) continue;
+				value& v = it->second.value;
+				if(param_.single_ && !tree_unit_.is_directory(it)) {
+					// シングル選択は、選択された時だけ
+					if(t.w_->get_select_out() && it != select_it_) {
+						check_select_();
+						if(select_it_ != nullptr) select_it_->second.value.check_ = false;
+						set_select_(it);
+						v.check_ = true;
+						++select_id_;
 					}
+					continue;
 				}
-				if(sel) {
-					BOOST_FOREACH(tree_unit::unit_map_it it, tree_unit_its_) {
-						widget_check* w = it->second.value.w_;
-						if(w == 0) continue;
-						if(tree_unit_.is_directory(it)) continue;
-						if(w != sel) {
-							w->set_check(false);
-						} else {
-							select_it_ = it;
-						}
-					}
+				if(t.w_->get_check() == v.check_) continue;
+				if(tree_unit_.is_directory(it)) {
+					v.check_ = t.w_->get_check();
+					uint32_t row = t.row_;
+					if(row >= rows_.size() || rows_[row] != it) continue;  // 同じ回の操作で隠れた行
+					uint32_t n = rows_.size();
+					if(v.check_) expand_(row);
+					else collapse_(row);
+					shift_slots_(row + 1, n);
+				} else {
+					v.check_ = t.w_->get_check();
 				}
 			}
 		}
@@ -306,58 +530,15 @@ namespace gui {
 				return;
 			}
 
-			// ツリーが更新されたら、アイテムを作り直す
-			if(tree_unit_.get_serial_id() != serial_id_) {
-				create_();
-				tree_unit_.create_list("", tree_unit_its_);
-				serial_id_ = tree_unit_.get_serial_id();
+			// ツリーが外部で更新されたら、行を作り直す
+			if(rebuild_ || tree_unit_.get_serial_id() != serial_id_) {
+				rebuild_rows_();
 			}
+			edit_count_ = 0;
 
 			roots_.clear();
-			vtx::spos pos(0);
-			BOOST_FOREACH(tree_unit::unit_map_it it, tree_unit_its_) {
-				widget_check* w = it->second.value.w_;
-				if(w == 0) continue;
-				bool draw = true;
-				std::vector<bool> st;
-				uint32_t n = utils::count_char(it->first, '/');
-				if(n > 1) {
-					std::string path = it->first;
-					for(uint32_t i = 1; i < n; ++i) {
-						auto p = utils::get_file_path(path);
-						tree_unit::optional_const_ref opt = tree_unit_.get(p);
-						if(opt) {
-							widget_check* w = (*opt).w_;
-							if(w) {
-								if(!w->get_check()) {
-									draw = false;
-									break;
-								}
-								st.push_back(w->get_check());						
-							}
-						}
-						path = p;
-					}
-				}
-				wd_.enable(w, draw);
-				if(draw) {
-					w->at_local_param().draw_box_ = tree_unit_.is_directory(it);
-					pos.x = (n - 1) * param_.height_;
-					w->at_rect().org = pos;
-#if 0
-					short x = 0;
-					BOOST_FOREACH(bool b, st) {
-						root_t r;
-						r.pos.x = x;
-						r.pos.y = pos.y;
-						r.h = h_;
-////						roots_.push_back(r);
-						x += param_.height_;
-					}
-#endif
-					pos.y += param_.height_;
-				}
-			}
+			vtx::ipos pos(0);
+			pos.y = rows_.size() * param_.height_;
 
 			if(get_select_in()) {
 				speed_.set(0.0f);
@@ -365,7 +546,7 @@ namespace gui {
 			}
 			float damping = 0.85f;
 			float slip_gain = 0.5f;
-			short d = get_rect().size.y - pos.y;
+			int32_t d = get_rect().size.y - pos.y;
 			if(get_select()) {
 				position_ = offset_ + get_param().move_pos_ - get_param().move_org_;
 				if(d < 0) {
@@ -415,12 +596,8 @@ namespace gui {
 				}
 			}
 
-			short ofsy = position_.y;
-			BOOST_FOREACH(tree_unit::unit_map_it it, tree_unit_its_) {
-				widget_check* w = it->second.value.w_;
-				if(w == 0) continue;
-				w->at_rect().org.y += ofsy;
-			}
+			int32_t ofsy = position_.y;
+			bind_(ofsy);
 		}
 
 
@@ -471,13 +648,6 @@ namespace gui {
 			path += wd_.create_widget_name(this);
 
 			int err = 0;
-			tree_unit::unit_map_its its;
-			tree_unit_.create_list("", its);
-			BOOST_FOREACH(tree_unit::unit_map_it it, its) {
-				widget_check* w = it->second.value.w_;
-				if(w == 0) continue;
-///				const vtx::spos& pos = w->get_rect().org;
-			}
 
 			return err == 0;
 		}
@@ -497,12 +667,6 @@ namespace gui {
 			path += wd_.create_widget_name(this);
 
 			int err = 0;
-			tree_unit::unit_map_its its;
-			tree_unit_.create_list("", its);
-			BOOST_FOREACH(tree_unit::unit_map_it it, its) {
-				widget_check* w = it->second.value.w_;
-				if(w == 0) continue;			
-			}
 
 			return err == 0;
 		}
@@ -514,10 +678,130 @@ namespace gui {
 		*/
 		//-----------------------------------------------------------------//
 		void clear() {
-			destroy_();
-			tree_unit_.clear();
-			tree_unit_its_.clear();
-///			select_it_ = tree_unit_.end();
+			unbind_();
+			tree_unit_.clear(false);  // シリアルIDは進める
+			rows_.clear();
+			set_select_(nullptr);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ユニットを登録 @n
+					見えている所に増えたら、その位置に行を入れる。@n
+					一度に沢山登録した場合は、次の service でまとめて行を作り直す。
+			@param[in]	path	パス
+			@param[in]	v		値
+			@return 成功したら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool install(const std::string& path, const value& v)
+		{
+			uint32_t serial = tree_unit_.get_serial_id();
+			if(!tree_unit_.install(path, v)) return false;
+			if(serial != serial_id_) return true;  // 次の service で作り直す
+			serial_id_ = tree_unit_.get_serial_id();
+			// 途中で作られたディレクトリーを含めて、一番上の新しいユニット
+			tree_unit::unit_map_it it = tree_unit_.find_it(path);
+			tree_unit::unit_map_it parent = tree_unit_.get_parent(it);
+			while(parent != nullptr && parent->second.get_id() >= serial) {
+				it = parent;
+				parent = tree_unit_.get_parent(parent);
+			}
+			if(shown_(parent) && edit_()) insert_row_(it);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ユニットを削除 @n
+					見えている行なら、その行と子孫の行を取り除く。
+			@param[in]	path	パス
+			@return 成功したら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool erase(const std::string& path)
+		{
+			bool sync = tree_unit_.get_serial_id() == serial_id_;
+			tree_unit::unit_map_it it = tree_unit_.find_it(path);
+			if(it == nullptr) return false;
+			check_select_();
+			if(select_it_ != nullptr) {
+				for(tree_unit::unit_map_it s = select_it_; s != nullptr; s = tree_unit_.get_parent(s)) {
+					if(s == it) {
+						set_select_(nullptr);
+						break;
+					}
+				}
+			}
+			if(shown_(tree_unit_.get_parent(it))) {
+				int32_t row = (sync && edit_()) ? row_of_(it) : -1;
+				unbind_();
+				if(row >= 0) {
+					rows_.erase(rows_.begin() + row, rows_.begin() + subtree_end_(row));
+				} else {
+					rebuild_ = true;
+				}
+			}
+			tree_unit_.erase(path);
+			if(sync) serial_id_ = tree_unit_.get_serial_id();
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ディレクトリーを開く、閉じる
+			@param[in]	path	パス
+			@param[in]	open	開く場合「true」
+			@return 成功したら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool expand(const std::string& path, bool open = true)
+		{
+			tree_unit::unit_map_it it = tree_unit_.find_it(path);
+			if(it == nullptr || !tree_unit_.is_directory(it)) return false;
+			if(it->second.value.check_ == open) return true;
+			it->second.value.check_ = open;
+			if(!shown_(tree_unit_.get_parent(it))) return true;
+			if(tree_unit_.get_serial_id() != serial_id_ || !edit_()) return true;
+			int32_t row = row_of_(it);
+			if(row < 0) {
+				rebuild_ = true;
+				return true;
+			}
+			uint32_t n = rows_.size();
+			if(open) expand_(row);
+			else collapse_(row);
+			shift_slots_(row + 1, n);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	表示されている行数を取得
+			@return 行数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t get_row_count() const { return rows_.size(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	位置から行を得る（ヒット・テスト）
+			@param[in]	y	ウィジェット内の Y 座標
+			@return 行のユニット（範囲外なら「nullptr」）
+		*/
+		//-----------------------------------------------------------------//
+		tree_unit::unit_map_it row_at(int32_t y) const
+		{
+			int32_t row = static_cast<int32_t>(y - position_.y);
+			if(row < 0) return nullptr;
+			row /= param_.height_;
+			if(static_cast<uint32_t>(row) >= rows_.size()) return nullptr;
+			return rows_[row];
 		}
 
 	};
@@ -86,24 +86,38 @@ namespace app {
 
 	static void draw_mesh_(const collada::dae_io::triangle_mesh& mesh, bool color = false)
 	{
+		if(mesh.vertex_.empty()) return;
+
+		bool nor = !mesh.normal_.empty();
+		bool tex = !mesh.texcoord_.empty();
+		bool col = !mesh.color_.empty() && color;
+		::glPushMatrix();
 		::glMultMatrixf(mesh.matrix_());
 		::glEnableClientState(GL_VERTEX_ARRAY);
-		::glEnableClientState(GL_NORMAL_ARRAY);
-		::glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		if(!mesh.color_.empty() && color) {
+		::glVertexPointer(mesh.vertex_stride_, GL_FLOAT, 0, &mesh.vertex_[0]);
+		if(nor) {
+			::glEnableClientState(GL_NORMAL_ARRAY);
+			::glNormalPointer(GL_FLOAT, 0, &mesh.normal_[0]);
+		}
+		if(tex) {
+			::glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			::glTexCoordPointer(mesh.texcoord_stride_, GL_FLOAT, 0, &mesh.texcoord_[0]);
+		}
+		if(col) {
 			::glEnableClientState(GL_COLOR_ARRAY);
 			::glColorPointer(mesh.color_stride_, GL_FLOAT, 0, &mesh.color_[0]);
 		}
-		::glVertexPointer(mesh.vertex_stride_, GL_FLOAT, 0, &mesh.vertex_[0]);
-		::glNormalPointer(GL_FLOAT, 0, &mesh.normal_[0]);
-		::glTexCoordPointer(mesh.texcoord_stride_, GL_FLOAT, 0, &mesh.texcoord_[0]);
-		::glDrawArrays(GL_TRIANGLES, 0, mesh.vertex_.size() / 3);
-		::glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		if(!mesh.color_.empty() && color) {
-			::glDisableClientState(GL_COLOR_ARRAY);
+		if(!mesh.index_.empty()) {
+			// 溶接済みのメッシュはインデックスで描画
+			::glDrawElements(GL_TRIANGLES, mesh.index_.size(), GL_UNSIGNED_INT, &mesh.index_[0]);
+		} else {
+			::glDrawArrays(GL_TRIANGLES, 0, mesh.vertex_.size() / mesh.vertex_stride_);
 		}
-		::glDisableClientState(GL_NORMAL_ARRAY);
+		if(col) ::glDisableClientState(GL_COLOR_ARRAY);
+		if(tex) ::glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		if(nor) ::glDisableClientState(GL_NORMAL_ARRAY);
 		::glDisableClientState(GL_VERTEX_ARRAY);
+		::glPopMatrix();
 	}
 
 
@@ -365,6 +379,18 @@ namespace app {
 		if(dev.get_positive(device::key::L)) {
 			light_enable_ = !light_enable_;
 		}
+		if(dev.get_positive(device::key::P)) {
+			if(physics_.is_running()) {
+				physics_.stop();
+			} else {
+				physics_.start();
+			}
+			physics_enable_ = physics_.is_running();
+			if(physics_enable_) {
+				physics_time_ = 0.0f;
+				physics_base_ = physics_.get_stats().steps_;
+			}
+		}
 
 //		if(dev.get_key_positive(KEY_NORMAL + 0x1b)) {
 //			physics_enable_ = !physics_enable_;
@@ -380,7 +406,8 @@ namespace app {
 
 		if(physics_enable_) {
 			physics_.update(camera_);
-			physics_time_ += 1.0f / 60.0f;
+			bt::physics::step_stats st = physics_.get_stats();
+			physics_time_ = static_cast<float>(st.steps_ - physics_base_) * physics_.get_step();
 		}
 
 		gui::widget_director& wd = director_.at_core().widget_director_;
@@ -527,6 +554,8 @@ namespace app {
 		pre.set_current_path("/dae_render");
 ///		pre.put_text("file_path", filer_.get_root_path());
 
+		physics_.stop();
+
 		std::cout << "DAE Render - destroy" << std::endl;
 	}
 
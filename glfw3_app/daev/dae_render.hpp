@@ -42,6 +42,7 @@ namespace app {
 
 		bt::physics			physics_;
 		float				physics_time_;
+		uint64_t			physics_base_;	///< 計測を始めた時のステップ数
 
 		struct capsule_body {
 			vtx::fvtx	org_;
@@ -80,7 +81,7 @@ namespace app {
 		//-----------------------------------------------------------------//
 		dae_render(utils::director<core>& d) : director_(d),
 			model_scale_(10.0f),
-			physics_(), physics_time_(0.0f),
+			physics_(), physics_time_(0.0f), physics_base_(0),
 			filer_(0), file_id_(0),
 			tools_palette_(0), filer_button_(0), physics_button_(0),
 			wire_frame_(false), light_enable_(true),
@@ -4,6 +4,8 @@
 	@author 平松邦仁 (hira@rvf-rc45.net)
 */
 //=====================================================================//
+#include <cstdlib>
+#include <boost/format.hpp>
 #include "main.hpp"
 #include "core/glcore.hpp"
 #include "utils/director.hpp"
@@ -12,8 +14,30 @@
 
 int main(int argc, char** argv);
 
+// ヘッドレス計測：daev -headless [剛体数] [ステップ数]
+static int headless_(int argc, char** argv)
+{
+	uint32_t num = 1000;
+	uint32_t steps = 1000;
+	if(argc > 2) num = std::strtoul(argv[2], nullptr, 10);
+	if(argc > 3) steps = std::strtoul(argv[3], nullptr, 10);
+
+	bt::physics phy;
+	phy.initialize();
+	double sps = phy.benchmark(num, steps);
+	bt::physics::step_stats st = phy.get_stats();
+	std::cout << boost::format("Bodies: %d, Steps: %d, %.1f steps/s (average: %.3f ms, max: %.3f ms)")
+		% num % steps % sps % st.average_ms_ % st.max_ms_ << std::endl;
+	phy.destroy();
+	return 0;
+}
+
 int main(int argc, char** argv)
 {
+	if(argc > 1 && std::string(argv[1]) == "-headless") {
+		return headless_(argc, argv);
+	}
+
 	gl::create_glcore();
 
 	gl::IGLcore* igl = gl::get_glcore();
@@ -8,6 +8,7 @@
 #include <boost/foreach.hpp>
 #include "gl_fw/IGLcore.hpp"
 #include <boost/foreach.hpp>
+#include <chrono>
 #include "utils/quat.hpp"
 
 #if 0
@@ -80,12 +81,8 @@ namespace bt {
 	}
 
 
-	void physics::picking_body_(const gl::camera& cam, const btVector3& ray_to)
-	{					
-		btVector3 ray_from;
-		const vtx::fvtx& cp = cam.get_eye();
-		ray_from = btVector3(cp.x, cp.y, cp.z);
-
+	void physics::picking_body_(const btVector3& ray_from, const btVector3& ray_to)
+	{
 		btCollisionWorld::ClosestRayResultCallback ray_callback(ray_from, ray_to);
 		world_->rayTest(ray_from, ray_to, ray_callback);
 		if(ray_callback.hasHit()) {
@@ -144,7 +141,7 @@ namespace bt {
 	}
 
 
-	void physics::moveing_body_(const gl::camera& cam, const btVector3& ray)
+	void physics::moveing_body_(const btVector3& ray_from, const btVector3& ray)
 	{
 		if(pick_constraint_) {
 			//move the constraint pivot
@@ -161,8 +158,6 @@ namespace bt {
 //						newPivot.setY(ray.getY());
 //					} else
 					{
-						const vtx::fvtx& v = cam.get_eye();
-						btVector3 ray_from(v.x, v.y, v.z);
 						btVector3 dir = ray - ray_from;
 						dir.normalize();
 						dir *= last_picking_dist_;
@@ -183,8 +178,6 @@ namespace bt {
 //						newPivotB.setY(ray.getY());
 //					} else
 					{
-						const vtx::fvtx& v = cam.get_eye();
-						btVector3 ray_from(v.x, v.y, v.z);
 						btVector3 dir = ray - ray_from;
 						dir.normalize();
 						dir *= last_picking_dist_;
@@ -211,37 +204,36 @@ namespace bt {
 	}
 
 
-	void physics::render_world_(int pass)
+	void physics::render_world_(int pass, float alpha)
 	{
 		btScalar m[16];
-		btMatrix3x3 rot;
-		rot.setIdentity();
-		int num = world_->getNumCollisionObjects();
-		btVector3 wireColor(1, 0, 0);
-		for(int i = 0; i < num; ++i) {
-			btCollisionObject* cobj = world_->getCollisionObjectArray()[i];
-			btRigidBody* body = btRigidBody::upcast(cobj);
-			if(body && body->getMotionState()) {
-				btDefaultMotionState* state = (btDefaultMotionState*)body->getMotionState();
-				state->m_graphicsWorldTrans.getOpenGLMatrix(m);
-				rot = state->m_graphicsWorldTrans.getBasis();
+		// 描画側のコピーだけを使う（ワールドはスレッドが更新している）
+		btVector3 aabbMin(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+		btVector3 aabbMax( BT_LARGE_FLOAT,  BT_LARGE_FLOAT,  BT_LARGE_FLOAT);
+		for(int i = 0; i < static_cast<int>(view_.size()); ++i) {
+			const body_state& bs = view_[i];
+			btTransform trans;
+			if(alpha >= 1.0f) {
+				trans = bs.cur_;
 			} else {
-				cobj->getWorldTransform().getOpenGLMatrix(m);
-				rot = cobj->getWorldTransform().getBasis();
+				trans.setOrigin(bs.prev_.getOrigin().lerp(bs.cur_.getOrigin(), alpha));
+				trans.setRotation(slerp(bs.prev_.getRotation(), bs.cur_.getRotation(), alpha));
 			}
+			trans.getOpenGLMatrix(m);
+			btMatrix3x3 rot = trans.getBasis();
 
 			btVector3 wireColor(1.0f, 1.0f, 0.5f); //wants deactivation
 			if(i & 1) wireColor = btVector3(0.0f, 0.0f, 1.0f);
 
 			// color differently for active, sleeping, wantsdeactivation states
-			if(cobj->getActivationState() == 1) {
+			if(bs.activation_ == 1) {
 				if (i & 1) {
 					wireColor += btVector3 (1.f,0.f,0.f);
 				} else {			
 					wireColor += btVector3 (.5f,0.f,0.f);
 				}
 			}
-			if(cobj->getActivationState() == 2) {	//ISLAND_SLEEPING
+			if(bs.activation_ == 2) {	//ISLAND_SLEEPING
 				if(i & 1) {
 					wireColor += btVector3 (0.f,1.f, 0.f);
 				} else {
@@ -249,30 +241,19 @@ namespace bt {
 				}
 			}
 
-			btVector3 aabbMin,aabbMax;
-			world_->getBroadphase()->getBroadphaseAabb(aabbMin, aabbMax);		
-			aabbMin -= btVector3(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
-			aabbMax += btVector3(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
-
-///			std::cout << boost::format("aabbMin=(%f,%f,%f)\n")
-///				% aabbMin.getX() % aabbMin.getY() % aabbMin.getZ();
-///			std::cout << boost::format("aabbMax=(%f,%f,%f)\n")
-///				% aabbMax.getX() % aabbMax.getY() % aabbMax.getZ();
-///			world_->getDebugDrawer()->drawAabb(aabbMin,aabbMax,btVector3(1,1,1));
-
 			if (!(debug_mode_ & btIDebugDraw::DBG_DrawWireframe)) {
 				switch(pass)
 				{
 				case 0:
-					shape_drawer_.drawOpenGL(m, cobj->getCollisionShape(),
+					shape_drawer_.drawOpenGL(m, bs.shape_,
 						wireColor, debug_mode_, aabbMin, aabbMax);
 					break;
 				case 1:
 					shape_drawer_.drawShadow(m, sun_direction_ * rot,
-						cobj->getCollisionShape(), aabbMin, aabbMax);
+						bs.shape_, aabbMin, aabbMax);
 					break;
 				case 2:
-					shape_drawer_.drawOpenGL(m, cobj->getCollisionShape(),
+					shape_drawer_.drawOpenGL(m, bs.shape_,
 						wireColor * btScalar(0.3f), 0, aabbMin, aabbMax);
 					break;
 				}
@@ -309,6 +290,129 @@ namespace bt {
 	}
 
 
+	void physics::add_body_(btRigidBody* body)
+	{
+		post_([this, body]() { world_->addRigidBody(body); });
+	}
+
+
+	void physics::post_(const command& cmd)
+	{
+		// 動作中の判定と積むのは同じロックの中で行う（stop の後に積まれない様に）
+		{
+			std::lock_guard<std::mutex> lock(command_mutex_);
+			if(running_) {
+				commands_.push_back(cmd);
+				return;
+			}
+		}
+		// stop がスレッドを待っている間でも、ワールドは止めてから、積まれた順に実行
+		std::lock_guard<std::mutex> lock(world_mutex_);
+		execute_commands_();
+		cmd();
+	}
+
+
+	void physics::execute_commands_()
+	{
+		{
+			std::lock_guard<std::mutex> lock(command_mutex_);
+			exec_.swap(commands_);
+		}
+		for(command& cmd : exec_) {
+			cmd();
+		}
+		exec_.clear();
+	}
+
+
+	void physics::capture_()
+	{
+		int num = world_->getNumCollisionObjects();
+		uint32_t old = back_.size();
+		back_.resize(num);
+		for(int i = 0; i < num; ++i) {
+			btCollisionObject* cobj = world_->getCollisionObjectArray()[i];
+			btRigidBody* body = btRigidBody::upcast(cobj);
+			body_state& bs = back_[i];
+			bool same = static_cast<uint32_t>(i) < old && bs.shape_ == cobj->getCollisionShape();
+			if(body && body->getMotionState()) {
+				btDefaultMotionState* state = (btDefaultMotionState*)body->getMotionState();
+				bs.cur_ = state->m_graphicsWorldTrans;
+			} else {
+				bs.cur_ = cobj->getWorldTransform();
+			}
+			if(!same) bs.prev_ = bs.cur_;
+			bs.shape_ = cobj->getCollisionShape();
+			bs.activation_ = cobj->getActivationState();
+		}
+	}
+
+
+	void physics::publish_(float ms)
+	{
+		double now = std::chrono::duration<double>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		std::lock_guard<std::mutex> lock(frame_mutex_);
+		front_ = back_;
+		front_time_ = now;
+		for(body_state& bs : back_) {
+			bs.prev_ = bs.cur_;
+		}
+		if(ms >= 0.0f) {
+			++stats_.steps_;
+			total_ms_ += ms;
+			stats_.last_ms_ = ms;
+			stats_.average_ms_ = static_cast<float>(total_ms_ / static_cast<double>(stats_.steps_));
+			if(stats_.max_ms_ < ms) stats_.max_ms_ = ms;
+		}
+	}
+
+
+	void physics::step_once_(float dt)
+	{
+		typedef std::chrono::steady_clock clock;
+		clock::time_point t0 = clock::now();
+		{
+			std::lock_guard<std::mutex> lock(world_mutex_);
+			execute_commands_();
+			world_->stepSimulation(dt, 0, dt);
+			capture_();
+		}
+		float ms = std::chrono::duration<float, std::milli>(clock::now() - t0).count();
+		publish_(ms);
+	}
+
+
+	void physics::step_loop_()
+	{
+		typedef std::chrono::steady_clock clock;
+		clock::duration period = std::chrono::duration_cast<clock::duration>(
+			std::chrono::duration<double>(step_));
+		clock::time_point next = clock::now();
+		while(running_) {
+			uint32_t n = 0;
+			while(running_ && clock::now() >= next && n < max_sub_steps_) {
+				step_once_(step_);
+				next += period;
+				++n;
+			}
+			clock::time_point now = clock::now();
+			if(now >= next) {
+				// 追いつけない分は捨てて、時間を合わせる
+				uint64_t drops = (now - next) / period + 1;
+				{
+					std::lock_guard<std::mutex> lock(frame_mutex_);
+					stats_.drops_ += drops;
+				}
+				next += period * drops;
+			}
+			std::unique_lock<std::mutex> lock(wake_mutex_);
+			wake_.wait_until(lock, next, [this]() { return !running_; });
+		}
+	}
+
+
 
 	//-----------------------------------------------------------------//
 	/*!
@@ -388,7 +492,7 @@ namespace bt {
 		shapes_.push_back(cshape);
 		btRigidBody* body = new_body_(cshape, org, dir);
 		body->setDamping(current_.damping_linear_, current_.damping_rotate_);
-		world_->addRigidBody(body);
+		add_body_(body);
 		return body;
 	}
 
@@ -407,7 +511,7 @@ namespace bt {
 		shapes_.push_back(cshape);
 		btRigidBody* body = new_body_(cshape, org, vtx::fvtx(0.0f, 0.0f, 1.0f));
 		body->setDamping(current_.damping_linear_, current_.damping_rotate_);
-		world_->addRigidBody(body);
+		add_body_(body);
 		return body;
 	}
 
@@ -433,7 +537,7 @@ namespace bt {
 			vtx::fvtx p = (org + end) * 0.5f;	// 中心
 			btRigidBody* body = new_body_(cshape, p, n);
 			body->setDamping(current_.damping_linear_, current_.damping_rotate_);
-			world_->addRigidBody(body);
+			add_body_(body);
 			return body;
 		} else {
 			return 0;
@@ -463,7 +567,7 @@ namespace bt {
 			vtx::fvtx p = (org + end) * 0.5f;	// 中心
 			btRigidBody* body = new_body_(cshape, p, n);
 			body->setDamping(current_.damping_linear_, current_.damping_rotate_);
-			world_->addRigidBody(body);
+			add_body_(body);
 			return body;
 		} else {
 			return 0;
@@ -483,6 +587,10 @@ namespace bt {
 	//-----------------------------------------------------------------//
 	btTypedConstraint* physics::create_joint(btRigidBody* bdya, btRigidBody* bdyb, float ofsa, float ofsb)
 	{
+		// 先に送った剛体の追加を済ませてから、ワールドを止めて繋ぐ
+		std::lock_guard<std::mutex> lock(world_mutex_);
+		execute_commands_();
+
 		bool useLinearReferenceFrameA = true;
 		btTransform trans_a;
 		trans_a.setIdentity();
@@ -517,6 +625,10 @@ namespace bt {
 	//-----------------------------------------------------------------//
 	btTypedConstraint* physics::create_spring_joint(btRigidBody* bdya, btRigidBody* bdyb, float ofsa, float ofsb)
 	{
+		// 先に送った剛体の追加を済ませてから、ワールドを止めて繋ぐ
+		std::lock_guard<std::mutex> lock(world_mutex_);
+		execute_commands_();
+
 		bool useLinearReferenceFrameA = true;
 		btTransform trans_a;
 		trans_a.setIdentity();
@@ -573,6 +685,8 @@ namespace bt {
 	//-----------------------------------------------------------------//
 	void physics::create_body(const hairs& hs)
 	{
+		// 剛体はここで作り、ワールドへの追加はまとめてスレッドに送る
+		std::vector<btRigidBody*> bodies;
 		BOOST_FOREACH(const hair& h, hs) {
 			if(!h.joints_.empty()) {
 				vtx::fvtx org = h.joints_[0];
@@ -586,12 +700,18 @@ namespace bt {
 						vtx::fvtx p = (org + v) * 0.5f;	// 中心
 						btRigidBody* body = new_body_(cshape, p, n);
 						body->setDamping(0.15f, 0.85f);
-						world_->addRigidBody(body);
+						bodies.push_back(body);
 					}
 					org = v;
 				}
 			}
 		}
+		if(bodies.empty()) return;
+		post_([this, bodies]() {
+			for(btRigidBody* body : bodies) {
+				world_->addRigidBody(body);
+			}
+		});
 	}
 
 
@@ -602,15 +722,8 @@ namespace bt {
 	//-----------------------------------------------------------------//
 	void physics::update(const gl::camera& cam)
 	{
-		world_->stepSimulation(1.0f / 60.0f, 10);
-
-		for(int j = world_->getNumCollisionObjects() - 1; j >= 0; --j) {
-			btCollisionObject* obj = world_->getCollisionObjectArray()[j];
-			btRigidBody* body = btRigidBody::upcast(obj);
-			if(body && body->getMotionState()) {
-				btTransform trans;
-				body->getMotionState()->getWorldTransform(trans);
-			}
+		if(!running_) {
+			step_once_(step_);
 		}
 
 		if(!cam.get_touch()) {
@@ -621,19 +734,60 @@ namespace bt {
 
 			const vtx::spos& mspos = dev.get_cursor();
 			btVector3 ray_to = get_ray_to_(cam, mspos.x, mspos.y);
+			const vtx::fvtx& cp = cam.get_eye();
+			btVector3 ray_from(cp.x, cp.y, cp.z);
 
 			if(dev.get_positive(device::key::MOUSE_LEFT)) {
-				picking_body_(cam, ray_to);
+				post_([this, ray_from, ray_to]() { picking_body_(ray_from, ray_to); });
 			}
 			if(dev.get_level(device::key::MOUSE_LEFT)) {
-				moveing_body_(cam, ray_to);
+				post_([this, ray_from, ray_to]() { moveing_body_(ray_from, ray_to); });
 			} else {
-				remove_picking_constraint_();
+				post_([this]() { remove_picking_constraint_(); });
 			}
 		}
 	}
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	シミュレーション・スレッドの開始
+		@param[in]	step	固定ステップ（秒）
+		@param[in]	max_sub_steps	遅れた場合に１回で追いつくステップ数の上限
+	*/
+	//-----------------------------------------------------------------//
+	void physics::start(float step, uint32_t max_sub_steps)
+	{
+		if(running_ || world_ == 0) return;
+		step_ = step;
+		max_sub_steps_ = max_sub_steps ? max_sub_steps : 1;
+		{
+			std::lock_guard<std::mutex> lock(command_mutex_);
+			running_ = true;
+		}
+		thread_ = std::thread(&physics::step_loop_, this);
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	シミュレーション・スレッドの停止
+	*/
+	//-----------------------------------------------------------------//
+	void physics::stop()
+	{
+		if(!running_) return;
+		{
+			std::lock_guard<std::mutex> lock(command_mutex_);
+			std::lock_guard<std::mutex> wake(wake_mutex_);
+			running_ = false;
+		}
+		wake_.notify_all();
+		thread_.join();
+		execute_commands_();
+	}
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief	レンダリング
@@ -641,10 +795,29 @@ namespace bt {
 	//-----------------------------------------------------------------//
 	void physics::render()
 	{
+		float alpha = 1.0f;
+		if(running_) {
+			double t;
+			{
+				std::lock_guard<std::mutex> lock(frame_mutex_);
+				view_ = front_;
+				t = front_time_;
+			}
+			// 公開された２ステップの間を、経過時間で補間（描画は１ステップ遅れる）
+			double now = std::chrono::duration<double>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+			alpha = static_cast<float>((now - t) / static_cast<double>(step_));
+			if(alpha < 0.0f) alpha = 0.0f;
+			else if(alpha > 1.0f) alpha = 1.0f;
+		} else {
+			capture_();
+			view_ = back_;
+		}
+
 		if(render_shadow_) {
 			glClear(GL_STENCIL_BUFFER_BIT);
 			glEnable(GL_CULL_FACE);
-			render_world_(0);
+			render_world_(0, alpha);
 
 			glDisable(GL_LIGHTING);
 			glDepthMask(GL_FALSE);
@@ -654,10 +827,10 @@ namespace bt {
 			glStencilFunc(GL_ALWAYS,1,0xFFFFFFFFL);
 			glFrontFace(GL_CCW);
 			glStencilOp(GL_KEEP,GL_KEEP,GL_INCR);
-			render_world_(1);
+			render_world_(1, alpha);
 			glFrontFace(GL_CW);
 			glStencilOp(GL_KEEP,GL_KEEP,GL_DECR);
-			render_world_(1);
+			render_world_(1, alpha);
 			glFrontFace(GL_CCW);
 
 			glPolygonMode(GL_FRONT,GL_FILL);
@@ -676,14 +849,14 @@ namespace bt {
 			glStencilFunc( GL_NOTEQUAL, 0, 0xFFFFFFFFL );
 			glStencilOp( GL_KEEP, GL_KEEP, GL_KEEP );
 			glDisable(GL_LIGHTING);
-			render_world_(2);
+			render_world_(2, alpha);
 			glEnable(GL_LIGHTING);
 			glDepthFunc(GL_LESS);
 			glDisable(GL_STENCIL_TEST);
 			glDisable(GL_CULL_FACE);
 		} else {
 			glDisable(GL_CULL_FACE);
-			render_world_(0);
+			render_world_(0, alpha);
 		}
 	}
 
@@ -695,11 +868,47 @@ namespace bt {
 	//-----------------------------------------------------------------//
 	void physics::destroy_body()
 	{
+		// スレッドと描画が形状を参照しない様に、止めてから外す
+		bool run = running_;
+		float step = step_;
+		uint32_t max_sub_steps = max_sub_steps_;
+		stop();
+		{
+			std::lock_guard<std::mutex> lock(world_mutex_);
+			execute_commands_();
+			if(world_ != 0) {
+				remove_picking_constraint_();
+				for(btTypedConstraint* joint : joints_) {
+					world_->removeConstraint(joint);
+					delete joint;
+				}
+				for(int i = world_->getNumCollisionObjects() - 1; i >= 0; --i) {
+					btCollisionObject* cobj = world_->getCollisionObjectArray()[i];
+					btRigidBody* body = btRigidBody::upcast(cobj);
+					if(body && body->getMotionState()) {
+						delete body->getMotionState();
+					}
+					world_->removeCollisionObject(cobj);
+					delete cobj;
+				}
+			}
+			joints_.clear();
+			picked_body_ = 0;
+			back_.clear();
+		}
+		{
+			std::lock_guard<std::mutex> lock(frame_mutex_);
+			front_.clear();
+		}
+		view_.clear();
+
 		for(int i = 0; i < shapes_.size(); ++i) {
 			btCollisionShape* shape = shapes_[i];
 			delete shape;
 		}
 		shapes_.clear();
+
+		if(run) start(step, max_sub_steps);
 	}
 
 
@@ -710,6 +919,7 @@ namespace bt {
 	//-----------------------------------------------------------------//
 	void physics::destroy()
 	{
+		stop();
 		delete world_;
 		world_ = 0;
 		delete solver_;
@@ -723,4 +933,45 @@ namespace bt {
 	}
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief	ヘッドレス計測
+		@param[in]	num		剛体の数
+		@param[in]	steps	ステップ数
+		@return 毎秒のステップ数
+	*/
+	//-----------------------------------------------------------------//
+	double physics::benchmark(uint32_t num, uint32_t steps)
+	{
+		if(world_ == 0 || running_) return 0.0;
+
+		create_ground_body();
+
+		// 地面の上に、箱と球を交互に格子状に積む
+		current_.mass_ = 1.0f;
+		uint32_t side = 1;
+		while(side * side * side < num) ++side;
+		for(uint32_t i = 0; i < num; ++i) {
+			float x = (static_cast<float>(i % side) - static_cast<float>(side) * 0.5f) * 1.1f;
+			float y = (static_cast<float>((i / side) % side) - static_cast<float>(side) * 0.5f) * 1.1f;
+			float z = static_cast<float>(i / (side * side)) * 1.1f;
+			vtx::fvtx org(x * 0.5f, y * 0.5f, z + 0.5f);
+			if(i & 1) {
+				create_sphere(org, 0.25f);
+			} else {
+				create_box(org, vtx::fvtx(0.25f));
+			}
+		}
+
+		typedef std::chrono::steady_clock clock;
+		clock::time_point t0 = clock::now();
+		for(uint32_t i = 0; i < steps; ++i) {
+			step_once_(step_);
+		}
+		double sec = std::chrono::duration<double>(clock::now() - t0).count();
+		if(sec <= 0.0) return 0.0;
+		return static_cast<double>(steps) / sec;
+	}
+
+
 }
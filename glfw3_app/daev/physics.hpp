@@ -1,13 +1,21 @@
 #pragma once
 //=====================================================================//
 /*!	@file
-	@brief	物理・クラス（ヘッダー）
+	@brief	物理・クラス（ヘッダー） @n
+			ワールドの更新は専用スレッドで固定ステップで行い、剛体の姿勢を @n
+			ダブル・バッファで公開する。描画側は直前の２ステップを補間する。@n
+			ピッキング、剛体の追加は、コマンドとしてスレッドに渡す。
 	@author	平松邦仁 (hira@rvf-rc45.net)
 */
 //=====================================================================//
 #include <iostream>
 #include "btBulletDynamicsCommon.h"
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
 #include "gl_shape_drawer.hpp"
 #include "gl_fw/glcamera.hpp"
 
@@ -31,6 +39,21 @@ namespace bt {
 		};
 		typedef std::vector<hair>	hairs;
 
+
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		/*!
+			@brief	ステップ時間の統計
+		*/
+		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+		struct step_stats {
+			uint64_t	steps_;			///< ステップ数
+			uint64_t	drops_;			///< 追いつけずに捨てたステップ数
+			float		last_ms_;		///< 直前のステップ時間
+			float		average_ms_;	///< 平均ステップ時間
+			float		max_ms_;		///< 最大ステップ時間
+			step_stats() : steps_(0), drops_(0), last_ms_(0.0f), average_ms_(0.0f), max_ms_(0.0f) { }
+		};
+
 	private:
 		btDefaultCollisionConfiguration*		config_;
 		btCollisionDispatcher*					dispatcher_;
@@ -63,12 +86,48 @@ namespace bt {
 
 		bool	render_shadow_;
 
+		// 公開する剛体の姿勢（直前と現在のステップ）
+		struct body_state {
+			btCollisionShape*	shape_;
+			btTransform			prev_;
+			btTransform			cur_;
+			int					activation_;
+		};
+		typedef std::vector<body_state>	body_states;
+		body_states				back_;		///< スレッド側
+		body_states				front_;		///< 公開側
+		body_states				view_;		///< 描画側
+		double					front_time_;
+		step_stats				stats_;
+		double					total_ms_;
+		std::mutex				frame_mutex_;
+
+		typedef std::function<void ()>	command;
+		std::vector<command>	commands_;
+		std::vector<command>	exec_;
+		std::mutex				command_mutex_;
+
+		std::mutex				world_mutex_;
+		std::thread				thread_;
+		std::atomic<bool>		running_;
+		std::mutex				wake_mutex_;
+		std::condition_variable	wake_;
+		float					step_;
+		uint32_t				max_sub_steps_;
+
 		btVector3 get_ray_to_(const gl::camera& cam, int x, int y);
-		void picking_body_(const gl::camera& cam, const btVector3& ray);
-		void moveing_body_(const gl::camera& cam, const btVector3& ray);
+		void picking_body_(const btVector3& ray_from, const btVector3& ray_to);
+		void moveing_body_(const btVector3& ray_from, const btVector3& ray_to);
 		void remove_picking_constraint_();
-		void render_world_(int pass);
+		void render_world_(int pass, float alpha);
 		btRigidBody* new_body_(btCollisionShape* shape, const vtx::fvtx& pos, const vtx::fvtx& dir);
+		void add_body_(btRigidBody* body);
+		void post_(const command& cmd);
+		void execute_commands_();
+		void capture_();
+		void publish_(float ms);
+		void step_once_(float dt);
+		void step_loop_();
 	public:
 		//-----------------------------------------------------------------//
 		/*!
@@ -80,7 +139,9 @@ namespace bt {
 			use_6dof_(false), last_picking_pos_(0.0f, 0.0f, 0.0f), last_picking_dist_(0.0f),
 			picked_body_(0), pick_constraint_(0),
 			current_(),
-			render_shadow_(false) { }
+			render_shadow_(false),
+			front_time_(0.0), total_ms_(0.0),
+			running_(false), step_(1.0f / 60.0f), max_sub_steps_(5) { }
 
 
 		//-----------------------------------------------------------------//
@@ -195,7 +256,57 @@ namespace bt {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	シュミレーション
+			@brief	シミュレーション・スレッドの開始
+			@param[in]	step	固定ステップ（秒）
+			@param[in]	max_sub_steps	遅れた場合に１回で追いつくステップ数の上限
+		*/
+		//-----------------------------------------------------------------//
+		void start(float step = 1.0f / 60.0f, uint32_t max_sub_steps = 5);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	シミュレーション・スレッドの停止（溜まったコマンドは実行する）
+		*/
+		//-----------------------------------------------------------------//
+		void stop();
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	シミュレーション・スレッドが動いているか
+			@return 動いている場合「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool is_running() const { return running_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	固定ステップを取得
+			@return 固定ステップ（秒）
+		*/
+		//-----------------------------------------------------------------//
+		float get_step() const { return step_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ステップ時間の統計を取得
+			@return 統計
+		*/
+		//-----------------------------------------------------------------//
+		step_stats get_stats() {
+			std::lock_guard<std::mutex> lock(frame_mutex_);
+			return stats_;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	シュミレーション @n
+					ピッキングをコマンドとして送る。スレッドが動いていない場合は、@n
+					ここでワールドを１ステップ進める（統計にも数える）。
 		*/
 		//-----------------------------------------------------------------//
 		void update(const gl::camera& cam);
@@ -203,7 +314,7 @@ namespace bt {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	レンダリング
+			@brief	レンダリング（公開された姿勢を補間して描画）
 		*/
 		//-----------------------------------------------------------------//
 		void render();
@@ -211,7 +322,21 @@ namespace bt {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	剛体廃棄
+			@brief	ヘッドレス計測 @n
+					地面と num 個の剛体を作り、steps 回（スレッドを使わずに）進める。
+			@param[in]	num		剛体の数
+			@param[in]	steps	ステップ数
+			@return 毎秒のステップ数
+		*/
+		//-----------------------------------------------------------------//
+		double benchmark(uint32_t num, uint32_t steps);
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	剛体廃棄 @n
+					スレッドを止めて、ワールドから外してから形状を消す @n
+					（動いていた場合は、再び開始する）。
 		*/
 		//-----------------------------------------------------------------//
 		void destroy_body();
@@ -4,8 +4,11 @@
 	@author 平松邦仁 (hira@rvf-rc45.net)
 */
 //=====================================================================//
+#include <cstdlib>
+#include <boost/format.hpp>
 #include "main.hpp"
 #include "effv_main.hpp"
+#include "utils/string_utils.hpp"
 
 typedef app::effv_main start_app;
 
@@ -15,8 +18,65 @@ static const vtx::spos start_pos_(10, 40);
 static const vtx::spos start_size_(800, 600);
 static const vtx::spos limit_size_(800, 600);
 
+// ヘッドレス計測：effv -bench file.efk [エフェクト数] [フレーム数] [スレッド数]
+static int bench_(int argc, char** argv)
+{
+	if(argc < 3) {
+		std::cerr << "usage: effv -bench file.efk [effects] [frames] [threads]" << std::endl;
+		return -1;
+	}
+	uint32_t num = 2000;
+	uint32_t frames = 300;
+	uint32_t threads = 1;
+	if(argc > 3) num = std::strtoul(argv[3], nullptr, 10);
+	if(argc > 4) frames = std::strtoul(argv[4], nullptr, 10);
+	if(argc > 5) threads = std::strtoul(argv[5], nullptr, 10);
+
+	::Effekseer::Manager* manager = ::Effekseer::Manager::Create(num * 128);
+	manager->SetUpdateThreadCount(threads);
+
+	utils::wstring path;
+	utils::utf8_to_utf16(argv[2], path);
+	::Effekseer::Effect* effect = ::Effekseer::Effect::Create(manager, path.c_str());
+	if(effect == nullptr) {
+		std::cerr << "Can't load effect: '" << argv[2] << "'" << std::endl;
+		manager->Destroy();
+		return -1;
+	}
+
+	for(uint32_t i = 0; i < num; ++i) {
+		manager->Play(effect, static_cast<float>(i % 64), 0.0f, static_cast<float>(i / 64));
+	}
+
+	uint64_t total = 0;
+	int32_t peak = 0;
+	int32_t max_time = 0;
+	for(uint32_t i = 0; i < frames; ++i) {
+		manager->Update();
+		int32_t t = manager->GetUpdateTime();
+		total += t;
+		if(max_time < t) max_time = t;
+		int32_t n = num * 128 - manager->GetRestInstancesCount();
+		if(peak < n) peak = n;
+	}
+
+	std::cout << boost::format("Effects: %d, Frames: %d, Threads: %d, Instances: %d (peak), "
+		"Update: %.3f ms (average), %.3f ms (max)")
+		% num % frames % threads % peak
+		% (static_cast<double>(total) / frames / 1000.0)
+		% (static_cast<double>(max_time) / 1000.0) << std::endl;
+
+	effect->Release();
+	manager->Destroy();
+	return 0;
+}
+
 int main(int argc, char** argv)
 {
+	if(argc > 1 && std::string(argv[1]) == "-bench") {
+		return bench_(argc, argv);
+	}
+
 	gl::core& core = gl::core::get_instance();
 
 	if(!core.initialize(argc, argv)) {
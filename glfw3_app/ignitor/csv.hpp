@@ -10,15 +10,18 @@
 //=====================================================================//
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <boost/format.hpp>
 
 #include "utils/string_utils.hpp"
+#include "utils/csv_io.hpp"
 
 namespace app {
 
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	/*!
-		@brief  CSV 簡易クラス
+		@brief  CSV 簡易クラス @n
+				※大きな CSV は utils::csv_reader で逐次読み込む事
 	*/
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	class csv {
@@ -164,61 +167,56 @@ namespace app {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief  セーブ
+			@brief  セーブ @n
+					区切り、引用符、改行を含むセルは引用する（RFC 4180）。
 			@param[in]	path	セーブ・パス
 			@return 成功なら「true」
 		*/
 		//-----------------------------------------------------------------//
 		bool save(const std::string& path)
 		{
-			utils::file_io fio;
-			if(!fio.open(path, "wb")) {
+			utils::csv_writer wr;
+			if(!wr.open(path)) {
 				return false;
 			}
 
-			for(uint32_t r = 0; r < cell_.size(); ++r) {
-				utils::strings& line = cell_[r];
-				for(uint32_t c = 0; c < line.size(); ++c) {
-					const std::string& s = line[c];
-					fio.put(s);
-					if(c < (line.size() - 1)) fio.put(",");
-					else if(c == (line.size() - 1)) fio.put("\n");
+			for(const auto& line : cell_) {
+				if(line.empty()) continue;
+				for(const auto& s : line) {
+					wr.put(s);
 				}
+				wr.end_row();
 			}
-			fio.close();
-
-			return true;
+			return wr.close();
 		}
 
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief  ロード
+			@brief  ロード @n
+					作成（create）済みの範囲に、セルを設定する。@n
+					空のセルも位置を保つ（RFC 4180）。
 			@param[in]	path	ロード・パス
 			@return 成功なら「true」
 		*/
 		//-----------------------------------------------------------------//
 		bool load(const std::string& path)
 		{
-			utils::file_io fio;
-			if(!fio.open(path, "rb")) {
+			utils::csv_reader rd;
+			if(!rd.open(path)) {
 				return false;
 			}
 
+			utils::csv_row row;
 			uint32_t lno = 0;
-			while(!fio.eof()) {
-				auto line = fio.get_line();
-				if(line.empty()) continue;
-				auto ss = utils::split_text(line, ",");
-				uint32_t n = 0;
-				for(auto s : ss) {
-					set(n, lno, s);
-					++n;
+			while(rd.next(row) && lno < cell_.size()) {
+				utils::strings& ss = cell_[lno];
+				uint32_t n = std::min(row.size(), static_cast<uint32_t>(ss.size()));
+				for(uint32_t c = 0; c < n; ++c) {
+					ss[c].assign(row[c].data(), row[c].size());
 				}
 				++lno;
 			}
-			fio.close();
-
 			return true;
 		}
 	};
@@ -7,6 +7,9 @@
 //=====================================================================//
 #include "main.hpp"
 #include "player.hpp"
+#ifdef OPTION_MEMORY_ALOCATE
+#include "utils/galloc.hpp"
+#endif
 
 typedef app::player start_app;
 
@@ -18,6 +21,10 @@ static const vtx::spos limit_size_(800, 600);
 
 int main(int argc, char** argv)
 {
+#ifdef OPTION_MEMORY_ALOCATE
+	// 終了時（director の廃棄後）に集計を出力する
+	galloc galloc_(true);
+#endif
 	gl::core& core = gl::core::get_instance();
 
 	if(!core.initialize(argc, argv)) {
@@ -62,7 +69,14 @@ int main(int argc, char** argv)
 		glDisable(GL_DEPTH_TEST);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+#ifdef OPTION_MEMORY_ALOCATE
+		global_memory_setkey("render");
 		director.render();
+		global_memory_restorekey();
+		global_memory_frame();
+#else
+		director.render();
+#endif
 
 		core.flip_frame();
 
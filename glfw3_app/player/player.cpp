@@ -37,6 +37,39 @@ namespace app {
 	}
 
 
+	void player::set_alias_(const std::string& file, const al::tag& t)
+	{
+		using namespace std;
+		const string p = utils::get_file_name(file);
+		// タイトルが無い場合は、ファイル名に戻す
+		if(t.title_.empty()) {
+			filer_->set_alias(p, p);
+			return;
+		}
+		// 75% 一致しない場合
+		if(utils::compare(p, t.title_) >= 0.75f) return;
+		if(!t.track_.empty()) {
+			string n;
+			auto pos = t.track_.find('/');
+			if(pos != string::npos) {
+				n = t.track_.substr(0, pos);
+			} else {
+				n = t.track_;
+			}
+			if(n.size() == 1) {
+				if(n[0] == '0') n.clear();
+				else if(n[0] >= '0' && n[0] <= '9') {
+					n = '0' + n;
+				}
+			}
+			if(!n.empty()) n += ' ';
+			filer_->set_alias(p, n + t.title_);
+		} else {
+			filer_->set_alias(p, t.title_);
+		}
+	}
+
+
 	static void set_time_(gui::widget_label* w, time_t t)
 	{
 		gui::widget_label::param& pa = w->at_local_param();
@@ -93,6 +126,10 @@ namespace app {
 
 		mobj_.initialize();
 
+		// メディア・インデックス
+		index_path_ = core.get_exec_path() + ".idx";
+		index_.load(index_path_);
+
 		auto& fonts = core.at_fonts();
 		auto cf = fonts.get_font_type();
 		auto fp = core.get_current_path();
@@ -481,49 +518,29 @@ namespace app {
 				files_step_ = 0;
 			} else {
 				if(files_.empty()) {
-					if(!sound.state_tag_info()) {
-						files_ = filer_->get_file_list();
-						tag_info_serial_ = sound.get_tag_info().serial_;
-						tag_wait_ = false;
-					}
+					files_ = filer_->get_file_list();
+					files_step_ = 0;
 				} else if(files_step_ < files_.size()) {
-					const al::tag& t = sound.get_tag_info();
-					if(t.serial_ == tag_info_serial_) {
-						if(!tag_wait_) {
-							const std::string fn = files_[files_step_];
-							sound.request_tag_info(fn);
-							tag_wait_ = true;
-						}
-					} else {
-						tag_wait_ = false;
-						tag_info_serial_ = t.serial_;
-						using namespace std;
-						const string p = utils::get_file_name(files_[files_step_]);
-						// 75% 一致しない場合
-						if(utils::compare(p, t.title_) < 0.75f) {
-							if(t.title_.empty()) {
-								filer_->set_alias(p, p);
-							} if(!t.track_.empty()) {
-								string n;
-								auto pos = t.track_.find('/');
-								if(pos != string::npos) {
-									n = t.track_.substr(0, pos);
-								} else {
-									n = t.track_;
+					// 変更の無いファイルはインデックスから得る（更新は別スレッドで行い、終わるのを待たない）
+					if(!index_th_.joinable()) {
+						index_files_ = files_;
+						index_busy_ = true;
+						index_th_ = std::thread([this] {
+							index_.update(index_files_);
+							index_busy_ = false;
+						});
+					} else if(!index_busy_) {
+						index_th_.join();
+						// 更新中にファイル・リストが変わったら、次のサービスでやり直す
+						if(index_files_ == files_) {
+							al::tag t;
+							for(const std::string& fn : files_) {
+								if(index_.get_tag(index_.find(fn), t)) {
+									set_alias_(fn, t);
 								}
-								if(n.size() == 1) {
-									if(n[0] == '0') n.clear();
-									else if(n[0] >= '0' && n[0] <= '9') {
-										n = '0' + n;
-									}
-								}
-								if(!n.empty()) n += ' ';
-								filer_->set_alias(p, n + t.title_);
-							} else {
-								filer_->set_alias(p, t.title_);
 							}
+							files_step_ = files_.size();
 						}
-						++files_step_;
 					}
 				}
 			}
@@ -605,5 +622,12 @@ namespace app {
 		if(filer_) {
 			filer_->save(pre);
 		}
+
+		if(index_th_.joinable()) {
+			index_th_.join();
+		}
+		if(index_.is_modify()) {
+			index_.save(index_path_);
+		}
 	}
 }
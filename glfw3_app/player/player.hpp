@@ -6,6 +6,8 @@
 */
 //=====================================================================//
 #include <time.h>
+#include <atomic>
+#include <thread>
 #include "main.hpp"
 #include "utils/director.hpp"
 #include "widgets/widget_filer.hpp"
@@ -14,6 +16,7 @@
 #include "widgets/widget_check.hpp"
 #include "widgets/widget_dialog.hpp"
 #include "gl_fw/glmobj.hpp"
+#include "snd_io/media_index.hpp"
 
 namespace app {
 
@@ -70,11 +73,16 @@ namespace app {
 
 		utils::strings	files_;
 		uint32_t		files_step_;
-		uint32_t		tag_info_serial_;
-		bool			tag_wait_;
+
+		al::media_index	index_;
+		std::string		index_path_;
+		std::thread		index_th_;		///< インデックス更新スレッド
+		std::atomic<bool>	index_busy_;	///< 更新中
+		utils::strings	index_files_;	///< 更新するファイル（更新中は触らない）
 
 		static std::string tag_server_(const std::string path);
 		void sound_play_(const std::string& file);
+		void set_alias_(const std::string& file, const al::tag& t);
 		gui::widget* create_image_button_(const std::string& file, const vtx::spos& pos);
 		gui::widget_label* create_text_pad_(const vtx::spos& size, const std::string& text,
 			const std::string& font = "", bool proportional = true);
@@ -95,7 +103,8 @@ namespace app {
 			total_t_(0), remain_t_(0), seek_pos_(0),
 			tag_serial_(0), jacket_(0), drop_file_id_(0),
 			mouse_pos_(0), mouse_scr_(0), filer_count_(0),
-			files_step_(0), tag_info_serial_(0), tag_wait_(false)
+			files_step_(0), index_(), index_path_(),
+			index_th_(), index_busy_(false), index_files_()
 		{ }
 
 
@@ -104,7 +113,9 @@ namespace app {
 			@brief  デストラクター
 		*/
 		//-----------------------------------------------------------------//
-		virtual ~player() { }
+		virtual ~player() {
+			if(index_th_.joinable()) index_th_.join();
+		}
 
 
 		//-----------------------------------------------------------------//
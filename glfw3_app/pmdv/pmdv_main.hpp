@@ -15,6 +15,8 @@
 #include "widgets/widget_terminal.hpp"
 #include "mdf/pmd_io.hpp"
 #include "mdf/pmx_io.hpp"
+#include "mdf/vmd_io.hpp"
+#include "mdf/motion.hpp"
 #include "gl_fw/glcamera.hpp"
 #include "gl_fw/gllight.hpp"
 
@@ -43,6 +45,12 @@ namespace app {
 		mdf::pmx_io		pmx_io_;
 		bool			pmx_enable_;
 
+		mdf::vmd_io		vmd_io_;
+		mdf::motion		motion_;
+		mdf::motion::pose	pose_;
+		float			frame_;
+		bool			motion_enable_;
+
 		gl::camera		camera_;
 		gl::light		light_;
 		gl::light::handle	bone_light_;
@@ -109,6 +117,7 @@ namespace app {
 			tree_frame_(0), tree_(0),
 			terminal_frame_(0), terminal_(0),
 			pmd_io_(), pmx_io_(), pmx_enable_(false),
+			vmd_io_(), motion_(), pose_(), frame_(0.0f), motion_enable_(false),
 			bone_light_(0)
 		{ }
 
@@ -248,9 +257,30 @@ namespace app {
 					std::string info;
 					pmx_io_.get_info(info);
 					terminal_->output(info);
+					motion_.setup(pmx_io_);
+					motion_.create_pose(pose_);
+					motion_enable_ = false;
+				} else if(vmd_io_.load(filer_->get_file())) {
+					std::string info;
+					vmd_io_.get_info(info);
+					terminal_->output(info);
+					if(pmx_enable_) {
+						uint32_t n = motion_.bind(vmd_io_);
+						terminal_->output((boost::format("Bind: %d\n") % n).str());
+						frame_ = 0.0f;
+						motion_enable_ = true;
+					}
 				}
 			}
 
+			// モーションの再生（30 フレーム／秒）
+			if(motion_enable_ && pmx_enable_) {
+				motion_.evaluate(frame_, pose_);
+				pmx_io_.skinning(pose_.skin_);
+				frame_ += 0.5f;
+				if(frame_ > static_cast<float>(vmd_io_.get_last_frame())) frame_ = 0.0f;
+			}
+
 			if(!wd.update()) {
 				camera_.update();
 			}
@@ -8,7 +8,7 @@
 #include "spinv.hpp"
 #include "core/glcore.hpp"
 #include "gl_fw/glutils.hpp"
-#include "utils/unzip.hpp"
+#include "utils/zip_archive.hpp"
 #include "widgets/widget_dialog.hpp"
 
 #include "utils/format.hpp"
@@ -36,26 +36,31 @@ namespace app {
     			"Ufo", "Walk1", "Walk2", "Walk3",
 				"Walk4", "Shot", "UfoHit", "BaseHit", "InvHit"
 			};
-			utils::unzip zip;
+			utils::zip_archive zip;
 			std::string sda = "sounds.zip";
 			if(zip.open(sda)) {
 				if(zip.file_count() == 9) {
+					// 全ての展開を先に要求して、ワーカー・スレッドで並列に展開する
+					int hs[9];
 					for(int i = 0; i < 9; ++i) {
 						std::string fn = sounds[i];
 						fn += ".wav";
-						int h = zip.find(fn);
-						if(h < 0) {
+						hs[i] = zip.find(fn);
+						if(hs[i] < 0) {
 							fn = sounds[i];
 							fn += ".Wav";
-							h = zip.find(fn);
+							hs[i] = zip.find(fn);
 						}
+						if(hs[i] >= 0) zip.prefetch(hs[i]);
+					}
+					for(int i = 0; i < 9; ++i) {
+						std::string fn = sounds[i];
+						fn += ".wav";
+						int h = hs[i];
 						if(h >= 0) {
-							std::vector<char> wav;
-							size_t wn = zip.get_filesize(h);
-							wav.reserve(wn);
-							zip.get_file(h, &wav[0]);
+							auto sp = zip.get(h);
 							utils::file_io fin;
-							if(fin.open(&wav[0], wn)) {
+							if(sp.valid() && fin.open(sp.data, sp.size, sp.hold)) {
 								se_id_[i] = sound.load(fin, "wav");
 								fin.close();
 							}
@@ -84,22 +89,29 @@ namespace app {
 		// invaders.zip 展開（ROM イメージ）
 		std::string romerr;
 		{
-			utils::unzip zip;
+			utils::zip_archive zip;
 			std::string romzip = "invaders.zip";
 //			std::string romzip = "spaceat2.zip";
 			if(zip.open(romzip)) {
-				rom_.reserve(0x2000);
+				rom_.resize(0x2000);
 				static const char* rom_files[] = {
 					"invaders.h", "invaders.g", "invaders.f", "invaders.e"
 //					"spaceatt.h", "spaceatt.g", "spaceatt.f", "spaceatt.e"
 				};
 				for(int i = 0; i < 4; ++i) {
 					int h = zip.find(rom_files[i]);
-					if(h < 0) {
+					if(h >= 0) zip.prefetch(h);
+				}
+				for(int i = 0; i < 4; ++i) {
+					int h = zip.find(rom_files[i]);
+					auto sp = h >= 0 ? zip.get(h) : utils::zip_archive::span();
+					if(!sp.valid()) {
 						if(!romerr.empty()) romerr += ", ";
 						romerr += rom_files[i];
+						continue;
 					}
-					zip.get_file(h, &rom_[i * 0x800]);
+					size_t n = sp.size < 0x800 ? sp.size : 0x800;
+					std::memcpy(&rom_[i * 0x800], sp.data, n);
 				}
 
 				uint32_t sum = 0;
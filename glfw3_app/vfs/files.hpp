@@ -8,7 +8,9 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include <array>
 #include <cstring>
+#include <iostream>
 #include "tree_unit.hpp"
 #include "fio.hpp"
 
@@ -47,28 +49,10 @@ namespace vfs {
 
 
 		void remove_(uint32_t hnd) {
-			std::unordered_set<uint16_t> rm_list;
-			if(finfos_[hnd].path_.back() == '/') { // directory
-				finfos_[hnd].reset();
-				return;
-			} else {
-				for(const finfo::block& bk : finfos_[hnd].blocks_) {
-					rm_list.insert(bk.fileno_);
-				}
-			}
-
-			for(finfo& fi : finfos_) {
-				if(fi.handle_ == hnd) continue;
-				for(const finfo::block& bk : fi.blocks_) {
-					rm_list.erase(bk.fileno_);
-				}
+			if(finfos_[hnd].path_.back() != '/') { // file
+				fio_.release(finfos_[hnd]);
 			}
-
 			finfos_[hnd].reset();
-
-			for(uint16_t h : rm_list) {
-				fio_.remove_file(h);
-			}
 		}
 
 	public:
@@ -78,7 +62,7 @@ namespace vfs {
 			@param[in]	base	ベース・パス
 		*/
 		//-----------------------------------------------------------------//
-		files(const std::string& base) : tree_unit_(), finfos_(), fio_(finfos_, base) { }
+		files(const std::string& base) : tree_unit_(), finfos_(), fio_(base) { }
 
 
 		//-----------------------------------------------------------------//
@@ -212,9 +196,14 @@ namespace vfs {
 			@return 「-1」なら失敗
 		*/
 		//-----------------------------------------------------------------//
-		int file_size(const std::string& path) {
+		int file_size(const std::string& path) const {
 			if(path.empty()) return -1;
-			return fio_.file_size(path);
+			auto hnd = tree_unit_.find(path);
+			if(hnd == 0 || hnd >= finfos_.size()) return -1;
+			const finfo& fi = finfos_[hnd];
+			if(fi.path_.empty() || fi.path_.back() == '/') return -1;
+			if(fi.open_mode_ == open_mode::write) return static_cast<int>(fi.fpos_);
+			return static_cast<int>(fi.fsize_);
 		}
 
 
@@ -253,6 +242,7 @@ namespace vfs {
 			int rl = 0;
 			do {
 				rl = read(srchnd, &buffer[0], buffer.size());
+				if(rl <= 0) break;
 				write(dsthnd, &buffer[0], rl);
 			} while(rl > 0) ;
 			close(dsthnd);
@@ -278,6 +268,7 @@ namespace vfs {
 				resize_infos_(hnd);
 				finfo& fi = finfos_[hnd];
 				if(fi.open_mode_ != vfs::open_mode::none) return 0;
+				fio_.release(fi);  // 既存のファイルの領域は開放
 				fi.path_ = tree_unit_.create_full_path(path);
 				fi.handle_ = hnd;
 				fi.open_mode_ = opm;
@@ -285,14 +276,13 @@ namespace vfs {
 				fi.create_cash();
 				fi.cpos_ = 0;
 				fi.fpos_ = 0;
-				fi.blocks_.clear();
 			} else if(opm == open_mode::read) {
 				hnd = tree_unit_.find(path);
 				if(hnd == 0) return 0;
 				finfo& fi = finfos_[hnd];
 				if(fi.open_mode_ != vfs::open_mode::none) return 0;
+				if(fi.path_.empty() || fi.path_.back() == '/') return 0;
 				fi.open_mode_ = opm;
-				fi.create_cash();
 				fi.cpos_ = 0;
 				fi.fpos_ = 0;
 			}
@@ -327,12 +317,13 @@ namespace vfs {
 						cs = size;
 					}
 					std::memcpy(fi.cash_ptr(fi.cpos_), src, cs);
+					src = static_cast<const uint8_t*>(src) + cs;
 					fi.cpos_ += cs;
 					fi.fpos_ += cs;
 					size -= cs;
 					ret += static_cast<int>(cs);
 					if(fi.cpos_ >= fi.cash_size()) {
-						fio_.write_cash(fi, false);
+						if(!fio_.write_cash(fi, false)) return -1;
 					}
 				}
 			}
@@ -358,25 +349,7 @@ namespace vfs {
 					return ret;
 				}
 
-				ret = 0;
-				while(size > 0) {
-					if(fi.cpos_ == 0) {
-						if(!fio_.read_cash(fi)) {
-							return -1;
-						}
-					}
-					if(fi.fpos_ >= fi.fsize_) break;
-					if(fi.cpos_ > 0) {
-						uint32_t cps;
-						if(size < fi.cpos_) cps = size;
-						else cps = fi.cpos_;
-						std::memcpy(dst, fi.cash_ptr(fi.fpos_ % fi.cash_size()), cps);
-						fi.cpos_ -= cps;
-						fi.fpos_ += cps;
-						size -= cps;
-						ret += static_cast<int>(cps);
-					}
-				}
+				ret = fio_.read(fi, dst, size);
 			}
 			return ret;
 		}
@@ -395,7 +368,7 @@ namespace vfs {
 			int ret = -1;
 			if(hnd < finfos_.size() && finfos_[hnd].handle_ == hnd) {
 				finfo& fi = finfos_[hnd];
-				if(fi.open_mode_ != vfs::open_mode::read) {
+				if(fi.open_mode_ == vfs::open_mode::none) {
 					return ret;
 				}
 
@@ -410,8 +383,14 @@ namespace vfs {
 				} else {
 					return ret;
 				}
-				if(pos > fi.fsize_) pos = fi.fsize_;
+				if(fi.open_mode_ == vfs::open_mode::write) {
+					// 書き込み中は、追記のみ（現在位置へのシークだけ許す）
+					if(pos != fi.fpos_) return ret;
+				} else if(pos > fi.fsize_) {
+					pos = fi.fsize_;
+				}
 				fi.fpos_ = pos;
+				ret = static_cast<int>(pos);
 			}
 			return ret;
 		}
@@ -448,7 +427,7 @@ namespace vfs {
 			if(hnd < finfos_.size() && finfos_[hnd].handle_ == hnd) {
 				const finfo& fi = finfos_[hnd];
 				if(fi.open_mode_ != vfs::open_mode::none) {
-					if(fi.fpos_ == fi.fsize_) ret = 1;
+					if(fi.open_mode_ == open_mode::write || fi.fpos_ >= fi.fsize_) ret = 1;
 					else ret = 0;
 				}				
 			}
@@ -471,8 +450,6 @@ namespace vfs {
 					fi.fsize_ = fi.fpos_;
 					fi.destroy_cash();
 				} else if(fi.open_mode_ == open_mode::read) {
-					fio_.read_close(fi);
-					fi.destroy_cash();
 				} else {
 					return false;
 				}
@@ -493,6 +470,44 @@ namespace vfs {
 		}
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ディレクトリー情報と、コンテナのファイルを全て消す @n
+					※再び使う場合は start を呼ぶ
+		*/
+		//-----------------------------------------------------------------//
+		void remove_all() {
+			fio_.remove_all();
+			tree_unit_.clear();
+			finfos_.clear();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンパクション @n
+					全てのファイルを詰めて書き直し、空き領域を無くす。@n
+					※オープン中のファイルがある場合は失敗する
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool compact() {
+			for(const auto& fi : finfos_) {
+				if(fi.handle_ != 0 && fi.open_mode_ != open_mode::none) return false;
+			}
+			return fio_.compact(finfos_);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイル I/O を得る（統計情報など）
+			@return ファイル I/O
+		*/
+		//-----------------------------------------------------------------//
+		const fio& get_fio() const { return fio_; }
+
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief	ファイルリストを表示
@@ -528,6 +543,9 @@ namespace vfs {
 				++n;
 			}
 			std::cout << "Total files: " << n << std::endl;
+			const free_map& fm = fio_.get_free_map();
+			std::cout << "Containers: " << fio_.container_count() << ", Free: " << fm.count()
+				<< " extents, " << fm.total() * finfo::file_align_size_ << " bytes" << std::endl;
 			std::cout << std::endl;
 #endif
 		}
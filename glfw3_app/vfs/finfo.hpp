@@ -0,0 +1,127 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	ファイル情報（VFS）
+	@author	平松邦仁 (hira@bexide.co.jp)
+*/
+//=====================================================================//
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace vfs {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	オープン・モード
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	enum class open_mode : uint8_t {
+		none,	///< オープンしていない
+		read,	///< 読み込み
+		write	///< 書き込み
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	シーク・モード
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	enum class seek_mode : uint8_t {
+		set,	///< 先頭から
+		cur,	///< 現在位置から
+		end		///< 終端から（終端から手前へのオフセット）
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	ファイル情報・クラス @n
+				ファイルの実体は、コンテナ・ファイル上の連続した領域（ブロック）@n
+				の並びで、ブロックは file_align_size_ 単位で確保される。
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct finfo {
+
+		static const uint32_t file_align_size_ = 512;				///< アライメント（確保単位）
+		static const uint32_t cash_size_ = 8192;					///< 書き込みキャッシュのサイズ
+		static const uint32_t file_limit_size_ = 16 * 1024 * 1024;	///< コンテナ・ファイルの最大サイズ
+
+		//=================================================================//
+		/*!
+			@brief	ブロック（コンテナ上の連続領域）
+		*/
+		//=================================================================//
+		struct block {
+			uint16_t	fileno_;	///< コンテナ番号（０から）
+			uint16_t	offset_;	///< 先頭（file_align_size_ 単位）
+			uint16_t	blocks_;	///< 長さ（file_align_size_ 単位）
+			block() : fileno_(0), offset_(0), blocks_(0) { }
+			block(uint16_t fileno, uint16_t offset, uint16_t blocks) :
+				fileno_(fileno), offset_(offset), blocks_(blocks) { }
+
+			uint32_t top() const { return static_cast<uint32_t>(offset_) * file_align_size_; }
+			uint32_t size() const { return static_cast<uint32_t>(blocks_) * file_align_size_; }
+			uint32_t end() const { return top() + size(); }
+		};
+		typedef std::vector<block> blocks;
+
+		uint32_t	handle_;
+		std::string	path_;
+		uint32_t	fsize_;
+		blocks		blocks_;
+
+		open_mode	open_mode_;
+		uint32_t	cpos_;		///< キャッシュ内の位置
+		uint32_t	fpos_;		///< ファイル位置
+
+		std::vector<uint8_t>	cash_;
+
+		finfo() : handle_(0), path_(), fsize_(0), blocks_(),
+			open_mode_(open_mode::none), cpos_(0), fpos_(0), cash_() { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	リセット
+		*/
+		//-----------------------------------------------------------------//
+		void reset() {
+			handle_ = 0;
+			path_.clear();
+			fsize_ = 0;
+			blocks_.clear();
+			open_mode_ = open_mode::none;
+			cpos_ = 0;
+			fpos_ = 0;
+			destroy_cash();
+		}
+
+
+		void create_cash() { cash_.resize(cash_size_); }
+
+		void destroy_cash() { std::vector<uint8_t>().swap(cash_); }
+
+		uint32_t cash_size() const { return static_cast<uint32_t>(cash_.size()); }
+
+		uint8_t* cash_ptr(uint32_t ofs = 0) { return &cash_[ofs]; }
+
+		const uint8_t* cash_ptr(uint32_t ofs = 0) const { return &cash_[ofs]; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	確保済みの容量（ブロックの総和）
+			@return 容量（バイト）
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t capacity() const {
+			uint32_t n = 0;
+			for(const auto& bk : blocks_) n += bk.size();
+			return n;
+		}
+	};
+
+	typedef std::vector<finfo> finfos;
+}
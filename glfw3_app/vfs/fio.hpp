@@ -1,24 +1,35 @@
 #pragma once
 //=====================================================================//
 /*!	@file
-	@brief	ファイル I/O ラッパー
+	@brief	ファイル I/O ラッパー @n
+			コンテナ・ファイル（base + "0001" ...）上の領域の割り当て、@n
+			読み書き、先読み、コンパクションを行う。@n
+			コンテナ "0000" はディレクトリー情報。
 	@author	平松邦仁 (hira@bexide.co.jp)
 */
 //=====================================================================//
-#ifdef WIN32
-#include <cstdint>
-#include <cstdio>
-#include <cstdlib>
-#endif
 #ifdef __psp2__
 #include <stdint.h>
 #include <stddef.h>
 #include <kernel.h>
 #include <apputil.h>
+#else
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
 #endif
+#endif
+#include <cstring>
 #include <string>
 #include <vector>
+#include <array>
+#include <algorithm>
 #include "finfo.hpp"
+#include "free_map.hpp"
 
 namespace vfs {
 
@@ -28,25 +39,43 @@ namespace vfs {
 	*/
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	class fio {
+	public:
+		static const uint32_t read_ahead_size_ = 64 * 1024;	///< 先読みウィンドウのサイズ
+		static const uint32_t read_ahead_num_ = 4;				///< 先読みウィンドウの数
 
-		finfos	fis_;
-
+	private:
 		std::string	base_;
 
 		struct fidx {
-			open_mode	opm_;
-			uint32_t	pos_;
-			uint32_t	hnd_;
-			fidx() : opm_(open_mode::none), pos_(0), hnd_(0) { }
-			void reset() {
-				pos_ = 0;
-				hnd_ = 0;
-			}
+			uint32_t	end_;	///< 使用終端（バイト）
+#ifndef __psp2__
+			FILE*		fp_;
+			fidx() : end_(0), fp_(nullptr) { }
+#else
+			fidx() : end_(0) { }
+#endif
 		};
 		std::vector<fidx>	fidxes_;
 
-		std::string block_name_(uint16_t nmb) {
+		free_map	free_map_;
+
+		// 先読みウィンドウ（隣接するブロックは、まとめて読む）
+		struct window {
+			uint32_t	fileno_;
+			uint32_t	top_;
+			uint32_t	len_;
+			uint32_t	stamp_;
+			std::vector<uint8_t>	buff_;
+			window() : fileno_(0), top_(0), len_(0), stamp_(0), buff_() { }
+		};
+		std::array<window, read_ahead_num_>	windows_;
+		uint32_t	stamp_;
+
+		uint32_t	read_count_;	///< ホストへの読み込み回数
+
+		std::string block_name_(uint16_t nmb, bool temp = false) const {
 			std::string s = base_;
+			if(temp) s += '~';
 			char tmp[4];
 			for(int i = 3; i >= 0; --i) {
 				tmp[i] = (nmb % 10) + '0';
@@ -59,8 +88,11 @@ namespace vfs {
 		}
 
 
-#ifdef WIN32
+#ifndef __psp2__
+		FILE*	tmp_fp_;
+
 		void init_() {
+			tmp_fp_ = nullptr;
 		}
 
 
@@ -75,58 +107,84 @@ namespace vfs {
 			return -1;
 		}
 
-		
-		void file_align_(FILE* fp, uint32_t als) {
-			uint32_t pos = ftell(fp);
-			uint32_t mod = als - (pos % als);
-			//			std::cout << static_cast<int>(pos) << ", " << static_cast<int>(mod) << std::endl;
-			if(mod) {
-				std::vector<uint8_t> tmp;
-				tmp.resize(mod, 0);
-				fwrite(&tmp[0], mod, 1, fp);
+
+		FILE* handle_(uint32_t idx) {
+			fidx& fx = fidxes_[idx];
+			if(fx.fp_ == nullptr) {
+				auto path = block_name_(idx + 1);
+				if(fx.end_ > 0) fx.fp_ = fopen(path.c_str(), "r+b");
+				if(fx.fp_ == nullptr) fx.fp_ = fopen(path.c_str(), "w+b");
 			}
+			return fx.fp_;
 		}
 
 
-		void write_(uint32_t idx, const finfo& fi, bool close) {
-			const char* om;
-			if(fidxes_[idx].pos_ == 0) {
-				om = "wb";  // new file
-			} else {
-				om = "ab";  // append file
+		void close_(uint32_t idx) {
+			fidx& fx = fidxes_[idx];
+			if(fx.fp_ != nullptr) {
+				fclose(fx.fp_);
+				fx.fp_ = nullptr;
 			}
-			FILE* fp = fopen(block_name_(idx + 1).c_str(), om);
-			if(fp != nullptr) {
-				if(fi.cpos_) fwrite(fi.cash_ptr(), 1, fi.cpos_, fp);
-				if(close) file_align_(fp, finfo::file_align_size_);
-				fidxes_[idx].pos_ = ftell(fp);
-				fidxes_[idx].hnd_ = fi.handle_;
-				//				std::cout << static_cast<int>(fidxes_[idx].pos_) << std::endl;
-				fclose(fp);
+		}
+
+
+		uint32_t read_at_(uint32_t idx, uint32_t pos, void* dst, uint32_t len) {
+			FILE* fp = handle_(idx);
+			if(fp == nullptr) return 0;
+			++read_count_;
+			fseek(fp, pos, SEEK_SET);
+			return fread(dst, 1, len, fp);
+		}
+
+
+		bool write_at_(uint32_t idx, uint32_t pos, const void* src, uint32_t len) {
+			FILE* fp = handle_(idx);
+			if(fp == nullptr) return false;
+			fseek(fp, pos, SEEK_SET);
+			return fwrite(src, 1, len, fp) == len;
+		}
+
+
+		bool write_temp_(uint32_t idx, uint32_t pos, const void* src, uint32_t len) {
+			if(pos == 0) {
+				if(tmp_fp_ != nullptr) fclose(tmp_fp_);
+				tmp_fp_ = fopen(block_name_(idx + 1, true).c_str(), "wb");
 			}
+			if(tmp_fp_ == nullptr) return false;
+			return fwrite(src, 1, len, tmp_fp_) == len;
 		}
 
 
-		bool read_(uint32_t idx, finfo& fi) {
-			FILE* fp = fopen(block_name_(idx + 1).c_str(), "rb");
-			if(fp != nullptr) {
-				fseek(fp, fi.fpos_, SEEK_SET);
-				uint32_t rl = fi.fsize_ - fi.fpos_;
-				if(rl > fi.cash_size()) rl = fi.cash_size();
-				fi.cpos_ = fread(fi.cash_ptr(), 1, rl, fp);
-				//				std::cout << "Read: " << static_cast<int>(fi.fpos_) << ", " << static_cast<int>(fi.cpos_) << std::endl;
-				fclose(fp);
-				return true;
-			} else {
-				return false;
+		void close_temp_() {
+			if(tmp_fp_ != nullptr) {
+				fclose(tmp_fp_);
+				tmp_fp_ = nullptr;
 			}
 		}
 
+
+		void truncate_(uint32_t idx, uint32_t size) {
+			FILE* fp = handle_(idx);
+			if(fp == nullptr) return;
+			fflush(fp);
+#ifdef WIN32
+			_chsize(_fileno(fp), size);
+#else
+			if(ftruncate(fileno(fp), size) != 0) { }
+#endif
+		}
+
+
 		void remove_file_(const std::string& path) {
 			remove(path.c_str());  // for POSIX a remove file
 		}
 
 
+		bool rename_file_(const std::string& src, const std::string& dst) {
+			return rename(src.c_str(), dst.c_str()) == 0;
+		}
+
+
 		void write_dir_(const std::string& path, const finfos& fis) {
 			FILE* fp = fopen(path.c_str(), "wb");
 			if(fp != nullptr) {
@@ -139,11 +197,11 @@ namespace vfs {
 					fwrite(&fi.fsize_, sizeof(fi.fsize_), 1, fp);
 					uint32_t len = fi.blocks_.size();
 					fwrite(&len, sizeof(len), 1, fp);
-					fwrite(&fi.blocks_[0], sizeof(finfo::block), len, fp);
+					if(len > 0) fwrite(&fi.blocks_[0], sizeof(finfo::block), len, fp);
 					uint32_t pos = ftell(fp);
 					path.clear();
-					path.resize(256 - (pos & 255), 0);
-					fwrite(path.c_str(), path.size(), 1, fp);
+					path.resize((256 - (pos & 255)) & 255, 0);
+					if(!path.empty()) fwrite(path.c_str(), path.size(), 1, fp);
 				}
 				fclose(fp);
 			}
@@ -158,24 +216,25 @@ namespace vfs {
 				fseek(fp, 0, SEEK_SET);
 				while(fs > 0) {
 					char buff[256];
-					fread(buff, 256, 1, fp);
+					if(fread(buff, 256, 1, fp) != 1) break;
+					buff[255] = 0;
 					finfo fi;
 					fi.path_ = buff;
 //					std::cout << buff << std::endl;
 					fread(&fi.fsize_, sizeof(fi.fsize_), 1, fp);
-					uint32_t len;
+					uint32_t len = 0;
 					fread(&len, sizeof(len), 1, fp);
 					fi.blocks_.resize(len);
-					fread(&fi.blocks_[0], sizeof(finfo::block), len, fp);
+					if(len > 0) fread(&fi.blocks_[0], sizeof(finfo::block), len, fp);
 					uint32_t pos = ftell(fp);
-					fseek(fp, 256 - (pos & 255), SEEK_CUR);
-					fs -= 512;
+					pos += (256 - (pos & 255)) & 255;
+					fseek(fp, pos, SEEK_SET);
+					fs = file_size_(path) - static_cast<int>(pos);
 					fis.push_back(fi);
 				}
 				fclose(fp);
 			}
 		}
-
 #endif
 
 #ifdef __psp2__
@@ -273,39 +332,45 @@ namespace vfs {
 		}
 
 
-		void write_(uint32_t idx, finfo& fi, bool close) {
-			auto path = block_name_(idx + 1);
+		void close_(uint32_t idx) { }
 
-			// アライメントして書き込み
-			uint32_t len = fi.cpos_;
-			uint32_t mod = len % finfo::file_align_size_;
-			if(mod) {
-				len += finfo::file_align_size_ - mod;
-				std::memset(fi.cash_ptr(fi.cpos_), 0, finfo::file_align_size_ - mod);
-			}
-			write_sub_(path, fi.cash_ptr(), fidxes_[idx].pos_, len);
-			fidxes_[idx].pos_ += len;
-			fidxes_[idx].hnd_ = fi.handle_;
-		}
 
-
-		bool read_(uint32_t idx, finfo& fi) {
+		uint32_t read_file_(const std::string& name, uint32_t pos, void* dst, uint32_t len) {
 			std::string path("savedata0:");
-			path += block_name_(idx + 1);
+			path += name;
 			int fd = sceIoOpen(path.c_str(), SCE_O_RDONLY, 0);
-			if(fd >= 0) {
-				sceIoLseek32(fd, fi.fpos_, SCE_SEEK_SET);
-				uint32_t rl = fi.fsize_ - fi.fpos_;
-				if(rl > fi.cash_size()) rl = fi.cash_size();
-				int rlen = sceIoRead(fd, fi.cash_ptr(), rl);
-				if(rlen >= 0) fi.cpos_ = rlen;
-				sceIoClose(fd);
-				return true;
-			}
-			return false;
+			if(fd < 0) return 0;
+			sceIoLseek32(fd, pos, SCE_SEEK_SET);
+			int rlen = sceIoRead(fd, dst, len);
+			sceIoClose(fd);
+			return rlen >= 0 ? static_cast<uint32_t>(rlen) : 0;
 		}
 
 
+		uint32_t read_at_(uint32_t idx, uint32_t pos, void* dst, uint32_t len) {
+			++read_count_;
+			return read_file_(block_name_(idx + 1), pos, dst, len);
+		}
+
+
+		bool write_at_(uint32_t idx, uint32_t pos, const void* src, uint32_t len) {
+			write_sub_(block_name_(idx + 1), src, pos, len);
+			return true;
+		}
+
+
+		bool write_temp_(uint32_t idx, uint32_t pos, const void* src, uint32_t len) {
+			write_sub_(block_name_(idx + 1, true), src, pos, len);
+			return true;
+		}
+
+
+		void close_temp_() { }
+
+
+		void truncate_(uint32_t idx, uint32_t size) { }
+
+
 		void remove_file_(const std::string& path) {
 			char sdFile[SCE_APPUTIL_MOUNTPOINT_DATA_MAXSIZE + 256];
 			memset(sdFile, 0, sizeof(sdFile));
@@ -331,25 +396,36 @@ namespace vfs {
 		}
 
 
+		// セーブデータには名前の変更が無いので、コピーして消す
+		bool rename_file_(const std::string& src, const std::string& dst) {
+			int fs = file_size_(std::string("savedata0:") + src);
+			if(fs < 0) return false;
+			std::vector<uint8_t> tmp(fs);
+			if(fs > 0 && read_file_(src, 0, &tmp[0], fs) != static_cast<uint32_t>(fs)) return false;
+			if(fs > 0) write_sub_(dst, &tmp[0], 0, fs);
+			remove_file_(src);
+			return true;
+		}
+
+
 		void write_dir_(const std::string& path, const finfos& fis) {
-//			write_sub_(path, fi.cash_ptr(), fidxes_[idx].pos_, len);
 			uint32_t i = 0;
 			for(auto& fi : fis) {
 				if(fi.handle_ == 0) continue;
 				std::vector<uint8_t> buff;
-				buff.resize(512, uint8_t(0));
+				uint32_t len = fi.blocks_.size();
+				uint32_t rec = (256 + sizeof(fi.fsize_) + sizeof(len) + sizeof(finfo::block) * len + 255) & ~255u;
+				buff.resize(rec, uint8_t(0));
 				uint32_t pos = 0;
 				std::memcpy(&buff[pos], fi.path_.c_str(), fi.path_.size() + 1);
 				pos += 256;
 				std::memcpy(&buff[pos], &fi.fsize_, sizeof(fi.fsize_));
 				pos += sizeof(fi.fsize_);
-				uint32_t len = fi.blocks_.size();
 				std::memcpy(&buff[pos], &len, sizeof(len));
 				pos += sizeof(len);
-				std::memcpy(&buff[pos], &fi.blocks_[0], sizeof(finfo::block) * fi.blocks_.size());
-//				pos += sizeof(finfo::block) * fi.blocks_.size();
-				write_sub_(path, &buff[0], 512 * i, 512);
-				++i;
+				if(len > 0) std::memcpy(&buff[pos], &fi.blocks_[0], sizeof(finfo::block) * len);
+				write_sub_(path, &buff[0], i, rec);
+				i += rec;
 			}
 		}
 
@@ -364,6 +440,7 @@ namespace vfs {
 				while(fs > 0) {
 					char buff[256];
 					sceIoRead(fd, buff, 256);
+					buff[255] = 0;
 					finfo fi;
 					fi.path_ = buff;
 //					std::cout << buff << std::endl;
@@ -371,10 +448,11 @@ namespace vfs {
 					uint32_t len;
 					sceIoRead(fd, &len, sizeof(len));
 					fi.blocks_.resize(len);
-					sceIoRead(fd, &fi.blocks_[0], sizeof(finfo::block) * len);
+					if(len > 0) sceIoRead(fd, &fi.blocks_[0], sizeof(finfo::block) * len);
 					uint32_t pos = sceIoLseek32(fd, 0, SCE_SEEK_CUR);
-					sceIoLseek32(fd, 256 - (pos & 255), SCE_SEEK_CUR);
-					fs -= 512;
+					pos = sceIoLseek32(fd, (256 - (pos & 255)) & 255, SCE_SEEK_CUR);
+					fs = sceIoLseek32(fd, 0, SCE_SEEK_END) - pos;
+					sceIoLseek32(fd, pos, SCE_SEEK_SET);
 					fis.push_back(fi);
 				}
 				sceIoClose(fd);
@@ -382,6 +460,82 @@ namespace vfs {
 		}
 #endif
 
+		void invalidate_(uint32_t idx, uint32_t top, uint32_t end) {
+			for(auto& w : windows_) {
+				if(w.len_ == 0 || w.fileno_ != idx) continue;
+				if(top < (w.top_ + w.len_) && w.top_ < end) w.len_ = 0;
+			}
+		}
+
+
+		// 先読みウィンドウを通して読む
+		bool read_ahead_(uint32_t idx, uint32_t pos, uint8_t* dst, uint32_t len) {
+			if(len >= read_ahead_size_) {
+				return read_at_(idx, pos, dst, len) == len;
+			}
+			++stamp_;
+			window* lru = &windows_[0];
+			for(auto& w : windows_) {
+				if(w.len_ > 0 && w.fileno_ == idx && w.top_ <= pos && (pos + len) <= (w.top_ + w.len_)) {
+					std::memcpy(dst, &w.buff_[pos - w.top_], len);
+					w.stamp_ = stamp_;
+					return true;
+				}
+				if(w.stamp_ < lru->stamp_) lru = &w;
+			}
+			uint32_t wl = read_ahead_size_;
+			if((pos + wl) > fidxes_[idx].end_) wl = fidxes_[idx].end_ - pos;
+			if(wl < len) wl = len;
+			lru->buff_.resize(read_ahead_size_);
+			lru->len_ = read_at_(idx, pos, &lru->buff_[0], wl);
+			lru->fileno_ = idx;
+			lru->top_ = pos;
+			lru->stamp_ = stamp_;
+			if(lru->len_ < len) {
+				lru->len_ = 0;
+				return false;
+			}
+			std::memcpy(dst, &lru->buff_[0], len);
+			return true;
+		}
+
+
+		// コンテナの末尾に確保
+		bool alloc_tail_(uint32_t blocks, finfo::block& bk) {
+			uint32_t len = blocks * finfo::file_align_size_;
+			uint32_t idx = fidxes_.size();
+			for(uint32_t i = 0; i < fidxes_.size(); ++i) {
+				uint32_t n = fidxes_.size() - 1 - i;	// 新しいコンテナから探す
+				if((fidxes_[n].end_ + len) <= finfo::file_limit_size_) {
+					idx = n;
+					break;
+				}
+			}
+			if(idx == fidxes_.size()) {
+				if(len > finfo::file_limit_size_) return false;
+				fidxes_.emplace_back();
+			}
+			bk = finfo::block(idx, fidxes_[idx].end_ / finfo::file_align_size_, blocks);
+			fidxes_[idx].end_ += len;
+			return true;
+		}
+
+
+		// 開放された領域がコンテナの末尾なら切り詰め、空になったら消す
+		void shrink_(uint32_t idx) {
+			fidx& fx = fidxes_[idx];
+			uint32_t end = free_map_.trim(idx, fx.end_ / finfo::file_align_size_) * finfo::file_align_size_;
+			if(end == fx.end_) return;
+			invalidate_(idx, end, fx.end_);
+			fx.end_ = end;
+			if(end == 0) {
+				close_(idx);
+				remove_file_(block_name_(idx + 1));
+			} else {
+				truncate_(idx, end);
+			}
+		}
+
 	public:
 		//-----------------------------------------------------------------//
 		/*!
@@ -389,7 +543,18 @@ namespace vfs {
 			@param[in]	base	ベース名
 		*/
 		//-----------------------------------------------------------------//
-		fio(finfos& fis, const std::string& base) : fis_(fis), base_(base) { }
+		fio(const std::string& base) : base_(base), fidxes_(), free_map_(),
+			windows_(), stamp_(0), read_count_(0) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	デストラクター
+		*/
+		//-----------------------------------------------------------------//
+		~fio() {
+			for(uint32_t i = 0; i < fidxes_.size(); ++i) close_(i);
+		}
 
 
 		//-----------------------------------------------------------------//
@@ -398,13 +563,17 @@ namespace vfs {
 		*/
 		//-----------------------------------------------------------------//
 		void init() {
+			for(uint32_t i = 0; i < fidxes_.size(); ++i) close_(i);
+			fidxes_.clear();
+			free_map_.clear();
+			for(auto& w : windows_) w.len_ = 0;
 			init_();
 		}
 
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	ファイルのサイズを返す
+			@brief	ホストのファイルのサイズを返す
 			@param[in]	path	ファイル名
 			@return 正常な場合ファイル・サイズ、エラーの場合は「-1」
 		*/
@@ -416,124 +585,231 @@ namespace vfs {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	ファイルの消去
-			@param[in]	idx	ファイル・インデックス
+			@brief	コンテナ数を返す
+			@return コンテナ数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t container_count() const {
+			uint32_t n = 0;
+			for(const auto& fx : fidxes_) if(fx.end_ > 0) ++n;
+			return n;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	空き領域マップを得る
+			@return 空き領域マップ
+		*/
+		//-----------------------------------------------------------------//
+		const free_map& get_free_map() const { return free_map_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ホストへの読み込み回数を得る
+			@return 読み込み回数
 		*/
 		//-----------------------------------------------------------------//
-		void remove_file(uint32_t idx) {
-			auto path = block_name_(idx + 1);
-//			std::cout << "Remove file: '" << path << "'" << std::endl;
-			remove_file_(path);
-			fidxes_[idx].reset();
+		uint32_t get_read_count() const { return read_count_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイルの領域を開放する
+			@param[in]	fi		ファイル情報
+		*/
+		//-----------------------------------------------------------------//
+		void release(finfo& fi) {
+			for(const finfo::block& bk : fi.blocks_) {
+				free_map_.release(bk);
+				invalidate_(bk.fileno_, bk.top(), bk.end());
+			}
+			for(const finfo::block& bk : fi.blocks_) {
+				if(bk.fileno_ < fidxes_.size()) shrink_(bk.fileno_);
+			}
+			fi.blocks_.clear();
 		}
 
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	キャッシュ・バッファの書き込み
+			@brief	キャッシュ・バッファの書き込み @n
+					ファイル末尾のブロックを伸ばせる場合は伸ばし、@n
+					出来ない場合は、空き領域から最適適合で、無ければ @n
+					コンテナの末尾から確保する。
 			@param[in]	fi		ファイル情報
 			@param[in]	close	ファイル・クローズの場合「true」
+			@return 書き込めたら「true」
 		*/
 		//-----------------------------------------------------------------//
-		void write_cash(finfo& fi, bool close) {
-			if(fidxes_.empty()) {
-				fidx fx;
-				fidxes_.push_back(fx);
+		bool write_cash(finfo& fi, bool close) {
+			if(fi.cpos_ == 0) return true;
+
+			// アライメント（キャッシュのサイズはアライメントの倍数）
+			uint32_t len = fi.cpos_;
+			uint32_t mod = len % finfo::file_align_size_;
+			if(mod) {
+				std::memset(fi.cash_ptr(fi.cpos_), 0, finfo::file_align_size_ - mod);
+				len += finfo::file_align_size_ - mod;
 			}
+			uint32_t nb = len / finfo::file_align_size_;
 
-			// 追記できるか？
+			uint32_t idx;
+			uint32_t pos;
+			bool extend = false;
 			if(!fi.blocks_.empty()) {
 				finfo::block& bk = fi.blocks_.back();
-				uint32_t idx = bk.fileno_;
-				fidx& fx = fidxes_[idx];
-				if(fx.opm_ == open_mode::write && fx.hnd_ == fi.handle_) {
-					write_(idx, fi, close);
-					uint32_t org = bk.offset_ * finfo::file_align_size_;
-					bk.blocks_ = (fx.pos_ - org) / finfo::file_align_size_;
-					fi.cpos_ = 0;
-					// 残り容量が、キャッシュサイズ以下なら、追記出来ないので、クローズとする。
-					if(close || (fx.pos_ + finfo::cash_size_) > finfo::file_limit_size_) {
-						fx.opm_ = open_mode::none;
-					}
-//					std::cout << "Append block: " << static_cast<int>(idx) << ", S: " << static_cast<int>(fx.pos_) << std::endl;
-					return;
+				fidx& fx = fidxes_[bk.fileno_];
+				if(bk.end() == fx.end_ && (fx.end_ + len) <= finfo::file_limit_size_) {
+					fx.end_ += len;
+					extend = true;
+				} else if(free_map_.take(bk.fileno_, bk.offset_ + bk.blocks_, nb)) {
+					extend = true;
 				}
-			}
-
-			uint32_t idx = 0;
-			for(auto& fx : fidxes_) {
-				if(fx.pos_ < finfo::file_limit_size_) {
-					uint32_t ms = finfo::file_limit_size_ - fx.pos_;
-					if(fx.opm_ == open_mode::none && ms >= fi.cpos_) {
-						uint32_t pos = fx.pos_;
-						write_(idx, fi, close);
-						
-						if(close || (fx.pos_ + finfo::cash_size_) > finfo::file_limit_size_) {
-							fx.opm_ = open_mode::none;
-						} else {
-							fx.opm_ = open_mode::write;
-						}
-						finfo::block bk;
-						bk.fileno_ = idx;
-						bk.offset_ = pos / finfo::file_align_size_;
-						bk.blocks_ = (fx.pos_ - pos) / finfo::file_align_size_;
-						fi.blocks_.push_back(bk);
-						fi.cpos_ = 0;
-						return;
-					}
+				if(extend) {
+					idx = bk.fileno_;
+					pos = bk.end();
+					bk.blocks_ += nb;
 				}
-				++idx;
 			}
-
-			{ // 新規ブロック
-				idx = fidxes_.size();
-				fidx f;
-				fidxes_.push_back(f);
-				fidx& fx = fidxes_.back();
+			if(!extend) {
 				finfo::block bk;
-				uint32_t pos = fx.pos_;
-				bk.offset_ = fx.pos_ / finfo::file_align_size_;
-				write_(idx, fi, close);
-				if(close) fx.opm_ = open_mode::none;
-				else fx.opm_ = open_mode::write;
-				bk.fileno_ = idx;
-				bk.blocks_ = (fx.pos_ - pos) / finfo::file_align_size_;
+				if(!free_map_.alloc(nb, bk)) {
+					if(!alloc_tail_(nb, bk)) return false;
+				}
+				idx = bk.fileno_;
+				pos = bk.top();
 				fi.blocks_.push_back(bk);
-				fi.cpos_ = 0;
 			}
+			invalidate_(idx, pos, pos + len);
+			bool ret = write_at_(idx, pos, fi.cash_ptr(), len);
+			fi.cpos_ = 0;
+			return ret;
 		}
 
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	キャッシュ・バッファへの読み込み
+			@brief	読み込み @n
+					物理的に隣接するブロックは、一回の読み込みにまとめる。
 			@param[in]	fi		ファイル情報
-			@return 読み込めたら「true」
+			@param[out]	dst		読み込み先
+			@param[in]	size	サイズ
+			@return 読み込んだバイト数（エラーなら「-1」）
 		*/
 		//-----------------------------------------------------------------//
-		bool read_cash(finfo& fi) {
-			for(const finfo::block& bk : fi.blocks_) {
-				uint32_t top = bk.offset_ * finfo::file_align_size_;
-				uint32_t end = top + bk.blocks_ * finfo::file_align_size_;
-				if(top <= fi.fpos_ && fi.fpos_ < end) {
-					fidxes_[bk.fileno_].opm_ = open_mode::read;
-					return read_(bk.fileno_, fi);
+		int read(finfo& fi, void* dst, uint32_t size) {
+			uint8_t* out = static_cast<uint8_t*>(dst);
+			if(fi.fpos_ >= fi.fsize_) return 0;
+			if(size > (fi.fsize_ - fi.fpos_)) size = fi.fsize_ - fi.fpos_;
+
+			int ret = 0;
+			uint32_t lpos = 0;	// ブロックの論理位置
+			uint32_t i = 0;
+			while(size > 0 && i < fi.blocks_.size()) {
+				const finfo::block& bk = fi.blocks_[i];
+				if(fi.fpos_ >= (lpos + bk.size())) {
+					lpos += bk.size();
+					++i;
+					continue;
 				}
+				uint32_t ofs = fi.fpos_ - lpos;
+				uint32_t run = bk.size() - ofs;
+				uint32_t j = i + 1;
+				while(run < size && j < fi.blocks_.size()
+					&& fi.blocks_[j].fileno_ == bk.fileno_
+					&& fi.blocks_[j].top() == fi.blocks_[j - 1].end()) {
+					run += fi.blocks_[j].size();
+					++j;
+				}
+				if(run > size) run = size;
+				if(!read_ahead_(bk.fileno_, bk.top() + ofs, out, run)) return -1;
+				out += run;
+				fi.fpos_ += run;
+				size -= run;
+				ret += static_cast<int>(run);
 			}
-			return false;
+			return ret;
 		}
 
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	読み込み終了
-			@param[in]	fi		ファイル情報
+			@brief	コンパクション（オフライン） @n
+					全てのファイルを、ディレクトリー順に新しいコンテナへ詰めて @n
+					書き直し、古いコンテナと置き換える。@n
+					※オープン中のファイルが無い事
+			@param[in]	fis		ファイル情報群
+			@return 成功なら「true」
 		*/
 		//-----------------------------------------------------------------//
-		void read_close(finfo& fi) {
-			for(const finfo::block& bk : fi.blocks_) {
-				fidxes_[bk.fileno_].opm_ = open_mode::none;
+		bool compact(finfos& fis) {
+			std::vector<finfo::blocks> news(fis.size());
+			std::vector<uint8_t> tmp;
+			uint32_t tidx = 0;
+			uint32_t tpos = 0;
+			std::vector<uint32_t> ends;
+			for(uint32_t n = 0; n < fis.size(); ++n) {
+				finfo& fi = fis[n];
+				if(fi.handle_ == 0 || fi.blocks_.empty()) continue;
+				uint32_t len = (fi.fsize_ + finfo::file_align_size_ - 1) & ~(finfo::file_align_size_ - 1);
+				if(len > fi.capacity()) len = fi.capacity();
+				tmp.resize(len);
+				uint32_t fpos = fi.fpos_;
+				uint32_t fsize = fi.fsize_;
+				fi.fpos_ = 0;
+				fi.fsize_ = len;
+				int rl = read(fi, tmp.data(), len);
+				fi.fpos_ = fpos;
+				fi.fsize_ = fsize;
+				if(rl != static_cast<int>(len)) {
+					close_temp_();
+					return false;
+				}
+				uint32_t org = 0;
+				while(org < len) {
+					if(tpos >= finfo::file_limit_size_) {
+						ends.push_back(tpos);
+						++tidx;
+						tpos = 0;
+					}
+					uint32_t l = std::min(len - org, finfo::file_limit_size_ - tpos);
+					if(!write_temp_(tidx, tpos, &tmp[org], l)) {
+						close_temp_();
+						return false;
+					}
+					finfo::blocks& bks = news[n];
+					if(!bks.empty() && bks.back().fileno_ == tidx && bks.back().end() == tpos) {
+						bks.back().blocks_ += l / finfo::file_align_size_;
+					} else {
+						bks.emplace_back(tidx, tpos / finfo::file_align_size_, l / finfo::file_align_size_);
+					}
+					tpos += l;
+					org += l;
+				}
+			}
+			close_temp_();
+			if(tpos > 0) ends.push_back(tpos);
+
+			// 置き換え
+			for(uint32_t i = 0; i < fidxes_.size(); ++i) {
+				close_(i);
+				remove_file_(block_name_(i + 1));
 			}
+			fidxes_.clear();
+			fidxes_.resize(ends.size());
+			for(uint32_t i = 0; i < ends.size(); ++i) {
+				rename_file_(block_name_(i + 1, true), block_name_(i + 1));
+				fidxes_[i].end_ = ends[i];
+			}
+			free_map_.clear();
+			for(auto& w : windows_) w.len_ = 0;
+			for(uint32_t n = 0; n < fis.size(); ++n) {
+				if(fis[n].handle_ == 0 || fis[n].blocks_.empty()) continue;
+				fis[n].blocks_.swap(news[n]);
+			}
+			return true;
 		}
 
 
@@ -544,6 +820,7 @@ namespace vfs {
 		*/
 		//-----------------------------------------------------------------//
 		void write_dir(const finfos& fis) {
+			for(uint32_t i = 0; i < fidxes_.size(); ++i) close_(i);
 			auto path = block_name_(0);
 			write_dir_(path, fis);
 		}
@@ -551,7 +828,25 @@ namespace vfs {
 
 		//-----------------------------------------------------------------//
 		/*!
-			@brief	ディレクトリー情報の読み込み
+			@brief	ディレクトリーと全てのコンテナのファイルを消す
+		*/
+		//-----------------------------------------------------------------//
+		void remove_all() {
+			for(uint32_t i = 0; i < fidxes_.size(); ++i) {
+				close_(i);
+				remove_file_(block_name_(i + 1));
+			}
+			fidxes_.clear();
+			free_map_.clear();
+			for(auto& w : windows_) w.len_ = 0;
+			remove_file_(block_name_(0));
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ディレクトリー情報の読み込み @n
+					コンテナの使用終端と、空き領域マップを再構築する。
 			@param[in]	fis		ファイル情報群
 		*/
 		//-----------------------------------------------------------------//
@@ -560,16 +855,29 @@ namespace vfs {
 			read_dir_(path, fis);
 
 			// update dir index tables
+			std::vector<finfo::blocks> used;
 			for(const auto& fi : fis) {
 				for(const auto& bk : fi.blocks_) {
-					uint32_t pos = (bk.offset_ + bk.blocks_) * finfo::file_align_size_;
 					if(fidxes_.size() <= bk.fileno_) fidxes_.resize(bk.fileno_ + 1);
-					if(fidxes_[bk.fileno_].pos_ < pos) {
-						fidxes_[bk.fileno_].pos_ = pos;
+					if(used.size() <= bk.fileno_) used.resize(bk.fileno_ + 1);
+					if(fidxes_[bk.fileno_].end_ < bk.end()) {
+						fidxes_[bk.fileno_].end_ = bk.end();
 					}
+					used[bk.fileno_].push_back(bk);
+				}
+			}
+			// 使用領域の隙間を、空き領域とする
+			for(auto& bks : used) {
+				std::sort(bks.begin(), bks.end(),
+					[](const finfo::block& a, const finfo::block& b) { return a.offset_ < b.offset_; });
+				uint32_t pos = 0;
+				for(const auto& bk : bks) {
+					if(pos < bk.offset_) {
+						free_map_.release(finfo::block(bk.fileno_, pos, bk.offset_ - pos));
+					}
+					if(pos < static_cast<uint32_t>(bk.offset_ + bk.blocks_)) pos = bk.offset_ + bk.blocks_;
 				}
 			}
 		}
-
 	};
 }
@@ -0,0 +1,183 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	空き領域マップ（VFS） @n
+			コンテナ上の空き領域を、位置順と大きさ順の二つの索引で管理し、@n
+			最適適合（best-fit）で割り当て、開放時は隣接領域と結合する。
+	@author	平松邦仁 (hira@bexide.co.jp)
+*/
+//=====================================================================//
+#include <map>
+#include <set>
+#include <utility>
+#include "finfo.hpp"
+
+namespace vfs {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	空き領域マップ・クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class free_map {
+
+		// キーは (コンテナ番号 << 16) | 先頭、値は長さ（file_align_size_ 単位）
+		typedef std::map<uint32_t, uint32_t>	pos_map;
+		typedef std::set<std::pair<uint32_t, uint32_t> >	size_set;
+
+		pos_map		pos_;
+		size_set	size_;
+		uint32_t	total_;
+
+		static uint32_t key_(uint32_t fileno, uint32_t offset) { return (fileno << 16) | offset; }
+
+		void insert_(uint32_t key, uint32_t len) {
+			pos_.emplace(key, len);
+			size_.emplace(len, key);
+			total_ += len;
+		}
+
+		void erase_(pos_map::iterator it) {
+			size_.erase(std::make_pair(it->second, it->first));
+			total_ -= it->second;
+			pos_.erase(it);
+		}
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+		*/
+		//-----------------------------------------------------------------//
+		free_map() : pos_(), size_(), total_(0) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	クリア
+		*/
+		//-----------------------------------------------------------------//
+		void clear() {
+			pos_.clear();
+			size_.clear();
+			total_ = 0;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	空き領域の総和を得る
+			@return 空き領域（file_align_size_ 単位）
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t total() const { return total_; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	空き領域の数を得る
+			@return 空き領域の数
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t count() const { return static_cast<uint32_t>(pos_.size()); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	領域を開放する（隣接する空き領域と結合）
+			@param[in]	bk	ブロック
+		*/
+		//-----------------------------------------------------------------//
+		void release(const finfo::block& bk) {
+			if(bk.blocks_ == 0) return;
+			uint32_t key = key_(bk.fileno_, bk.offset_);
+			uint32_t len = bk.blocks_;
+			auto it = pos_.lower_bound(key);
+			// 後ろと結合
+			if(it != pos_.end() && it->first == (key + len)) {
+				len += it->second;
+				auto nx = std::next(it);
+				erase_(it);
+				it = nx;
+			}
+			// 前と結合（同じコンテナ内のみ）
+			if(it != pos_.begin()) {
+				auto pv = std::prev(it);
+				if((pv->first >> 16) == bk.fileno_ && (pv->first + pv->second) == key) {
+					key = pv->first;
+					len += pv->second;
+					erase_(pv);
+				}
+			}
+			insert_(key, len);
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	最適適合で領域を割り当てる
+			@param[in]	blocks	長さ（file_align_size_ 単位）
+			@param[out]	bk	割り当てたブロック
+			@return 割り当て出来たら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool alloc(uint32_t blocks, finfo::block& bk) {
+			if(blocks == 0) return false;
+			auto sit = size_.lower_bound(std::make_pair(blocks, 0u));
+			if(sit == size_.end()) return false;
+			uint32_t key = sit->second;
+			uint32_t len = sit->first;
+			erase_(pos_.find(key));
+			if(len > blocks) {
+				insert_(key + blocks, len - blocks);
+			}
+			bk = finfo::block(key >> 16, key & 0xffff, blocks);
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	指定位置から始まる空き領域を、先頭から割り当てる @n
+					（ファイル末尾のブロックを、その場で伸ばす場合に使う）
+			@param[in]	fileno	コンテナ番号
+			@param[in]	offset	先頭（file_align_size_ 単位）
+			@param[in]	blocks	長さ（file_align_size_ 単位）
+			@return 割り当て出来たら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool take(uint32_t fileno, uint32_t offset, uint32_t blocks) {
+			auto it = pos_.find(key_(fileno, offset));
+			if(it == pos_.end() || it->second < blocks) return false;
+			uint32_t key = it->first;
+			uint32_t len = it->second;
+			erase_(it);
+			if(len > blocks) {
+				insert_(key + blocks, len - blocks);
+			}
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンテナの末尾の空き領域を切り詰める
+			@param[in]	fileno	コンテナ番号
+			@param[in]	end		コンテナの使用終端（file_align_size_ 単位）
+			@return 新しい使用終端
+		*/
+		//-----------------------------------------------------------------//
+		uint32_t trim(uint32_t fileno, uint32_t end) {
+			while(end > 0) {
+				auto it = pos_.lower_bound(key_(fileno + 1, 0));
+				if(it == pos_.begin()) break;
+				auto last = std::prev(it);
+				if((last->first >> 16) != fileno) break;
+				if(((last->first & 0xffff) + last->second) != end) break;
+				end = last->first & 0xffff;
+				erase_(last);
+			}
+			return end;
+		}
+	};
+}
@@ -6,7 +6,11 @@
 //=====================================================================//
 #include <iostream>
 #include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include "files.hpp"
+#include "vfs.hpp"
 
 typedef std::vector<uint8_t> bytes;
 
@@ -62,8 +66,137 @@ static void read_text_(const std::string& path)
 	fs.close(h);
 }
 
+static double elapsed_(const std::chrono::steady_clock::time_point& t)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+}
+
+
+static std::string bench_name_(uint32_t i)
+{
+	char tmp[32];
+	snprintf(tmp, sizeof(tmp), "f%05u.bin", i);
+	return tmp;
+}
+
+
+static bool bench_verify_(vfs::files& bfs, const std::vector<bytes>& src, uint32_t step)
+{
+	bytes tmp;
+	for(uint32_t i = 0; i < src.size(); i += step) {
+		utils::vfs f(bfs);
+		if(!f.open("/bench/" + bench_name_(i), vfs::open_mode::read)) return false;
+		tmp.resize(src[i].size());
+		if(f.read(&tmp[0], tmp.size()) != static_cast<int>(tmp.size())) return false;
+		if(tmp != src[i]) return false;
+	}
+	return true;
+}
+
+
+// 小さなファイルの作成、読み込み（ホスト・ファイルとの比較）
+static int bench_(vfs::files& bfs, const std::string& base, uint32_t num, uint32_t size)
+{
+	bfs.start(false);
+	bfs.mkdir("bench");
+
+	std::vector<bytes> src(num);
+	for(uint32_t i = 0; i < num; ++i) {
+		src[i] = make_bytes_(size / 2 + (rand() % size));
+	}
+
+	auto t = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < num; ++i) {
+		utils::vfs f(bfs);
+		f.open("/bench/" + bench_name_(i), vfs::open_mode::write);
+		f.write(&src[i][0], src[i].size());
+	}
+	bfs.final();
+	double vw = elapsed_(t);
+
+	t = std::chrono::steady_clock::now();
+	bool ok = bench_verify_(bfs, src, 1);
+	double vr = elapsed_(t);
+
+	t = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < num; ++i) {
+		FILE* fp = fopen((base + "_host_" + bench_name_(i)).c_str(), "wb");
+		if(fp == nullptr) return 1;
+		fwrite(&src[i][0], 1, src[i].size(), fp);
+		fclose(fp);
+	}
+	double hw = elapsed_(t);
+
+	t = std::chrono::steady_clock::now();
+	bytes tmp;
+	for(uint32_t i = 0; i < num; ++i) {
+		FILE* fp = fopen((base + "_host_" + bench_name_(i)).c_str(), "rb");
+		if(fp == nullptr) return 1;
+		tmp.resize(src[i].size());
+		if(fread(&tmp[0], 1, tmp.size(), fp) != tmp.size()) ok = false;
+		fclose(fp);
+	}
+	double hr = elapsed_(t);
+	for(uint32_t i = 0; i < num; ++i) {
+		remove((base + "_host_" + bench_name_(i)).c_str());
+	}
+
+	std::cout << "Files: " << num << ", avg " << size << " bytes" << std::endl;
+	std::cout << "VFS  write: " << vw << " ms, read: " << vr << " ms, host reads: "
+		<< bfs.get_fio().get_read_count() << std::endl;
+	std::cout << "Host write: " << hw << " ms, read: " << hr << " ms" << std::endl;
+
+	// 一つおきに消して、作り直す（空き領域の再利用）
+	for(uint32_t i = 0; i < num; i += 2) {
+		bfs.remove("/bench/" + bench_name_(i));
+	}
+	const vfs::free_map& fm = bfs.get_fio().get_free_map();
+	std::cout << "Removed half: free " << fm.count() << " extents, "
+		<< fm.total() * vfs::finfo::file_align_size_ << " bytes" << std::endl;
+	for(uint32_t i = 0; i < num; i += 2) {
+		src[i] = make_bytes_(size / 4 + (rand() % size) / 2);
+		utils::vfs f(bfs);
+		f.open("/bench/" + bench_name_(i), vfs::open_mode::write);
+		f.write(&src[i][0], src[i].size());
+	}
+	std::cout << "Recreated: free " << fm.count() << " extents, "
+		<< fm.total() * vfs::finfo::file_align_size_ << " bytes, containers "
+		<< bfs.get_fio().container_count() << std::endl;
+	ok = ok && bench_verify_(bfs, src, 1);
+
+	t = std::chrono::steady_clock::now();
+	bool cmp = bfs.compact();
+	double ct = elapsed_(t);
+	bfs.final();
+	std::cout << "Compact: " << (cmp ? "OK " : "NG ") << ct << " ms, free " << fm.count()
+		<< " extents, containers " << bfs.get_fio().container_count() << std::endl;
+
+	// ディレクトリーを読み直して検証
+	bfs.start(true);
+	ok = ok && bench_verify_(bfs, src, 1);
+	std::cout << "Verify: " << (ok ? "OK" : "NG") << std::endl;
+	return ok ? 0 : 1;
+}
+
+
 int main(int argc, char** argv)
 {
+	if(argc >= 2 && std::string(argv[1]) == "-bench") {
+		uint32_t num = 2000;
+		uint32_t size = 2048;
+		if(argc >= 3) num = atoi(argv[2]);
+		if(argc >= 4) size = atoi(argv[3]);
+		// コンテナは一時ディレクトリーに作り、終わったら消す
+		const char* dir = getenv("TMPDIR");
+		if(dir == nullptr) dir = getenv("TEMP");
+		if(dir == nullptr) dir = "/tmp";
+		std::string base = std::string(dir) + "/VFS";
+		vfs::files bfs(base);
+		int ret = bench_(bfs, base, num, size);
+		bfs.remove_all();
+		return ret;
+	}
+
 	fs.start(true);
 
 	fs.mkdir("qwe");
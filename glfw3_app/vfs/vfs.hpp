@@ -1,75 +1,150 @@
 #pragma once
+//=====================================================================//
+/*!	@file
+	@brief	VFS ファイル・クラス（ハンドルのラッパー） @n
+			vfs::files 上のファイルを、一つのオブジェクトとして扱う。
+	@author	平松邦仁 (hira@bexide.co.jp)
+*/
+//=====================================================================//
 #include "files.hpp"
 
 namespace utils {
 
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief	VFS ファイル・クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	class vfs {
 
-		files&	files_;
-
-		static const uint32_t cash_size_ = 8192;
-
-		open_mode	open_mode_;
-
-		std::vector<uint16_t>	list_;
-		std::vector<uint8_t>	cash_;
+		::vfs::files&	files_;
 
 		uint32_t	handle_;
 
-	public:
-		vfs(files& fs) : files_(fs), open_mode_(open_mode::none), handle_(0) { }
+		vfs(const vfs&) = delete;
+		vfs& operator = (const vfs&) = delete;
 
-		void init() {
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	コンストラクター
+			@param[in]	fs	ファイル群
+		*/
+		//-----------------------------------------------------------------//
+		vfs(::vfs::files& fs) : files_(fs), handle_(0) { }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	デストラクター
+		*/
+		//-----------------------------------------------------------------//
+		~vfs() { close(); }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	オープン
+			@param[in]	path	パス
+			@param[in]	mode	オープン・モード
+			@return 成功なら「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool open(const std::string& path, ::vfs::open_mode mode) {
+			close();
+			handle_ = files_.open(path, mode);
+			return handle_ != 0;
 		}
 
-		bool open(const std::string& path, open_mode mode) {
-			handle_ = files_.install(path);
-			if(handle_ == 0) {
-				return false;
-			}
-			open_mode_ = mode;
-
 
-			return true;
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	オープンしているか
+			@return オープンしていれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		bool is_open() const { return handle_ != 0; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	読み込み
+			@param[out]	ptr	読み込み先
+			@param[in]	len	サイズ
+			@return 読み込んだバイト数（エラーなら「-1」）
+		*/
+		//-----------------------------------------------------------------//
+		int read(void* ptr, uint32_t len) {
+			if(handle_ == 0) return -1;
+			return files_.read(handle_, ptr, len);
 		}
 
 
-		int read(const void* ptr, uint32_t len) {
-			if(open_mode_ != open_mode::read) {
-				return -1;
-			}
-
-
-
-			return 0;
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	書き込み
+			@param[in]	ptr	書き込み元
+			@param[in]	len	サイズ
+			@return 書き込んだバイト数（エラーなら「-1」）
+		*/
+		//-----------------------------------------------------------------//
+		int write(const void* ptr, uint32_t len) {
+			if(handle_ == 0) return -1;
+			return files_.write(handle_, ptr, len);
 		}
 
 
-		int write(void* ptr, uint32_t len) {
-			if(open_mode_ != open_mode::write) {
-				return -1;
-			}
-
-
-			return 0;
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	シーク
+			@param[in]	mode	シーク・モード
+			@param[in]	offset	オフセット
+			@return 移動した位置（エラーなら「-1」）
+		*/
+		//-----------------------------------------------------------------//
+		int seek(::vfs::seek_mode mode, uint32_t offset) {
+			if(handle_ == 0) return -1;
+			return files_.seek(handle_, offset, mode);
 		}
 
 
-		int seek(seek_mode mode, uint32_t offset) {
-
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	ファイル位置を取得
+			@return ファイル位置（エラーなら「-1」）
+		*/
+		//-----------------------------------------------------------------//
+		int tell() const {
+			if(handle_ == 0) return -1;
+			return files_.tell(handle_);
+		}
 
 
-			return static_cast<int>(offset);
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	終端か検査
+			@return 終端なら「1」（エラーなら「-1」）
+		*/
+		//-----------------------------------------------------------------//
+		int eof() const {
+			if(handle_ == 0) return -1;
+			return files_.eof(handle_);
 		}
 
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief	クローズ
+			@return 成功なら「０」
+		*/
+		//-----------------------------------------------------------------//
 		int close() {
-			if(open_mode_ == open_mode::none) {
+			if(handle_ == 0) {
 				return -1;
 			}
-			open_mode_ = open_mode::none;
+			files_.close(handle_);
+			handle_ = 0;
 			return 0;
 		}
-
 	};
 }